@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe source module for AF_PACKET TPACKET_V3 rings
+ *
+ * This source receives UDP datagrams from a memory mapped packet ring, as a
+ * portable alternative to netmap. The uri has the same syntax as for
+ * @ref upipe_udpsrc_mgr_alloc, with the following options:
+ *   - ifname=<name>: interface to capture on (mandatory),
+ *   - fanout=<id>: PACKET_FANOUT group to join, to spread the load over
+ *     several pipes,
+ *   - fanout-mode=<hash|lb|cpu|qm>: fanout balancing mode (default hash),
+ *   - blocks=<n>: number of blocks of the ring,
+ *   - block-size=<bytes>: size of a block, a multiple of the page size.
+ * For instance "@239.1.1.1:5000/ifname=eth0/fanout=42".
+ *
+ * Output buffers point directly into the ring. The kernel fills blocks in
+ * order, so urefs which are kept longer than the ring can hold stall
+ * reception until they are freed.
+ */
+
+#ifndef _UPIPE_AFPACKET_UPIPE_AFPACKET_SOURCE_H_
+/** @hidden */
+#define _UPIPE_AFPACKET_UPIPE_AFPACKET_SOURCE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_AFPACKET_SOURCE_SIGNATURE UBASE_FOURCC('a','f','p','s')
+
+/** @This returns the management structure for afpacket_source pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_afpacket_source_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
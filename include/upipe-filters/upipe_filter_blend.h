@@ -39,6 +39,45 @@ extern "C" {
  */
 struct upipe_mgr *upipe_filter_blend_mgr_alloc(void);
 
+/** @This extends upipe_command with specific commands for blend pipes. */
+enum upipe_filter_blend_command {
+    UPIPE_FILTER_BLEND_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** gets the number of filtering threads (unsigned int *) */
+    UPIPE_FILTER_BLEND_GET_THREADS,
+    /** sets the number of filtering threads (unsigned int) */
+    UPIPE_FILTER_BLEND_SET_THREADS
+};
+
+/** @This gets the number of threads filtering the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_filter_blend_get_threads(struct upipe *upipe,
+                                                 unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_FILTER_BLEND_GET_THREADS,
+                         UPIPE_FILTER_BLEND_SIGNATURE, threads_p);
+}
+
+/** @This sets the number of threads filtering the pictures. The planes are
+ * split into as many slices of lines, one of which is filtered by the thread
+ * calling @ref upipe_input while the others are handed to worker threads.
+ * The default is 1, which filters the whole picture on the calling thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static inline int upipe_filter_blend_set_threads(struct upipe *upipe,
+                                                 unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_FILTER_BLEND_SET_THREADS,
+                         UPIPE_FILTER_BLEND_SIGNATURE, threads);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-6 depacketizer
+ *
+ * This pipe takes RTP packets and reassembles the packed 10-bit SDI frames,
+ * suitable for unpack10bit. The output flow definition carries the active
+ * picture size, frame rate and scan mode signalled in the HBRMT header.
+ */
+
+#ifndef _UPIPE_HBRMT_UPIPE_HBRMT_DEC_H_
+/** @hidden */
+#define _UPIPE_HBRMT_UPIPE_HBRMT_DEC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UPIPE_HBRMT_DEC_SIGNATURE UBASE_FOURCC('h','b','r','d')
+
+#include <upipe/upipe.h>
+
+/** @This returns the management structure for hbrmt_dec pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hbrmt_dec_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-6 packetizer
+ *
+ * This pipe takes packed 10-bit SDI frames (as output by pack10bit), with
+ * a flow definition carrying the active picture size, frame rate and scan
+ * mode of the raster, and outputs complete RTP packets. The payloads are
+ * spliced from the frame without copy, and the system clock reference of
+ * each packet is spread linearly over the frame duration.
+ */
+
+#ifndef _UPIPE_HBRMT_UPIPE_HBRMT_ENC_H_
+/** @hidden */
+#define _UPIPE_HBRMT_UPIPE_HBRMT_ENC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UPIPE_HBRMT_ENC_SIGNATURE UBASE_FOURCC('h','b','r','e')
+
+#include <upipe/upipe.h>
+
+/** @This returns the management structure for hbrmt_enc pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hbrmt_enc_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2110-20 packetizer
+ *
+ * This pipe takes 4:2:2 10-bit pictures stored as 16-bit samples in a single
+ * "u10y10v10y10" plane, and outputs complete RTP packets carrying 4:2:2
+ * 10-bit pgroups, possibly with several sample row data headers per packet.
+ * Interlaced pictures are sent field by field. The system clock reference of
+ * each packet is spread linearly over the frame duration.
+ */
+
+#ifndef _UPIPE_HBRMT_UPIPE_RFC4175_ENC_H_
+/** @hidden */
+#define _UPIPE_HBRMT_UPIPE_RFC4175_ENC_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UPIPE_RFC4175_ENC_SIGNATURE UBASE_FOURCC('r','f','c','e')
+
+#include <upipe/upipe.h>
+
+/** @This returns the management structure for rfc4175_enc pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rfc4175_enc_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -39,6 +39,46 @@ extern "C" {
  */
 struct upipe_mgr *upipe_unpack10bit_mgr_alloc(void);
 
+/** @This extends upipe_command with specific commands for unpack10bit pipes. */
+enum upipe_unpack10bit_command {
+    UPIPE_UNPACK10BIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** gets the number of unpacking threads (unsigned int *) */
+    UPIPE_UNPACK10BIT_GET_THREADS,
+    /** sets the number of unpacking threads (unsigned int) */
+    UPIPE_UNPACK10BIT_SET_THREADS
+};
+
+/** @This gets the number of threads unpacking the blocks.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_unpack10bit_get_threads(struct upipe *upipe,
+                                                unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_UNPACK10BIT_GET_THREADS,
+                         UPIPE_UNPACK10BIT_SIGNATURE, threads_p);
+}
+
+/** @This sets the number of threads unpacking the blocks. The samples of
+ * the block are split into as many slices, one of which is unpacked by the
+ * thread calling @ref upipe_input while the others are handed to worker
+ * threads. The default is 1, which unpacks the whole block on the calling
+ * thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static inline int upipe_unpack10bit_set_threads(struct upipe *upipe,
+                                                unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_UNPACK10BIT_SET_THREADS,
+                         UPIPE_UNPACK10BIT_SIGNATURE, threads);
+}
+
 #ifdef __cplusplus
 }
 #endif
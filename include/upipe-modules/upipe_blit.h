@@ -61,7 +61,11 @@ enum upipe_blit_command {
     UPIPE_BLIT_SENTINEL = UPIPE_CONTROL_LOCAL,
 
     /** prepares the next picture to output (struct upump **) */
-    UPIPE_BLIT_PREPARE
+    UPIPE_BLIT_PREPARE,
+    /** gets the number of compositing threads (unsigned int *) */
+    UPIPE_BLIT_GET_THREADS,
+    /** sets the number of compositing threads (unsigned int) */
+    UPIPE_BLIT_SET_THREADS
 };
 
 /** @This extends upipe_command with specific commands for upipe_blit_sub pipes.
@@ -108,6 +112,36 @@ static inline int upipe_blit_prepare(struct upipe *upipe,
                                upump_p);
 }
 
+/** @This gets the number of threads compositing the output pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_blit_get_threads(struct upipe *upipe,
+                                         unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_BLIT_GET_THREADS, UPIPE_BLIT_SIGNATURE,
+                         threads_p);
+}
+
+/** @This sets the number of threads compositing the output pictures. The
+ * picture is split into as many horizontal bands, one of which is
+ * composited by the thread calling @ref upipe_blit_prepare while the others
+ * are handed to worker threads. The default is 1, which composites the
+ * whole picture on the calling thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static inline int upipe_blit_set_threads(struct upipe *upipe,
+                                         unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_BLIT_SET_THREADS, UPIPE_BLIT_SIGNATURE,
+                         threads);
+}
+
 /** @This gets the offsets (from the respective borders of the frame) of the
  * rectangle onto which the input of the subpipe will be blitted.
  *
@@ -28,7 +28,8 @@
  *
  * Note that the allocator requires an additional parameter:
  * @table 2
- * @item queue_length @item maximum length of the queue (<= 255)
+ * @item queue_length @item maximum length of the queue (<=
+ * @ref UQUEUE_MAX_LENGTH)
  * @end table
  *
  * Also note that this module is exceptional in that upipe_release() may be
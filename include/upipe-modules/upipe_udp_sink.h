@@ -51,6 +51,14 @@ enum upipe_udpsink_command {
     UPIPE_UDPSINK_SET_FD,
     /** set remote address (const struct sockaddr *, socklen_t) **/
     UPIPE_UDPSINK_SET_PEER,
+    /** get the maximum number of datagrams sent at once (unsigned int *) **/
+    UPIPE_UDPSINK_GET_BATCH,
+    /** set the maximum number of datagrams sent at once (unsigned int) **/
+    UPIPE_UDPSINK_SET_BATCH,
+    /** get segmentation offload mode (int *) **/
+    UPIPE_UDPSINK_GET_GSO,
+    /** set segmentation offload mode (int) **/
+    UPIPE_UDPSINK_SET_GSO,
 };
 
 /** @This returns the management structure for all udp sinks.
@@ -96,6 +104,62 @@ static inline int upipe_udpsink_set_peer(struct upipe *upipe,
     return upipe_control(upipe, UPIPE_UDPSINK_SET_PEER, UPIPE_UDPSINK_SIGNATURE,
             addr, addrlen);
 }
+
+/** @This returns the maximum number of datagrams sent at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_batch(struct upipe *upipe,
+                                          unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch_p);
+}
+
+/** @This sets the maximum number of datagrams sent at once. When greater
+ * than 1, datagrams which are due are kept until the end of the current
+ * event loop iteration, or until there are batch of them, and are then sent
+ * with a single sendmmsg(2) call. This is only available on systems
+ * providing sendmmsg(2).
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams (1 disables batch mode)
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_batch(struct upipe *upipe,
+                                          unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch);
+}
+
+/** @This returns whether segmentation offload is enabled.
+ *
+ * @param upipe description structure of the pipe
+ * @param gso_p filled in with true if segmentation offload is enabled
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_gso(struct upipe *upipe, int *gso_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_GSO,
+                         UPIPE_UDPSINK_SIGNATURE, gso_p);
+}
+
+/** @This enables or disables segmentation offload in batch mode.
+ * Consecutive datagrams of the same size are then handed over to the kernel
+ * as a single buffer with UDP_SEGMENT. It has no effect on raw sockets.
+ *
+ * @param upipe description structure of the pipe
+ * @param gso true to enable segmentation offload
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_gso(struct upipe *upipe, int gso)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_GSO,
+                         UPIPE_UDPSINK_SIGNATURE, gso);
+}
 #ifdef __cplusplus
 }
 #endif
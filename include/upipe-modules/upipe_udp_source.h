@@ -36,6 +36,11 @@ extern "C" {
 #endif
 
 #include <upipe/upipe.h>
+#include <upipe/uref_attr.h>
+
+/** raw hardware reception date, in 27 MHz units of the clock of the network
+ * interface (PHC), which is not related to the system clock */
+UREF_ATTR_UNSIGNED(udpsrc, hw_date, "udpsrc.hw_date", hardware reception date)
 
 #define UPIPE_UDPSRC_SIGNATURE UBASE_FOURCC('u','s','r','c')
 
@@ -47,6 +52,27 @@ enum upipe_udpsrc_command {
     UPIPE_UDPSRC_GET_FD,
     /** set socket fd (int) */
     UPIPE_UDPSRC_SET_FD,
+    /** get the number of datagrams read per wakeup (unsigned int *) */
+    UPIPE_UDPSRC_GET_BATCH,
+    /** set the number of datagrams read per wakeup (unsigned int) */
+    UPIPE_UDPSRC_SET_BATCH,
+    /** get the source of reception dates (int *) */
+    UPIPE_UDPSRC_GET_TIMESTAMP,
+    /** set the source of reception dates (int) */
+    UPIPE_UDPSRC_SET_TIMESTAMP,
+};
+
+/** @This defines the possible sources of the reception dates (cr_sys). */
+enum upipe_udpsrc_timestamp {
+    /** uclock is read when the pipe is woken up (default) */
+    UPIPE_UDPSRC_TIMESTAMP_UCLOCK = 0,
+    /** software timestamp taken by the kernel (SO_TIMESTAMPNS) */
+    UPIPE_UDPSRC_TIMESTAMP_KERNEL,
+    /** software timestamp taken by the kernel (SO_TIMESTAMPING); if the
+     * network interface has been configured for it, its raw hardware
+     * timestamp is also attached as a separate hw_date attribute, as it is
+     * in the clock domain of the interface and not of the system */
+    UPIPE_UDPSRC_TIMESTAMP_HARDWARE,
 };
 
 /** @This extends uprobe_throw with specific events. */
@@ -81,6 +107,67 @@ static inline int upipe_udpsrc_set_fd(struct upipe *upipe, int fd)
                          fd);
 }
 
+/** @This returns the number of datagrams read per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_batch(struct upipe *upipe,
+                                         unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_BATCH, UPIPE_UDPSRC_SIGNATURE,
+                         batch_p);
+}
+
+/** @This sets the number of datagrams read per wakeup. When greater than 1,
+ * datagrams are received with a single recvmmsg(2) call into pre-allocated
+ * buffers, and output in a row. As they are all read at the same time, each
+ * datagram is then dated from its kernel reception timestamp (SO_TIMESTAMPNS)
+ * instead of the time of the wakeup. This is only available on systems
+ * providing recvmmsg(2).
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams (1 disables batch mode)
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_batch(struct upipe *upipe,
+                                         unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_BATCH, UPIPE_UDPSRC_SIGNATURE,
+                         batch);
+}
+
+/** @This returns the source of the reception dates.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp_p filled in with the source of the reception dates
+ * (@ref upipe_udpsrc_timestamp)
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_timestamp(struct upipe *upipe,
+                                             int *timestamp_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp_p);
+}
+
+/** @This sets the source of the reception dates. Kernel timestamps are
+ * converted to the domain of the uclock, and are not affected by the
+ * scheduling latency of the thread running the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp source of the reception dates
+ * (@ref upipe_udpsrc_timestamp)
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_timestamp(struct upipe *upipe,
+                                             int timestamp)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp);
+}
+
 /** @This returns the management structure for all udp socket sources.
  *
  * @return pointer to manager
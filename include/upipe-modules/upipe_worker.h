@@ -60,6 +60,11 @@ extern "C" {
 #define UPIPE_WORK_SIGNATURE UBASE_FOURCC('w','o','r','k')
 
 /** @This returns the management structure for all worker pipes.
+ *
+ * The bin stays in the calling thread, while the remote subpipeline is
+ * attached to the event loop behind xfer_mgr. Allocate the
+ * manager with @ref upipe_pthread_work_mgr_alloc to choose the CPUs,
+ * priority and memory node of that thread.
  *
  * @param xfer_mgr manager to transfer pipes to the remote thread
  * @return pointer to manager
@@ -61,6 +61,10 @@ extern "C" {
 #define UPIPE_WLIN_SIGNATURE UBASE_FOURCC('w','l','i','n')
 
 /** @This returns the management structure for all wlin pipes.
+ *
+ * Each packet crosses to the thread of xfer_mgr and back, so for
+ * latency-sensitive processing @ref upipe_pthread_wlin_mgr_alloc can give
+ * that thread its own CPUs and a real-time priority.
  *
  * @param xfer_mgr manager to transfer pipes to the remote thread
  * @return pointer to manager
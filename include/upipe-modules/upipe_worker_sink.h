@@ -59,6 +59,10 @@ extern "C" {
 #define UPIPE_WSINK_SIGNATURE UBASE_FOURCC('w','s','n','k')
 
 /** @This returns the management structure for all wsink pipes.
+ *
+ * The sink paces its output in the thread of xfer_mgr, where a real-time
+ * priority set with @ref upipe_pthread_wsink_mgr_alloc keeps the timing of
+ * output packets from being disturbed by the rest of the application.
  *
  * @param xfer_mgr manager to transfer pipes to the remote thread
  * @return pointer to manager
@@ -58,6 +58,10 @@ extern "C" {
 #define UPIPE_WSRC_SIGNATURE UBASE_FOURCC('w','s','r','c')
 
 /** @This returns the management structure for all wsrc pipes.
+ *
+ * The source reads from its device or socket in the thread of xfer_mgr;
+ * @ref upipe_pthread_wsrc_mgr_alloc runs it on the CPUs and memory node
+ * closest to the device (e.g. a capture card or a NIC).
  *
  * @param xfer_mgr manager to transfer pipes to the remote thread
  * @return pointer to manager
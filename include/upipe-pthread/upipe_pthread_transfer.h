@@ -40,11 +40,97 @@ extern "C" {
 #include <upipe/upump.h>
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 #include <pthread.h>
 
 /** @hidden */
 struct umutex;
 
+/** maximum number of CPUs that can be addressed by
+ * @ref upipe_pthread_xfer_attr */
+#define UPIPE_PTHREAD_XFER_MAX_CPUS 1024
+
+/** @This describes where and how the xfer thread runs. The settings are
+ * applied by the new thread itself before it spawns its event loop; failures
+ * are reported as warnings on the upump_mgr probe and do not prevent the
+ * thread from running. Since worker bins (wlin, wsrc, wsink) are allocated
+ * from an xfer manager, a manager allocated with these attributes places all
+ * the remote pipes of the workers using it. */
+struct upipe_pthread_xfer_attr {
+    /** bitmap of the CPUs the thread may run on (empty means no
+     * restriction) */
+    uint64_t cpus[UPIPE_PTHREAD_XFER_MAX_CPUS / 64];
+    /** scheduling policy (SCHED_FIFO, SCHED_RR), or -1 to keep the
+     * inherited one */
+    int sched_policy;
+    /** scheduling priority, used with SCHED_FIFO and SCHED_RR */
+    int sched_priority;
+    /** NUMA node to allocate memory from, or -1 */
+    int numa_node;
+    /** true to only allocate memory from numa_node, false to prefer it */
+    bool numa_strict;
+};
+
+/** @This initializes a structure of xfer thread attributes with default
+ * values (no CPU restriction, inherited scheduling, no memory policy).
+ *
+ * @param attr pointer to the attributes
+ */
+static inline void
+upipe_pthread_xfer_attr_init(struct upipe_pthread_xfer_attr *attr)
+{
+    memset(attr->cpus, 0, sizeof(attr->cpus));
+    attr->sched_policy = -1;
+    attr->sched_priority = 0;
+    attr->numa_node = -1;
+    attr->numa_strict = false;
+}
+
+/** @This allows the xfer thread to run on the given CPU.
+ *
+ * @param attr pointer to the attributes
+ * @param cpu CPU number
+ * @return false if the CPU number is out of range
+ */
+static inline bool
+upipe_pthread_xfer_attr_add_cpu(struct upipe_pthread_xfer_attr *attr,
+                                unsigned int cpu)
+{
+    if (cpu >= UPIPE_PTHREAD_XFER_MAX_CPUS)
+        return false;
+    attr->cpus[cpu / 64] |= UINT64_C(1) << (cpu % 64);
+    return true;
+}
+
+/** @This sets the real-time scheduling policy of the xfer thread.
+ *
+ * @param attr pointer to the attributes
+ * @param policy SCHED_FIFO or SCHED_RR
+ * @param priority real-time priority
+ */
+static inline void
+upipe_pthread_xfer_attr_set_sched(struct upipe_pthread_xfer_attr *attr,
+                                  int policy, int priority)
+{
+    attr->sched_policy = policy;
+    attr->sched_priority = priority;
+}
+
+/** @This sets the NUMA node the xfer thread allocates memory from.
+ *
+ * @param attr pointer to the attributes
+ * @param node NUMA node, or -1 to use the default policy
+ * @param strict true to bind allocations to the node, false to prefer it
+ */
+static inline void
+upipe_pthread_xfer_attr_set_numa_node(struct upipe_pthread_xfer_attr *attr,
+                                      int node, bool strict)
+{
+    attr->numa_node = node;
+    attr->numa_strict = strict;
+}
+
 /** @This returns a management structure for transfer pipes, using a new
  * pthread. You would need one management structure per target thread.
  *
@@ -61,7 +147,7 @@ struct umutex;
  * @param attr pthread attributes
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(unsigned int queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
@@ -85,7 +171,7 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
  * @param name custom name
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(unsigned int queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
@@ -112,7 +198,7 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(uint8_t queue_length,
  */
 UBASE_FMT_PRINTF(10, 11)
 static inline struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named_va(
-        uint8_t queue_length, uint16_t msg_pool_depth,
+        unsigned int queue_length, uint16_t msg_pool_depth,
         struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
@@ -129,6 +215,32 @@ static inline struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named_va(
                                                     string), NULL)
 }
 
+/** @This returns a management structure for transfer pipes, using a new
+ * pthread with a custom name, CPU affinity, scheduling policy and memory
+ * node. You would need one management structure per target thread.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param pthread_id_p reference to created thread ID (may be NULL)
+ * @param attr pthread attributes
+ * @param xfer_attr thread placement attributes (may be NULL)
+ * @param name custom name (may be NULL)
+ * @return pointer to xfer manager
+ */
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_attr(unsigned int queue_length,
+        uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+        const struct upipe_pthread_xfer_attr *xfer_attr, const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014-2019 OpenHeadend S.A.R.L.
+ *
+ * Authors: Christophe Massiot
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Worker bins running their remote pipes in a new POSIX thread
+ *
+ * These allocators create the thread of a worker manager (wlin, wsrc,
+ * wsink) together with the manager, so that the CPUs, scheduling policy
+ * and memory node of the remote pipes are given where the worker is set up.
+ * The thread ends when the manager and all its pipes are released.
+ */
+
+#ifndef _UPIPE_PTHREAD_UPIPE_PTHREAD_WORKER_H_
+/** @hidden */
+#define _UPIPE_PTHREAD_UPIPE_PTHREAD_WORKER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_worker.h>
+#include <upipe-modules/upipe_worker_linear.h>
+#include <upipe-modules/upipe_worker_source.h>
+#include <upipe-modules/upipe_worker_sink.h>
+#include <upipe-pthread/upipe_pthread_transfer.h>
+
+/** @This declares a function returning a management structure for worker
+ * pipes, whose remote subpipelines run in a new pthread.
+ *
+ * Supposing the worker is upipe_foo, it declares:
+ * @code
+ *  struct upipe_mgr *upipe_pthread_foo_mgr_alloc(
+ *      unsigned int queue_length, uint16_t msg_pool_depth,
+ *      struct uprobe *uprobe_pthread_upump_mgr,
+ *      upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+ *      uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+ *      pthread_t *pthread_id_p,
+ *      const struct upipe_pthread_xfer_attr *xfer_attr, const char *name)
+ * @end code
+ * with the following parameters:
+ * @list
+ * @item queue_length maximum length of the internal queue of commands
+ * @item msg_pool_depth maximum number of messages in the pool
+ * @item uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @item upump_mgr_alloc alloc function provided by the upump manager
+ * @item upump_pool_depth maximum number of upump structures in the pool
+ * @item upump_blocker_pool_depth maximum number of upump_blocker structures
+ * in the pool
+ * @item mutex mutual exclusion primitives to access the event loop, or NULL
+ * @item pthread_id_p reference to created thread ID (may be NULL)
+ * @item xfer_attr thread placement attributes (may be NULL)
+ * @item name custom name of the thread (may be NULL)
+ * @end list
+ * It returns a pointer to the manager, or NULL in case of error.
+ *
+ * @param worker short name of the worker (work, wlin, wsrc or wsink)
+ */
+#define UPIPE_PTHREAD_WORK_MGR_ALLOC(worker)                                \
+static inline struct upipe_mgr *upipe_pthread_##worker##_mgr_alloc(         \
+        unsigned int queue_length, uint16_t msg_pool_depth,                 \
+        struct uprobe *uprobe_pthread_upump_mgr,                            \
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,         \
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,            \
+        pthread_t *pthread_id_p,                                            \
+        const struct upipe_pthread_xfer_attr *xfer_attr, const char *name)  \
+{                                                                           \
+    struct upipe_mgr *xfer_mgr = upipe_pthread_xfer_mgr_alloc_attr(         \
+            queue_length, msg_pool_depth, uprobe_pthread_upump_mgr,         \
+            upump_mgr_alloc, upump_pool_depth, upump_blocker_pool_depth,    \
+            mutex, pthread_id_p, NULL, xfer_attr, name);                    \
+    if (unlikely(xfer_mgr == NULL))                                         \
+        return NULL;                                                        \
+                                                                            \
+    struct upipe_mgr *mgr = upipe_##worker##_mgr_alloc(xfer_mgr);           \
+    upipe_mgr_release(xfer_mgr);                                            \
+    return mgr;                                                             \
+}
+
+UPIPE_PTHREAD_WORK_MGR_ALLOC(work)
+UPIPE_PTHREAD_WORK_MGR_ALLOC(wlin)
+UPIPE_PTHREAD_WORK_MGR_ALLOC(wsrc)
+UPIPE_PTHREAD_WORK_MGR_ALLOC(wsink)
+#undef UPIPE_PTHREAD_WORK_MGR_ALLOC
+
+#ifdef __cplusplus
+}
+#endif
+#endif
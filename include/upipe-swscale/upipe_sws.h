@@ -45,7 +45,17 @@ enum upipe_sws_command {
     /** set flags (int) */
     UPIPE_SWS_SET_FLAGS,
     /** get flags (int *) */
-    UPIPE_SWS_GET_FLAGS
+    UPIPE_SWS_GET_FLAGS,
+    /** gets the number of conversion threads (unsigned int *) */
+    UPIPE_SWS_GET_THREADS,
+    /** sets the number of conversion threads (unsigned int) */
+    UPIPE_SWS_SET_THREADS,
+    /** gets the number of pictures converted in the background
+     * (unsigned int *) */
+    UPIPE_SWS_GET_PIPELINE,
+    /** sets the number of pictures converted in the background
+     * (unsigned int) */
+    UPIPE_SWS_SET_PIPELINE
 };
 
 /** @This gets the swscale flags.
@@ -72,6 +82,71 @@ static inline bool upipe_sws_set_flags(struct upipe *upipe, int flags)
                          flags);
 }
 
+/** @This gets the number of threads converting the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_sws_get_threads(struct upipe *upipe,
+                                        unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_SWS_GET_THREADS, UPIPE_SWS_SIGNATURE,
+                         threads_p);
+}
+
+/** @This sets the number of threads converting the pictures. Each thread
+ * has its own swscale contexts, and the output pictures are split into as
+ * many slices of lines, one of which is converted by the thread calling
+ * @ref upipe_input while the others are handed to worker threads. Slices
+ * require libswscale 6.1 or later; with older versions, each picture is
+ * converted by a single thread, which is only useful together with
+ * @ref upipe_sws_set_pipeline. The default is 1, which converts the whole
+ * picture on the calling thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static inline int upipe_sws_set_threads(struct upipe *upipe,
+                                        unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_SWS_SET_THREADS, UPIPE_SWS_SIGNATURE,
+                         threads);
+}
+
+/** @This gets the number of pictures converted in the background.
+ *
+ * @param upipe description structure of the pipe
+ * @param pipeline_p filled in with the number of pictures
+ * @return an error code
+ */
+static inline int upipe_sws_get_pipeline(struct upipe *upipe,
+                                         unsigned int *pipeline_p)
+{
+    return upipe_control(upipe, UPIPE_SWS_GET_PIPELINE, UPIPE_SWS_SIGNATURE,
+                         pipeline_p);
+}
+
+/** @This sets the number of pictures converted in the background. When it
+ * is not 0, @ref upipe_input hands the picture to the worker threads and
+ * returns without waiting for it; the converted pictures are output in
+ * order by later calls, when more than this number of pictures are pending,
+ * when the input flow definition changes, and when the pipe is released.
+ * The default is 0, which outputs each picture before @ref upipe_input
+ * returns. It requires at least 2 threads (see @ref upipe_sws_set_threads).
+ *
+ * @param upipe description structure of the pipe
+ * @param pipeline number of pictures
+ * @return an error code
+ */
+static inline int upipe_sws_set_pipeline(struct upipe *upipe,
+                                         unsigned int pipeline)
+{
+    return upipe_control(upipe, UPIPE_SWS_SET_PIPELINE, UPIPE_SWS_SIGNATURE,
+                         pipeline);
+}
+
 /** @This returns the management structure for sws pipes.
  *
  * @return pointer to manager
@@ -49,7 +49,16 @@ enum upipe_ts_sync_command {
     /** returns the configured number of packets to synchronize with (int *) */
     UPIPE_TS_SYNC_GET_SYNC,
     /** sets the configured number of packets to synchronize with (int) */
-    UPIPE_TS_SYNC_SET_SYNC
+    UPIPE_TS_SYNC_SET_SYNC,
+    /** returns the maximum number of packets per output uref
+     * (unsigned int *) */
+    UPIPE_TS_SYNC_GET_VECTOR,
+    /** sets the maximum number of packets per output uref (unsigned int) */
+    UPIPE_TS_SYNC_SET_VECTOR,
+    /** returns whether the packet size is detected (int *) */
+    UPIPE_TS_SYNC_GET_AUTODETECT,
+    /** sets whether the packet size is detected (int) */
+    UPIPE_TS_SYNC_SET_AUTODETECT
 };
 
 /** @This returns the management structure for all ts_sync pipes.
@@ -84,6 +93,62 @@ static inline int upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
                          sync);
 }
 
+/** @This returns the maximum number of packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector_p filled in with number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_sync_get_vector(struct upipe *upipe,
+                                           unsigned int *vector_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_GET_VECTOR,
+                         UPIPE_TS_SYNC_SIGNATURE, vector_p);
+}
+
+/** @This sets the maximum number of packets per output uref. The default
+ * is 1. With higher values, consecutive 188-octet TS packets are output in
+ * the same uref with the flow definition "block.mpegtsaligned.".
+ *
+ * @param upipe description structure of the pipe
+ * @param vector number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_sync_set_vector(struct upipe *upipe,
+                                           unsigned int vector)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_SET_VECTOR,
+                         UPIPE_TS_SYNC_SIGNATURE, vector);
+}
+
+/** @This returns whether the packet size is detected.
+ *
+ * @param upipe description structure of the pipe
+ * @param autodetect_p filled in with 1 if the packet size is detected
+ * @return an error code
+ */
+static inline int upipe_ts_sync_get_autodetect(struct upipe *upipe,
+                                               int *autodetect_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_GET_AUTODETECT,
+                         UPIPE_TS_SYNC_SIGNATURE, autodetect_p);
+}
+
+/** @This sets whether the packet size is detected among 188 octets,
+ * 192 octets (M2TS) and 204 octets (TS packets followed by Reed-Solomon
+ * parity). The output is then made of standard 188-octet TS packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param autodetect 1 to detect the packet size
+ * @return an error code
+ */
+static inline int upipe_ts_sync_set_autodetect(struct upipe *upipe,
+                                               int autodetect)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_SET_AUTODETECT,
+                         UPIPE_TS_SYNC_SIGNATURE, autodetect);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,45 @@ extern "C" {
  */
 struct upipe_mgr *upipe_v210enc_mgr_alloc(void);
 
+/** @This extends upipe_command with specific commands for v210enc pipes. */
+enum upipe_v210enc_command {
+    UPIPE_V210ENC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** gets the number of packing threads (unsigned int *) */
+    UPIPE_V210ENC_GET_THREADS,
+    /** sets the number of packing threads (unsigned int) */
+    UPIPE_V210ENC_SET_THREADS
+};
+
+/** @This gets the number of threads packing the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static inline int upipe_v210enc_get_threads(struct upipe *upipe,
+                                            unsigned int *threads_p)
+{
+    return upipe_control(upipe, UPIPE_V210ENC_GET_THREADS,
+                         UPIPE_V210ENC_SIGNATURE, threads_p);
+}
+
+/** @This sets the number of threads packing the pictures. The lines of the
+ * picture are split into as many slices, one of which is packed by the thread
+ * calling @ref upipe_input while the others are handed to worker threads.
+ * The default is 1, which packs the whole picture on the calling thread.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static inline int upipe_v210enc_set_threads(struct upipe *upipe,
+                                            unsigned int threads)
+{
+    return upipe_control(upipe, UPIPE_V210ENC_SET_THREADS,
+                         UPIPE_V210ENC_SIGNATURE, threads);
+}
+
 #ifdef __cplusplus
 }
 #endif
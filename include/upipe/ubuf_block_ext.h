@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with external storage
+ *
+ * This manager wraps memory owned by someone else, typically the slots of
+ * a capture ring, into block ubufs. The owner passes a @ref urefcount along
+ * with the buffer; it is used by every ubuf pointing to the buffer (including
+ * duplicates and splices), and released when the last of them is freed, so
+ * that its callback may recycle the memory.
+ *
+ * Regular block allocations (@ref ubuf_block_alloc), which are performed on
+ * ubuf->mgr by the block helpers, are forwarded to an optional ubuf manager.
+ */
+
+#ifndef _UPIPE_UBUF_BLOCK_EXT_H_
+/** @hidden */
+#define _UPIPE_UBUF_BLOCK_EXT_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+
+#include <stdint.h>
+
+/** @This is the signature to use to wrap external memory. */
+#define UBUF_BLOCK_EXT_ALLOC UBASE_FOURCC('e','x','t','b')
+
+/** @This returns a new ubuf pointing to external memory.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param buffer pointer to the external memory
+ * @param size size of the buffer
+ * @param refcount reference to use while the memory is pointed to, released
+ * when the last ubuf is freed (may be NULL if the memory outlives the ubufs)
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_ext_alloc(struct ubuf_mgr *mgr,
+                                                uint8_t *buffer, int size,
+                                                struct urefcount *refcount)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_EXT_ALLOC, buffer, size, refcount);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using external storage.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param ubuf_mgr ubuf manager for regular block allocations (may be NULL)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_ext_mgr_alloc(uint16_t ubuf_pool_depth,
+                                          struct ubuf_mgr *ubuf_mgr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
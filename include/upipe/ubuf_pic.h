@@ -370,114 +370,19 @@ static inline int ubuf_pic_resize(struct ubuf *ubuf, int hskip, int vskip,
  * @param alpha alpha multiplier
  * @param threshold alpha blending method
  *    0 means ignore alpha
- *    255 means blends src and dest together using alpha levels (slow)
+ *    255 means blends src and dest together using alpha levels
  *    Any value in between means using the src pixels if and only if
  *      their alpha value is more than this value
+ * Planes of 9 to 12-bit little-endian samples are blended per sample, other
+ * planes per octet.
  * @return an error code
  */
-static inline int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
-                                int dest_hoffset, int dest_voffset,
-                                int src_hoffset, int src_voffset,
-                                int extract_hsize, int extract_vsize,
-                                const uint8_t *alpha_plane, int alpha_stride,
-                                const uint8_t alpha, const uint8_t threshold)
-{
-    if (alpha_plane == NULL && alpha < threshold && threshold != 0xff)
-        return UBASE_ERR_NONE; /* nothing to do */
-
-    uint8_t src_macropixel;
-    UBASE_RETURN(ubuf_pic_size(src, NULL, NULL, &src_macropixel))
-    uint8_t dest_macropixel;
-    UBASE_RETURN(ubuf_pic_size(dest, NULL, NULL, &dest_macropixel))
-    if (unlikely(dest_macropixel != src_macropixel))
-        return UBASE_ERR_INVALID;
-
-    const char *chroma;
-    ubuf_pic_foreach_plane(dest, chroma) {
-        size_t src_stride;
-        uint8_t src_hsub, src_vsub, src_macropixel_size;
-        UBASE_RETURN(ubuf_pic_plane_size(src, chroma, &src_stride,
-                    &src_hsub, &src_vsub, &src_macropixel_size))
-
-        size_t dest_stride;
-        uint8_t dest_hsub, dest_vsub, dest_macropixel_size;
-        UBASE_RETURN(ubuf_pic_plane_size(dest, chroma,
-                     &dest_stride, &dest_hsub, &dest_vsub,
-                     &dest_macropixel_size))
-
-        if (unlikely(src_hsub != dest_hsub || src_vsub != dest_vsub ||
-                     src_macropixel_size != dest_macropixel_size))
-            return UBASE_ERR_INVALID;
-
-        uint8_t *dest_buffer;
-        const uint8_t *src_buffer;
-        UBASE_RETURN(ubuf_pic_plane_write(dest, chroma,
-                    dest_hoffset, dest_voffset,
-                    extract_hsize, extract_vsize, &dest_buffer))
-        int err = ubuf_pic_plane_read(src, chroma, src_hoffset, src_voffset,
-                                      extract_hsize, extract_vsize,
-                                      &src_buffer);
-        if (unlikely(!ubase_check(err))) {
-            ubuf_pic_plane_unmap(dest, chroma,
-                                 dest_hoffset, dest_voffset,
-                                 extract_hsize, extract_vsize);
-            return err;
-        }
-
-        int plane_hsize = extract_hsize / src_hsub / src_macropixel *
-                          src_macropixel_size;
-        int plane_vsize = extract_vsize / src_vsub;
-
-        for (int i = 0; i < plane_vsize; i++) {
-            if ((!alpha_plane && alpha == 0xff) || threshold == 0) {
-                memcpy(dest_buffer, src_buffer, plane_hsize);
-            } else if (!alpha_plane) {
-                for (int j = 0; j < plane_hsize; j++) {
-                    dest_buffer[j] = (dest_buffer[j] * (0xff - alpha) + src_buffer[j] * alpha) / 0xff;
-                }
-            } else if (threshold != 0xff) {
-                /* This is an on/off blending
-                 * if alpha is over the threshold, we use the subpicture pixel.
-                 */
-                if (alpha == 0xff) {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub];
-                        if (a > threshold) dest_buffer[j] = src_buffer[j];
-                    }
-                } else {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = (uint16_t)alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub] * (uint16_t)alpha / 0xff;
-                        if (a > threshold) dest_buffer[j] = src_buffer[j];
-                    }
-                }
-            } else {
-                /* smooth and slow blending */
-                if (alpha == 0xff) {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub];
-                        dest_buffer[j] = (dest_buffer[j] * (0xff - a) + src_buffer[j] * a) / 0xff;
-                    }
-                } else {
-                    for (int j = 0; j < plane_hsize; j++) {
-                        const uint8_t a = (uint16_t)alpha_plane[alpha_stride * (i * src_vsub) + j * src_hsub] * (uint16_t)alpha / 0xff;
-                        dest_buffer[j] = (dest_buffer[j] * (0xff - a) + src_buffer[j] * a) / 0xff;
-                    }
-                }
-            }
-            dest_buffer += dest_stride;
-            src_buffer += src_stride;
-        }
-
-        err = ubuf_pic_plane_unmap(dest, chroma,
-                                   dest_hoffset, dest_voffset,
-                                   extract_hsize, extract_vsize);
-        UBASE_RETURN(ubuf_pic_plane_unmap(src, chroma,
-                                          src_hoffset, src_voffset,
-                                          extract_hsize, extract_vsize))
-        UBASE_RETURN(err)
-    }
-    return UBASE_ERR_NONE;
-}
+int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
+                        int dest_hoffset, int dest_voffset,
+                        int src_hoffset, int src_voffset,
+                        int extract_hsize, int extract_vsize,
+                        const uint8_t *alpha_plane, int alpha_stride,
+                        const uint8_t alpha, const uint8_t threshold);
 
 /** @This blits a picture ubuf to another ubuf.
  *
@@ -505,7 +410,9 @@ static inline int ubuf_pic_blit(struct ubuf *dest, struct ubuf *src,
     size_t alpha_stride = 0;
     int ret;
 
-    if (!ubase_check(ubuf_pic_plane_read(src, "a8", 0, 0, -1, -1, &alpha_plane))) {
+    if (!ubase_check(ubuf_pic_plane_read(src, "a8", src_hoffset, src_voffset,
+                                         extract_hsize, extract_vsize,
+                                         &alpha_plane))) {
         alpha_plane = NULL;
     } else if (unlikely(!ubase_check(ubuf_pic_plane_size(src, "a8", &alpha_stride,
                             NULL, NULL, NULL)))) {
@@ -520,7 +427,8 @@ static inline int ubuf_pic_blit(struct ubuf *dest, struct ubuf *src,
 
 end:
     if (alpha_plane)
-        ubuf_pic_plane_unmap(src, "a8", 0, 0, -1, -1);
+        ubuf_pic_plane_unmap(src, "a8", src_hoffset, src_voffset,
+                             extract_hsize, extract_vsize);
 
     return ret;
 }
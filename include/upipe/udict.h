@@ -268,7 +268,9 @@ static inline int udict_control(struct udict *udict, int command, ...)
     return err;
 }
 
-/** @This duplicates a given udict.
+/** @This duplicates a given udict. Depending on the manager, the attributes
+ * may be shared until one of the udicts is modified, so pointers returned
+ * by get functions are only valid until the next modification.
  *
  * @param udict pointer to udict
  * @return duplicated udict
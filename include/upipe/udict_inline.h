@@ -39,8 +39,22 @@ extern "C" {
 
 #include <upipe/udict.h>
 
+#include <stdbool.h>
+
+/** @This is the signature of the inline udict manager. */
+#define UDICT_INLINE_SIGNATURE UBASE_FOURCC('i','n','l','n')
+
 struct umem_mgr;
 
+/** @This extends udict_mgr_command with specific commands for the inline
+ * manager. */
+enum udict_inline_mgr_command {
+    UDICT_INLINE_MGR_SENTINEL = UDICT_MGR_CONTROL_LOCAL,
+
+    /** enables or disables the attribute index of new udicts (int) */
+    UDICT_INLINE_MGR_SET_INDEX
+};
+
 /** @This allocates a new instance of the inline udict manager.
  *
  * @param udict_pool_depth maximum number of udict structures in the pool
@@ -55,6 +69,22 @@ struct udict_mgr *udict_inline_mgr_alloc(uint16_t udict_pool_depth,
                                          struct umem_mgr *umem_mgr,
                                          int min_size, int extra_size);
 
+/** @This enables or disables the hash index of attributes on udicts
+ * allocated afterwards. The index is enabled by default; without it,
+ * lookups walk all attributes. Already allocated udicts keep their index
+ * until one of their attributes is deleted.
+ *
+ * @param mgr pointer to udict manager
+ * @param index true to enable the index
+ * @return an error code
+ */
+static inline int udict_inline_mgr_set_index(struct udict_mgr *mgr,
+                                             bool index)
+{
+    return udict_mgr_control(mgr, UDICT_INLINE_MGR_SET_INDEX,
+                             UDICT_INLINE_SIGNATURE, index ? 1 : 0);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,6 +39,21 @@ extern "C" {
 
 #include <upipe/umem.h>
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @This holds the statistics of a pool of a umem pool manager. */
+struct umem_pool_stats {
+    /** allocations served from the cache of the thread */
+    uint64_t hits;
+    /** allocations served by taking a magazine from the global depot */
+    uint64_t depot_hits;
+    /** allocations that reverted to malloc() */
+    uint64_t misses;
+    /** buffers handed back to free() because the pool was full */
+    uint64_t releases;
+};
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's.
  *
@@ -49,6 +64,10 @@ extern "C" {
  * to keep in the pool (unsigned int); larger buffers will be directly managed
  * with malloc() and free()
  * @return pointer to manager, or NULL in case of error
+ *
+ * Buffers are cached in per-thread magazines, which are exchanged as a whole
+ * with a global depot; caches and depot together never hold more buffers than
+ * the depth of the pool.
  */
 struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...);
 
@@ -62,6 +81,18 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...);
  */
 struct umem_mgr *umem_pool_mgr_alloc_simple(uint16_t base_pools_depth);
 
+/** @This returns the statistics of a pool, summed over all threads.
+ *
+ * @param mgr pointer to a umem pool manager
+ * @param pool index of the pool
+ * @param size_p filled in with the size of the buffers of the pool (may be
+ * NULL)
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+int umem_pool_mgr_get_stats(struct umem_mgr *mgr, unsigned int pool,
+                            size_t *size_p, struct umem_pool_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
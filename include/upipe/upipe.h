@@ -39,6 +39,7 @@ extern "C" {
 #include <upipe/uprobe.h>
 #include <upipe/urequest.h>
 #include <upipe/udict_dump.h>
+#include <upipe/upipe_stats.h>
 
 #include <stdint.h>
 #include <stdarg.h>
@@ -179,6 +180,8 @@ struct upipe {
     struct uprobe *uprobe;
     /** pointer to the manager for this pipe type */
     struct upipe_mgr *mgr;
+    /** statistics, or NULL if they are disabled */
+    struct upipe_stats *stats;
 };
 
 UBASE_FROM_TO(upipe, uchain, uchain, uchain)
@@ -454,6 +457,7 @@ static inline void upipe_init(struct upipe *upipe, struct upipe_mgr *mgr,
     upipe->uprobe = uprobe;
     upipe->refcount = NULL;
     upipe->mgr = mgr;
+    upipe->stats = NULL;
     upipe_mgr_use(mgr);
 }
 
@@ -560,6 +564,8 @@ static inline struct uprobe *upipe_pop_probe(struct upipe *upipe)
 static inline void upipe_clean(struct upipe *upipe)
 {
     assert(upipe != NULL);
+    if (unlikely(upipe->stats != NULL))
+        upipe_stats_disable(upipe);
     uprobe_release(upipe->uprobe);
     upipe_mgr_release(upipe->mgr);
 }
@@ -1081,7 +1087,10 @@ static inline void upipe_input(struct upipe *upipe, struct uref *uref,
         return;
     }
     upipe_use(upipe);
-    upipe->mgr->upipe_input(upipe, uref, upump_p);
+    if (unlikely(upipe->stats != NULL))
+        upipe_stats_input(upipe, uref, upump_p);
+    else
+        upipe->mgr->upipe_input(upipe, uref, upump_p);
     upipe_release(upipe);
 }
 
@@ -121,6 +121,36 @@ static inline int upipe_dump_open(upipe_dump_pipe_label pipe_label,
     return err;
 }
 
+/** @This dumps the pipes of a pipeline and their statistics in JSON format.
+ * Each pipe is printed with a numeric ID, its label, its signature, the ID
+ * of its output and its statistics (see @ref upipe_stats_enable), or null if
+ * they are disabled. Durations and dates are in units of the freq member.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format
+ * @param args list of sources pipes terminated with NULL
+ */
+void upipe_dump_json_va(upipe_dump_pipe_label pipe_label,
+                        FILE *file, struct uchain *ulist, va_list args);
+
+/** @This dumps the pipes of a pipeline and their statistics in JSON format
+ * with a variable list of arguments.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format, followed by a list of
+ * source pipes terminated by NULL
+ */
+static inline void upipe_dump_json(upipe_dump_pipe_label pipe_label,
+                                   FILE *file, struct uchain *ulist, ...)
+{
+    va_list args;
+    va_start(args, ulist);
+    upipe_dump_json_va(pipe_label, file, ulist, args);
+    va_end(args);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe optional per-pipe statistics
+ */
+
+#ifndef _UPIPE_UPIPE_STATS_H_
+/** @hidden */
+#define _UPIPE_UPIPE_STATS_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** @hidden */
+struct upipe;
+/** @hidden */
+struct uref;
+/** @hidden */
+struct upump;
+/** @hidden */
+struct uclock;
+
+/** @This stores the statistics of a pipe. Durations and dates are in units
+ * of the clock passed to @ref upipe_stats_enable. */
+struct upipe_stats {
+    /** clock used for durations and latency */
+    struct uclock *uclock;
+
+    /** number of urefs received by upipe_input */
+    uint64_t urefs_in;
+    /** number of octets of block urefs received by upipe_input */
+    uint64_t bytes_in;
+    /** number of urefs sent to the output (with upipe_helper_output) */
+    uint64_t urefs_out;
+    /** number of octets of block urefs sent to the output */
+    uint64_t bytes_out;
+
+    /** cumulative time spent in the input function, excluding the time
+     * spent in the input of downstream pipes */
+    uint64_t input_time;
+    /** cumulative time spent in the input function, including downstream
+     * pipes */
+    uint64_t input_time_total;
+
+    /** number of urefs received with a cr_sys date */
+    uint64_t latency_count;
+    /** sum of the differences between the input date and cr_sys */
+    uint64_t latency_total;
+    /** maximum difference between the input date and cr_sys */
+    uint64_t latency_max;
+};
+
+/** @This enables statistics on a pipe, or resets them if they are already
+ * enabled.
+ *
+ * @param upipe description structure of the pipe
+ * @param uclock clock used for durations, must be the clock of cr_sys dates
+ * for latency to be meaningful
+ * @return an error code
+ */
+int upipe_stats_enable(struct upipe *upipe, struct uclock *uclock);
+
+/** @This disables statistics on a pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+void upipe_stats_disable(struct upipe *upipe);
+
+/** @internal @This is called by upipe_input when statistics are enabled,
+ * and calls the input function of the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+void upipe_stats_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p);
+
+/** @internal @This is called by upipe_helper_output when statistics are
+ * enabled, before a uref is sent to the output.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ */
+void upipe_stats_output(struct upipe *upipe, struct uref *uref);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -92,6 +92,10 @@ enum upump_command {
     UPUMP_FREE_BLOCKER,
     /** restarts the pump (void) */
     UPUMP_RESTART,
+    /** gets the pump statistics (struct upump_stats *) */
+    UPUMP_GET_STATS,
+    /** gets whether the pump is blocked (int *) */
+    UPUMP_GET_BLOCKED,
 
     /** non-standard commands implemented by a upump handler can start
      * from there (first arg = signature) */
@@ -101,6 +105,38 @@ enum upump_command {
 /** function called when a pump is triggered */
 typedef void (*upump_cb)(struct upump *);
 
+/** number of buckets of the event loop histograms; bucket 0 counts
+ * durations below 1 us, bucket i durations between 2^(i-1) and 2^i us, and
+ * the last bucket all longer durations */
+#define UPUMP_HISTO_BUCKETS 24
+
+/** @This stores the statistics of a pump, collected when they are enabled
+ * on the manager. Durations are in ticks of a 27 MHz clock. */
+struct upump_stats {
+    /** number of callbacks */
+    uint64_t calls;
+    /** cumulative duration of the callbacks */
+    uint64_t total;
+    /** maximum duration of a callback */
+    uint64_t max;
+    /** maximum lateness of a timer */
+    uint64_t late_max;
+};
+
+/** @This stores the statistics of an event loop, collected when they are
+ * enabled on the manager. */
+struct upump_mgr_stats {
+    /** number of loop iterations */
+    uint64_t iterations;
+    /** histogram of callback durations */
+    uint64_t callbacks[UPUMP_HISTO_BUCKETS];
+    /** histogram of timer lateness */
+    uint64_t timer_lateness[UPUMP_HISTO_BUCKETS];
+    /** histogram of the time spent dispatching in a loop iteration, during
+     * which no new event is serviced */
+    uint64_t loop_lag[UPUMP_HISTO_BUCKETS];
+};
+
 /** @This stores a pump of a given event loop.
  *
  * The structure is not refcounted and shouldn't be used by more than one
@@ -133,6 +169,12 @@ enum upump_mgr_command {
     UPUMP_MGR_RUN,
     /** release all buffers kept in pools (void) */
     UPUMP_MGR_VACUUM,
+    /** enables or disables statistics (int) */
+    UPUMP_MGR_SET_STATS,
+    /** gets the event loop statistics (struct upump_mgr_stats *) */
+    UPUMP_MGR_GET_STATS,
+    /** iterates over the allocated pumps (struct upump **) */
+    UPUMP_MGR_ITERATE,
 
     /** non-standard manager commands implemented by a upump handler can start
      * from there (first arg = signature) */
@@ -396,6 +438,34 @@ static inline void upump_set_status(struct upump *upump, bool status)
     upump_control(upump, UPUMP_SET_STATUS, i);
 }
 
+/** @This gets the statistics of a pump. They are only collected when
+ * enabled with @ref upump_mgr_set_stats.
+ *
+ * @param upump description structure of the pump
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int upump_get_stats(struct upump *upump,
+                                  struct upump_stats *stats)
+{
+    return upump_control(upump, UPUMP_GET_STATS, stats);
+}
+
+/** @This gets whether a pump is currently blocked by at least one blocker,
+ * typically because a downstream pipe doesn't accept more buffers.
+ *
+ * @param upump description structure of the pump
+ * @param blocked_p filled in with true if the pump is blocked
+ * @return an error code
+ */
+static inline int upump_get_blocked(struct upump *upump, bool *blocked_p)
+{
+    int blocked = 0;
+    int err = upump_control(upump, UPUMP_GET_BLOCKED, &blocked);
+    *blocked_p = blocked;
+    return err;
+}
+
 /** @This gets the opaque structure with a cast.
  *
  * @param upump description structure of the pump
@@ -518,6 +588,43 @@ static inline int upump_mgr_vacuum(struct upump_mgr *mgr)
     return upump_mgr_control(mgr, UPUMP_MGR_VACUUM);
 }
 
+/** @This enables or disables the collection of statistics on the pumps of
+ * an event loop. Enabling resets the statistics.
+ *
+ * @param mgr pointer to upump manager
+ * @param enabled true to enable statistics
+ * @return an error code
+ */
+static inline int upump_mgr_set_stats(struct upump_mgr *mgr, bool enabled)
+{
+    return upump_mgr_control(mgr, UPUMP_MGR_SET_STATS, enabled ? 1 : 0);
+}
+
+/** @This gets the statistics of an event loop.
+ *
+ * @param mgr pointer to upump manager
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int upump_mgr_get_stats(struct upump_mgr *mgr,
+                                      struct upump_mgr_stats *stats)
+{
+    return upump_mgr_control(mgr, UPUMP_MGR_GET_STATS, stats);
+}
+
+/** @This iterates over the pumps allocated on a manager.
+ *
+ * @param mgr pointer to upump manager
+ * @param upump_p reference to a pump, initialized with NULL, and set to NULL
+ * at the end
+ * @return an error code
+ */
+static inline int upump_mgr_iterate(struct upump_mgr *mgr,
+                                    struct upump **upump_p)
+{
+    return upump_mgr_control(mgr, UPUMP_MGR_ITERATE, upump_p);
+}
+
 #ifdef __cplusplus
 }
 #endif
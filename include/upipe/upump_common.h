@@ -44,6 +44,8 @@ extern "C" {
 
 /** @hidden */
 struct upump_blocker;
+/** @hidden */
+struct uclock;
 
 /** @This stores upump parameters invisible from modules but usually common.
  */
@@ -54,12 +56,17 @@ struct upump_common {
     bool status;
     /** list of blockers registered on this pump */
     struct uchain blockers;
+    /** structure for the list of pumps of the manager */
+    struct uchain uchain;
+    /** statistics */
+    struct upump_stats stats;
 
     /** public upump structure */
     struct upump upump;
 };
 
 UBASE_FROM_TO(upump_common, upump, upump, upump)
+UBASE_FROM_TO(upump_common, uchain, uchain, uchain)
 
 /** @This allocates and initializes a blocker.
  *
@@ -86,6 +93,14 @@ void upump_common_init(struct upump *upump);
  */
 void upump_common_dispatch(struct upump *upump);
 
+/** @This dispatches a timer pump, accounting for its lateness.
+ *
+ * @param upump description structure of the pump
+ * @param deadline date at which the timer was due, as returned by
+ * @ref upump_common_mgr_now, or UINT64_MAX if unknown
+ */
+void upump_common_dispatch_timer(struct upump *upump, uint64_t deadline);
+
 /** @This starts a pump if allowed.
  *
  * @param upump description structure of the pump
@@ -124,6 +139,20 @@ void upump_common_set_status(struct upump *upump, int status);
  */
 void upump_common_clean(struct upump *upump);
 
+/** @This gets the statistics of a pump.
+ *
+ * @param upump description structure of the pump
+ * @param stats filled in with the statistics
+ */
+void upump_common_get_stats(struct upump *upump, struct upump_stats *stats);
+
+/** @This gets whether a pump is blocked by at least one blocker.
+ *
+ * @param upump description structure of the pump
+ * @param blocked_p filled in with 1 if the pump is blocked, 0 otherwise
+ */
+void upump_common_get_blocked(struct upump *upump, int *blocked_p);
+
 /** @This stores management parameters invisible from modules but usually
  * common.
  */
@@ -140,6 +169,17 @@ struct upump_common_mgr {
     /** function to really stop a watcher */
     void (*upump_real_stop)(struct upump *, bool);
 
+    /** list of allocated pumps */
+    struct uchain upumps;
+    /** clock used for statistics, or NULL if they are disabled */
+    struct uclock *uclock;
+    /** event loop statistics */
+    struct upump_mgr_stats stats;
+    /** date at which the current loop iteration woke up, or UINT64_MAX */
+    uint64_t wake;
+    /** pump being dispatched, or NULL if it was freed */
+    struct upump *dispatching;
+
     /** structure exported to modules */
     struct upump_mgr mgr;
 };
@@ -156,6 +196,56 @@ UBASE_FROM_TO(upump_common_mgr, upool, upump_blocker_pool, upump_blocker_pool)
  */
 void upump_common_mgr_vacuum(struct upump_mgr *mgr);
 
+/** @This returns the current date of the statistics clock.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @return current date, or UINT64_MAX if statistics are disabled
+ */
+uint64_t upump_common_mgr_now(struct upump_mgr *mgr);
+
+/** @This is called by the event loop when it wakes up, before dispatching
+ * events.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ */
+void upump_common_mgr_wake(struct upump_mgr *mgr);
+
+/** @This is called by the event loop before it goes to sleep.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ */
+void upump_common_mgr_sleep(struct upump_mgr *mgr);
+
+/** @This enables or disables statistics.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param enabled true to enable statistics
+ * @return an error code
+ */
+int upump_common_mgr_set_stats(struct upump_mgr *mgr, bool enabled);
+
+/** @This gets the event loop statistics.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param stats filled in with the statistics
+ */
+void upump_common_mgr_get_stats(struct upump_mgr *mgr,
+                                struct upump_mgr_stats *stats);
+
+/** @This iterates over the allocated pumps.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param upump_p reference to a pump, initialized with NULL, and set to NULL
+ * at the end
+ */
+void upump_common_mgr_iterate(struct upump_mgr *mgr, struct upump **upump_p);
+
 /** @This returns the extra buffer space needed for pools.
  *
  * @param upump_pool_depth maximum number of upump structures in the pool
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe event loop statistics dumping
+ */
+
+#ifndef _UPIPE_UPUMP_DUMP_H_
+/** @hidden */
+#define _UPIPE_UPUMP_DUMP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/uclock.h>
+#include <upipe/upump.h>
+#include <upipe/uprobe.h>
+
+#include <stdint.h>
+#include <inttypes.h>
+
+/** @internal @This dumps the non-empty buckets of a histogram.
+ *
+ * @param uprobe pipe module printing the messages
+ * @param name name of the histogram
+ * @param histo histogram
+ */
+static inline void upump_dump_histo(struct uprobe *uprobe, const char *name,
+                                    const uint64_t *histo)
+{
+    uprobe_notice_va(uprobe, NULL, " - %s:", name);
+    for (unsigned int i = 0; i < UPUMP_HISTO_BUCKETS; i++) {
+        if (!histo[i])
+            continue;
+        if (!i)
+            uprobe_notice_va(uprobe, NULL, "     < 1 us: %" PRIu64, histo[i]);
+        else if (i == UPUMP_HISTO_BUCKETS - 1)
+            uprobe_notice_va(uprobe, NULL, "     >= %" PRIu64 " us: %" PRIu64,
+                             UINT64_C(1) << (i - 1), histo[i]);
+        else
+            uprobe_notice_va(uprobe, NULL,
+                             "     %" PRIu64 "-%" PRIu64 " us: %" PRIu64,
+                             UINT64_C(1) << (i - 1), UINT64_C(1) << i,
+                             histo[i]);
+    }
+}
+
+/** @This dumps the statistics of an event loop and of its pumps. They must
+ * have been enabled with @ref upump_mgr_set_stats.
+ *
+ * @param mgr pointer to upump manager
+ * @param uprobe pipe module printing the messages
+ * @return an error code
+ */
+static inline int upump_mgr_dump(struct upump_mgr *mgr, struct uprobe *uprobe)
+{
+    struct upump_mgr_stats mgr_stats;
+    UBASE_RETURN(upump_mgr_get_stats(mgr, &mgr_stats))
+
+    uprobe_notice_va(uprobe, NULL,
+                     "dumping upump manager %p (%" PRIu64 " iterations)",
+                     mgr, mgr_stats.iterations);
+    upump_dump_histo(uprobe, "callback duration", mgr_stats.callbacks);
+    upump_dump_histo(uprobe, "timer lateness", mgr_stats.timer_lateness);
+    upump_dump_histo(uprobe, "loop lag", mgr_stats.loop_lag);
+
+    struct upump *upump = NULL;
+    while (ubase_check(upump_mgr_iterate(mgr, &upump)) && upump != NULL) {
+        struct upump_stats stats;
+        if (!ubase_check(upump_get_stats(upump, &stats)) || !stats.calls)
+            continue;
+        uprobe_notice_va(uprobe, NULL,
+                " - pump %p (cb %p, opaque %p): %" PRIu64 " calls, "
+                "avg %" PRIu64 " us, max %" PRIu64 " us, "
+                "late max %" PRIu64 " us",
+                upump, (void *)(uintptr_t)upump->cb, upump->opaque,
+                stats.calls,
+                stats.total / stats.calls * 1000000 / UCLOCK_FREQ,
+                stats.max * 1000000 / UCLOCK_FREQ,
+                stats.late_max * 1000000 / UCLOCK_FREQ);
+    }
+    return UBASE_ERR_NONE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
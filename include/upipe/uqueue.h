@@ -37,21 +37,44 @@ extern "C" {
 #include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/uatomic.h>
-#include <upipe/ufifo.h>
 #include <upipe/ueventfd.h>
 #include <upipe/upump.h>
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <assert.h>
 
-/** @This is the implementation of a queue. */
+/** @This is the maximum number of elements in a queue. */
+#define UQUEUE_MAX_LENGTH (UINT32_C(1) << 24)
+
+/** @internal @This is an element of the ring of a queue. */
+struct uqueue_elem {
+    /** sequence number telling whether the element may be pushed or popped */
+    uatomic_uint32_t seq;
+    /** pointer to opaque */
+    void *opaque;
+};
+
+/** @This is the implementation of a queue. It is a bounded ring of elements
+ * (D. Vyukov's algorithm), where each element carries a sequence number
+ * telling which producer or consumer may use it next. Producers and
+ * consumers claim runs of consecutive elements with a single atomic
+ * operation, so pushing and popping in batches is cheaper. */
 struct uqueue {
-    /** FIFO */
-    struct ufifo fifo;
-    /** number of elements in the queue */
-    uatomic_uint32_t counter;
+    /** position of the next element to push */
+    uatomic_uint32_t push_pos;
     /** maximum number of elements in the queue */
     uint32_t length;
+    /** number of elements in the ring (length + 1) */
+    uint32_t size;
+    /** positions wrap around at this multiple of size */
+    uint32_t wrap;
+    /** array of elements */
+    struct uqueue_elem *elems;
+    /** position of the next element to pop */
+    uatomic_uint32_t pop_pos;
+    /** number of elements in the queue */
+    uatomic_uint32_t counter;
     /** ueventfd triggered when data can be pushed */
     struct ueventfd event_push;
     /** ueventfd triggered when data can be popped */
@@ -63,19 +86,22 @@ struct uqueue {
  * @param length maximum number of elements in the queue
  * @return size in octets to allocate
  */
-#define uqueue_sizeof(length) ufifo_sizeof(length)
+#define uqueue_sizeof(length) (((length) + 1) * sizeof(struct uqueue_elem))
 
 /** @This initializes a uqueue.
  *
  * @param uqueue pointer to a uqueue structure
- * @param length maximum number of elements in the queue
+ * @param length maximum number of elements in the queue (max
+ * @ref UQUEUE_MAX_LENGTH)
  * @param extra mandatory extra space allocated by the caller, with the size
- * returned by @ref #ufifo_sizeof
+ * returned by @ref #uqueue_sizeof
  * @return false in case of failure
  */
-static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
+static inline bool uqueue_init(struct uqueue *uqueue, unsigned int length,
                                void *extra)
 {
+    if (unlikely(!length || length > UQUEUE_MAX_LENGTH))
+        return false;
     if (unlikely(!ueventfd_init(&uqueue->event_push, true)))
         return false;
     if (unlikely(!ueventfd_init(&uqueue->event_pop, false))) {
@@ -83,12 +109,168 @@ static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
         return false;
     }
 
-    ufifo_init(&uqueue->fifo, length, extra);
-    uatomic_init(&uqueue->counter, 0);
+    /* the ring has a spare element, as the algorithm needs at least two */
     uqueue->length = length;
+    uqueue->size = length + 1;
+    uqueue->wrap = (UINT32_C(1) << 31) / uqueue->size * uqueue->size;
+    uqueue->elems = (struct uqueue_elem *)extra;
+    for (unsigned int i = 0; i < uqueue->size; i++) {
+        uatomic_init(&uqueue->elems[i].seq, i);
+        uqueue->elems[i].opaque = NULL;
+    }
+    uatomic_init(&uqueue->push_pos, 0);
+    uatomic_init(&uqueue->pop_pos, 0);
+    uatomic_init(&uqueue->counter, 0);
     return true;
 }
 
+/** @internal @This advances a position in the ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param pos position in the ring
+ * @param n number of elements to advance (at most size)
+ * @return new position
+ */
+static inline uint32_t uqueue_pos_add(struct uqueue *uqueue, uint32_t pos,
+                                      uint32_t n)
+{
+    pos += n;
+    if (pos >= uqueue->wrap)
+        pos -= uqueue->wrap;
+    return pos;
+}
+
+/** @internal @This returns the signed distance between two positions in the
+ * ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param a first position
+ * @param b second position
+ * @return a - b
+ */
+static inline int32_t uqueue_pos_diff(struct uqueue *uqueue, uint32_t a,
+                                      uint32_t b)
+{
+    int64_t diff = (int64_t)a - (int64_t)b;
+    if (diff > (int64_t)(uqueue->wrap / 2))
+        diff -= uqueue->wrap;
+    else if (diff < -(int64_t)(uqueue->wrap / 2))
+        diff += uqueue->wrap;
+    return diff;
+}
+
+/** @internal @This claims a run of consecutive elements of the ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param pos_p pointer to the position to claim from
+ * @param offset 0 to claim empty elements, 1 to claim full elements
+ * @param nb maximum number of elements to claim
+ * @param pos_claim_p filled in with the position of the first claimed element
+ * @return number of claimed elements
+ */
+static inline unsigned int uqueue_claim(struct uqueue *uqueue,
+                                        uatomic_uint32_t *pos_p,
+                                        uint32_t offset, unsigned int nb,
+                                        uint32_t *pos_claim_p)
+{
+    if (unlikely(!nb))
+        return 0;
+
+    uint32_t pos = uatomic_load(pos_p);
+    for ( ; ; ) {
+        unsigned int max = nb;
+        if (!offset) {
+            /* do not go over length, the ring has a spare element */
+            int32_t used = uqueue_pos_diff(uqueue, pos,
+                                           uatomic_load(&uqueue->pop_pos));
+            if (used >= (int32_t)uqueue->length)
+                return 0;
+            if (used < 0)
+                /* stale position, the loop below will reload it */
+                used = 0;
+            if (max > uqueue->length - used)
+                max = uqueue->length - used;
+        }
+
+        unsigned int n = 0;
+        uint32_t index = pos % uqueue->size;
+        int32_t diff = 0;
+        while (n < max) {
+            uint32_t seq = uatomic_load(&uqueue->elems[index].seq);
+            diff = uqueue_pos_diff(uqueue, seq,
+                                   uqueue_pos_add(uqueue, pos, n + offset));
+            if (diff)
+                break;
+            n++;
+            if (++index == uqueue->size)
+                index = 0;
+        }
+
+        if (unlikely(!n)) {
+            if (diff < 0)
+                /* the queue is full (or empty) */
+                return 0;
+            /* another thread went past us */
+            pos = uatomic_load(pos_p);
+            continue;
+        }
+
+        if (likely(uatomic_compare_exchange(pos_p, &pos,
+                                            uqueue_pos_add(uqueue, pos, n)))) {
+            *pos_claim_p = pos;
+            return n;
+        }
+    }
+}
+
+/** @internal @This pushes elements into the ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array of pointers to elements to push
+ * @param nb number of elements in the array
+ * @return number of elements pushed
+ */
+static inline unsigned int uqueue_ring_push(struct uqueue *uqueue,
+                                            void **elements, unsigned int nb)
+{
+    uint32_t pos;
+    unsigned int n = uqueue_claim(uqueue, &uqueue->push_pos, 0, nb, &pos);
+    uint32_t index = pos % uqueue->size;
+    for (unsigned int i = 0; i < n; i++) {
+        assert(elements[i] != NULL);
+        uqueue->elems[index].opaque = elements[i];
+        uatomic_store(&uqueue->elems[index].seq,
+                      uqueue_pos_add(uqueue, pos, i + 1));
+        if (++index == uqueue->size)
+            index = 0;
+    }
+    return n;
+}
+
+/** @internal @This pops elements from the ring.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array filled in with pointers to popped elements
+ * @param nb size of the array
+ * @return number of elements popped
+ */
+static inline unsigned int uqueue_ring_pop(struct uqueue *uqueue,
+                                           void **elements, unsigned int nb)
+{
+    uint32_t pos;
+    unsigned int n = uqueue_claim(uqueue, &uqueue->pop_pos, 1, nb, &pos);
+    uint32_t index = pos % uqueue->size;
+    for (unsigned int i = 0; i < n; i++) {
+        elements[i] = uqueue->elems[index].opaque;
+        uqueue->elems[index].opaque = NULL;
+        uatomic_store(&uqueue->elems[index].seq,
+                      uqueue_pos_add(uqueue, pos, i + uqueue->size));
+        if (++index == uqueue->size)
+            index = 0;
+    }
+    return n;
+}
+
 /** @This allocates a watcher triggering when data is ready to be pushed.
  *
  * @param uqueue pointer to a uqueue structure
@@ -127,54 +309,88 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
                                 refcount);
 }
 
-/** @This pushes an element into the queue.
+/** @This pushes several elements into the queue. The event loop of the
+ * consumer is only woken up once for the whole batch.
  *
  * @param uqueue pointer to a uqueue structure
- * @param element pointer to element to push
- * @return false if the queue is full and the element couldn't be queued
+ * @param elements array of pointers to elements to push
+ * @param nb number of elements in the array
+ * @return number of elements pushed, which may be less than nb if the queue
+ * is full
  */
-static inline bool uqueue_push(struct uqueue *uqueue, void *element)
+static inline unsigned int uqueue_push_batch(struct uqueue *uqueue,
+                                             void **elements, unsigned int nb)
 {
-    if (unlikely(!ufifo_push(&uqueue->fifo, element))) {
+    unsigned int n = uqueue_ring_push(uqueue, elements, nb);
+    if (unlikely(n < nb)) {
         /* signal that we are full */
         ueventfd_read(&uqueue->event_push);
 
         /* double-check */
-        if (likely(!ufifo_push(&uqueue->fifo, element)))
-            return false;
-
-        /* signal that we're alright again */
-        ueventfd_write(&uqueue->event_push);
+        n += uqueue_ring_push(uqueue, elements + n, nb - n);
+        if (likely(n < nb)) {
+            if (!n)
+                return 0;
+        } else
+            /* signal that we're alright again */
+            ueventfd_write(&uqueue->event_push);
     }
 
-    if (unlikely(uatomic_fetch_add(&uqueue->counter, 1) == 0))
+    if (unlikely(uatomic_fetch_add(&uqueue->counter, n) == 0))
         ueventfd_write(&uqueue->event_pop);
-    return true;
+    return n;
 }
 
-/** @internal @This pops an element from the queue.
+/** @This pushes an element into the queue.
  *
  * @param uqueue pointer to a uqueue structure
- * @return pointer to element, or NULL if the LIFO is empty
+ * @param element pointer to element to push
+ * @return false if the queue is full and the element couldn't be queued
  */
-static inline void *uqueue_pop_internal(struct uqueue *uqueue)
+static inline bool uqueue_push(struct uqueue *uqueue, void *element)
 {
-    void *element = ufifo_pop(&uqueue->fifo, void *);
-    if (unlikely(element == NULL)) {
+    return uqueue_push_batch(uqueue, &element, 1) == 1;
+}
+
+/** @This pops several elements from the queue.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array filled in with pointers to popped elements
+ * @param nb size of the array
+ * @return number of elements popped, or 0 if the queue is empty
+ */
+static inline unsigned int uqueue_pop_batch(struct uqueue *uqueue,
+                                            void **elements, unsigned int nb)
+{
+    unsigned int n = uqueue_ring_pop(uqueue, elements, nb);
+    if (unlikely(!n)) {
         /* signal that we starve */
         ueventfd_read(&uqueue->event_pop);
 
         /* double-check */
-        element = ufifo_pop(&uqueue->fifo, void *);
-        if (likely(element == NULL))
-            return NULL;
+        n = uqueue_ring_pop(uqueue, elements, nb);
+        if (likely(!n))
+            return 0;
 
         /* signal that we're alright again */
         ueventfd_write(&uqueue->event_pop);
     }
 
-    if (unlikely(uatomic_fetch_sub(&uqueue->counter, 1) == uqueue->length))
+    if (unlikely(uatomic_fetch_sub(&uqueue->counter, n) == uqueue->length))
         ueventfd_write(&uqueue->event_push);
+    return n;
+}
+
+/** @internal @This pops an element from the queue.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @return pointer to element, or NULL if the queue is empty
+ */
+static inline void *uqueue_pop_internal(struct uqueue *uqueue)
+{
+    void *element;
+    if (!uqueue_pop_batch(uqueue, &element, 1))
+        return NULL;
     return element;
 }
 
@@ -182,7 +398,7 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
  *
  * @param uqueue pointer to a uqueue structure
  * @param type type of the opaque pointer
- * @return pointer to element, or NULL if the LIFO is empty
+ * @return pointer to element, or NULL if the queue is empty
  */
 #define uqueue_pop(uqueue, type) (type)uqueue_pop_internal(uqueue)
 
@@ -202,8 +418,11 @@ static inline unsigned int uqueue_length(struct uqueue *uqueue)
  */
 static inline void uqueue_clean(struct uqueue *uqueue)
 {
+    for (unsigned int i = 0; i < uqueue->size; i++)
+        uatomic_clean(&uqueue->elems[i].seq);
+    uatomic_clean(&uqueue->push_pos);
+    uatomic_clean(&uqueue->pop_pos);
     uatomic_clean(&uqueue->counter);
-    ufifo_clean(&uqueue->fifo);
     ueventfd_clean(&uqueue->event_push);
     ueventfd_clean(&uqueue->event_pop);
 }
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ring of urefs indexed by 16-bit sequence numbers
+ */
+
+#ifndef _UPIPE_USEQRING_H_
+/** @hidden */
+#define _UPIPE_USEQRING_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/uref.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/** @This is the maximum number of urefs in a ring. Sequence numbers more
+ * than half of the 16-bit space apart cannot be ordered. */
+#define USEQRING_MAX_SIZE (UINT32_C(1) << 15)
+
+/** @This is the result of @ref useqring_insert. */
+enum useqring_status {
+    /** uref was stored */
+    USEQRING_INSERTED,
+    /** a uref with the same sequence number is already stored */
+    USEQRING_DUPLICATE,
+    /** sequence number is before the window */
+    USEQRING_LATE,
+    /** sequence number is after the window, entries must be popped first */
+    USEQRING_AHEAD
+};
+
+/** @This is the implementation of a ring of urefs indexed by sequence
+ * numbers. It covers a window of size consecutive sequence numbers starting
+ * at head, where each sequence number has a slot that may hold a uref. A
+ * bitmap of the filled slots allows finding the next stored uref or the next
+ * hole in 64 slots at a time.
+ *
+ * Inserting, looking up and removing a uref are O(1). It is not thread-safe.
+ */
+struct useqring {
+    /** first sequence number of the window */
+    uint16_t head;
+    /** number of slots, power of 2 */
+    uint32_t size;
+    /** number of stored urefs */
+    uint32_t count;
+    /** bitmap of filled slots */
+    uint64_t *bitmap;
+    /** array of slots */
+    struct uref **urefs;
+};
+
+/** @internal @This returns the number of 64-bit words of the bitmap.
+ *
+ * @param size number of slots
+ * @return number of words
+ */
+#define useqring_bitmap_words(size) (((size) + 63) / 64)
+
+/** @This returns the required size of extra data space for useqring.
+ *
+ * @param size number of slots (power of 2, max @ref USEQRING_MAX_SIZE)
+ * @return size in octets to allocate
+ */
+#define useqring_sizeof(size)                                               \
+    (useqring_bitmap_words(size) * sizeof(uint64_t) +                       \
+     (size) * sizeof(struct uref *))
+
+/** @This initializes a useqring.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param size number of slots (power of 2, max @ref USEQRING_MAX_SIZE)
+ * @param extra mandatory extra space allocated by the caller, with the size
+ * returned by @ref #useqring_sizeof
+ * @return false in case of failure
+ */
+static inline bool useqring_init(struct useqring *useqring, uint32_t size,
+                                 void *extra)
+{
+    if (unlikely(!size || size > USEQRING_MAX_SIZE || (size & (size - 1))))
+        return false;
+
+    useqring->head = 0;
+    useqring->size = size;
+    useqring->count = 0;
+    useqring->bitmap = (uint64_t *)extra;
+    useqring->urefs = (struct uref **)
+        (useqring->bitmap + useqring_bitmap_words(size));
+    for (uint32_t i = 0; i < useqring_bitmap_words(size); i++)
+        useqring->bitmap[i] = 0;
+    for (uint32_t i = 0; i < size; i++)
+        useqring->urefs[i] = NULL;
+    return true;
+}
+
+/** @This returns the number of stored urefs.
+ *
+ * @param useqring pointer to a useqring structure
+ * @return number of urefs
+ */
+static inline uint32_t useqring_count(const struct useqring *useqring)
+{
+    return useqring->count;
+}
+
+/** @This returns the first sequence number of the window.
+ *
+ * @param useqring pointer to a useqring structure
+ * @return sequence number
+ */
+static inline uint16_t useqring_head(const struct useqring *useqring)
+{
+    return useqring->head;
+}
+
+/** @This returns the offset of a sequence number from the start of the
+ * window, modulo 2^16.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum sequence number
+ * @return offset
+ */
+static inline uint16_t useqring_offset(const struct useqring *useqring,
+                                       uint16_t seqnum)
+{
+    return seqnum - useqring->head;
+}
+
+/** @internal @This returns the slot of a sequence number.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum sequence number
+ * @return index of the slot
+ */
+static inline uint32_t useqring_slot(const struct useqring *useqring,
+                                     uint16_t seqnum)
+{
+    return seqnum & (useqring->size - 1);
+}
+
+/** @This returns the uref stored for a sequence number.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum sequence number
+ * @return pointer to uref, or NULL if none is stored or seqnum is outside
+ * the window
+ */
+static inline struct uref *useqring_peek(const struct useqring *useqring,
+                                         uint16_t seqnum)
+{
+    if (useqring_offset(useqring, seqnum) >= useqring->size)
+        return NULL;
+    return useqring->urefs[useqring_slot(useqring, seqnum)];
+}
+
+/** @This stores a uref for a sequence number. The uref belongs to the ring
+ * only if @ref USEQRING_INSERTED is returned.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum sequence number
+ * @param uref uref to store
+ * @return status of the insertion
+ */
+static inline enum useqring_status useqring_insert(struct useqring *useqring,
+                                                   uint16_t seqnum,
+                                                   struct uref *uref)
+{
+    uint16_t offset = useqring_offset(useqring, seqnum);
+    if (offset >= useqring->size)
+        return offset >= 0x8000 ? USEQRING_LATE : USEQRING_AHEAD;
+
+    uint32_t slot = useqring_slot(useqring, seqnum);
+    if (useqring->urefs[slot] != NULL)
+        return USEQRING_DUPLICATE;
+
+    useqring->urefs[slot] = uref;
+    useqring->bitmap[slot / 64] |= UINT64_C(1) << (slot % 64);
+    useqring->count++;
+    return USEQRING_INSERTED;
+}
+
+/** @This removes the uref stored for a sequence number.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum sequence number
+ * @return pointer to uref, or NULL if none is stored or seqnum is outside
+ * the window
+ */
+static inline struct uref *useqring_remove(struct useqring *useqring,
+                                           uint16_t seqnum)
+{
+    if (useqring_offset(useqring, seqnum) >= useqring->size)
+        return NULL;
+
+    uint32_t slot = useqring_slot(useqring, seqnum);
+    struct uref *uref = useqring->urefs[slot];
+    if (uref != NULL) {
+        useqring->urefs[slot] = NULL;
+        useqring->bitmap[slot / 64] &= ~(UINT64_C(1) << (slot % 64));
+        useqring->count--;
+    }
+    return uref;
+}
+
+/** @This removes the uref stored for the first sequence number of the
+ * window, and moves the window forward by one.
+ *
+ * @param useqring pointer to a useqring structure
+ * @return pointer to uref, or NULL if none was stored
+ */
+static inline struct uref *useqring_pop(struct useqring *useqring)
+{
+    struct uref *uref = useqring_remove(useqring, useqring->head);
+    useqring->head++;
+    return uref;
+}
+
+/** @internal @This finds the first filled or empty slot in a range of the
+ * window.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param from first sequence number of the range
+ * @param nb number of sequence numbers in the range
+ * @param filled true to look for a filled slot, false for an empty one
+ * @param seqnum_p filled in with the sequence number found
+ * @return false if there is none
+ */
+static inline bool useqring_find(const struct useqring *useqring,
+                                 uint16_t from, uint32_t nb, bool filled,
+                                 uint16_t *seqnum_p)
+{
+    uint32_t i = 0;
+    while (i < nb) {
+        uint32_t slot = useqring_slot(useqring, from + i);
+        uint32_t bit = slot % 64;
+        uint32_t chunk = 64 - bit;
+        if (chunk > useqring->size - slot)
+            chunk = useqring->size - slot;
+        if (chunk > nb - i)
+            chunk = nb - i;
+
+        uint64_t word = useqring->bitmap[slot / 64] >> bit;
+        if (!filled)
+            word = ~word;
+        if (chunk < 64)
+            word &= (UINT64_C(1) << chunk) - 1;
+        if (word) {
+            *seqnum_p = from + i + __builtin_ctzll(word);
+            return true;
+        }
+        i += chunk;
+    }
+    return false;
+}
+
+/** @This finds the first stored uref at or after a sequence number.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param from sequence number to start from, in the window
+ * @param seqnum_p filled in with the sequence number of the uref
+ * @return false if there is none until the end of the window
+ */
+static inline bool useqring_next(const struct useqring *useqring,
+                                 uint16_t from, uint16_t *seqnum_p)
+{
+    uint16_t offset = useqring_offset(useqring, from);
+    if (!useqring->count || offset >= useqring->size)
+        return false;
+    return useqring_find(useqring, from, useqring->size - offset, true,
+                         seqnum_p);
+}
+
+/** @This finds the first hole at or after a sequence number and before
+ * another.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param from sequence number to start from, in the window
+ * @param to sequence number following the range, in the window or just
+ * after it
+ * @param seqnum_p filled in with the sequence number of the hole
+ * @return false if there is no hole in the range
+ */
+static inline bool useqring_next_missing(const struct useqring *useqring,
+                                         uint16_t from, uint16_t to,
+                                         uint16_t *seqnum_p)
+{
+    uint16_t offset = useqring_offset(useqring, from);
+    uint16_t end = useqring_offset(useqring, to);
+    if (offset >= end || end > useqring->size)
+        return false;
+    return useqring_find(useqring, from, end - offset, false, seqnum_p);
+}
+
+/** @internal @This frees the urefs stored in a range of the window.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param from first sequence number of the range
+ * @param nb number of sequence numbers in the range
+ */
+static inline void useqring_free_range(struct useqring *useqring,
+                                       uint16_t from, uint32_t nb)
+{
+    uint16_t seqnum;
+    while (nb && useqring->count &&
+           useqring_find(useqring, from, nb, true, &seqnum)) {
+        uref_free(useqring_remove(useqring, seqnum));
+        nb -= (uint16_t)(seqnum - from) + 1;
+        from = seqnum + 1;
+    }
+}
+
+/** @This moves the start of the window, and frees the urefs that fall
+ * outside of it.
+ *
+ * @param useqring pointer to a useqring structure
+ * @param seqnum new first sequence number of the window
+ */
+static inline void useqring_set_head(struct useqring *useqring,
+                                     uint16_t seqnum)
+{
+    uint16_t forward = seqnum - useqring->head;
+    uint16_t backward = useqring->head - seqnum;
+    if (forward < useqring->size)
+        useqring_free_range(useqring, useqring->head, forward);
+    else if (backward < useqring->size)
+        useqring_free_range(useqring,
+                            useqring->head + useqring->size - backward,
+                            backward);
+    else
+        useqring_free_range(useqring, useqring->head, useqring->size);
+    useqring->head = seqnum;
+}
+
+/** @This frees all urefs stored in the ring.
+ *
+ * @param useqring pointer to a useqring structure
+ */
+static inline void useqring_flush(struct useqring *useqring)
+{
+    useqring_free_range(useqring, useqring->head, useqring->size);
+}
+
+/** @This cleans up a useqring, freeing the stored urefs.
+ *
+ * @param useqring pointer to a useqring structure
+ */
+static inline void useqring_clean(struct useqring *useqring)
+{
+    useqring_flush(useqring);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
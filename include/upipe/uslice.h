@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Authors: Christophe Massiot
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe pool of threads processing jobs split into slices
+ * A job (typically a picture) is split into slices which are handed to the
+ * worker threads of the pool; the thread waiting for the job processes the
+ * slices that no worker has picked yet, so that a pool of n threads only
+ * starts n - 1 worker threads.
+ */
+
+#ifndef _UPIPE_USLICE_H_
+/** @hidden */
+#define _UPIPE_USLICE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/** maximum number of threads of a pool, including the calling thread */
+#define USLICE_MAX_THREADS 64
+
+struct uslice_job;
+
+/** @This processes a slice of a job.
+ *
+ * @param job pointer to the job
+ * @param slice index of the slice, from 0 to nb_slices - 1
+ * @param thread index of the thread, 0 for the thread waiting for the job and
+ * 1 to threads - 1 for the worker threads
+ */
+typedef void (*uslice_cb)(struct uslice_job *job, unsigned int slice,
+                          unsigned int thread);
+
+/** @This is a job split into slices, usually embedded in the private
+ * structure of the caller. */
+struct uslice_job {
+    /** structure for double-linked lists of the pool */
+    struct uchain uchain;
+    /** function processing a slice */
+    uslice_cb cb;
+    /** number of slices */
+    unsigned int nb_slices;
+    /** next slice to hand out */
+    unsigned int next_slice;
+    /** number of slices not processed yet */
+    unsigned int pending;
+};
+
+UBASE_FROM_TO(uslice_job, uchain, uchain, uchain)
+
+/** @This is a pool of threads processing slices. */
+struct uslice_pool {
+    /** protects the jobs and the counters */
+    pthread_mutex_t mutex;
+    /** signaled when a job is queued or workers must exit */
+    pthread_cond_t work_cond;
+    /** signaled when the last slice of a job is done */
+    pthread_cond_t done_cond;
+    /** jobs with slices not handed out yet */
+    struct uchain jobs;
+    /** set when workers must exit */
+    bool quit;
+    /** number of threads, including the calling thread */
+    unsigned int threads;
+    /** worker threads (threads - 1) */
+    struct uslice_worker *workers;
+};
+
+/** @This initializes a job.
+ *
+ * @param job pointer to the job
+ * @param cb function processing a slice
+ * @param nb_slices number of slices
+ */
+static inline void uslice_job_init(struct uslice_job *job, uslice_cb cb,
+                                   unsigned int nb_slices)
+{
+    uchain_init(&job->uchain);
+    job->cb = cb;
+    job->nb_slices = nb_slices;
+    job->next_slice = 0;
+    job->pending = nb_slices;
+}
+
+/** @This initializes a pool with a single thread, the calling thread.
+ *
+ * @param pool pointer to the pool
+ */
+void uslice_pool_init(struct uslice_pool *pool);
+
+/** @This stops the worker threads and cleans up a pool. No job may be
+ * pending.
+ *
+ * @param pool pointer to the pool
+ */
+void uslice_pool_clean(struct uslice_pool *pool);
+
+/** @This sets the number of threads, and (re)starts the worker threads.
+ * No job may be pending. In case of error the pool is left with a single
+ * thread.
+ *
+ * @param pool pointer to the pool
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+int uslice_pool_set_threads(struct uslice_pool *pool, unsigned int threads);
+
+/** @This returns the number of threads of a pool.
+ *
+ * @param pool pointer to the pool
+ * @return number of threads, including the calling thread
+ */
+static inline unsigned int uslice_pool_get_threads(struct uslice_pool *pool)
+{
+    return pool->threads;
+}
+
+/** @This hands the slices of a job to the worker threads, and returns
+ * immediately. @ref uslice_pool_wait must be called before the job is
+ * released.
+ *
+ * @param pool pointer to the pool
+ * @param job pointer to an initialized job
+ */
+void uslice_pool_queue(struct uslice_pool *pool, struct uslice_job *job);
+
+/** @This processes the slices of a queued job not picked by any worker in
+ * the calling thread, and returns when all slices are done.
+ *
+ * @param pool pointer to the pool
+ * @param job pointer to a queued job
+ */
+void uslice_pool_wait(struct uslice_pool *pool, struct uslice_job *job);
+
+/** @This processes all slices of a job and returns when they are done.
+ *
+ * @param pool pointer to the pool
+ * @param job pointer to an initialized job
+ */
+static inline void uslice_pool_run(struct uslice_pool *pool,
+                                   struct uslice_job *job)
+{
+    uslice_pool_queue(pool, job);
+    uslice_pool_wait(pool, job);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
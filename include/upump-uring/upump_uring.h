@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short declarations for a Upipe main loop using Linux io_uring
+ *
+ * Besides the usual pumps (fd watchers, timers, idlers and signals), this
+ * manager lets pipes queue their actual I/O on the ring with
+ * @ref upump_uring_mgr_submit. Other managers return
+ * @ref UBASE_ERR_UNHANDLED, so pipes can fall back to read(2)/write(2) from
+ * a watcher. The file source and sink queue their reads and writes of
+ * regular files this way.
+ */
+
+#ifndef _UPUMP_URING_UPUMP_URING_H_
+/** @hidden */
+#define _UPUMP_URING_UPUMP_URING_H_
+
+#include <upipe/upump.h>
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UPUMP_URING_SIGNATURE UBASE_FOURCC('u','r','n','g')
+
+/** @This defines the types of I/O that can be queued on the ring. */
+enum upump_uring_io_type {
+    /** pread(2) */
+    UPUMP_URING_IO_READ,
+    /** pwrite(2) */
+    UPUMP_URING_IO_WRITE,
+    /** recvmsg(2) */
+    UPUMP_URING_IO_RECVMSG,
+    /** sendmsg(2) */
+    UPUMP_URING_IO_SENDMSG
+};
+
+/** @This describes an I/O queued on the ring. It is allocated by the caller
+ * and must remain valid until the completion callback is called. */
+struct upump_uring_io {
+    /** type of I/O */
+    enum upump_uring_io_type type;
+    /** file descriptor */
+    int fd;
+    /** buffer for read and write */
+    void *buf;
+    /** size of the buffer for read and write */
+    size_t len;
+    /** file offset for read and write, or -1 for the current position */
+    uint64_t offset;
+    /** message for recvmsg and sendmsg */
+    struct msghdr *msg;
+    /** flags for recvmsg and sendmsg */
+    int flags;
+
+    /** completion callback, called from the event loop with the result of
+     * the system call (negative errno in case of error) */
+    void (*cb)(struct upump_uring_io *, int);
+    /** opaque pointer for the callback */
+    void *opaque;
+};
+
+/** @This extends upump_mgr_command with specific commands for uring. */
+enum upump_uring_mgr_command {
+    UPUMP_URING_MGR_SENTINEL = UPUMP_MGR_CONTROL_LOCAL,
+
+    /** queues an I/O on the ring (struct upump_uring_io *) */
+    UPUMP_URING_MGR_SUBMIT,
+    /** cancels a queued I/O (struct upump_uring_io *) */
+    UPUMP_URING_MGR_CANCEL
+};
+
+/** @This queues an I/O on the ring. The I/O is handed to the kernel before
+ * this function returns, so the file descriptor may be closed afterwards.
+ * The completion callback is called from the event loop; a pending I/O keeps
+ * the loop running.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param io description of the I/O
+ * @return an error code, including @ref UBASE_ERR_UNHANDLED if the manager
+ * is not a uring manager
+ */
+static inline int upump_uring_mgr_submit(struct upump_mgr *mgr,
+                                         struct upump_uring_io *io)
+{
+    return upump_mgr_control(mgr, UPUMP_URING_MGR_SUBMIT,
+                             UPUMP_URING_SIGNATURE, io);
+}
+
+/** @This cancels a queued I/O. The completion callback is still called,
+ * with -ECANCELED unless the I/O completed in the meantime.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param io description of the I/O
+ * @return an error code
+ */
+static inline int upump_uring_mgr_cancel(struct upump_mgr *mgr,
+                                         struct upump_uring_io *io)
+{
+    return upump_mgr_control(mgr, UPUMP_URING_MGR_CANCEL,
+                             UPUMP_URING_SIGNATURE, io);
+}
+
+/** @This allocates and initializes a upump_mgr structure bound to a new
+ * io_uring instance.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of error
+ * (including kernels without io_uring or older than 5.11)
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
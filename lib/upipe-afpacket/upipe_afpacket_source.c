@@ -0,0 +1,1060 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe source module for AF_PACKET TPACKET_V3 rings
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/urefcount.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/upump.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_ext.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_uref_mgr.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe/upipe_helper_uclock.h>
+#include <upipe-afpacket/upipe_afpacket_source.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+#include <bitstream/ietf/ip.h>
+#include <bitstream/ietf/udp.h>
+#include <bitstream/ieee/ethernet.h>
+
+/** default size of a block of the ring */
+#define AFPACKET_BLOCK_SIZE     (256 * 1024)
+/** default number of blocks of the ring */
+#define AFPACKET_BLOCK_NR       256
+/** nominal frame size, only used to dimension the ring */
+#define AFPACKET_FRAME_SIZE     2048
+/** delay after which the kernel retires a partially filled block, in ms */
+#define AFPACKET_BLOCK_TOV      4
+/** period of the ring polling while blocks are held by downstream pipes */
+#define AFPACKET_POLL_PERIOD    (UCLOCK_FREQ / 1000)
+/** depth of the pool of ubuf structures */
+#define AFPACKET_UBUF_POOL_DEPTH 1024
+/** marker of the jumps to the reject instruction of the socket filter */
+#define AFPACKET_BPF_REJECT     0xff
+
+/** @hidden */
+static int upipe_afpacket_source_check(struct upipe *upipe,
+                                       struct uref *flow_format);
+
+/** @hidden */
+struct upipe_afpacket_ring;
+
+/** @internal @This describes a block of the ring. */
+struct upipe_afpacket_block {
+    /** references to the block while it is read and pointed to by ubufs */
+    struct urefcount urefcount;
+    /** true until the block is given back to the kernel */
+    uatomic_uint32_t held;
+    /** block descriptor shared with the kernel */
+    struct tpacket_block_desc *desc;
+    /** pointer to the ring */
+    struct upipe_afpacket_ring *ring;
+};
+
+UBASE_FROM_TO(upipe_afpacket_block, urefcount, urefcount, urefcount)
+
+/** @internal @This describes the packet socket and its mapped ring. It is
+ * refcounted by the pipe and by the blocks in use, so that it outlives the
+ * pipe as long as buffers point into it. */
+struct upipe_afpacket_ring {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** packet socket */
+    int fd;
+    /** mapped ring */
+    uint8_t *map;
+    /** size of the mapping */
+    size_t map_size;
+    /** number of blocks */
+    unsigned int block_nr;
+    /** array of blocks */
+    struct upipe_afpacket_block *blocks;
+};
+
+UBASE_FROM_TO(upipe_afpacket_ring, urefcount, urefcount, urefcount)
+
+/** @internal @This gives a block back to the kernel once the last ubuf
+ * pointing into it is freed.
+ *
+ * @param urefcount pointer to the urefcount of the block
+ */
+static void upipe_afpacket_block_free(struct urefcount *urefcount)
+{
+    struct upipe_afpacket_block *block =
+        upipe_afpacket_block_from_urefcount(urefcount);
+    struct upipe_afpacket_ring *ring = block->ring;
+
+    /* the block is only marked free once the kernel owns it, so that the
+     * pipe never sees it as a new block */
+    __sync_synchronize();
+    block->desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    uatomic_store(&block->held, 0);
+    urefcount_release(upipe_afpacket_ring_to_urefcount(ring));
+}
+
+/** @internal @This frees the ring.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_afpacket_ring_free(struct urefcount *urefcount)
+{
+    struct upipe_afpacket_ring *ring =
+        upipe_afpacket_ring_from_urefcount(urefcount);
+    if (ring->map != MAP_FAILED)
+        munmap(ring->map, ring->map_size);
+    if (ring->fd != -1)
+        close(ring->fd);
+    for (unsigned int i = 0; i < ring->block_nr; i++)
+        uatomic_clean(&ring->blocks[i].held);
+    free(ring->blocks);
+    urefcount_clean(urefcount);
+    free(ring);
+}
+
+/** @internal @This allocates a ring, without opening the socket.
+ *
+ * @return pointer to the ring or NULL in case of allocation error
+ */
+static struct upipe_afpacket_ring *upipe_afpacket_ring_alloc(void)
+{
+    struct upipe_afpacket_ring *ring =
+        malloc(sizeof(struct upipe_afpacket_ring));
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    urefcount_init(upipe_afpacket_ring_to_urefcount(ring),
+                   upipe_afpacket_ring_free);
+    ring->fd = -1;
+    ring->map = MAP_FAILED;
+    ring->map_size = 0;
+    ring->block_nr = 0;
+    ring->blocks = NULL;
+    return ring;
+}
+
+/** @internal @This is the private context of an afpacket source pipe. */
+struct upipe_afpacket_source {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uref manager */
+    struct uref_mgr *uref_mgr;
+    /** uref manager request */
+    struct urequest uref_mgr_request;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** uclock structure, if not NULL we are in live mode */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** read watcher */
+    struct upump *upump;
+    /** timer polling the ring while blocks are held downstream */
+    struct upump *upump_timer;
+
+    /** ring */
+    struct upipe_afpacket_ring *ring;
+    /** ubuf manager pointing into the ring */
+    struct ubuf_mgr *ext_mgr;
+    /** next block to read */
+    unsigned int block_idx;
+    /** true if the next block is still held downstream */
+    bool ring_full;
+    /** socket holding the multicast membership, or -1 */
+    int mcast_fd;
+    /** destination address filter (host order), or 0 */
+    uint32_t dst_addr;
+    /** destination port filter, or 0 */
+    uint16_t dst_port;
+
+    /** uri */
+    char *uri;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_afpacket_source, upipe,
+                   UPIPE_AFPACKET_SOURCE_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_afpacket_source, urefcount,
+                       upipe_afpacket_source_free)
+UPIPE_HELPER_VOID(upipe_afpacket_source)
+
+UPIPE_HELPER_OUTPUT(upipe_afpacket_source, output, flow_def, output_state,
+                    request_list)
+UPIPE_HELPER_UREF_MGR(upipe_afpacket_source, uref_mgr, uref_mgr_request,
+                      upipe_afpacket_source_check,
+                      upipe_afpacket_source_register_output_request,
+                      upipe_afpacket_source_unregister_output_request)
+UPIPE_HELPER_UBUF_MGR(upipe_afpacket_source, ubuf_mgr, flow_format,
+                      ubuf_mgr_request,
+                      upipe_afpacket_source_check,
+                      upipe_afpacket_source_register_output_request,
+                      upipe_afpacket_source_unregister_output_request)
+UPIPE_HELPER_UCLOCK(upipe_afpacket_source, uclock, uclock_request,
+                    upipe_afpacket_source_check,
+                    upipe_afpacket_source_register_output_request,
+                    upipe_afpacket_source_unregister_output_request)
+
+UPIPE_HELPER_UPUMP_MGR(upipe_afpacket_source, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_afpacket_source, upump, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_afpacket_source, upump_timer, upump_mgr)
+
+/** @internal @This allocates an afpacket source pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_afpacket_source_alloc(struct upipe_mgr *mgr,
+                                                 struct uprobe *uprobe,
+                                                 uint32_t signature,
+                                                 va_list args)
+{
+    struct upipe *upipe = upipe_afpacket_source_alloc_void(mgr, uprobe,
+                                                           signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    upipe_afpacket_source_init_urefcount(upipe);
+    upipe_afpacket_source_init_uref_mgr(upipe);
+    upipe_afpacket_source_init_ubuf_mgr(upipe);
+    upipe_afpacket_source_init_output(upipe);
+    upipe_afpacket_source_init_upump_mgr(upipe);
+    upipe_afpacket_source_init_upump(upipe);
+    upipe_afpacket_source_init_upump_timer(upipe);
+    upipe_afpacket_source_init_uclock(upipe);
+    upipe_afpacket_source->ring = NULL;
+    upipe_afpacket_source->ext_mgr = NULL;
+    upipe_afpacket_source->block_idx = 0;
+    upipe_afpacket_source->ring_full = false;
+    upipe_afpacket_source->mcast_fd = -1;
+    upipe_afpacket_source->dst_addr = 0;
+    upipe_afpacket_source->dst_port = 0;
+    upipe_afpacket_source->uri = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This returns the UDP payload of a frame if it matches the
+ * destination filter.
+ *
+ * @param upipe description structure of the pipe
+ * @param frame pointer to the ethernet frame
+ * @param size captured size of the frame
+ * @param payload_p filled in with a pointer to the UDP payload
+ * @param payload_size_p filled in with the size of the UDP payload
+ * @return false if the frame must be skipped
+ */
+static bool upipe_afpacket_source_parse(struct upipe *upipe,
+                                        uint8_t *frame, size_t size,
+                                        uint8_t **payload_p,
+                                        size_t *payload_size_p)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+
+    if (unlikely(size < ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE +
+                        UDP_HEADER_SIZE ||
+                 ethernet_get_lentype(frame) != ETHERNET_TYPE_IP))
+        return false;
+    size -= ETHERNET_HEADER_LEN;
+
+    uint8_t *ip = frame + ETHERNET_HEADER_LEN;
+    size_t ip_header_size = ip_get_ihl(ip) * 4;
+    if (unlikely(ip_get_version(ip) != 4 ||
+                 ip_header_size < IP_HEADER_MINSIZE ||
+                 ip_header_size + UDP_HEADER_SIZE > size ||
+                 ip_get_proto(ip) != IP_PROTO_UDP))
+        return false;
+    if (upipe_afpacket_source->dst_addr &&
+        ip_get_dstaddr(ip) != upipe_afpacket_source->dst_addr)
+        return false;
+    size -= ip_header_size;
+
+    uint8_t *udp = ip_payload(ip);
+    if (upipe_afpacket_source->dst_port &&
+        udp_get_dstport(udp) != upipe_afpacket_source->dst_port)
+        return false;
+    uint16_t udp_size = udp_get_len(udp);
+    if (unlikely(udp_size < UDP_HEADER_SIZE || udp_size > size))
+        return false;
+
+    *payload_p = udp_payload(udp);
+    *payload_size_p = udp_size - UDP_HEADER_SIZE;
+    return true;
+}
+
+/** @internal @This outputs the matching datagrams of a block of the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param block block of the ring, held by the caller
+ * @param systime system time at wakeup
+ * @param real real time at wakeup
+ * @return false if the pipe was closed or reconfigured meanwhile
+ */
+static bool upipe_afpacket_source_read_block(struct upipe *upipe,
+                                             struct upipe_afpacket_block *block,
+                                             uint64_t systime, uint64_t real)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    struct upipe_afpacket_ring *ring = upipe_afpacket_source->ring;
+    struct tpacket_block_desc *desc = block->desc;
+    uint8_t *packet = (uint8_t *)desc + desc->hdr.bh1.offset_to_first_pkt;
+
+    for (uint32_t i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+        struct tpacket3_hdr *hdr = (struct tpacket3_hdr *)packet;
+        const struct sockaddr_ll *sll = (const struct sockaddr_ll *)
+            (packet + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+        packet += hdr->tp_next_offset;
+
+        uint8_t *payload;
+        size_t payload_size;
+        if (sll->sll_pkttype == PACKET_OUTGOING ||
+            !upipe_afpacket_source_parse(upipe, (uint8_t *)hdr + hdr->tp_mac,
+                                         hdr->tp_snaplen,
+                                         &payload, &payload_size))
+            continue;
+
+        struct uref *uref = uref_alloc(upipe_afpacket_source->uref_mgr);
+        struct ubuf *ubuf =
+            ubuf_block_ext_alloc(upipe_afpacket_source->ext_mgr,
+                                 payload, payload_size,
+                                 upipe_afpacket_block_to_urefcount(block));
+        if (unlikely(uref == NULL || ubuf == NULL)) {
+            uref_free(uref);
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return false;
+        }
+        uref_attach_ubuf(uref, ubuf);
+
+        if (likely(upipe_afpacket_source->uclock != NULL)) {
+            /* the ring is dated with the real time clock */
+            uint64_t date = hdr->tp_sec * UCLOCK_FREQ +
+                hdr->tp_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+            if (unlikely(date > real || real - date > systime))
+                date = systime;
+            else
+                date = systime - (real - date);
+            uref_clock_set_cr_sys(uref, date);
+        }
+
+        upipe_afpacket_source_output(upipe, uref,
+                                     &upipe_afpacket_source->upump);
+        if (unlikely(upipe_afpacket_source->ring != ring))
+            return false;
+    }
+    return true;
+}
+
+/** @internal @This reads the blocks that the kernel handed over.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the last blocks are still held downstream
+ */
+static bool upipe_afpacket_source_read(struct upipe *upipe)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    struct upipe_afpacket_ring *ring = upipe_afpacket_source->ring;
+
+    uint64_t systime = 0, real = 0;
+    if (likely(upipe_afpacket_source->uclock != NULL)) {
+        struct timespec ts;
+        systime = uclock_now(upipe_afpacket_source->uclock);
+        clock_gettime(CLOCK_REALTIME, &ts);
+        real = ts.tv_sec * UCLOCK_FREQ +
+               ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+    }
+
+    urefcount_use(upipe_afpacket_ring_to_urefcount(ring));
+    for ( ; ; ) {
+        struct upipe_afpacket_block *block =
+            &ring->blocks[upipe_afpacket_source->block_idx];
+        if (uatomic_load(&block->held)) {
+            /* the previous round of this block is still in use */
+            if (!upipe_afpacket_source->ring_full)
+                upipe_warn(upipe, "ring full, waiting for downstream pipes");
+            upipe_afpacket_source->ring_full = true;
+            break;
+        }
+        if (!(block->desc->hdr.bh1.block_status & TP_STATUS_USER))
+            break;
+        __sync_synchronize();
+
+        upipe_afpacket_source->ring_full = false;
+        uatomic_store(&block->held, 1);
+        urefcount_init(upipe_afpacket_block_to_urefcount(block),
+                       upipe_afpacket_block_free);
+        urefcount_use(upipe_afpacket_ring_to_urefcount(ring));
+        upipe_afpacket_source->block_idx =
+            (upipe_afpacket_source->block_idx + 1) % ring->block_nr;
+        bool cont = upipe_afpacket_source_read_block(upipe, block,
+                                                     systime, real);
+        urefcount_release(upipe_afpacket_block_to_urefcount(block));
+        if (!cont) {
+            urefcount_release(upipe_afpacket_ring_to_urefcount(ring));
+            return true;
+        }
+    }
+
+    /* the kernel reports the socket readable as long as the block before
+     * the one it fills is not given back */
+    unsigned int last = (upipe_afpacket_source->block_idx +
+                         ring->block_nr - 1) % ring->block_nr;
+    bool ret = !upipe_afpacket_source->ring_full &&
+               !uatomic_load(&ring->blocks[last].held);
+    urefcount_release(upipe_afpacket_ring_to_urefcount(ring));
+    return ret;
+}
+
+/** @internal @This polls the ring while blocks are held downstream.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_afpacket_source_timer_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    if (!upipe_afpacket_source_read(upipe) ||
+        upipe_afpacket_source->upump_timer != upump)
+        return;
+
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+    if (!getsockopt(upipe_afpacket_source->ring->fd, SOL_PACKET,
+                    PACKET_STATISTICS, &stats, &len) && stats.tp_drops)
+        upipe_warn_va(upipe, "%u packets dropped", stats.tp_drops);
+
+    upipe_afpacket_source_set_upump_timer(upipe, NULL);
+    upump_start(upipe_afpacket_source->upump);
+}
+
+/** @internal @This reads the ring when the kernel retires a block.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_afpacket_source_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    if (upipe_afpacket_source_read(upipe) ||
+        upipe_afpacket_source->upump != upump)
+        return;
+
+    /* the socket would stay readable, so poll the ring with a timer until
+     * downstream pipes release their buffers */
+    struct upump *upump_timer =
+        upump_alloc_timer(upipe_afpacket_source->upump_mgr,
+                          upipe_afpacket_source_timer_worker, upipe,
+                          upipe->refcount, AFPACKET_POLL_PERIOD,
+                          AFPACKET_POLL_PERIOD);
+    if (unlikely(upump_timer == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+    upump_stop(upump);
+    upipe_afpacket_source_set_upump_timer(upipe, upump_timer);
+    upump_start(upump_timer);
+}
+
+/** @internal @This checks if the pump may be allocated.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_afpacket_source_check(struct upipe *upipe,
+                                       struct uref *flow_format)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_afpacket_source_store_flow_def(upipe, flow_format);
+
+    upipe_afpacket_source_check_upump_mgr(upipe);
+    if (upipe_afpacket_source->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_afpacket_source->uref_mgr == NULL) {
+        upipe_afpacket_source_require_uref_mgr(upipe);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_afpacket_source->ubuf_mgr == NULL) {
+        struct uref *flow_format =
+            uref_block_flow_alloc_def(upipe_afpacket_source->uref_mgr, NULL);
+        if (unlikely(flow_format == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return UBASE_ERR_ALLOC;
+        }
+        upipe_afpacket_source_require_ubuf_mgr(upipe, flow_format);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_afpacket_source->uclock == NULL &&
+        urequest_get_opaque(&upipe_afpacket_source->uclock_request,
+                            struct upipe *) != NULL)
+        return UBASE_ERR_NONE;
+
+    struct upipe_afpacket_ring *ring = upipe_afpacket_source->ring;
+    if (ring == NULL || upipe_afpacket_source->upump != NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_afpacket_source->ext_mgr == NULL) {
+        /* regular allocations on the output buffers use our ubuf manager */
+        upipe_afpacket_source->ext_mgr =
+            ubuf_block_ext_mgr_alloc(AFPACKET_UBUF_POOL_DEPTH,
+                                     upipe_afpacket_source->ubuf_mgr);
+        if (unlikely(upipe_afpacket_source->ext_mgr == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+
+    struct upump *upump =
+        upump_alloc_fd_read(upipe_afpacket_source->upump_mgr,
+                            upipe_afpacket_source_worker, upipe,
+                            upipe->refcount, ring->fd);
+    if (unlikely(upump == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upipe_afpacket_source_set_upump(upipe, upump);
+    upump_start(upump);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This attaches a socket filter keeping only the UDP datagrams
+ * for the configured destination, so that the ring is not filled with
+ * unrelated traffic.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd packet socket
+ * @return an error code
+ */
+static int upipe_afpacket_source_attach_filter(struct upipe *upipe, int fd)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    struct sock_filter code[16];
+    unsigned int n = 0;
+
+    /* IPv4, UDP, not a fragment */
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+            ETH_P_IP, 0, AFPACKET_BPF_REJECT);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS,
+            ETHERNET_HEADER_LEN + 9);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+            IPPROTO_UDP, 0, AFPACKET_BPF_REJECT);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS,
+            ETHERNET_HEADER_LEN + 6);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+            0x3fff, AFPACKET_BPF_REJECT, 0);
+
+    if (upipe_afpacket_source->dst_addr) {
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                ETHERNET_HEADER_LEN + 16);
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                upipe_afpacket_source->dst_addr, 0, AFPACKET_BPF_REJECT);
+    }
+    if (upipe_afpacket_source->dst_port) {
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_LDX | BPF_B | BPF_MSH,
+                ETHERNET_HEADER_LEN);
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_IND,
+                ETHERNET_HEADER_LEN + 2);
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                upipe_afpacket_source->dst_port, 0, AFPACKET_BPF_REJECT);
+    }
+
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, UINT32_MAX);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+    for (unsigned int i = 0; i < n; i++) {
+        if (BPF_CLASS(code[i].code) != BPF_JMP)
+            continue;
+        if (code[i].jt == AFPACKET_BPF_REJECT)
+            code[i].jt = n - 2 - i;
+        if (code[i].jf == AFPACKET_BPF_REJECT)
+            code[i].jf = n - 2 - i;
+    }
+
+    struct sock_fprog prog = { .len = n, .filter = code };
+    if (unlikely(setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                            &prog, sizeof(prog)) < 0)) {
+        upipe_err_va(upipe, "can't attach socket filter (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This opens the packet socket and maps its ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param ring ring to fill in
+ * @param ifindex index of the capture interface
+ * @param block_size size of a block
+ * @param block_nr number of blocks
+ * @param fanout fanout argument, or 0
+ * @return an error code
+ */
+static int upipe_afpacket_source_open(struct upipe *upipe,
+                                      struct upipe_afpacket_ring *ring,
+                                      int ifindex, unsigned int block_size,
+                                      unsigned int block_nr, uint32_t fanout)
+{
+    /* no protocol until the ring and filter are ready */
+    int fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (unlikely(fd < 0)) {
+        upipe_err_va(upipe, "can't open packet socket (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    ring->fd = fd;
+    UBASE_RETURN(upipe_afpacket_source_attach_filter(upipe, fd))
+
+    int version = TPACKET_V3;
+    if (unlikely(setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                            &version, sizeof(version)) < 0)) {
+        upipe_err_va(upipe, "can't set TPACKET_V3 (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = block_size;
+    req.tp_block_nr = block_nr;
+    req.tp_frame_size = AFPACKET_FRAME_SIZE;
+    req.tp_frame_nr = block_size / AFPACKET_FRAME_SIZE * block_nr;
+    req.tp_retire_blk_tov = AFPACKET_BLOCK_TOV;
+    if (unlikely(setsockopt(fd, SOL_PACKET, PACKET_RX_RING,
+                            &req, sizeof(req)) < 0)) {
+        upipe_err_va(upipe, "can't set up %ux%u ring (%m)",
+                     block_nr, block_size);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    ring->map_size = (size_t)block_size * block_nr;
+    ring->map = mmap(NULL, ring->map_size,
+                             PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (unlikely(ring->map == MAP_FAILED)) {
+        upipe_err_va(upipe, "can't map ring (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    ring->blocks = malloc(sizeof(struct upipe_afpacket_block) *
+                                  block_nr);
+    if (unlikely(ring->blocks == NULL))
+        return UBASE_ERR_ALLOC;
+    ring->block_nr = block_nr;
+    for (unsigned int i = 0; i < block_nr; i++) {
+        uatomic_init(&ring->blocks[i].held, 0);
+        ring->blocks[i].ring = ring;
+        ring->blocks[i].desc = (struct tpacket_block_desc *)
+            (ring->map + (size_t)i * block_size);
+    }
+
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex = ifindex;
+    if (unlikely(bind(fd, (struct sockaddr *)&sll, sizeof(sll)) < 0)) {
+        upipe_err_va(upipe, "can't bind packet socket (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    if (fanout && unlikely(setsockopt(fd, SOL_PACKET, PACKET_FANOUT,
+                                      &fanout, sizeof(fanout)) < 0)) {
+        upipe_err_va(upipe, "can't join fanout group %u (%m)",
+                     fanout & 0xffff);
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This joins the multicast group of the destination, so that
+ * the switches and the interface deliver the stream.
+ *
+ * @param upipe description structure of the pipe
+ * @param ifindex index of the capture interface
+ * @return an error code
+ */
+static int upipe_afpacket_source_join(struct upipe *upipe, int ifindex)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    if (!IN_MULTICAST(upipe_afpacket_source->dst_addr))
+        return UBASE_ERR_NONE;
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (unlikely(fd < 0)) {
+        upipe_err_va(upipe, "can't open socket (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct ip_mreqn mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr.s_addr = htonl(upipe_afpacket_source->dst_addr);
+    mreq.imr_ifindex = ifindex;
+    if (unlikely(setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                            &mreq, sizeof(mreq)) < 0)) {
+        upipe_err_va(upipe, "can't join multicast group (%m)");
+        close(fd);
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_afpacket_source->mcast_fd = fd;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This closes the ring and releases the filter settings.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_afpacket_source_close(struct upipe *upipe)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    upipe_afpacket_source_set_upump(upipe, NULL);
+    upipe_afpacket_source_set_upump_timer(upipe, NULL);
+    if (upipe_afpacket_source->ring != NULL) {
+        urefcount_release(upipe_afpacket_ring_to_urefcount(
+                    upipe_afpacket_source->ring));
+        upipe_afpacket_source->ring = NULL;
+    }
+    ubuf_mgr_release(upipe_afpacket_source->ext_mgr);
+    upipe_afpacket_source->ext_mgr = NULL;
+    if (upipe_afpacket_source->mcast_fd != -1) {
+        close(upipe_afpacket_source->mcast_fd);
+        upipe_afpacket_source->mcast_fd = -1;
+    }
+    upipe_afpacket_source->block_idx = 0;
+    upipe_afpacket_source->ring_full = false;
+    upipe_afpacket_source->dst_addr = 0;
+    upipe_afpacket_source->dst_port = 0;
+    ubase_clean_str(&upipe_afpacket_source->uri);
+}
+
+/** @internal @This returns the uri of the currently opened ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri
+ * @return an error code
+ */
+static int upipe_afpacket_source_get_uri(struct upipe *upipe,
+                                         const char **uri_p)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_afpacket_source->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This asks to open the given uri.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri uri to open, see @ref upipe_afpacket_source_mgr_alloc
+ * @return an error code
+ */
+static int upipe_afpacket_source_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_afpacket_source *upipe_afpacket_source =
+        upipe_afpacket_source_from_upipe(upipe);
+
+    upipe_afpacket_source_close(upipe);
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    char *string = strdup(uri);
+    if (unlikely(string == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    char *options = strchr(string, '/');
+    if (options != NULL)
+        *options++ = '\0';
+
+    /* [@][addr][:port] */
+    char *addr = string;
+    if (*addr == '@')
+        addr++;
+    char *port = strrchr(addr, ':');
+    if (port != NULL) {
+        *port++ = '\0';
+        char *end;
+        unsigned long value = strtoul(port, &end, 10);
+        if (*end || !value || value > UINT16_MAX)
+            goto invalid;
+        upipe_afpacket_source->dst_port = value;
+    }
+    if (*addr) {
+        struct in_addr in;
+        if (inet_pton(AF_INET, addr, &in) != 1)
+            goto invalid;
+        upipe_afpacket_source->dst_addr = ntohl(in.s_addr);
+    }
+
+    int ifindex = 0;
+    unsigned int block_size = AFPACKET_BLOCK_SIZE;
+    unsigned int block_nr = AFPACKET_BLOCK_NR;
+    uint32_t fanout = 0;
+    uint32_t fanout_mode = PACKET_FANOUT_HASH;
+    while (options != NULL) {
+        char *option = options;
+        options = strchr(options, '/');
+        if (options != NULL)
+            *options++ = '\0';
+
+#define IS_OPTION(name) (!strncasecmp(option, name, strlen(name)))
+#define ARG_OPTION(name) (option + strlen(name))
+        if (IS_OPTION("ifname=")) {
+            ifindex = if_nametoindex(ARG_OPTION("ifname="));
+            if (!ifindex) {
+                upipe_err_va(upipe, "unknown interface %s",
+                             ARG_OPTION("ifname="));
+                goto invalid;
+            }
+        } else if (IS_OPTION("fanout=")) {
+            fanout = strtoul(ARG_OPTION("fanout="), NULL, 0) & 0xffff;
+        } else if (IS_OPTION("fanout-mode=")) {
+            const char *mode = ARG_OPTION("fanout-mode=");
+            if (!strcasecmp(mode, "hash"))
+                fanout_mode = PACKET_FANOUT_HASH;
+            else if (!strcasecmp(mode, "lb"))
+                fanout_mode = PACKET_FANOUT_LB;
+            else if (!strcasecmp(mode, "cpu"))
+                fanout_mode = PACKET_FANOUT_CPU;
+            else if (!strcasecmp(mode, "qm"))
+                fanout_mode = PACKET_FANOUT_QM;
+            else
+                upipe_warn_va(upipe, "unknown fanout mode %s", mode);
+        } else if (IS_OPTION("blocks=")) {
+            block_nr = strtoul(ARG_OPTION("blocks="), NULL, 0);
+        } else if (IS_OPTION("block-size=")) {
+            block_size = strtoul(ARG_OPTION("block-size="), NULL, 0);
+        } else {
+            upipe_warn_va(upipe, "unrecognized option %s", option);
+        }
+#undef IS_OPTION
+#undef ARG_OPTION
+    }
+
+    if (!ifindex) {
+        upipe_err_va(upipe, "no interface given in %s", uri);
+        goto invalid;
+    }
+    if (!block_nr || !block_size || block_size % getpagesize()) {
+        upipe_err_va(upipe, "invalid ring of %u blocks of %u octets",
+                     block_nr, block_size);
+        goto invalid;
+    }
+    free(string);
+
+    struct upipe_afpacket_ring *ring = upipe_afpacket_ring_alloc();
+    if (unlikely(ring == NULL)) {
+        upipe_afpacket_source_close(upipe);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_afpacket_source->ring = ring;
+
+    int err = upipe_afpacket_source_open(upipe, ring, ifindex,
+            block_size, block_nr, fanout ? fanout | (fanout_mode << 16) : 0);
+    if (ubase_check(err))
+        err = upipe_afpacket_source_join(upipe, ifindex);
+    if (ubase_check(err)) {
+        upipe_afpacket_source->uri = strdup(uri);
+        if (unlikely(upipe_afpacket_source->uri == NULL))
+            err = UBASE_ERR_ALLOC;
+    }
+    if (unlikely(!ubase_check(err))) {
+        upipe_afpacket_source_close(upipe);
+        return err;
+    }
+
+    upipe_notice_va(upipe, "opening packet ring %s (%ux%u)",
+                    upipe_afpacket_source->uri, block_nr, block_size);
+    return UBASE_ERR_NONE;
+
+invalid:
+    upipe_err_va(upipe, "invalid afpacket uri %s", uri);
+    free(string);
+    upipe_afpacket_source_close(upipe);
+    return UBASE_ERR_INVALID;
+}
+
+/** @internal @This processes control commands on an afpacket source pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_afpacket_source_control(struct upipe *upipe,
+                                          int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_afpacket_source_set_upump(upipe, NULL);
+            upipe_afpacket_source_set_upump_timer(upipe, NULL);
+            return upipe_afpacket_source_attach_upump_mgr(upipe);
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_afpacket_source_set_upump(upipe, NULL);
+            upipe_afpacket_source_set_upump_timer(upipe, NULL);
+            upipe_afpacket_source_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_GET_FLOW_DEF:
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+            return upipe_afpacket_source_control_output(upipe, command, args);
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_afpacket_source_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_afpacket_source_set_uri(upipe, uri);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on an afpacket source pipe,
+ * and checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_afpacket_source_control(struct upipe *upipe,
+                                         int command, va_list args)
+{
+    UBASE_RETURN(_upipe_afpacket_source_control(upipe, command, args));
+
+    return upipe_afpacket_source_check(upipe, NULL);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_afpacket_source_free(struct upipe *upipe)
+{
+    upipe_afpacket_source_close(upipe);
+
+    upipe_throw_dead(upipe);
+
+    upipe_afpacket_source_clean_uclock(upipe);
+    upipe_afpacket_source_clean_upump_timer(upipe);
+    upipe_afpacket_source_clean_upump(upipe);
+    upipe_afpacket_source_clean_upump_mgr(upipe);
+    upipe_afpacket_source_clean_output(upipe);
+    upipe_afpacket_source_clean_ubuf_mgr(upipe);
+    upipe_afpacket_source_clean_uref_mgr(upipe);
+    upipe_afpacket_source_clean_urefcount(upipe);
+    upipe_afpacket_source_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_afpacket_source_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_AFPACKET_SOURCE_SIGNATURE,
+
+    .upipe_alloc = upipe_afpacket_source_alloc,
+    .upipe_input = NULL,
+    .upipe_control = upipe_afpacket_source_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all afpacket sources.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_afpacket_source_mgr_alloc(void)
+{
+    return &upipe_afpacket_source_mgr;
+}
@@ -0,0 +1,58 @@
+;******************************************************************************
+;* Deinterlace merge kernels
+;* Copyright (C) 2026 OpenHeadend S.A.R.L.
+;*
+;* This program is free software; you can redistribute it and/or modify it
+;* under the terms of the GNU Lesser General Public License as published by
+;* the Free Software Foundation; either version 2.1 of the License, or
+;* (at your option) any later version.
+;*
+;* This program is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+;* GNU Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public License
+;* along with this program; if not, write to the Free Software Foundation,
+;* Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+%if ARCH_X86_64
+
+; %1 = sample size in octets, %2 = averaging instruction
+%macro filter_merge 2
+
+; filter_merge(uint8_t *dst, const uint8_t *s1, const uint8_t *s2, ptrdiff_t w)
+cglobal filter_merge%1, 4, 4, 2, dst, s1, s2, w
+%if %1 == 16
+    add     wq, wq
+%endif
+    add     dstq, wq
+    add     s1q, wq
+    add     s2q, wq
+    neg     wq
+
+.loop:
+    movu    m0, [s1q + wq]
+    movu    m1, [s2q + wq]
+    %2      m0, m1
+    movu    [dstq + wq], m0
+    add     wq, mmsize
+    jl      .loop
+    RET
+
+%endmacro
+
+INIT_XMM sse2
+filter_merge 8, pavgb
+filter_merge 16, pavgw
+
+INIT_YMM avx2
+filter_merge 8, pavgb
+filter_merge 16, pavgw
+
+%endif
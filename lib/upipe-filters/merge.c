@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2011 VLC authors and VideoLAN
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short deinterlace merge kernels
+ *
+ * Adapted from VLC video_filter (blend deinterlace) :
+ * - modules/video_filter/deinterlace/merge.c
+ */
+
+#include "merge.h"
+
+void upipe_filter_merge8_c(uint8_t *dst, const uint8_t *s1,
+                           const uint8_t *s2, ptrdiff_t w)
+{
+    for (ptrdiff_t i = 0; i < w; i++)
+        dst[i] = (s1[i] + s2[i] + 1) >> 1;
+}
+
+void upipe_filter_merge16_c(uint16_t *dst, const uint16_t *s1,
+                            const uint16_t *s2, ptrdiff_t w)
+{
+    for (ptrdiff_t i = 0; i < w; i++)
+        dst[i] = (s1[i] + s2[i] + 1) >> 1;
+}
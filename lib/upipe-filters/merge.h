@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short deinterlace merge kernels
+ *
+ * The kernels compute the rounded mean (a + b + 1) >> 1 of w samples of two
+ * lines, like pavgb and pavgw. The SIMD versions require w to be a multiple
+ * of @ref UPIPE_FILTER_MERGE_ALIGN.
+ */
+
+#ifndef _MERGE_H_
+/** @hidden */
+#define _MERGE_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/** alignment of the w parameter of SIMD kernels */
+#define UPIPE_FILTER_MERGE_ALIGN 32
+
+void upipe_filter_merge8_c(uint8_t *dst, const uint8_t *s1,
+                           const uint8_t *s2, ptrdiff_t w);
+void upipe_filter_merge16_c(uint16_t *dst, const uint16_t *s1,
+                            const uint16_t *s2, ptrdiff_t w);
+
+void upipe_filter_merge8_sse2(uint8_t *dst, const uint8_t *s1,
+                              const uint8_t *s2, ptrdiff_t w);
+void upipe_filter_merge16_sse2(uint16_t *dst, const uint16_t *s1,
+                               const uint16_t *s2, ptrdiff_t w);
+
+void upipe_filter_merge8_avx2(uint8_t *dst, const uint8_t *s1,
+                              const uint8_t *s2, ptrdiff_t w);
+void upipe_filter_merge16_avx2(uint16_t *dst, const uint16_t *s1,
+                               const uint16_t *s2, ptrdiff_t w);
+
+#endif
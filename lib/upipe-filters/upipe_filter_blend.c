@@ -27,6 +27,8 @@
  * - modules/video_filter/deinterlace/algo_basic.c
  */
 
+#include <config.h>
+
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
 #include <upipe/udict.h>
@@ -44,13 +46,27 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslice.h>
 #include <upipe-filters/upipe_filter_blend.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#include "merge.h"
+
+/** maximum number of planes of a picture */
+#define MAX_PLANES 8
+
+/** @internal @This is the type of the 8-bit merge kernels. */
+typedef void (*upipe_filter_blend_merge_8)(uint8_t *dst, const uint8_t *s1,
+                                           const uint8_t *s2, ptrdiff_t w);
+/** @internal @This is the type of the 16-bit merge kernels. */
+typedef void (*upipe_filter_blend_merge_16)(uint16_t *dst, const uint16_t *s1,
+                                            const uint16_t *s2, ptrdiff_t w);
+
 /** @hidden */
 static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
                                       struct upump **upump_p);
@@ -58,6 +74,24 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
 static int upipe_filter_blend_check(struct upipe *upipe,
                                     struct uref *flow_format);
 
+/** @internal @This describes a plane of the picture being filtered. */
+struct upipe_filter_blend_plane {
+    /** input buffer */
+    const uint8_t *in;
+    /** output buffer */
+    uint8_t *out;
+    /** stride of the input buffer */
+    size_t stride_in;
+    /** stride of the output buffer */
+    size_t stride_out;
+    /** number of octets to process per line */
+    size_t bytes;
+    /** number of lines */
+    size_t height;
+    /** true if the plane is made of 16-bit samples */
+    bool merge16;
+};
+
 /** @internal upipe_filter_blend private structure */
 struct upipe_filter_blend {
     /** refcount management structure */
@@ -88,6 +122,20 @@ struct upipe_filter_blend {
     /** list of blockers (used during udeal) */
     struct uchain blockers;
 
+    /** pool of filtering threads */
+    struct uslice_pool pool;
+    /** job of the current picture */
+    struct uslice_job job;
+    /** planes of the picture being filtered */
+    struct upipe_filter_blend_plane planes[MAX_PLANES];
+    /** number of planes of the picture being filtered */
+    unsigned int nb_planes;
+
+    /** merge kernel for the aligned part of 8-bit lines */
+    upipe_filter_blend_merge_8 merge_8;
+    /** merge kernel for the aligned part of 16-bit lines */
+    upipe_filter_blend_merge_16 merge_16;
+
     /** public structure */
     struct upipe upipe;
 };
@@ -123,83 +171,196 @@ static struct upipe *upipe_filter_blend_alloc(struct upipe_mgr *mgr,
     upipe_filter_blend_init_ubuf_mgr(upipe);
     upipe_filter_blend_init_output(upipe);
     upipe_filter_blend_init_input(upipe);
+
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    uslice_pool_init(&upipe_filter_blend->pool);
+    upipe_filter_blend->nb_planes = 0;
+
+    upipe_filter_blend->merge_8 = upipe_filter_merge8_c;
+    upipe_filter_blend->merge_16 = upipe_filter_merge16_c;
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    upipe_filter_blend->merge_8 = upipe_filter_merge8_sse2;
+    upipe_filter_blend->merge_16 = upipe_filter_merge16_sse2;
+
+    if (__builtin_cpu_supports("avx2")) {
+        upipe_filter_blend->merge_8 = upipe_filter_merge8_avx2;
+        upipe_filter_blend->merge_16 = upipe_filter_merge16_avx2;
+    }
+#endif
+
     upipe_throw_ready(upipe);
     return upipe;
 }
 
-/** @internal @This computes the per-pixel mean of two lines
- * Code from VLC.
- * - modules/video_filter/deinterlace/merge.c
+/** @internal @This computes the per-pixel mean of two lines. The SIMD
+ * kernels process the aligned part of the lines, and the C kernels the
+ * remaining samples.
  *
- * @param _dest dest line
- * @param _s1 first source line
- * @param _s2 second source line
+ * @param upipe_filter_blend private structure of the pipe
+ * @param out output line
+ * @param s1 first source line
+ * @param s2 second source line
  * @param bytes length in bytes
+ * @param merge16 true if the lines are made of 16-bit samples
  */
-static void upipe_filter_merge16bit( void *_dest, const void *_s1,
-                       const void *_s2, size_t bytes )
+static void upipe_filter_blend_merge(
+        const struct upipe_filter_blend *upipe_filter_blend,
+        uint8_t *out, const uint8_t *s1, const uint8_t *s2, size_t bytes,
+        bool merge16)
 {
-    uint16_t *dest = _dest;
-    const uint16_t *s1 = _s1;
-    const uint16_t *s2 = _s2;
+    ptrdiff_t w = merge16 ? bytes / 2 : bytes;
+    ptrdiff_t done = 0;
+
+    if (w >= UPIPE_FILTER_MERGE_ALIGN) {
+        done = w & ~(ptrdiff_t)(UPIPE_FILTER_MERGE_ALIGN - 1);
+        if (merge16)
+            upipe_filter_blend->merge_16((uint16_t *)out,
+                    (const uint16_t *)s1, (const uint16_t *)s2, done);
+        else
+            upipe_filter_blend->merge_8(out, s1, s2, done);
+    }
 
-    bytes /= 2;
-    for( ; bytes > 0; bytes-- )
-        *dest++ = ( *s1++ + *s2++ ) >> 1;
+    if (merge16)
+        upipe_filter_merge16_c((uint16_t *)out + done,
+                               (const uint16_t *)s1 + done,
+                               (const uint16_t *)s2 + done, w - done);
+    else
+        upipe_filter_merge8_c(out + done, s1 + done, s2 + done, w - done);
 }
 
-/** @internal @This computes the per-pixel mean of two lines
- * Code from VLC.
- * - modules/video_filter/deinterlace/merge.c
+/** @internal @This processes a slice of lines of a picture plane. The first
+ * line is copied, and each following line is the mean of the input line
+ * and the line above.
+ * Adapted from VLC.
+ * - modules/video_filter/deinterlace/algo_basic.c
  *
- * @param _dest dest line
- * @param _s1 first source line
- * @param _s2 second source line
- * @param bytes length in bytes
+ * @param upipe_filter_blend private structure of the pipe
+ * @param plane description of the plane
+ * @param first first line of the slice
+ * @param last line following the last line of the slice
  */
-static void upipe_filter_merge8bit( void *_dest, const void *_s1,
-                       const void *_s2, size_t bytes )
+static void upipe_filter_blend_plane(
+        const struct upipe_filter_blend *upipe_filter_blend,
+        const struct upipe_filter_blend_plane *plane,
+        size_t first, size_t last)
 {
-    uint8_t *dest = _dest;
-    const uint8_t *s1 = _s1;
-    const uint8_t *s2 = _s2;
+    const uint8_t *in = plane->in + first * plane->stride_in;
+    uint8_t *out = plane->out + first * plane->stride_out;
+
+    if (first == 0 && last > 0) {
+        // Copy first line
+        memcpy(out, in, plane->bytes);
+        out += plane->stride_out;
+        first++;
+    } else {
+        in -= plane->stride_in;
+    }
 
-    for( ; bytes > 0; bytes-- )
-        *dest++ = ( *s1++ + *s2++ ) >> 1;
+    // Compute mean value for remaining lines
+    for ( ; first < last; first++) {
+        upipe_filter_blend_merge(upipe_filter_blend, out, in,
+                                 in + plane->stride_in,
+                                 plane->bytes, plane->merge16);
+        out += plane->stride_out;
+        in += plane->stride_in;
+    }
 }
 
-/** @internal @This processes a picture plane
- * Adapted from VLC.
- * - modules/video_filter/deinterlace/algo_basic.c
+/** @internal @This processes a slice of all planes of the current picture.
  *
- * @param in input buffer
- * @param out output buffer
- * @param stride_in stride length of input buffer
- * @param stride_out stride length of output buffer
- * @param height picture height
+ * @param job job of the current picture
+ * @param slice index of the slice
+ * @param thread index of the thread
  */
-static void upipe_filter_blend_plane(const uint8_t *in, uint8_t *out,
-                                     size_t stride_in, size_t stride_out,
-                                     size_t height, uint8_t macropixel_size)
+static void upipe_filter_blend_work_slice(struct uslice_job *job,
+                                          unsigned int slice,
+                                          unsigned int thread)
 {
-    uint8_t *out_end = out + stride_out * height;
-
-    // Copy first line
-    memcpy(out, in, stride_in);
-    out += stride_out;
+    struct upipe_filter_blend *upipe_filter_blend =
+        container_of(job, struct upipe_filter_blend, job);
+    unsigned int nb_slices = job->nb_slices;
+    for (unsigned int i = 0; i < upipe_filter_blend->nb_planes; i++) {
+        const struct upipe_filter_blend_plane *plane =
+            &upipe_filter_blend->planes[i];
+        upipe_filter_blend_plane(upipe_filter_blend, plane,
+                                 plane->height * slice / nb_slices,
+                                 plane->height * (slice + 1) / nb_slices);
+    }
+}
 
-    // Compute mean value for remaining lines
-    while (out < out_end) {
-        if (macropixel_size == 2)
-            upipe_filter_merge16bit(out, in, in+stride_in,
-                    (stride_in < stride_out) ? stride_in : stride_out);
-        else
-            upipe_filter_merge8bit(out, in, in+stride_in,
-                    (stride_in < stride_out) ? stride_in : stride_out);
+/** @internal @This gets the number of filtering threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_filter_blend_get_threads(struct upipe *upipe,
+                                           unsigned int *threads_p)
+{
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_filter_blend->pool);
+    return UBASE_ERR_NONE;
+}
 
-        out += stride_out;
-        in += stride_in;
+/** @internal @This sets the number of filtering threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_filter_blend_set_threads(struct upipe *upipe,
+                                           unsigned int threads)
+{
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&upipe_filter_blend->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
     }
+    upipe_dbg_va(upipe, "filtering with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This filters all planes of the current picture. The planes are
+ * split into slices of lines, shared between the worker threads and the
+ * calling thread. It returns when all slices are done.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_filter_blend_work(struct upipe *upipe)
+{
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    uslice_job_init(&upipe_filter_blend->job, upipe_filter_blend_work_slice,
+                    uslice_pool_get_threads(&upipe_filter_blend->pool));
+    uslice_pool_run(&upipe_filter_blend->pool, &upipe_filter_blend->job);
+}
+
+/** @internal @This checks whether a plane is made of little-endian samples
+ * of more than 8 bits, which are merged per sample.
+ *
+ * @param chroma chroma type (see chroma reference)
+ * @param macropixel_size size of a macropixel in octets
+ * @return true if the plane is merged with 16-bit kernels
+ */
+static bool upipe_filter_blend_16bit(const char *chroma,
+                                     uint8_t macropixel_size)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (macropixel_size != 2 || !*chroma)
+        return false;
+    char *end;
+    unsigned long bits = strtoul(chroma + 1, &end, 10);
+    return bits > 8 && bits <= 16 && !strcmp(end, "l");
+#else
+    return false;
+#endif
 }
 
 /** @internal @This handles input.
@@ -223,11 +384,10 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
     if (upipe_filter_blend->flow_def == NULL)
         return false;
 
-    const uint8_t *in;
-    uint8_t *out;
-    uint8_t hsub, vsub, macropixel_size;
+    uint8_t vsub, macropixel_size;
     size_t stride_in = 0, stride_out = 0, width, height;
     struct ubuf *ubuf_deint = NULL;
+    const char *chroma;
 
     // Now process frames
     uref_pic_size(uref, &width, &height, NULL);
@@ -241,29 +401,54 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
     }
 
     // Iterate planes
-    const char *chroma;
+    upipe_filter_blend->nb_planes = 0;
     uref_pic_foreach_plane(uref, chroma) {
-        // map all
+        if (unlikely(upipe_filter_blend->nb_planes >= MAX_PLANES)) {
+            upipe_err(upipe, "too many planes");
+            goto error_unmap;
+        }
         if (unlikely(!ubase_check(uref_pic_plane_size(uref, chroma, &stride_in,
-                                                &hsub, &vsub, &macropixel_size)))) {
+                                                NULL, &vsub, &macropixel_size)))) {
             upipe_err_va(upipe, "Could not read origin chroma %s", chroma);
-            goto error;
+            goto error_unmap;
         }
         if (unlikely(!ubase_check(ubuf_pic_plane_size(ubuf_deint, chroma, &stride_out,
                                                   NULL, NULL, NULL)))) {
             upipe_err_va(upipe, "Could not read dest chroma %s", chroma);
-            goto error;
+            goto error_unmap;
+        }
+
+        // map all
+        struct upipe_filter_blend_plane *plane =
+            &upipe_filter_blend->planes[upipe_filter_blend->nb_planes];
+        if (unlikely(!ubase_check(uref_pic_plane_read(uref, chroma,
+                                    0, 0, -1, -1, &plane->in)))) {
+            upipe_err_va(upipe, "Could not map origin chroma %s", chroma);
+            goto error_unmap;
+        }
+        if (unlikely(!ubase_check(ubuf_pic_plane_write(ubuf_deint, chroma,
+                                    0, 0, -1, -1, &plane->out)))) {
+            upipe_err_va(upipe, "Could not map dest chroma %s", chroma);
+            uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1);
+            goto error_unmap;
         }
-        uref_pic_plane_read(uref, chroma, 0, 0, -1, -1, &in);
-        ubuf_pic_plane_write(ubuf_deint, chroma, 0, 0, -1, -1, &out);
+        plane->stride_in = stride_in;
+        plane->stride_out = stride_out;
+        plane->bytes = stride_in < stride_out ? stride_in : stride_out;
+        plane->height = height / vsub;
+        plane->merge16 = upipe_filter_blend_16bit(chroma, macropixel_size);
+        upipe_filter_blend->nb_planes++;
+    }
 
-        // process plane
-        upipe_filter_blend_plane(in, out, stride_in, stride_out, (size_t) height/vsub, macropixel_size);
+    // process planes
+    upipe_filter_blend_work(upipe);
 
-        // unmap all
+    // unmap all
+    uref_pic_foreach_plane(uref, chroma) {
         uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1);
         ubuf_pic_plane_unmap(ubuf_deint, chroma, 0, 0, -1, -1);
     }
+    upipe_filter_blend->nb_planes = 0;
 
     // Attach new ubuf and output frame
     uref_attach_ubuf(uref, ubuf_deint);
@@ -273,6 +458,14 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
     upipe_filter_blend_output(upipe, uref, upump_p);
     return true;
 
+error_unmap:
+    uref_pic_foreach_plane(uref, chroma) {
+        if (!upipe_filter_blend->nb_planes)
+            break;
+        uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1);
+        ubuf_pic_plane_unmap(ubuf_deint, chroma, 0, 0, -1, -1);
+        upipe_filter_blend->nb_planes--;
+    }
 error:
     uref_free(uref);
     if (ubuf_deint) {
@@ -385,6 +578,17 @@ static int upipe_filter_blend_control(struct upipe *upipe,
         case UPIPE_GET_OUTPUT:
         case UPIPE_SET_OUTPUT:
             return upipe_filter_blend_control_output(upipe, command, args);
+
+        case UPIPE_FILTER_BLEND_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_BLEND_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_filter_blend_get_threads(upipe, threads_p);
+        }
+        case UPIPE_FILTER_BLEND_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_BLEND_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_filter_blend_set_threads(upipe, threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -396,8 +600,11 @@ static int upipe_filter_blend_control(struct upipe *upipe,
  */
 static void upipe_filter_blend_free(struct upipe *upipe)
 {
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
     upipe_throw_dead(upipe);
 
+    uslice_pool_clean(&upipe_filter_blend->pool);
     upipe_filter_blend_clean_input(upipe);
     upipe_filter_blend_clean_ubuf_mgr(upipe);
     upipe_filter_blend_clean_output(upipe);
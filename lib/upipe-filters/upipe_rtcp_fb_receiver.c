@@ -32,6 +32,7 @@
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_flow.h>
 #include <upipe/upipe.h>
+#include <upipe/useqring.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -94,7 +95,11 @@ struct upipe_rtcpfb {
     struct upump *upump_timer;
     struct uclock *uclock;
     struct urequest uclock_request;
-    struct uchain queue;
+    /** packets kept for retransmission, indexed by sequence number */
+    struct useqring queue;
+    /** extra space for the queue */
+    void *queue_extra;
+    /** newest buffered sequence number */
     unsigned last_seq;
 
     /** list of input subpipes */
@@ -272,44 +277,44 @@ static int ctz(unsigned int x)
 #endif
 }
 
-/** @internal @This retransmits a number of packets */
-static void upipe_rtcpfb_lost_sub_n(struct upipe *upipe, uint16_t seq, uint16_t pkts)
+/** @internal @This retransmits a packet if it is still buffered.
+ *
+ * @param upipe description structure of the subpipe
+ * @param seq sequence number of the packet
+ * @return false if the packet is not buffered anymore
+ */
+static bool upipe_rtcpfb_retransmit(struct upipe *upipe, uint16_t seq)
 {
     struct upipe *upipe_super = NULL;
     upipe_rtcpfb_input_get_super(upipe, &upipe_super);
     struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe_super);
 
-    struct uchain *uchain;
-    ulist_foreach(&upipe_rtcpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t uref_seqnum = 0;
-        uref_attr_get_priv(uref, &uref_seqnum);
-
-        uint16_t diff = uref_seqnum - seq;
-        if (diff > pkts) {
-            /* packet not in range */
-            if (diff < 0x8000) {
-                /* packet after range */
-                return;
-            }
-            continue;
-        }
+    struct uref *uref = useqring_peek(&upipe_rtcpfb->queue, seq);
+    if (uref == NULL)
+        return false;
+
+    upipe_verbose_va(upipe, "Retransmit %hu", seq);
+    upipe_rtcpfb->retrans++;
+
+    uint8_t *buf;
+    int s = 0;
+    if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
+        uint8_t ssrc[4];
+        rtp_get_ssrc(buf, ssrc);
+        ssrc[3] |= 1; /* RIST retransmitted packet */
+        rtp_set_ssrc(buf, ssrc);
+        uref_block_unmap(uref, 0);
+    }
 
-        upipe_verbose_va(upipe, "Retransmit %hu", seq);
-        upipe_rtcpfb->retrans++;
-
-        uint8_t *buf;
-        int s = 0;
-        if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
-            uint8_t ssrc[4];
-            rtp_get_ssrc(buf, ssrc);
-            ssrc[3] |= 1; /* RIST retransmitted packet */
-            rtp_set_ssrc(buf, ssrc);
-            uref_block_unmap(uref, 0);
-        }
+    upipe_rtcpfb_output(upipe_super, uref_dup(uref), NULL);
+    return true;
+}
 
-        upipe_rtcpfb_output(upipe_super, uref_dup(uref), NULL);
-    }
+/** @internal @This retransmits a number of packets */
+static void upipe_rtcpfb_lost_sub_n(struct upipe *upipe, uint16_t seq, uint16_t pkts)
+{
+    for (uint32_t i = 0; i <= pkts; i++)
+        upipe_rtcpfb_retransmit(upipe, seq + i);
 }
 
 /** @internal @This retransmits a list of packets described by a single FCI.
@@ -317,33 +322,9 @@ static void upipe_rtcpfb_lost_sub_n(struct upipe *upipe, uint16_t seq, uint16_t
  */
 static void upipe_rtcpfb_lost_sub(struct upipe *upipe, uint16_t seq, uint16_t mask)
 {
-    struct upipe *upipe_super = NULL;
-    upipe_rtcpfb_input_get_super(upipe, &upipe_super);
-    struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe_super);
-
-    struct uchain *uchain;
-    ulist_foreach(&upipe_rtcpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t uref_seqnum = 0;
-        uref_attr_get_priv(uref, &uref_seqnum);
-
-        if (seq != uref_seqnum)
-            continue;
-
-        upipe_verbose_va(upipe, "Retransmit %hu", seq);
-        upipe_rtcpfb->retrans++;
-
-        uint8_t *buf;
-        int s = 0;
-        if (ubase_check(uref_block_write(uref, 0, &s, &buf))) {
-            uint8_t ssrc[4];
-            rtp_get_ssrc(buf, ssrc);
-            ssrc[3] |= 1; /* RIST retransmitted packet */
-            rtp_set_ssrc(buf, ssrc);
-            uref_block_unmap(uref, 0);
-        }
-
-        upipe_rtcpfb_output(upipe_super, uref_dup(uref), NULL);
+    for (;;) {
+        if (!upipe_rtcpfb_retransmit(upipe, seq))
+            upipe_warn_va(upipe, "Couldn't find seq %hu", seq);
 
         if (!mask)
             return;
@@ -352,8 +333,6 @@ static void upipe_rtcpfb_lost_sub(struct upipe *upipe, uint16_t seq, uint16_t ma
         mask >>= zeros + 1;
         seq += zeros + 1;
     }
-
-    upipe_warn_va(upipe, "Couldn't find seq %hu", seq);
 }
 
 /** @This is called when there is no external reference to the pipe anymore.
@@ -413,12 +392,10 @@ static void upipe_rtcpfb_timer(struct upump *upump)
 
     uint64_t now = uclock_now(upipe_rtcpfb->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtcpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
+    uint16_t seqnum;
+    while (useqring_next(&upipe_rtcpfb->queue,
+                         useqring_head(&upipe_rtcpfb->queue), &seqnum)) {
+        struct uref *uref = useqring_peek(&upipe_rtcpfb->queue, seqnum);
 
         uint64_t cr_sys = 0;
         if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
@@ -427,10 +404,11 @@ static void upipe_rtcpfb_timer(struct upump *upump)
         if (now - cr_sys < upipe_rtcpfb->latency * UCLOCK_FREQ / 1000)
             return;
 
-        upipe_verbose_va(upipe, "Delete seq %" PRIu64 " after %"PRIu64" clocks",
+        upipe_verbose_va(upipe, "Delete seq %hu after %"PRIu64" clocks",
                 seqnum, now - cr_sys);
 
-        ulist_delete(uchain);
+        useqring_remove(&upipe_rtcpfb->queue, seqnum);
+        useqring_set_head(&upipe_rtcpfb->queue, seqnum + 1);
         uref_free(uref);
     }
 }
@@ -547,6 +525,14 @@ static struct upipe *upipe_rtcpfb_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_rtcpfb *upipe_rtcpfb = upipe_rtcpfb_from_upipe(upipe);
+    upipe_rtcpfb->queue_extra = malloc(useqring_sizeof(USEQRING_MAX_SIZE));
+    if (unlikely(upipe_rtcpfb->queue_extra == NULL)) {
+        upipe_rtcpfb_free_void(upipe);
+        return NULL;
+    }
+    useqring_init(&upipe_rtcpfb->queue, USEQRING_MAX_SIZE,
+                  upipe_rtcpfb->queue_extra);
+
     upipe_rtcpfb_init_urefcount(upipe);
     upipe_rtcpfb_init_urefcount_real(upipe);
     upipe_rtcpfb_init_upump_mgr(upipe);
@@ -557,7 +543,6 @@ static struct upipe *upipe_rtcpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtcpfb_init_sub_outputs(upipe);
     upipe_rtcpfb_init_ubuf_mgr(upipe);
     upipe_rtcpfb_init_uref_mgr(upipe);
-    ulist_init(&upipe_rtcpfb->queue);
     upipe_rtcpfb->expected_seqnum = -1;
     upipe_rtcpfb->retrans = 0;
     upipe_rtcpfb->last_seq = UINT_MAX;
@@ -593,17 +578,44 @@ static inline void upipe_rtcpfb_input(struct upipe *upipe, struct uref *uref,
 #endif
     uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
-    uref_attr_set_priv(uref, seqnum);
-
     /* Output packet immediately */
     upipe_rtcpfb_output(upipe, uref_dup(uref), upump_p);
 
     upipe_verbose_va(upipe, "Output & buffer %hu", seqnum);
 
     /* Buffer packet in case retransmission is needed */
-    ulist_add(&upipe_rtcpfb->queue, uref_to_uchain(uref));
+    if (!useqring_count(&upipe_rtcpfb->queue)) {
+        useqring_set_head(&upipe_rtcpfb->queue, seqnum);
+        upipe_rtcpfb->last_seq = seqnum;
+    }
+    switch (useqring_insert(&upipe_rtcpfb->queue, seqnum, uref)) {
+        case USEQRING_INSERTED:
+            break;
+        case USEQRING_LATE:
+            if ((uint16_t)(seqnum - upipe_rtcpfb->last_seq) >= 0x8000) {
+                /* older than the buffered packets */
+                upipe_verbose_va(upipe, "late packet %hu, not buffered",
+                                 seqnum);
+                uref_free(uref);
+                return;
+            }
+            /* newer than the last packet, but too far from the oldest
+             * buffered one */
+            /* fallthrough */
+        case USEQRING_AHEAD:
+            /* forget the oldest packets */
+            useqring_set_head(&upipe_rtcpfb->queue,
+                              seqnum - (upipe_rtcpfb->queue.size - 1));
+            useqring_insert(&upipe_rtcpfb->queue, seqnum, uref);
+            break;
+        default:
+            upipe_verbose_va(upipe, "duplicate packet %hu", seqnum);
+            uref_free(uref);
+            return;
+    }
 
-    upipe_rtcpfb->last_seq = seqnum;
+    if ((uint16_t)(seqnum - upipe_rtcpfb->last_seq) < 0x8000)
+        upipe_rtcpfb->last_seq = seqnum;
 }
 
 /** @internal @This sets the input flow definition.
@@ -700,12 +712,8 @@ static void upipe_rtcpfb_free(struct upipe *upipe)
     upipe_rtcpfb_clean_upump_mgr(upipe);
     upipe_rtcpfb_clean_uclock(upipe);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtcpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    useqring_clean(&upipe_rtcpfb->queue);
+    free(upipe_rtcpfb->queue_extra);
 
     upipe_rtcpfb_free_void(upipe);
 }
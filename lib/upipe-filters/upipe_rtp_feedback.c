@@ -33,6 +33,7 @@
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_flow.h>
 #include <upipe/upipe.h>
+#include <upipe/useqring.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -90,7 +91,10 @@ struct upipe_rtpfb {
     struct upump *upump_timer_lost;
     struct uclock *uclock;
     struct urequest uclock_request;
-    struct uchain queue;
+    /** packets not output yet, indexed by sequence number */
+    struct useqring queue;
+    /** extra space for the queue */
+    void *queue_extra;
     struct uprobe *uprobe;
 
     /** expected sequence number */
@@ -383,8 +387,6 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
 
-    uint64_t expected_seq = UINT64_MAX;
-
     uint64_t rtt = _upipe_rtpfb_get_rtt(upipe);
 
     uint64_t now = uclock_now(upipe_rtpfb->uclock);
@@ -397,52 +399,54 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
      * XXX: use cr_sys, because pkts/s also accounts for
      * the retransmitted packets */
 
-    struct uchain *uchain;
     int holes = 0;
-    ulist_foreach(&upipe_rtpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
-
-        if (likely(expected_seq != UINT64_MAX) && seqnum != expected_seq) {
-            /* hole found */
-            uint8_t ssrc[4] = {0,}; // TODO
-            upipe_dbg_va(upipe, "Found hole from %"PRIu64" (incl) to %"PRIu64" (excl)",
-                expected_seq, seqnum);
-
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                /* if packet was lost, we should have detected it already */
-                if (upipe_rtpfb->last_nack[seq] == 0) {
-                    upipe_err_va(upipe, "packet %hu missing but was not marked as lost!", seq);
-                    continue;
-                }
-
-                /* if we sent a NACK not too long ago, do not repeat it */
-                /* since NACKs are sent in a batch, break loop if the first packet is too early */
-                if (upipe_rtpfb->last_nack[seq] > next_nack) {
-                    if (0) upipe_err_va(upipe, "Cancelling NACK due to RTT (seq %hu diff %"PRId64"",
-                        seq, next_nack - upipe_rtpfb->last_nack[seq]
-                    );
-                    goto next;
-                }
+    uint16_t from, lost, seqnum;
+    if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX) ||
+        !useqring_next(&upipe_rtpfb->queue,
+                       useqring_head(&upipe_rtpfb->queue), &from))
+        return;
+
+    while (useqring_next_missing(&upipe_rtpfb->queue, from,
+                                 upipe_rtpfb->expected_seqnum, &lost) &&
+           useqring_next(&upipe_rtpfb->queue, lost, &seqnum)) {
+        from = seqnum;
+
+        /* hole found */
+        uint8_t ssrc[4] = {0,}; // TODO
+        upipe_dbg_va(upipe, "Found hole from %hu (incl) to %hu (excl)",
+            lost, seqnum);
+
+        for (uint16_t seq = lost; seq != seqnum; seq++) {
+            /* if packet was lost, we should have detected it already */
+            if (upipe_rtpfb->last_nack[seq] == 0) {
+                upipe_err_va(upipe, "packet %hu missing but was not marked as lost!", seq);
+                continue;
             }
 
-            /* update NACK request time */
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                upipe_rtpfb->last_nack[seq] = now;
+            /* if we sent a NACK not too long ago, do not repeat it */
+            /* since NACKs are sent in a batch, break loop if the first packet is too early */
+            if (upipe_rtpfb->last_nack[seq] > next_nack) {
+                if (0) upipe_err_va(upipe, "Cancelling NACK due to RTT (seq %hu diff %"PRId64"",
+                    seq, next_nack - upipe_rtpfb->last_nack[seq]
+                );
+                goto next;
             }
+        }
 
-            /* TODO:
-                - check the following packets to fill in bitmask
-                - send request in a single batch (multiple FCI)
-             */
-            if (upipe_rtpfb->rtpfb_output)
-                upipe_rtpfb_output_lost(upipe_rtpfb->rtpfb_output, expected_seq, seqnum, ssrc);
-            holes++;
+        /* update NACK request time */
+        for (uint16_t seq = lost; seq != seqnum; seq++) {
+            upipe_rtpfb->last_nack[seq] = now;
         }
 
+        /* TODO:
+            - check the following packets to fill in bitmask
+            - send request in a single batch (multiple FCI)
+         */
+        if (upipe_rtpfb->rtpfb_output)
+            upipe_rtpfb_output_lost(upipe_rtpfb->rtpfb_output, lost, seqnum, ssrc);
+        holes++;
 next:
-        expected_seq = (seqnum + 1) & UINT16_MAX;
+        ;
     }
 
     if (holes) { /* debug stats */
@@ -464,13 +468,10 @@ static void upipe_rtpfb_timer(struct upump *upump)
 
     uint64_t now = uclock_now(upipe_rtpfb->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        if (!ubase_check(uref_attr_get_priv(uref, &seqnum))) {
-            upipe_err_va(upipe, "Could not read seqnum from uref");
-        }
+    uint16_t seqnum;
+    while (useqring_next(&upipe_rtpfb->queue,
+                         useqring_head(&upipe_rtpfb->queue), &seqnum)) {
+        struct uref *uref = useqring_peek(&upipe_rtpfb->queue, seqnum);
 
         uint64_t cr_sys = 0;
         if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
@@ -479,19 +480,20 @@ static void upipe_rtpfb_timer(struct upump *upump)
         if (now - cr_sys <= upipe_rtpfb->latency)
             break;
 
-        upipe_verbose_va(upipe, "Output seq %"PRIu64" after %"PRIu64" clocks", seqnum, now - cr_sys);
+        upipe_verbose_va(upipe, "Output seq %hu after %"PRIu64" clocks", seqnum, now - cr_sys);
         if (likely(upipe_rtpfb->last_output_seqnum != UINT_MAX)) {
             uint16_t diff = seqnum - upipe_rtpfb->last_output_seqnum - 1;
             if (diff) {
                 upipe_rtpfb->loss += diff;
-                upipe_dbg_va(upipe, "PKT LOSS: %u -> %"PRIu64" DIFF %hu",
+                upipe_dbg_va(upipe, "PKT LOSS: %u -> %hu DIFF %hu",
                         upipe_rtpfb->last_output_seqnum, seqnum, diff);
             }
         }
 
         upipe_rtpfb->last_output_seqnum = seqnum;
 
-        ulist_delete(uchain);
+        useqring_remove(&upipe_rtpfb->queue, seqnum);
+        useqring_set_head(&upipe_rtpfb->queue, seqnum + 1);
         upipe_rtpfb_output(upipe, uref, NULL); // XXX: use timer upump ?
         if (--upipe_rtpfb->buffered == 0) {
             upipe_warn_va(upipe, "Exhausted buffer");
@@ -747,6 +749,14 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
+    upipe_rtpfb->queue_extra = malloc(useqring_sizeof(USEQRING_MAX_SIZE));
+    if (unlikely(upipe_rtpfb->queue_extra == NULL)) {
+        upipe_rtpfb_free_void(upipe);
+        return NULL;
+    }
+    useqring_init(&upipe_rtpfb->queue, USEQRING_MAX_SIZE,
+                  upipe_rtpfb->queue_extra);
+
     upipe_rtpfb_init_urefcount(upipe);
     upipe_rtpfb_init_urefcount_real(upipe);
     upipe_rtpfb_init_output(upipe);
@@ -758,7 +768,6 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtpfb_init_upump_timer(upipe);
     upipe_rtpfb_init_upump_timer_lost(upipe);
     upipe_rtpfb_init_uclock(upipe);
-    ulist_init(&upipe_rtpfb->queue);
     memset(upipe_rtpfb->last_nack, 0, sizeof(upipe_rtpfb->last_nack));
     upipe_rtpfb->rtt = 0;
     upipe_rtpfb_require_uclock(upipe);
@@ -777,76 +786,75 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This outputs the oldest packets until a sequence number fits
+ * in the queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param seqnum sequence number to make room for
+ */
+static void upipe_rtpfb_make_room(struct upipe *upipe, uint16_t seqnum)
+{
+    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
+    uint16_t head = seqnum - (upipe_rtpfb->queue.size - 1);
+    uint16_t first;
+
+    while (useqring_next(&upipe_rtpfb->queue,
+                         useqring_head(&upipe_rtpfb->queue), &first) &&
+           (uint16_t)(first - head) >= 0x8000) {
+        struct uref *uref = useqring_remove(&upipe_rtpfb->queue, first);
+        useqring_set_head(&upipe_rtpfb->queue, first + 1);
+        upipe_rtpfb->last_output_seqnum = first;
+        upipe_rtpfb->buffered--;
+        upipe_rtpfb_output(upipe, uref, NULL);
+    }
+    useqring_set_head(&upipe_rtpfb->queue, head);
+}
+
 /* returns true if uref was inserted in the queue */
-static bool upipe_rtpfb_insert_inner(struct upipe *upipe, struct uref *uref,
-        const uint16_t seqnum, struct uref *next)
+static bool upipe_rtpfb_insert(struct upipe *upipe, struct uref *uref, const uint16_t seqnum)
 {
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-    uint64_t next_seqnum = 0;
-    uref_attr_get_priv(next, &next_seqnum);
 
-    uint16_t diff = seqnum - next_seqnum;
-    if (!diff) {
-        upipe_verbose_va(upipe, "dropping duplicate %hu", seqnum);
-        upipe_rtpfb->dups++;
-        uref_free(uref);
-        return true;
+    switch (useqring_insert(&upipe_rtpfb->queue, seqnum, uref)) {
+        case USEQRING_INSERTED:
+            break;
+        case USEQRING_DUPLICATE:
+            upipe_verbose_va(upipe, "dropping duplicate %hu", seqnum);
+            upipe_rtpfb->dups++;
+            uref_free(uref);
+            return true;
+        default:
+            return false;
     }
 
-    /* browse the list until we find a seqnum bigger than ours */
-    if (diff < 0x8000) // seqnum > next_seqnum
+    /* a later packet is always queued since expected_seqnum was bumped */
+    uint16_t next_seqnum;
+    if (unlikely(!useqring_next(&upipe_rtpfb->queue, seqnum + 1,
+                                &next_seqnum))) {
+        useqring_remove(&upipe_rtpfb->queue, seqnum);
         return false;
-
-    /* if there's no previous packet we're too late */
-    struct uchain *uchain = uref_to_uchain(next);
-    if (unlikely(ulist_is_first(&upipe_rtpfb->queue, uchain))) {
-        upipe_dbg_va(upipe,
-                "LATE packet drop: Expected %u, got %hu, didn't insert after %"PRIu64,
-                upipe_rtpfb->expected_seqnum, seqnum, next_seqnum);
-        uref_free(uref);
-        return true;
     }
 
-    /* Read previous packet seq & cr_sys */
-    uint64_t prev_seqnum = 0, cr_sys = 0;
-
-    struct uref *prev = uref_from_uchain(uchain->prev);
-    uref_attr_get_priv(prev, &prev_seqnum);
-
-    /* overwrite this uref' cr_sys with previous one's
+    /* overwrite this uref' cr_sys with the next one's
      * so it get scheduled at the right time */
-    if (ubase_check(uref_clock_get_cr_sys(prev, &cr_sys)))
+    uint64_t cr_sys = 0;
+    struct uref *next = useqring_peek(&upipe_rtpfb->queue, next_seqnum);
+    if (ubase_check(uref_clock_get_cr_sys(next, &cr_sys)))
         uref_clock_set_cr_sys(uref, cr_sys);
     else
         upipe_err_va(upipe, "Couldn't read cr_sys in %s() - %zu buffered",
                 __func__, upipe_rtpfb->buffered);
 
     upipe_rtpfb->buffered++;
-    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
     upipe_rtpfb->repaired++;
     upipe_rtpfb->last_nack[seqnum] = 0;
 
-    upipe_dbg_va(upipe, "Repaired %"PRIu64" > %hu > %"PRIu64" -diff %d",
-            prev_seqnum, seqnum, next_seqnum, -diff);
+    upipe_dbg_va(upipe, "Repaired %hu > %hu",
+            seqnum, next_seqnum);
 
     return true;
 }
 
-static bool upipe_rtpfb_insert(struct upipe *upipe, struct uref *uref, const uint16_t seqnum)
-{
-    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *next = uref_from_uchain(uchain);
-        if (upipe_rtpfb_insert_inner(upipe, uref, seqnum, next))
-            return true;
-    }
-
-    /* Could not insert packet */
-    return false;
-}
-
 /** @internal @This handles RTCP data.
  *
  * @param upipe description structure of the pipe
@@ -990,19 +998,24 @@ static void upipe_rtpfb_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
-    /* store seqnum in uref */
-    uref_attr_set_priv(uref, seqnum);
-
     /* first packet */
-    if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX))
+    if (unlikely(upipe_rtpfb->expected_seqnum == UINT_MAX)) {
         upipe_rtpfb->expected_seqnum = seqnum;
+        useqring_set_head(&upipe_rtpfb->queue, seqnum);
+    }
 
     uint16_t diff = seqnum - upipe_rtpfb->expected_seqnum;
 
     if (diff < 0x8000) { // seqnum > last seq, insert at the end
         /* packet is from the future */
+        if (unlikely(useqring_insert(&upipe_rtpfb->queue, seqnum, uref) ==
+                     USEQRING_AHEAD)) {
+            upipe_warn_va(upipe, "queue full, forcing output before %hu",
+                          seqnum);
+            upipe_rtpfb_make_room(upipe, seqnum);
+            useqring_insert(&upipe_rtpfb->queue, seqnum, uref);
+        }
         upipe_rtpfb->buffered++;
-        ulist_add(&upipe_rtpfb->queue, uref_to_uchain(uref));
         upipe_rtpfb->last_nack[seqnum] = 0;
 
         if (diff != 0) {
@@ -1022,12 +1035,10 @@ static void upipe_rtpfb_input(struct upipe *upipe, struct uref *uref,
     if (upipe_rtpfb_insert(upipe, uref, seqnum))
         return;
 
-    uint64_t first_seq = 0, last_seq = 0;
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.next), &first_seq);
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.prev), &last_seq);
     // XXX : when much too late, it could mean RTP source restart
-    upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %"PRIu64" -> %"PRIu64")",
-            seqnum, first_seq, last_seq);
+    upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %hu -> %u)",
+            seqnum, useqring_head(&upipe_rtpfb->queue),
+            (upipe_rtpfb->expected_seqnum - 1) & UINT16_MAX);
     uref_free(uref);
 }
 
@@ -1174,12 +1185,8 @@ static void upipe_rtpfb_free(struct upipe *upipe)
     upipe_rtpfb_clean_sub_outputs(upipe);
     uprobe_release(upipe_rtpfb->uprobe);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    useqring_clean(&upipe_rtpfb->queue);
+    free(upipe_rtpfb->queue_extra);
 
     upipe_rtpfb_free_void(upipe);
 }
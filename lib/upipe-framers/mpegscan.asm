@@ -0,0 +1,69 @@
+;******************************************************************************
+;* MPEG start code scanning
+;* Copyright (C) 2026 OpenHeadend S.A.R.L.
+;*
+;* This program is free software; you can redistribute it and/or modify it
+;* under the terms of the GNU Lesser General Public License as published by
+;* the Free Software Foundation; either version 2.1 of the License, or
+;* (at your option) any later version.
+;*
+;* This program is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+;* GNU Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public License
+;* along with this program; if not, write to the Free Software Foundation,
+;* Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION_RODATA 32
+
+pb_1: times 32 db 1
+
+SECTION .text
+
+%if ARCH_X86_64
+
+%macro mpeg_scan 0
+
+; mpeg_scan(const uint8_t *src, ptrdiff_t len)
+cglobal mpeg_scan, 2, 4, 4, src, len, i, mask
+    pxor    m3, m3
+    mova    m2, [pb_1]
+    xor     id, id
+
+.loop:
+    movu    m0, [srcq + iq]
+    movu    m1, [srcq + iq + 1]
+    por     m0, m1
+    movu    m1, [srcq + iq + 2]
+    pcmpeqb m0, m3
+    pcmpeqb m1, m2
+    pand    m0, m1
+    pmovmskb maskd, m0
+    test    maskd, maskd
+    jnz     .found
+    add     iq, mmsize
+    cmp     iq, lenq
+    jl      .loop
+
+    mov     rax, lenq
+    RET
+
+.found:
+    bsf     maskd, maskd
+    lea     rax, [iq + maskq]
+    RET
+
+%endmacro
+
+INIT_XMM sse2
+mpeg_scan
+
+INIT_YMM avx2
+mpeg_scan
+
+%endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short MPEG start code scanning kernels
+ */
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "mpegscan.h"
+
+ptrdiff_t upipe_mpeg_scan_c(const uint8_t *src, ptrdiff_t len)
+{
+    /* skips from libav/libavcodec/mpegvideo.c */
+    ptrdiff_t i = 0;
+    while (i < len) {
+        if      (src[i + 2] > 1             ) i += 3;
+        else if (src[i + 1]                 ) i += 2;
+        else if (src[i] | (src[i + 2] - 1)  ) i++;
+        else
+            return i;
+    }
+    return len;
+}
+
+#if defined(__aarch64__)
+ptrdiff_t upipe_mpeg_scan_neon(const uint8_t *src, ptrdiff_t len)
+{
+    const uint8x16_t one = vdupq_n_u8(1);
+    for (ptrdiff_t i = 0; i < len; i += 16) {
+        uint8x16_t zero = vceqzq_u8(vorrq_u8(vld1q_u8(src + i),
+                                             vld1q_u8(src + i + 1)));
+        uint8x16_t found = vandq_u8(zero, vceqq_u8(vld1q_u8(src + i + 2), one));
+        if (!vmaxvq_u8(found))
+            continue;
+
+        uint64x2_t mask = vreinterpretq_u64_u8(found);
+        uint64_t low = vgetq_lane_u64(mask, 0);
+        if (low)
+            return i + (__builtin_ctzll(low) >> 3);
+        return i + 8 + (__builtin_ctzll(vgetq_lane_u64(mask, 1)) >> 3);
+    }
+    return len;
+}
+#endif
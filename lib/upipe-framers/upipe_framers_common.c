@@ -24,10 +24,35 @@
  * @short Upipe common utils for framers
  */
 
+#include <config.h>
+
 #include <stdint.h>
 
 #include <upipe-framers/upipe_framers_common.h>
 
+#include "mpegscan.h"
+
+#if (defined(HAVE_X86ASM) && defined(__x86_64__)) || defined(__aarch64__)
+/** @internal @This runs the best SIMD start code scanner for the CPU.
+ *
+ * @param src linear buffer
+ * @param len number of positions to test, multiple of
+ * @ref UPIPE_MPEG_SCAN_ALIGN
+ * @return offset of the start code, or len if not found
+ */
+static inline ptrdiff_t upipe_framers_mpeg_scan_simd(const uint8_t *src,
+                                                     ptrdiff_t len)
+{
+#if defined(__aarch64__)
+    return upipe_mpeg_scan_neon(src, len);
+#else
+    if (__builtin_cpu_supports("avx2"))
+        return upipe_mpeg_scan_avx2(src, len);
+    return upipe_mpeg_scan_sse2(src, len);
+#endif
+}
+#endif
+
 /** @This scans for an MPEG-style 3-octet start code in a linear buffer.
  *
  * @param p linear buffer
@@ -48,16 +73,20 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
             return p;
     }
 
-    while (p < end) {
-        if      (p[-1] > 1      ) p += 3;
-        else if (p[-2]          ) p += 2;
-        else if (p[-3]|(p[-1]-1)) p++;
-        else {
-            p++;
-            break;
-        }
-    }
+    /* look for 00 00 01 starting with the three octets before p */
+    const uint8_t *src = p - 3;
+    ptrdiff_t len = end - src - 2;
+    ptrdiff_t offset = 0;
+#if (defined(HAVE_X86ASM) && defined(__x86_64__)) || defined(__aarch64__)
+    ptrdiff_t simd_len = len & ~(ptrdiff_t)(UPIPE_MPEG_SCAN_ALIGN - 1);
+    if (simd_len)
+        offset = upipe_framers_mpeg_scan_simd(src, simd_len);
+    if (offset == simd_len)
+#endif
+        offset += upipe_mpeg_scan_c(src + offset, len - offset);
 
+    /* return the octet following the start code */
+    p = src + offset + 4;
     if (p > end)
         p = end;
     *state = ((uint32_t)p[-4] << 24) | (p[-3] << 16) | (p[-2] << 8) | p[-1];
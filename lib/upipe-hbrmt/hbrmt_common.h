@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short common definitions for SMPTE 2022-6 and 2110-20 RTP payloads
+ */
+
+#ifndef _UPIPE_HBRMT_HBRMT_COMMON_H_
+/** @hidden */
+#define _UPIPE_HBRMT_HBRMT_COMMON_H_
+
+#include <upipe/ubase.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_clock.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bitstream/ietf/rtp.h>
+
+/*
+ * SMPTE 2022-6
+ */
+
+/** RTP payload type of HBRMT */
+#define HBRMT_RTP_TYPE 98
+/** RTP clock rate of HBRMT */
+#define HBRMT_CLOCKRATE 27000000
+/** size of the HBRMT payload header */
+#define HBRMT_HEADER_SIZE 8
+/** size of the media payload of every HBRMT datagram */
+#define HBRMT_DATA_SIZE 1376
+/** SAMPLE code for 4:2:2 10 bits */
+#define HBRMT_SAMPLE_422_10 0x1
+
+/** @This initializes an HBRMT header, with the video source format
+ * present. */
+static inline void hbrmt_set_hdr(uint8_t *p)
+{
+    memset(p, 0, HBRMT_HEADER_SIZE);
+    p[0] = 0x08;
+}
+
+/** @This returns the Ext field of an HBRMT header. */
+static inline uint8_t hbrmt_get_ext(const uint8_t *p)
+{
+    return p[0] >> 4;
+}
+
+/** @This checks whether the video source format fields are present. */
+static inline bool hbrmt_check_video_source_format(const uint8_t *p)
+{
+    return p[0] & 0x08;
+}
+
+/** @This sets the frame counter of an HBRMT header. */
+static inline void hbrmt_set_frcount(uint8_t *p, uint8_t frcount)
+{
+    p[1] = frcount;
+}
+
+/** @This returns the frame counter of an HBRMT header. */
+static inline uint8_t hbrmt_get_frcount(const uint8_t *p)
+{
+    return p[1];
+}
+
+/** @This sets the FRAME field of an HBRMT header. */
+static inline void hbrmt_set_frame(uint8_t *p, uint8_t frame)
+{
+    p[4] = (p[4] & 0xf0) | (frame >> 4);
+    p[5] = (p[5] & 0x0f) | (frame << 4);
+}
+
+/** @This returns the FRAME field of an HBRMT header. */
+static inline uint8_t hbrmt_get_frame(const uint8_t *p)
+{
+    return (p[4] << 4) | (p[5] >> 4);
+}
+
+/** @This sets the FRATE field of an HBRMT header. */
+static inline void hbrmt_set_frate(uint8_t *p, uint8_t frate)
+{
+    p[5] = (p[5] & 0xf0) | (frate >> 4);
+    p[6] = (p[6] & 0x0f) | (frate << 4);
+}
+
+/** @This returns the FRATE field of an HBRMT header. */
+static inline uint8_t hbrmt_get_frate(const uint8_t *p)
+{
+    return (p[5] << 4) | (p[6] >> 4);
+}
+
+/** @This sets the SAMPLE field of an HBRMT header. */
+static inline void hbrmt_set_sample(uint8_t *p, uint8_t sample)
+{
+    p[6] = (p[6] & 0xf0) | (sample & 0xf);
+}
+
+/** @This returns the SAMPLE field of an HBRMT header. */
+static inline uint8_t hbrmt_get_sample(const uint8_t *p)
+{
+    return p[6] & 0xf;
+}
+
+/** @This describes an SDI raster carried by HBRMT. */
+struct hbrmt_format {
+    /** FRAME code */
+    uint8_t frame;
+    /** FRATE code (field rate for interlaced rasters) */
+    uint8_t frate;
+    /** active width */
+    uint64_t hsize;
+    /** active height */
+    uint64_t vsize;
+    /** true if the raster is progressive */
+    bool progressive;
+    /** total number of pixels per line */
+    unsigned int total_hsize;
+    /** total number of lines */
+    unsigned int total_vsize;
+    /** frame rate */
+    struct urational fps;
+};
+
+/** @This lists the rasters supported by HBRMT. */
+static const struct hbrmt_format hbrmt_formats[] = {
+    { 0x10, 0x11,  720,  486, false,  858,  525, { 30000, 1001 } },
+    { 0x11, 0x12,  720,  576, false,  864,  625, {    25,    1 } },
+    { 0x20, 0x10, 1920, 1080, false, 2200, 1125, {    30,    1 } },
+    { 0x20, 0x11, 1920, 1080, false, 2200, 1125, { 30000, 1001 } },
+    { 0x20, 0x12, 1920, 1080, false, 2640, 1125, {    25,    1 } },
+    { 0x21, 0x10, 1920, 1080,  true, 2200, 1125, {    60,    1 } },
+    { 0x21, 0x11, 1920, 1080,  true, 2200, 1125, { 60000, 1001 } },
+    { 0x21, 0x12, 1920, 1080,  true, 2640, 1125, {    50,    1 } },
+    { 0x21, 0x16, 1920, 1080,  true, 2200, 1125, {    30,    1 } },
+    { 0x21, 0x17, 1920, 1080,  true, 2200, 1125, { 30000, 1001 } },
+    { 0x21, 0x18, 1920, 1080,  true, 2640, 1125, {    25,    1 } },
+    { 0x21, 0x1a, 1920, 1080,  true, 2750, 1125, {    24,    1 } },
+    { 0x21, 0x1b, 1920, 1080,  true, 2750, 1125, { 24000, 1001 } },
+    { 0x30, 0x10, 1280,  720,  true, 1650,  750, {    60,    1 } },
+    { 0x30, 0x11, 1280,  720,  true, 1650,  750, { 60000, 1001 } },
+    { 0x30, 0x12, 1280,  720,  true, 1980,  750, {    50,    1 } },
+    { 0x30, 0x16, 1280,  720,  true, 3300,  750, {    30,    1 } },
+    { 0x30, 0x17, 1280,  720,  true, 3300,  750, { 30000, 1001 } },
+    { 0x30, 0x18, 1280,  720,  true, 3960,  750, {    25,    1 } },
+    { 0x30, 0x1a, 1280,  720,  true, 4125,  750, {    24,    1 } },
+    { 0x30, 0x1b, 1280,  720,  true, 4125,  750, { 24000, 1001 } },
+};
+
+/** @This returns the raster matching HBRMT codes.
+ *
+ * @param frame FRAME code
+ * @param frate FRATE code
+ * @return pointer to the format, or NULL if unsupported
+ */
+static inline const struct hbrmt_format *hbrmt_format_from_codes(
+        uint8_t frame, uint8_t frate)
+{
+    for (unsigned i = 0; i < UBASE_ARRAY_SIZE(hbrmt_formats); i++)
+        if (hbrmt_formats[i].frame == frame && hbrmt_formats[i].frate == frate)
+            return &hbrmt_formats[i];
+    return NULL;
+}
+
+/** @This returns the raster matching picture attributes.
+ *
+ * @param hsize active width
+ * @param vsize active height
+ * @param fps frame rate
+ * @param progressive true if the picture is progressive
+ * @return pointer to the format, or NULL if unsupported
+ */
+static inline const struct hbrmt_format *hbrmt_format_from_pic(
+        uint64_t hsize, uint64_t vsize, struct urational fps, bool progressive)
+{
+    for (unsigned i = 0; i < UBASE_ARRAY_SIZE(hbrmt_formats); i++)
+        if (hbrmt_formats[i].hsize == hsize &&
+            hbrmt_formats[i].vsize == vsize &&
+            hbrmt_formats[i].progressive == progressive &&
+            !urational_cmp(&hbrmt_formats[i].fps, &fps))
+            return &hbrmt_formats[i];
+    return NULL;
+}
+
+/** @This returns the size of a packed 10-bit 4:2:2 raster.
+ *
+ * @param format raster description
+ * @return size in octets
+ */
+static inline size_t hbrmt_format_size(const struct hbrmt_format *format)
+{
+    return (size_t)format->total_hsize * format->total_vsize * 5 / 2;
+}
+
+/*
+ * SMPTE 2110-20
+ */
+
+/** RTP payload type used for 2110-20 (dynamic) */
+#define RFC4175_RTP_TYPE 96
+/** RTP clock rate of 2110-20 */
+#define RFC4175_CLOCKRATE 90000
+/** size of the extended sequence number */
+#define RFC4175_HEADER_SIZE 2
+/** size of a sample row data header */
+#define RFC4175_SRD_SIZE 6
+/** size of a 4:2:2 10-bit pgroup */
+#define RFC4175_PGROUP_SIZE 5
+/** number of pixels in a 4:2:2 10-bit pgroup */
+#define RFC4175_PGROUP_PIXELS 2
+/** chroma of the picture plane (16-bit samples, 2 pixels per macropixel) */
+#define RFC4175_CHROMA "u10y10v10y10"
+/** alignment of the picture lines required by the SIMD kernels */
+#define RFC4175_ALIGN 32
+
+/** @This sets the extended sequence number. */
+static inline void rfc4175_set_ext_seqnum(uint8_t *p, uint16_t seqnum)
+{
+    p[0] = seqnum >> 8;
+    p[1] = seqnum;
+}
+
+/** @This returns the extended sequence number. */
+static inline uint16_t rfc4175_get_ext_seqnum(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/** @This writes a sample row data header.
+ *
+ * @param p pointer to the SRD
+ * @param length length of the segment in octets
+ * @param field second field flag
+ * @param row line number in the field
+ * @param offset offset of the first pixel in the line
+ * @param cont true if another SRD follows
+ */
+static inline void rfc4175_set_srd(uint8_t *p, uint16_t length, bool field,
+                                   uint16_t row, uint16_t offset, bool cont)
+{
+    p[0] = length >> 8;
+    p[1] = length;
+    p[2] = (field ? 0x80 : 0) | ((row >> 8) & 0x7f);
+    p[3] = row;
+    p[4] = (cont ? 0x80 : 0) | ((offset >> 8) & 0x7f);
+    p[5] = offset;
+}
+
+/** @This returns the length of a sample row data segment. */
+static inline uint16_t rfc4175_get_srd_length(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/** @This returns the field flag of a sample row data header. */
+static inline bool rfc4175_get_srd_field(const uint8_t *p)
+{
+    return p[2] & 0x80;
+}
+
+/** @This returns the line number of a sample row data header. */
+static inline uint16_t rfc4175_get_srd_row(const uint8_t *p)
+{
+    return ((p[2] & 0x7f) << 8) | p[3];
+}
+
+/** @This returns the pixel offset of a sample row data header. */
+static inline uint16_t rfc4175_get_srd_offset(const uint8_t *p)
+{
+    return ((p[4] & 0x7f) << 8) | p[5];
+}
+
+/** @This checks the continuation flag of a sample row data header. */
+static inline bool rfc4175_check_srd_continuation(const uint8_t *p)
+{
+    return p[4] & 0x80;
+}
+
+/*
+ * common RTP helpers
+ */
+
+/** @This returns the offset of the payload in an RTP packet.
+ *
+ * @param p pointer to the RTP header
+ * @param size size of the packet
+ * @return offset of the payload, or -1 if the packet is invalid
+ */
+static inline int hbrmt_rtp_payload_offset(const uint8_t *p, size_t size)
+{
+    if (size < RTP_HEADER_SIZE || !rtp_check_hdr(p))
+        return -1;
+    size_t offset = RTP_HEADER_SIZE + 4 * rtp_get_cc(p);
+    if (rtp_check_extension(p)) {
+        if (offset + 4 > size)
+            return -1;
+        offset += 4 + 4 * ((p[offset + 2] << 8) | p[offset + 3]);
+    }
+    return offset <= size ? offset : -1;
+}
+
+/** @This returns the RTP timestamp of a uref, synced to the program
+ * presentation date with a fallback to the system date.
+ *
+ * @param uref uref structure
+ * @param clockrate RTP clock rate
+ * @param delay delay to add to the date, in units of the uclock
+ * @return RTP timestamp
+ */
+static inline uint32_t hbrmt_rtp_timestamp(struct uref *uref,
+                                           uint64_t clockrate, uint64_t delay)
+{
+    uint64_t pts = 0;
+    if (unlikely(!ubase_check(uref_clock_get_pts_prog(uref, &pts))))
+        uref_clock_get_pts_sys(uref, &pts);
+    pts += delay;
+
+    lldiv_t div = lldiv(pts, UCLOCK_FREQ);
+    return div.quot * clockrate + ((uint64_t)div.rem * clockrate) / UCLOCK_FREQ;
+}
+
+#endif
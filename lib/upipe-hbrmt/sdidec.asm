@@ -21,7 +21,11 @@
 
 %include "x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
+
+; spreads 5 words to each lane
+sdi_dec_perm_10: dw  0,  1,  2,  3,  4,  0,  0,  0,  5,  6,  7,  8,  9,  0,  0,  0
+                 dw 10, 11, 12, 13, 14,  0,  0,  0, 15, 16, 17, 18, 19,  0,  0,  0
 
 sdi_comp_mask_10:  times 2 db 0xff, 0xc0, 0xf,  0xfc, 0x0,  0xff, 0xc0, 0xf,  0xfc, 0x0,  0x0, 0x0, 0x0, 0x0, 0x0, 0x0
 
@@ -76,3 +80,73 @@ INIT_XMM ssse3
 sdi_to_uyvy
 INIT_YMM avx2
 sdi_to_uyvy
+
+; The AVX-512 version reads 40 octets per iteration with a masked load and
+; spreads them to the 4 lanes with vpermw. A last group of 8 pixels or fewer
+; is processed with ymm registers, so that the same number of pixels is read
+; and written as with the AVX2 version.
+
+%if ARCH_X86_64
+INIT_ZMM avx512
+cglobal sdi_to_uyvy, 3, 4, 8, src, y, pixels, tmp
+    lea yq,     [yq + 4*pixelsq]
+    neg pixelsq
+
+    vbroadcasti32x4 m2, [sdi_comp_mask_10]
+    vbroadcasti32x4 m3, [sdi_chroma_shuf_10]
+    vbroadcasti32x4 m4, [sdi_luma_shuf_10]
+    vbroadcasti32x4 m5, [sdi_chroma_mult_10]
+    vbroadcasti32x4 m6, [sdi_luma_mult_10]
+    mova     m7, [sdi_dec_perm_10]
+    mov    tmpd, 0xfffff
+    kmovd    k1, tmpd
+    mov    tmpd, 0x3ff
+    kmovd    k2, tmpd
+
+    cmp pixelsq, -8
+    jge .last
+
+.loop:
+    vmovdqu16 m0{k1}{z}, [srcq]
+    vpermw   m0, m7, m0
+
+    pandn    m1, m2, m0
+    pand     m0, m2
+
+    pshufb   m0, m3
+    pshufb   m1, m4
+
+    pmulhuw  m0, m5
+    pmulhrsw m1, m6
+
+    por      m0, m1
+
+    movu     [yq + 4*pixelsq], m0
+
+    add    srcq, (mmsize*5)/8
+    add pixelsq, mmsize/4
+    cmp pixelsq, -8
+    jl .loop
+    test pixelsq, pixelsq
+    jge .end
+
+.last:
+    vmovdqu16 ym0{k2}{z}, [srcq]
+    vpermw   ym0, ym7, ym0
+
+    pandn    ym1, ym2, ym0
+    pand     ym0, ym2
+
+    pshufb   ym0, ym3
+    pshufb   ym1, ym4
+
+    pmulhuw  ym0, ym5
+    pmulhrsw ym1, ym6
+
+    por      ym0, ym1
+
+    movu     [yq + 4*pixelsq], ym0
+
+.end:
+    RET
+%endif
@@ -21,7 +21,11 @@
 
 %include "x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
+
+; gathers the 5 words packed in each lane
+sdi_enc_perm_10: dw  0,  1,  2,  3,  4,  8,  9, 10, 11, 12, 16, 17, 18, 19, 20, 24
+                 dw 25, 26, 27, 28,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
 
 sdi_enc_mult_10: times 4 dw 64, 16, 4, 1
 sdi_chroma_shuf_10: times 2 db 1, 0, 5, 4, -1, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1
@@ -63,3 +67,52 @@ INIT_XMM avx
 uyvy_to_sdi
 INIT_YMM avx2
 uyvy_to_sdi
+
+; The AVX-512 version packs 16 pixels per iteration and compacts the 4 lanes
+; with vpermw, so that the output is written without overlapping stores. A
+; last group of 8 pixels or fewer is processed with ymm registers, so that the
+; same number of pixels is read and written as with the AVX2 version.
+
+%if ARCH_X86_64
+INIT_ZMM avx512
+cglobal uyvy_to_sdi, 3, 4, 6, dst, y, pixels, tmp
+    lea     yq, [yq + 4*pixelsq]
+    neg     pixelsq
+    vbroadcasti32x4 m2, [sdi_enc_mult_10]
+    vbroadcasti32x4 m3, [sdi_chroma_shuf_10]
+    vbroadcasti32x4 m4, [sdi_luma_shuf_10]
+    mova    m5, [sdi_enc_perm_10]
+    mov     tmpd, 0xfffff
+    kmovd   k1, tmpd
+    mov     tmpd, 0x3ff
+    kmovd   k2, tmpd
+
+    cmp     pixelsq, -8
+    jge .last
+
+.loop:
+    pmullw  m0, m2, [yq+4*pixelsq]
+    pshufb  m1, m0, m3
+    pshufb  m0, m4
+    por     m0, m1
+    vpermw  m0, m5, m0
+    vmovdqu16 [dstq]{k1}, m0
+
+    add     dstq, (mmsize*5)/8
+    add     pixelsq, mmsize/4
+    cmp     pixelsq, -8
+    jl .loop
+    test    pixelsq, pixelsq
+    jge .end
+
+.last:
+    pmullw  ym0, ym2, [yq+4*pixelsq]
+    pshufb  ym1, ym0, ym3
+    pshufb  ym0, ym4
+    por     ym0, ym1
+    vpermw  ym0, ym5, ym0
+    vmovdqu16 [dstq]{k2}, ym0
+
+.end:
+    RET
+%endif
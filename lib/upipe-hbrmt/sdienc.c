@@ -32,4 +32,8 @@ void upipe_uyvy_to_sdi_c(uint8_t *dst, const uint8_t *y, int64_t pixels)
 
     for (int i = 0; i < size; i ++)
         ubits_put(&s, 10, htons((y[2*i+0] << 8) | y[2*i+1]));
+
+    /* flush the last bits */
+    uint8_t *end;
+    ubits_clean(&s, &end);
 }
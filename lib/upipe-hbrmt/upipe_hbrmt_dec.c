@@ -0,0 +1,555 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-6 depacketizer
+ */
+
+#include <config.h>
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/upipe.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_dump.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/uref_block.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_input.h>
+
+#include <upipe-hbrmt/upipe_hbrmt_dec.h>
+
+#include "hbrmt_common.h"
+
+/** alignment of the output frames (256-bits simd) */
+#define UBUF_ALIGN 32
+/** padding required by unpack10bit */
+#define UBUF_APPEND 12
+
+/** upipe_hbrmt_dec structure */
+struct upipe_hbrmt_dec {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** temporary uref storage (used during urequest) */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers (used during udeal) */
+    struct uchain blockers;
+
+    /** input flow definition */
+    struct uref *flow_def_input;
+    /** raster of the stream */
+    const struct hbrmt_format *format;
+    /** number of datagrams per frame */
+    unsigned int nb_packets;
+
+    /** true if the beginning of a frame has been found */
+    bool synced;
+    /** sequence number of the first datagram of the current frame */
+    uint16_t first_seqnum;
+    /** frame being reassembled */
+    struct uref *uref;
+    /** mapped buffer of the frame being reassembled */
+    uint8_t *buffer;
+    /** number of datagrams received for the current frame */
+    unsigned int nb_received;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static bool upipe_hbrmt_dec_handle(struct upipe *upipe, struct uref *uref,
+                                   struct upump **upump_p);
+/** @hidden */
+static int upipe_hbrmt_dec_check(struct upipe *upipe, struct uref *flow_format);
+
+UPIPE_HELPER_UPIPE(upipe_hbrmt_dec, upipe, UPIPE_HBRMT_DEC_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_hbrmt_dec, urefcount, upipe_hbrmt_dec_free);
+UPIPE_HELPER_VOID(upipe_hbrmt_dec);
+UPIPE_HELPER_OUTPUT(upipe_hbrmt_dec, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UBUF_MGR(upipe_hbrmt_dec, ubuf_mgr, flow_format, ubuf_mgr_request,
+                      upipe_hbrmt_dec_check,
+                      upipe_hbrmt_dec_register_output_request,
+                      upipe_hbrmt_dec_unregister_output_request)
+UPIPE_HELPER_INPUT(upipe_hbrmt_dec, urefs, nb_urefs, max_urefs, blockers, upipe_hbrmt_dec_handle)
+
+/** @internal @This outputs the frame being reassembled.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_hbrmt_dec_output_frame(struct upipe *upipe,
+                                         struct upump **upump_p)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+    struct uref *uref = upipe_hbrmt_dec->uref;
+    if (uref == NULL)
+        return;
+
+    uref_block_unmap(uref, 0);
+    upipe_hbrmt_dec->uref = NULL;
+    upipe_hbrmt_dec->buffer = NULL;
+
+    if (upipe_hbrmt_dec->nb_received != upipe_hbrmt_dec->nb_packets)
+        upipe_warn_va(upipe, "incomplete frame (%u/%u datagrams)",
+                      upipe_hbrmt_dec->nb_received,
+                      upipe_hbrmt_dec->nb_packets);
+    upipe_hbrmt_dec_output(upipe, uref, upump_p);
+}
+
+/** @internal @This drops the frame being reassembled.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hbrmt_dec_flush(struct upipe *upipe)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+    if (upipe_hbrmt_dec->uref != NULL) {
+        uref_block_unmap(upipe_hbrmt_dec->uref, 0);
+        uref_free(upipe_hbrmt_dec->uref);
+        upipe_hbrmt_dec->uref = NULL;
+        upipe_hbrmt_dec->buffer = NULL;
+    }
+}
+
+/** @internal @This allocates the next frame and maps it.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref first datagram of the frame, used for the attributes
+ * @return an error code
+ */
+static int upipe_hbrmt_dec_alloc_frame(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+    size_t size = hbrmt_format_size(upipe_hbrmt_dec->format);
+
+    struct ubuf *ubuf = ubuf_block_alloc(upipe_hbrmt_dec->ubuf_mgr, size);
+    UBASE_ALLOC_RETURN(ubuf);
+    struct uref *frame = uref_fork(uref, ubuf);
+    if (unlikely(frame == NULL)) {
+        ubuf_free(ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int buf_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(frame, 0, &buf_size,
+                                               &upipe_hbrmt_dec->buffer)) ||
+                 buf_size != (int)size)) {
+        uref_free(frame);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_hbrmt_dec->uref = frame;
+    upipe_hbrmt_dec->nb_received = 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This requires a ubuf manager for a new raster.
+ *
+ * @param upipe description structure of the pipe
+ * @param format new raster
+ * @return an error code
+ */
+static int upipe_hbrmt_dec_set_format(struct upipe *upipe,
+                                      const struct hbrmt_format *format)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+
+    upipe_notice_va(upipe, "new raster %"PRIu64"x%"PRIu64"%c %"PRId64"/%"PRIu64,
+                    format->hsize, format->vsize,
+                    format->progressive ? 'p' : 'i',
+                    format->fps.num, format->fps.den);
+
+    upipe_hbrmt_dec_flush(upipe);
+    upipe_hbrmt_dec->format = format;
+    upipe_hbrmt_dec->nb_packets =
+        (hbrmt_format_size(format) + HBRMT_DATA_SIZE - 1) / HBRMT_DATA_SIZE;
+    upipe_hbrmt_dec->synced = false;
+
+    struct uref *flow_def = uref_dup(upipe_hbrmt_dec->flow_def_input);
+    UBASE_ALLOC_RETURN(flow_def);
+    uref_flow_set_def(flow_def, "block.");
+    uref_block_flow_set_align(flow_def, UBUF_ALIGN);
+    uref_block_flow_set_append(flow_def, UBUF_APPEND);
+    uref_pic_flow_set_hsize(flow_def, format->hsize);
+    uref_pic_flow_set_vsize(flow_def, format->vsize);
+    uref_pic_flow_set_fps(flow_def, format->fps);
+    if (format->progressive)
+        uref_pic_set_progressive(flow_def);
+    else
+        uref_pic_delete_progressive(flow_def);
+
+    upipe_hbrmt_dec_store_flow_def(upipe, NULL);
+    upipe_hbrmt_dec_require_ubuf_mgr(upipe, flow_def);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This handles datagrams.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be blocked
+ */
+static bool upipe_hbrmt_dec_handle(struct upipe *upipe, struct uref *uref,
+                                   struct upump **upump_p)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+
+    if (unlikely(upipe_hbrmt_dec->flow_def_input == NULL)) {
+        upipe_warn(upipe, "received buffer without flow definition");
+        uref_free(uref);
+        return true;
+    }
+
+    size_t size;
+    const uint8_t *buf;
+    int buf_size = -1;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)) ||
+                 !ubase_check(uref_block_read(uref, 0, &buf_size, &buf)))) {
+        upipe_warn(upipe, "received non-block buffer");
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(buf_size != (int)size)) {
+        /* segmented datagram, should not happen with network sources */
+        uref_block_unmap(uref, 0);
+        if (unlikely(!ubase_check(uref_block_merge(uref, uref->ubuf->mgr,
+                                                   0, size)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return true;
+        }
+        buf_size = -1;
+        uref_block_read(uref, 0, &buf_size, &buf);
+    }
+
+    int offset = hbrmt_rtp_payload_offset(buf, size);
+    if (unlikely(offset < 0 ||
+                 offset + HBRMT_HEADER_SIZE + HBRMT_DATA_SIZE > size)) {
+        upipe_warn(upipe, "invalid datagram");
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return true;
+    }
+
+    const uint8_t *hbrmt = buf + offset;
+    if (unlikely(hbrmt_get_ext(hbrmt) ||
+                 !hbrmt_check_video_source_format(hbrmt) ||
+                 hbrmt_get_sample(hbrmt) != HBRMT_SAMPLE_422_10)) {
+        upipe_warn(upipe, "unsupported HBRMT stream");
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return true;
+    }
+
+    const struct hbrmt_format *format =
+        hbrmt_format_from_codes(hbrmt_get_frame(hbrmt),
+                                hbrmt_get_frate(hbrmt));
+    if (unlikely(format == NULL)) {
+        upipe_warn_va(upipe, "unsupported raster %"PRIx8"/%"PRIx8,
+                      hbrmt_get_frame(hbrmt), hbrmt_get_frate(hbrmt));
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(format != upipe_hbrmt_dec->format &&
+                 !ubase_check(upipe_hbrmt_dec_set_format(upipe, format)))) {
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+
+    if (upipe_hbrmt_dec->flow_def == NULL ||
+        upipe_hbrmt_dec->ubuf_mgr == NULL) {
+        uref_block_unmap(uref, 0);
+        return false;
+    }
+
+    uint16_t seqnum = rtp_get_seqnum(buf);
+    bool marker = rtp_check_marker(buf);
+
+    if (likely(upipe_hbrmt_dec->synced)) {
+        uint16_t index = seqnum - upipe_hbrmt_dec->first_seqnum;
+        if (unlikely(index >= upipe_hbrmt_dec->nb_packets)) {
+            /* the end of the previous frame was lost */
+            upipe_warn(upipe, "lost end of frame");
+            upipe_hbrmt_dec_output_frame(upipe, upump_p);
+            upipe_hbrmt_dec->synced = false;
+        } else {
+            if (upipe_hbrmt_dec->uref == NULL &&
+                unlikely(!ubase_check(upipe_hbrmt_dec_alloc_frame(upipe,
+                                                                  uref)))) {
+                uref_block_unmap(uref, 0);
+                uref_free(uref);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return true;
+            }
+
+            /* reassemble in place */
+            size_t frame_size = hbrmt_format_size(upipe_hbrmt_dec->format);
+            size_t position = (size_t)index * HBRMT_DATA_SIZE;
+            size_t data_size = frame_size - position < HBRMT_DATA_SIZE ?
+                               frame_size - position : HBRMT_DATA_SIZE;
+            memcpy(upipe_hbrmt_dec->buffer + position,
+                   hbrmt + HBRMT_HEADER_SIZE, data_size);
+            upipe_hbrmt_dec->nb_received++;
+
+            if (marker)
+                upipe_hbrmt_dec_output_frame(upipe, upump_p);
+        }
+    }
+
+    if (marker) {
+        upipe_hbrmt_dec->synced = true;
+        upipe_hbrmt_dec->first_seqnum = seqnum + 1;
+    }
+
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+    return true;
+}
+
+/** @internal @This receives incoming uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_hbrmt_dec_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    if (!upipe_hbrmt_dec_check_input(upipe)) {
+        upipe_hbrmt_dec_hold_input(upipe, uref);
+        upipe_hbrmt_dec_block_input(upipe, upump_p);
+    } else if (!upipe_hbrmt_dec_handle(upipe, uref, upump_p)) {
+        upipe_hbrmt_dec_hold_input(upipe, uref);
+        upipe_hbrmt_dec_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This receives a provided ubuf manager.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_hbrmt_dec_check(struct upipe *upipe, struct uref *flow_format)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_hbrmt_dec_store_flow_def(upipe, flow_format);
+
+    if (upipe_hbrmt_dec->flow_def == NULL)
+        return UBASE_ERR_NONE;
+
+    bool was_buffered = !upipe_hbrmt_dec_check_input(upipe);
+    upipe_hbrmt_dec_output_input(upipe);
+    upipe_hbrmt_dec_unblock_input(upipe);
+    if (was_buffered && upipe_hbrmt_dec_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_hbrmt_dec_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_hbrmt_dec_set_flow_def(struct upipe *upipe,
+                                        struct uref *flow_def)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    UBASE_RETURN(uref_flow_match_def(flow_def, "block."))
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    uref_free(upipe_hbrmt_dec->flow_def_input);
+    upipe_hbrmt_dec->flow_def_input = flow_def_dup;
+
+    /* the output flow definition is built from the first datagram */
+    upipe_hbrmt_dec->format = NULL;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_hbrmt_dec_control(struct upipe *upipe, int command,
+                                   va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return upipe_throw_provide_request(upipe, request);
+            return upipe_hbrmt_dec_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return UBASE_ERR_NONE;
+            return upipe_hbrmt_dec_free_output_proxy(upipe, request);
+        }
+
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+        case UPIPE_GET_FLOW_DEF:
+            return upipe_hbrmt_dec_control_output(upipe, command, args);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_hbrmt_dec_set_flow_def(upipe, flow_def);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This allocates a hbrmt_dec pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_hbrmt_dec_alloc(struct upipe_mgr *mgr,
+                                           struct uprobe *uprobe,
+                                           uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_hbrmt_dec_alloc_void(mgr, uprobe, signature,
+                                                     args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+    upipe_hbrmt_dec->flow_def_input = NULL;
+    upipe_hbrmt_dec->format = NULL;
+    upipe_hbrmt_dec->nb_packets = 0;
+    upipe_hbrmt_dec->synced = false;
+    upipe_hbrmt_dec->first_seqnum = 0;
+    upipe_hbrmt_dec->uref = NULL;
+    upipe_hbrmt_dec->buffer = NULL;
+    upipe_hbrmt_dec->nb_received = 0;
+
+    upipe_hbrmt_dec_init_urefcount(upipe);
+    upipe_hbrmt_dec_init_ubuf_mgr(upipe);
+    upipe_hbrmt_dec_init_output(upipe);
+    upipe_hbrmt_dec_init_input(upipe);
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hbrmt_dec_free(struct upipe *upipe)
+{
+    struct upipe_hbrmt_dec *upipe_hbrmt_dec =
+        upipe_hbrmt_dec_from_upipe(upipe);
+
+    upipe_throw_dead(upipe);
+    upipe_hbrmt_dec_flush(upipe);
+    uref_free(upipe_hbrmt_dec->flow_def_input);
+    upipe_hbrmt_dec_clean_input(upipe);
+    upipe_hbrmt_dec_clean_output(upipe);
+    upipe_hbrmt_dec_clean_ubuf_mgr(upipe);
+    upipe_hbrmt_dec_clean_urefcount(upipe);
+    upipe_hbrmt_dec_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_hbrmt_dec_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_HBRMT_DEC_SIGNATURE,
+
+    .upipe_alloc = upipe_hbrmt_dec_alloc,
+    .upipe_input = upipe_hbrmt_dec_input,
+    .upipe_control = upipe_hbrmt_dec_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for hbrmt_dec pipes
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hbrmt_dec_mgr_alloc(void)
+{
+    return &upipe_hbrmt_dec_mgr;
+}
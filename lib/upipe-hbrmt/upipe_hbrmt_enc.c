@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2022-6 packetizer
+ */
+
+#include <config.h>
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/upipe.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_dump.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/uref_block.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+
+#include <upipe-hbrmt/upipe_hbrmt_enc.h>
+
+#include "hbrmt_common.h"
+
+/** size of the headers of an HBRMT datagram */
+#define HBRMT_PACKET_HEADER_SIZE (RTP_HEADER_SIZE + HBRMT_HEADER_SIZE)
+
+/** upipe_hbrmt_enc structure */
+struct upipe_hbrmt_enc {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** raster of the input frames */
+    const struct hbrmt_format *format;
+    /** frame duration */
+    uint64_t duration;
+    /** next RTP sequence number */
+    uint16_t seqnum;
+    /** frame counter */
+    uint8_t frcount;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_hbrmt_enc, upipe, UPIPE_HBRMT_ENC_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_hbrmt_enc, urefcount, upipe_hbrmt_enc_free);
+UPIPE_HELPER_VOID(upipe_hbrmt_enc);
+UPIPE_HELPER_OUTPUT(upipe_hbrmt_enc, output, flow_def, output_state, request_list)
+
+/** @internal @This writes the headers of all the datagrams of a frame.
+ *
+ * @param upipe description structure of the pipe
+ * @param buf pointer to the headers
+ * @param nb_packets number of datagrams
+ * @param timestamp RTP timestamp of the frame
+ */
+static void upipe_hbrmt_enc_write_headers(struct upipe *upipe, uint8_t *buf,
+                                          unsigned int nb_packets,
+                                          uint32_t timestamp)
+{
+    struct upipe_hbrmt_enc *upipe_hbrmt_enc =
+        upipe_hbrmt_enc_from_upipe(upipe);
+
+    for (unsigned int i = 0; i < nb_packets; i++) {
+        memset(buf, 0, RTP_HEADER_SIZE);
+        rtp_set_hdr(buf);
+        rtp_set_type(buf, HBRMT_RTP_TYPE);
+        rtp_set_seqnum(buf, upipe_hbrmt_enc->seqnum++);
+        rtp_set_timestamp(buf, timestamp);
+        if (i == nb_packets - 1)
+            rtp_set_marker(buf);
+
+        uint8_t *hbrmt = buf + RTP_HEADER_SIZE;
+        hbrmt_set_hdr(hbrmt);
+        hbrmt_set_frcount(hbrmt, upipe_hbrmt_enc->frcount);
+        hbrmt_set_frame(hbrmt, upipe_hbrmt_enc->format->frame);
+        hbrmt_set_frate(hbrmt, upipe_hbrmt_enc->format->frate);
+        hbrmt_set_sample(hbrmt, HBRMT_SAMPLE_422_10);
+
+        buf += HBRMT_PACKET_HEADER_SIZE;
+    }
+    upipe_hbrmt_enc->frcount++;
+}
+
+/** @internal @This builds a datagram out of its header and the matching part
+ * of the frame, without copying the payload.
+ *
+ * @param headers buffer containing all the headers and the padding
+ * @param frame packed frame
+ * @param i index of the datagram
+ * @param nb_packets number of datagrams
+ * @param size size of the frame
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *upipe_hbrmt_enc_splice(struct ubuf *headers,
+                                           struct ubuf *frame, unsigned int i,
+                                           unsigned int nb_packets,
+                                           size_t size)
+{
+    size_t offset = (size_t)i * HBRMT_DATA_SIZE;
+    size_t payload_size = size - offset < HBRMT_DATA_SIZE ?
+                          size - offset : HBRMT_DATA_SIZE;
+
+    struct ubuf *ubuf = ubuf_block_splice(headers,
+            i * HBRMT_PACKET_HEADER_SIZE, HBRMT_PACKET_HEADER_SIZE);
+    if (unlikely(ubuf == NULL))
+        return NULL;
+
+    struct ubuf *payload = ubuf_block_splice(frame, offset, payload_size);
+    if (unlikely(payload == NULL ||
+                 !ubase_check(ubuf_block_append(ubuf, payload))))
+        goto error;
+
+    if (payload_size < HBRMT_DATA_SIZE) {
+        payload = ubuf_block_splice(headers,
+                nb_packets * HBRMT_PACKET_HEADER_SIZE,
+                HBRMT_DATA_SIZE - payload_size);
+        if (unlikely(payload == NULL ||
+                     !ubase_check(ubuf_block_append(ubuf, payload))))
+            goto error;
+    }
+    return ubuf;
+
+error:
+    ubuf_free(payload);
+    ubuf_free(ubuf);
+    return NULL;
+}
+
+/** @internal @This receives a packed frame and outputs RTP datagrams.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_hbrmt_enc_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct upipe_hbrmt_enc *upipe_hbrmt_enc =
+        upipe_hbrmt_enc_from_upipe(upipe);
+
+    size_t size;
+    if (unlikely(upipe_hbrmt_enc->format == NULL ||
+                 !ubase_check(uref_block_size(uref, &size)))) {
+        upipe_warn(upipe, "received non-block buffer");
+        uref_free(uref);
+        return;
+    }
+
+    if (unlikely(size != hbrmt_format_size(upipe_hbrmt_enc->format))) {
+        upipe_warn_va(upipe, "invalid frame size %zu", size);
+        uref_free(uref);
+        return;
+    }
+
+    unsigned int nb_packets = (size + HBRMT_DATA_SIZE - 1) / HBRMT_DATA_SIZE;
+    size_t padding = nb_packets * HBRMT_DATA_SIZE - size;
+
+    /* all the headers of the frame, followed by the padding of the last
+     * datagram, are allocated in one buffer and spliced */
+    size_t headers_size = nb_packets * HBRMT_PACKET_HEADER_SIZE;
+    struct ubuf *headers = ubuf_block_alloc(uref->ubuf->mgr,
+                                            headers_size + padding);
+    uint8_t *buf;
+    int buf_size = -1;
+    if (unlikely(headers == NULL ||
+                 !ubase_check(ubuf_block_write(headers, 0, &buf_size,
+                                               &buf)))) {
+        ubuf_free(headers);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    uint32_t timestamp = hbrmt_rtp_timestamp(uref, HBRMT_CLOCKRATE, 0);
+    upipe_hbrmt_enc_write_headers(upipe, buf, nb_packets, timestamp);
+    memset(buf + headers_size, 0, padding);
+    ubuf_block_unmap(headers, 0);
+
+    uint64_t cr_sys = 0;
+    bool has_cr_sys = ubase_check(uref_clock_get_cr_sys(uref, &cr_sys));
+
+    for (unsigned int i = 0; i < nb_packets; i++) {
+        struct ubuf *ubuf = upipe_hbrmt_enc_splice(headers, uref->ubuf,
+                                                   i, nb_packets, size);
+        struct uref *packet = ubuf != NULL ? uref_fork(uref, ubuf) : NULL;
+        if (unlikely(packet == NULL)) {
+            ubuf_free(ubuf);
+            ubuf_free(headers);
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+
+        /* spread the datagrams linearly over the frame */
+        if (has_cr_sys)
+            uref_clock_set_cr_sys(packet, cr_sys +
+                    i * upipe_hbrmt_enc->duration / nb_packets);
+        upipe_hbrmt_enc_output(upipe, packet, upump_p);
+    }
+
+    ubuf_free(headers);
+    uref_free(uref);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_hbrmt_enc_set_flow_def(struct upipe *upipe,
+                                        struct uref *flow_def)
+{
+    struct upipe_hbrmt_enc *upipe_hbrmt_enc =
+        upipe_hbrmt_enc_from_upipe(upipe);
+
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    UBASE_RETURN(uref_flow_match_def(flow_def, "block."))
+
+    uint64_t hsize, vsize;
+    struct urational fps;
+    UBASE_RETURN(uref_pic_flow_get_hsize(flow_def, &hsize))
+    UBASE_RETURN(uref_pic_flow_get_vsize(flow_def, &vsize))
+    UBASE_RETURN(uref_pic_flow_get_fps(flow_def, &fps))
+    bool progressive = ubase_check(uref_pic_get_progressive(flow_def));
+
+    const struct hbrmt_format *format =
+        hbrmt_format_from_pic(hsize, vsize, fps, progressive);
+    if (unlikely(format == NULL)) {
+        upipe_err(upipe, "unsupported raster");
+        uref_dump(flow_def, upipe->uprobe);
+        return UBASE_ERR_INVALID;
+    }
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    uref_flow_set_def(flow_def_dup, "block.rtp.");
+
+    upipe_hbrmt_enc->format = format;
+    upipe_hbrmt_enc->duration = UCLOCK_FREQ * fps.den / fps.num;
+    upipe_hbrmt_enc_store_flow_def(upipe, flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_hbrmt_enc_control(struct upipe *upipe, int command,
+                                   va_list args)
+{
+    UBASE_HANDLED_RETURN(upipe_hbrmt_enc_control_output(upipe, command, args));
+
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_hbrmt_enc_set_flow_def(upipe, flow_def);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This allocates a hbrmt_enc pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_hbrmt_enc_alloc(struct upipe_mgr *mgr,
+                                           struct uprobe *uprobe,
+                                           uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_hbrmt_enc_alloc_void(mgr, uprobe, signature,
+                                                     args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_hbrmt_enc *upipe_hbrmt_enc =
+        upipe_hbrmt_enc_from_upipe(upipe);
+    upipe_hbrmt_enc->format = NULL;
+    upipe_hbrmt_enc->duration = 0;
+    upipe_hbrmt_enc->seqnum = 0;
+    upipe_hbrmt_enc->frcount = 0;
+
+    upipe_hbrmt_enc_init_urefcount(upipe);
+    upipe_hbrmt_enc_init_output(upipe);
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hbrmt_enc_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_hbrmt_enc_clean_output(upipe);
+    upipe_hbrmt_enc_clean_urefcount(upipe);
+    upipe_hbrmt_enc_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_hbrmt_enc_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_HBRMT_ENC_SIGNATURE,
+
+    .upipe_alloc = upipe_hbrmt_enc_alloc,
+    .upipe_input = upipe_hbrmt_enc_input,
+    .upipe_control = upipe_hbrmt_enc_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for hbrmt_enc pipes
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_hbrmt_enc_mgr_alloc(void)
+{
+    return &upipe_hbrmt_enc_mgr;
+}
@@ -40,12 +40,17 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslice.h>
 
 #include <upipe-hbrmt/upipe_pack10bit.h>
 
+#include <stdlib.h>
+
 #include "sdienc.h"
 
 #define UBUF_ALIGN 32 /* 256-bits simd (avx2) */
+/** number of pixels packed with the C kernel at the end of a slice */
+#define PACK_TAIL 8
 
 /** upipe_pack10bit structure with pack10bit parameters */
 struct upipe_pack10bit {
@@ -80,6 +85,17 @@ struct upipe_pack10bit {
     /** packing */
     void (*pack)(uint8_t *dst, const uint8_t *y, int64_t pixels);
 
+    /** pool of packing threads */
+    struct uslice_pool pool;
+    /** job of the chunk being packed */
+    struct uslice_job job;
+    /** input of the chunk being packed */
+    const uint8_t *work_src;
+    /** output of the chunk being packed */
+    uint8_t *work_dst;
+    /** number of pixels of the chunk being packed */
+    int64_t work_pixels;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -100,6 +116,90 @@ UPIPE_HELPER_UBUF_MGR(upipe_pack10bit, ubuf_mgr, flow_format, ubuf_mgr_request,
                       upipe_pack10bit_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_pack10bit, urefs, nb_urefs, max_urefs, blockers, upipe_pack10bit_handle)
 
+/** @internal @This packs a slice of the current block. Slices start on
+ * multiples of 32 pixels. As the SIMD kernels write a few octets past the
+ * end of their output, the last pixels of all slices but the last one are
+ * packed with the C kernel, so that they do not overwrite the beginning of
+ * the next slice.
+ *
+ * @param job job of the chunk being packed
+ * @param slice index of the slice
+ * @param thread index of the thread
+ */
+static void upipe_pack10bit_work_slice(struct uslice_job *job,
+                                       unsigned int slice, unsigned int thread)
+{
+    struct upipe_pack10bit *upipe_pack10bit =
+        container_of(job, struct upipe_pack10bit, job);
+    unsigned int nb_slices = job->nb_slices;
+    int64_t pixels = upipe_pack10bit->work_pixels;
+    int64_t size = ((pixels + nb_slices - 1) / nb_slices + 31) & ~31;
+    int64_t first = slice * size;
+    int64_t last = first + size;
+    if (first >= pixels)
+        return;
+
+    const uint8_t *src = upipe_pack10bit->work_src + first * 4;
+    uint8_t *dst = upipe_pack10bit->work_dst + first * 5 / 2;
+    if (last >= pixels) {
+        upipe_pack10bit->pack(dst, src, pixels - first);
+        return;
+    }
+
+    upipe_pack10bit->pack(dst, src, size - PACK_TAIL);
+    upipe_uyvy_to_sdi_c(dst + (size - PACK_TAIL) * 5 / 2,
+                        src + (size - PACK_TAIL) * 4, PACK_TAIL);
+}
+
+/** @internal @This gets the number of packing threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_pack10bit_get_threads(struct upipe *upipe,
+                                        unsigned int *threads_p)
+{
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_pack10bit->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of packing threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_pack10bit_set_threads(struct upipe *upipe,
+                                        unsigned int threads)
+{
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&upipe_pack10bit->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
+    }
+    upipe_dbg_va(upipe, "packing with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This converts the current block. It is split into slices of
+ * pixels, shared between the worker threads and the calling thread. It returns
+ * when all slices are done.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_pack10bit_work(struct upipe *upipe)
+{
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
+    uslice_job_init(&upipe_pack10bit->job, upipe_pack10bit_work_slice,
+                    uslice_pool_get_threads(&upipe_pack10bit->pool));
+    uslice_pool_run(&upipe_pack10bit->pool, &upipe_pack10bit->job);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -155,8 +255,10 @@ static bool upipe_pack10bit_handle(struct upipe *upipe, struct uref *uref,
         }
 
         /* Pack data into output. */
-        int pixels = buf_size / 4;
-        upipe_pack10bit->pack(buffer, src, pixels);
+        upipe_pack10bit->work_src = src;
+        upipe_pack10bit->work_dst = buffer;
+        upipe_pack10bit->work_pixels = buf_size / 4;
+        upipe_pack10bit_work(upipe);
 
         /* Unmap input. */
         uref_block_unmap(uref, input_offset);
@@ -322,6 +424,17 @@ static int upipe_pack10bit_control(struct upipe *upipe, int command, va_list arg
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_pack10bit_set_flow_def(upipe, flow);
         }
+
+        case UPIPE_PACK10BIT_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACK10BIT_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_pack10bit_get_threads(upipe, threads_p);
+        }
+        case UPIPE_PACK10BIT_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACK10BIT_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_pack10bit_set_threads(upipe, threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -358,12 +471,18 @@ static struct upipe *upipe_pack10bit_alloc(struct upipe_mgr *mgr,
     if (__builtin_cpu_supports("avx2"))
         upipe_pack10bit->pack = upipe_uyvy_to_sdi_avx2;
 #endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        upipe_pack10bit->pack = upipe_uyvy_to_sdi_avx512;
+#endif
 #endif
 
     upipe_pack10bit_init_urefcount(upipe);
     upipe_pack10bit_init_ubuf_mgr(upipe);
     upipe_pack10bit_init_output(upipe);
     upipe_pack10bit_init_input(upipe);
+    uslice_pool_init(&upipe_pack10bit->pool);
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -375,7 +494,10 @@ static struct upipe *upipe_pack10bit_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_pack10bit_free(struct upipe *upipe)
 {
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
     upipe_throw_dead(upipe);
+
+    uslice_pool_clean(&upipe_pack10bit->pool);
     upipe_pack10bit_clean_input(upipe);
     upipe_pack10bit_clean_output(upipe);
     upipe_pack10bit_clean_ubuf_mgr(upipe);
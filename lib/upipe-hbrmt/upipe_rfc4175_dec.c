@@ -0,0 +1,656 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2110-20 depacketizer
+ */
+
+#include <config.h>
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/upipe.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_dump.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/uref_block.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_input.h>
+
+#include <upipe-hbrmt/upipe_rfc4175_dec.h>
+
+#include "hbrmt_common.h"
+#include "sdidec.h"
+
+/** maximum number of sample row data headers in a datagram */
+#define RFC4175_MAX_SRD 32
+
+/** upipe_rfc4175_dec structure */
+struct upipe_rfc4175_dec {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** temporary uref storage (used during urequest) */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers (used during udeal) */
+    struct uchain blockers;
+
+    /** picture width */
+    uint64_t hsize;
+    /** picture height */
+    uint64_t vsize;
+    /** true if the pictures are progressive */
+    bool progressive;
+
+    /** true if a sequence number was received */
+    bool has_seqnum;
+    /** next expected extended sequence number */
+    uint32_t seqnum;
+
+    /** picture being reassembled */
+    struct uref *uref;
+    /** mapped plane of the picture being reassembled */
+    uint8_t *plane;
+    /** stride of the plane */
+    size_t stride;
+    /** true if the plane is suitably aligned for the SIMD kernels */
+    bool aligned;
+    /** RTP timestamp of the picture being reassembled */
+    uint32_t timestamp;
+    /** true if the second field of the picture was received */
+    bool second_field;
+    /** number of datagrams lost during the picture */
+    unsigned int nb_lost;
+
+    /** unpacking */
+    void (*unpack)(const uint8_t *src, uint16_t *y, int64_t pixels);
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static bool upipe_rfc4175_dec_handle(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p);
+/** @hidden */
+static int upipe_rfc4175_dec_check(struct upipe *upipe,
+                                   struct uref *flow_format);
+
+UPIPE_HELPER_UPIPE(upipe_rfc4175_dec, upipe, UPIPE_RFC4175_DEC_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_rfc4175_dec, urefcount, upipe_rfc4175_dec_free);
+UPIPE_HELPER_VOID(upipe_rfc4175_dec);
+UPIPE_HELPER_OUTPUT(upipe_rfc4175_dec, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UBUF_MGR(upipe_rfc4175_dec, ubuf_mgr, flow_format, ubuf_mgr_request,
+                      upipe_rfc4175_dec_check,
+                      upipe_rfc4175_dec_register_output_request,
+                      upipe_rfc4175_dec_unregister_output_request)
+UPIPE_HELPER_INPUT(upipe_rfc4175_dec, urefs, nb_urefs, max_urefs, blockers, upipe_rfc4175_dec_handle)
+
+/** @internal @This outputs the picture being reassembled.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rfc4175_dec_output_frame(struct upipe *upipe,
+                                           struct upump **upump_p)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    struct uref *uref = upipe_rfc4175_dec->uref;
+    if (uref == NULL)
+        return;
+
+    uref_pic_plane_unmap(uref, RFC4175_CHROMA, 0, 0, -1, -1);
+    upipe_rfc4175_dec->uref = NULL;
+    upipe_rfc4175_dec->plane = NULL;
+
+    if (upipe_rfc4175_dec->nb_lost)
+        upipe_warn_va(upipe, "incomplete picture (%u datagrams lost)",
+                      upipe_rfc4175_dec->nb_lost);
+
+    if (upipe_rfc4175_dec->progressive)
+        uref_pic_set_progressive(uref);
+    else {
+        uref_pic_delete_progressive(uref);
+        uref_pic_set_tf(uref);
+        uref_pic_set_bf(uref);
+        uref_pic_set_tff(uref);
+    }
+    upipe_rfc4175_dec_output(upipe, uref, upump_p);
+}
+
+/** @internal @This drops the picture being reassembled.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rfc4175_dec_flush(struct upipe *upipe)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    if (upipe_rfc4175_dec->uref != NULL) {
+        uref_pic_plane_unmap(upipe_rfc4175_dec->uref, RFC4175_CHROMA,
+                             0, 0, -1, -1);
+        uref_free(upipe_rfc4175_dec->uref);
+        upipe_rfc4175_dec->uref = NULL;
+        upipe_rfc4175_dec->plane = NULL;
+    }
+}
+
+/** @internal @This allocates the next picture and maps its plane.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref first datagram of the picture, used for the attributes
+ * @param timestamp RTP timestamp of the picture
+ * @return an error code
+ */
+static int upipe_rfc4175_dec_alloc_frame(struct upipe *upipe,
+                                         struct uref *uref, uint32_t timestamp)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+
+    struct ubuf *ubuf = ubuf_pic_alloc(upipe_rfc4175_dec->ubuf_mgr,
+                                       upipe_rfc4175_dec->hsize,
+                                       upipe_rfc4175_dec->vsize);
+    UBASE_ALLOC_RETURN(ubuf);
+    struct uref *frame = uref_fork(uref, ubuf);
+    if (unlikely(frame == NULL)) {
+        ubuf_free(ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+
+    if (unlikely(!ubase_check(uref_pic_plane_size(frame, RFC4175_CHROMA,
+                                                  &upipe_rfc4175_dec->stride,
+                                                  NULL, NULL, NULL)) ||
+                 !ubase_check(uref_pic_plane_write(frame, RFC4175_CHROMA,
+                                                   0, 0, -1, -1,
+                                                   &upipe_rfc4175_dec->plane)))) {
+        uref_free(frame);
+        return UBASE_ERR_INVALID;
+    }
+
+    upipe_rfc4175_dec->aligned =
+        !(((uintptr_t)upipe_rfc4175_dec->plane | upipe_rfc4175_dec->stride) %
+          RFC4175_ALIGN);
+    upipe_rfc4175_dec->uref = frame;
+    upipe_rfc4175_dec->timestamp = timestamp;
+    upipe_rfc4175_dec->second_field = false;
+    upipe_rfc4175_dec->nb_lost = 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This unpacks a segment of pgroups into the picture.
+ *
+ * The SIMD kernels store whole aligned registers and read 6 octets past the
+ * last pgroup they unpack, so the edges of the segment are unpacked in C.
+ *
+ * @param upipe description structure of the pipe
+ * @param src pgroups
+ * @param line line of the picture
+ * @param offset offset of the first pixel in the line
+ * @param pixels number of pixels
+ */
+static void upipe_rfc4175_dec_unpack(struct upipe *upipe, const uint8_t *src,
+                                     uint64_t line, uint64_t offset,
+                                     uint64_t pixels)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    uint16_t *dst = (uint16_t *)(upipe_rfc4175_dec->plane +
+                                 line * upipe_rfc4175_dec->stride) +
+                    2 * offset;
+
+    if (upipe_rfc4175_dec->aligned) {
+        /* 8 pixels are 32 octets */
+        uint64_t head = (8 - offset % 8) % 8;
+        if (head > pixels)
+            head = pixels;
+        upipe_sdi_to_uyvy_c(src, dst, head);
+        src += head / RFC4175_PGROUP_PIXELS * RFC4175_PGROUP_SIZE;
+        dst += 2 * head;
+        pixels -= head;
+
+        uint64_t simd = pixels > 3 ? (pixels - 3) & ~7 : 0;
+        if (simd) {
+            upipe_rfc4175_dec->unpack(src, dst, simd);
+            src += simd / RFC4175_PGROUP_PIXELS * RFC4175_PGROUP_SIZE;
+            dst += 2 * simd;
+            pixels -= simd;
+        }
+    }
+
+    upipe_sdi_to_uyvy_c(src, dst, pixels);
+}
+
+/** @internal @This handles a datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param buf pointer to the datagram
+ * @param size size of the datagram
+ * @param upump_p reference to pump that generated the buffer
+ * @return an error code
+ */
+static int upipe_rfc4175_dec_parse(struct upipe *upipe, struct uref *uref,
+                                   const uint8_t *buf, size_t size,
+                                   struct upump **upump_p)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+
+    int offset = hbrmt_rtp_payload_offset(buf, size);
+    if (unlikely(offset < 0 ||
+                 offset + RFC4175_HEADER_SIZE + RFC4175_SRD_SIZE > size)) {
+        upipe_warn(upipe, "invalid datagram");
+        return UBASE_ERR_INVALID;
+    }
+
+    const uint8_t *payload = buf + offset;
+    const uint8_t *end = buf + size;
+    uint32_t seqnum = (rfc4175_get_ext_seqnum(payload) << 16) |
+                      rtp_get_seqnum(buf);
+    uint32_t lost = 0;
+    if (upipe_rfc4175_dec->has_seqnum &&
+        unlikely(seqnum != upipe_rfc4175_dec->seqnum)) {
+        lost = seqnum - upipe_rfc4175_dec->seqnum;
+        if ((int32_t)lost < 0) {
+            upipe_warn(upipe, "late datagram");
+            return UBASE_ERR_INVALID;
+        }
+        upipe_warn_va(upipe, "potentially lost %"PRIu32" datagrams", lost);
+    }
+    upipe_rfc4175_dec->has_seqnum = true;
+    upipe_rfc4175_dec->seqnum = seqnum + 1;
+
+    /* sample row data headers */
+    const uint8_t *srd[RFC4175_MAX_SRD];
+    unsigned int nb_srd = 0;
+    const uint8_t *data = payload + RFC4175_HEADER_SIZE;
+    do {
+        if (unlikely(data + RFC4175_SRD_SIZE > end ||
+                     nb_srd >= RFC4175_MAX_SRD)) {
+            upipe_warn(upipe, "invalid sample row data headers");
+            return UBASE_ERR_INVALID;
+        }
+        srd[nb_srd++] = data;
+        data += RFC4175_SRD_SIZE;
+    } while (rfc4175_check_srd_continuation(srd[nb_srd - 1]));
+
+    uint32_t timestamp = rtp_get_timestamp(buf);
+    bool field = rfc4175_get_srd_field(srd[0]);
+    bool progressive = upipe_rfc4175_dec->progressive;
+
+    if (upipe_rfc4175_dec->uref != NULL &&
+        ((progressive && timestamp != upipe_rfc4175_dec->timestamp) ||
+         (!progressive && !field && upipe_rfc4175_dec->second_field))) {
+        /* the end of the previous picture was lost */
+        upipe_rfc4175_dec->nb_lost++;
+        upipe_rfc4175_dec_output_frame(upipe, upump_p);
+    }
+
+    if (upipe_rfc4175_dec->uref == NULL) {
+        if (!progressive && field)
+            /* wait for the first field */
+            return UBASE_ERR_NONE;
+        UBASE_RETURN(upipe_rfc4175_dec_alloc_frame(upipe, uref, timestamp))
+    }
+    if (field)
+        upipe_rfc4175_dec->second_field = true;
+    upipe_rfc4175_dec->nb_lost += lost;
+
+    for (unsigned int i = 0; i < nb_srd; i++) {
+        uint16_t length = rfc4175_get_srd_length(srd[i]);
+        uint64_t line = rfc4175_get_srd_row(srd[i]);
+        uint64_t pixel = rfc4175_get_srd_offset(srd[i]);
+        uint64_t pixels = length / RFC4175_PGROUP_SIZE * RFC4175_PGROUP_PIXELS;
+        if (!progressive)
+            line = 2 * line + rfc4175_get_srd_field(srd[i]);
+
+        if (unlikely(length % RFC4175_PGROUP_SIZE ||
+                     pixel % RFC4175_PGROUP_PIXELS ||
+                     data + length > end ||
+                     line >= upipe_rfc4175_dec->vsize ||
+                     pixel + pixels > upipe_rfc4175_dec->hsize)) {
+            upipe_warn(upipe, "invalid sample row data");
+            break;
+        }
+
+        upipe_rfc4175_dec_unpack(upipe, data, line, pixel, pixels);
+        data += length;
+    }
+
+    if (rtp_check_marker(buf) && (progressive || field))
+        upipe_rfc4175_dec_output_frame(upipe, upump_p);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This handles data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be blocked
+ */
+static bool upipe_rfc4175_dec_handle(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_rfc4175_dec_flush(upipe);
+        upipe_rfc4175_dec_store_flow_def(upipe, NULL);
+        upipe_rfc4175_dec_require_ubuf_mgr(upipe, uref);
+        return true;
+    }
+
+    if (upipe_rfc4175_dec->flow_def == NULL ||
+        upipe_rfc4175_dec->ubuf_mgr == NULL)
+        return false;
+
+    size_t size;
+    const uint8_t *buf;
+    int buf_size = -1;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)) ||
+                 !ubase_check(uref_block_read(uref, 0, &buf_size, &buf)))) {
+        upipe_warn(upipe, "received non-block buffer");
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(buf_size != (int)size)) {
+        /* segmented datagram, should not happen with network sources */
+        uref_block_unmap(uref, 0);
+        if (unlikely(!ubase_check(uref_block_merge(uref, uref->ubuf->mgr,
+                                                   0, size)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return true;
+        }
+        buf_size = -1;
+        uref_block_read(uref, 0, &buf_size, &buf);
+    }
+
+    int err = upipe_rfc4175_dec_parse(upipe, uref, buf, size, upump_p);
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+    if (unlikely(err == UBASE_ERR_ALLOC))
+        upipe_throw_fatal(upipe, err);
+    return true;
+}
+
+/** @internal @This receives incoming uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rfc4175_dec_input(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    if (!upipe_rfc4175_dec_check_input(upipe)) {
+        upipe_rfc4175_dec_hold_input(upipe, uref);
+        upipe_rfc4175_dec_block_input(upipe, upump_p);
+    } else if (!upipe_rfc4175_dec_handle(upipe, uref, upump_p)) {
+        upipe_rfc4175_dec_hold_input(upipe, uref);
+        upipe_rfc4175_dec_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This receives a provided ubuf manager.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_rfc4175_dec_check(struct upipe *upipe,
+                                   struct uref *flow_format)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_rfc4175_dec_store_flow_def(upipe, flow_format);
+
+    if (upipe_rfc4175_dec->flow_def == NULL)
+        return UBASE_ERR_NONE;
+
+    bool was_buffered = !upipe_rfc4175_dec_check_input(upipe);
+    upipe_rfc4175_dec_output_input(upipe);
+    upipe_rfc4175_dec_unblock_input(upipe);
+    if (was_buffered && upipe_rfc4175_dec_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_rfc4175_dec_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_rfc4175_dec_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    UBASE_RETURN(uref_flow_match_def(flow_def, "block."))
+
+    uint64_t hsize, vsize;
+    if (unlikely(!ubase_check(uref_pic_flow_get_hsize(flow_def, &hsize)) ||
+                 !ubase_check(uref_pic_flow_get_vsize(flow_def, &vsize)) ||
+                 hsize % RFC4175_PGROUP_PIXELS)) {
+        upipe_err(upipe, "incompatible input flow def");
+        uref_dump(flow_def, upipe->uprobe);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    uref_block_flow_clear_format(flow_def_dup);
+    uref_flow_set_def(flow_def_dup, "pic.");
+    uref_pic_flow_clear_format(flow_def_dup);
+    if (unlikely(!ubase_check(uref_pic_flow_set_macropixel(flow_def_dup,
+                                                           RFC4175_PGROUP_PIXELS)) ||
+                 !ubase_check(uref_pic_flow_add_plane(flow_def_dup, 1, 1, 8,
+                                                      RFC4175_CHROMA)) ||
+                 !ubase_check(uref_pic_flow_set_align(flow_def_dup,
+                                                      RFC4175_ALIGN)))) {
+        uref_free(flow_def_dup);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_rfc4175_dec->hsize = hsize;
+    upipe_rfc4175_dec->vsize = vsize;
+    upipe_rfc4175_dec->progressive =
+        ubase_check(uref_pic_get_progressive(flow_def));
+
+    upipe_input(upipe, flow_def_dup, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_rfc4175_dec_control(struct upipe *upipe, int command,
+                                     va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return upipe_throw_provide_request(upipe, request);
+            return upipe_rfc4175_dec_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return UBASE_ERR_NONE;
+            return upipe_rfc4175_dec_free_output_proxy(upipe, request);
+        }
+
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+        case UPIPE_GET_FLOW_DEF:
+            return upipe_rfc4175_dec_control_output(upipe, command, args);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_rfc4175_dec_set_flow_def(upipe, flow_def);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This allocates a rfc4175_dec pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_rfc4175_dec_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_rfc4175_dec_alloc_void(mgr, uprobe, signature,
+                                                       args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_rfc4175_dec *upipe_rfc4175_dec =
+        upipe_rfc4175_dec_from_upipe(upipe);
+    upipe_rfc4175_dec->hsize = 0;
+    upipe_rfc4175_dec->vsize = 0;
+    upipe_rfc4175_dec->progressive = true;
+    upipe_rfc4175_dec->has_seqnum = false;
+    upipe_rfc4175_dec->seqnum = 0;
+    upipe_rfc4175_dec->uref = NULL;
+    upipe_rfc4175_dec->plane = NULL;
+    upipe_rfc4175_dec->stride = 0;
+    upipe_rfc4175_dec->aligned = false;
+    upipe_rfc4175_dec->timestamp = 0;
+    upipe_rfc4175_dec->second_field = false;
+    upipe_rfc4175_dec->nb_lost = 0;
+
+    upipe_rfc4175_dec->unpack = upipe_sdi_to_uyvy_c;
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("ssse3"))
+        upipe_rfc4175_dec->unpack = upipe_sdi_to_uyvy_ssse3;
+
+    if (__builtin_cpu_supports("avx2"))
+        upipe_rfc4175_dec->unpack = upipe_sdi_to_uyvy_avx2;
+#endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        upipe_rfc4175_dec->unpack = upipe_sdi_to_uyvy_avx512;
+#endif
+#endif
+
+    upipe_rfc4175_dec_init_urefcount(upipe);
+    upipe_rfc4175_dec_init_ubuf_mgr(upipe);
+    upipe_rfc4175_dec_init_output(upipe);
+    upipe_rfc4175_dec_init_input(upipe);
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rfc4175_dec_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_rfc4175_dec_flush(upipe);
+    upipe_rfc4175_dec_clean_input(upipe);
+    upipe_rfc4175_dec_clean_output(upipe);
+    upipe_rfc4175_dec_clean_ubuf_mgr(upipe);
+    upipe_rfc4175_dec_clean_urefcount(upipe);
+    upipe_rfc4175_dec_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_rfc4175_dec_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_RFC4175_DEC_SIGNATURE,
+
+    .upipe_alloc = upipe_rfc4175_dec_alloc,
+    .upipe_input = upipe_rfc4175_dec_input,
+    .upipe_control = upipe_rfc4175_dec_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for rfc4175_dec pipes
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rfc4175_dec_mgr_alloc(void)
+{
+    return &upipe_rfc4175_dec_mgr;
+}
@@ -0,0 +1,660 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short Upipe SMPTE 2110-20 packetizer
+ */
+
+#include <config.h>
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/upipe.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_dump.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/uref_block.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_ubuf_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_input.h>
+
+#include <upipe-hbrmt/upipe_rfc4175_enc.h>
+
+#include "hbrmt_common.h"
+#include "sdienc.h"
+
+/** maximum size of the pgroups of a datagram */
+#define RFC4175_PAYLOAD_SIZE 1200
+/** maximum number of sample row data headers in a datagram */
+#define RFC4175_MAX_SRD 3
+/** maximum size of the headers of a datagram */
+#define RFC4175_PACKET_HEADER_SIZE (RTP_HEADER_SIZE + RFC4175_HEADER_SIZE + \
+                                    RFC4175_MAX_SRD * RFC4175_SRD_SIZE)
+/** the packing kernels write up to 6 octets past the end of a line */
+#define UBUF_APPEND 32
+
+/** upipe_rfc4175_enc structure */
+struct upipe_rfc4175_enc {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+    /** flow format packet */
+    struct uref *flow_format;
+    /** ubuf manager request */
+    struct urequest ubuf_mgr_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** temporary uref storage (used during urequest) */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers (used during udeal) */
+    struct uchain blockers;
+
+    /** picture width */
+    uint64_t hsize;
+    /** picture height */
+    uint64_t vsize;
+    /** true if the pictures are progressive */
+    bool progressive;
+    /** frame duration */
+    uint64_t duration;
+    /** next extended sequence number */
+    uint32_t seqnum;
+
+    /** packing */
+    void (*pack)(uint8_t *dst, const uint8_t *y, int64_t pixels);
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static bool upipe_rfc4175_enc_handle(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p);
+/** @hidden */
+static int upipe_rfc4175_enc_check(struct upipe *upipe,
+                                   struct uref *flow_format);
+
+UPIPE_HELPER_UPIPE(upipe_rfc4175_enc, upipe, UPIPE_RFC4175_ENC_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_rfc4175_enc, urefcount, upipe_rfc4175_enc_free);
+UPIPE_HELPER_VOID(upipe_rfc4175_enc);
+UPIPE_HELPER_OUTPUT(upipe_rfc4175_enc, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UBUF_MGR(upipe_rfc4175_enc, ubuf_mgr, flow_format, ubuf_mgr_request,
+                      upipe_rfc4175_enc_check,
+                      upipe_rfc4175_enc_register_output_request,
+                      upipe_rfc4175_enc_unregister_output_request)
+UPIPE_HELPER_INPUT(upipe_rfc4175_enc, urefs, nb_urefs, max_urefs, blockers, upipe_rfc4175_enc_handle)
+
+/** @internal @This returns the number of lines of the first field, or of the
+ * frame for progressive pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of lines
+ */
+static inline uint64_t upipe_rfc4175_enc_field_lines(struct upipe *upipe)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    if (upipe_rfc4175_enc->progressive)
+        return upipe_rfc4175_enc->vsize;
+    return (upipe_rfc4175_enc->vsize + 1) / 2;
+}
+
+/** @internal @This returns the size of the next datagram.
+ *
+ * Datagrams are filled with as many pgroups as possible, spanning several
+ * lines if needed, but never span two fields.
+ *
+ * @param line_size size of a packed line
+ * @param position offset of the datagram in the packed frame
+ * @param end end of the field in the packed frame
+ * @param nb_srd_p filled in with the number of sample row data headers
+ * @return size of the payload
+ */
+static size_t upipe_rfc4175_enc_next(size_t line_size, size_t position,
+                                     size_t end, unsigned int *nb_srd_p)
+{
+    size_t size = 0;
+    unsigned int nb_srd = 0;
+    while (position + size < end && nb_srd < RFC4175_MAX_SRD &&
+           size < RFC4175_PAYLOAD_SIZE) {
+        size_t chunk = line_size - (position + size) % line_size;
+        if (chunk > RFC4175_PAYLOAD_SIZE - size)
+            chunk = RFC4175_PAYLOAD_SIZE - size;
+        size += chunk;
+        nb_srd++;
+    }
+    *nb_srd_p = nb_srd;
+    return size;
+}
+
+/** @internal @This packs a picture line by line, in transmission order.
+ *
+ * @param upipe description structure of the pipe
+ * @param dst packed frame
+ * @param plane picture plane
+ * @param stride stride of the picture plane
+ */
+static void upipe_rfc4175_enc_pack(struct upipe *upipe, uint8_t *dst,
+                                   const uint8_t *plane, size_t stride)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    uint64_t hsize = upipe_rfc4175_enc->hsize;
+    uint64_t vsize = upipe_rfc4175_enc->vsize;
+    uint64_t field_lines = upipe_rfc4175_enc_field_lines(upipe);
+    size_t line_size = hsize / RFC4175_PGROUP_PIXELS * RFC4175_PGROUP_SIZE;
+
+    /* the kernels process 8 pixels per iteration, and the SSSE3 one
+     * requires aligned lines */
+    void (*pack)(uint8_t *, const uint8_t *, int64_t) = upipe_rfc4175_enc->pack;
+    uint64_t simd_hsize = hsize & ~7;
+    if (((uintptr_t)plane | stride) % 16)
+        pack = upipe_uyvy_to_sdi_c;
+
+    for (uint64_t t = 0; t < vsize; t++) {
+        uint64_t line = t;
+        if (!upipe_rfc4175_enc->progressive)
+            line = t < field_lines ? 2 * t : 2 * (t - field_lines) + 1;
+        const uint8_t *src = plane + line * stride;
+
+        if (simd_hsize)
+            pack(dst, src, simd_hsize);
+        if (simd_hsize < hsize)
+            upipe_uyvy_to_sdi_c(dst + simd_hsize / 2 * 5, src + simd_hsize * 4,
+                                hsize - simd_hsize);
+        dst += line_size;
+    }
+}
+
+/** @internal @This writes the headers of all the datagrams of a frame.
+ *
+ * @param upipe description structure of the pipe
+ * @param buf pointer to the headers
+ * @param timestamp RTP timestamps of both fields
+ * @return number of datagrams
+ */
+static unsigned int upipe_rfc4175_enc_write_headers(struct upipe *upipe,
+                                                    uint8_t *buf,
+                                                    uint32_t timestamp[2])
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    uint64_t field_lines = upipe_rfc4175_enc_field_lines(upipe);
+    size_t line_size = upipe_rfc4175_enc->hsize / RFC4175_PGROUP_PIXELS *
+                       RFC4175_PGROUP_SIZE;
+    size_t frame_size = line_size * upipe_rfc4175_enc->vsize;
+    size_t field_end = line_size * field_lines;
+    unsigned int nb_packets = 0;
+
+    for (size_t position = 0; position < frame_size; nb_packets++) {
+        bool field = position >= field_end;
+        size_t end = field ? frame_size : field_end;
+        unsigned int nb_srd;
+        size_t size = upipe_rfc4175_enc_next(line_size, position, end,
+                                             &nb_srd);
+        uint32_t seqnum = upipe_rfc4175_enc->seqnum++;
+
+        memset(buf, 0, RTP_HEADER_SIZE);
+        rtp_set_hdr(buf);
+        rtp_set_type(buf, RFC4175_RTP_TYPE);
+        rtp_set_seqnum(buf, seqnum);
+        rtp_set_timestamp(buf, timestamp[field]);
+        if (position + size == end)
+            rtp_set_marker(buf);
+        rfc4175_set_ext_seqnum(buf + RTP_HEADER_SIZE, seqnum >> 16);
+
+        uint8_t *srd = buf + RTP_HEADER_SIZE + RFC4175_HEADER_SIZE;
+        for (unsigned int i = 0; i < nb_srd; i++) {
+            uint64_t t = position / line_size;
+            size_t offset = position % line_size;
+            size_t length = line_size - offset;
+            if (length > size)
+                length = size;
+            uint64_t row = field ? t - field_lines : t;
+
+            rfc4175_set_srd(srd, length, field, row,
+                            offset / RFC4175_PGROUP_SIZE *
+                            RFC4175_PGROUP_PIXELS, i < nb_srd - 1);
+            srd += RFC4175_SRD_SIZE;
+            position += length;
+            size -= length;
+        }
+
+        buf += RFC4175_PACKET_HEADER_SIZE;
+    }
+    return nb_packets;
+}
+
+/** @internal @This counts the datagrams of a frame.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of datagrams
+ */
+static unsigned int upipe_rfc4175_enc_count(struct upipe *upipe)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    size_t line_size = upipe_rfc4175_enc->hsize / RFC4175_PGROUP_PIXELS *
+                       RFC4175_PGROUP_SIZE;
+    size_t frame_size = line_size * upipe_rfc4175_enc->vsize;
+    size_t field_end = line_size * upipe_rfc4175_enc_field_lines(upipe);
+    unsigned int nb_packets = 0;
+
+    for (size_t position = 0; position < frame_size; nb_packets++) {
+        unsigned int nb_srd;
+        position += upipe_rfc4175_enc_next(line_size, position,
+                position >= field_end ? frame_size : field_end, &nb_srd);
+    }
+    return nb_packets;
+}
+
+/** @internal @This outputs the datagrams of a packed frame.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure of the picture
+ * @param packed packed frame
+ * @param headers buffer containing all the headers
+ * @param nb_packets number of datagrams
+ * @param upump_p reference to pump that generated the buffer
+ * @return an error code
+ */
+static int upipe_rfc4175_enc_send(struct upipe *upipe, struct uref *uref,
+                                  struct ubuf *packed, struct ubuf *headers,
+                                  unsigned int nb_packets,
+                                  struct upump **upump_p)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    size_t line_size = upipe_rfc4175_enc->hsize / RFC4175_PGROUP_PIXELS *
+                       RFC4175_PGROUP_SIZE;
+    size_t frame_size = line_size * upipe_rfc4175_enc->vsize;
+    size_t field_end = line_size * upipe_rfc4175_enc_field_lines(upipe);
+
+    uint64_t cr_sys = 0;
+    bool has_cr_sys = ubase_check(uref_clock_get_cr_sys(uref, &cr_sys));
+
+    size_t position = 0;
+    for (unsigned int i = 0; i < nb_packets; i++) {
+        unsigned int nb_srd;
+        size_t size = upipe_rfc4175_enc_next(line_size, position,
+                position >= field_end ? frame_size : field_end, &nb_srd);
+
+        struct ubuf *ubuf = ubuf_block_splice(headers,
+                i * RFC4175_PACKET_HEADER_SIZE,
+                RTP_HEADER_SIZE + RFC4175_HEADER_SIZE +
+                nb_srd * RFC4175_SRD_SIZE);
+        UBASE_ALLOC_RETURN(ubuf);
+        struct ubuf *payload = ubuf_block_splice(packed, position, size);
+        if (unlikely(payload == NULL ||
+                     !ubase_check(ubuf_block_append(ubuf, payload)))) {
+            ubuf_free(payload);
+            ubuf_free(ubuf);
+            return UBASE_ERR_ALLOC;
+        }
+        position += size;
+
+        struct uref *packet = uref_fork(uref, ubuf);
+        if (unlikely(packet == NULL)) {
+            ubuf_free(ubuf);
+            return UBASE_ERR_ALLOC;
+        }
+
+        /* spread the datagrams linearly over the frame */
+        if (has_cr_sys)
+            uref_clock_set_cr_sys(packet, cr_sys +
+                    i * upipe_rfc4175_enc->duration / nb_packets);
+        upipe_rfc4175_enc_output(upipe, packet, upump_p);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This handles data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure describing the picture
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be blocked
+ */
+static bool upipe_rfc4175_enc_handle(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_rfc4175_enc_store_flow_def(upipe, NULL);
+        upipe_rfc4175_enc_require_ubuf_mgr(upipe, uref);
+        return true;
+    }
+
+    if (upipe_rfc4175_enc->flow_def == NULL ||
+        upipe_rfc4175_enc->ubuf_mgr == NULL)
+        return false;
+
+    size_t hsize, vsize;
+    const uint8_t *plane;
+    size_t stride;
+    if (unlikely(!ubase_check(uref_pic_size(uref, &hsize, &vsize, NULL)) ||
+                 hsize != upipe_rfc4175_enc->hsize ||
+                 vsize != upipe_rfc4175_enc->vsize ||
+                 !ubase_check(uref_pic_plane_size(uref, RFC4175_CHROMA,
+                                                  &stride, NULL, NULL,
+                                                  NULL)) ||
+                 !ubase_check(uref_pic_plane_read(uref, RFC4175_CHROMA,
+                                                  0, 0, -1, -1, &plane)))) {
+        upipe_warn(upipe, "invalid picture received");
+        uref_free(uref);
+        return true;
+    }
+
+    size_t frame_size = hsize / RFC4175_PGROUP_PIXELS * RFC4175_PGROUP_SIZE *
+                        vsize;
+    struct ubuf *packed = ubuf_block_alloc(upipe_rfc4175_enc->ubuf_mgr,
+                                           frame_size);
+    uint8_t *buf;
+    int buf_size = -1;
+    if (unlikely(packed == NULL ||
+                 !ubase_check(ubuf_block_write(packed, 0, &buf_size, &buf)))) {
+        ubuf_free(packed);
+        uref_pic_plane_unmap(uref, RFC4175_CHROMA, 0, 0, -1, -1);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+
+    upipe_rfc4175_enc_pack(upipe, buf, plane, stride);
+    ubuf_block_unmap(packed, 0);
+    uref_pic_plane_unmap(uref, RFC4175_CHROMA, 0, 0, -1, -1);
+
+    unsigned int nb_packets = upipe_rfc4175_enc_count(upipe);
+    struct ubuf *headers = ubuf_block_alloc(upipe_rfc4175_enc->ubuf_mgr,
+            nb_packets * RFC4175_PACKET_HEADER_SIZE);
+    buf_size = -1;
+    if (unlikely(headers == NULL ||
+                 !ubase_check(ubuf_block_write(headers, 0, &buf_size,
+                                               &buf)))) {
+        ubuf_free(headers);
+        ubuf_free(packed);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+
+    /* the second field is sampled half a frame later */
+    uint32_t timestamp[2];
+    timestamp[0] = hbrmt_rtp_timestamp(uref, RFC4175_CLOCKRATE, 0);
+    timestamp[1] = hbrmt_rtp_timestamp(uref, RFC4175_CLOCKRATE,
+                                       upipe_rfc4175_enc->duration / 2);
+    upipe_rfc4175_enc_write_headers(upipe, buf, timestamp);
+    ubuf_block_unmap(headers, 0);
+
+    int err = upipe_rfc4175_enc_send(upipe, uref, packed, headers, nb_packets,
+                                     upump_p);
+    ubuf_free(headers);
+    ubuf_free(packed);
+    uref_free(uref);
+    if (unlikely(!ubase_check(err)))
+        upipe_throw_fatal(upipe, err);
+    return true;
+}
+
+/** @internal @This receives incoming uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure describing the picture
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rfc4175_enc_input(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    if (!upipe_rfc4175_enc_check_input(upipe)) {
+        upipe_rfc4175_enc_hold_input(upipe, uref);
+        upipe_rfc4175_enc_block_input(upipe, upump_p);
+    } else if (!upipe_rfc4175_enc_handle(upipe, uref, upump_p)) {
+        upipe_rfc4175_enc_hold_input(upipe, uref);
+        upipe_rfc4175_enc_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This receives a provided ubuf manager.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_rfc4175_enc_check(struct upipe *upipe,
+                                   struct uref *flow_format)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_rfc4175_enc_store_flow_def(upipe, flow_format);
+
+    if (upipe_rfc4175_enc->flow_def == NULL)
+        return UBASE_ERR_NONE;
+
+    bool was_buffered = !upipe_rfc4175_enc_check_input(upipe);
+    upipe_rfc4175_enc_output_input(upipe);
+    upipe_rfc4175_enc_unblock_input(upipe);
+    if (was_buffered && upipe_rfc4175_enc_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_rfc4175_enc_input. */
+        upipe_release(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_rfc4175_enc_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    UBASE_RETURN(uref_flow_match_def(flow_def, "pic."))
+
+    uint64_t hsize, vsize;
+    struct urational fps;
+    if (unlikely(!ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 8,
+                                                         RFC4175_CHROMA)) ||
+                 !ubase_check(uref_pic_flow_get_hsize(flow_def, &hsize)) ||
+                 !ubase_check(uref_pic_flow_get_vsize(flow_def, &vsize)) ||
+                 !ubase_check(uref_pic_flow_get_fps(flow_def, &fps)) ||
+                 hsize % RFC4175_PGROUP_PIXELS || !fps.num)) {
+        upipe_err(upipe, "incompatible input flow def");
+        uref_dump(flow_def, upipe->uprobe);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    uref_pic_flow_clear_format(flow_def_dup);
+    uref_flow_set_def(flow_def_dup, "block.rtp.");
+    uref_block_flow_set_append(flow_def_dup, UBUF_APPEND);
+
+    upipe_rfc4175_enc->hsize = hsize;
+    upipe_rfc4175_enc->vsize = vsize;
+    upipe_rfc4175_enc->progressive =
+        ubase_check(uref_pic_get_progressive(flow_def));
+    upipe_rfc4175_enc->duration = UCLOCK_FREQ * fps.den / fps.num;
+
+    upipe_input(upipe, flow_def_dup, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_rfc4175_enc_control(struct upipe *upipe, int command,
+                                     va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return upipe_throw_provide_request(upipe, request);
+            return upipe_rfc4175_enc_alloc_output_proxy(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR ||
+                request->type == UREQUEST_FLOW_FORMAT)
+                return UBASE_ERR_NONE;
+            return upipe_rfc4175_enc_free_output_proxy(upipe, request);
+        }
+
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+        case UPIPE_GET_FLOW_DEF:
+            return upipe_rfc4175_enc_control_output(upipe, command, args);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_rfc4175_enc_set_flow_def(upipe, flow_def);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This allocates a rfc4175_enc pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_rfc4175_enc_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_rfc4175_enc_alloc_void(mgr, uprobe, signature,
+                                                       args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_rfc4175_enc *upipe_rfc4175_enc =
+        upipe_rfc4175_enc_from_upipe(upipe);
+    upipe_rfc4175_enc->hsize = 0;
+    upipe_rfc4175_enc->vsize = 0;
+    upipe_rfc4175_enc->progressive = true;
+    upipe_rfc4175_enc->duration = 0;
+    upipe_rfc4175_enc->seqnum = 0;
+
+    upipe_rfc4175_enc->pack = upipe_uyvy_to_sdi_c;
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    if (__builtin_cpu_supports("ssse3"))
+        upipe_rfc4175_enc->pack = upipe_uyvy_to_sdi_ssse3;
+
+    if (__builtin_cpu_supports("avx"))
+        upipe_rfc4175_enc->pack = upipe_uyvy_to_sdi_avx;
+
+    if (__builtin_cpu_supports("avx2"))
+        upipe_rfc4175_enc->pack = upipe_uyvy_to_sdi_avx2;
+#endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        upipe_rfc4175_enc->pack = upipe_uyvy_to_sdi_avx512;
+#endif
+#endif
+
+    upipe_rfc4175_enc_init_urefcount(upipe);
+    upipe_rfc4175_enc_init_ubuf_mgr(upipe);
+    upipe_rfc4175_enc_init_output(upipe);
+    upipe_rfc4175_enc_init_input(upipe);
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rfc4175_enc_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_rfc4175_enc_clean_input(upipe);
+    upipe_rfc4175_enc_clean_output(upipe);
+    upipe_rfc4175_enc_clean_ubuf_mgr(upipe);
+    upipe_rfc4175_enc_clean_urefcount(upipe);
+    upipe_rfc4175_enc_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_rfc4175_enc_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_RFC4175_ENC_SIGNATURE,
+
+    .upipe_alloc = upipe_rfc4175_enc_alloc,
+    .upipe_input = upipe_rfc4175_enc_input,
+    .upipe_control = upipe_rfc4175_enc_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for rfc4175_enc pipes
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rfc4175_enc_mgr_alloc(void)
+{
+    return &upipe_rfc4175_enc_mgr;
+}
@@ -40,9 +40,12 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslice.h>
 
 #include <upipe-hbrmt/upipe_unpack10bit.h>
 
+#include <stdlib.h>
+
 #include "sdidec.h"
 
 #define UBUF_ALIGN 32 /* 256-bits simd (avx2) */
@@ -80,6 +83,17 @@ struct upipe_unpack10bit {
     /** unpacking */
     void (*unpack)(const uint8_t *src, uint16_t *y, int64_t pixels);
 
+    /** pool of unpacking threads */
+    struct uslice_pool pool;
+    /** job of the block being unpacked */
+    struct uslice_job job;
+    /** input of the block being unpacked */
+    const uint8_t *work_src;
+    /** output of the block being unpacked */
+    uint16_t *work_dst;
+    /** number of pixels of the block being unpacked */
+    int64_t work_pixels;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -100,6 +114,83 @@ UPIPE_HELPER_UBUF_MGR(upipe_unpack10bit, ubuf_mgr, flow_format, ubuf_mgr_request
                       upipe_unpack10bit_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_unpack10bit, urefs, nb_urefs, max_urefs, blockers, upipe_unpack10bit_handle)
 
+/** @internal @This unpacks a slice of the current block. Slices start on
+ * multiples of 32 pixels, so that the output of the SIMD kernels stays
+ * aligned and each slice writes whole groups of pixels.
+ *
+ * @param job job of the block being unpacked
+ * @param slice index of the slice
+ * @param thread index of the thread
+ */
+static void upipe_unpack10bit_work_slice(struct uslice_job *job,
+                                         unsigned int slice, unsigned int thread)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit =
+        container_of(job, struct upipe_unpack10bit, job);
+    unsigned int nb_slices = job->nb_slices;
+    int64_t pixels = upipe_unpack10bit->work_pixels;
+    int64_t size = ((pixels + nb_slices - 1) / nb_slices + 31) & ~31;
+    int64_t first = slice * size;
+    int64_t last = first + size;
+    if (first >= pixels)
+        return;
+    if (last > pixels)
+        last = pixels;
+
+    upipe_unpack10bit->unpack(upipe_unpack10bit->work_src + first * 5 / 2,
+                              upipe_unpack10bit->work_dst + first * 2,
+                              last - first);
+}
+
+/** @internal @This gets the number of unpacking threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_unpack10bit_get_threads(struct upipe *upipe,
+                                          unsigned int *threads_p)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_unpack10bit->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of unpacking threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_unpack10bit_set_threads(struct upipe *upipe,
+                                          unsigned int threads)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&upipe_unpack10bit->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
+    }
+    upipe_dbg_va(upipe, "unpacking with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This converts the current block. It is split into slices of
+ * pixels, shared between the worker threads and the calling thread. It returns
+ * when all slices are done.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_unpack10bit_work(struct upipe *upipe)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+    uslice_job_init(&upipe_unpack10bit->job, upipe_unpack10bit_work_slice,
+                    uslice_pool_get_threads(&upipe_unpack10bit->pool));
+    uslice_pool_run(&upipe_unpack10bit->pool, &upipe_unpack10bit->job);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -148,7 +239,10 @@ static bool upipe_unpack10bit_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
-    upipe_unpack10bit->unpack(input, (uint16_t *)out, (2*input_size) / 5);
+    upipe_unpack10bit->work_src = input;
+    upipe_unpack10bit->work_dst = (uint16_t *)out;
+    upipe_unpack10bit->work_pixels = (2*input_size) / 5;
+    upipe_unpack10bit_work(upipe);
 
     ubuf_block_unmap(ubuf_out, 0);
     uref_block_unmap(uref, 0);
@@ -309,6 +403,17 @@ static int upipe_unpack10bit_control(struct upipe *upipe, int command, va_list a
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_unpack10bit_set_flow_def(upipe, flow);
         }
+
+        case UPIPE_UNPACK10BIT_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UNPACK10BIT_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_unpack10bit_get_threads(upipe, threads_p);
+        }
+        case UPIPE_UNPACK10BIT_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UNPACK10BIT_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_unpack10bit_set_threads(upipe, threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -341,12 +446,18 @@ static struct upipe *upipe_unpack10bit_alloc(struct upipe_mgr *mgr,
     if (__builtin_cpu_supports("avx2"))
         upipe_unpack10bit->unpack = upipe_sdi_to_uyvy_avx2;
 #endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        upipe_unpack10bit->unpack = upipe_sdi_to_uyvy_avx512;
+#endif
 #endif
 
     upipe_unpack10bit_init_urefcount(upipe);
     upipe_unpack10bit_init_ubuf_mgr(upipe);
     upipe_unpack10bit_init_output(upipe);
     upipe_unpack10bit_init_input(upipe);
+    uslice_pool_init(&upipe_unpack10bit->pool);
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -358,7 +469,10 @@ static struct upipe *upipe_unpack10bit_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_unpack10bit_free(struct upipe *upipe)
 {
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
     upipe_throw_dead(upipe);
+
+    uslice_pool_clean(&upipe_unpack10bit->pool);
     upipe_unpack10bit_clean_input(upipe);
     upipe_unpack10bit_clean_output(upipe);
     upipe_unpack10bit_clean_ubuf_mgr(upipe);
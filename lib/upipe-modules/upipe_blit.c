@@ -43,6 +43,7 @@
 #include <upipe/upipe_helper_upump.h>
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_flow_format.h>
+#include <upipe/uslice.h>
 #include <upipe-modules/upipe_blit.h>
 
 #include <stdlib.h>
@@ -55,6 +56,21 @@
 /** we only accept pictures */
 #define EXPECTED_FLOW_DEF "pic."
 
+struct upipe_blit;
+struct upipe_blit_sub;
+
+/** @internal @This describes a horizontal band of the output picture. */
+struct upipe_blit_band {
+    /** first line of the band */
+    uint64_t top;
+    /** line following the last line of the band */
+    uint64_t bottom;
+    /** first subpipe which could not be blitted, or NULL */
+    struct upipe_blit_sub *failed;
+    /** error code of the failed blit */
+    int err;
+};
+
 /** @internal @This is the private context of a blit pipe */
 struct upipe_blit {
     /** refcount management structure */
@@ -106,6 +122,15 @@ struct upipe_blit {
     /** last received uref */
     struct uref *uref;
 
+    /** pool of compositing threads */
+    struct uslice_pool pool;
+    /** job of the picture being composited */
+    struct uslice_job job;
+    /** bands of the picture being composited */
+    struct upipe_blit_band bands[USLICE_MAX_THREADS];
+    /** picture being composited */
+    struct uref *work_uref;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -242,23 +267,33 @@ static struct upipe *upipe_blit_sub_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This blits the subpicture into the input uref.
-*
-* @param upipe description structure of the pipe
-* @param uref uref structure
-*/
-static void upipe_blit_sub_work(struct upipe *upipe, struct uref *uref)
+/** @internal @This blits the part of the subpicture falling into a band of
+ * the output picture. It may run on a worker thread, so it doesn't throw
+ * events and records the first failure in the band instead.
+ *
+ * @param sub description structure of the subpipe
+ * @param uref output picture
+ * @param band band of the output picture
+ */
+static void upipe_blit_sub_work(struct upipe_blit_sub *sub, struct uref *uref,
+                                struct upipe_blit_band *band)
 {
-    struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
     if (unlikely(sub->ubuf == NULL))
         return;
 
-    int err = uref_pic_blit(uref, sub->ubuf, sub->hposition, sub->vposition,
-                            0, 0, sub->hsize, sub->vsize, sub->alpha,
-                            sub->alpha_threshold);
-    if (unlikely(!ubase_check(err))) {
-        upipe_warn(upipe, "unable to blit picture");
-        upipe_throw_error(upipe, err);
+    uint64_t top = sub->vposition > band->top ? sub->vposition : band->top;
+    uint64_t bottom = sub->vposition + sub->vsize;
+    if (bottom > band->bottom)
+        bottom = band->bottom;
+    if (top >= bottom)
+        return;
+
+    int err = uref_pic_blit(uref, sub->ubuf, sub->hposition, top,
+                            0, top - sub->vposition, sub->hsize, bottom - top,
+                            sub->alpha, sub->alpha_threshold);
+    if (unlikely(!ubase_check(err)) && band->failed == NULL) {
+        band->failed = sub;
+        band->err = err;
     }
 }
 
@@ -888,6 +923,8 @@ static struct upipe *upipe_blit_alloc(struct upipe_mgr *mgr,
     upipe_blit_init_ubuf_mgr(upipe);
     upipe_blit->hsize = upipe_blit->vsize = UINT64_MAX;
     upipe_blit->uref = NULL;
+    uslice_pool_init(&upipe_blit->pool);
+    upipe_blit->work_uref = NULL;
     urequest_init(&upipe_blit->flow_format_proxy, UREQUEST_FLOW_FORMAT,
                   NULL, upipe_blit_provide_upstream_flow_format,
                   (urequest_free_func)free);
@@ -908,6 +945,107 @@ static void upipe_blit_sort(struct upipe *upipe)
     ulist_sort(&upipe_blit->subs, upipe_blit_sub_compare);
 }
 
+/** @internal @This blits all subpictures into a band of the output picture,
+ * in ascending z-index order.
+ *
+ * @param job job of the picture being composited
+ * @param slice index of the band
+ * @param thread index of the thread
+ */
+static void upipe_blit_work_band(struct uslice_job *job, unsigned int slice,
+                                 unsigned int thread)
+{
+    struct upipe_blit *upipe_blit = container_of(job, struct upipe_blit, job);
+    struct upipe_blit_band *band = &upipe_blit->bands[slice];
+    band->failed = NULL;
+    band->err = UBASE_ERR_NONE;
+
+    struct uchain *uchain;
+    ulist_foreach (&upipe_blit->subs, uchain) {
+        struct upipe_blit_sub *sub = upipe_blit_sub_from_uchain(uchain);
+        upipe_blit_sub_work(sub, upipe_blit->work_uref, band);
+    }
+}
+
+/** @internal @This gets the number of compositing threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_blit_get_threads(struct upipe *upipe,
+                                   unsigned int *threads_p)
+{
+    struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_blit->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of compositing threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_blit_set_threads(struct upipe *upipe, unsigned int threads)
+{
+    struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&upipe_blit->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
+    }
+    upipe_dbg_va(upipe, "compositing with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This blits all subpictures into the output picture. The picture
+ * is split into horizontal bands, shared between the worker threads and the
+ * calling thread. It returns when all bands are done.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref output picture
+ */
+static void upipe_blit_work(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+    struct upipe_blit_band *bands = upipe_blit->bands;
+    unsigned int nb_bands = uslice_pool_get_threads(&upipe_blit->pool);
+
+    /* bands start on a line shared by all planes */
+    size_t vsize = 0;
+    uref_pic_size(uref, NULL, &vsize, NULL);
+    uint8_t vsub = upipe_blit->vsub ?: 1;
+    uint64_t lines = vsize / nb_bands;
+    lines -= lines % vsub;
+    for (unsigned int i = 0; i < nb_bands; i++) {
+        bands[i].top = i * lines;
+        bands[i].bottom = i == nb_bands - 1 ? vsize : (i + 1) * lines;
+    }
+
+    upipe_blit->work_uref = uref;
+    uslice_job_init(&upipe_blit->job, upipe_blit_work_band, nb_bands);
+    uslice_pool_run(&upipe_blit->pool, &upipe_blit->job);
+    upipe_blit->work_uref = NULL;
+
+    for (unsigned int i = 0; i < nb_bands; i++) {
+        struct upipe_blit_sub *sub = bands[i].failed;
+        if (sub == NULL)
+            continue;
+        /* report each subpipe once */
+        unsigned int j;
+        for (j = 0; j < i && bands[j].failed != sub; j++);
+        if (j < i)
+            continue;
+
+        struct upipe *sub_upipe = upipe_blit_sub_to_upipe(sub);
+        upipe_warn(sub_upipe, "unable to blit picture");
+        upipe_throw_error(sub_upipe, bands[i].err);
+    }
+}
+
 /** @internal @This receives incoming uref.
  *
  * @param upipe description structure of the pipe
@@ -1059,10 +1197,7 @@ static int _upipe_blit_prepare(struct upipe *upipe, struct upump **upump_p)
         uref_attach_ubuf(uref, ubuf);
     }
 
-    ulist_foreach (&upipe_blit->subs, uchain) {
-        struct upipe_blit_sub *sub = upipe_blit_sub_from_uchain(uchain);
-        upipe_blit_sub_work(upipe_blit_sub_to_upipe(sub), uref);
-    }
+    upipe_blit_work(upipe, uref);
 
     upipe_blit_output(upipe, uref, upump_p);
     return UBASE_ERR_NONE;
@@ -1262,6 +1397,16 @@ static int upipe_blit_control_real(struct upipe *upipe,
             struct upump **upump_p = va_arg(args, struct upump **);
             return _upipe_blit_prepare(upipe, upump_p);
         }
+        case UPIPE_BLIT_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_BLIT_SIGNATURE);
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_blit_get_threads(upipe, threads_p);
+        }
+        case UPIPE_BLIT_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_BLIT_SIGNATURE);
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_blit_set_threads(upipe, threads);
+        }
 
         case UPIPE_ATTACH_UPUMP_MGR:
             upipe_blit_set_idler(upipe, NULL);
@@ -1293,6 +1438,7 @@ static void upipe_blit_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+    uslice_pool_clean(&upipe_blit->pool);
     uref_free(upipe_blit->uref);
     urequest_clean(&upipe_blit->flow_format_proxy);
     upipe_blit_clean_ubuf_mgr(upipe);
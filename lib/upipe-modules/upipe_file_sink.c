@@ -48,6 +48,7 @@
 #include <upipe/upipe_helper_input.h>
 #include <upipe/upipe_helper_uclock.h>
 #include <upipe-modules/upipe_file_sink.h>
+#include <upump-uring/upump_uring.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -97,6 +98,17 @@ struct upipe_fsink {
     char *path;
     /** sync period */
     uint64_t sync_period;
+    /** true if the file is regular and doesn't support poll() */
+    bool regular_file;
+
+    /** true if the upump manager can't queue writes */
+    bool no_uring;
+    /** write queued on the upump manager */
+    struct upump_uring_io io;
+    /** buffer of the queued write, or NULL */
+    struct uref *io_uref;
+    /** true if the queued write was for a previous file */
+    bool io_stale;
 
     /** temporary uref storage */
     struct uchain urefs;
@@ -147,6 +159,10 @@ static struct upipe *upipe_fsink_alloc(struct upipe_mgr *mgr,
     upipe_fsink->fd = -1;
     upipe_fsink->path = NULL;
     upipe_fsink->sync_period = 0;
+    upipe_fsink->regular_file = false;
+    upipe_fsink->no_uring = false;
+    upipe_fsink->io_uref = NULL;
+    upipe_fsink->io_stale = false;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -174,6 +190,107 @@ static void upipe_fsink_poll(struct upipe *upipe)
     }
 }
 
+/** @internal @This outputs the buffers held while the sink was blocked, and
+ * unblocks the sources.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_output_held(struct upipe *upipe)
+{
+    upipe_fsink_output_input(upipe);
+    upipe_fsink_unblock_input(upipe);
+    if (upipe_fsink_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_fsink_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This is called from the event loop when a queued write
+ * completes. It then plays the role of the write watcher.
+ *
+ * @param io description of the write
+ * @param ret number of octets written, or negative errno
+ */
+static void upipe_fsink_write_cb(struct upump_uring_io *io, int ret)
+{
+    struct upipe *upipe = io->opaque;
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    struct uref *uref = upipe_fsink->io_uref;
+    upipe_fsink->io_uref = NULL;
+    uref_block_unmap(uref, 0);
+
+    size_t uref_size;
+    if (unlikely(upipe_fsink->io_stale)) {
+        upipe_fsink->io_stale = false;
+        uref_free(uref);
+    } else if (unlikely(ret < 0 && ret != -EINTR && ret != -EAGAIN)) {
+        uref_free(uref);
+        errno = -ret;
+        upipe_warn_va(upipe, "write error to %s (%m)", upipe_fsink->path);
+        upipe_fsink_set_upump(upipe, NULL);
+        upipe_fsink_set_upump_sync(upipe, NULL);
+        upipe_throw_sink_end(upipe);
+    } else if (ret >= 0 && ubase_check(uref_block_size(uref, &uref_size)) &&
+               uref_size == ret) {
+        uref_free(uref);
+    } else {
+        /* write the rest before the held buffers */
+        if (ret > 0)
+            uref_block_resize(uref, ret, -1);
+        if (upipe_fsink_check_input(upipe))
+            /* Released in @ref upipe_fsink_output_held. */
+            upipe_use(upipe);
+        upipe_fsink_unshift_input(upipe, uref);
+    }
+
+    if (!upipe_fsink_check_input(upipe))
+        upipe_fsink_output_held(upipe);
+    /* Release the pipe used in @ref upipe_fsink_queue_write. */
+    upipe_release(upipe);
+}
+
+/** @internal @This queues the write of the first segment of a buffer to a
+ * regular file on the upump manager, so that the event loop doesn't wait
+ * for the disk. Only one write is queued at a time, at the current file
+ * position.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref buffer, which belongs to the queued write on success
+ * @return an error code, including @ref UBASE_ERR_UNHANDLED if the upump
+ * manager can't queue writes
+ */
+static int upipe_fsink_queue_write(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    int size = -1;
+    const uint8_t *buffer;
+    UBASE_RETURN(uref_block_read(uref, 0, &size, &buffer))
+    if (unlikely(!size)) {
+        uref_block_unmap(uref, 0);
+        return UBASE_ERR_INVALID;
+    }
+
+    struct upump_uring_io *io = &upipe_fsink->io;
+    io->type = UPUMP_URING_IO_WRITE;
+    io->fd = upipe_fsink->fd;
+    io->buf = (void *)buffer;
+    io->len = size;
+    io->offset = (uint64_t)-1;
+    io->cb = upipe_fsink_write_cb;
+    io->opaque = upipe;
+    int err = upump_uring_mgr_submit(upipe_fsink->upump_mgr, io);
+    if (unlikely(!ubase_check(err))) {
+        uref_block_unmap(uref, 0);
+        return err;
+    }
+
+    upipe_fsink->io_uref = uref;
+    /* keep the pipe alive until the write completes */
+    upipe_use(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This outputs data to the file sink.
  *
  * @param upipe description structure of the pipe
@@ -201,6 +318,10 @@ static bool upipe_fsink_output(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    if (unlikely(upipe_fsink->io_uref != NULL))
+        /* wait for the queued write to complete */
+        return false;
+
     if (likely(upipe_fsink->uclock == NULL))
         goto write_buffer;
 
@@ -218,6 +339,17 @@ static bool upipe_fsink_output(struct upipe *upipe, struct uref *uref,
     }
 
 write_buffer:
+    if (upipe_fsink->regular_file && !upipe_fsink->no_uring &&
+        upipe_fsink->upump_mgr != NULL) {
+        int err = upipe_fsink_queue_write(upipe, uref);
+        if (likely(ubase_check(err)))
+            return true;
+        if (err == UBASE_ERR_UNHANDLED) {
+            upipe_dbg(upipe, "upump manager can't queue writes");
+            upipe_fsink->no_uring = true;
+        }
+    }
+
     for ( ; ; ) {
         int iovec_count = uref_block_iovec_count(uref, 0, -1);
         if (unlikely(iovec_count == -1)) {
@@ -288,13 +420,7 @@ static void upipe_fsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     upipe_fsink_set_upump(upipe, NULL);
-    upipe_fsink_output_input(upipe);
-    upipe_fsink_unblock_input(upipe);
-    if (upipe_fsink_check_input(upipe)) {
-        /* All packets have been output, release again the pipe that has been
-         * used in @ref upipe_fsink_input. */
-        upipe_release(upipe);
-    }
+    upipe_fsink_output_held(upipe);
 }
 
 /** @internal @This is called when the file descriptor needs to be sync'ed.
@@ -382,6 +508,33 @@ static int _upipe_fsink_get_path(struct upipe *upipe, const char **path_p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This discards the rest of the queued write, if any, because
+ * the file is closed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_cancel_write(struct upipe *upipe)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    if (upipe_fsink->io_uref == NULL || upipe_fsink->io_stale)
+        return;
+    upipe_fsink->io_stale = true;
+    upump_uring_mgr_cancel(upipe_fsink->upump_mgr, &upipe_fsink->io);
+}
+
+/** @internal @This checks whether the opened file is regular, in which case
+ * poll() is meaningless and writes may be queued.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_check_regular(struct upipe *upipe)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    struct stat st;
+    upipe_fsink->regular_file = fstat(upipe_fsink->fd, &st) != -1 &&
+                                S_ISREG(st.st_mode);
+}
+
 /** @internal @This asks to open the given file.
  *
  * @param upipe description structure of the pipe
@@ -402,6 +555,7 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
     ubase_clean_str(&upipe_fsink->path);
     upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
+    upipe_fsink_cancel_write(upipe);
     if (!upipe_fsink_check_input(upipe))
         /* Release the pipe used in @ref upipe_fsink_input. */
         upipe_release(upipe);
@@ -439,6 +593,7 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
         upipe_err_va(upipe, "can't open file %s (%s)", path, mode_desc);
         return UBASE_ERR_EXTERNAL;
     }
+    upipe_fsink_check_regular(upipe);
     switch (mode) {
         /* O_APPEND seeks on each write, so use this instead */
         case UPIPE_FSINK_APPEND:
@@ -486,6 +641,7 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
     ubase_clean_str(&upipe_fsink->path);
     upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
+    upipe_fsink_cancel_write(upipe);
     if (!upipe_fsink_check_input(upipe))
         /* Release the pipe used in @ref upipe_fsink_input. */
         upipe_release(upipe);
@@ -513,6 +669,7 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
             return UBASE_ERR_INVALID;
     }
     upipe_fsink->fd = fd;
+    upipe_fsink_check_regular(upipe);
     switch (mode) {
         /* O_APPEND seeks on each write, so use this instead */
         case UPIPE_FSINK_APPEND:
@@ -589,10 +746,13 @@ static int  _upipe_fsink_control(struct upipe *upipe, int command, va_list args)
         case UPIPE_UNREGISTER_REQUEST:
             return upipe_control_provide_request(upipe, command, args);
 
-        case UPIPE_ATTACH_UPUMP_MGR:
+        case UPIPE_ATTACH_UPUMP_MGR: {
+            struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
             upipe_fsink_set_upump(upipe, NULL);
             upipe_fsink_set_upump_sync(upipe, NULL);
+            upipe_fsink->no_uring = false;
             return upipe_fsink_attach_upump_mgr(upipe);
+        }
         case UPIPE_ATTACH_UCLOCK:
             upipe_fsink_set_upump(upipe, NULL);
             upipe_fsink_set_upump_sync(upipe, NULL);
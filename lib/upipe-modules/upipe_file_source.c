@@ -51,6 +51,7 @@
 #include <upipe/upipe_helper_uclock.h>
 #include <upipe/upipe_helper_output_size.h>
 #include <upipe-modules/upipe_file_source.h>
+#include <upump-uring/upump_uring.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -123,6 +124,17 @@ struct upipe_fsrc {
     /** length to read */
     uint64_t length;
 
+    /** true if the upump manager can't queue reads */
+    bool no_uring;
+    /** read queued on the upump manager */
+    struct upump_uring_io io;
+    /** buffer of the queued read, or NULL */
+    struct uref *io_uref;
+    /** system date of the queued read */
+    uint64_t io_systime;
+    /** true if the result of the queued read must be discarded */
+    bool io_stale;
+
     /** public upipe structure */
     struct upipe upipe;
     /** guard for upump */
@@ -177,16 +189,39 @@ static struct upipe *upipe_fsrc_alloc(struct upipe_mgr *mgr,
     upipe_fsrc->uri = NULL;
     upipe_fsrc->fd = -1;
     upipe_fsrc->length = (uint64_t)-1;
+    upipe_fsrc->no_uring = false;
+    upipe_fsrc->io_uref = NULL;
+    upipe_fsrc->io_stale = false;
     upipe_fsrc->safe = false;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This discards the result of the queued read, if any, moves
+ * the file position back to the beginning of the read, and restarts the
+ * idler.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsrc_cancel_read(struct upipe *upipe)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    if (upipe_fsrc->io_uref == NULL || upipe_fsrc->io_stale)
+        return;
+    upipe_fsrc->io_stale = true;
+    upump_uring_mgr_cancel(upipe_fsrc->upump_mgr, &upipe_fsrc->io);
+    if (upipe_fsrc->fd != -1)
+        lseek(upipe_fsrc->fd, upipe_fsrc->io.offset, SEEK_SET);
+    if (upipe_fsrc->upump != NULL)
+        upump_start(upipe_fsrc->upump);
+}
+
 static void upipe_fsrc_set_upump_safe(struct upipe *upipe,
                                       struct upump *upump)
 {
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     upipe_fsrc->safe = false;
+    upipe_fsrc_cancel_read(upipe);
     upipe_fsrc_set_upump(upipe, upump);
 }
 
@@ -205,6 +240,134 @@ static int upipe_fsrc_get_uri(struct upipe *upipe, const char **path_p)
     return uref_uri_get_path(upipe_fsrc->uri, path_p);
 }
 
+/** @internal @This outputs the buffer filled in by a read.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref buffer
+ * @param ret number of octets read, or negative errno
+ * @param systime system date of the read
+ */
+static void upipe_fsrc_output_read(struct upipe *upipe, struct uref *uref,
+                                   ssize_t ret, uint64_t systime)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    if (unlikely(ret < 0)) {
+        uref_free(uref);
+        switch (-ret) {
+            case EINTR:
+            case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+            case EWOULDBLOCK:
+#endif
+                /* not an issue, try again later */
+                return;
+            case EBADF:
+            case EINVAL:
+            case EIO:
+            default:
+                break;
+        }
+        errno = -ret;
+        const char *path = "(none)";
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_err_va(upipe, "read error from %s (%m)", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+    if (upipe_fsrc->length != (uint64_t)-1)
+        upipe_fsrc->length -= ret;
+    if (upipe_fsrc->uclock != NULL)
+        uref_clock_set_cr_sys(uref, systime);
+    if (unlikely(ret != upipe_fsrc->output_size))
+        uref_block_resize(uref, 0, ret);
+    if (unlikely(ret == 0))
+        uref_block_set_end(uref);
+    upipe_fsrc->safe = true;
+    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
+    if (likely(upipe_fsrc->safe) && unlikely(ret == 0)) {
+        const char *path = "(none)";
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of file %s", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+    }
+}
+
+/** @internal @This is called from the event loop when a queued read
+ * completes.
+ *
+ * @param io description of the read
+ * @param ret number of octets read, or negative errno
+ */
+static void upipe_fsrc_read_cb(struct upump_uring_io *io, int ret)
+{
+    struct upipe *upipe = io->opaque;
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    struct uref *uref = upipe_fsrc->io_uref;
+    upipe_fsrc->io_uref = NULL;
+    uref_block_unmap(uref, 0);
+
+    if (unlikely(upipe_fsrc->io_stale)) {
+        upipe_fsrc->io_stale = false;
+        uref_free(uref);
+    } else {
+        /* the queued read used an explicit offset */
+        if (ret >= 0 && ret < upipe_fsrc->output_size)
+            lseek(upipe_fsrc->fd, io->offset + ret, SEEK_SET);
+        upipe_fsrc_output_read(upipe, uref, ret, upipe_fsrc->io_systime);
+        if (upipe_fsrc->upump != NULL)
+            upump_start(upipe_fsrc->upump);
+    }
+    /* release the pipe used in @ref upipe_fsrc_queue_read */
+    upipe_release(upipe);
+}
+
+/** @internal @This queues a read of a regular file on the upump manager,
+ * so that the event loop doesn't wait for the disk. The file position is
+ * moved past the buffer at once, and the idler is stopped until the read
+ * completes.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref buffer, mapped for writing
+ * @param buffer pointer to the mapped buffer
+ * @param systime system date of the read
+ * @return an error code, including @ref UBASE_ERR_UNHANDLED if the upump
+ * manager can't queue reads
+ */
+static int upipe_fsrc_queue_read(struct upipe *upipe, struct uref *uref,
+                                 uint8_t *buffer, uint64_t systime)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    off_t position = lseek(upipe_fsrc->fd, upipe_fsrc->output_size,
+                           SEEK_CUR);
+    if (unlikely(position == (off_t)-1))
+        return UBASE_ERR_EXTERNAL;
+
+    struct upump_uring_io *io = &upipe_fsrc->io;
+    io->type = UPUMP_URING_IO_READ;
+    io->fd = upipe_fsrc->fd;
+    io->buf = buffer;
+    io->len = upipe_fsrc->output_size;
+    io->offset = position - upipe_fsrc->output_size;
+    io->cb = upipe_fsrc_read_cb;
+    io->opaque = upipe;
+    int err = upump_uring_mgr_submit(upipe_fsrc->upump_mgr, io);
+    if (unlikely(!ubase_check(err))) {
+        lseek(upipe_fsrc->fd, io->offset, SEEK_SET);
+        return err;
+    }
+
+    upipe_fsrc->io_uref = uref;
+    upipe_fsrc->io_systime = systime;
+    upump_stop(upipe_fsrc->upump);
+    /* keep the pipe alive until the read completes */
+    upipe_use(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This reads data from the source and outputs it.
  * It is called either when the idler triggers (permanent storage mode) or
  * when data is available on the file descriptor (live stream mode).
@@ -255,51 +418,19 @@ static void upipe_fsrc_worker(struct upump *upump)
     }
     assert(output_size == upipe_fsrc->output_size);
 
-    ssize_t ret = read(upipe_fsrc->fd, buffer, upipe_fsrc->output_size);
-    uref_block_unmap(uref, 0);
-
-    if (unlikely(ret == -1)) {
-        uref_free(uref);
-        switch (errno) {
-            case EINTR:
-            case EAGAIN:
-#if EAGAIN != EWOULDBLOCK
-            case EWOULDBLOCK:
-#endif
-                /* not an issue, try again later */
-                return;
-            case EBADF:
-            case EINVAL:
-            case EIO:
-            default:
-                break;
+    if (upipe_fsrc->regular_file && !upipe_fsrc->no_uring) {
+        int err = upipe_fsrc_queue_read(upipe, uref, buffer, systime);
+        if (likely(ubase_check(err)))
+            return;
+        if (err == UBASE_ERR_UNHANDLED) {
+            upipe_dbg(upipe, "upump manager can't queue reads");
+            upipe_fsrc->no_uring = true;
         }
-        const char *path = "(none)";
-        upipe_fsrc_get_uri(upipe, &path);
-        upipe_err_va(upipe, "read error from %s (%m)", path);
-        upipe_fsrc_set_upump_safe(upipe, NULL);
-        ubase_clean_fd(&upipe_fsrc->fd);
-        upipe_throw_source_end(upipe);
-        return;
-    }
-    if (upipe_fsrc->length != (uint64_t)-1)
-        upipe_fsrc->length -= ret;
-    if (upipe_fsrc->uclock != NULL)
-        uref_clock_set_cr_sys(uref, systime);
-    if (unlikely(ret != upipe_fsrc->output_size))
-        uref_block_resize(uref, 0, ret);
-    if (unlikely(ret == 0))
-        uref_block_set_end(uref);
-    upipe_fsrc->safe = true;
-    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
-    if (likely(upipe_fsrc->safe) && unlikely(ret == 0)) {
-        const char *path = "(none)";
-        upipe_fsrc_get_uri(upipe, &path);
-        upipe_notice_va(upipe, "end of file %s", path);
-        upipe_fsrc_set_upump_safe(upipe, NULL);
-        ubase_clean_fd(&upipe_fsrc->fd);
-        upipe_throw_source_end(upipe);
     }
+
+    ssize_t ret = read(upipe_fsrc->fd, buffer, upipe_fsrc->output_size);
+    uref_block_unmap(uref, 0);
+    upipe_fsrc_output_read(upipe, uref, ret == -1 ? -errno : ret, systime);
 }
 
 /** @internal @This builds the flow definition.
@@ -532,6 +663,7 @@ static int _upipe_fsrc_set_position(struct upipe *upipe, uint64_t position)
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    upipe_fsrc_cancel_read(upipe);
     return lseek(upipe_fsrc->fd, position, SEEK_SET) != (off_t)-1 ?
         UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
 }
@@ -597,9 +729,12 @@ static int _upipe_fsrc_get_range(struct upipe *upipe,
  */
 static int _upipe_fsrc_control(struct upipe *upipe, int command, va_list args)
 {
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+
     switch (command) {
         case UPIPE_ATTACH_UPUMP_MGR:
             upipe_fsrc_set_upump_safe(upipe, NULL);
+            upipe_fsrc->no_uring = false;
             return upipe_fsrc_attach_upump_mgr(upipe);
         case UPIPE_ATTACH_UCLOCK:
             upipe_fsrc_set_upump_safe(upipe, NULL);
@@ -53,6 +53,9 @@
 #include <string.h>
 #include <assert.h>
 
+/** maximum number of held urefs pushed at once */
+#define PUSH_BATCH 32
+
 /** @hidden */
 static void upipe_qsink_watcher(struct upump *upump);
 /** @hidden */
@@ -163,6 +166,36 @@ static bool upipe_qsink_output(struct upipe *upipe, struct uref *uref,
                        uref_to_uchain(uref));
 }
 
+/** @internal @This outputs the held urefs to the queue. They are pushed
+ * several at once, so that the queue source is woken up once per batch.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the queue is full and urefs are still held
+ */
+static bool upipe_qsink_output_held(struct upipe *upipe)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct uqueue *uqueue = &upipe_queue(upipe_qsink->qsrc)->uqueue;
+    while (!ulist_empty(&upipe_qsink->urefs)) {
+        void *elems[PUSH_BATCH];
+        unsigned int nb = 0;
+        struct uchain *uchain;
+        while (nb < PUSH_BATCH &&
+               (uchain = ulist_pop(&upipe_qsink->urefs)) != NULL)
+            elems[nb++] = uchain;
+
+        unsigned int pushed = uqueue_push_batch(uqueue, elems, nb);
+        upipe_qsink->nb_urefs -= pushed;
+        if (pushed < nb) {
+            /* keep the urefs which didn't fit, in order */
+            while (nb > pushed)
+                ulist_unshift(&upipe_qsink->urefs, elems[--nb]);
+            return false;
+        }
+    }
+    return true;
+}
+
 /** @internal @This is called when the queue can be written again.
  * Unblock the sink.
  *
@@ -171,7 +204,7 @@ static bool upipe_qsink_output(struct upipe *upipe, struct uref *uref,
 static void upipe_qsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
-    upipe_qsink_output_input(upipe);
+    upipe_qsink_output_held(upipe);
     upipe_qsink_unblock_input(upipe);
     if (upipe_qsink_check_input(upipe)) {
         upump_stop(upump);
@@ -28,7 +28,8 @@
  *
  * Note that the allocator requires an additional parameter:
  * @table 2
- * @item queue_length @item maximum length of the queue (<= 255)
+ * @item queue_length @item maximum length of the queue (<=
+ * @ref UQUEUE_MAX_LENGTH)
  * @end table
  *
  * Also note that this module is exceptional in that upipe_release() may be
@@ -58,6 +59,8 @@
 
 /** maximum length of out of band queues */
 #define OOB_QUEUES 255
+/** maximum number of urefs output per wake-up */
+#define POP_BATCH 32
 
 /** @internal @This is the private context of a queue source pipe. */
 struct upipe_qsrc {
@@ -80,6 +83,9 @@ struct upipe_qsrc {
     /** list of output requests */
     struct uchain request_list;
 
+    /** urefs popped from the queue but not output yet */
+    struct uchain urefs;
+
     /** structure exported to the sinks */
     struct upipe_queue upipe_queue;
 
@@ -111,7 +117,7 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
     if (signature != UPIPE_QSRC_SIGNATURE)
         goto upipe_qsrc_alloc_err;
     unsigned int length = va_arg(args, unsigned int);
-    if (!length || length > UINT8_MAX)
+    if (!length || length > UQUEUE_MAX_LENGTH)
         goto upipe_qsrc_alloc_err;
 
     struct upipe_qsrc *upipe_qsrc = malloc(sizeof(struct upipe_qsrc) +
@@ -139,6 +145,7 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
     upipe_qsrc_init_upump_mgr(upipe);
     upipe_qsrc_init_upump(upipe);
     upipe_qsrc_init_upump_oob(upipe);
+    ulist_init(&upipe_qsrc->urefs);
     upipe_qsrc->upipe_queue.max_length = length;
     upipe_throw_ready(upipe);
 
@@ -167,7 +174,10 @@ static void upipe_qsrc_input(struct upipe *upipe, struct uref *uref,
     upipe_qsrc_output(upipe, uref, upump_p);
 }
 
-/** @internal @This reads data from the queue and outputs it.
+/** @internal @This reads data from the queue and outputs it. Several urefs
+ * are popped at once, to save wake-ups of the event loop. If the output
+ * blocks the pump or the pump is released, the remaining urefs are kept
+ * and output first at the next wake-up.
  *
  * @param upump description structure of the read watcher
  */
@@ -175,9 +185,41 @@ static void upipe_qsrc_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
-    struct uref *uref = uqueue_pop(&upipe_queue(upipe)->uqueue, struct uref *);
-    if (likely(uref != NULL))
-        upipe_qsrc_input(upipe, uref, &upipe_qsrc->upump);
+    if (ulist_empty(&upipe_qsrc->urefs)) {
+        void *elems[POP_BATCH];
+        unsigned int nb = uqueue_pop_batch(&upipe_queue(upipe)->uqueue, elems,
+                                           POP_BATCH);
+        for (unsigned int i = 0; i < nb; i++)
+            ulist_add(&upipe_qsrc->urefs, elems[i]);
+    }
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_qsrc->urefs)) != NULL) {
+        upipe_qsrc_input(upipe, uref_from_uchain(uchain), &upipe_qsrc->upump);
+
+        if (upipe_qsrc->upump != upump)
+            break;
+        bool blocked;
+        if (ubase_check(upump_get_blocked(upump, &blocked)) && blocked)
+            break;
+    }
+}
+
+/** @internal @This outputs all the urefs kept or still in the queue.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_qsrc_drain(struct upipe *upipe)
+{
+    struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_qsrc->urefs)) != NULL)
+        upipe_qsrc_input(upipe, uref_from_uchain(uchain), NULL);
+
+    struct uref *uref;
+    while ((uref = uqueue_pop(&upipe_queue(upipe)->uqueue,
+                              struct uref *)) != NULL)
+        upipe_qsrc_input(upipe, uref, NULL);
 }
 
 /** @internal @This handles the result of a request.
@@ -267,11 +309,7 @@ static int upipe_qsrc_unregister_request(struct upipe *upipe,
  */
 static void upipe_qsrc_source_end(struct upipe *upipe)
 {
-    struct uref *uref;
-    while ((uref = uqueue_pop(&upipe_queue(upipe)->uqueue,
-                              struct uref *)) != NULL)
-        upipe_qsrc_input(upipe, uref, NULL);
-
+    upipe_qsrc_drain(upipe);
     upipe_throw_source_end(upipe);
 }
 
@@ -282,10 +320,7 @@ static void upipe_qsrc_source_end(struct upipe *upipe)
  */
 static void upipe_qsrc_ref_end(struct upipe *upipe)
 {
-    struct uref *uref;
-    while ((uref = uqueue_pop(&upipe_queue(upipe)->uqueue,
-                              struct uref *)) != NULL)
-        upipe_qsrc_input(upipe, uref, NULL);
+    upipe_qsrc_drain(upipe);
 
     upipe_dbg_va(upipe, "freeing queue %p", upipe);
     upipe_throw_dead(upipe);
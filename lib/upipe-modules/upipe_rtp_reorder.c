@@ -39,6 +39,7 @@
 #include <upipe/uclock.h>
 #include <upipe/upipe.h>
 #include <upipe/ulist.h>
+#include <upipe/useqring.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_upump_mgr.h>
 #include <upipe/upipe_helper_upump.h>
@@ -98,7 +99,12 @@ struct upipe_rtpr {
     /** manager to create subs */
     struct upipe_mgr sub_mgr;
 
-    struct uchain queue;
+    /** packets waiting to be output, indexed by sequence number */
+    struct useqring queue;
+    /** extra space for the queue */
+    void *queue_extra;
+    /** highest sequence number in the queue */
+    uint16_t last_seqnum;
 
     uint64_t last_sent_seqnum;
     uint64_t num_consecutive_late;
@@ -160,6 +166,33 @@ static inline bool seq_num_lt(uint16_t s1, uint16_t s2)
         return 0;
 }
 
+/** @internal @This outputs the first packet of the queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param seqnum sequence number of the first packet
+ */
+static void upipe_rtpr_output_seqnum(struct upipe *upipe, uint16_t seqnum)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    struct uref *uref = useqring_remove(&rtpr->queue, seqnum);
+    useqring_set_head(&rtpr->queue, seqnum + 1);
+    rtpr->last_sent_seqnum = seqnum;
+    upipe_rtpr_output(upipe, uref, NULL);
+}
+
+/** @internal @This outputs all packets of the queue.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtpr_flush(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    uint16_t seqnum;
+
+    while (useqring_next(&rtpr->queue, useqring_head(&rtpr->queue), &seqnum))
+        upipe_rtpr_output_seqnum(upipe, seqnum);
+}
+
 static void upipe_rtpr_timer(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
@@ -167,23 +200,16 @@ static void upipe_rtpr_timer(struct upump *upump)
     uint64_t now = uclock_now(rtpr->uclock);
     uint64_t date_sys;
     int type;
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
+    uint16_t seqnum;
 
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
+    while (useqring_next(&rtpr->queue, useqring_head(&rtpr->queue), &seqnum)) {
+        struct uref *uref = useqring_peek(&rtpr->queue, seqnum);
         uref_clock_get_date_sys(uref, &date_sys, &type);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
 
-        if (now >= date_sys || date_sys == UINT64_MAX) {
-            ulist_delete(uchain);
-            upipe_rtpr_output(upipe, uref, NULL);
-            rtpr->last_sent_seqnum = seqnum;
-        }
-        else {
+        if (type == UREF_DATE_NONE || now >= date_sys)
+            upipe_rtpr_output_seqnum(upipe, seqnum);
+        else
             break;
-        }
     }
 }
 
@@ -298,8 +324,6 @@ static int upipe_rtpr_sub_control(struct upipe *upipe,
 static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    int dup = 0, ooo = 0;
-    struct uchain *uchain, *uchain_tmp;
 
     uint8_t rtp_buffer[RTP_HEADER_SIZE];
     const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
@@ -311,7 +335,6 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
         return;
     }
     uint16_t new_seqnum = rtp_get_seqnum(rtp_header);
-    uref_attr_set_priv(uref, new_seqnum);
     uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
     /* Drop late packets */
@@ -329,46 +352,42 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 
     rtpr->num_consecutive_late = 0;
 
-    /* Remove date_sys for any late packets */
-    ulist_delete_foreach_reverse(&rtpr->queue, uchain, uchain_tmp) {
-        struct uref *cur_uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(cur_uref, &seqnum);
-
-        if (seq_num_lt(new_seqnum, seqnum)) {
-            if (ulist_is_first(&rtpr->queue, uchain)) {
-                uref_clock_delete_date_sys(uref);
-                ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                ooo = 1;
-                break;
-            }
-            else {
-                struct uref *prev_uref = uref_from_uchain(uchain->prev);
-                uint64_t prev_seqnum = 0;
-                uref_attr_get_priv(prev_uref, &prev_seqnum);
-                if (!seq_num_lt(new_seqnum, prev_seqnum) && !(new_seqnum == prev_seqnum)) {
-                    uref_clock_delete_date_sys(uref);
-                    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                    ooo = 1;
-                    break;
-                }
-            }
-        }
-        /* Duplicate packet */
-        else if (new_seqnum == seqnum) {
-            dup = 1;
-            uref_free(uref);
-            break;
-        }
+    if (!useqring_count(&rtpr->queue)) {
+        /* keep the window right after the last output packet, so that
+         * packets received out of order can still be inserted */
+        if (rtpr->last_sent_seqnum != UINT64_MAX)
+            useqring_set_head(&rtpr->queue, rtpr->last_sent_seqnum + 1);
         else
-            break;
+            useqring_set_head(&rtpr->queue, new_seqnum);
+        rtpr->last_seqnum = new_seqnum;
+    } else if (rtpr->last_sent_seqnum == UINT64_MAX &&
+               seq_num_lt(new_seqnum, useqring_head(&rtpr->queue))) {
+        /* nothing was output yet, extend the queue backwards */
+        useqring_set_head(&rtpr->queue, new_seqnum);
     }
 
-
-    /* Add to end if normal packet */
-    if (!dup && !ooo) {
-        ulist_add(&rtpr->queue, uref_to_uchain(uref));
+    switch (useqring_insert(&rtpr->queue, new_seqnum, uref)) {
+        case USEQRING_INSERTED:
+            break;
+        case USEQRING_AHEAD:
+            /* the queue cannot span this far, output what it holds */
+            upipe_warn_va(upipe, "jump to seqnum %hu, flushing", new_seqnum);
+            upipe_rtpr_flush(upipe);
+            useqring_set_head(&rtpr->queue, new_seqnum);
+            useqring_insert(&rtpr->queue, new_seqnum, uref);
+            rtpr->last_seqnum = new_seqnum;
+            return;
+        default:
+            /* Duplicate packet */
+            uref_free(uref);
+            return;
     }
+
+    /* Remove date_sys for any late packets */
+    if (seq_num_lt(new_seqnum, rtpr->last_seqnum))
+        uref_clock_delete_date_sys(uref);
+    else
+        rtpr->last_seqnum = new_seqnum;
 }
 
 /** @internal @This receives data.
@@ -446,14 +465,8 @@ static void upipe_rtpr_init_sub_mgr(struct upipe *upipe)
 static void upipe_rtpr_clean_queue(struct upipe *upipe)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
-
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    useqring_clean(&rtpr->queue);
+    free(rtpr->queue_extra);
 }
 
 /** @internal @This allocates a rtpr pipe.
@@ -473,6 +486,15 @@ static struct upipe *upipe_rtpr_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    upipe_rtpr->queue_extra = malloc(useqring_sizeof(USEQRING_MAX_SIZE));
+    if (unlikely(upipe_rtpr->queue_extra == NULL)) {
+        upipe_rtpr_free_void(upipe);
+        return NULL;
+    }
+    useqring_init(&upipe_rtpr->queue, USEQRING_MAX_SIZE,
+                  upipe_rtpr->queue_extra);
+    upipe_rtpr->last_seqnum = 0;
+
     upipe_rtpr_init_urefcount(upipe);
 
     urefcount_init(upipe_rtpr_to_urefcount_real(upipe_rtpr),
@@ -485,8 +507,6 @@ static struct upipe *upipe_rtpr_alloc(struct upipe_mgr *mgr,
     upipe_rtpr_init_sub_mgr(upipe);
     upipe_rtpr_init_sub_inputs(upipe);
 
-    ulist_init(&upipe_rtpr->queue);
-
     upipe_rtpr->last_sent_seqnum = UINT64_MAX;
     upipe_rtpr->num_consecutive_late = 0;
     upipe_rtpr->delay = UCLOCK_FREQ/10;
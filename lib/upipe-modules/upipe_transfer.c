@@ -69,7 +69,7 @@ struct upipe_xfer_mgr {
     /** remote upump_mgr */
     struct upump_mgr *upump_mgr;
     /** queue length */
-    uint8_t queue_length;
+    unsigned int queue_length;
     /** queue of messages */
     struct uqueue uqueue;
     /** pool of @ref upipe_xfer_msg */
@@ -716,7 +716,7 @@ static int upipe_xfer_mgr_control(struct upipe_mgr *mgr,
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
  * @return pointer to manager
  */
-struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_xfer_mgr_alloc(unsigned int queue_length,
                                        uint16_t msg_pool_depth,
                                        struct umutex *mutex)
 {
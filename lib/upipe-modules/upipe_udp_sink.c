@@ -28,6 +28,8 @@
  * @short Upipe sink module for udp
  */
 
+#include <config.h>
+
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
@@ -56,10 +58,13 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/udp.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <errno.h>
+#include <limits.h>
 #include <assert.h>
 
 /** tolerance for late packets */
@@ -72,6 +77,15 @@
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
 
+/** maximum number of datagrams sent at once in batch mode */
+#define UDP_MAX_BATCH 64
+/** maximum payload handed over to the kernel in a segmented send */
+#define UDP_MAX_GSO_SIZE 65000
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 /** @hidden */
 static void upipe_udpsink_watcher(struct upump *upump);
 /** @hidden */
@@ -118,6 +132,17 @@ struct upipe_udpsink {
     /** destination for not-connected socket (size) */
     socklen_t addrlen;
 
+    /** maximum number of datagrams sent at once */
+    unsigned int batch;
+    /** true if segmentation offload is used in batch mode */
+    bool gso;
+    /** datagrams due and waiting to be sent in batch mode */
+    struct uref *pending[UDP_MAX_BATCH];
+    /** number of datagrams waiting */
+    unsigned int nb_pending;
+    /** pump sending waiting datagrams at the next loop iteration */
+    struct upump *upump_flush;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -127,6 +152,7 @@ UPIPE_HELPER_UREFCOUNT(upipe_udpsink, urefcount, upipe_udpsink_free)
 UPIPE_HELPER_VOID(upipe_udpsink)
 UPIPE_HELPER_UPUMP_MGR(upipe_udpsink, upump_mgr)
 UPIPE_HELPER_UPUMP(upipe_udpsink, upump, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_udpsink, upump_flush, upump_mgr)
 UPIPE_HELPER_INPUT(upipe_udpsink, urefs, nb_urefs, max_urefs, blockers, upipe_udpsink_output)
 UPIPE_HELPER_UCLOCK(upipe_udpsink, uclock, uclock_request, NULL, upipe_throw_provide_request, NULL)
 
@@ -151,6 +177,7 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink_init_urefcount(upipe);
     upipe_udpsink_init_upump_mgr(upipe);
     upipe_udpsink_init_upump(upipe);
+    upipe_udpsink_init_upump_flush(upipe);
     upipe_udpsink_init_input(upipe);
     upipe_udpsink_init_uclock(upipe);
     upipe_udpsink->latency = 0;
@@ -158,6 +185,9 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink->uri = NULL;
     upipe_udpsink->raw = false;
     upipe_udpsink->addrlen = 0;
+    upipe_udpsink->batch = 1;
+    upipe_udpsink->gso = false;
+    upipe_udpsink->nb_pending = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -185,6 +215,240 @@ static void upipe_udpsink_poll(struct upipe *upipe)
     }
 }
 
+/** @internal @This frees the datagrams waiting to be sent.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsink_clean_pending(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    for (unsigned int i = 0; i < upipe_udpsink->nb_pending; i++)
+        uref_free(upipe_udpsink->pending[i]);
+    upipe_udpsink->nb_pending = 0;
+    upipe_udpsink_set_upump_flush(upipe, NULL);
+}
+
+#ifdef HAVE_SENDMMSG
+/** @internal @This sends the datagrams waiting in batch mode with a single
+ * system call.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the socket is full and the watcher was started
+ */
+static bool upipe_udpsink_flush_pending(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    unsigned int nb_pending = upipe_udpsink->nb_pending;
+    if (nb_pending == 0)
+        return true;
+    upipe_udpsink_set_upump_flush(upipe, NULL);
+
+    if (unlikely(upipe_udpsink->fd == -1)) {
+        upipe_warn(upipe, "dropping buffers sent before opening a socket");
+        upipe_udpsink_clean_pending(upipe);
+        return true;
+    }
+
+    bool raw = upipe_udpsink->raw;
+    int nb_iovecs = 0;
+    for (unsigned int i = 0; i < nb_pending; i++)
+        nb_iovecs += uref_block_iovec_count(upipe_udpsink->pending[i],
+                                            0, -1) + (raw ? 1 : 0);
+
+    struct iovec iovecs[nb_iovecs];
+    struct iovec *datagram_iovecs[UDP_MAX_BATCH];
+    int datagram_counts[UDP_MAX_BATCH];
+    size_t datagram_sizes[UDP_MAX_BATCH];
+    uint8_t raw_headers[UDP_MAX_BATCH][RAW_HEADER_SIZE];
+
+    /* map all datagrams */
+    struct iovec *iovec = iovecs;
+    unsigned int nb_datagrams = 0;
+    for (unsigned int i = 0; i < nb_pending; i++) {
+        struct uref *uref = upipe_udpsink->pending[i];
+        int count = uref_block_iovec_count(uref, 0, -1);
+        size_t size = 0;
+        uref_block_size(uref, &size);
+
+        if (raw) {
+            memcpy(raw_headers[nb_datagrams], upipe_udpsink->raw_header,
+                   RAW_HEADER_SIZE);
+            udp_raw_set_len(raw_headers[nb_datagrams], size);
+            iovec[0].iov_base = raw_headers[nb_datagrams];
+            iovec[0].iov_len = RAW_HEADER_SIZE;
+        }
+        if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1,
+                                        raw ? iovec + 1 : iovec)))) {
+            uref_free(uref);
+            upipe_warn(upipe, "cannot read ubuf buffer");
+            continue;
+        }
+
+        upipe_udpsink->pending[nb_datagrams] = uref;
+        datagram_iovecs[nb_datagrams] = iovec;
+        datagram_counts[nb_datagrams] = count + (raw ? 1 : 0);
+        datagram_sizes[nb_datagrams] = size;
+        iovec += datagram_counts[nb_datagrams];
+        nb_datagrams++;
+    }
+    upipe_udpsink->nb_pending = nb_datagrams;
+
+    /* build messages, possibly gathering segments of equal size */
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    unsigned int msg_datagrams[UDP_MAX_BATCH];
+#ifdef UDP_SEGMENT
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } cmsgs[UDP_MAX_BATCH];
+#endif
+    unsigned int nb_msgs = 0;
+    for (unsigned int i = 0; i < nb_datagrams; ) {
+        struct msghdr *msg = &msgs[nb_msgs].msg_hdr;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_name = upipe_udpsink->addrlen ? &upipe_udpsink->addr : NULL;
+        msg->msg_namelen = upipe_udpsink->addrlen;
+        msg->msg_iov = datagram_iovecs[i];
+        msg->msg_iovlen = datagram_counts[i];
+        unsigned int n = 1;
+
+#ifdef UDP_SEGMENT
+        if (upipe_udpsink->gso && !raw) {
+            size_t segment = datagram_sizes[i];
+            size_t total = segment;
+            /* only the last segment may be shorter */
+            while (i + n < nb_datagrams &&
+                   datagram_sizes[i + n - 1] == segment &&
+                   datagram_sizes[i + n] <= segment &&
+                   total + datagram_sizes[i + n] <= UDP_MAX_GSO_SIZE &&
+                   msg->msg_iovlen + datagram_counts[i + n] <= IOV_MAX) {
+                total += datagram_sizes[i + n];
+                msg->msg_iovlen += datagram_counts[i + n];
+                n++;
+            }
+            if (n > 1) {
+                msg->msg_control = cmsgs[nb_msgs].buf;
+                msg->msg_controllen = sizeof(cmsgs[nb_msgs].buf);
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gso_size = segment;
+                memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            }
+        }
+#endif
+
+        msg_datagrams[nb_msgs++] = n;
+        i += n;
+    }
+
+    unsigned int nb_sent = 0;
+    bool blocked = false;
+    while (nb_sent < nb_msgs) {
+        int ret = sendmmsg(upipe_udpsink->fd, msgs + nb_sent,
+                           nb_msgs - nb_sent, 0);
+        if (unlikely(ret == -1)) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN
+#if EAGAIN != EWOULDBLOCK
+                || errno == EWOULDBLOCK
+#endif
+               ) {
+                blocked = true;
+                break;
+            }
+            /* Errors at this point come from ICMP messages such as
+             * "port unreachable", and we do not want to kill the application
+             * with transient errors. Skip the faulty message. */
+            ret = 1;
+        }
+        nb_sent += ret;
+    }
+
+    unsigned int nb_done = 0;
+    for (unsigned int i = 0; i < nb_sent; i++)
+        nb_done += msg_datagrams[i];
+    for (unsigned int i = 0; i < nb_datagrams; i++) {
+        struct uref *uref = upipe_udpsink->pending[i];
+        uref_block_iovec_unmap(uref, 0, -1,
+                raw ? datagram_iovecs[i] + 1 : datagram_iovecs[i]);
+        if (i < nb_done)
+            uref_free(uref);
+    }
+    memmove(upipe_udpsink->pending, upipe_udpsink->pending + nb_done,
+            (nb_datagrams - nb_done) * sizeof(struct uref *));
+    upipe_udpsink->nb_pending = nb_datagrams - nb_done;
+
+    if (unlikely(blocked)) {
+        upipe_udpsink_poll(upipe);
+        return false;
+    }
+    return true;
+}
+
+/** @internal @This is called at the next event loop iteration to send the
+ * datagrams waiting in batch mode.
+ *
+ * @param upump description structure of the pump
+ */
+static void upipe_udpsink_flush_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_udpsink_set_upump_flush(upipe, NULL);
+    upipe_udpsink_flush_pending(upipe);
+}
+
+/** @internal @This adds a datagram which is due to the list of datagrams
+ * waiting to be sent in batch mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return true if the uref was processed
+ */
+static bool upipe_udpsink_queue(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    int iovec_count = uref_block_iovec_count(uref, 0, -1);
+    if (unlikely(iovec_count == -1)) {
+        uref_free(uref);
+        upipe_warn(upipe, "cannot read ubuf buffer");
+        return true;
+    }
+    if (unlikely(iovec_count == 0)) {
+        uref_free(uref);
+        return true;
+    }
+
+    if (upipe_udpsink->nb_pending >= upipe_udpsink->batch &&
+        !upipe_udpsink_flush_pending(upipe))
+        return false;
+
+    upipe_udpsink->pending[upipe_udpsink->nb_pending++] = uref;
+    if (upipe_udpsink->nb_pending >= upipe_udpsink->batch) {
+        upipe_udpsink_flush_pending(upipe);
+        return true;
+    }
+
+    if (upipe_udpsink->upump_flush == NULL) {
+        upipe_udpsink_check_upump_mgr(upipe);
+        if (unlikely(upipe_udpsink->upump_mgr == NULL))
+            upipe_udpsink_flush_pending(upipe);
+        else
+            upipe_udpsink_wait_upump_flush(upipe, 0,
+                                           upipe_udpsink_flush_watcher);
+    }
+    return true;
+}
+#else
+/** @hidden */
+static inline bool upipe_udpsink_flush_pending(struct upipe *upipe)
+{
+    return true;
+}
+#endif
+
 /** @internal @This outputs data to the udp sink.
  *
  * @param upipe description structure of the pipe
@@ -224,6 +488,8 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
     uint64_t now = uclock_now(upipe_udpsink->uclock);
     systime += upipe_udpsink->latency;
     if (unlikely(now < systime)) {
+        /* send what is already due before sleeping */
+        upipe_udpsink_flush_pending(upipe);
         upipe_udpsink_check_upump_mgr(upipe);
         if (likely(upipe_udpsink->upump_mgr != NULL)) {
             upipe_verbose_va(upipe, "sleeping %"PRIu64" (%"PRIu64")",
@@ -246,6 +512,11 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                       upipe_udpsink->latency / (UCLOCK_FREQ / 1000));
 
 write_buffer:
+#ifdef HAVE_SENDMMSG
+    if (upipe_udpsink->batch > 1)
+        return upipe_udpsink_queue(upipe, uref);
+#endif
+
     for ( ; ; ) {
         size_t payload_len = 0;
         if (unlikely(!ubase_check(uref_block_size(uref, &payload_len)))) {
@@ -338,6 +609,11 @@ static void upipe_udpsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     upipe_udpsink_set_upump(upipe, NULL);
+    if (!upipe_udpsink_flush_pending(upipe))
+        return;
+    if (upipe_udpsink_check_input(upipe))
+        /* only datagrams waiting in batch mode were blocked */
+        return;
     upipe_udpsink_output_input(upipe);
     upipe_udpsink_unblock_input(upipe);
     if (upipe_udpsink_check_input(upipe)) {
@@ -450,6 +726,27 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum number of datagrams sent at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams
+ * @return an error code
+ */
+static int _upipe_udpsink_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (unlikely(batch == 0 || batch > UDP_MAX_BATCH))
+        return UBASE_ERR_INVALID;
+#ifndef HAVE_SENDMMSG
+    if (batch > 1)
+        return UBASE_ERR_UNHANDLED;
+#endif
+    if (batch < upipe_udpsink->nb_pending)
+        upipe_udpsink_flush_pending(upipe);
+    upipe_udpsink->batch = batch;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This flushes all currently held buffers, and unblocks the
  * sources.
  *
@@ -458,6 +755,7 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
  */
 static int upipe_udpsink_flush(struct upipe *upipe)
 {
+    upipe_udpsink_clean_pending(upipe);
     if (upipe_udpsink_flush_input(upipe)) {
         upipe_udpsink_set_upump(upipe, NULL);
         /* All packets have been output, release again the pipe that has been
@@ -533,6 +831,33 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             memcpy(&upipe_udpsink->addr, s, upipe_udpsink->addrlen);
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSINK_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsink->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_udpsink_set_batch(upipe, batch);
+        }
+        case UPIPE_UDPSINK_GET_GSO: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            int *gso_p = va_arg(args, int *);
+            *gso_p = upipe_udpsink->gso;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_GSO: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            int gso = va_arg(args, int);
+#ifndef UDP_SEGMENT
+            if (gso)
+                return UBASE_ERR_UNHANDLED;
+#endif
+            upipe_udpsink->gso = !!gso;
+            return UBASE_ERR_NONE;
+        }
         case UPIPE_FLUSH:
             return upipe_udpsink_flush(upipe);
         default:
@@ -569,6 +894,10 @@ static void upipe_udpsink_free(struct upipe *upipe)
     if (upipe_udpsink->upump != NULL)
         upump_stop(upipe_udpsink->upump);
 
+    /* send the datagrams held for the batch, they are already due */
+    upipe_udpsink_flush_pending(upipe);
+    upipe_udpsink_clean_pending(upipe);
+
     if (likely(upipe_udpsink->fd != -1)) {
         if (likely(upipe_udpsink->uri != NULL))
             upipe_notice_va(upipe, "closing socket %s", upipe_udpsink->uri);
@@ -578,6 +907,7 @@ static void upipe_udpsink_free(struct upipe *upipe)
 
     free(upipe_udpsink->uri);
     upipe_udpsink_clean_uclock(upipe);
+    upipe_udpsink_clean_upump_flush(upipe);
     upipe_udpsink_clean_upump(upipe);
     upipe_udpsink_clean_upump_mgr(upipe);
     upipe_udpsink_clean_input(upipe);
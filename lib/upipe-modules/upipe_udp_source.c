@@ -28,6 +28,8 @@
  * @short Upipe source module for udp sockets
  */
 
+#include <config.h>
+
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
@@ -64,6 +66,10 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/socket.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       4096
@@ -71,6 +77,17 @@
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
 
+/** maximum number of datagrams read per wakeup in batch mode */
+#define UDP_MAX_BATCH 64
+
+/** @internal @This is a buffer for control messages carrying timestamps. */
+union upipe_udpsrc_cmsg {
+    /** room for up to three timestamps (SO_TIMESTAMPING) */
+    char buf[CMSG_SPACE(3 * sizeof(struct timespec))];
+    /** alignment */
+    struct cmsghdr align;
+};
+
 /** @hidden */
 static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format);
 
@@ -122,6 +139,15 @@ struct upipe_udpsrc {
     /** source address (size) */
     socklen_t addrlen;
 
+    /** number of datagrams read per wakeup */
+    unsigned int batch;
+    /** pre-allocated urefs for batch mode */
+    struct uref *batch_urefs[UDP_MAX_BATCH];
+    /** source of reception dates */
+    enum upipe_udpsrc_timestamp timestamp;
+    /** true if the timestamping options of the socket are set by the pipe */
+    bool timestamp_sockopt;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -172,10 +198,354 @@ static struct upipe *upipe_udpsrc_alloc(struct upipe_mgr *mgr,
     upipe_udpsrc->fd = -1;
     upipe_udpsrc->uri = NULL;
     upipe_udpsrc->addrlen = 0;
+    upipe_udpsrc->batch = 1;
+    upipe_udpsrc->timestamp = UPIPE_UDPSRC_TIMESTAMP_UCLOCK;
+    upipe_udpsrc->timestamp_sockopt = false;
+    for (unsigned int i = 0; i < UDP_MAX_BATCH; i++)
+        upipe_udpsrc->batch_urefs[i] = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This handles a read error on the udp socket.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_read_error(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    switch (errno) {
+        case EINTR:
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+            /* not an issue, try again later */
+            return;
+        case EBADF:
+        case EINVAL:
+        case EIO:
+        default:
+            break;
+    }
+    upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
+    upipe_udpsrc_set_upump(upipe, NULL);
+    upipe_throw_source_end(upipe);
+}
+
+/** @internal @This checks the address of the sender of a datagram, and
+ * throws an event if it changed.
+ *
+ * @param upipe description structure of the pipe
+ * @param addr address of the sender
+ * @param addrlen size of addr
+ */
+static void upipe_udpsrc_check_peer(struct upipe *upipe,
+                                    struct sockaddr_storage *addr,
+                                    socklen_t addrlen)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (addrlen != upipe_udpsrc->addrlen ||
+        memcmp(addr, &upipe_udpsrc->addr, addrlen)) {
+        upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
+                addr, &addrlen);
+        upipe_udpsrc->addrlen = addrlen;
+        memcpy(&upipe_udpsrc->addr, addr, addrlen);
+    }
+}
+
+/** @internal @This checks if datagrams are dated with kernel timestamps.
+ * Datagrams read in a batch are all read at the same wakeup, so they are
+ * dated by the kernel even if the uclock was requested.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if kernel timestamps are used
+ */
+static bool upipe_udpsrc_kernel_dates(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->timestamp != UPIPE_UDPSRC_TIMESTAMP_UCLOCK)
+        return true;
+#ifdef SO_TIMESTAMPNS
+    return upipe_udpsrc->batch > 1;
+#else
+    return false;
+#endif
+}
+
+/** @internal @This returns the dates needed to convert kernel timestamps
+ * at wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param systime_p filled in with the current system time
+ * @param real_p filled in with the same date in real time, or UINT64_MAX
+ * if kernel timestamps are not used
+ */
+static void upipe_udpsrc_now(struct upipe *upipe, uint64_t *systime_p,
+                             uint64_t *real_p)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    *systime_p = 0; /* to keep gcc quiet */
+    *real_p = UINT64_MAX;
+    if (likely(upipe_udpsrc->uclock == NULL))
+        return;
+
+    *systime_p = uclock_now(upipe_udpsrc->uclock);
+    if (upipe_udpsrc_kernel_dates(upipe))
+        *real_p = uclock_to_real(upipe_udpsrc->uclock, *systime_p);
+}
+
+/** @internal @This returns the reception date of a datagram, from the
+ * kernel timestamp if there is one. The raw hardware timestamp, which is in
+ * the clock domain of the network interface, is attached to the uref as is.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref received datagram
+ * @param msg received message
+ * @param systime system time at wakeup
+ * @param real real time at wakeup, or UINT64_MAX
+ * @return reception date in system time
+ */
+static uint64_t upipe_udpsrc_get_date(struct upipe *upipe, struct uref *uref,
+                                      struct msghdr *msg,
+                                      uint64_t systime, uint64_t real)
+{
+    if (real == UINT64_MAX)
+        return systime;
+
+    const struct timespec *ts = NULL;
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+#ifdef SO_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            ts = (const struct timespec *)CMSG_DATA(cmsg);
+            break;
+        }
+#endif
+#ifdef SO_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            /* [0] is the software timestamp, [2] the raw hardware one,
+             * which is not in real time and can't be converted */
+            ts = (const struct timespec *)CMSG_DATA(cmsg);
+            if (ts[2].tv_sec || ts[2].tv_nsec)
+                uref_udpsrc_set_hw_date(uref, ts[2].tv_sec * UCLOCK_FREQ +
+                        ts[2].tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000));
+            break;
+        }
+#endif
+    }
+    if (ts == NULL || (!ts->tv_sec && !ts->tv_nsec))
+        return systime;
+
+    uint64_t date = ts->tv_sec * UCLOCK_FREQ +
+                    ts->tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+    if (unlikely(date > real || real - date > systime)) {
+        upipe_verbose(upipe, "discarding invalid kernel timestamp");
+        return systime;
+    }
+    return systime - (real - date);
+}
+
+/** @internal @This configures the udp socket for the given source of
+ * reception dates.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp source of reception dates
+ * @return an error code
+ */
+static int upipe_udpsrc_set_sockopt_timestamp(struct upipe *upipe,
+                                              int timestamp)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->fd == -1)
+        return UBASE_ERR_NONE;
+    /* leave the options of a socket given by the caller untouched, unless
+     * timestamping is explicitly enabled */
+    if (!upipe_udpsrc->timestamp_sockopt &&
+        timestamp == UPIPE_UDPSRC_TIMESTAMP_UCLOCK)
+        return UBASE_ERR_NONE;
+
+#ifdef SO_TIMESTAMPNS
+    /* datagrams read in a batch are dated by the kernel */
+    int enable = timestamp == UPIPE_UDPSRC_TIMESTAMP_KERNEL ||
+                 (timestamp == UPIPE_UDPSRC_TIMESTAMP_UCLOCK &&
+                  upipe_udpsrc->batch > 1);
+    if (unlikely(setsockopt(upipe_udpsrc->fd, SOL_SOCKET, SO_TIMESTAMPNS,
+                            &enable, sizeof(enable)) < 0)) {
+        if (timestamp == UPIPE_UDPSRC_TIMESTAMP_KERNEL) {
+            upipe_err_va(upipe, "can't enable SO_TIMESTAMPNS (%m)");
+            return UBASE_ERR_EXTERNAL;
+        }
+        upipe_warn_va(upipe, "can't %s SO_TIMESTAMPNS (%m)",
+                      enable ? "enable" : "disable");
+    }
+#endif
+
+#if defined(SO_TIMESTAMPING) && defined(__linux__)
+    int flags = 0;
+    if (timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE)
+        flags = SOF_TIMESTAMPING_RX_HARDWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE |
+                SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_SOFTWARE;
+    if (unlikely(setsockopt(upipe_udpsrc->fd, SOL_SOCKET, SO_TIMESTAMPING,
+                            &flags, sizeof(flags)) < 0)) {
+        if (flags) {
+            upipe_err_va(upipe, "can't enable SO_TIMESTAMPING (%m)");
+            return UBASE_ERR_EXTERNAL;
+        }
+        upipe_warn_va(upipe, "can't disable SO_TIMESTAMPING (%m)");
+    }
+#endif
+    upipe_udpsrc->timestamp_sockopt = true;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs a received datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref containing the datagram
+ * @param size size of the datagram
+ * @param systime reception date
+ * @return false if the source has ended
+ */
+static bool upipe_udpsrc_output_datagram(struct upipe *upipe,
+                                         struct uref *uref, size_t size,
+                                         uint64_t systime)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (unlikely(size == 0)) {
+        uref_free(uref);
+        if (likely(upipe_udpsrc->uclock == NULL)) {
+            upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
+            upipe_udpsrc_set_upump(upipe, NULL);
+            upipe_throw_source_end(upipe);
+            return false;
+        }
+        return true;
+    }
+    if (unlikely(upipe_udpsrc->uclock != NULL))
+        uref_clock_set_cr_sys(uref, systime);
+    if (unlikely(size != upipe_udpsrc->output_size))
+        uref_block_resize(uref, 0, size);
+    upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+    return true;
+}
+
+/** @internal @This releases the urefs pre-allocated for batch mode.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_flush_batch(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    for (unsigned int i = 0; i < UDP_MAX_BATCH; i++) {
+        if (upipe_udpsrc->batch_urefs[i] != NULL) {
+            uref_free(upipe_udpsrc->batch_urefs[i]);
+            upipe_udpsrc->batch_urefs[i] = NULL;
+        }
+    }
+}
+
+#ifdef HAVE_RECVMMSG
+/** @internal @This reads up to batch datagrams from the udp socket with a
+ * single system call, and outputs them. Buffers which were not filled are
+ * kept for the next wakeup.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_udpsrc_worker_batch(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    unsigned int batch = upipe_udpsrc->batch;
+    struct mmsghdr msgs[UDP_MAX_BATCH];
+    struct iovec iovecs[UDP_MAX_BATCH];
+    struct sockaddr_storage addrs[UDP_MAX_BATCH];
+    union upipe_udpsrc_cmsg cmsgs[UDP_MAX_BATCH];
+    uint64_t systime, real;
+    upipe_udpsrc_now(upipe, &systime, &real);
+
+    for (unsigned int i = 0; i < batch; i++) {
+        struct uref *uref = upipe_udpsrc->batch_urefs[i];
+        if (uref == NULL) {
+            uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                    upipe_udpsrc->ubuf_mgr,
+                                    upipe_udpsrc->output_size);
+            if (unlikely(uref == NULL)) {
+                for (unsigned int j = 0; j < i; j++)
+                    uref_block_unmap(upipe_udpsrc->batch_urefs[j], 0);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            upipe_udpsrc->batch_urefs[i] = uref;
+        }
+
+        uint8_t *buffer;
+        int output_size = -1;
+        if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                                   &buffer)))) {
+            for (unsigned int j = 0; j < i; j++)
+                uref_block_unmap(upipe_udpsrc->batch_urefs[j], 0);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        assert(output_size == upipe_udpsrc->output_size);
+
+        iovecs[i].iov_base = buffer;
+        iovecs[i].iov_len = output_size;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (real != UINT64_MAX) {
+            msgs[i].msg_hdr.msg_control = cmsgs[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i].buf);
+        }
+    }
+
+    int ret = recvmmsg(upipe_udpsrc->fd, msgs, batch, MSG_DONTWAIT, NULL);
+    for (unsigned int i = 0; i < batch; i++)
+        uref_block_unmap(upipe_udpsrc->batch_urefs[i], 0);
+
+    if (unlikely(ret == -1)) {
+        upipe_udpsrc_read_error(upipe);
+        return;
+    }
+
+    /* take the filled urefs, and move the spare ones to the front */
+    struct uref *urefs[UDP_MAX_BATCH];
+    memcpy(urefs, upipe_udpsrc->batch_urefs, ret * sizeof(struct uref *));
+    memmove(upipe_udpsrc->batch_urefs, upipe_udpsrc->batch_urefs + ret,
+            (UDP_MAX_BATCH - ret) * sizeof(struct uref *));
+    for (unsigned int i = UDP_MAX_BATCH - ret; i < UDP_MAX_BATCH; i++)
+        upipe_udpsrc->batch_urefs[i] = NULL;
+
+    for (unsigned int i = 0; i < ret; i++) {
+        /* the pipe may have been reconfigured by a previous output */
+        if (unlikely(upipe_udpsrc->upump != upump)) {
+            uref_free(urefs[i]);
+            continue;
+        }
+        upipe_udpsrc_check_peer(upipe, &addrs[i],
+                                msgs[i].msg_hdr.msg_namelen);
+        uint64_t date = upipe_udpsrc_get_date(upipe, urefs[i],
+                                              &msgs[i].msg_hdr, systime, real);
+        if (unlikely(!upipe_udpsrc_output_datagram(upipe, urefs[i],
+                                                   msgs[i].msg_len,
+                                                   date))) {
+            for (i++; i < ret; i++)
+                uref_free(urefs[i]);
+            break;
+        }
+    }
+}
+#endif
+
 /** @internal @This reads data from the source and outputs it.
  * It is called either when the idler triggers (permanent storage mode) or
  * when data is available on the udp socket descriptor (live stream mode).
@@ -186,9 +556,15 @@ static void upipe_udpsrc_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
-    uint64_t systime = 0; /* to keep gcc quiet */
-    if (unlikely(upipe_udpsrc->uclock != NULL))
-        systime = uclock_now(upipe_udpsrc->uclock);
+#ifdef HAVE_RECVMMSG
+    if (upipe_udpsrc->batch > 1) {
+        upipe_udpsrc_worker_batch(upump);
+        return;
+    }
+#endif
+
+    uint64_t systime, real;
+    upipe_udpsrc_now(upipe, &systime, &real);
 
     struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
                                          upipe_udpsrc->ubuf_mgr,
@@ -209,54 +585,80 @@ static void upipe_udpsrc_worker(struct upump *upump)
     assert(output_size == upipe_udpsrc->output_size);
 
     struct sockaddr_storage addr;
-    socklen_t addrlen = sizeof(addr);
+    struct iovec iovec;
+    iovec.iov_base = buffer;
+    iovec.iov_len = upipe_udpsrc->output_size;
+    union upipe_udpsrc_cmsg cmsg;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iovec;
+    msg.msg_iovlen = 1;
+    if (real != UINT64_MAX) {
+        msg.msg_control = cmsg.buf;
+        msg.msg_controllen = sizeof(cmsg.buf);
+    }
 
-    ssize_t ret = recvfrom(upipe_udpsrc->fd, buffer, upipe_udpsrc->output_size,
-                        0, (struct sockaddr*)&addr, &addrlen);
+    ssize_t ret = recvmsg(upipe_udpsrc->fd, &msg, 0);
     uref_block_unmap(uref, 0);
 
     if (unlikely(ret == -1)) {
         uref_free(uref);
-        switch (errno) {
-            case EINTR:
-            case EAGAIN:
-#if EAGAIN != EWOULDBLOCK
-            case EWOULDBLOCK:
-#endif
-                /* not an issue, try again later */
-                return;
-            case EBADF:
-            case EINVAL:
-            case EIO:
-            default:
-                break;
-        }
-        upipe_err_va(upipe, "read error from %s (%m)", upipe_udpsrc->uri);
-        upipe_udpsrc_set_upump(upipe, NULL);
-        upipe_throw_source_end(upipe);
+        upipe_udpsrc_read_error(upipe);
         return;
-    } else if (addrlen != upipe_udpsrc->addrlen ||
-        memcmp(&addr, &upipe_udpsrc->addr, addrlen)) {
-        upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
-                &addr, &addrlen);
-        upipe_udpsrc->addrlen = addrlen;
-        memcpy(&upipe_udpsrc->addr, &addr, addrlen);
     }
+    upipe_udpsrc_check_peer(upipe, &addr, msg.msg_namelen);
+    upipe_udpsrc_output_datagram(upipe, uref, ret,
+            upipe_udpsrc_get_date(upipe, uref, &msg, systime, real));
+}
 
-    if (unlikely(ret == 0)) {
-        uref_free(uref);
-        if (likely(upipe_udpsrc->uclock == NULL)) {
-            upipe_notice_va(upipe, "end of udp socket %s", upipe_udpsrc->uri);
-            upipe_udpsrc_set_upump(upipe, NULL);
-            upipe_throw_source_end(upipe);
-        }
-        return;
+/** @internal @This sets the number of datagrams read per wakeup.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams
+ * @return an error code
+ */
+static int _upipe_udpsrc_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (unlikely(batch == 0 || batch > UDP_MAX_BATCH))
+        return UBASE_ERR_INVALID;
+#ifndef HAVE_RECVMMSG
+    if (batch > 1)
+        return UBASE_ERR_UNHANDLED;
+#endif
+    upipe_udpsrc_flush_batch(upipe);
+    upipe_udpsrc->batch = batch;
+    return upipe_udpsrc_set_sockopt_timestamp(upipe, upipe_udpsrc->timestamp);
+}
+
+/** @internal @This sets the source of reception dates.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp source of reception dates
+ * @return an error code
+ */
+static int _upipe_udpsrc_set_timestamp(struct upipe *upipe, int timestamp)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    switch (timestamp) {
+        case UPIPE_UDPSRC_TIMESTAMP_UCLOCK:
+            break;
+#ifdef SO_TIMESTAMPNS
+        case UPIPE_UDPSRC_TIMESTAMP_KERNEL:
+            break;
+#endif
+#if defined(SO_TIMESTAMPING) && defined(__linux__)
+        case UPIPE_UDPSRC_TIMESTAMP_HARDWARE:
+            break;
+#endif
+        default:
+            return UBASE_ERR_UNHANDLED;
     }
-    if (unlikely(upipe_udpsrc->uclock != NULL))
-        uref_clock_set_cr_sys(uref, systime);
-    if (unlikely(ret != upipe_udpsrc->output_size))
-        uref_block_resize(uref, 0, ret);
-    upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
+    UBASE_RETURN(upipe_udpsrc_set_sockopt_timestamp(upipe, timestamp))
+    upipe_udpsrc->timestamp = timestamp;
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This checks if the pump may be allocated.
@@ -362,6 +764,14 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return UBASE_ERR_ALLOC;
     }
+    upipe_udpsrc->timestamp_sockopt = true;
+    int err = upipe_udpsrc_set_sockopt_timestamp(upipe,
+                                                 upipe_udpsrc->timestamp);
+    if (unlikely(!ubase_check(err))) {
+        ubase_clean_fd(&upipe_udpsrc->fd);
+        ubase_clean_str(&upipe_udpsrc->uri);
+        return err;
+    }
     upipe_notice_va(upipe, "opening udp socket %s", upipe_udpsrc->uri);
     return UBASE_ERR_NONE;
 }
@@ -393,7 +803,9 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
             return upipe_udpsrc_control_output(upipe, command, args);
 
         case UPIPE_GET_OUTPUT_SIZE:
+            return upipe_udpsrc_control_output_size(upipe, command, args);
         case UPIPE_SET_OUTPUT_SIZE:
+            upipe_udpsrc_flush_batch(upipe);
             return upipe_udpsrc_control_output_size(upipe, command, args);
 
         case UPIPE_GET_URI: {
@@ -414,8 +826,36 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
             UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
             upipe_udpsrc_set_upump(upipe, NULL);
             upipe_udpsrc->fd = va_arg(args, int );
+            upipe_udpsrc->timestamp_sockopt = false;
+            int err = upipe_udpsrc_set_sockopt_timestamp(upipe,
+                                                     upipe_udpsrc->timestamp);
+            if (unlikely(!ubase_check(err)))
+                /* the caller keeps ownership of the socket */
+                upipe_udpsrc->fd = -1;
+            return err;
+        }
+        case UPIPE_UDPSRC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsrc->batch;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSRC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_udpsrc_set_batch(upipe, batch);
+        }
+        case UPIPE_UDPSRC_GET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int *timestamp_p = va_arg(args, int *);
+            *timestamp_p = upipe_udpsrc->timestamp;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int timestamp = va_arg(args, int);
+            return _upipe_udpsrc_set_timestamp(upipe, timestamp);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -456,6 +896,7 @@ static void upipe_udpsrc_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     free(upipe_udpsrc->uri);
+    upipe_udpsrc_flush_batch(upipe);
     upipe_udpsrc_clean_output_size(upipe);
     upipe_udpsrc_clean_uclock(upipe);
     upipe_udpsrc_clean_upump(upipe);
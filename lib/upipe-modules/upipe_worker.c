@@ -54,6 +54,10 @@
 #include <string.h>
 #include <assert.h>
 
+/** @internal @This is the maximum length of the queues between the threads;
+ * the queues are preallocated, so the excess is held in the queue sinks */
+#define UPIPE_WORK_MAX_QUEUE_LENGTH 4096
+
 /** @internal @This is the private context of a worker manager. */
 struct upipe_work_mgr {
     /** refcount management structure */
@@ -258,7 +262,8 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
         struct upipe *out_qsrc = upipe_qsrc_alloc(work_mgr->qsrc_mgr,
                 uprobe_pfx_alloc(uprobe_use(&upipe_work->out_qsrc_probe),
                                  UPROBE_LOG_VERBOSE, "out_qsrc"),
-                out_queue_length > UINT8_MAX ? UINT8_MAX : out_queue_length);
+                out_queue_length > UPIPE_WORK_MAX_QUEUE_LENGTH ?
+                UPIPE_WORK_MAX_QUEUE_LENGTH : out_queue_length);
         if (unlikely(out_qsrc == NULL))
             goto error;
 
@@ -270,8 +275,9 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
             upipe_release(out_qsrc);
             goto error;
         }
-        if (out_queue_length > UINT8_MAX)
-            upipe_set_max_length(out_qsink, out_queue_length - UINT8_MAX);
+        if (out_queue_length > UPIPE_WORK_MAX_QUEUE_LENGTH)
+            upipe_set_max_length(out_qsink,
+                    out_queue_length - UPIPE_WORK_MAX_QUEUE_LENGTH);
 
         upipe_attach_upump_mgr(out_qsrc);
         ulist_add(&upipe_work->upump_mgr_pipes, upipe_to_uchain(out_qsrc));
@@ -316,7 +322,8 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
                 uprobe_pfx_alloc(
                     uprobe_use(&upipe_work->in_qsrc_probe),
                     UPROBE_LOG_VERBOSE, "in_qsrc"),
-                in_queue_length > UINT8_MAX ? UINT8_MAX : in_queue_length);
+                in_queue_length > UPIPE_WORK_MAX_QUEUE_LENGTH ?
+                UPIPE_WORK_MAX_QUEUE_LENGTH : in_queue_length);
         if (unlikely(in_qsrc == NULL))
             goto error;
 
@@ -329,9 +336,9 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
             goto error;
         }
         upipe_work_store_bin_input(upipe, in_qsink);
-        if (in_queue_length > UINT8_MAX)
+        if (in_queue_length > UPIPE_WORK_MAX_QUEUE_LENGTH)
             upipe_set_max_length(upipe_work->in_qsink,
-                                      in_queue_length - UINT8_MAX);
+                    in_queue_length - UPIPE_WORK_MAX_QUEUE_LENGTH);
 
         struct upipe *in_qsrc_xfer = upipe_xfer_alloc(work_mgr->xfer_mgr,
                 uprobe_pfx_alloc(uprobe_use(&upipe_work->proxy_probe),
@@ -25,6 +25,8 @@
 
 
 #include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/urefcount.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
 #include <upipe/uref.h>
@@ -33,6 +35,7 @@
 #include <upipe/uref_clock.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block_ext.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -57,9 +60,105 @@
 #include <bitstream/ietf/udp.h>
 #include <bitstream/ieee/ethernet.h>
 
+/** depth of the pool of ubuf structures */
+#define NETMAP_UBUF_POOL_DEPTH 1024
+
 /** @hidden */
 static int upipe_netmap_source_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @hidden */
+struct upipe_netmap_source_ring;
+
+/** @internal @This describes a slot of the receive ring. */
+struct upipe_netmap_source_slot {
+    /** references to the slot buffer by ubufs */
+    struct urefcount urefcount;
+    /** true until the slot may be given back to the kernel */
+    uatomic_uint32_t held;
+    /** pointer to the ring */
+    struct upipe_netmap_source_ring *ring;
+};
+
+UBASE_FROM_TO(upipe_netmap_source_slot, urefcount, urefcount, urefcount)
+
+/** @internal @This describes the netmap descriptor, which outlives the pipe
+ * as long as buffers point into its slots. */
+struct upipe_netmap_source_ring {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** netmap descriptor */
+    struct nm_desc *d;
+    /** number of slots */
+    unsigned int num_slots;
+    /** slots of the receive ring */
+    struct upipe_netmap_source_slot slots[];
+};
+
+UBASE_FROM_TO(upipe_netmap_source_ring, urefcount, urefcount, urefcount)
+
+/** @internal @This marks a slot as released once the last ubuf pointing to
+ * it is freed. The slot is given back to the kernel by the pipe.
+ *
+ * @param urefcount pointer to the urefcount of the slot
+ */
+static void upipe_netmap_source_slot_free(struct urefcount *urefcount)
+{
+    struct upipe_netmap_source_slot *slot =
+        upipe_netmap_source_slot_from_urefcount(urefcount);
+    struct upipe_netmap_source_ring *ring = slot->ring;
+    uatomic_store(&slot->held, 0);
+    urefcount_release(upipe_netmap_source_ring_to_urefcount(ring));
+}
+
+/** @internal @This closes the netmap descriptor.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_netmap_source_ring_free(struct urefcount *urefcount)
+{
+    struct upipe_netmap_source_ring *ring =
+        upipe_netmap_source_ring_from_urefcount(urefcount);
+    nm_close(ring->d);
+    for (unsigned int i = 0; i < ring->num_slots; i++)
+        uatomic_clean(&ring->slots[i].held);
+    urefcount_clean(urefcount);
+    free(ring);
+}
+
+/** @internal @This opens a netmap descriptor.
+ *
+ * @param uri netmap uri
+ * @param ring_idx index of the receive ring
+ * @return pointer to the ring or NULL in case of error
+ */
+static struct upipe_netmap_source_ring *
+    upipe_netmap_source_ring_alloc(const char *uri, unsigned int ring_idx)
+{
+    struct nm_desc *d = nm_open(uri, NULL, 0, 0);
+    if (unlikely(d == NULL))
+        return NULL;
+
+    unsigned int num_slots = NETMAP_RXRING(d->nifp, ring_idx)->num_slots;
+    struct upipe_netmap_source_ring *ring =
+        malloc(sizeof(struct upipe_netmap_source_ring) +
+               num_slots * sizeof(struct upipe_netmap_source_slot));
+    if (unlikely(ring == NULL)) {
+        nm_close(d);
+        return NULL;
+    }
+
+    urefcount_init(upipe_netmap_source_ring_to_urefcount(ring),
+                   upipe_netmap_source_ring_free);
+    ring->d = d;
+    ring->num_slots = num_slots;
+    for (unsigned int i = 0; i < num_slots; i++) {
+        uatomic_init(&ring->slots[i].held, 0);
+        ring->slots[i].ring = ring;
+    }
+    return ring;
+}
+
 /** @internal @This is the private context of a netmap source pipe. */
 struct upipe_netmap_source {
     /** refcount management structure */
@@ -96,8 +195,12 @@ struct upipe_netmap_source {
     /** read watcher */
     struct upump *upump;
 
-    /** netmap descriptor **/
-    struct nm_desc *d;
+    /** netmap descriptor and slots **/
+    struct upipe_netmap_source_ring *ring;
+    /** ubuf manager pointing into the slots */
+    struct ubuf_mgr *ext_mgr;
+    /** true if all slots are held downstream */
+    bool ring_full;
 
     /** netmape uri **/
     char *uri;
@@ -151,29 +254,60 @@ static struct upipe *upipe_netmap_source_alloc(struct upipe_mgr *mgr,
     upipe_netmap_source_init_upump(upipe);
     upipe_netmap_source_init_uclock(upipe);
     upipe_netmap_source->uri = NULL;
-    upipe_netmap_source->d = NULL;
+    upipe_netmap_source->ring = NULL;
+    upipe_netmap_source->ext_mgr = NULL;
+    upipe_netmap_source->ring_full = false;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This gives back to the kernel the slots which are no longer
+ * pointed to by ubufs. Since the head of the ring may only move forward,
+ * a held slot also retains the following ones.
+ *
+ * @param upipe description structure of the pipe
+ * @param rxring netmap receive ring
+ */
+static void upipe_netmap_source_release(struct upipe *upipe,
+                                        struct netmap_ring *rxring)
+{
+    struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+    struct upipe_netmap_source_ring *ring = upipe_netmap_source->ring;
+
+    while (rxring->head != rxring->cur &&
+           !uatomic_load(&ring->slots[rxring->head].held))
+        rxring->head = nm_ring_next(rxring, rxring->head);
+
+    bool ring_full = nm_ring_next(rxring, rxring->cur) == rxring->head;
+    if (ring_full && !upipe_netmap_source->ring_full)
+        upipe_warn(upipe, "ring full, waiting for downstream pipes");
+    upipe_netmap_source->ring_full = ring_full;
+}
+
 static void upipe_netmap_source_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+    struct upipe_netmap_source_ring *ring = upipe_netmap_source->ring;
 
     uint64_t systime = 0;
     if (likely(upipe_netmap_source->uclock != NULL))
         systime = uclock_now(upipe_netmap_source->uclock);
 
-    ioctl(NETMAP_FD(upipe_netmap_source->d), NIOCRXSYNC, NULL);
-    struct netmap_ring *rxring = NETMAP_RXRING(upipe_netmap_source->d->nifp,
+    struct netmap_ring *rxring = NETMAP_RXRING(ring->d->nifp,
             upipe_netmap_source->ring_idx);
+    upipe_netmap_source_release(upipe, rxring);
+    ioctl(NETMAP_FD(ring->d), NIOCRXSYNC, NULL);
 
+    urefcount_use(upipe_netmap_source_ring_to_urefcount(ring));
     while (!nm_ring_empty(rxring)) {
         const uint32_t cur = rxring->cur;
+        struct upipe_netmap_source_slot *slot = &ring->slots[cur];
         uint8_t *src = (uint8_t*)NETMAP_BUF(rxring, rxring->slot[cur].buf_idx);
+        uint16_t len = rxring->slot[cur].len;
 
-        if (ethernet_get_lentype(src) != ETHERNET_TYPE_IP)
+        if (len < ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE + UDP_HEADER_SIZE ||
+            ethernet_get_lentype(src) != ETHERNET_TYPE_IP)
             goto next;
 
         uint8_t *ip = &src[ETHERNET_HEADER_LEN];
@@ -181,35 +315,45 @@ static void upipe_netmap_source_worker(struct upump *upump)
             goto next;
 
         uint8_t *udp = ip_payload(ip);
-        const uint8_t *rtp = udp_payload(udp);
+        uint8_t *rtp = udp_payload(udp);
+        if (udp_get_len(udp) < UDP_HEADER_SIZE ||
+            rtp - src + udp_get_len(udp) - UDP_HEADER_SIZE > len)
+            goto next;
         uint16_t payload_len = udp_get_len(udp) - UDP_HEADER_SIZE;
 
-        struct uref *uref = uref_block_alloc(upipe_netmap_source->uref_mgr,
-                                             upipe_netmap_source->ubuf_mgr,
-                                             payload_len);
-        if (unlikely(uref == NULL)) {
-            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
-        }
-
-        uint8_t *buffer;
-        int output_size = -1;
-        if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
-                                                   &buffer)))) {
+        /* the slot is held until the last ubuf pointing to it is freed */
+        uatomic_store(&slot->held, 1);
+        urefcount_init(upipe_netmap_source_slot_to_urefcount(slot),
+                       upipe_netmap_source_slot_free);
+        urefcount_use(upipe_netmap_source_ring_to_urefcount(ring));
+
+        struct uref *uref = uref_alloc(upipe_netmap_source->uref_mgr);
+        struct ubuf *ubuf = ubuf_block_ext_alloc(upipe_netmap_source->ext_mgr,
+                rtp, payload_len, upipe_netmap_source_slot_to_urefcount(slot));
+        urefcount_release(upipe_netmap_source_slot_to_urefcount(slot));
+        if (unlikely(uref == NULL || ubuf == NULL)) {
             uref_free(uref);
+            ubuf_free(ubuf);
+            urefcount_release(upipe_netmap_source_ring_to_urefcount(ring));
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return;
         }
-
-        memcpy(buffer, rtp, payload_len);
-        uref_block_unmap(uref, 0);
+        uref_attach_ubuf(uref, ubuf);
 
         uref_clock_set_cr_sys(uref, systime);
 
+        rxring->cur = nm_ring_next(rxring, cur);
         upipe_netmap_source_output(upipe, uref, &upipe_netmap_source->upump);
+        if (unlikely(upipe_netmap_source->ring != ring))
+            break;
+        continue;
 next:
-        rxring->head = rxring->cur = nm_ring_next(rxring, cur);
+        rxring->cur = nm_ring_next(rxring, cur);
     }
+
+    if (likely(upipe_netmap_source->ring == ring))
+        upipe_netmap_source_release(upipe, rxring);
+    urefcount_release(upipe_netmap_source_ring_to_urefcount(ring));
 }
 
 /** @internal @This checks if the pump may be allocated.
@@ -249,15 +393,26 @@ static int upipe_netmap_source_check(struct upipe *upipe, struct uref *flow_form
             != NULL)
         return UBASE_ERR_NONE;
 
-    if (!upipe_netmap_source->d)
+    if (!upipe_netmap_source->ring)
         return UBASE_ERR_NONE;
 
-    if (NETMAP_FD(upipe_netmap_source->d) == -1)
+    if (NETMAP_FD(upipe_netmap_source->ring->d) == -1)
         return UBASE_ERR_NONE;
 
     if (upipe_netmap_source->upump)
         return UBASE_ERR_NONE;
 
+    if (upipe_netmap_source->ext_mgr == NULL) {
+        /* regular allocations on the output buffers use our ubuf manager */
+        upipe_netmap_source->ext_mgr =
+            ubuf_block_ext_mgr_alloc(NETMAP_UBUF_POOL_DEPTH,
+                                     upipe_netmap_source->ubuf_mgr);
+        if (unlikely(upipe_netmap_source->ext_mgr == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+
     struct upump *upump = upump_alloc_timer(upipe_netmap_source->upump_mgr,
             upipe_netmap_source_worker, upipe, upipe->refcount, 0,
             UCLOCK_FREQ/1000);
@@ -268,6 +423,26 @@ static int upipe_netmap_source_check(struct upipe *upipe, struct uref *flow_form
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This closes the netmap descriptor, which is only freed once
+ * the buffers pointing to its slots are released.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_source_close(struct upipe *upipe)
+{
+    struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+    upipe_netmap_source_set_upump(upipe, NULL);
+    if (upipe_netmap_source->ring != NULL) {
+        urefcount_release(upipe_netmap_source_ring_to_urefcount(
+                    upipe_netmap_source->ring));
+        upipe_netmap_source->ring = NULL;
+    }
+    ubuf_mgr_release(upipe_netmap_source->ext_mgr);
+    upipe_netmap_source->ext_mgr = NULL;
+    upipe_netmap_source->ring_full = false;
+    ubase_clean_str(&upipe_netmap_source->uri);
+}
+
 /** @internal @This returns the uri of the currently opened netmap.
  *
  * @param upipe description structure of the pipe
@@ -292,9 +467,7 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
 {
     struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
 
-    nm_close(upipe_netmap_source->d);
-    ubase_clean_str(&upipe_netmap_source->uri);
-    upipe_netmap_source_set_upump(upipe, NULL);
+    upipe_netmap_source_close(upipe);
 
     if (unlikely(uri == NULL))
         return UBASE_ERR_NONE;
@@ -304,16 +477,16 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
         return UBASE_ERR_EXTERNAL;
     }
 
-    upipe_netmap_source->d = nm_open(uri, NULL, 0, 0);
-    if (unlikely(!upipe_netmap_source->d)) {
+    upipe_netmap_source->ring =
+        upipe_netmap_source_ring_alloc(uri, upipe_netmap_source->ring_idx);
+    if (unlikely(!upipe_netmap_source->ring)) {
         upipe_err_va(upipe, "can't open netmap socket %s", uri);
         return UBASE_ERR_EXTERNAL;
     }
 
     upipe_netmap_source->uri = strdup(uri);
     if (unlikely(upipe_netmap_source->uri == NULL)) {
-        nm_close(upipe_netmap_source->d);
-        upipe_netmap_source->d = NULL;
+        upipe_netmap_source_close(upipe);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return UBASE_ERR_ALLOC;
     }
@@ -381,13 +554,10 @@ static int upipe_netmap_source_control(struct upipe *upipe, int command, va_list
  */
 static void upipe_netmap_source_free(struct upipe *upipe)
 {
-    struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
-
-    nm_close(upipe_netmap_source->d);
+    upipe_netmap_source_close(upipe);
 
     upipe_throw_dead(upipe);
 
-    free(upipe_netmap_source->uri);
     upipe_netmap_source_clean_uclock(upipe);
     upipe_netmap_source_clean_upump(upipe);
     upipe_netmap_source_clean_upump_mgr(upipe);
@@ -55,6 +55,12 @@
 #include <errno.h>
 #include <math.h>
 #include <assert.h>
+#include <sched.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
 
 /** @internal @This is the private context for pthread. */
 struct upipe_pthread_ctx {
@@ -76,8 +82,79 @@ struct upipe_pthread_ctx {
     struct umutex *mutex;
     /** thread name */
     char *name;
+    /** thread placement attributes */
+    struct upipe_pthread_xfer_attr xfer_attr;
 };
 
+/** @internal @This applies the CPU affinity, scheduling policy and memory
+ * policy to the current thread.
+ *
+ * @param pthread_ctx private context of the thread
+ */
+static void upipe_pthread_place(struct upipe_pthread_ctx *pthread_ctx)
+{
+    struct upipe_pthread_xfer_attr *xfer_attr = &pthread_ctx->xfer_attr;
+    struct uprobe *uprobe = pthread_ctx->uprobe_pthread_upump_mgr;
+    int err;
+
+#ifdef __linux__
+    cpu_set_t cpuset;
+    bool has_cpus = false;
+    CPU_ZERO(&cpuset);
+    for (unsigned int cpu = 0;
+         cpu < UPIPE_PTHREAD_XFER_MAX_CPUS && cpu < CPU_SETSIZE; cpu++)
+        if (xfer_attr->cpus[cpu / 64] & (UINT64_C(1) << (cpu % 64))) {
+            CPU_SET(cpu, &cpuset);
+            has_cpus = true;
+        }
+    if (has_cpus &&
+        (err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset),
+                                      &cpuset)) != 0)
+        uprobe_warn_va(uprobe, NULL, "unable to set CPU affinity (%s)",
+                       strerror(err));
+
+    if (xfer_attr->numa_node >= 0) {
+        unsigned long nodemask[64 / sizeof(unsigned long)] = { 0 };
+        unsigned int maxnode = sizeof(nodemask) * 8;
+        if ((unsigned int)xfer_attr->numa_node >= maxnode)
+            uprobe_warn_va(uprobe, NULL, "invalid NUMA node %d",
+                           xfer_attr->numa_node);
+        else {
+            unsigned int bits = sizeof(unsigned long) * 8;
+            nodemask[xfer_attr->numa_node / bits] |=
+                1UL << (xfer_attr->numa_node % bits);
+            if (syscall(SYS_set_mempolicy,
+                        xfer_attr->numa_strict ? MPOL_BIND : MPOL_PREFERRED,
+                        nodemask, maxnode + 1) != 0)
+                uprobe_warn_va(uprobe, NULL,
+                               "unable to set memory node %d (%m)",
+                               xfer_attr->numa_node);
+        }
+    }
+#else
+    for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(xfer_attr->cpus); i++)
+        if (xfer_attr->cpus[i]) {
+            uprobe_warn(uprobe, NULL, "CPU affinity is not supported");
+            break;
+        }
+    if (xfer_attr->numa_node >= 0)
+        uprobe_warn(uprobe, NULL, "memory node is not supported");
+#endif
+
+    if (xfer_attr->sched_policy >= 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = xfer_attr->sched_priority;
+        if ((err = pthread_setschedparam(pthread_self(),
+                                         xfer_attr->sched_policy,
+                                         &param)) != 0)
+            uprobe_warn_va(uprobe, NULL,
+                           "unable to set scheduling policy %d priority %d "
+                           "(%s)", xfer_attr->sched_policy,
+                           xfer_attr->sched_priority, strerror(err));
+    }
+}
+
 /** @internal @This is the main function of the new thread.
  *
  * @param mgr pointer to a upipe pthread manager
@@ -96,6 +173,9 @@ static void *upipe_pthread_start(void *_pthread_ctx)
 #endif
     }
 
+    /* bind to CPUs and memory node */
+    upipe_pthread_place(pthread_ctx);
+
     /* disable signals */
     sigset_t sigs;
     sigemptyset(&sigs);
@@ -168,7 +248,8 @@ static void upipe_pthread_stop(struct upump *upump)
 }
 
 /** @This returns a management structure for transfer pipes, using a new
- * pthread. You would need one management structure per target thread.
+ * pthread with a custom name, CPU affinity, scheduling policy and memory
+ * node. You would need one management structure per target thread.
  *
  * @param queue_length maximum length of the internal queue of commands
  * @param msg_pool_depth maximum number of messages in the pool
@@ -181,14 +262,16 @@ static void upipe_pthread_stop(struct upump *upump)
  * @param mutex mutual exclusion pimitives to access the event loop, or NULL
  * @param pthread_id_p reference to created thread ID (may be NULL)
  * @param attr pthread attributes
+ * @param xfer_attr thread placement attributes (may be NULL)
+ * @param name custom name (may be NULL)
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_attr(unsigned int queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
         pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
-        const char *name)
+        const struct upipe_pthread_xfer_attr *xfer_attr, const char *name)
 {
     struct upipe_pthread_ctx *pthread_ctx =
         malloc(sizeof(struct upipe_pthread_ctx));
@@ -223,6 +306,10 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(uint8_t queue_length,
     pthread_ctx->upump_blocker_pool_depth = upump_blocker_pool_depth;
     pthread_ctx->mutex = umutex_use(mutex);
     pthread_ctx->name = name ? strdup(name) : NULL;
+    if (xfer_attr != NULL)
+        pthread_ctx->xfer_attr = *xfer_attr;
+    else
+        upipe_pthread_xfer_attr_init(&pthread_ctx->xfer_attr);
 
     if (unlikely(pthread_create(&pthread_ctx->pthread_id, attr,
                                 upipe_pthread_start, pthread_ctx) != 0))
@@ -248,7 +335,27 @@ upipe_pthread_xfer_mgr_alloc_err1:
     return NULL;
 }
 
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_named(unsigned int queue_length,
+        uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+        const char *name)
+{
+    return upipe_pthread_xfer_mgr_alloc_attr(queue_length,
+                                             msg_pool_depth,
+                                             uprobe_pthread_upump_mgr,
+                                             upump_mgr_alloc,
+                                             upump_pool_depth,
+                                             upump_blocker_pool_depth,
+                                             mutex,
+                                             pthread_id_p,
+                                             attr,
+                                             NULL,
+                                             name);
+}
+
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(unsigned int queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
@@ -44,6 +44,8 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/ulist.h>
+#include <upipe/uslice.h>
 #include <upipe-swscale/upipe_sws.h>
 #include <upipe-av/upipe_av_pixfmt.h>
 
@@ -57,7 +59,18 @@
 #include <assert.h>
 
 #include <libavutil/opt.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
 #include <libswscale/swscale.h>
+#include <libswscale/version.h>
+
+/** maximum number of pictures converted in the background */
+#define MAX_PIPELINE 16
+
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+/** swscale is able to output a range of lines of a picture */
+#define UPIPE_SWS_SLICES
+#endif
 
 /** @hidden */
 static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
@@ -65,6 +78,54 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
 /** @hidden */
 static int upipe_sws_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @internal @This describes a picture being converted. */
+struct upipe_sws_pic {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** input picture, to which the output buffer is attached */
+    struct uref *uref;
+    /** output buffer */
+    struct ubuf *ubuf;
+    /** true if the picture is progressive */
+    bool progressive;
+    /** horizontal size of the input picture */
+    int input_hsize;
+    /** vertical size of the input picture */
+    int input_vsize;
+    /** horizontal size of the output picture */
+    int output_hsize;
+    /** vertical size of the output picture */
+    int output_vsize;
+    /** mapped input planes */
+    const uint8_t *input_planes[UPIPE_AV_MAX_PLANES + 1];
+    /** strides of the input planes */
+    int input_strides[UPIPE_AV_MAX_PLANES + 1];
+    /** mapped output planes */
+    uint8_t *output_planes[UPIPE_AV_MAX_PLANES + 1];
+    /** strides of the output planes */
+    int output_strides[UPIPE_AV_MAX_PLANES + 1];
+    /** pointer to the pipe */
+    struct upipe_sws *upipe_sws;
+    /** conversion job, split into slices of lines */
+    struct uslice_job job;
+    /** true if the conversion of a slice failed, for each slice */
+    bool errors[USLICE_MAX_THREADS];
+};
+
+UBASE_FROM_TO(upipe_sws_pic, uchain, uchain, uchain)
+
+/** @internal @This is the conversion context of a thread. */
+struct upipe_sws_ctx {
+    /** swscale image conversion context [0] for progressive, [1,2] interlaced */
+    struct SwsContext *convert_ctx[3];
+#ifdef UPIPE_SWS_SLICES
+    /** frame wrapping the input planes */
+    AVFrame *input_frame;
+    /** frame wrapping the output planes */
+    AVFrame *output_frame;
+#endif
+};
+
 /** upipe_sws structure with swscale parameters */
 struct upipe_sws {
     /** refcount management structure */
@@ -101,8 +162,8 @@ struct upipe_sws {
 
     /** swscale flags */
     int flags;
-    /** swscale image conversion context [0] for progressive, [1,2] interlaced */
-    struct SwsContext *convert_ctx[3];
+    /** conversion context of the thread calling @ref upipe_input */
+    struct upipe_sws_ctx ctx;
     /** input pixel format */
     enum AVPixelFormat input_pix_fmt;
     /** requested output pixel format */
@@ -121,6 +182,38 @@ struct upipe_sws {
     int output_color_range;
     /** true if the we already tried to set the colorspace, but failed at it */
     bool colorspace_invalid;
+    /** true if the conversion contexts match the sizes below */
+    bool ctx_valid;
+    /** input horizontal size the contexts are configured for */
+    size_t ctx_input_hsize;
+    /** input vertical size the contexts are configured for */
+    size_t ctx_input_vsize;
+    /** output horizontal size the contexts are configured for */
+    uint64_t ctx_output_hsize;
+    /** output vertical size the contexts are configured for */
+    uint64_t ctx_output_vsize;
+
+    /** pool of conversion threads */
+    struct uslice_pool pool;
+    /** conversion contexts of the worker threads (threads - 1) */
+    struct upipe_sws_ctx *workers_ctx;
+    /** number of pictures converted in the background */
+    unsigned int pipeline;
+    /** number of pictures in the list below */
+    unsigned int nb_pics;
+    /** pictures being converted, in input order */
+    struct uchain pics;
+    /** unused picture descriptions */
+    struct uchain pics_pool;
+#ifdef UPIPE_SWS_SLICES
+    /** dummy buffer referenced by the frames wrapping mapped planes */
+    AVBufferRef *frame_buf;
+    /** true if pictures may be split into slices */
+    bool slices;
+    /** vertical chroma subsampling libswscale wrongly applies to the luma
+     * plane of slices */
+    int slice_luma_shift;
+#endif
 
     /** public upipe structure */
     struct upipe upipe;
@@ -163,64 +256,106 @@ static int upipe_sws_convert_color(struct upipe *upipe, struct uref *flow_def)
     return colorspace;
 }
 
-/** @internal @This handles data.
+#ifdef UPIPE_SWS_SLICES
+/** @internal @This does nothing, as the frames only wrap mapped planes.
  *
- * @param upipe description structure of the pipe
- * @param uref uref structure describing the picture
- * @param upump_p reference to pump that generated the buffer
- * @return false if the input must be blocked
+ * @param opaque unused
+ * @param data unused
  */
-static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
-                             struct upump **upump_p)
+static void upipe_sws_frame_buf_free(void *opaque, uint8_t *data)
 {
-    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
-    const char *def;
-    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
-        upipe_sws_store_flow_def(upipe, NULL);
-        uref = upipe_sws_store_flow_def_input(upipe, uref);
-        struct urational dar;
-        if (ubase_check(uref_pic_flow_get_dar(uref, &dar)) &&
-            !ubase_check(uref_pic_flow_get_sar(uref, NULL)))
-            uref_pic_flow_infer_sar(uref, dar);
-        upipe_sws_require_ubuf_mgr(upipe, uref);
-        return true;
-    }
+}
+#endif
 
-    if (upipe_sws->flow_def == NULL)
-        return false;
+/** @internal @This frees the conversion context of a thread.
+ *
+ * @param ctx conversion context
+ */
+static void upipe_sws_free_ctx(struct upipe_sws_ctx *ctx)
+{
+    for (int i = 0; i < 3; i++) {
+        if (likely(ctx->convert_ctx[i]))
+            sws_freeContext(ctx->convert_ctx[i]);
+        ctx->convert_ctx[i] = NULL;
+    }
+#ifdef UPIPE_SWS_SLICES
+    av_frame_free(&ctx->input_frame);
+    av_frame_free(&ctx->output_frame);
+#endif
+}
 
-    size_t input_hsize, input_vsize;
-    if (!ubase_check(uref_pic_size(uref, &input_hsize, &input_vsize, NULL))) {
-        upipe_warn(upipe, "invalid buffer received");
-        uref_free(uref);
-        return true;
+/** @internal @This allocates the conversion context of a thread.
+ *
+ * @param upipe_sws private context of the pipe
+ * @param ctx conversion context to fill in
+ * @return false in case of allocation error
+ */
+static bool upipe_sws_alloc_ctx(struct upipe_sws *upipe_sws,
+                                struct upipe_sws_ctx *ctx)
+{
+    memset(ctx, 0, sizeof (*ctx));
+    for (int i = 0; i < 3; i++) {
+        ctx->convert_ctx[i] = sws_alloc_context();
+        if (!ctx->convert_ctx[i])
+            goto fail;
     }
+#ifdef UPIPE_SWS_SLICES
+    if (unlikely((ctx->input_frame = av_frame_alloc()) == NULL ||
+                 (ctx->output_frame = av_frame_alloc()) == NULL ||
+                 (ctx->input_frame->buf[0] =
+                    av_buffer_ref(upipe_sws->frame_buf)) == NULL ||
+                 (ctx->output_frame->buf[0] =
+                    av_buffer_ref(upipe_sws->frame_buf)) == NULL))
+        goto fail;
+#endif
+    return true;
 
-    int progressive = ubase_check(uref_pic_get_progressive(uref)) ? 1 : 0;
-    if (unlikely(!progressive && input_vsize % 2)) {
-        upipe_warn(upipe, "interlaced picture has odd vertical size");
-        progressive = 1;
+fail:
+    upipe_sws_free_ctx(ctx);
+    return false;
+}
+
+/** @internal @This configures a set of conversion contexts for the given
+ * picture sizes.
+ *
+ * @param upipe description structure of the pipe
+ * @param ctx conversion context of a thread
+ * @param input_hsize horizontal size of the input pictures
+ * @param input_vsize vertical size of the input pictures
+ * @param output_hsize horizontal size of the output pictures
+ * @param output_vsize vertical size of the output pictures
+ * @return false in case of error
+ */
+static bool upipe_sws_setup_ctx(struct upipe *upipe,
+                                struct upipe_sws_ctx *ctx,
+                                size_t input_hsize, size_t input_vsize,
+                                uint64_t output_hsize, uint64_t output_vsize)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    struct SwsContext **convert_ctx = ctx->convert_ctx;
+
+    if (upipe_sws->input_pix_fmt == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(convert_ctx[0], "src_v_chr_pos", 128, 0);
+        av_opt_set_int(convert_ctx[1], "src_v_chr_pos", 64, 0);
+        av_opt_set_int(convert_ctx[2], "src_v_chr_pos", 192, 0);
     }
 
-    uint64_t output_hsize, output_vsize;
-    if (!ubase_check(uref_pic_flow_get_hsize(upipe_sws->flow_def_attr, &output_hsize)) ||
-        !ubase_check(uref_pic_flow_get_vsize(upipe_sws->flow_def_attr, &output_vsize))) {
-        /* comes handy in case of format conversion with no rescaling */
-        output_hsize = input_hsize;
-        output_vsize = input_vsize;
+    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(convert_ctx[0], "dst_v_chr_pos", 128, 0);
+        av_opt_set_int(convert_ctx[1], "dst_v_chr_pos", 64, 0);
+        av_opt_set_int(convert_ctx[2], "dst_v_chr_pos", 192, 0);
     }
 
     int i;
     for (i = 0; i < 3; i++) {
-        upipe_sws->convert_ctx[i] = sws_getCachedContext(upipe_sws->convert_ctx[i],
+        convert_ctx[i] = sws_getCachedContext(convert_ctx[i],
                     input_hsize, input_vsize >> !!i, upipe_sws->input_pix_fmt,
                     output_hsize, output_vsize >> !!i, upipe_sws->output_pix_fmt,
                     upipe_sws->flags, NULL, NULL, NULL);
 
-        if (unlikely(upipe_sws->convert_ctx[i] == NULL)) {
+        if (unlikely(convert_ctx[i] == NULL)) {
             upipe_err(upipe, "sws_getContext failed");
-            uref_free(uref);
-            return true;
+            return false;
         }
 
         if (upipe_sws->colorspace_invalid)
@@ -229,7 +364,7 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
         int in_full, out_full, brightness, contrast, saturation;
         const int *inv_table, *table;
 
-        if (unlikely(sws_getColorspaceDetails(upipe_sws->convert_ctx[i],
+        if (unlikely(sws_getColorspaceDetails(convert_ctx[i],
                         (int **)&inv_table, &in_full, (int **)&table, &out_full,
                         &brightness, &contrast, &saturation) < 0)) {
             upipe_warn(upipe, "unable to set color space data");
@@ -246,21 +381,427 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
         if (upipe_sws->output_color_range != -1)
             out_full = upipe_sws->output_color_range;
 
-        if (unlikely(sws_setColorspaceDetails(upipe_sws->convert_ctx[i],
+        if (unlikely(sws_setColorspaceDetails(convert_ctx[i],
                         inv_table, in_full, table, out_full,
                         brightness, contrast, saturation) < 0)) {
             upipe_warn(upipe, "unable to set color space data");
             upipe_sws->colorspace_invalid = true;
         }
     }
+    return true;
+}
+
+/** @internal @This returns an unused picture description.
+ *
+ * @param upipe description structure of the pipe
+ * @return pointer to a picture description, or NULL in case of error
+ */
+static struct upipe_sws_pic *upipe_sws_pic_alloc(struct upipe *upipe)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    struct uchain *uchain = ulist_pop(&upipe_sws->pics_pool);
+    if (uchain != NULL)
+        return upipe_sws_pic_from_uchain(uchain);
+
+    struct upipe_sws_pic *pic = malloc(sizeof (struct upipe_sws_pic));
+    if (unlikely(pic == NULL))
+        return NULL;
+    uchain_init(&pic->uchain);
+    pic->upipe_sws = upipe_sws;
+    return pic;
+}
+
+#ifdef UPIPE_SWS_SLICES
+/** @internal @This wraps the planes of a picture or field into a frame.
+ *
+ * @param frame frame to fill in
+ * @param planes mapped planes
+ * @param strides strides of the planes
+ * @param field 0 for a progressive picture, 1 or 2 for a field
+ * @param pix_fmt pixel format of the planes
+ * @param hsize horizontal size of the picture
+ * @param vsize vertical size of the picture or field
+ */
+static void upipe_sws_wrap_frame(AVFrame *frame, uint8_t *const *planes,
+                                 const int *strides, int field,
+                                 enum AVPixelFormat pix_fmt,
+                                 int hsize, int vsize)
+{
+    for (int i = 0; i < AV_NUM_DATA_POINTERS; i++) {
+        if (i >= UPIPE_AV_MAX_PLANES || planes[i] == NULL) {
+            frame->data[i] = NULL;
+            frame->linesize[i] = 0;
+            continue;
+        }
+        frame->data[i] = planes[i];
+        if (field == 2)
+            frame->data[i] += strides[i] >> 1;
+        frame->linesize[i] = strides[i];
+    }
+    frame->format = pix_fmt;
+    frame->width = hsize;
+    frame->height = vsize;
+}
+#endif
+
+/** @internal @This converts a slice of lines of a picture. With swscale
+ * versions unable to output a range of lines, there is a single slice.
+ *
+ * @param upipe_sws private context of the pipe
+ * @param pic description of the picture
+ * @param slice index of the slice
+ * @param ctx conversion context of the calling thread
+ * @return false in case of error
+ */
+static bool upipe_sws_convert_slice(struct upipe_sws *upipe_sws,
+                                    struct upipe_sws_pic *pic,
+                                    unsigned int slice,
+                                    struct upipe_sws_ctx *ctx)
+{
+    int first = pic->progressive ? 0 : 1;
+    int last = pic->progressive ? 0 : 2;
+    for (int i = first; i <= last; i++) {
+        struct SwsContext *convert_ctx = ctx->convert_ctx[i];
+#ifdef UPIPE_SWS_SLICES
+        int input_vsize = pic->input_vsize >> !!i;
+        int output_vsize = pic->output_vsize >> !!i;
+        int align = sws_receive_slice_alignment(convert_ctx);
+        int lines = (output_vsize + pic->job.nb_slices - 1) /
+                    pic->job.nb_slices;
+        lines = (lines + align - 1) / align * align;
+        int start = lines * slice;
+        if (start >= output_vsize)
+            continue;
+        if (lines > output_vsize - start)
+            lines = output_vsize - start;
+
+        AVFrame *input = ctx->input_frame;
+        AVFrame *output = ctx->output_frame;
+        upipe_sws_wrap_frame(input, (uint8_t *const *)pic->input_planes,
+                             pic->input_strides, i, upipe_sws->input_pix_fmt,
+                             pic->input_hsize, input_vsize);
+        upipe_sws_wrap_frame(output, pic->output_planes,
+                             pic->output_strides, i, upipe_sws->output_pix_fmt,
+                             pic->output_hsize, output_vsize);
+        int shift = start - (start >> upipe_sws->slice_luma_shift);
+        for (int j = 0; j < 4; j += 3)
+            if (output->data[j] != NULL)
+                output->data[j] += output->linesize[j] * shift;
+
+        if (unlikely(sws_frame_start(convert_ctx, output, input) < 0))
+            return false;
+        int ret = sws_send_slice(convert_ctx, 0, input_vsize);
+        if (likely(ret >= 0))
+            ret = sws_receive_slice(convert_ctx, start, lines);
+        sws_frame_end(convert_ctx);
+        if (unlikely(ret < 0))
+            return false;
+#else
+        const uint8_t *input_planes[UPIPE_AV_MAX_PLANES + 1];
+        uint8_t *output_planes[UPIPE_AV_MAX_PLANES + 1];
+        for (int j = 0; j < UPIPE_AV_MAX_PLANES + 1; j++) {
+            input_planes[j] = pic->input_planes[j];
+            if (i == 2 && input_planes[j] != NULL)
+                input_planes[j] += pic->input_strides[j] >> 1;
+            output_planes[j] = pic->output_planes[j];
+            if (i == 2 && output_planes[j] != NULL)
+                output_planes[j] += pic->output_strides[j] >> 1;
+        }
+        int input_vsize = i == 0 ? pic->input_vsize :
+                          i == 1 ? (pic->input_vsize + 1) / 2 :
+                                   pic->input_vsize / 2;
+        if (unlikely(sws_scale(convert_ctx,
+                               input_planes, pic->input_strides,
+                               0, input_vsize,
+                               output_planes, pic->output_strides) <= 0))
+            return false;
+#endif
+    }
+    return true;
+}
+
+#ifdef UPIPE_SWS_SLICES
+/** @internal @This checks where libswscale writes a slice of lines which
+ * does not start at the top of the picture. Some versions offset the luma
+ * plane of vertically subsampled formats as if it were a chroma plane.
+ *
+ * @param upipe description structure of the pipe
+ * @return 0 if slices are written in place, 1 if the luma plane is offset
+ * like a chroma plane, and -1 if slices are not usable
+ */
+static int upipe_sws_probe_slices(struct upipe *upipe)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    uint8_t input[3][16 * 32], output[3][16 * 16];
+    uint8_t *input_planes[UPIPE_AV_MAX_PLANES + 1] =
+        { input[0], input[1], input[2], NULL };
+    uint8_t *output_planes[UPIPE_AV_MAX_PLANES + 1] =
+        { output[0], output[1], output[2], NULL };
+    int strides[UPIPE_AV_MAX_PLANES + 1] = { 16, 8, 8, 0 };
+    struct upipe_sws_ctx ctx;
+    int ret = -1;
+
+    if (unlikely(!upipe_sws_alloc_ctx(upipe_sws, &ctx)))
+        return -1;
+    struct SwsContext *convert_ctx = ctx.convert_ctx[0] =
+        sws_getCachedContext(ctx.convert_ctx[0],
+                             16, 32, AV_PIX_FMT_YUV420P,
+                             16, 16, AV_PIX_FMT_YUV420P,
+                             SWS_POINT, NULL, NULL, NULL);
+    if (unlikely(convert_ctx == NULL))
+        goto end;
+    int align = sws_receive_slice_alignment(convert_ctx);
+    if (unlikely(align > 8))
+        goto end;
+
+    /* convert lines [align, 2 * align[ of a flat picture */
+    memset(input[0], 200, sizeof (input[0]));
+    memset(input[1], 128, sizeof (input[1]));
+    memset(input[2], 128, sizeof (input[2]));
+    memset(output, 0, sizeof (output));
+    upipe_sws_wrap_frame(ctx.input_frame, input_planes, strides, 0,
+                         AV_PIX_FMT_YUV420P, 16, 32);
+    upipe_sws_wrap_frame(ctx.output_frame, output_planes, strides, 0,
+                         AV_PIX_FMT_YUV420P, 16, 16);
+
+    if (unlikely(sws_frame_start(convert_ctx, ctx.output_frame,
+                                 ctx.input_frame) < 0))
+        goto end;
+    if (sws_send_slice(convert_ctx, 0, 32) >= 0 &&
+        sws_receive_slice(convert_ctx, align, align) >= 0) {
+        if (output[0][16 * (align - 1)])
+            ret = 1;
+        else if (output[0][16 * align])
+            ret = 0;
+    }
+    sws_frame_end(convert_ctx);
+
+end:
+    upipe_sws_free_ctx(&ctx);
+    return ret;
+}
+#endif
+
+/** @internal @This converts a slice of a queued picture, with the conversion
+ * context of the calling thread.
+ *
+ * @param job conversion job of the picture
+ * @param slice index of the slice
+ * @param thread index of the thread
+ */
+static void upipe_sws_work_slice(struct uslice_job *job, unsigned int slice,
+                                 unsigned int thread)
+{
+    struct upipe_sws_pic *pic = container_of(job, struct upipe_sws_pic, job);
+    struct upipe_sws *upipe_sws = pic->upipe_sws;
+    struct upipe_sws_ctx *ctx = thread ? &upipe_sws->workers_ctx[thread - 1] :
+                                         &upipe_sws->ctx;
+    pic->errors[slice] = !upipe_sws_convert_slice(upipe_sws, pic, slice, ctx);
+}
+
+/** @internal @This queues a picture for conversion by the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param pic description of the picture
+ */
+static void upipe_sws_queue_pic(struct upipe *upipe,
+                                struct upipe_sws_pic *pic)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    /* in pipelined mode, slices are sized for the worker threads */
+    unsigned int nb_slices = uslice_pool_get_threads(&upipe_sws->pool);
+    if (upipe_sws->pipeline && nb_slices > 1)
+        nb_slices--;
+#ifdef UPIPE_SWS_SLICES
+    if (!upipe_sws->slices)
+        nb_slices = 1;
+#else
+    nb_slices = 1;
+#endif
+    uslice_job_init(&pic->job, upipe_sws_work_slice, nb_slices);
+
+    ulist_add(&upipe_sws->pics, upipe_sws_pic_to_uchain(pic));
+    uslice_pool_queue(&upipe_sws->pool, &pic->job);
+    upipe_sws->nb_pics++;
+}
+
+/** @internal @This converts on the calling thread the slices of a picture
+ * which have not been picked by worker threads, and waits for the others.
+ *
+ * @param upipe description structure of the pipe
+ * @param pic description of the picture
+ * @return false if the conversion of a slice failed
+ */
+static bool upipe_sws_wait_pic(struct upipe *upipe, struct upipe_sws_pic *pic)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    uslice_pool_wait(&upipe_sws->pool, &pic->job);
+    ulist_delete(upipe_sws_pic_to_uchain(pic));
+    upipe_sws->nb_pics--;
+
+    for (unsigned int i = 0; i < pic->job.nb_slices; i++)
+        if (unlikely(pic->errors[i]))
+            return false;
+    return true;
+}
+
+/** @internal @This outputs the oldest converted pictures, in input order,
+ * until at most the given number of pictures are still being converted.
+ *
+ * @param upipe description structure of the pipe
+ * @param max maximum number of pictures left in the queue
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_sws_output_pics(struct upipe *upipe, unsigned int max,
+                                  struct upump **upump_p)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+
+    while (upipe_sws->nb_pics > max) {
+        struct upipe_sws_pic *pic =
+            upipe_sws_pic_from_uchain(ulist_peek(&upipe_sws->pics));
+        bool error = !upipe_sws_wait_pic(upipe, pic);
+
+        /* unmap pictures */
+        int i;
+        for (i = 0; i < UPIPE_AV_MAX_PLANES &&
+                    upipe_sws->input_chroma_map[i] != NULL; i++)
+            uref_pic_plane_unmap(pic->uref, upipe_sws->input_chroma_map[i],
+                                 0, 0, -1, -1);
+        for (i = 0; i < UPIPE_AV_MAX_PLANES &&
+                    upipe_sws->output_chroma_map[i] != NULL; i++)
+            ubuf_pic_plane_unmap(pic->ubuf, upipe_sws->output_chroma_map[i],
+                                 0, 0, -1, -1);
+
+        struct uref *uref = pic->uref;
+        struct ubuf *ubuf = pic->ubuf;
+        ulist_add(&upipe_sws->pics_pool, upipe_sws_pic_to_uchain(pic));
+
+        /* clean and attach */
+        if (unlikely(error)) {
+            upipe_warn(upipe, "error during sws conversion");
+            ubuf_free(ubuf);
+            uref_free(uref);
+            continue;
+        }
+        uref_attach_ubuf(uref, ubuf);
+        upipe_sws_output(upipe, uref, upump_p);
+    }
+}
+
+/** @internal @This checks that the conversion contexts of all threads are
+ * configured for the given picture sizes, and reconfigures them after the
+ * pictures being converted are output otherwise.
+ *
+ * @param upipe description structure of the pipe
+ * @param input_hsize horizontal size of the input pictures
+ * @param input_vsize vertical size of the input pictures
+ * @param output_hsize horizontal size of the output pictures
+ * @param output_vsize vertical size of the output pictures
+ * @param upump_p reference to pump that generated the buffer
+ * @return false in case of error
+ */
+static bool upipe_sws_configure(struct upipe *upipe,
+                                size_t input_hsize, size_t input_vsize,
+                                uint64_t output_hsize, uint64_t output_vsize,
+                                struct upump **upump_p)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    if (likely(upipe_sws->ctx_valid &&
+               upipe_sws->ctx_input_hsize == input_hsize &&
+               upipe_sws->ctx_input_vsize == input_vsize &&
+               upipe_sws->ctx_output_hsize == output_hsize &&
+               upipe_sws->ctx_output_vsize == output_vsize))
+        return true;
+
+    upipe_sws_output_pics(upipe, 0, upump_p);
+    upipe_sws->ctx_valid = false;
+    if (!upipe_sws_setup_ctx(upipe, &upipe_sws->ctx,
+                             input_hsize, input_vsize,
+                             output_hsize, output_vsize))
+        return false;
+    for (unsigned int i = 0;
+         i < uslice_pool_get_threads(&upipe_sws->pool) - 1; i++)
+        if (!upipe_sws_setup_ctx(upipe, &upipe_sws->workers_ctx[i],
+                                 input_hsize, input_vsize,
+                                 output_hsize, output_vsize))
+            return false;
+
+    upipe_sws->ctx_valid = true;
+    upipe_sws->ctx_input_hsize = input_hsize;
+    upipe_sws->ctx_input_vsize = input_vsize;
+    upipe_sws->ctx_output_hsize = output_hsize;
+    upipe_sws->ctx_output_vsize = output_vsize;
+    return true;
+}
+
+/** @internal @This handles data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure describing the picture
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be blocked
+ */
+static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
+                             struct upump **upump_p)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_sws_output_pics(upipe, 0, upump_p);
+        upipe_sws_store_flow_def(upipe, NULL);
+        uref = upipe_sws_store_flow_def_input(upipe, uref);
+        struct urational dar;
+        if (ubase_check(uref_pic_flow_get_dar(uref, &dar)) &&
+            !ubase_check(uref_pic_flow_get_sar(uref, NULL)))
+            uref_pic_flow_infer_sar(uref, dar);
+        upipe_sws_require_ubuf_mgr(upipe, uref);
+        return true;
+    }
+
+    if (upipe_sws->flow_def == NULL)
+        return false;
+
+    size_t input_hsize, input_vsize;
+    if (!ubase_check(uref_pic_size(uref, &input_hsize, &input_vsize, NULL))) {
+        upipe_warn(upipe, "invalid buffer received");
+        uref_free(uref);
+        return true;
+    }
+
+    int progressive = ubase_check(uref_pic_get_progressive(uref)) ? 1 : 0;
+    if (unlikely(!progressive && input_vsize % 2)) {
+        upipe_warn(upipe, "interlaced picture has odd vertical size");
+        progressive = 1;
+    }
+
+    uint64_t output_hsize, output_vsize;
+    if (!ubase_check(uref_pic_flow_get_hsize(upipe_sws->flow_def_attr, &output_hsize)) ||
+        !ubase_check(uref_pic_flow_get_vsize(upipe_sws->flow_def_attr, &output_vsize))) {
+        /* comes handy in case of format conversion with no rescaling */
+        output_hsize = input_hsize;
+        output_vsize = input_vsize;
+    }
+
+    if (unlikely(!upipe_sws_configure(upipe, input_hsize, input_vsize,
+                                      output_hsize, output_vsize, upump_p))) {
+        uref_free(uref);
+        return true;
+    }
 
     upipe_verbose_va(upipe, "%s -> %s",
         av_get_pix_fmt_name(upipe_sws->input_pix_fmt),
         av_get_pix_fmt_name(upipe_sws->output_pix_fmt));
 
+    struct upipe_sws_pic *pic = upipe_sws_pic_alloc(upipe);
+    if (unlikely(pic == NULL)) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+
     /* map input */
-    const uint8_t *input_planes[UPIPE_AV_MAX_PLANES + 1];
-    int input_strides[UPIPE_AV_MAX_PLANES + 1];
+    int i;
     for (i = 0; i < UPIPE_AV_MAX_PLANES &&
                 upipe_sws->input_chroma_map[i] != NULL; i++) {
         const uint8_t *data;
@@ -272,17 +813,18 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
                                           upipe_sws->input_chroma_map[i],
                                           &stride, NULL, NULL, NULL)))) {
             upipe_warn(upipe, "invalid buffer received");
+            ulist_add(&upipe_sws->pics_pool, upipe_sws_pic_to_uchain(pic));
             uref_free(uref);
             return true;
         }
-        input_planes[i] = data;
-        input_strides[i] = stride * (1+!progressive);
+        pic->input_planes[i] = data;
+        pic->input_strides[i] = stride * (1+!progressive);
         upipe_verbose_va(upipe, "input_stride[%d] %d",
-                         i, input_strides[i]);
+                         i, pic->input_strides[i]);
     }
-    for ( ; i < UPIPE_AV_MAX_PLANES; i++) {
-        input_planes[i] = NULL;
-        input_strides[i] = 0;
+    for ( ; i < UPIPE_AV_MAX_PLANES + 1; i++) {
+        pic->input_planes[i] = NULL;
+        pic->input_strides[i] = 0;
     }
 
     /* allocate dest ubuf */
@@ -293,14 +835,13 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
                     upipe_sws->input_chroma_map[i] != NULL; i++)
             uref_pic_plane_unmap(uref, upipe_sws->input_chroma_map[i],
                                  0, 0, -1, -1);
+        ulist_add(&upipe_sws->pics_pool, upipe_sws_pic_to_uchain(pic));
         uref_free(uref);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return true;
     }
 
     /* map output */
-    uint8_t *output_planes[UPIPE_AV_MAX_PLANES + 1];
-    int output_strides[UPIPE_AV_MAX_PLANES + 1];
     for (i = 0; i < UPIPE_AV_MAX_PLANES &&
                 upipe_sws->output_chroma_map[i] != NULL; i++) {
         uint8_t *data;
@@ -312,63 +853,32 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
                                           upipe_sws->output_chroma_map[i],
                                           &stride, NULL, NULL, NULL)))) {
             upipe_warn(upipe, "invalid buffer received");
+            ulist_add(&upipe_sws->pics_pool, upipe_sws_pic_to_uchain(pic));
             ubuf_free(ubuf);
             uref_free(uref);
             return true;
         }
-        output_planes[i] = data;
-        output_strides[i] = stride * (1+!progressive);
+        pic->output_planes[i] = data;
+        pic->output_strides[i] = stride * (1+!progressive);
         upipe_verbose_va(upipe, "output_stride[%d] %d",
-                         i, output_strides[i]);
+                         i, pic->output_strides[i]);
     }
-    for ( ; i < UPIPE_AV_MAX_PLANES; i++) {
-        output_planes[i] = NULL;
-        output_strides[i] = 0;
+    for ( ; i < UPIPE_AV_MAX_PLANES + 1; i++) {
+        pic->output_planes[i] = NULL;
+        pic->output_strides[i] = 0;
     }
 
-    /* fire ! */
-    int ret = 0, ret2 = 1;
-    if (progressive) {
-        ret = sws_scale(upipe_sws->convert_ctx[0],
-                        input_planes, input_strides, 0, input_vsize,
-                        output_planes, output_strides);
-    }
-    else {
-        ret = sws_scale(upipe_sws->convert_ctx[1],
-                        input_planes, input_strides, 0, (input_vsize+1)/2,
-                        output_planes, output_strides);
-
-        for (i = 0; i < UPIPE_AV_MAX_PLANES && input_planes[i]; i++) {
-                input_planes[i] += input_strides[i] >> 1;
-        }
-        for (i = 0; i < UPIPE_AV_MAX_PLANES && output_planes[i]; i++) {
-                output_planes[i] += output_strides[i] >> 1;
-        }
+    pic->uref = uref;
+    pic->ubuf = ubuf;
+    pic->progressive = progressive;
+    pic->input_hsize = input_hsize;
+    pic->input_vsize = input_vsize;
+    pic->output_hsize = output_hsize;
+    pic->output_vsize = output_vsize;
 
-        ret2 = sws_scale(upipe_sws->convert_ctx[2],
-                         input_planes, input_strides, 0, input_vsize/2,
-                         output_planes, output_strides);
-    }
-
-    /* unmap pictures */
-    for (i = 0; i < UPIPE_AV_MAX_PLANES &&
-                upipe_sws->input_chroma_map[i] != NULL; i++)
-        uref_pic_plane_unmap(uref, upipe_sws->input_chroma_map[i],
-                             0, 0, -1, -1);
-    for (i = 0; i < UPIPE_AV_MAX_PLANES &&
-                upipe_sws->output_chroma_map[i] != NULL; i++)
-        ubuf_pic_plane_unmap(ubuf, upipe_sws->output_chroma_map[i],
-                             0, 0, -1, -1);
-
-    /* clean and attach */
-    if (unlikely(ret <= 0) || unlikely(ret2 <= 0)) {
-        upipe_warn(upipe, "error during sws conversion");
-        ubuf_free(ubuf);
-        uref_free(uref);
-        return true;
-    }
-    uref_attach_ubuf(uref, ubuf);
-    upipe_sws_output(upipe, uref, upump_p);
+    /* fire ! */
+    upipe_sws_queue_pic(upipe, pic);
+    upipe_sws_output_pics(upipe, upipe_sws->pipeline, upump_p);
     return true;
 }
 
@@ -464,6 +974,10 @@ static int upipe_sws_set_flow_def(struct upipe *upipe, struct uref *flow_def)
     UBASE_RETURN(uref_flow_match_def(flow_def, "pic."))
 
     struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    /* pictures being converted refer to the former input format */
+    upipe_sws_output_pics(upipe, 0, NULL);
+    upipe_sws->ctx_valid = false;
+
     if ((upipe_sws->input_pix_fmt =
                 upipe_av_pixfmt_from_flow_def(flow_def, NULL,
                             upipe_sws->input_chroma_map)) == AV_PIX_FMT_NONE ||
@@ -522,17 +1036,6 @@ static int upipe_sws_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         }
     }
 
-    if (upipe_sws->input_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "src_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "src_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "src_v_chr_pos", 192, 0);
-    }
-
-    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "dst_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "dst_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "dst_v_chr_pos", 192, 0);
-    }
     upipe_sws->colorspace_invalid = false;
 
     upipe_input(upipe, flow_def, NULL);
@@ -562,10 +1065,118 @@ static int _upipe_sws_set_flags(struct upipe *upipe, int flags)
 {
     struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
     upipe_sws->flags = flags;
+    upipe_sws->ctx_valid = false;
     upipe_dbg_va(upipe, "setting flags to %d", flags);
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This frees the conversion contexts of the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_workers number of allocated contexts
+ */
+static void upipe_sws_free_workers_ctx(struct upipe *upipe,
+                                       unsigned int nb_workers)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    for (unsigned int i = 0; i < nb_workers; i++)
+        upipe_sws_free_ctx(&upipe_sws->workers_ctx[i]);
+    free(upipe_sws->workers_ctx);
+    upipe_sws->workers_ctx = NULL;
+}
+
+/** @internal @This gets the number of conversion threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_sws_get_threads(struct upipe *upipe,
+                                  unsigned int *threads_p)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_sws->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of conversion threads, and (re)starts
+ * the worker threads after the pictures being converted are output.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_sws_set_threads(struct upipe *upipe, unsigned int threads)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    if (!threads || threads > USLICE_MAX_THREADS)
+        return UBASE_ERR_INVALID;
+    if (threads == uslice_pool_get_threads(&upipe_sws->pool))
+        return UBASE_ERR_NONE;
+
+    unsigned int nb_workers = uslice_pool_get_threads(&upipe_sws->pool) - 1;
+    upipe_sws_output_pics(upipe, 0, NULL);
+    uslice_pool_set_threads(&upipe_sws->pool, 1);
+    upipe_sws_free_workers_ctx(upipe, nb_workers);
+    upipe_sws->ctx_valid = false;
+    if (threads == 1)
+        return UBASE_ERR_NONE;
+
+    upipe_sws->workers_ctx = calloc(threads - 1,
+                                    sizeof (*upipe_sws->workers_ctx));
+    if (unlikely(upipe_sws->workers_ctx == NULL))
+        return UBASE_ERR_ALLOC;
+    for (unsigned int i = 0; i < threads - 1; i++) {
+        if (unlikely(!upipe_sws_alloc_ctx(upipe_sws,
+                                          &upipe_sws->workers_ctx[i]))) {
+            upipe_sws_free_workers_ctx(upipe, i);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+
+    int err = uslice_pool_set_threads(&upipe_sws->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        upipe_err(upipe, "unable to create worker threads");
+        upipe_sws_free_workers_ctx(upipe, threads - 1);
+        return err;
+    }
+    upipe_dbg_va(upipe, "converting with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the number of pictures converted in the background.
+ *
+ * @param upipe description structure of the pipe
+ * @param pipeline_p filled in with the number of pictures
+ * @return an error code
+ */
+static int _upipe_sws_get_pipeline(struct upipe *upipe,
+                                   unsigned int *pipeline_p)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    *pipeline_p = upipe_sws->pipeline;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of pictures converted in the background,
+ * and outputs the pictures in excess.
+ *
+ * @param upipe description structure of the pipe
+ * @param pipeline number of pictures
+ * @return an error code
+ */
+static int _upipe_sws_set_pipeline(struct upipe *upipe, unsigned int pipeline)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    if (pipeline > MAX_PIPELINE)
+        return UBASE_ERR_INVALID;
+
+    upipe_sws->pipeline = pipeline;
+    upipe_sws_output_pics(upipe, pipeline, NULL);
+    upipe_dbg_va(upipe, "converting %u pictures in the background", pipeline);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -613,6 +1224,26 @@ static int upipe_sws_control(struct upipe *upipe, int command, va_list args)
             int flags = va_arg(args, int);
             return _upipe_sws_set_flags(upipe, flags);
         }
+        case UPIPE_SWS_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_sws_get_threads(upipe, threads_p);
+        }
+        case UPIPE_SWS_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_sws_set_threads(upipe, threads);
+        }
+        case UPIPE_SWS_GET_PIPELINE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int *pipeline_p = va_arg(args, unsigned int *);
+            return _upipe_sws_get_pipeline(upipe, pipeline_p);
+        }
+        case UPIPE_SWS_SET_PIPELINE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int pipeline = va_arg(args, unsigned int);
+            return _upipe_sws_set_pipeline(upipe, pipeline);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -652,13 +1283,28 @@ static struct upipe *upipe_sws_alloc(struct upipe_mgr *mgr,
     upipe_sws_init_flow_def(upipe);
     upipe_sws_init_input(upipe);
     upipe_sws->colorspace_invalid = false;
-
-    memset(upipe_sws->convert_ctx, 0, sizeof(upipe_sws->convert_ctx));
-    for (int i = 0; i < 3; i++) {
-        upipe_sws->convert_ctx[i] = sws_alloc_context();
-        if (!upipe_sws->convert_ctx[i])
-            goto fail;
-    }
+    upipe_sws->ctx_valid = false;
+    uslice_pool_init(&upipe_sws->pool);
+    upipe_sws->workers_ctx = NULL;
+    upipe_sws->pipeline = 0;
+    upipe_sws->nb_pics = 0;
+    ulist_init(&upipe_sws->pics);
+    ulist_init(&upipe_sws->pics_pool);
+
+#ifdef UPIPE_SWS_SLICES
+    upipe_sws->frame_buf = av_buffer_create((uint8_t *)upipe_sws, 0,
+                                            upipe_sws_frame_buf_free, NULL, 0);
+    if (unlikely(upipe_sws->frame_buf == NULL))
+        goto fail;
+#endif
+    if (unlikely(!upipe_sws_alloc_ctx(upipe_sws, &upipe_sws->ctx)))
+        goto fail;
+#ifdef UPIPE_SWS_SLICES
+    int probe = upipe_sws_probe_slices(upipe);
+    upipe_sws->slices = probe >= 0;
+    upipe_sws->slice_luma_shift = probe == 1 ?
+        av_pix_fmt_desc_get(upipe_sws->output_pix_fmt)->log2_chroma_h : 0;
+#endif
 
     upipe_sws->flags = SWS_FULL_CHR_H_INP | SWS_ACCURATE_RND | SWS_LANCZOS;
 
@@ -673,11 +1319,10 @@ static struct upipe *upipe_sws_alloc(struct upipe_mgr *mgr,
     return upipe;
 
 fail:
-    for (int i = 0; i < 3; i++) {
-        if (likely(upipe_sws->convert_ctx[i]))
-            sws_freeContext(upipe_sws->convert_ctx[i]);
-        upipe_sws->convert_ctx[i] = NULL;
-    }
+#ifdef UPIPE_SWS_SLICES
+    av_buffer_unref(&upipe_sws->frame_buf);
+#endif
+    uslice_pool_clean(&upipe_sws->pool);
     uref_free(flow_def);
     upipe_sws_free_flow(upipe);
     return NULL;
@@ -690,11 +1335,19 @@ fail:
 static void upipe_sws_free(struct upipe *upipe)
 {
     struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
-    for (int i = 0; i < 3; i++) {
-        if (likely(upipe_sws->convert_ctx[i]))
-            sws_freeContext(upipe_sws->convert_ctx[i]);
-        upipe_sws->convert_ctx[i] = NULL;
-    }
+    /* output the pictures still being converted */
+    upipe_sws_output_pics(upipe, 0, NULL);
+    unsigned int nb_workers = uslice_pool_get_threads(&upipe_sws->pool) - 1;
+    uslice_pool_clean(&upipe_sws->pool);
+    upipe_sws_free_workers_ctx(upipe, nb_workers);
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_sws->pics_pool)) != NULL)
+        free(upipe_sws_pic_from_uchain(uchain));
+#ifdef UPIPE_SWS_SLICES
+    av_buffer_unref(&upipe_sws->frame_buf);
+#endif
+    upipe_sws_free_ctx(&upipe_sws->ctx);
 
     upipe_throw_dead(upipe);
     upipe_sws_clean_input(upipe);
@@ -0,0 +1,50 @@
+;******************************************************************************
+;* SMPTE 2022-1 FEC XOR
+;* Copyright (C) 2026 OpenHeadend S.A.R.L.
+;*
+;* This program is free software; you can redistribute it and/or modify it
+;* under the terms of the GNU Lesser General Public License as published by
+;* the Free Software Foundation; either version 2.1 of the License, or
+;* (at your option) any later version.
+;*
+;* This program is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+;* GNU Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public License
+;* along with this program; if not, write to the Free Software Foundation,
+;* Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+%if ARCH_X86_64
+
+%macro rtp_fec_xor 0
+
+; rtp_fec_xor(uint8_t *dst, const uint8_t *src, ptrdiff_t len)
+cglobal rtp_fec_xor, 3, 3, 2, dst, src, len
+    add     dstq, lenq
+    add     srcq, lenq
+    neg     lenq
+
+.loop:
+    movu    m0, [dstq + lenq]
+    movu    m1, [srcq + lenq]
+    pxor    m0, m1
+    movu    [dstq + lenq], m0
+    add     lenq, mmsize
+    jl      .loop
+    RET
+
+%endmacro
+
+INIT_XMM sse2
+rtp_fec_xor
+INIT_YMM avx2
+rtp_fec_xor
+
+%endif
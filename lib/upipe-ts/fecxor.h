@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short SMPTE 2022-1 FEC XOR kernels
+ *
+ * The kernels XOR len octets of src into dst. The SIMD versions require len
+ * to be a multiple of @ref UPIPE_RTP_FEC_XOR_ALIGN.
+ */
+
+#ifndef _FECXOR_H_
+/** @hidden */
+#define _FECXOR_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/** alignment of the len parameter of SIMD kernels */
+#define UPIPE_RTP_FEC_XOR_ALIGN 32
+
+void upipe_rtp_fec_xor_c(uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+
+void upipe_rtp_fec_xor_sse2(uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+void upipe_rtp_fec_xor_avx2(uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+
+#endif
@@ -0,0 +1,93 @@
+;******************************************************************************
+;* TS sync word scanning
+;* Copyright (C) 2026 OpenHeadend S.A.R.L.
+;*
+;* This program is free software; you can redistribute it and/or modify it
+;* under the terms of the GNU Lesser General Public License as published by
+;* the Free Software Foundation; either version 2.1 of the License, or
+;* (at your option) any later version.
+;*
+;* This program is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+;* GNU Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public License
+;* along with this program; if not, write to the Free Software Foundation,
+;* Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION .text
+
+%if ARCH_X86_64
+
+%macro ts_sync_scan 0
+
+; ts_sync_scan(const uint8_t *src, ptrdiff_t len, ptrdiff_t count,
+;              ptrdiff_t stride1, ptrdiff_t stride2, ptrdiff_t stride3)
+cglobal ts_sync_scan, 6, 12, 5, src, len, count, s1, s2, s3, i, k, o1, o2, o3, mask
+    mov     maskd, 0x47474747
+    movd    xm0, maskd
+%if cpuflag(avx2)
+    vpbroadcastd m0, xm0
+%else
+    pshufd  m0, m0, 0
+%endif
+    xor     id, id
+
+.loop:
+    ; candidate sync words for the three strides
+    movu    m1, [srcq+iq]
+    pcmpeqb m1, m0
+    mova    m2, m1
+    mova    m3, m1
+    lea     o1q, [srcq+iq]
+    mov     o2q, o1q
+    mov     o3q, o1q
+    mov     kq, countq
+
+.next:
+    dec     kq
+    jz .test
+    add     o1q, s1q
+    add     o2q, s2q
+    add     o3q, s3q
+    movu    m4, [o1q]
+    pcmpeqb m4, m0
+    pand    m1, m4
+    movu    m4, [o2q]
+    pcmpeqb m4, m0
+    pand    m2, m4
+    movu    m4, [o3q]
+    pcmpeqb m4, m0
+    pand    m3, m4
+    jmp .next
+
+.test:
+    por     m1, m2
+    por     m1, m3
+    pmovmskb maskd, m1
+    test    maskd, maskd
+    jnz .found
+    add     iq, mmsize
+    cmp     iq, lenq
+    jl .loop
+
+    mov     rax, lenq
+    RET
+
+.found:
+    bsf     maskd, maskd
+    add     maskq, iq
+    mov     rax, maskq
+    RET
+%endmacro
+
+INIT_XMM sse2
+ts_sync_scan
+INIT_YMM avx2
+ts_sync_scan
+
+%endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short TS sync word scanning kernels
+ */
+
+#include <stdbool.h>
+
+#include "tssync.h"
+
+/** TS synchronization word */
+#define TS_SYNC 0x47
+
+/** @internal @This checks the sync words at a given stride.
+ *
+ * @param src pointer to the first sync word
+ * @param count number of sync words
+ * @param stride distance between sync words
+ * @return true if all sync words are present
+ */
+static inline bool upipe_ts_sync_scan_stride(const uint8_t *src,
+                                             ptrdiff_t count,
+                                             ptrdiff_t stride)
+{
+    for (ptrdiff_t k = 1; k < count; k++)
+        if (src[k * stride] != TS_SYNC)
+            return false;
+    return true;
+}
+
+ptrdiff_t upipe_ts_sync_scan_c(const uint8_t *src, ptrdiff_t len,
+                               ptrdiff_t count, ptrdiff_t stride1,
+                               ptrdiff_t stride2, ptrdiff_t stride3)
+{
+    for (ptrdiff_t i = 0; i < len; i++) {
+        if (src[i] != TS_SYNC)
+            continue;
+        if (upipe_ts_sync_scan_stride(src + i, count, stride1) ||
+            upipe_ts_sync_scan_stride(src + i, count, stride2) ||
+            upipe_ts_sync_scan_stride(src + i, count, stride3))
+            return i;
+    }
+    return len;
+}
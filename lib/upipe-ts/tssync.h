@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ */
+
+/** @file
+ * @short TS sync word scanning kernels
+ *
+ * The kernels return the first offset i in [0, len[ such that
+ * src[i + k * stride] is a sync word for all k in [0, count[, and for
+ * at least one of the three strides, or len if there is none. They read
+ * up to src[len - 1 + (count - 1) * max(stride)]. The SIMD versions require
+ * len to be a multiple of @ref UPIPE_TS_SYNC_SCAN_ALIGN.
+ */
+
+#ifndef _TSSYNC_H_
+/** @hidden */
+#define _TSSYNC_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/** alignment of the len parameter of SIMD kernels */
+#define UPIPE_TS_SYNC_SCAN_ALIGN 32
+
+ptrdiff_t upipe_ts_sync_scan_c(const uint8_t *src, ptrdiff_t len,
+                               ptrdiff_t count, ptrdiff_t stride1,
+                               ptrdiff_t stride2, ptrdiff_t stride3);
+
+ptrdiff_t upipe_ts_sync_scan_sse2(const uint8_t *src, ptrdiff_t len,
+                                  ptrdiff_t count, ptrdiff_t stride1,
+                                  ptrdiff_t stride2, ptrdiff_t stride3);
+ptrdiff_t upipe_ts_sync_scan_avx2(const uint8_t *src, ptrdiff_t len,
+                                  ptrdiff_t count, ptrdiff_t stride1,
+                                  ptrdiff_t stride2, ptrdiff_t stride3);
+
+#endif
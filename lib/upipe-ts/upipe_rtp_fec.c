@@ -21,7 +21,12 @@
 /** @file
  * @short Upipe RTP FEC module
 
-    The code does not handle one special case:
+    Main packets are stored in a ring indexed by sequence number, so the
+    packet at row r and column c of a matrix starting at snbase is found
+    directly at snbase + r * cols + c.
+
+    A FEC packet protecting two or more lost packets is kept until a FEC
+    packet of the other dimension recovers one of them:
     X - lost
     O - received
 
@@ -31,9 +36,12 @@
         OOOR
         CXC
 
-    This would require two passes of row FEC, adding significant complexity for an unlikely case.
+    The first row FEC packet cannot be used at first. Once the first column
+    FEC packet has recovered the first packet, it recovers the second one.
  */
 
+#include <config.h>
+
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uref_block.h>
@@ -42,6 +50,7 @@
 #include <upipe/uref_pic.h>
 #include <upipe/upipe.h>
 #include <upipe/ulist.h>
+#include <upipe/useqring.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref.h>
 #include <upipe/uref_dump.h>
@@ -62,14 +71,21 @@
 #include <bitstream/mpeg/ts.h>
 #include <bitstream/smpte/2022_1_fec.h>
 
+#include "fecxor.h"
+
 #define UPIPE_FEC_JITTER UCLOCK_FREQ/25
 #define FEC_MAX 255
+/* Largest matrix, so that the ring holds more than two matrices and the
+ * latency */
+#define FEC_MATRIX_MAX (USEQRING_MAX_SIZE / 4)
 #define DEFAULT_LATENCY_MAX (UCLOCK_FREQ*2)
 
 /** upipe_rtp_fec structure with rtp-fec parameters */
 struct upipe_rtp_fec {
     /** refcount management structure */
     struct urefcount urefcount;
+    /** real refcount management structure, held by the subpipes */
+    struct urefcount urefcount_real;
 
     /** uclock structure, if not NULL we are in live mode */
     struct uclock *uclock;
@@ -119,10 +135,24 @@ struct upipe_rtp_fec {
     /** row subpipe */
     struct upipe row_subpipe;
 
-    struct uchain main_queue;
+    /** main packets indexed by sequence number */
+    struct useqring main_ring;
+    /** extra space for the ring */
+    void *main_extra;
+    /** highest sequence number stored in the ring */
+    uint32_t max_seqnum;
+
     struct uchain col_queue;
     struct uchain row_queue;
 
+    /** column FEC packets protecting more than one missing packet */
+    struct uchain col_pending;
+    /** row FEC packets protecting more than one missing packet */
+    struct uchain row_pending;
+
+    /** XOR kernel */
+    void (*fec_xor)(uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+
     /* number of packets not recovered */
     uint64_t lost;
 
@@ -146,7 +176,7 @@ struct upipe_rtp_fec {
 };
 
 UPIPE_HELPER_UPIPE(upipe_rtp_fec, upipe, UPIPE_RTP_FEC_SIGNATURE);
-UPIPE_HELPER_UREFCOUNT(upipe_rtp_fec, urefcount, upipe_rtp_fec_free);
+UPIPE_HELPER_UREFCOUNT(upipe_rtp_fec, urefcount, upipe_rtp_fec_no_ref);
 
 UPIPE_HELPER_OUTPUT(upipe_rtp_fec, output, flow_def, output_state, request_list)
 
@@ -158,6 +188,10 @@ UPIPE_HELPER_UPUMP_MGR(upipe_rtp_fec, upump_mgr);
 UPIPE_HELPER_UPUMP(upipe_rtp_fec, upump, upump_mgr);
 
 UBASE_FROM_TO(upipe_rtp_fec, upipe_mgr, sub_mgr, sub_mgr)
+UBASE_FROM_TO(upipe_rtp_fec, urefcount, urefcount_real, urefcount_real)
+
+/** @hidden */
+static void upipe_rtp_fec_free(struct urefcount *urefcount_real);
 UBASE_FROM_TO(upipe_rtp_fec, upipe, main_subpipe, main_subpipe)
 UBASE_FROM_TO(upipe_rtp_fec, upipe, col_subpipe, col_subpipe)
 UBASE_FROM_TO(upipe_rtp_fec, upipe, row_subpipe, row_subpipe)
@@ -202,22 +236,7 @@ static void upipe_rtp_fec_extract_parameters(struct uref *fec_uref,
     uref_block_peek_unmap(fec_uref, RTP_HEADER_SIZE, fec_header, peek);
 }
 
-/* Delete main packets older than the reference point */
-static void clear_main_list(struct uchain *main_list, uint16_t snbase)
-{
-    struct uchain *uchain, *uchain_tmp;
-
-    ulist_delete_foreach (main_list, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        if (!seq_num_lt(uref->priv, snbase))
-            break;
-
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
-}
-
-// TODO : merge with above, cache seqnum
+// TODO : cache seqnum
 /* Delete FEC packets older than the reference point */
 static void clear_fec_list(struct uchain *fec_list, uint16_t last_fec_snbase)
 {
@@ -272,148 +291,369 @@ static void insert_ordered_uref(struct uchain *queue, struct uref *uref)
     ulist_add(queue, uref_to_uchain(uref));
 }
 
-/* apply the correction from that fec packet */
-static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
-        struct uref *fec_uref, uint16_t *seqnum_list, int items)
+/** @internal @This inserts a FEC packet in a queue of bounded depth, dropping
+ * the oldest one if needed.
+ *
+ * @param queue queue of FEC packets
+ * @param fec_uref FEC packet
+ * @param max_urefs maximum number of FEC packets in the queue
+ */
+static void upipe_rtp_fec_queue(struct uchain *queue, struct uref *fec_uref,
+                                unsigned int max_urefs)
+{
+    insert_ordered_uref(queue, fec_uref);
+    if (ulist_depth(queue) > max_urefs) {
+        struct uchain *uchain = ulist_pop(queue);
+        uref_free(uref_from_uchain(uchain));
+    }
+}
+
+/** @internal @This outputs a packet of the ring and moves the ring past it.
+ *
+ * @param upipe description structure of the pipe
+ * @param seqnum sequence number of the packet
+ */
+static void upipe_rtp_fec_output_seqnum(struct upipe *upipe, uint16_t seqnum)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct uref *uref = useqring_remove(&upipe_rtp_fec->main_ring, seqnum);
+    useqring_set_head(&upipe_rtp_fec->main_ring, seqnum + 1);
+
+    if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX) {
+        uint16_t expected = upipe_rtp_fec->last_send_seqnum + 1;
+        if (expected != seqnum) {
+            upipe_dbg_va(upipe, "FEC output LOST, expected seqnum %hu got %hu",
+                    expected, seqnum);
+            upipe_rtp_fec->lost += (uint16_t)(seqnum - expected);
+        }
+    }
 
-    bool found_seqnum[FEC_MAX] = {0};
+    upipe_rtp_fec->last_send_seqnum = seqnum;
+    upipe_rtp_fec_output(upipe, uref, NULL);
+}
 
-    /* Search to see if any packets are lost */
-    int processed = 0;
-    struct uchain *uchain;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint16_t seqnum = uref->priv;
+/** @internal @This outputs all packets of the ring.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtp_fec_flush(struct upipe *upipe)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
+    uint16_t seqnum;
 
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == seqnum) {
-                processed++;
-                found_seqnum[i] = true;
-                break;
-            }
-        }
+    while (useqring_next(ring, useqring_head(ring), &seqnum))
+        upipe_rtp_fec_output_seqnum(upipe, seqnum);
+}
 
-        if (processed == items) {
-            upipe_verbose_va(upipe, "no packets lost");
-            uref_free(fec_uref);
-            return;
-        }
+/** @internal @This stores a main packet in the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref packet, with its sequence number in priv
+ * @return false if the packet was dropped
+ */
+static bool upipe_rtp_fec_insert(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
+    uint16_t seqnum = uref->priv;
+
+    if (upipe_rtp_fec->max_seqnum == UINT32_MAX) {
+        useqring_set_head(ring, seqnum);
+    } else if (upipe_rtp_fec->last_send_seqnum == UINT32_MAX &&
+               seq_num_lt(seqnum, useqring_head(ring))) {
+        /* nothing was output yet, extend the ring backwards */
+        useqring_set_head(ring, seqnum);
     }
 
-    if (processed != items - 1) {
-        upipe_dbg_va(upipe, "Too much packet loss: found only %d out of %d",
-                processed, items);
-        uref_free(fec_uref);
-        return;
+    switch (useqring_insert(ring, seqnum, uref)) {
+        case USEQRING_INSERTED:
+            break;
+        case USEQRING_AHEAD:
+            /* the ring cannot span this far, output what it holds */
+            upipe_warn_va(upipe, "jump to seqnum %hu, flushing", seqnum);
+            upipe_rtp_fec_flush(upipe);
+            useqring_set_head(ring, seqnum);
+            useqring_insert(ring, seqnum, uref);
+            upipe_rtp_fec->max_seqnum = seqnum;
+            return true;
+        default:
+            /* Duplicate packet, or packet from the past */
+            uref_free(uref);
+            return false;
+    }
+
+    /* Remove date_sys for any late packets */
+    if (upipe_rtp_fec->max_seqnum != UINT32_MAX &&
+        seq_num_lt(seqnum, upipe_rtp_fec->max_seqnum))
+        uref_clock_delete_date_sys(uref);
+    else
+        upipe_rtp_fec->max_seqnum = seqnum;
+    return true;
+}
+
+/** @internal @This XORs a buffer into another.
+ *
+ * @param upipe_rtp_fec private structure of the pipe
+ * @param dst destination buffer
+ * @param src source buffer
+ * @param len number of octets
+ */
+static inline void upipe_rtp_fec_xor(struct upipe_rtp_fec *upipe_rtp_fec,
+                                     uint8_t *dst, const uint8_t *src,
+                                     int len)
+{
+    int simd = len & ~(UPIPE_RTP_FEC_XOR_ALIGN - 1);
+    if (simd)
+        upipe_rtp_fec->fec_xor(dst, src, simd);
+    upipe_rtp_fec_xor_c(dst + simd, src + simd, len - simd);
+}
+
+/** @internal @This XORs the payload of a packet into a buffer.
+ *
+ * @param upipe_rtp_fec private structure of the pipe
+ * @param dst destination buffer
+ * @param uref packet
+ * @param len number of octets of payload
+ */
+static void upipe_rtp_fec_xor_uref(struct upipe_rtp_fec *upipe_rtp_fec,
+                                   uint8_t *dst, struct uref *uref, int len)
+{
+    int offset = RTP_HEADER_SIZE;
+
+    while (len > 0) {
+        int size = len;
+        const uint8_t *src;
+        if (unlikely(!ubase_check(uref_block_read(uref, offset, &size,
+                                                  &src)) || !size))
+            break;
+
+        upipe_rtp_fec_xor(upipe_rtp_fec, dst, src, size);
+        uref_block_unmap(uref, offset);
+        dst += size;
+        offset += size;
+        len -= size;
+    }
+}
+
+/** @internal @This counts the missing packets protected by a FEC packet.
+ *
+ * @param upipe_rtp_fec private structure of the pipe
+ * @param snbase first protected sequence number
+ * @param step distance between protected sequence numbers
+ * @param items number of protected packets
+ * @param missing_p filled in with the sequence number of a missing packet
+ * @return number of missing packets, or 0 if protected packets were already
+ * output
+ */
+static int upipe_rtp_fec_missing(struct upipe_rtp_fec *upipe_rtp_fec,
+                                 uint16_t snbase, uint16_t step, int items,
+                                 uint16_t *missing_p)
+{
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
+    if (seq_num_lt(snbase, useqring_head(ring)))
+        return 0;
+
+    int missing = 0;
+    for (int i = 0; i < items; i++) {
+        uint16_t seqnum = snbase + i * step;
+        if (useqring_peek(ring, seqnum) == NULL) {
+            *missing_p = seqnum;
+            missing++;
+        }
     }
+    return missing;
+}
+
+/** @internal @This recovers the only missing packet protected by a FEC
+ * packet, and stores it in the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param fec_uref FEC packet, turned into the recovered packet
+ * @param snbase first protected sequence number
+ * @param step distance between protected sequence numbers
+ * @param items number of protected packets
+ * @param missing sequence number of the missing packet
+ * @return false if the packet could not be recovered
+ */
+static bool upipe_rtp_fec_recover(struct upipe *upipe, struct uref *fec_uref,
+                                  uint16_t snbase, uint16_t step, int items,
+                                  uint16_t missing)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
 
     /* Extract parameters from FEC packet */
     uint16_t length_rec;
     uint32_t ts_rec;
     upipe_rtp_fec_extract_parameters(fec_uref, &ts_rec, &length_rec);
 
-    /* Recoverable packet */
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
+    /* Keep room for the RTP header in front of the FEC payload */
+    uref_block_resize(fec_uref, SMPTE_2022_FEC_HEADER_SIZE, -1);
+    size_t fec_size = 0;
+    uref_block_size(fec_uref, &fec_size);
+    uint8_t *dst;
+    int size = -1;
+    if (unlikely(!ubase_check(uref_block_write(fec_uref, 0, &size, &dst)))) {
+        upipe_warn(upipe, "unable to write FEC packet");
+        uref_free(fec_uref);
+        return false;
+    }
+    if (unlikely(size != (int)fec_size)) {
+        upipe_warn(upipe, "fragmented FEC packet");
+        uref_block_unmap(fec_uref, 0);
+        uref_free(fec_uref);
+        return false;
+    }
+    int payload_size = size - RTP_HEADER_SIZE;
 
-        // TODO: only if in list?
+    bool copy_header = true;
+    for (int i = 0; i < items; i++) {
+        uint16_t seqnum = snbase + i * step;
+        if (seqnum == missing)
+            continue;
 
+        struct uref *uref = useqring_peek(ring, seqnum);
         uint8_t rtp_buffer[RTP_HEADER_SIZE];
         const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
                 rtp_buffer);
         if (unlikely(rtp_header == NULL)) {
             upipe_warn(upipe, "invalid buffer");
-            continue;
+            uref_block_unmap(fec_uref, 0);
+            uref_free(fec_uref);
+            return false;
         }
 
-        uint32_t timestamp = rtp_get_timestamp(rtp_header);
+        if (copy_header) {
+            memcpy(dst, rtp_header, RTP_HEADER_SIZE);
+            copy_header = false;
+        }
+        ts_rec ^= rtp_get_timestamp(rtp_header);
         uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
-        /* Recover length and timestamp of missing packet */
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t uref_len = 0;
-                uref_block_size(uref, &uref_len);
-                uref_len -= RTP_HEADER_SIZE;
+        /* Recover length of missing packet */
+        size_t uref_size = 0;
+        uref_block_size(uref, &uref_size);
+        int len = uref_size - RTP_HEADER_SIZE;
+        length_rec ^= len;
 
-                length_rec ^= uref_len;
-                ts_rec ^= timestamp;
-            }
-        }
+        if (len > payload_size)
+            len = payload_size;
+        upipe_rtp_fec_xor_uref(upipe_rtp_fec, dst + RTP_HEADER_SIZE, uref, len);
     }
 
     if (length_rec != 7 * TS_SIZE)
-        upipe_warn_va(upipe_rtp_fec_to_upipe(upipe_rtp_fec),
-                "DUBIOUS REC LEN %i timestamp %u", length_rec, ts_rec);
+        upipe_warn_va(upipe, "DUBIOUS REC LEN %i timestamp %u", length_rec,
+                ts_rec);
+    if (length_rec > payload_size)
+        length_rec = payload_size;
 
-    uref_block_resize(fec_uref, SMPTE_2022_FEC_HEADER_SIZE, -1);
-    uint8_t *dst;
-    int size = length_rec + RTP_HEADER_SIZE;
-    uref_block_write(fec_uref, 0, &size, &dst);
+    rtp_set_seqnum(dst, missing);
+    rtp_set_timestamp(dst, ts_rec);
+    uref_block_unmap(fec_uref, 0);
+    uref_block_resize(fec_uref, 0, length_rec + RTP_HEADER_SIZE);
 
-    bool copy_header = true;
+    upipe_dbg_va(upipe, "Corrected packet. Sequence number: %u", missing);
+    upipe_rtp_fec->recovered++;
+    fec_uref->priv = missing;
+    return upipe_rtp_fec_insert(upipe, fec_uref);
+}
 
-    processed = 0;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t size = 0;
-                uref_block_size(uref, &size);
-                uint8_t payload_buf[TS_SIZE * 7 + RTP_HEADER_SIZE];
-
-                if(size < sizeof(payload_buf))
-                    continue;
-
-                // TODO: uref_block_read in a loop
-                const uint8_t *peek = uref_block_peek(uref, 0, size,
-                        payload_buf);
-                if (copy_header) {
-                    memcpy(dst, peek, RTP_HEADER_SIZE);
-                    copy_header = false;
-                }
-                for (int i = 0; i < size - RTP_HEADER_SIZE; i++)
-                    dst[RTP_HEADER_SIZE + i] ^= peek[RTP_HEADER_SIZE + i];
-                uref_block_peek_unmap(uref, RTP_HEADER_SIZE, payload_buf, peek);
-                processed++;
-                break;
-            }
-        }
+static void upipe_rtp_fec_retry(struct upipe *upipe, uint16_t seqnum);
 
-        if (processed == items-1)
-            break;
+/** @internal @This applies a FEC packet. If it protects more than one
+ * missing packet, it is kept in the pending list of its dimension.
+ *
+ * @param upipe description structure of the pipe
+ * @param fec_uref FEC packet
+ * @param row true for a row FEC packet, false for a column FEC packet
+ */
+static void upipe_rtp_fec_apply(struct upipe *upipe, struct uref *fec_uref,
+                                bool row)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    uint16_t snbase = fec_uref->priv >> 32;
+    uint16_t step = row ? 1 : upipe_rtp_fec->cols;
+    int items = row ? upipe_rtp_fec->cols : upipe_rtp_fec->rows;
+
+    uint16_t missing = 0;
+    int lost = upipe_rtp_fec_missing(upipe_rtp_fec, snbase, step, items,
+                                     &missing);
+    if (!lost) {
+        upipe_verbose_va(upipe, "no packets lost");
+        uref_free(fec_uref);
+        return;
     }
 
-    /* Maybe possible to merge with above */
-    uint16_t missing_seqnum = 0;
-    for (int i = 0; i < items; i++)
-        if (!found_seqnum[i]) {
-            missing_seqnum = seqnum_list[i];
-            break;
-        }
+    if (lost > 1) {
+        upipe_dbg_va(upipe, "Too much packet loss: found only %d out of %d",
+                items - lost, items);
+        if (row)
+            upipe_rtp_fec_queue(&upipe_rtp_fec->row_pending, fec_uref,
+                                2 * upipe_rtp_fec->rows);
+        else
+            upipe_rtp_fec_queue(&upipe_rtp_fec->col_pending, fec_uref,
+                                2 * upipe_rtp_fec->cols);
+        return;
+    }
 
-    upipe_dbg_va(&upipe_rtp_fec->upipe, "Corrected packet. Sequence number: %u", missing_seqnum);
-    upipe_rtp_fec->recovered++;
-    fec_uref->priv = missing_seqnum;
-    rtp_set_seqnum(dst, missing_seqnum);
-    rtp_set_timestamp(dst, ts_rec);
-    uref_block_unmap(fec_uref, 0);
-    uref_block_resize(fec_uref, 0, size);
+    if (upipe_rtp_fec_recover(upipe, fec_uref, snbase, step, items, missing))
+        upipe_rtp_fec_retry(upipe, missing);
+}
 
-    /* Don't insert an FEC corrected packet from the past */
-    if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX &&
-       (seq_num_lt(missing_seqnum, upipe_rtp_fec->last_send_seqnum) || upipe_rtp_fec->last_send_seqnum == missing_seqnum))
-        uref_free(fec_uref);
-    else
-        insert_ordered_uref(&upipe_rtp_fec->main_queue, fec_uref);
+/** @internal @This finds a pending FEC packet protecting a sequence number,
+ * and removes it from the pending list.
+ *
+ * @param list pending list
+ * @param seqnum sequence number
+ * @param step distance between protected sequence numbers
+ * @param items number of protected packets
+ * @return pointer to the FEC packet, or NULL
+ */
+static struct uref *upipe_rtp_fec_find_pending(struct uchain *list,
+                                               uint16_t seqnum, uint16_t step,
+                                               int items)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (list, uchain, uchain_tmp) {
+        struct uref *fec_uref = uref_from_uchain(uchain);
+        uint16_t snbase = fec_uref->priv >> 32;
+        uint16_t delta = seqnum - snbase;
+
+        if (delta % step || delta / step >= items)
+            continue;
+
+        ulist_delete(uchain);
+        return fec_uref;
+    }
+    return NULL;
+}
+
+/** @internal @This applies the pending FEC packets protecting a packet that
+ * was just stored, in case they now protect a single missing packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param seqnum sequence number of the stored packet
+ */
+static void upipe_rtp_fec_retry(struct upipe *upipe, uint16_t seqnum)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+
+    struct uref *fec_uref = upipe_rtp_fec_find_pending(
+            &upipe_rtp_fec->row_pending, seqnum, 1, upipe_rtp_fec->cols);
+    if (fec_uref)
+        upipe_rtp_fec_apply(upipe, fec_uref, true);
+
+    /* The row correction may have consumed the column FEC packet */
+    fec_uref = upipe_rtp_fec_find_pending(&upipe_rtp_fec->col_pending,
+            seqnum, upipe_rtp_fec->cols, upipe_rtp_fec->rows);
+    if (fec_uref)
+        upipe_rtp_fec_apply(upipe, fec_uref, false);
 }
 
 static void upipe_rtp_fec_apply_col_fec(struct upipe *upipe)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
-    uint16_t seqnum_list[FEC_MAX];
 
     for (;;) {
         struct uchain *fec_uchain = ulist_peek(&upipe_rtp_fec->col_queue);
@@ -437,13 +677,7 @@ static void upipe_rtp_fec_apply_col_fec(struct upipe *upipe)
             upipe_rtp_fec->cur_matrix_snbase = snbase_low;
         }
 
-        /* Build a list of the expected sequence numbers in matrix column */
-        seqnum_list[0] = snbase_low;
-        for (int i = 1; i < upipe_rtp_fec->rows; i++)
-            seqnum_list[i] = seqnum_list[i-1] + upipe_rtp_fec->cols;
-
-        upipe_rtp_fec_correct_packets(upipe, fec_uref, seqnum_list,
-                upipe_rtp_fec->rows);
+        upipe_rtp_fec_apply(upipe, fec_uref, false);
     }
 }
 
@@ -452,8 +686,6 @@ static void upipe_rtp_fec_apply_row_fec(struct upipe *upipe,
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
 
-    uint16_t seqnum_list[FEC_MAX];
-
     /* get rid of old row FEC packets */
     clear_fec_list(&upipe_rtp_fec->row_queue, cur_row_fec_snbase);
 
@@ -463,16 +695,9 @@ static void upipe_rtp_fec_apply_row_fec(struct upipe *upipe,
         return;
 
     struct uref *fec_uref = uref_from_uchain(fec_uchain);
-    uint16_t snbase_low = fec_uref->priv >> 32;
-
-    upipe_rtp_fec->cur_row_fec_snbase = snbase_low;
-
-    /* Build a list of the expected sequence numbers */
-    for (int i = 0; i < upipe_rtp_fec->cols; i++)
-        seqnum_list[i] = snbase_low++;
+    upipe_rtp_fec->cur_row_fec_snbase = fec_uref->priv >> 32;
 
-    upipe_rtp_fec_correct_packets(upipe, fec_uref, seqnum_list,
-            upipe_rtp_fec->cols);
+    upipe_rtp_fec_apply(upipe, fec_uref, true);
 }
 
 static void upipe_rtp_fec_clear_queue(struct uchain *queue)
@@ -487,9 +712,11 @@ static void upipe_rtp_fec_clear_queue(struct uchain *queue)
 
 static void upipe_rtp_fec_clear(struct upipe_rtp_fec *upipe_rtp_fec)
 {
-    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->main_queue);
+    useqring_flush(&upipe_rtp_fec->main_ring);
     upipe_rtp_fec_clear_queue(&upipe_rtp_fec->col_queue);
     upipe_rtp_fec_clear_queue(&upipe_rtp_fec->row_queue);
+    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->col_pending);
+    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->row_pending);
 }
 
 // TODO: wait_upump?
@@ -497,15 +724,15 @@ static void upipe_rtp_fec_timer(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
     uint64_t now = uclock_now(upipe_rtp_fec->uclock);
+    uint16_t seqnum;
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (&upipe_rtp_fec->main_queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
+    while (useqring_next(ring, useqring_head(ring), &seqnum)) {
+        struct uref *uref = useqring_peek(ring, seqnum);
         uint64_t date_sys = UINT64_MAX;
         int type;
         uref_clock_get_date_sys(uref, &date_sys, &type);
-        uint64_t seqnum = uref->priv & UINT32_MAX;
 
         if (date_sys != UINT64_MAX) {
             // TODO: replace by output latency
@@ -517,22 +744,12 @@ static void upipe_rtp_fec_timer(struct upump *upump)
             uref_clock_set_date_sys(uref, date_sys, type);
         }
 
-        ulist_delete(uchain);
-        upipe_rtp_fec_output(upipe, uref, NULL);
-
-        if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX) {
-            uint16_t expected = upipe_rtp_fec->last_send_seqnum + 1;
-            if (expected != seqnum) {
-                upipe_dbg_va(upipe, "FEC output LOST, expected seqnum %hu got %" PRIu64,
-                        expected, seqnum);
-                upipe_rtp_fec->lost +=
-                    (seqnum + UINT16_MAX + 1 - expected) & UINT16_MAX;
-
-            }
-        }
-
-        upipe_rtp_fec->last_send_seqnum = seqnum;
+        upipe_rtp_fec_output_seqnum(upipe, seqnum);
     }
+
+    /* Pending FEC packets are useless once a protected packet is output */
+    clear_fec_list(&upipe_rtp_fec->col_pending, useqring_head(ring));
+    clear_fec_list(&upipe_rtp_fec->row_pending, useqring_head(ring));
 }
 
 /** @internal @This builds the flow definition packet.
@@ -564,6 +781,7 @@ static void clear_fec(struct upipe *upipe)
 
     upipe_rtp_fec->first_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_seqnum = UINT32_MAX;
+    upipe_rtp_fec->max_seqnum = UINT32_MAX;
     upipe_rtp_fec->latency = 0;
 
     memset(upipe_rtp_fec->recent, 0xff, 2 * upipe_rtp_fec->rows *
@@ -573,16 +791,18 @@ static void clear_fec(struct upipe *upipe)
 static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_sub_mgr(upipe->mgr);
+    struct useqring *ring = &upipe_rtp_fec->main_ring;
 
     /* Clear any old non-FEC packets */
-    clear_main_list(&upipe_rtp_fec->main_queue, upipe_rtp_fec->cur_matrix_snbase);
+    if (seq_num_lt(useqring_head(ring), upipe_rtp_fec->cur_matrix_snbase))
+        useqring_set_head(ring, upipe_rtp_fec->cur_matrix_snbase);
 
-    struct uchain *first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-    if (!first_uchain)
+    uint16_t first_seqnum;
+    if (!useqring_next(ring, useqring_head(ring), &first_seqnum))
         return;
 
-    struct uref *first_uref = uref_from_uchain(first_uchain);
-    upipe_rtp_fec->first_seqnum = first_uref->priv;
+    struct uref *first_uref = useqring_peek(ring, first_seqnum);
+    upipe_rtp_fec->first_seqnum = first_seqnum;
 
     /* Make sure we have at least two matrices of data as per the spec */
     uint16_t seq_delta = seqnum - upipe_rtp_fec->first_seqnum - 1;
@@ -598,13 +818,9 @@ static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
 
     if (date_sys == UINT64_MAX) {
         /* First packet having an unusable date_sys is not useful */
-        ulist_delete(first_uchain);
-        uref_free(first_uref);
-        first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-        if (first_uchain) {
-            struct uref *uref = uref_from_uchain(first_uchain);
-            upipe_rtp_fec->first_seqnum = uref->priv;
-        }
+        useqring_set_head(ring, first_seqnum + 1);
+        if (useqring_next(ring, useqring_head(ring), &first_seqnum))
+            upipe_rtp_fec->first_seqnum = first_seqnum;
         return;
     }
 
@@ -694,17 +910,21 @@ static void upipe_rtp_fec_main_input(struct upipe *upipe, struct uref *uref)
         uint64_t date_sys = 0;
         uref_clock_get_date_sys(uref, &date_sys, &type);
 
-        insert_ordered_uref(&upipe_rtp_fec->main_queue, uref);
+        /* A late packet may complete a pending FEC packet */
+        bool late = upipe_rtp_fec->max_seqnum != UINT32_MAX &&
+                    seq_num_lt(seqnum, upipe_rtp_fec->max_seqnum);
+        if (upipe_rtp_fec_insert(super_pipe, uref) && late)
+            upipe_rtp_fec_retry(super_pipe, seqnum);
 
         /* Owing to clock drift the latency of 2x the FEC matrix may increase
          * Build a continually updating duration and correct the latency if necessary.
          * Also helps with undershoot of latency calculation from initial packets */
-        uint8_t idx = seqnum % two_matrix_size;
+        unsigned int idx = seqnum % two_matrix_size;
         uint64_t prev_date_sys = upipe_rtp_fec->recent[idx].date_sys;
         uint64_t prev_seqnum = upipe_rtp_fec->recent[idx].seqnum;
         uint16_t expected_seqnum = prev_seqnum + two_matrix_size;
         uint16_t later_seqnum = seqnum + two_matrix_size;
-        uint8_t new_idx = later_seqnum % two_matrix_size;
+        unsigned int new_idx = later_seqnum % two_matrix_size;
 
         /* Make sure the sequence number is exactly two matrices behind and not more,
          * otherwise the latency calculation will be too large.
@@ -782,6 +1002,12 @@ static void upipe_rtp_fec_colrow_input(struct upipe *upipe, struct uref *uref)
             goto invalid;
         }
 
+        if (offset * na > FEC_MATRIX_MAX) {
+            upipe_warn_va(upipe, "Unsupported %ux%u FEC matrix, ignoring",
+                    na, offset);
+            goto invalid;
+        }
+
         if (upipe_rtp_fec->cols != offset ||
             upipe_rtp_fec->rows != na) {
             upipe_rtp_fec->cols = offset;
@@ -799,13 +1025,8 @@ static void upipe_rtp_fec_colrow_input(struct upipe *upipe, struct uref *uref)
         }
     }
 
-    insert_ordered_uref(queue, uref);
-    int max_urefs = 2 * (col ? upipe_rtp_fec->cols : upipe_rtp_fec->rows);
-    if (ulist_depth(queue) >  max_urefs) {
-        struct uchain *uchain = ulist_pop(queue);
-        struct uref *uref = uref_from_uchain(uchain);
-        uref_free(uref);
-    }
+    upipe_rtp_fec_queue(queue, uref,
+            2 * (col ? upipe_rtp_fec->cols : upipe_rtp_fec->rows));
     upipe_rtp_fec->pkts_since_last_fec = 0;
     return;
 
@@ -920,7 +1141,7 @@ static void upipe_rtp_fec_init_sub_mgr(struct upipe *upipe)
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
     struct upipe_mgr *sub_mgr = &upipe_rtp_fec->sub_mgr;
 
-    sub_mgr->refcount = upipe_rtp_fec_to_urefcount(upipe_rtp_fec);
+    sub_mgr->refcount = upipe_rtp_fec_to_urefcount_real(upipe_rtp_fec);
     sub_mgr->signature = UPIPE_RTP_FEC_INPUT_SIGNATURE;
     sub_mgr->upipe_alloc = NULL;
     sub_mgr->upipe_input = upipe_rtp_fec_sub_input;
@@ -948,13 +1169,29 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
 
     struct upipe_rtp_fec *upipe_rtp_fec =
         (struct upipe_rtp_fec *)calloc(1, sizeof(struct upipe_rtp_fec));
-    if (unlikely(upipe_rtp_fec == NULL)) {
+    void *main_extra = malloc(useqring_sizeof(USEQRING_MAX_SIZE));
+    if (unlikely(upipe_rtp_fec == NULL || main_extra == NULL)) {
+        free(upipe_rtp_fec);
+        free(main_extra);
         uprobe_release(uprobe_main);
         uprobe_release(uprobe_col);
         uprobe_release(uprobe_row);
         return NULL;
     }
 
+    upipe_rtp_fec->main_extra = main_extra;
+    useqring_init(&upipe_rtp_fec->main_ring, USEQRING_MAX_SIZE, main_extra);
+    upipe_rtp_fec->max_seqnum = UINT32_MAX;
+    upipe_rtp_fec->fec_xor = upipe_rtp_fec_xor_c;
+#ifdef HAVE_X86ASM
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse2"))
+        upipe_rtp_fec->fec_xor = upipe_rtp_fec_xor_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        upipe_rtp_fec->fec_xor = upipe_rtp_fec_xor_avx2;
+#endif
+#endif
+
     upipe_rtp_fec->first_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_send_seqnum = UINT32_MAX;
@@ -975,6 +1212,8 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
     upipe_rtp_fec_init_upump(upipe);
     upipe_rtp_fec_init_uclock(upipe);
     upipe_rtp_fec_init_urefcount(upipe);
+    urefcount_init(upipe_rtp_fec_to_urefcount_real(upipe_rtp_fec),
+                   upipe_rtp_fec_free);
     upipe_rtp_fec_init_sub_mgr(upipe);
     upipe_rtp_fec_init_output(upipe);
 
@@ -986,9 +1225,10 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
     upipe_rtp_fec_sub_init(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec),
                             &upipe_rtp_fec->sub_mgr, uprobe_row);
 
-    ulist_init(&upipe_rtp_fec->main_queue);
     ulist_init(&upipe_rtp_fec->col_queue);
     ulist_init(&upipe_rtp_fec->row_queue);
+    ulist_init(&upipe_rtp_fec->col_pending);
+    ulist_init(&upipe_rtp_fec->row_pending);
 
     upipe_rtp_fec_check_upump_mgr(upipe);
 
@@ -1088,22 +1328,39 @@ static int upipe_rtp_fec_control(struct upipe *upipe, int command, va_list args)
     }
 }
 
-/** @This frees a upipe.
+/** @This is called when there is no external reference to the pipe anymore.
+ * The subpipes release their references to the manager.
  *
  * @param upipe description structure of the pipe
  */
-static void upipe_rtp_fec_free(struct upipe *upipe)
+static void upipe_rtp_fec_no_ref(struct upipe *upipe)
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
 
-    upipe_throw_dead(upipe);
-
-    upipe_rtp_fec_clear(upipe_rtp_fec);
-
     upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_main_subpipe(upipe_rtp_fec));
     upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_col_subpipe(upipe_rtp_fec));
     upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec));
 
+    urefcount_release(upipe_rtp_fec_to_urefcount_real(upipe_rtp_fec));
+}
+
+/** @This frees a upipe.
+ *
+ * @param urefcount_real pointer to the real urefcount structure
+ */
+static void upipe_rtp_fec_free(struct urefcount *urefcount_real)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec =
+        upipe_rtp_fec_from_urefcount_real(urefcount_real);
+    struct upipe *upipe = upipe_rtp_fec_to_upipe(upipe_rtp_fec);
+
+    upipe_throw_dead(upipe);
+
+    upipe_rtp_fec_clear(upipe_rtp_fec);
+    useqring_clean(&upipe_rtp_fec->main_ring);
+    free(upipe_rtp_fec->main_extra);
+
+    urefcount_clean(urefcount_real);
     upipe_rtp_fec_clean_uclock(upipe);
     upipe_rtp_fec_clean_upump(upipe);
     upipe_rtp_fec_clean_upump_mgr(upipe);
@@ -20,6 +20,11 @@
 
 /** @file
  * @short Upipe module decapsulating (removing TS header) TS packets
+ *
+ * Input urefs may carry several consecutive TS packets of the same PID. The
+ * payloads of continuation packets are then gathered in a single output uref,
+ * which starts at each packet with the unit start indicator, a discontinuity,
+ * a random access point, a transport error or a PCR.
  */
 
 #include <upipe/ubase.h>
@@ -48,6 +53,8 @@
 
 /** we only accept TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
+/** possibly aligned in multi-packet blocks */
+#define EXPECTED_FLOW_DEF_ALIGNED "block.mpegtsaligned."
 
 /** @internal @This is the private context of a ts_decaps pipe. */
 struct upipe_ts_decaps {
@@ -65,8 +72,8 @@ struct upipe_ts_decaps {
 
     /** last continuity counter for this PID, or -1 */
     int8_t last_cc;
-    /** last TS packet */
-    struct uref *last_uref;
+    /** payload of the last TS packet */
+    struct ubuf *last_ubuf;
 
     /** lost packets based on cc errors */
     uint64_t lost;
@@ -102,12 +109,81 @@ static struct upipe *upipe_ts_decaps_alloc(struct upipe_mgr *mgr,
     upipe_ts_decaps_init_output(upipe);
     upipe_ts_decaps->last_cc = -1;
     upipe_ts_decaps->lost = 0;
-    upipe_ts_decaps->last_uref = NULL;
+    upipe_ts_decaps->last_ubuf = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
-/** @internal @This parses and removes the TS header of a packet.
+/** @internal @This is the payload being gathered from consecutive TS
+ * packets. */
+struct upipe_ts_decaps_chunk {
+    /** uref carrying the attributes, or NULL to use the input uref */
+    struct uref *uref;
+    /** payloads */
+    struct ubuf *ubuf;
+    /** true if the chunk starts after a discontinuity */
+    bool discontinuity;
+    /** true if the chunk starts on a random access point */
+    bool random;
+    /** true if the chunk starts with a unit start indicator */
+    bool start;
+    /** true if the first packet was flagged with a transport error */
+    bool error;
+};
+
+/** @internal @This outputs a chunk of payloads.
+ *
+ * @param upipe description structure of the pipe
+ * @param chunk chunk of payloads, reset on return
+ * @param uref input uref
+ * @param last true if this is the last chunk of the input uref, which is then
+ * used for the output
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_decaps_flush(struct upipe *upipe,
+                                  struct upipe_ts_decaps_chunk *chunk,
+                                  struct uref *uref, bool last,
+                                  struct upump **upump_p)
+{
+    struct uref *output = chunk->uref;
+    struct ubuf *ubuf = chunk->ubuf;
+    chunk->uref = NULL;
+    chunk->ubuf = NULL;
+
+    if (ubuf == NULL) {
+        if (output != NULL)
+            uref_free(output);
+        if (last)
+            uref_free(uref);
+        return;
+    }
+
+    if (output == NULL) {
+        if (last) {
+            output = uref;
+            uref = NULL;
+        } else if (unlikely((output = uref_dup_inner(uref)) == NULL)) {
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+    } else if (last)
+        uref_free(uref);
+    uref_attach_ubuf(output, ubuf);
+
+    if (unlikely(chunk->discontinuity))
+        uref_flow_set_discontinuity(output);
+    if (unlikely(chunk->random))
+        uref_flow_set_random(output);
+    if (unlikely(chunk->start))
+        uref_block_set_start(output);
+    if (unlikely(chunk->error))
+        uref_flow_set_error(output);
+    upipe_ts_decaps_output(upipe, output, upump_p);
+}
+
+/** @internal @This parses and removes the TS headers of one or several
+ * packets.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
@@ -117,121 +193,190 @@ static void upipe_ts_decaps_input(struct upipe *upipe, struct uref *uref,
                                   struct upump **upump_p)
 {
     struct upipe_ts_decaps *upipe_ts_decaps = upipe_ts_decaps_from_upipe(upipe);
-    uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
-                                               buffer);
-    if (unlikely(ts_header == NULL)) {
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
         uref_free(uref);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return;
     }
-    bool transporterror = ts_get_transporterror(ts_header);
-    bool unitstart = ts_get_unitstart(ts_header);
-    uint8_t cc = ts_get_cc(ts_header);
-    bool has_payload = ts_has_payload(ts_header);
-    bool has_adaptation = ts_has_adaptation(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
-    UBASE_FATAL(upipe, uref_block_resize(uref, TS_HEADER_SIZE, -1))
-
-    bool discontinuity = upipe_ts_decaps->last_cc == -1;
-    bool random = false;
-    if (unlikely(has_adaptation)) {
-        uint8_t af_length;
-        if (unlikely(!ubase_check(uref_block_extract(uref, 0, 1, &af_length)))) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
-        }
 
-        if (unlikely((!has_payload && af_length != 183) || af_length > 183)) {
-            upipe_warn(upipe, "invalid adaptation field received");
-            uref_free(uref);
-            return;
-        }
-
-        if (af_length) {
-            uint8_t af_header;
-            if (unlikely(!ubase_check(uref_block_extract(uref, 1, 1, &af_header)))) {
-                uref_free(uref);
-                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-                return;
+    struct upipe_ts_decaps_chunk chunk;
+    chunk.uref = NULL;
+    chunk.ubuf = NULL;
+    /* offset and size of the last payload in this uref, if any */
+    int last_offset = -1, last_size = 0;
+    size_t offset = 0;
+
+    do {
+        size_t end = offset + TS_SIZE;
+        if (end + TS_HEADER_SIZE > size)
+            end = size;
+
+        uint8_t buffer[TS_HEADER_SIZE];
+        const uint8_t *ts_header = uref_block_peek(uref, offset,
+                                                   TS_HEADER_SIZE, buffer);
+        if (unlikely(ts_header == NULL))
+            goto upipe_ts_decaps_input_err;
+        bool transporterror = ts_get_transporterror(ts_header);
+        bool unitstart = ts_get_unitstart(ts_header);
+        uint8_t cc = ts_get_cc(ts_header);
+        bool has_payload = ts_has_payload(ts_header);
+        bool has_adaptation = ts_has_adaptation(ts_header);
+        UBASE_FATAL(upipe, uref_block_peek_unmap(uref, offset, buffer,
+                                                 ts_header))
+        size_t payload = offset + TS_HEADER_SIZE;
+
+        bool discontinuity = upipe_ts_decaps->last_cc == -1;
+        bool random = false;
+        struct uref *ref = NULL;
+        if (unlikely(has_adaptation)) {
+            uint8_t af_length;
+            if (unlikely(!ubase_check(uref_block_extract(uref, payload, 1,
+                                                         &af_length))))
+                goto upipe_ts_decaps_input_err;
+
+            if (unlikely((!has_payload && af_length != 183) ||
+                         af_length > 183)) {
+                upipe_warn(upipe, "invalid adaptation field received");
+                offset = end;
+                continue;
             }
 
-            if (unlikely(!discontinuity &&
-                     tsaf_has_discontinuity(&af_header - 1 - TS_HEADER_SIZE))) {
-                upipe_warn(upipe, "discontinuity flagged");
-                discontinuity = true;
-            }
+            if (af_length) {
+                uint8_t af_header;
+                if (unlikely(!ubase_check(uref_block_extract(uref,
+                                    payload + 1, 1, &af_header))))
+                    goto upipe_ts_decaps_input_err;
 
-            random = tsaf_has_randomaccess(&af_header - 1 - TS_HEADER_SIZE);
+                if (unlikely(!discontinuity &&
+                     tsaf_has_discontinuity(&af_header - 1 - TS_HEADER_SIZE))) {
+                    upipe_warn(upipe, "discontinuity flagged");
+                    discontinuity = true;
+                }
 
-            if (tsaf_has_pcr(&af_header - 1 - TS_HEADER_SIZE)) {
-                uint8_t buffer2[TS_HEADER_SIZE_PCR - TS_HEADER_SIZE_AF];
-                const uint8_t *pcr = uref_block_peek(uref, 2,
-                        TS_HEADER_SIZE_PCR - TS_HEADER_SIZE_AF, buffer2);
-                if (unlikely(pcr == NULL)) {
-                    uref_free(uref);
-                    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-                    return;
+                random = tsaf_has_randomaccess(&af_header - 1 - TS_HEADER_SIZE);
+
+                if (tsaf_has_pcr(&af_header - 1 - TS_HEADER_SIZE)) {
+                    uint8_t buffer2[TS_HEADER_SIZE_PCR - TS_HEADER_SIZE_AF];
+                    const uint8_t *pcr = uref_block_peek(uref, payload + 2,
+                            TS_HEADER_SIZE_PCR - TS_HEADER_SIZE_AF, buffer2);
+                    if (unlikely(pcr == NULL))
+                        goto upipe_ts_decaps_input_err;
+                    uint64_t pcrval =
+                        (tsaf_get_pcr(pcr - TS_HEADER_SIZE_AF) * 300 +
+                         tsaf_get_pcrext(pcr - TS_HEADER_SIZE_AF));
+                    pcrval *= UCLOCK_FREQ / 27000000;
+                    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, payload + 2,
+                                                             buffer2, pcr))
+
+                    /* the packet carrying the PCR gets its own uref */
+                    if (unlikely((ref = uref_dup_inner(uref)) == NULL))
+                        goto upipe_ts_decaps_input_err;
+                    uref_clock_set_ref(ref);
+                    upipe_throw_clock_ref(upipe, ref, pcrval,
+                                          discontinuity ? 1 : 0);
                 }
-                uint64_t pcrval = (tsaf_get_pcr(pcr - TS_HEADER_SIZE_AF) * 300 +
-                                   tsaf_get_pcrext(pcr - TS_HEADER_SIZE_AF));
-                pcrval *= UCLOCK_FREQ / 27000000;
-                UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 2, buffer2, pcr))
-
-                uref_clock_set_ref(uref);
-                upipe_throw_clock_ref(upipe, uref, pcrval,
-                                      discontinuity ? 1 : 0);
             }
-        }
 
-        UBASE_FATAL(upipe, uref_block_resize(uref, af_length + 1, -1))
-    }
+            payload += af_length + 1;
+        }
 
-    if (unlikely(ts_check_duplicate(cc, upipe_ts_decaps->last_cc))) {
-        if (!has_payload) {
-            /* padding or just PCR */
-            uref_free(uref);
-            return;
+        if (unlikely(ts_check_duplicate(cc, upipe_ts_decaps->last_cc))) {
+            if (!has_payload) {
+                /* padding or just PCR */
+                if (ref != NULL)
+                    uref_free(ref);
+                offset = end;
+                continue;
+            }
+            struct ubuf *last = NULL;
+            if (last_offset >= 0)
+                last = ubuf_block_splice(uref->ubuf, last_offset, last_size);
+            else if (upipe_ts_decaps->last_ubuf != NULL)
+                last = ubuf_dup(upipe_ts_decaps->last_ubuf);
+            bool duplicate = false;
+            if (last != NULL) {
+                struct ubuf *current = ubuf_block_splice(uref->ubuf, payload,
+                                                         end - payload);
+                duplicate = current != NULL &&
+                            ubase_check(ubuf_block_compare(current, 0, last));
+                if (current != NULL)
+                    ubuf_free(current);
+                ubuf_free(last);
+            }
+            if (duplicate) {
+                upipe_dbg(upipe, "removing duplicate packet");
+                if (ref != NULL)
+                    uref_free(ref);
+                offset = end;
+                continue;
+            }
+            upipe_warn_va(upipe, "potentially lost 16 packets");
+            upipe_ts_decaps->lost += 16;
+            discontinuity = true;
         }
-        if (upipe_ts_decaps->last_uref != NULL &&
-            ubase_check(uref_block_compare(uref, 0,
-                                           upipe_ts_decaps->last_uref))) {
-            upipe_dbg(upipe, "removing duplicate packet");
-            uref_free(uref);
-            return;
+
+        if (unlikely(!discontinuity &&
+                     ts_check_discontinuity(cc, upipe_ts_decaps->last_cc))) {
+            int lost = (0x10 + cc - upipe_ts_decaps->last_cc - 1) & 0xf;
+            upipe_ts_decaps->lost += lost;
+            upipe_warn_va(upipe, "potentially lost %d packets", lost);
+            discontinuity = true;
         }
-        upipe_warn_va(upipe, "potentially lost 16 packets");
-        upipe_ts_decaps->lost += 16;
-        discontinuity = true;
-    }
+        upipe_ts_decaps->last_cc = cc;
 
-    if (unlikely(!discontinuity &&
-                 ts_check_discontinuity(cc, upipe_ts_decaps->last_cc))) {
-        int lost = (0x10 + cc - upipe_ts_decaps->last_cc - 1) & 0xf;
-        upipe_ts_decaps->lost += lost;
-        upipe_warn_va(upipe, "potentially lost %d packets", lost);
-        discontinuity = true;
-    }
-    upipe_ts_decaps->last_cc = cc;
+        if (unlikely(!has_payload || payload >= end)) {
+            if (ref != NULL)
+                uref_free(ref);
+            offset = end;
+            continue;
+        }
 
-    if (unlikely(!has_payload)) {
-        uref_free(uref);
-        return;
+        struct ubuf *ubuf = ubuf_block_splice(uref->ubuf, payload,
+                                              end - payload);
+        if (unlikely(ubuf == NULL)) {
+            if (ref != NULL)
+                uref_free(ref);
+            goto upipe_ts_decaps_input_err;
+        }
+        last_offset = payload;
+        last_size = end - payload;
+
+        if (chunk.ubuf != NULL && ref == NULL && !discontinuity && !random &&
+            !unitstart && !transporterror) {
+            /* continuation packet */
+            if (unlikely(!ubase_check(ubuf_block_append(chunk.ubuf, ubuf)))) {
+                ubuf_free(ubuf);
+                goto upipe_ts_decaps_input_err;
+            }
+        } else {
+            upipe_ts_decaps_flush(upipe, &chunk, uref, false, upump_p);
+            chunk.uref = ref;
+            chunk.ubuf = ubuf;
+            chunk.discontinuity = discontinuity;
+            chunk.random = random;
+            chunk.start = unitstart;
+            chunk.error = transporterror;
+        }
+        offset = end;
+    } while (offset < size);
+
+    if (last_offset >= 0) {
+        if (upipe_ts_decaps->last_ubuf != NULL)
+            ubuf_free(upipe_ts_decaps->last_ubuf);
+        upipe_ts_decaps->last_ubuf = ubuf_block_splice(uref->ubuf,
+                                                       last_offset, last_size);
     }
-
-    if (unlikely(discontinuity))
-        uref_flow_set_discontinuity(uref);
-    if (unlikely(random))
-        uref_flow_set_random(uref);
-    if (unlikely(unitstart))
-        uref_block_set_start(uref);
-    if (unlikely(transporterror))
-        uref_flow_set_error(uref);
-
-    uref_free(upipe_ts_decaps->last_uref);
-    upipe_ts_decaps->last_uref = uref_dup(uref);
-    upipe_ts_decaps_output(upipe, uref, upump_p);
+    upipe_ts_decaps_flush(upipe, &chunk, uref, true, upump_p);
+    return;
+
+upipe_ts_decaps_input_err:
+    if (chunk.uref != NULL)
+        uref_free(chunk.uref);
+    if (chunk.ubuf != NULL)
+        ubuf_free(chunk.ubuf);
+    uref_free(uref);
+    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
 }
 
 /** @internal @This sets the input flow definition.
@@ -247,7 +392,12 @@ static int upipe_ts_decaps_set_flow_def(struct upipe *upipe,
         return UBASE_ERR_INVALID;
     const char *def;
     UBASE_RETURN(uref_flow_get_def(flow_def, &def))
-    if (ubase_ncmp(def, EXPECTED_FLOW_DEF))
+    const char *suffix;
+    if (!ubase_ncmp(def, EXPECTED_FLOW_DEF))
+        suffix = def + strlen(EXPECTED_FLOW_DEF);
+    else if (!ubase_ncmp(def, EXPECTED_FLOW_DEF_ALIGNED))
+        suffix = def + strlen(EXPECTED_FLOW_DEF_ALIGNED);
+    else
         return UBASE_ERR_INVALID;
     struct uref *flow_def_dup;
     if (unlikely((flow_def_dup = uref_dup(flow_def)) == NULL)) {
@@ -255,7 +405,7 @@ static int upipe_ts_decaps_set_flow_def(struct upipe *upipe,
         return UBASE_ERR_ALLOC;
     }
     if (unlikely(!ubase_check(uref_flow_set_def_va(flow_def_dup, "block.%s",
-                                       def + strlen(EXPECTED_FLOW_DEF)))))
+                                                   suffix))))
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
     upipe_ts_decaps_store_flow_def(upipe, flow_def_dup);
     return UBASE_ERR_NONE;
@@ -300,7 +450,8 @@ static void upipe_ts_decaps_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     struct upipe_ts_decaps *upipe_ts_decaps = upipe_ts_decaps_from_upipe(upipe);
-    uref_free(upipe_ts_decaps->last_uref);
+    if (upipe_ts_decaps->last_ubuf != NULL)
+        ubuf_free(upipe_ts_decaps->last_ubuf);
     upipe_ts_decaps_clean_output(upipe);
     upipe_ts_decaps_clean_urefcount(upipe);
     upipe_ts_decaps_free_void(upipe);
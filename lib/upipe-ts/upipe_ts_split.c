@@ -20,6 +20,10 @@
 
 /** @file
  * @short Upipe module splitting PIDs of a transport stream
+ *
+ * This module also accepts "block.mpegtsaligned." urefs carrying several
+ * TS packets. Runs of consecutive packets of the same PID are then output
+ * in a single uref.
  */
 
 #include <upipe/ubase.h>
@@ -46,8 +50,10 @@
 
 #include <bitstream/mpeg/ts.h>
 
-/** we only accept blocks containing exactly one TS packet */
+/** we accept blocks containing exactly one TS packet */
 #define EXPECTED_FLOW_DEF "block.mpegts."
+/** or blocks containing several aligned TS packets */
+#define EXPECTED_FLOW_DEF_ALIGNED "block.mpegtsaligned."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
 
@@ -55,6 +61,8 @@
 struct upipe_ts_split_pid {
     /** subs specific to that PID */
     struct uchain subs;
+    /** sub if it is the only one for that PID, otherwise NULL */
+    struct upipe *single;
     /** true if we asked for this PID */
     bool set;
 };
@@ -69,6 +77,8 @@ struct upipe_ts_split {
     /** list of output subpipes */
     struct uchain subs;
 
+    /** bitmap of PIDs having at least one sub, checked before pids */
+    uint64_t pid_map[MAX_PIDS / 64];
     /** PIDs array */
     struct upipe_ts_split_pid pids[MAX_PIDS];
 
@@ -256,17 +266,20 @@ static struct upipe *upipe_ts_split_alloc(struct upipe_mgr *mgr,
     upipe_ts_split_init_sub_mgr(upipe);
     upipe_ts_split_init_sub_subs(upipe);
 
+    memset(upipe_ts_split->pid_map, 0, sizeof(upipe_ts_split->pid_map));
     int i;
     for (i = 0; i < MAX_PIDS; i++) {
         ulist_init(&upipe_ts_split->pids[i].subs);
+        upipe_ts_split->pids[i].single = NULL;
         upipe_ts_split->pids[i].set = false;
     }
     upipe_throw_ready(upipe);
     return upipe;
 }
 
-/** @internal @This checks the status of the PID, and sends the split_set_pid
- * or split_unset_pid event if it has not already been sent.
+/** @internal @This checks the status of the PID, updates the dispatch
+ * table, and sends the split_set_pid or split_unset_pid event if it has not
+ * already been sent.
  *
  * @param upipe description structure of the pipe
  * @param pid PID to check
@@ -275,6 +288,17 @@ static void upipe_ts_split_pid_check(struct upipe *upipe, uint16_t pid)
 {
     assert(pid < MAX_PIDS);
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct uchain *subs = &upipe_ts_split->pids[pid].subs;
+    struct uchain *first = ulist_peek(subs);
+    upipe_ts_split->pids[pid].single =
+        first != NULL && ulist_is_last(subs, first) ?
+        upipe_ts_split_sub_to_upipe(upipe_ts_split_sub_from_uchain_pid(first)) :
+        NULL;
+    if (first != NULL)
+        upipe_ts_split->pid_map[pid / 64] |= UINT64_C(1) << (pid % 64);
+    else
+        upipe_ts_split->pid_map[pid / 64] &= ~(UINT64_C(1) << (pid % 64));
+
     if (!ulist_empty(&upipe_ts_split->pids[pid].subs)) {
         if (!upipe_ts_split->pids[pid].set) {
             upipe_ts_split->pids[pid].set = true;
@@ -328,50 +352,184 @@ static void upipe_ts_split_pid_unset(struct upipe *upipe, uint16_t pid,
     upipe_ts_split_pid_check(upipe, pid);
 }
 
-/** @internal @This demuxes a TS packet to the appropriate output(s).
+/** @internal @This is a read mapping of the input block, used to read TS
+ * headers in place. */
+struct upipe_ts_split_map {
+    /** mapped buffer, or NULL */
+    const uint8_t *buffer;
+    /** offset of the mapped buffer in the block */
+    size_t offset;
+    /** size of the mapped buffer */
+    int size;
+};
+
+/** @internal @This releases the read mapping of the input block.
+ *
+ * @param uref uref structure
+ * @param map read mapping
+ */
+static void upipe_ts_split_unmap(struct uref *uref,
+                                 struct upipe_ts_split_map *map)
+{
+    if (map->buffer != NULL) {
+        uref_block_unmap(uref, map->offset);
+        map->buffer = NULL;
+    }
+}
+
+/** @internal @This reads the PID of a TS packet, directly from the mapped
+ * block if the header is not split across segments.
+ *
+ * @param uref uref structure
+ * @param offset offset of the TS packet in the uref
+ * @param map read mapping of the block, updated as needed
+ * @param pid_p filled in with the PID
+ * @return an error code
+ */
+static int upipe_ts_split_get_pid(struct uref *uref, size_t offset,
+                                  struct upipe_ts_split_map *map,
+                                  uint16_t *pid_p)
+{
+    if (map->buffer == NULL || offset < map->offset ||
+        offset + TS_HEADER_SIZE > map->offset + map->size) {
+        upipe_ts_split_unmap(uref, map);
+        map->size = -1;
+        UBASE_RETURN(uref_block_read(uref, offset, &map->size, &map->buffer))
+        map->offset = offset;
+        if (unlikely(map->size < TS_HEADER_SIZE)) {
+            /* header split across segments */
+            upipe_ts_split_unmap(uref, map);
+            uint8_t buffer[TS_HEADER_SIZE];
+            const uint8_t *ts_header = uref_block_peek(uref, offset,
+                                                       TS_HEADER_SIZE, buffer);
+            if (unlikely(ts_header == NULL))
+                return UBASE_ERR_INVALID;
+            *pid_p = ts_get_pid(ts_header);
+            return uref_block_peek_unmap(uref, offset, buffer, ts_header);
+        }
+    }
+    *pid_p = ts_get_pid(map->buffer + offset - map->offset);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs TS packets of a PID to the appropriate output(s).
  *
  * @param upipe description structure of the pipe
+ * @param pid PID of the TS packets
  * @param uref uref structure
  * @param upump_p reference to pump that generated the buffer
  */
-static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
-                                 struct upump **upump_p)
+static void upipe_ts_split_output(struct upipe *upipe, uint16_t pid,
+                                  struct uref *uref, struct upump **upump_p)
 {
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
-                                               buffer);
-    if (unlikely(ts_header == NULL)) {
-        uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+    if (likely(upipe_ts_split->pids[pid].single != NULL)) {
+        upipe_ts_split_sub_output(upipe_ts_split->pids[pid].single, uref,
+                                  upump_p);
         return;
     }
-    uint16_t pid = ts_get_pid(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
 
+    struct uchain *subs = &upipe_ts_split->pids[pid].subs;
     struct uchain *uchain;
-    ulist_foreach (&upipe_ts_split->pids[pid].subs, uchain) {
+    ulist_foreach (subs, uchain) {
         struct upipe_ts_split_sub *output =
                 upipe_ts_split_sub_from_uchain_pid(uchain);
-        if (likely(uchain->next == NULL)) {
+        if (ulist_is_last(subs, uchain)) {
             upipe_ts_split_sub_output(upipe_ts_split_sub_to_upipe(output),
                                       uref, upump_p);
-            uref = NULL;
-        } else {
-            struct uref *new_uref = uref_dup(uref);
-            if (likely(new_uref != NULL))
-                upipe_ts_split_sub_output(
-                        upipe_ts_split_sub_to_upipe(output),
-                        new_uref, upump_p);
-            else {
-                uref_free(uref);
-                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+
+        struct uref *new_uref = uref_dup(uref);
+        if (unlikely(new_uref == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        upipe_ts_split_sub_output(upipe_ts_split_sub_to_upipe(output),
+                                  new_uref, upump_p);
+    }
+    uref_free(uref);
+}
+
+/** @internal @This checks whether a PID has at least one output.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID to check
+ * @return true if the PID has an output
+ */
+static bool upipe_ts_split_has_pid(struct upipe *upipe, uint16_t pid)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    return upipe_ts_split->pid_map[pid / 64] & (UINT64_C(1) << (pid % 64));
+}
+
+/** @internal @This demuxes TS packets to the appropriate output(s).
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    struct upipe_ts_split_map map;
+    map.buffer = NULL;
+    size_t size;
+    uint16_t pid;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)) ||
+                 !ubase_check(upipe_ts_split_get_pid(uref, 0, &map, &pid))))
+        goto upipe_ts_split_input_err;
+
+    if (likely(size <= TS_SIZE)) {
+        upipe_ts_split_unmap(uref, &map);
+        if (upipe_ts_split_has_pid(upipe, pid))
+            upipe_ts_split_output(upipe, pid, uref, upump_p);
+        else
+            uref_free(uref);
+        return;
+    }
+
+    /* several TS packets: output runs of packets of the same PID */
+    size_t offset = 0;
+    while (offset < size) {
+        size_t end = offset + TS_SIZE;
+        uint16_t next_pid = pid;
+        while (end + TS_HEADER_SIZE <= size) {
+            if (unlikely(!ubase_check(upipe_ts_split_get_pid(uref, end, &map,
+                                                             &next_pid))))
+                goto upipe_ts_split_input_err;
+            if (next_pid != pid)
+                break;
+            end += TS_SIZE;
+        }
+        if (end + TS_HEADER_SIZE > size)
+            /* trailing garbage */
+            end = size;
+
+        if (upipe_ts_split_has_pid(upipe, pid)) {
+            if (!offset && end == size) {
+                upipe_ts_split_unmap(uref, &map);
+                upipe_ts_split_output(upipe, pid, uref, upump_p);
                 return;
             }
+            struct uref *output = uref_block_splice(uref, offset,
+                                                    end - offset);
+            if (unlikely(output == NULL))
+                goto upipe_ts_split_input_err;
+            upipe_ts_split_output(upipe, pid, output, upump_p);
         }
+        offset = end;
+        pid = next_pid;
     }
-    if (uref != NULL)
-        uref_free(uref);
+    upipe_ts_split_unmap(uref, &map);
+    uref_free(uref);
+    return;
+
+upipe_ts_split_input_err:
+    upipe_ts_split_unmap(uref, &map);
+    uref_free(uref);
+    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
 }
 
 /** @internal @This sets the input flow definition.
@@ -385,6 +543,8 @@ static int upipe_ts_split_set_flow_def(struct upipe *upipe,
 {
     if (flow_def == NULL)
         return UBASE_ERR_INVALID;
+    if (ubase_check(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF_ALIGNED)))
+        return UBASE_ERR_NONE;
     return uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF);
 }
 
@@ -29,8 +29,18 @@
  * @item 196 @item TS packet followed by an 8-octet timestamp or checksum
  * @item 204 @item TS packet followed by a 16-octet checksum
  * @end table
+ *
+ * With @ref upipe_ts_sync_set_autodetect, the pipe instead locks on packets
+ * of 188, 192 (M2TS) or 204 (Reed-Solomon) octets, and outputs standard
+ * 188-octet TS packets.
+ *
+ * With @ref upipe_ts_sync_set_vector, consecutive synchronized TS packets are
+ * output in a single uref with the flow definition "block.mpegtsaligned.",
+ * which saves a uref allocation and a pipe call per packet downstream.
  */
 
+#include <config.h>
+
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
@@ -55,16 +65,24 @@
 
 #include <bitstream/mpeg/ts.h>
 
+#include "tssync.h"
+
 /** default number of packets to sync with */
 #define DEFAULT_TS_SYNC 2
 /** we only accept blocks */
 #define EXPECTED_FLOW_DEF "block."
 /** when configured with standard TS size, we output TS packets */
 #define OUTPUT_FLOW_DEF "block.mpegts."
+/** when configured to output several TS packets per uref */
+#define ALIGNED_OUTPUT_FLOW_DEF "block.mpegtsaligned."
 /** otherwise there is a suffix to decaps */
 #define SUFFIX_OUTPUT_FLOW_DEF "block.mpegtssuffix."
 /** TS synchronization word */
 #define TS_SYNC 0x47
+/** size of M2TS packets (BDAV) */
+#define M2TS_SIZE 192
+/** size of TS packets followed by Reed-Solomon parity */
+#define TS_RS_SIZE 204
 
 /** @internal @This is the private context of a ts_sync pipe. */
 struct upipe_ts_sync {
@@ -82,8 +100,17 @@ struct upipe_ts_sync {
 
     /** TS packet size */
     size_t output_size;
+    /** true if the packet size is detected */
+    bool autodetect;
+    /** detected packet size, or 0 */
+    size_t detected_size;
+    /** function scanning a buffer for sync words */
+    ptrdiff_t (*scan)(const uint8_t *, ptrdiff_t, ptrdiff_t,
+                      ptrdiff_t, ptrdiff_t, ptrdiff_t);
     /** number of packets to sync with */
     unsigned int ts_sync;
+    /** maximum number of packets per output uref */
+    unsigned int vector;
     /** next uref to be processed */
     struct uref *next_uref;
     /** original size of the next uref */
@@ -129,12 +156,131 @@ static struct upipe *upipe_ts_sync_alloc(struct upipe_mgr *mgr,
     upipe_ts_sync_init_output(upipe);
     upipe_ts_sync_init_output_size(upipe, TS_SIZE);
     upipe_ts_sync->ts_sync = DEFAULT_TS_SYNC;
+    upipe_ts_sync->vector = 1;
+    upipe_ts_sync->autodetect = false;
+    upipe_ts_sync->detected_size = 0;
+    upipe_ts_sync->scan = upipe_ts_sync_scan_c;
+#ifdef HAVE_X86ASM
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse2"))
+        upipe_ts_sync->scan = upipe_ts_sync_scan_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        upipe_ts_sync->scan = upipe_ts_sync_scan_avx2;
+#endif
+#endif
     upipe_ts_sync->next_uref = NULL;
     ulist_init(&upipe_ts_sync->urefs);
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This returns the period of the input packets.
+ *
+ * @param upipe description structure of the pipe
+ * @return size of input packets in octets
+ */
+static size_t upipe_ts_sync_period(struct upipe *upipe)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (upipe_ts_sync->autodetect && upipe_ts_sync->detected_size)
+        return upipe_ts_sync->detected_size;
+    return upipe_ts_sync->output_size;
+}
+
+/** @internal @This fills in the packet sizes to try, the preferred one
+ * first.
+ *
+ * @param upipe description structure of the pipe
+ * @param periods filled in with packet sizes
+ * @return number of packet sizes
+ */
+static unsigned int upipe_ts_sync_periods(struct upipe *upipe,
+                                          size_t periods[3])
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (!upipe_ts_sync->autodetect) {
+        periods[0] = upipe_ts_sync->output_size;
+        return 1;
+    }
+
+    static const size_t sizes[] = { TS_SIZE, M2TS_SIZE, TS_RS_SIZE };
+    unsigned int nb = 0;
+    if (upipe_ts_sync->detected_size)
+        periods[nb++] = upipe_ts_sync->detected_size;
+    for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(sizes); i++)
+        if (sizes[i] != upipe_ts_sync->detected_size)
+            periods[nb++] = sizes[i];
+    return nb;
+}
+
+/** @internal @This checks the presence of the sync words following a
+ * potential TS packet, at a given packet size.
+ *
+ * @param upipe description structure of the pipe
+ * @param offset offset of the potential first TS packet
+ * @param period size of packets
+ * @return 1 if the sync words are there, 0 if they are not, and -1 if not
+ * enough sync words could be tested
+ */
+static int upipe_ts_sync_check_period(struct upipe *upipe, size_t offset,
+                                      size_t period)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    for (unsigned int i = 1; i < upipe_ts_sync->ts_sync; i++) {
+        uint8_t word;
+        if (unlikely(!ubase_check(uref_block_extract(upipe_ts_sync->next_uref,
+                                    offset + i * period, 1, &word))))
+            return -1;
+        if (word != TS_SYNC)
+            return 0;
+    }
+    return 1;
+}
+
+/** @internal @This looks for potential TS packets in the contiguous segment
+ * of the working buffer at the given offset, with the SIMD scanner.
+ *
+ * @param upipe description structure of the pipe
+ * @param offset_p offset to start from, written with the offset of the
+ * potential TS packet or the offset to resume from
+ * @param periods packet sizes to try
+ * @param nb_periods number of packet sizes
+ * @return 1 if a potential TS packet was found, 0 if there is none in the
+ * scanned part, and -1 if the segment is too short to be scanned
+ */
+static int upipe_ts_sync_scan(struct upipe *upipe, size_t *offset_p,
+                              const size_t *periods, unsigned int nb_periods)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    ptrdiff_t strides[3];
+    size_t max_period = 0;
+    for (unsigned int i = 0; i < 3; i++) {
+        strides[i] = periods[i < nb_periods ? i : 0];
+        if (strides[i] > max_period)
+            max_period = strides[i];
+    }
+
+    const uint8_t *buffer;
+    int size = -1;
+    if (unlikely(!ubase_check(uref_block_read(upipe_ts_sync->next_uref,
+                                              *offset_p, &size, &buffer))))
+        return -1;
+
+    ptrdiff_t len = size - (ptrdiff_t)((upipe_ts_sync->ts_sync - 1) *
+                                       max_period);
+    if (len < UPIPE_TS_SYNC_SCAN_ALIGN) {
+        uref_block_unmap(upipe_ts_sync->next_uref, *offset_p);
+        return -1;
+    }
+    len &= ~(ptrdiff_t)(UPIPE_TS_SYNC_SCAN_ALIGN - 1);
+
+    ptrdiff_t found = upipe_ts_sync->scan(buffer, len, upipe_ts_sync->ts_sync,
+                                          strides[0], strides[1], strides[2]);
+    uref_block_unmap(upipe_ts_sync->next_uref, *offset_p);
+    *offset_p += found;
+    return found < len ? 1 : 0;
+}
+
 /** @internal @This checks the presence of the required number of sync words
  * in the working buffer.
  *
@@ -146,35 +292,98 @@ static struct upipe *upipe_ts_sync_alloc(struct upipe_mgr *mgr,
 static bool upipe_ts_sync_check(struct upipe *upipe, size_t *offset_p)
 {
     struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t periods[3];
+    unsigned int nb_periods = upipe_ts_sync_periods(upipe, periods);
+
     for ( ; ; ) {
         if (unlikely(!ubase_check(uref_block_scan(upipe_ts_sync->next_uref,
                                                   offset_p, TS_SYNC))))
             return false;
 
         /* first octet at *offset_p is a sync word */
-        int ts_sync = upipe_ts_sync->ts_sync - 1;
-        for (int offset = *offset_p + upipe_ts_sync->output_size; ts_sync;
-             ts_sync--, offset += upipe_ts_sync->output_size) {
-            const uint8_t *buffer;
-            int size = 1;
-            uint8_t word;
-            if (unlikely(!ubase_check(uref_block_read(upipe_ts_sync->next_uref,
-                                          offset, &size, &buffer))))
-                /* not enough sync words could be tested */
-                return false;
-            assert(size == 1);
-            word = *buffer;
-            uref_block_unmap(upipe_ts_sync->next_uref, offset);
-            if (word != TS_SYNC) {
-                *offset_p += 1;
-                break;
+        if (*offset_p || !upipe_ts_sync->acquired) {
+            /* resynchronization: scan whole segments at once */
+            int ret = upipe_ts_sync_scan(upipe, offset_p, periods, nb_periods);
+            if (!ret)
+                continue;
+        }
+
+        bool missing = false;
+        for (unsigned int i = 0; i < nb_periods; i++) {
+            int ret = upipe_ts_sync_check_period(upipe, *offset_p, periods[i]);
+            if (ret > 0) {
+                if (upipe_ts_sync->autodetect &&
+                    upipe_ts_sync->detected_size != periods[i]) {
+                    upipe_notice_va(upipe, "detected %zu-octet packets",
+                                    periods[i]);
+                    upipe_ts_sync->detected_size = periods[i];
+                }
+                return true;
             }
+            if (ret < 0)
+                missing = true;
         }
-        if (!ts_sync)
-            break;
+        if (missing)
+            /* not enough sync words could be tested */
+            return false;
+        *offset_p += 1;
     }
+}
+
+/** @internal @This extracts TS packets from the working buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb number of TS packets
+ * @return pointer to uref, or NULL in case of allocation error
+ */
+static struct uref *upipe_ts_sync_extract(struct upipe *upipe,
+                                          unsigned int nb)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t period = upipe_ts_sync_period(upipe);
+    struct uref *output = upipe_ts_sync_extract_uref_stream(upipe,
+                                                            nb * period);
+    if (likely(output != NULL) && upipe_ts_sync->autodetect &&
+        period != TS_SIZE)
+        /* remove M2TS header of the next packet or Reed-Solomon parity */
+        uref_block_truncate(output, TS_SIZE);
+    return output;
+}
 
-    return true;
+/** @internal @This returns the number of TS packets that may be output at
+ * once, starting at the beginning of the working buffer. Packets must all
+ * start in the first buffered uref, so that they share its attributes, and
+ * the sync words of the following packets must have been checked.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of TS packets
+ */
+static unsigned int upipe_ts_sync_vector(struct upipe *upipe)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t packet_size = upipe_ts_sync_period(upipe);
+    if (upipe_ts_sync->vector <= 1 || packet_size != TS_SIZE)
+        return 1;
+
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(upipe_ts_sync->next_uref,
+                                              &size))))
+        return 1;
+
+    /* the sync words of the first ts_sync packets were checked by
+     * upipe_ts_sync_check */
+    unsigned int nb = 1;
+    while (nb < upipe_ts_sync->vector &&
+           nb * packet_size < upipe_ts_sync->next_uref_size &&
+           (nb + upipe_ts_sync->ts_sync - 1) * packet_size < size) {
+        uint8_t word;
+        if (unlikely(!ubase_check(uref_block_extract(upipe_ts_sync->next_uref,
+                        (nb + upipe_ts_sync->ts_sync - 1) * packet_size,
+                        1, &word))) || word != TS_SYNC)
+            break;
+        nb++;
+    }
+    return nb;
 }
 
 /** @internal @This flushes all input buffers.
@@ -189,11 +398,10 @@ static void upipe_ts_sync_flush(struct upipe *upipe, struct upump **upump_p)
         size_t offset = 0, size;
         while (upipe_ts_sync->next_uref != NULL &&
                ubase_check(uref_block_size(upipe_ts_sync->next_uref, &size)) &&
-               size >= upipe_ts_sync->output_size &&
+               size >= upipe_ts_sync_period(upipe) &&
                ubase_check(uref_block_scan(upipe_ts_sync->next_uref, &offset, TS_SYNC)) &&
                !offset) {
-            struct uref *output = upipe_ts_sync_extract_uref_stream(upipe,
-                                                        upipe_ts_sync->output_size);
+            struct uref *output = upipe_ts_sync_extract(upipe, 1);
             if (unlikely(output == NULL)) {
                 upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
                 continue;
@@ -235,8 +443,8 @@ static void upipe_ts_sync_input(struct upipe *upipe, struct uref *uref,
 
         /* upipe_ts_sync_check said there is at least one TS packet there. */
         upipe_ts_sync_sync_acquired(upipe);
-        struct uref *output = upipe_ts_sync_extract_uref_stream(upipe,
-                                                    upipe_ts_sync->output_size);
+        unsigned int nb = upipe_ts_sync_vector(upipe);
+        struct uref *output = upipe_ts_sync_extract(upipe, nb);
         if (unlikely(output == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             continue;
@@ -245,6 +453,50 @@ static void upipe_ts_sync_input(struct upipe *upipe, struct uref *uref,
     }
 }
 
+/** @internal @This sets the attributes of the output flow definition, and
+ * stores it.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def output flow definition packet, belongs to the callee
+ * @return an error code
+ */
+static int upipe_ts_sync_build_flow_def(struct upipe *upipe,
+                                        struct uref *flow_def)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t size = upipe_ts_sync->autodetect ? TS_SIZE :
+                  upipe_ts_sync->output_size;
+    if (unlikely(!ubase_check(uref_block_flow_set_size(flow_def, size)) ||
+                 !ubase_check(uref_flow_set_def(flow_def,
+                        upipe_ts_sync->vector > 1 && size == TS_SIZE ?
+                        ALIGNED_OUTPUT_FLOW_DEF : OUTPUT_FLOW_DEF)))) {
+        uref_free(flow_def);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_ts_sync_store_flow_def(upipe, flow_def);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This rebuilds the output flow definition after a change of
+ * configuration.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_ts_sync_update_flow_def(struct upipe *upipe)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (upipe_ts_sync->flow_def == NULL)
+        return UBASE_ERR_NONE;
+    struct uref *flow_def = uref_dup(upipe_ts_sync->flow_def);
+    if (unlikely(flow_def == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    return upipe_ts_sync_build_flow_def(upipe, flow_def);
+}
+
 /** @internal @This sets the input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -262,12 +514,7 @@ static int upipe_ts_sync_set_flow_def(struct upipe *upipe,
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return UBASE_ERR_ALLOC;
     }
-    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
-    UBASE_RETURN(uref_block_flow_set_size(flow_def_dup,
-                                          upipe_ts_sync->output_size))
-    UBASE_RETURN(uref_flow_set_def(flow_def_dup, OUTPUT_FLOW_DEF))
-    upipe_ts_sync_store_flow_def(upipe, flow_def_dup);
-    return UBASE_ERR_NONE;
+    return upipe_ts_sync_build_flow_def(upipe, flow_def_dup);
 }
 
 /** @internal @This returns the configured number of packets to synchronize
@@ -302,6 +549,69 @@ static int _upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the maximum number of TS packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param vector_p filled in with the number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_get_vector(struct upipe *upipe,
+                                     unsigned int *vector_p)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    assert(vector_p != NULL);
+    *vector_p = upipe_ts_sync->vector;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the maximum number of TS packets per output uref.
+ * With a value greater than 1 and a TS packet size of 188 octets, the output
+ * flow definition is changed to "block.mpegtsaligned.".
+ *
+ * @param upipe description structure of the pipe
+ * @param vector number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_set_vector(struct upipe *upipe, unsigned int vector)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (!vector)
+        return UBASE_ERR_INVALID;
+    upipe_ts_sync->vector = vector;
+    return upipe_ts_sync_update_flow_def(upipe);
+}
+
+/** @internal @This returns whether the packet size is detected.
+ *
+ * @param upipe description structure of the pipe
+ * @param autodetect_p filled in with 1 if the packet size is detected
+ * @return an error code
+ */
+static int _upipe_ts_sync_get_autodetect(struct upipe *upipe,
+                                         int *autodetect_p)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    assert(autodetect_p != NULL);
+    *autodetect_p = upipe_ts_sync->autodetect ? 1 : 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets whether the packet size is detected among 188, 192
+ * (M2TS) and 204 (Reed-Solomon) octets. In that case the output packets are
+ * always 188-octet TS packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param autodetect 1 to detect the packet size
+ * @return an error code
+ */
+static int _upipe_ts_sync_set_autodetect(struct upipe *upipe, int autodetect)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    upipe_ts_sync->autodetect = !!autodetect;
+    upipe_ts_sync->detected_size = 0;
+    return upipe_ts_sync_update_flow_def(upipe);
+}
+
 /** @internal @This processes control commands on a ts sync pipe.
  *
  * @param upipe description structure of the pipe
@@ -333,6 +643,26 @@ static int upipe_ts_sync_control(struct upipe *upipe,
             int sync = va_arg(args, int);
             return _upipe_ts_sync_set_sync(upipe, sync);
         }
+        case UPIPE_TS_SYNC_GET_VECTOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int *vector_p = va_arg(args, unsigned int *);
+            return _upipe_ts_sync_get_vector(upipe, vector_p);
+        }
+        case UPIPE_TS_SYNC_SET_VECTOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int vector = va_arg(args, unsigned int);
+            return _upipe_ts_sync_set_vector(upipe, vector);
+        }
+        case UPIPE_TS_SYNC_GET_AUTODETECT: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            int *autodetect_p = va_arg(args, int *);
+            return _upipe_ts_sync_get_autodetect(upipe, autodetect_p);
+        }
+        case UPIPE_TS_SYNC_SET_AUTODETECT: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            int autodetect = va_arg(args, int);
+            return _upipe_ts_sync_set_autodetect(upipe, autodetect);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
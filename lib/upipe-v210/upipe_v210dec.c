@@ -43,6 +43,7 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslice.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -108,6 +109,23 @@ struct upipe_v210dec {
     /** output chroma map */
     const char *output_chroma_map[UPIPE_V210_MAX_PLANES+1];
 
+    /** pool of unpacking threads */
+    struct uslice_pool pool;
+    /** job of the current picture */
+    struct uslice_job job;
+    /** input plane of the picture being unpacked */
+    const uint8_t *work_input_plane;
+    /** stride of the input plane of the picture being unpacked */
+    size_t work_input_stride;
+    /** output planes of the picture being unpacked */
+    uint8_t *work_output_planes[3];
+    /** strides of the output planes of the picture being unpacked */
+    size_t work_output_strides[3];
+    /** horizontal size of the picture being unpacked */
+    size_t work_hsize;
+    /** vertical size of the picture being unpacked */
+    size_t work_vsize;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -188,85 +206,43 @@ static void v210dec_setup_asm(struct upipe *upipe, bool assembly)
         v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_aligned_avx2;
     }
 #endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        v210dec->v210_to_planar_8  = upipe_v210_to_planar_8_aligned_avx512;
+        v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_aligned_avx512;
+    }
+#endif
 #endif
 }
 
-/** @internal @This handles data.
+/** @internal @This unpacks a slice of lines of the current picture.
  *
- * @param upipe description structure of the pipe
- * @param uref uref structure describing the picture
- * @param upump_p reference to pump that generated the buffer
- * @return false if the input must be blocked
+ * @param job job of the current picture
+ * @param slice index of the slice
+ * @param thread index of the thread
  */
-static bool upipe_v210dec_handle(struct upipe *upipe, struct uref *uref,
-                             struct upump **upump_p)
+static void upipe_v210dec_work_slice(struct uslice_job *job,
+                                     unsigned int slice, unsigned int thread)
 {
-    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
-    const char *def;
-    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
-        upipe_v210dec_store_flow_def(upipe, NULL);
-        upipe_v210dec_require_ubuf_mgr(upipe, uref);
-        return true;
-    }
-
-    if (v210dec->flow_def == NULL)
-        return false;
-
-    size_t input_hsize, input_vsize;
-    if (!ubase_check(uref_pic_size(uref, &input_hsize, &input_vsize, NULL))) {
-        upipe_warn(upipe, "invalid buffer received");
-        uref_free(uref);
-        return true;
-    }
-
-    const uint8_t *input_plane;
-    size_t input_stride;
-    if (unlikely(!ubase_check(uref_pic_plane_read(uref, v210_chroma_str,
-                        0, 0, -1, -1, &input_plane)) ||
-                 !ubase_check(uref_pic_plane_size(uref, v210_chroma_str,
-                      &input_stride, 0, 0, 0)))) {
-        upipe_warn(upipe, "invalid buffer received");
-        uref_free(uref);
-        return true;
-    }
-
-    uint64_t output_hsize;
-    if (unlikely(!ubase_check(uref_pic_flow_get_hsize(v210dec->flow_def, &output_hsize)))) {
-        upipe_warn(upipe, "could not find output picture size");
-        uref_free(uref);
-        return true;
-    }
-
+    struct upipe_v210dec *v210dec =
+        container_of(job, struct upipe_v210dec, job);
+    unsigned int nb_slices = job->nb_slices;
+    size_t output_hsize = v210dec->work_hsize;
+    size_t first = v210dec->work_vsize * slice / nb_slices;
+    size_t last = v210dec->work_vsize * (slice + 1) / nb_slices;
+    size_t input_stride = v210dec->work_input_stride;
+    const uint8_t *input_plane = v210dec->work_input_plane +
+                                 first * input_stride;
+    const size_t *output_strides = v210dec->work_output_strides;
     uint8_t *output_planes[3];
-    size_t output_strides[3];
-    struct ubuf *ubuf = ubuf_pic_alloc(v210dec->ubuf_mgr, output_hsize, input_vsize);
-    if (unlikely(!ubuf)) {
-        // TODO free allocated memory
-        uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return true;
-    }
-
-    for (int i = 0; i < 3; i++) {
-        const char *chroma = v210dec->output_chroma_map[i];
-
-        if (unlikely(!ubase_check(ubuf_pic_plane_write(ubuf, chroma,
-                            0, 0, -1, -1,
-                            &output_planes[i])) ||
-                     !ubase_check(ubuf_pic_plane_size(ubuf, chroma,
-                             &output_strides[i],
-                             0, 0, 0)))) {
-            // TODO free allocated memory`
-            upipe_warn(upipe, "invalid buffer received");
-            ubuf_free(ubuf);
-            uref_free(uref);
-            return true;
-        }
-    }
+    for (int i = 0; i < 3; i++)
+        output_planes[i] = v210dec->work_output_planes[i] +
+                           first * output_strides[i];
 
     switch (v210dec->output_type) {
         case V2D_OUTPUT_PLANAR_8: {
-            for (int h = 0; h < input_vsize; h++) {
+            for (size_t h = first; h < last; h++) {
                 uint8_t *y = output_planes[0];
                 uint8_t *u = output_planes[1];
                 uint8_t *v = output_planes[2];
@@ -303,7 +279,7 @@ static bool upipe_v210dec_handle(struct upipe *upipe, struct uref *uref,
         } break;
 
         case V2D_OUTPUT_PLANAR_10: {
-            for (int h = 0; h < input_vsize; h++) {
+            for (size_t h = first; h < last; h++) {
                 uint16_t *y = (uint16_t*)output_planes[0];
                 uint16_t *u = (uint16_t*)output_planes[1];
                 uint16_t *v = (uint16_t*)output_planes[2];
@@ -343,6 +319,139 @@ static bool upipe_v210dec_handle(struct upipe *upipe, struct uref *uref,
         default:
             assert(0);
     }
+}
+
+/** @internal @This gets the number of unpacking threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_v210dec_get_threads(struct upipe *upipe,
+                                      unsigned int *threads_p)
+{
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&v210dec->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of unpacking threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_v210dec_set_threads(struct upipe *upipe,
+                                      unsigned int threads)
+{
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&v210dec->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
+    }
+    upipe_dbg_va(upipe, "unpacking with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This converts the current picture. It is split into slices of
+ * lines, shared between the worker threads and the calling thread. It returns
+ * when all slices are done.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_v210dec_work(struct upipe *upipe)
+{
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    uslice_job_init(&v210dec->job, upipe_v210dec_work_slice,
+                    uslice_pool_get_threads(&v210dec->pool));
+    uslice_pool_run(&v210dec->pool, &v210dec->job);
+}
+
+/** @internal @This handles data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure describing the picture
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be blocked
+ */
+static bool upipe_v210dec_handle(struct upipe *upipe, struct uref *uref,
+                             struct upump **upump_p)
+{
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        upipe_v210dec_store_flow_def(upipe, NULL);
+        upipe_v210dec_require_ubuf_mgr(upipe, uref);
+        return true;
+    }
+
+    if (v210dec->flow_def == NULL)
+        return false;
+
+    size_t input_hsize, input_vsize;
+    if (!ubase_check(uref_pic_size(uref, &input_hsize, &input_vsize, NULL))) {
+        upipe_warn(upipe, "invalid buffer received");
+        uref_free(uref);
+        return true;
+    }
+
+    const uint8_t *input_plane;
+    size_t input_stride;
+    if (unlikely(!ubase_check(uref_pic_plane_read(uref, v210_chroma_str,
+                        0, 0, -1, -1, &input_plane)) ||
+                 !ubase_check(uref_pic_plane_size(uref, v210_chroma_str,
+                      &input_stride, 0, 0, 0)))) {
+        upipe_warn(upipe, "invalid buffer received");
+        uref_free(uref);
+        return true;
+    }
+
+    uint64_t output_hsize;
+    if (unlikely(!ubase_check(uref_pic_flow_get_hsize(v210dec->flow_def, &output_hsize)))) {
+        upipe_warn(upipe, "could not find output picture size");
+        uref_free(uref);
+        return true;
+    }
+
+    uint8_t *output_planes[3];
+    size_t output_strides[3];
+    struct ubuf *ubuf = ubuf_pic_alloc(v210dec->ubuf_mgr, output_hsize, input_vsize);
+    if (unlikely(!ubuf)) {
+        // TODO free allocated memory
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const char *chroma = v210dec->output_chroma_map[i];
+
+        if (unlikely(!ubase_check(ubuf_pic_plane_write(ubuf, chroma,
+                            0, 0, -1, -1,
+                            &output_planes[i])) ||
+                     !ubase_check(ubuf_pic_plane_size(ubuf, chroma,
+                             &output_strides[i],
+                             0, 0, 0)))) {
+            // TODO free allocated memory`
+            upipe_warn(upipe, "invalid buffer received");
+            ubuf_free(ubuf);
+            uref_free(uref);
+            return true;
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        v210dec->work_output_planes[i] = output_planes[i];
+        v210dec->work_output_strides[i] = output_strides[i];
+    }
+    v210dec->work_input_plane = input_plane;
+    v210dec->work_input_stride = input_stride;
+    v210dec->work_hsize = output_hsize;
+    v210dec->work_vsize = input_vsize;
+    upipe_v210dec_work(upipe);
 
     uref_pic_plane_unmap(uref, v210_chroma_str, 0, 0, -1, -1);
     for (int i = 0; i < 3; i++)
@@ -561,6 +670,17 @@ static int upipe_v210dec_control(struct upipe *upipe, int command, va_list args)
             return upipe_v210dec_set_flow_def(upipe, flow);
         }
 
+        case UPIPE_V210DEC_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210DEC_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_v210dec_get_threads(upipe, threads_p);
+        }
+        case UPIPE_V210DEC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210DEC_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_v210dec_set_threads(upipe, threads);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -616,6 +736,7 @@ static struct upipe *upipe_v210dec_alloc(struct upipe_mgr *manager,
     upipe_v210dec_init_ubuf_mgr(upipe);
     upipe_v210dec_init_output(upipe);
     upipe_v210dec_init_input(upipe);
+    uslice_pool_init(&v210dec->pool);
 
     uref_free(flow_def);
     upipe_throw_ready(upipe);
@@ -628,7 +749,10 @@ static struct upipe *upipe_v210dec_alloc(struct upipe_mgr *manager,
  */
 static void upipe_v210dec_free(struct upipe *upipe)
 {
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
     upipe_throw_dead(upipe);
+
+    uslice_pool_clean(&v210dec->pool);
     upipe_v210dec_clean_input(upipe);
     upipe_v210dec_clean_output(upipe);
     upipe_v210dec_clean_ubuf_mgr(upipe);
@@ -43,6 +43,7 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslice.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -112,6 +113,23 @@ struct upipe_v210enc {
     /** output chroma map */
     const char *output_chroma_map;
 
+    /** pool of packing threads */
+    struct uslice_pool pool;
+    /** job of the current picture */
+    struct uslice_job job;
+    /** input planes of the picture being packed */
+    const uint8_t *work_input_planes[UPIPE_V210_MAX_PLANES + 1];
+    /** strides of the input planes of the picture being packed */
+    int work_input_strides[UPIPE_V210_MAX_PLANES + 1];
+    /** output plane of the picture being packed */
+    uint8_t *work_output_plane;
+    /** stride of the output plane of the picture being packed */
+    size_t work_output_stride;
+    /** horizontal size of the picture being packed */
+    size_t work_hsize;
+    /** vertical size of the picture being packed */
+    size_t work_vsize;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -161,6 +179,168 @@ static inline void wl32(uint8_t *dst, uint32_t u)
         dst += 4;                       \
     } while (0)
 
+/** @internal @This packs a slice of lines of the current picture.
+ *
+ * @param job job of the current picture
+ * @param slice index of the slice
+ * @param thread index of the thread
+ */
+static void upipe_v210enc_work_slice(struct uslice_job *job,
+                                     unsigned int slice, unsigned int thread)
+{
+    struct upipe_v210enc *upipe_v210enc =
+        container_of(job, struct upipe_v210enc, job);
+    unsigned int nb_slices = job->nb_slices;
+    const uint8_t *const *input_planes = upipe_v210enc->work_input_planes;
+    const int *input_strides = upipe_v210enc->work_input_strides;
+    size_t stride = upipe_v210enc->work_output_stride;
+    size_t input_hsize = upipe_v210enc->work_hsize;
+    size_t first = upipe_v210enc->work_vsize * slice / nb_slices;
+    size_t last = upipe_v210enc->work_vsize * (slice + 1) / nb_slices;
+
+    int line_padding = stride - ((input_hsize * 8 + 11) / 12) * 4;
+    uint8_t *dst = upipe_v210enc->work_output_plane + first * stride;
+    size_t h;
+    int w;
+    if (upipe_v210enc->input_bit_depth == 10) {
+        const uint16_t *y = (const uint16_t *)
+            (input_planes[0] + first * input_strides[0]);
+        const uint16_t *u = (const uint16_t *)
+            (input_planes[1] + first * input_strides[1]);
+        const uint16_t *v = (const uint16_t *)
+            (input_planes[2] + first * input_strides[2]);
+        for (h = first; h < last; h++) {
+            uint32_t val = 0;
+            w = (input_hsize / 6) * 6;
+            upipe_v210enc->pack_line_10(y, u, v, dst, w);
+
+            y += w;
+            u += w >> 1;
+            v += w >> 1;
+            dst += (w / 6) * 16;
+            if (w < input_hsize - 1) {
+                WRITE_PIXELS(u, y, v);
+
+                val = CLIP(*y++);
+                if (w == input_hsize - 2) {
+                    wl32(dst, val);
+                    dst += 4;
+                }
+            }
+            if (w < input_hsize - 3) {
+                val |= (CLIP(*u++) << 10) | (CLIP(*y++) << 20);
+                wl32(dst, val);
+                dst += 4;
+
+                val = CLIP(*v++) | (CLIP(*y++) << 10);
+                wl32(dst, val);
+                dst += 4;
+            }
+
+            memset(dst, 0, line_padding);
+            dst += line_padding;
+            y += input_strides[0] / 2 - input_hsize;
+            u += input_strides[1] / 2 - input_hsize / 2;
+            v += input_strides[2] / 2 - input_hsize / 2;
+        }
+    }
+    else {
+        const uint8_t *y = input_planes[0] + first * input_strides[0];
+        const uint8_t *u = input_planes[1] + first * input_strides[1];
+        const uint8_t *v = input_planes[2] + first * input_strides[2];
+        for (h = first; h < last; h++) {
+            uint32_t val = 0;
+            w = (input_hsize / 12) * 12;
+            upipe_v210enc->pack_line_8(y, u, v, dst, w);
+
+            y += w;
+            u += w >> 1;
+            v += w >> 1;
+            dst += (w / 12) * 32;
+
+            for (; w < input_hsize - 5; w += 6) {
+                WRITE_PIXELS8(u, y, v);
+                WRITE_PIXELS8(y, u, y);
+                WRITE_PIXELS8(v, y, u);
+                WRITE_PIXELS8(y, v, y);
+            }
+            if (w < input_hsize - 1) {
+                WRITE_PIXELS8(u, y, v);
+
+                val = CLIP8(*y++) << 2;
+                if (w == input_hsize - 2) {
+                    wl32(dst, val);
+                    dst += 4;
+                }
+            }
+            if (w < input_hsize - 3) {
+                val |= (CLIP8(*u++) << 12) | (CLIP8(*y++) << 22);
+                wl32(dst, val);
+                dst += 4;
+
+                val = (CLIP8(*v++) << 2) | (CLIP8(*y++) << 12);
+                wl32(dst, val);
+                dst += 4;
+            }
+            memset(dst, 0, line_padding);
+            dst += line_padding;
+
+            y += input_strides[0] - input_hsize;
+            u += input_strides[1] - input_hsize / 2;
+            v += input_strides[2] - input_hsize / 2;
+        }
+    }
+}
+
+/** @internal @This gets the number of packing threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads_p filled in with the number of threads
+ * @return an error code
+ */
+static int _upipe_v210enc_get_threads(struct upipe *upipe,
+                                      unsigned int *threads_p)
+{
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
+    *threads_p = uslice_pool_get_threads(&upipe_v210enc->pool);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of packing threads, and (re)starts
+ * the worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+static int _upipe_v210enc_set_threads(struct upipe *upipe,
+                                      unsigned int threads)
+{
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
+    int err = uslice_pool_set_threads(&upipe_v210enc->pool, threads);
+    if (unlikely(!ubase_check(err))) {
+        if (err != UBASE_ERR_INVALID)
+            upipe_err(upipe, "unable to create worker threads");
+        return err;
+    }
+    upipe_dbg_va(upipe, "packing with %u threads", threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This converts the current picture. It is split into slices of
+ * lines, shared between the worker threads and the calling thread. It returns
+ * when all slices are done.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_v210enc_work(struct upipe *upipe)
+{
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
+    uslice_job_init(&upipe_v210enc->job, upipe_v210enc_work_slice,
+                    uslice_pool_get_threads(&upipe_v210enc->pool));
+    uslice_pool_run(&upipe_v210enc->pool, &upipe_v210enc->job);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -256,94 +436,15 @@ static bool upipe_v210enc_handle(struct upipe *upipe, struct uref *uref,
     }
 
     /* Do v210 packing */
-    int line_padding = stride - ((input_hsize * 8 + 11) / 12) * 4;
-    uint8_t *dst = output_plane;
-    int h, w;
-    if (upipe_v210enc->input_bit_depth == 10) {
-        const uint16_t *y = (const uint16_t *)input_planes[0];
-        const uint16_t *u = (const uint16_t *)input_planes[1];
-        const uint16_t *v = (const uint16_t *)input_planes[2];
-        for (h = 0; h < input_vsize; h++) {
-            uint32_t val = 0;
-            w = (input_hsize / 6) * 6;
-            upipe_v210enc->pack_line_10(y, u, v, dst, w);
-
-            y += w;
-            u += w >> 1;
-            v += w >> 1;
-            dst += (w / 6) * 16;
-            if (w < input_hsize - 1) {
-                WRITE_PIXELS(u, y, v);
-
-                val = CLIP(*y++);
-                if (w == input_hsize - 2) {
-                    wl32(dst, val);
-                    dst += 4;
-                }
-            }
-            if (w < input_hsize - 3) {
-                val |= (CLIP(*u++) << 10) | (CLIP(*y++) << 20);
-                wl32(dst, val);
-                dst += 4;
-
-                val = CLIP(*v++) | (CLIP(*y++) << 10);
-                wl32(dst, val);
-                dst += 4;
-            }
-
-            memset(dst, 0, line_padding);
-            dst += line_padding;
-            y += input_strides[0] / 2 - input_hsize;
-            u += input_strides[1] / 2 - input_hsize / 2;
-            v += input_strides[2] / 2 - input_hsize / 2;
-        }
-    }
-    else {
-        const uint8_t *y = input_planes[0];
-        const uint8_t *u = input_planes[1];
-        const uint8_t *v = input_planes[2];
-        for (h = 0; h < input_vsize; h++) {
-            uint32_t val = 0;
-            w = (input_hsize / 12) * 12;
-            upipe_v210enc->pack_line_8(y, u, v, dst, w);
-
-            y += w;
-            u += w >> 1;
-            v += w >> 1;
-            dst += (w / 12) * 32;
-
-            for (; w < input_hsize - 5; w += 6) {
-                WRITE_PIXELS8(u, y, v);
-                WRITE_PIXELS8(y, u, y);
-                WRITE_PIXELS8(v, y, u);
-                WRITE_PIXELS8(y, v, y);
-            }
-            if (w < input_hsize - 1) {
-                WRITE_PIXELS8(u, y, v);
-
-                val = CLIP8(*y++) << 2;
-                if (w == input_hsize - 2) {
-                    wl32(dst, val);
-                    dst += 4;
-                }
-            }
-            if (w < input_hsize - 3) {
-                val |= (CLIP8(*u++) << 12) | (CLIP8(*y++) << 22);
-                wl32(dst, val);
-                dst += 4;
-
-                val = (CLIP8(*v++) << 2) | (CLIP8(*y++) << 12);
-                wl32(dst, val);
-                dst += 4;
-            }
-            memset(dst, 0, line_padding);
-            dst += line_padding;
-
-            y += input_strides[0] - input_hsize;
-            u += input_strides[1] - input_hsize / 2;
-            v += input_strides[2] - input_hsize / 2;
-        }
+    for (i = 0; i <= UPIPE_V210_MAX_PLANES; i++) {
+        upipe_v210enc->work_input_planes[i] = input_planes[i];
+        upipe_v210enc->work_input_strides[i] = input_strides[i];
     }
+    upipe_v210enc->work_output_plane = output_plane;
+    upipe_v210enc->work_output_stride = stride;
+    upipe_v210enc->work_hsize = input_hsize;
+    upipe_v210enc->work_vsize = input_vsize;
+    upipe_v210enc_work(upipe);
 
     /* unmap pictures */
     for (i = 0; i < UPIPE_V210_MAX_PLANES &&
@@ -556,6 +657,17 @@ static int upipe_v210enc_control(struct upipe *upipe, int command, va_list args)
             return upipe_v210enc_set_flow_def(upipe, flow);
         }
 
+        case UPIPE_V210ENC_GET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210ENC_SIGNATURE)
+            unsigned int *threads_p = va_arg(args, unsigned int *);
+            return _upipe_v210enc_get_threads(upipe, threads_p);
+        }
+        case UPIPE_V210ENC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210ENC_SIGNATURE)
+            unsigned int threads = va_arg(args, unsigned int);
+            return _upipe_v210enc_set_threads(upipe, threads);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -596,12 +708,20 @@ static struct upipe *upipe_v210enc_alloc(struct upipe_mgr *mgr,
         upipe_v210enc->pack_line_10 = upipe_planar_to_v210_10_avx2;
     }
 #endif
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        upipe_v210enc->pack_line_8  = upipe_planar_to_v210_8_avx512;
+        upipe_v210enc->pack_line_10 = upipe_planar_to_v210_10_avx512;
+    }
+#endif
 #endif
 
     upipe_v210enc_init_urefcount(upipe);
     upipe_v210enc_init_ubuf_mgr(upipe);
     upipe_v210enc_init_output(upipe);
     upipe_v210enc_init_input(upipe);
+    uslice_pool_init(&upipe_v210enc->pool);
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -613,7 +733,10 @@ static struct upipe *upipe_v210enc_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_v210enc_free(struct upipe *upipe)
 {
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
     upipe_throw_dead(upipe);
+
+    uslice_pool_clean(&upipe_v210enc->pool);
     upipe_v210enc_clean_input(upipe);
     upipe_v210enc_clean_output(upipe);
     upipe_v210enc_clean_ubuf_mgr(upipe);
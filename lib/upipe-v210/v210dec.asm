@@ -21,7 +21,14 @@
 
 %include "x86util.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
+
+; gathers the 6 luma samples of each lane
+v210_luma_perm:   dw  0,  1,  2,  3,  4,  5,  8,  9, 10, 11, 12, 13, 16, 17, 18, 19
+                  dw 20, 21, 24, 25, 26, 27, 28, 29,  0,  0,  0,  0,  0,  0,  0,  0
+; gathers the 3 u samples, then the 3 v samples of each lane
+v210_chroma_perm: dw  0,  1,  2,  8,  9, 10, 16, 17, 18, 24, 25, 26,  0,  0,  0,  0
+                  dw  4,  5,  6, 12, 13, 14, 20, 21, 22, 28, 29, 30,  0,  0,  0,  0
 
 v210_mask:        times 8 dd 0x3ff
 v210_mult:        times 2 dw 64, 4, 64, 4, 64, 4, 64, 4
@@ -151,3 +158,95 @@ INIT_XMM avx
 v210_to_planar_8 aligned
 INIT_YMM avx2
 v210_to_planar_8 aligned
+
+; The AVX-512 versions unpack 24 pixels (64 octets) per iteration as in the
+; SSSE3 version, and then gather the samples of the 4 lanes with vpermw. The
+; stores are masked, so nothing is written past the given number of pixels.
+
+%if ARCH_X86_64
+%macro v210_to_planar_avx512 1
+
+; v210_to_planar_%1(const uint32_t *src, uint%1_t *y, uint%1_t *u, uint%1_t *v, int64_t width)
+cglobal v210_to_planar_%1_aligned, 5, 7, 9, src, y, u, v, pixels, tmp, mask
+%if %1 == 10
+    lea    yq, [yq + 2*pixelsq]
+    add    uq, pixelsq
+    add    vq, pixelsq
+%else
+    add    yq, pixelsq
+    mov    tmpq, pixelsq
+    shr    tmpq, 1
+    add    uq, tmpq
+    add    vq, tmpq
+%endif
+    neg    pixelsq
+
+    vbroadcasti32x4 m3, [v210_mult]
+    vpbroadcastd    m4, [v210_mask]
+    vbroadcasti32x4 m5, [v210_luma_shuf]
+    vbroadcasti32x4 m6, [v210_chroma_shuf]
+    mova   m7, [v210_luma_perm]
+    mova   m8, [v210_chroma_perm]
+    mov    tmpd, 0xffffff
+    kmovd  k1, tmpd
+    mov    tmpd, 0xfff
+    kmovd  k2, tmpd
+
+    .loop:
+        cmp    pixelsq, -24
+        jle    .store_all
+        ; fewer than 24 pixels left
+        mov    tmpd, pixelsd
+        neg    tmpd
+        mov    maskd, -1
+        bzhi   maskd, maskd, tmpd
+        kmovd  k1, maskd
+        shr    tmpd, 1
+        mov    maskd, -1
+        bzhi   maskd, maskd, tmpd
+        kmovd  k2, maskd
+    .store_all:
+        movu   m0, [srcq]
+
+        pmullw m1, m0, m3
+        psrld  m0, 10
+        psrlw  m1, 6            ; u0 v0 y1 y2 v1 u2 y4 y5
+        pand   m0, m4           ; y0 __ u1 __ y3 __ v2 __
+
+        shufps m2, m1, m0, 0x8d ; y1 y2 y4 y5 y0 __ y3 __
+        pshufb m2, m5           ; y0 y1 y2 y3 y4 y5 __ __
+        vpermw m2, m7, m2
+
+        shufps m1, m1, m0, 0xd8 ; u0 v0 v1 u2 u1 __ v2 __
+        pshufb m1, m6           ; u0 u1 u2 __ v0 v1 v2 __
+        vpermw m1, m8, m1       ; u0-u11 __ v0-v11 __
+
+%if %1 == 10
+        vmovdqu16 [yq + 2*pixelsq]{k1}, m2
+        vmovdqu16 [uq + pixelsq]{k2}, ym1
+        vextracti64x4 ym1, m1, 1
+        vmovdqu16 [vq + pixelsq]{k2}, ym1
+%else
+        psrlw  m2, 2
+        psrlw  m1, 2
+        vpmovwb ym2, m2
+        vpmovwb ym1, m1
+        mov    tmpq, pixelsq
+        sar    tmpq, 1
+        vmovdqu8 [yq + pixelsq]{k1}, ym2
+        vmovdqu8 [uq + tmpq]{k2}, xm1
+        vextracti32x4 xm1, ym1, 1
+        vmovdqu8 [vq + tmpq]{k2}, xm1
+%endif
+
+        add srcq, mmsize
+        add pixelsq, 24
+    jl  .loop
+RET
+
+%endmacro
+
+INIT_ZMM avx512
+v210_to_planar_avx512 10
+v210_to_planar_avx512 8
+%endif
@@ -9,10 +9,12 @@ void upipe_v210_to_planar_8_c(const void *src, uint8_t *y, uint8_t *u, uint8_t *
 void upipe_v210_to_planar_10_aligned_ssse3(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_10_aligned_avx  (const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_10_aligned_avx2 (const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
+void upipe_v210_to_planar_10_aligned_avx512(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
 
 /* process (6*mmsize)/16 pixels per iteration */
 void upipe_v210_to_planar_8_aligned_ssse3(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_8_aligned_avx  (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_8_aligned_avx2 (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
+void upipe_v210_to_planar_8_aligned_avx512(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
 
 #endif
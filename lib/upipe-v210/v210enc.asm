@@ -23,6 +23,13 @@
 
 SECTION_RODATA 64
 
+; spreads 6 luma samples to each lane
+v210_enc_luma_perm_10: dw  0,  1,  2,  3,  4,  5,  0,  0,  6,  7,  8,  9, 10, 11,  0,  0
+                       dw 12, 13, 14, 15, 16, 17,  0,  0, 18, 19, 20, 21, 22, 23,  0,  0
+; spreads 3 u and 3 v samples to each lane (v is in the second table)
+v210_enc_chroma_perm_10: dw  0,  1,  2,  0, 32, 33, 34,  0,  3,  4,  5,  0, 35, 36, 37,  0
+                         dw  6,  7,  8,  0, 38, 39, 40,  0,  9, 10, 11,  0, 41, 42, 43,  0
+
 v210_enc_min_10: times 16 dw 0x0004
 v210_enc_max_10: times 16 dw 0x3fb
 
@@ -42,6 +49,7 @@ v210_enc_chroma_shuf1_8: times 2 db 0,-1,1,-1,2,-1,3,-1,8,-1,9,-1,10,-1,11,-1
 v210_enc_chroma_shuf2_8: times 2 db 3,-1,4,-1,5,-1,7,-1,11,-1,12,-1,13,-1,15,-1
 
 v210_enc_chroma_mult_8: times 2 dw 4,16,64,0,64,4,16,0
+v210_enc_clip_8: dw 1, 254
 
 SECTION .text
 
@@ -168,3 +176,88 @@ INIT_XMM avx
 planar_to_v210_8
 INIT_YMM avx2
 planar_to_v210_8
+
+; The AVX-512 versions process 24 pixels per iteration. The samples are read
+; with masked loads and spread to the 4 lanes with vpermw/vpermt2w, and then
+; packed as in the 10-bit SSSE3 version. 8-bit samples are clipped and scaled
+; to 10 bits first.
+
+%if ARCH_X86_64
+%macro planar_to_v210_avx512 1
+
+; planar_to_v210_%1(const uint%1_t *y, const uint%1_t *u, const uint%1_t *v, uint8_t *dst, ptrdiff_t width)
+cglobal planar_to_v210_%1, 5, 6, 12, y, u, v, dst, width, tmp
+%if %1 == 10
+    lea     yq, [yq+2*widthq]
+    add     uq, widthq
+    add     vq, widthq
+    neg     widthq
+    vpbroadcastw m2, [v210_enc_min_10]
+    vpbroadcastw m3, [v210_enc_max_10]
+%else
+    add     yq, widthq
+    shr     widthq, 1
+    add     uq, widthq
+    add     vq, widthq
+    neg     widthq
+    vpbroadcastw m2, [v210_enc_clip_8]
+    vpbroadcastw m3, [v210_enc_clip_8+2]
+%endif
+    vbroadcasti32x4 m4, [v210_enc_luma_mult_10]
+    vbroadcasti32x4 m5, [v210_enc_luma_shuf_10]
+    vbroadcasti32x4 m6, [v210_enc_chroma_mult_10]
+    vbroadcasti32x4 m7, [v210_enc_chroma_shuf_10]
+    mova    m8, [v210_enc_luma_perm_10]
+    mova    m9, [v210_enc_chroma_perm_10]
+    mov     tmpd, 0xffffff
+    kmovd   k1, tmpd
+    mov     tmpd, 0xfff
+    kmovd   k2, tmpd
+
+.loop:
+%if %1 == 10
+    vmovdqu16 m0{k1}{z}, [yq+2*widthq]
+    vmovdqu16 m1{k2}{z}, [uq+widthq]
+    vmovdqu16 m10{k2}{z}, [vq+widthq]
+%else
+    vmovdqu8  ym0{k1}{z}, [yq+2*widthq]
+    vmovdqu8  xm1{k2}{z}, [uq+widthq]
+    vmovdqu8  xm10{k2}{z}, [vq+widthq]
+    vpmovzxbw m0, ym0
+    vpmovzxbw m1, ym1
+    vpmovzxbw m10, ym10
+%endif
+    vpermw    m0, m8, m0
+    vpermt2w  m1, m9, m10
+    CLIPW   m0, m2, m3
+    CLIPW   m1, m2, m3
+%if %1 == 8
+    psllw   m0, 2
+    psllw   m1, 2
+%endif
+
+    pmullw  m0, m4
+    pshufb  m0, m5
+
+    pmullw  m1, m6
+    pshufb  m1, m7
+
+    por     m0, m1
+
+    movu    [dstq], m0
+
+    add     dstq, mmsize
+%if %1 == 10
+    add     widthq, 24
+%else
+    add     widthq, 12
+%endif
+    jl .loop
+
+    RET
+%endmacro
+
+INIT_ZMM avx512
+planar_to_v210_avx512 10
+planar_to_v210_avx512 8
+%endif
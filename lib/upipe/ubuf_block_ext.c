@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats with external storage
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/upool.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/ubuf_block_ext.h>
+#include <upipe/uref.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <assert.h>
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with a reference to the owner of the memory. */
+struct ubuf_block_ext {
+    /** reference to the owner of the memory */
+    struct urefcount *refcount;
+
+    /** common block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_ext, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_ext_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ubuf manager for regular block allocations */
+    struct ubuf_mgr *ubuf_mgr;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(ubuf_block_ext_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_ext_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(ubuf_block_ext_mgr, upool, ubuf_pool, ubuf_pool)
+
+/** @This allocates a ubuf pointing to external memory, or forwards regular
+ * block allocations.
+ *
+ * @param mgr common management structure
+ * @param signature signature of the allocation
+ * @param args optional arguments
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_ext_alloc_ext(struct ubuf_mgr *mgr,
+                                             uint32_t signature, va_list args)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_ubuf_mgr(mgr);
+    if (signature == UBUF_ALLOC_BLOCK) {
+        int size = va_arg(args, int);
+        if (unlikely(block_ext_mgr->ubuf_mgr == NULL))
+            return NULL;
+        return ubuf_block_alloc(block_ext_mgr->ubuf_mgr, size);
+    }
+    if (unlikely(signature != UBUF_BLOCK_EXT_ALLOC))
+        return NULL;
+
+    uint8_t *buffer = va_arg(args, uint8_t *);
+    int size = va_arg(args, int);
+    struct urefcount *refcount = va_arg(args, struct urefcount *);
+    if (unlikely(buffer == NULL || size < 0))
+        return NULL;
+
+    struct ubuf_block_ext *block_ext =
+        upool_alloc(&block_ext_mgr->ubuf_pool, struct ubuf_block_ext *);
+    if (unlikely(block_ext == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_ext_to_ubuf(block_ext);
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set(ubuf, 0, size);
+    ubuf_block_common_set_buffer(ubuf, buffer);
+    block_ext->refcount = urefcount_use(refcount);
+    return ubuf;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space,
+ * or a part of it.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer, or -1 for a plain duplicate
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_ext_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                              int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_ext *new_block =
+        upool_alloc(&block_ext_mgr->ubuf_pool, struct ubuf_block_ext *);
+    if (unlikely(new_block == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct ubuf *new_ubuf = ubuf_block_ext_to_ubuf(new_block);
+    ubuf_block_common_init(new_ubuf, false);
+    struct ubuf_block_ext *block_ext = ubuf_block_ext_from_ubuf(ubuf);
+    new_block->refcount = urefcount_use(block_ext->refcount);
+
+    int err = offset < 0 ? ubuf_block_common_dup(ubuf, new_ubuf) :
+              ubuf_block_common_splice(ubuf, new_ubuf, offset, size);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This checks whether there is only one reference to the external memory.
+ *
+ * @param ubuf pointer to ubuf
+ * @return an error code
+ */
+static int ubuf_block_ext_single(struct ubuf *ubuf)
+{
+    struct ubuf_block_ext *block_ext = ubuf_block_ext_from_ubuf(ubuf);
+    return block_ext->refcount != NULL &&
+           urefcount_single(block_ext->refcount) ?
+           UBASE_ERR_NONE : UBASE_ERR_BUSY;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_ext_control(struct ubuf *ubuf, int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_ext_dup(ubuf, new_ubuf_p, -1, 0);
+        }
+        case UBUF_SINGLE:
+            return ubuf_block_ext_single(ubuf);
+
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_ext_dup(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This recycles or frees a ubuf, and releases the external memory.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_ext_free(struct ubuf *ubuf)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_ext *block_ext = ubuf_block_ext_from_ubuf(ubuf);
+
+    ubuf_block_common_clean(ubuf);
+    urefcount_release(block_ext->refcount);
+    upool_free(&block_ext_mgr->ubuf_pool, block_ext);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_ext or NULL in case of allocation error
+ */
+static void *ubuf_block_ext_alloc_inner(struct upool *upool)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_ubuf_pool(upool);
+    struct ubuf_block_ext *block_ext = malloc(sizeof(struct ubuf_block_ext));
+    if (unlikely(block_ext == NULL))
+        return NULL;
+    struct ubuf *ubuf = ubuf_block_ext_to_ubuf(block_ext);
+    ubuf->mgr = ubuf_block_ext_mgr_to_ubuf_mgr(block_ext_mgr);
+    return block_ext;
+}
+
+/** @internal @This frees a ubuf_block_ext.
+ *
+ * @param upool pointer to upool
+ * @param _block_ext pointer to a ubuf_block_ext structure to free
+ */
+static void ubuf_block_ext_free_inner(struct upool *upool, void *_block_ext)
+{
+    struct ubuf_block_ext *block_ext = (struct ubuf_block_ext *)_block_ext;
+    free(block_ext);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_ext_mgr_control(struct ubuf_mgr *mgr,
+                                      int command, va_list args)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_ubuf_mgr(mgr);
+    switch (command) {
+        case UBUF_MGR_CHECK: {
+            struct uref *flow_format = va_arg(args, struct uref *);
+            if (block_ext_mgr->ubuf_mgr == NULL)
+                return UBASE_ERR_INVALID;
+            return ubuf_mgr_check(block_ext_mgr->ubuf_mgr, flow_format);
+        }
+        case UBUF_MGR_VACUUM: {
+            upool_vacuum(&block_ext_mgr->ubuf_pool);
+            if (block_ext_mgr->ubuf_mgr != NULL)
+                ubuf_mgr_vacuum(block_ext_mgr->ubuf_mgr);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_ext_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        ubuf_block_ext_mgr_from_urefcount(urefcount);
+    upool_clean(&block_ext_mgr->ubuf_pool);
+    ubuf_mgr_release(block_ext_mgr->ubuf_mgr);
+
+    urefcount_clean(urefcount);
+    free(block_ext_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * using external storage.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param ubuf_mgr ubuf manager for regular block allocations (may be NULL)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_ext_mgr_alloc(uint16_t ubuf_pool_depth,
+                                          struct ubuf_mgr *ubuf_mgr)
+{
+    struct ubuf_block_ext_mgr *block_ext_mgr =
+        malloc(sizeof(struct ubuf_block_ext_mgr) +
+               upool_sizeof(ubuf_pool_depth));
+    if (unlikely(block_ext_mgr == NULL))
+        return NULL;
+
+    block_ext_mgr->ubuf_mgr = ubuf_mgr_use(ubuf_mgr);
+
+    urefcount_init(ubuf_block_ext_mgr_to_urefcount(block_ext_mgr),
+                   ubuf_block_ext_mgr_free);
+    block_ext_mgr->mgr.refcount =
+        ubuf_block_ext_mgr_to_urefcount(block_ext_mgr);
+    block_ext_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    block_ext_mgr->mgr.ubuf_alloc = ubuf_block_ext_alloc_ext;
+    block_ext_mgr->mgr.ubuf_control = ubuf_block_ext_control;
+    block_ext_mgr->mgr.ubuf_free = ubuf_block_ext_free;
+    block_ext_mgr->mgr.ubuf_mgr_control = ubuf_block_ext_mgr_control;
+
+    upool_init(&block_ext_mgr->ubuf_pool, block_ext_mgr->mgr.refcount,
+               ubuf_pool_depth, block_ext_mgr->upool_extra,
+               ubuf_block_ext_alloc_inner, ubuf_block_ext_free_inner);
+
+    return ubuf_block_ext_mgr_to_ubuf_mgr(block_ext_mgr);
+}
@@ -30,7 +30,10 @@
 
 #include <upipe/ubuf_pic.h>
 
+#include "ubuf_pic_blend.h"
+
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 /** @This clears (part of) the specified plane, depending on plane type
@@ -237,6 +240,130 @@ int ubuf_pic_clear(struct ubuf *ubuf, int hoffset, int voffset,
     return ret ? UBASE_ERR_INVALID : UBASE_ERR_NONE;
 }
 
+/** @internal @This checks whether a plane is made of little-endian samples
+ * of 9 to 12 bits, which are blended per sample.
+ *
+ * @param chroma chroma type (see chroma reference)
+ * @param macropixel_size size of a macropixel in octets
+ * @return true if the plane is blended with 16-bit kernels
+ */
+static bool ubuf_pic_blend_16bit(const char *chroma, uint8_t macropixel_size)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (macropixel_size != 2 || !*chroma)
+        return false;
+    char *end;
+    unsigned long bits = strtoul(chroma + 1, &end, 10);
+    return bits > 8 && bits <= 12 && !strcmp(end, "l");
+#else
+    return false;
+#endif
+}
+
+/** @This blits a picture ubuf to another ubuf.
+ *
+ * @param dest destination ubuf
+ * @param src source ubuf
+ * @param dest_hoffset number of pixels to seek at the beginning of each line of
+ * dest
+ * @param dest_voffset number of lines to seek at the beginning of dest
+ * @param src_hoffset number of pixels to skip at the beginning of each line of
+ * src
+ * @param src_voffset number of lines to skip at the beginning of src
+ * @param extract_hsize horizontal size to copy
+ * @param extract_vsize vertical size to copy
+ * @param alpha_plane pointer to alpha plane buffer, if any
+ * @param alpha_stride horizontal stride of the alpha plane buffer
+ * @param alpha alpha multiplier
+ * @param threshold alpha blending method
+ *    0 means ignore alpha
+ *    255 means blends src and dest together using alpha levels
+ *    Any value in between means using the src pixels if and only if
+ *      their alpha value is more than this value
+ * @return an error code
+ */
+int ubuf_pic_blit_alpha(struct ubuf *dest, struct ubuf *src,
+                        int dest_hoffset, int dest_voffset,
+                        int src_hoffset, int src_voffset,
+                        int extract_hsize, int extract_vsize,
+                        const uint8_t *alpha_plane, int alpha_stride,
+                        const uint8_t alpha, const uint8_t threshold)
+{
+    if (alpha_plane == NULL && alpha < threshold && threshold != 0xff)
+        return UBASE_ERR_NONE; /* nothing to do */
+
+    uint8_t src_macropixel;
+    UBASE_RETURN(ubuf_pic_size(src, NULL, NULL, &src_macropixel))
+    uint8_t dest_macropixel;
+    UBASE_RETURN(ubuf_pic_size(dest, NULL, NULL, &dest_macropixel))
+    if (unlikely(dest_macropixel != src_macropixel))
+        return UBASE_ERR_INVALID;
+
+    const char *chroma;
+    ubuf_pic_foreach_plane(dest, chroma) {
+        size_t src_stride;
+        uint8_t src_hsub, src_vsub, src_macropixel_size;
+        UBASE_RETURN(ubuf_pic_plane_size(src, chroma, &src_stride,
+                    &src_hsub, &src_vsub, &src_macropixel_size))
+
+        size_t dest_stride;
+        uint8_t dest_hsub, dest_vsub, dest_macropixel_size;
+        UBASE_RETURN(ubuf_pic_plane_size(dest, chroma,
+                     &dest_stride, &dest_hsub, &dest_vsub,
+                     &dest_macropixel_size))
+
+        if (unlikely(src_hsub != dest_hsub || src_vsub != dest_vsub ||
+                     src_macropixel_size != dest_macropixel_size))
+            return UBASE_ERR_INVALID;
+
+        uint8_t *dest_buffer;
+        const uint8_t *src_buffer;
+        UBASE_RETURN(ubuf_pic_plane_write(dest, chroma,
+                    dest_hoffset, dest_voffset,
+                    extract_hsize, extract_vsize, &dest_buffer))
+        int err = ubuf_pic_plane_read(src, chroma, src_hoffset, src_voffset,
+                                      extract_hsize, extract_vsize,
+                                      &src_buffer);
+        if (unlikely(!ubase_check(err))) {
+            ubuf_pic_plane_unmap(dest, chroma,
+                                 dest_hoffset, dest_voffset,
+                                 extract_hsize, extract_vsize);
+            return err;
+        }
+
+        int plane_hsize = extract_hsize / src_hsub / src_macropixel *
+                          src_macropixel_size;
+        int plane_vsize = extract_vsize / src_vsub;
+        bool blend_16bit = src_macropixel == 1 &&
+            ubuf_pic_blend_16bit(chroma, src_macropixel_size);
+
+        for (int i = 0; i < plane_vsize; i++) {
+            const uint8_t *alpha_line = alpha_plane == NULL ? NULL :
+                alpha_plane + alpha_stride * (i * src_vsub);
+            if (blend_16bit)
+                ubuf_pic_blend_row16((uint16_t *)dest_buffer,
+                                     (const uint16_t *)src_buffer,
+                                     alpha_line, plane_hsize / 2, src_hsub,
+                                     alpha, threshold);
+            else
+                ubuf_pic_blend_row8(dest_buffer, src_buffer,
+                                    alpha_line, plane_hsize, src_hsub,
+                                    alpha, threshold);
+            dest_buffer += dest_stride;
+            src_buffer += src_stride;
+        }
+
+        err = ubuf_pic_plane_unmap(dest, chroma,
+                                   dest_hoffset, dest_voffset,
+                                   extract_hsize, extract_vsize);
+        UBASE_RETURN(ubuf_pic_plane_unmap(src, chroma,
+                                          src_hoffset, src_voffset,
+                                          extract_hsize, extract_vsize))
+        UBASE_RETURN(err)
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @This converts 8 bits RGB color to 8 bits YUV.
  *
  * @param rgb RGB color to convert
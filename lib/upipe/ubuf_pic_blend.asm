@@ -0,0 +1,349 @@
+;******************************************************************************
+;* Picture alpha blending
+;* Copyright (C) 2026 OpenHeadend S.A.R.L.
+;*
+;* Permission is hereby granted, free of charge, to any person obtaining
+;* a copy of this software and associated documentation files (the
+;* "Software"), to deal in the Software without restriction, including
+;* without limitation the rights to use, copy, modify, merge, publish,
+;* distribute, sublicense, and/or sell copies of the Software, and to
+;* permit persons to whom the Software is furnished to do so, subject
+;* to the following conditions:
+;*
+;* The above copyright notice and this permission notice shall be
+;* included in all copies or substantial portions of the Software.
+;*
+;* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+;* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+;* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+;* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+;* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+;* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+;* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;******************************************************************************
+
+%include "x86util.asm"
+
+SECTION_RODATA 32
+
+pw_1:   times 16 dw 1
+pw_255: times 16 dw 255
+pd_1:   times 8 dd 1
+pd_254: times 8 dd 254
+
+SECTION .text
+
+%if ARCH_X86_64
+
+; words: v = v / 255 for v <= 65534
+%macro DIV255W 2 ; v, tmp
+    psrlw   %2, %1, 8
+    paddw   %1, %2
+    paddw   %1, [pw_1]
+    psrlw   %1, 8
+%endmacro
+
+; dwords: v = v / 255 for v <= 4095 * 255, with one correction step
+%macro DIV255D 3 ; v, tmp, tmp
+    psrld   %2, %1, 8
+    paddd   %2, %1
+    paddd   %2, [pd_1]
+    psrld   %2, 8
+    pslld   %3, %2, 8
+    psubd   %3, %2
+    psubd   %1, %3
+    pcmpgtd %1, [pd_254]
+    psubd   %2, %1
+    mova    %1, %2
+%endmacro
+
+; loads mmsize alpha octets, taking one out of hsub
+%macro LOAD_ALPHA8 3 ; dst, hsub, tmp
+%if %2 == 1
+    movu    %1, [aq]
+%else
+    movu    %1, [aq]
+    movu    %3, [aq + mmsize]
+    pand    %1, [pw_255]
+    pand    %3, [pw_255]
+    packuswb %1, %3
+%if cpuflag(avx2)
+    vpermq  %1, %1, q3120
+%endif
+%endif
+%endmacro
+
+; loads mmsize / 2 alpha octets as words scaled by m6, taking one out of hsub
+%macro LOAD_ALPHA16 3 ; dst, hsub, tmp
+%if %2 == 1
+%if cpuflag(avx2)
+    vpmovzxbw %1, [aq]
+%else
+    movh    %1, [aq]
+    punpcklbw %1, m7
+%endif
+%else
+    movu    %1, [aq]
+    pand    %1, [pw_255]
+%endif
+    pmullw  %1, m6
+    DIV255W %1, %3
+%endmacro
+
+%macro blend_const8 0
+
+; blend_const8(uint8_t *dst, const uint8_t *src, ptrdiff_t w, int alpha)
+cglobal blend_const8, 4, 5, 8, dst, src, w, alpha, i
+    movd    xm6, alphad
+    SPLATW  m6, xm6
+    mova    m5, [pw_255]
+    psubw   m5, m6
+    pxor    m7, m7
+    xor     iq, iq
+
+.loop:
+    movu    m0, [dstq + iq]
+    movu    m2, [srcq + iq]
+    punpckhbw m1, m0, m7
+    punpcklbw m0, m7
+    punpckhbw m3, m2, m7
+    punpcklbw m2, m7
+    pmullw  m0, m5
+    pmullw  m1, m5
+    pmullw  m2, m6
+    pmullw  m3, m6
+    paddw   m0, m2
+    paddw   m1, m3
+    DIV255W m0, m2
+    DIV255W m1, m3
+    packuswb m0, m1
+    movu    [dstq + iq], m0
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop
+    RET
+%endmacro
+
+%macro BLEND_ALPHA8_LOOP 1 ; hsub
+.loop%1:
+    LOAD_ALPHA8 m4, %1, m5
+    punpckhbw m5, m4, m7
+    punpcklbw m4, m7
+    pmullw  m4, m6
+    pmullw  m5, m6
+    DIV255W m4, m0
+    DIV255W m5, m0
+    movu    m0, [dstq + iq]
+    movu    m2, [srcq + iq]
+    punpckhbw m1, m0, m7
+    punpcklbw m0, m7
+    punpckhbw m3, m2, m7
+    punpcklbw m2, m7
+    pmullw  m2, m4
+    pmullw  m3, m5
+    pxor    m4, [pw_255]
+    pxor    m5, [pw_255]
+    pmullw  m0, m4
+    pmullw  m1, m5
+    paddw   m0, m2
+    paddw   m1, m3
+    DIV255W m0, m2
+    DIV255W m1, m3
+    packuswb m0, m1
+    movu    [dstq + iq], m0
+    add     aq, mmsize * %1
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop%1
+    RET
+%endmacro
+
+%macro blend_alpha8 0
+
+; blend_alpha8(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+;              ptrdiff_t w, int hsub, int alpha)
+cglobal blend_alpha8, 6, 7, 8, dst, src, a, w, hsub, alpha, i
+    movd    xm6, alphad
+    SPLATW  m6, xm6
+    pxor    m7, m7
+    xor     iq, iq
+    cmp     hsubd, 1
+    jne     .loop2
+    BLEND_ALPHA8_LOOP 1
+    BLEND_ALPHA8_LOOP 2
+%endmacro
+
+%macro BLEND_THRESHOLD8_LOOP 1 ; hsub
+.loop%1:
+    LOAD_ALPHA8 m0, %1, m1
+    punpckhbw m1, m0, m7
+    punpcklbw m0, m7
+    pmullw  m0, m6
+    pmullw  m1, m6
+    DIV255W m0, m2
+    DIV255W m1, m2
+    packuswb m0, m1
+    pmaxub  m1, m0, m5
+    pcmpeqb m0, m1
+    movu    m2, [srcq + iq]
+    movu    m3, [dstq + iq]
+    pand    m2, m0
+    pandn   m0, m3
+    por     m0, m2
+    movu    [dstq + iq], m0
+    add     aq, mmsize * %1
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop%1
+    RET
+%endmacro
+
+%macro blend_threshold8 0
+
+; blend_threshold8(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+;                  ptrdiff_t w, int hsub, int alpha, int threshold)
+cglobal blend_threshold8, 7, 8, 8, dst, src, a, w, hsub, alpha, threshold, i
+    movd    xm6, alphad
+    SPLATW  m6, xm6
+    ; the source is used if alpha >= threshold + 1 (threshold < 255)
+    inc     thresholdd
+    movd    xm5, thresholdd
+%if cpuflag(avx2)
+    vpbroadcastb m5, xm5
+%else
+    punpcklbw m5, m5
+    SPLATW  m5, m5
+%endif
+    pxor    m7, m7
+    xor     iq, iq
+    cmp     hsubd, 1
+    jne     .loop2
+    BLEND_THRESHOLD8_LOOP 1
+    BLEND_THRESHOLD8_LOOP 2
+%endmacro
+
+%macro blend_const16 0
+
+; blend_const16(uint16_t *dst, const uint16_t *src, ptrdiff_t w, int alpha)
+cglobal blend_const16, 4, 5, 8, dst, src, w, alpha, i
+    ; word pairs (255 - alpha, alpha) for pmaddwd on (dst, src) pairs
+    mov     id, 255
+    sub     id, alphad
+    shl     alphad, 16
+    or      alphad, id
+    movd    xm6, alphad
+%if cpuflag(avx2)
+    vpbroadcastd m6, xm6
+%else
+    pshufd  m6, m6, 0
+%endif
+    add     wq, wq
+    xor     iq, iq
+
+.loop:
+    movu    m0, [dstq + iq]
+    movu    m2, [srcq + iq]
+    punpckhwd m1, m0, m2
+    punpcklwd m0, m2
+    pmaddwd m0, m6
+    pmaddwd m1, m6
+    DIV255D m0, m2, m3
+    DIV255D m1, m2, m3
+    packssdw m0, m1
+    movu    [dstq + iq], m0
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop
+    RET
+%endmacro
+
+%macro BLEND_ALPHA16_LOOP 1 ; hsub
+.loop%1:
+    LOAD_ALPHA16 m2, %1, m3
+    pxor    m3, m2, [pw_255]
+    punpckhwd m4, m3, m2
+    punpcklwd m3, m2
+    movu    m0, [dstq + iq]
+    movu    m2, [srcq + iq]
+    punpckhwd m1, m0, m2
+    punpcklwd m0, m2
+    pmaddwd m0, m3
+    pmaddwd m1, m4
+    DIV255D m0, m2, m3
+    DIV255D m1, m2, m3
+    packssdw m0, m1
+    movu    [dstq + iq], m0
+    add     aq, mmsize / 2 * %1
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop%1
+    RET
+%endmacro
+
+%macro blend_alpha16 0
+
+; blend_alpha16(uint16_t *dst, const uint16_t *src, const uint8_t *a,
+;               ptrdiff_t w, int hsub, int alpha)
+cglobal blend_alpha16, 6, 7, 8, dst, src, a, w, hsub, alpha, i
+    movd    xm6, alphad
+    SPLATW  m6, xm6
+    pxor    m7, m7
+    add     wq, wq
+    xor     iq, iq
+    cmp     hsubd, 1
+    jne     .loop2
+    BLEND_ALPHA16_LOOP 1
+    BLEND_ALPHA16_LOOP 2
+%endmacro
+
+%macro BLEND_THRESHOLD16_LOOP 1 ; hsub
+.loop%1:
+    LOAD_ALPHA16 m0, %1, m1
+    pcmpgtw m0, m5
+    movu    m1, [srcq + iq]
+    movu    m2, [dstq + iq]
+    pand    m1, m0
+    pandn   m0, m2
+    por     m0, m1
+    movu    [dstq + iq], m0
+    add     aq, mmsize / 2 * %1
+    add     iq, mmsize
+    cmp     iq, wq
+    jl      .loop%1
+    RET
+%endmacro
+
+%macro blend_threshold16 0
+
+; blend_threshold16(uint16_t *dst, const uint16_t *src, const uint8_t *a,
+;                   ptrdiff_t w, int hsub, int alpha, int threshold)
+cglobal blend_threshold16, 7, 8, 8, dst, src, a, w, hsub, alpha, threshold, i
+    movd    xm6, alphad
+    SPLATW  m6, xm6
+    movd    xm5, thresholdd
+    SPLATW  m5, xm5
+    pxor    m7, m7
+    add     wq, wq
+    xor     iq, iq
+    cmp     hsubd, 1
+    jne     .loop2
+    BLEND_THRESHOLD16_LOOP 1
+    BLEND_THRESHOLD16_LOOP 2
+%endmacro
+
+INIT_XMM sse2
+blend_const8
+blend_alpha8
+blend_threshold8
+blend_const16
+blend_alpha16
+blend_threshold16
+INIT_YMM avx2
+blend_const8
+blend_alpha8
+blend_threshold8
+blend_const16
+blend_alpha16
+blend_threshold16
+
+%endif
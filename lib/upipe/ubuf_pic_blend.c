@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short alpha blending kernels for picture buffers
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "ubuf_pic_blend.h"
+
+/** @internal @This scales an alpha value by a multiplier. */
+#define UPIPE_BLEND_SCALE(a, alpha) ((unsigned)(a) * (alpha) / 0xff)
+
+/** @internal @This blends two samples. */
+#define UPIPE_BLEND(d, s, a) \
+    (((unsigned)(d) * (0xff - (a)) + (unsigned)(s) * (a)) / 0xff)
+
+/** @internal @This defines the C kernels for a sample type. */
+#define UPIPE_BLEND_TEMPLATE(bits, type)                                    \
+void upipe_blend_const##bits##_c(type *dst, const type *src,                \
+                                 ptrdiff_t w, int alpha)                    \
+{                                                                           \
+    for (ptrdiff_t j = 0; j < w; j++)                                       \
+        dst[j] = UPIPE_BLEND(dst[j], src[j], alpha);                        \
+}                                                                           \
+                                                                            \
+void upipe_blend_alpha##bits##_c(type *dst, const type *src,                \
+                                 const uint8_t *a, ptrdiff_t w, int hsub,   \
+                                 int alpha)                                 \
+{                                                                           \
+    for (ptrdiff_t j = 0; j < w; j++) {                                     \
+        unsigned int sa = UPIPE_BLEND_SCALE(a[j * hsub], alpha);            \
+        dst[j] = UPIPE_BLEND(dst[j], src[j], sa);                           \
+    }                                                                       \
+}                                                                           \
+                                                                            \
+void upipe_blend_threshold##bits##_c(type *dst, const type *src,            \
+                                     const uint8_t *a, ptrdiff_t w,         \
+                                     int hsub, int alpha, int threshold)    \
+{                                                                           \
+    for (ptrdiff_t j = 0; j < w; j++)                                       \
+        if (UPIPE_BLEND_SCALE(a[j * hsub], alpha) > (unsigned)threshold)    \
+            dst[j] = src[j];                                                \
+}
+
+UPIPE_BLEND_TEMPLATE(8, uint8_t)
+UPIPE_BLEND_TEMPLATE(16, uint16_t)
+
+#undef UPIPE_BLEND_TEMPLATE
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+/** @internal @This is the set of SIMD kernels used by the row functions. */
+static struct {
+    void (*const8)(uint8_t *, const uint8_t *, ptrdiff_t, int);
+    void (*alpha8)(uint8_t *, const uint8_t *, const uint8_t *, ptrdiff_t,
+                   int, int);
+    void (*threshold8)(uint8_t *, const uint8_t *, const uint8_t *,
+                       ptrdiff_t, int, int, int);
+    void (*const16)(uint16_t *, const uint16_t *, ptrdiff_t, int);
+    void (*alpha16)(uint16_t *, const uint16_t *, const uint8_t *, ptrdiff_t,
+                    int, int);
+    void (*threshold16)(uint16_t *, const uint16_t *, const uint8_t *,
+                        ptrdiff_t, int, int, int);
+} upipe_blend_simd = {
+    .const8 = upipe_blend_const8_sse2,
+    .alpha8 = upipe_blend_alpha8_sse2,
+    .threshold8 = upipe_blend_threshold8_sse2,
+    .const16 = upipe_blend_const16_sse2,
+    .alpha16 = upipe_blend_alpha16_sse2,
+    .threshold16 = upipe_blend_threshold16_sse2,
+};
+
+/** @internal @This selects the SIMD kernels once, when the library is
+ * loaded. */
+static void __attribute__((constructor)) upipe_blend_simd_init(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        upipe_blend_simd.const8 = upipe_blend_const8_avx2;
+        upipe_blend_simd.alpha8 = upipe_blend_alpha8_avx2;
+        upipe_blend_simd.threshold8 = upipe_blend_threshold8_avx2;
+        upipe_blend_simd.const16 = upipe_blend_const16_avx2;
+        upipe_blend_simd.alpha16 = upipe_blend_alpha16_avx2;
+        upipe_blend_simd.threshold16 = upipe_blend_threshold16_avx2;
+    }
+}
+
+/** @internal @This returns the selected version of a kernel. */
+#define UPIPE_BLEND_SIMD(name) upipe_blend_simd.name
+#endif
+
+/** @internal @This defines the row blending function for a sample type.
+ * The SIMD kernels process the aligned part of the row, and the C kernels
+ * the remaining samples.
+ */
+#define UPIPE_BLEND_ROW_TEMPLATE(bits, type)                                \
+void ubuf_pic_blend_row##bits(type *dst, const type *src,                   \
+                              const uint8_t *alpha_plane, ptrdiff_t w,      \
+                              int hsub, uint8_t alpha, uint8_t threshold)   \
+{                                                                           \
+    if ((alpha_plane == NULL && alpha == 0xff) || threshold == 0) {         \
+        memcpy(dst, src, w * sizeof(type));                                 \
+        return;                                                             \
+    }                                                                       \
+                                                                            \
+    ptrdiff_t done = 0;                                                     \
+    UPIPE_BLEND_ROW_SIMD(bits)                                              \
+                                                                            \
+    dst += done;                                                            \
+    src += done;                                                            \
+    w -= done;                                                              \
+    if (alpha_plane == NULL)                                                \
+        upipe_blend_const##bits##_c(dst, src, w, alpha);                    \
+    else if (threshold != 0xff)                                             \
+        upipe_blend_threshold##bits##_c(dst, src, alpha_plane + done * hsub,\
+                                        w, hsub, alpha, threshold);         \
+    else                                                                    \
+        upipe_blend_alpha##bits##_c(dst, src, alpha_plane + done * hsub,    \
+                                    w, hsub, alpha);                        \
+}
+
+#ifdef UPIPE_BLEND_SIMD
+#define UPIPE_BLEND_ROW_SIMD(bits)                                          \
+    if ((alpha_plane == NULL || hsub <= 2) && w >= UPIPE_BLEND_ALIGN) {     \
+        done = w & ~(ptrdiff_t)(UPIPE_BLEND_ALIGN - 1);                     \
+        if (alpha_plane == NULL)                                            \
+            UPIPE_BLEND_SIMD(const##bits)(dst, src, done, alpha);           \
+        else if (threshold != 0xff)                                         \
+            UPIPE_BLEND_SIMD(threshold##bits)(dst, src,                     \
+                    alpha_plane, done, hsub, alpha, threshold);             \
+        else                                                                \
+            UPIPE_BLEND_SIMD(alpha##bits)(dst, src,                         \
+                    alpha_plane, done, hsub, alpha);                        \
+    }
+#else
+#define UPIPE_BLEND_ROW_SIMD(bits)
+#endif
+
+UPIPE_BLEND_ROW_TEMPLATE(8, uint8_t)
+UPIPE_BLEND_ROW_TEMPLATE(16, uint16_t)
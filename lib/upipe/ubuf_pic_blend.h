@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short alpha blending kernels for picture buffers
+ *
+ * The kernels blend w samples of src into dst. The effective alpha of a
+ * sample is a[j * hsub] * alpha / 255, or alpha if there is no alpha plane.
+ * All divisions by 255 are truncating, so that every implementation gives
+ * bit-exact results. The 16-bit kernels handle little-endian samples of up
+ * to 12 significant bits. The SIMD versions require w to be a multiple of
+ * @ref UPIPE_BLEND_ALIGN and hsub to be 1 or 2, and read w * hsub octets of
+ * the alpha plane.
+ */
+
+#ifndef _UBUF_PIC_BLEND_H_
+/** @hidden */
+#define _UBUF_PIC_BLEND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** alignment of the w parameter of SIMD kernels */
+#define UPIPE_BLEND_ALIGN 32
+
+/** @This blends a row with a constant alpha, or copies it when alpha_plane
+ * is NULL and alpha is 255 or when threshold is 0.
+ *
+ * @param dst destination samples
+ * @param src source samples
+ * @param alpha_plane row of the alpha plane, or NULL
+ * @param w number of samples
+ * @param hsub horizontal subsampling of the plane
+ * @param alpha alpha multiplier
+ * @param threshold alpha blending method (@see ubuf_pic_blit_alpha)
+ */
+void ubuf_pic_blend_row8(uint8_t *dst, const uint8_t *src,
+                         const uint8_t *alpha_plane, ptrdiff_t w,
+                         int hsub, uint8_t alpha, uint8_t threshold);
+
+/** @This is the same as @ref ubuf_pic_blend_row8 for 16-bit samples. */
+void ubuf_pic_blend_row16(uint16_t *dst, const uint16_t *src,
+                          const uint8_t *alpha_plane, ptrdiff_t w,
+                          int hsub, uint8_t alpha, uint8_t threshold);
+
+void upipe_blend_const8_c(uint8_t *dst, const uint8_t *src,
+                          ptrdiff_t w, int alpha);
+void upipe_blend_alpha8_c(uint8_t *dst, const uint8_t *src,
+                          const uint8_t *a, ptrdiff_t w, int hsub, int alpha);
+void upipe_blend_threshold8_c(uint8_t *dst, const uint8_t *src,
+                              const uint8_t *a, ptrdiff_t w, int hsub,
+                              int alpha, int threshold);
+void upipe_blend_const16_c(uint16_t *dst, const uint16_t *src,
+                           ptrdiff_t w, int alpha);
+void upipe_blend_alpha16_c(uint16_t *dst, const uint16_t *src,
+                           const uint8_t *a, ptrdiff_t w, int hsub, int alpha);
+void upipe_blend_threshold16_c(uint16_t *dst, const uint16_t *src,
+                               const uint8_t *a, ptrdiff_t w, int hsub,
+                               int alpha, int threshold);
+
+void upipe_blend_const8_sse2(uint8_t *dst, const uint8_t *src,
+                             ptrdiff_t w, int alpha);
+void upipe_blend_alpha8_sse2(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, ptrdiff_t w, int hsub,
+                             int alpha);
+void upipe_blend_threshold8_sse2(uint8_t *dst, const uint8_t *src,
+                                 const uint8_t *a, ptrdiff_t w, int hsub,
+                                 int alpha, int threshold);
+void upipe_blend_const16_sse2(uint16_t *dst, const uint16_t *src,
+                              ptrdiff_t w, int alpha);
+void upipe_blend_alpha16_sse2(uint16_t *dst, const uint16_t *src,
+                              const uint8_t *a, ptrdiff_t w, int hsub,
+                              int alpha);
+void upipe_blend_threshold16_sse2(uint16_t *dst, const uint16_t *src,
+                                  const uint8_t *a, ptrdiff_t w, int hsub,
+                                  int alpha, int threshold);
+
+void upipe_blend_const8_avx2(uint8_t *dst, const uint8_t *src,
+                             ptrdiff_t w, int alpha);
+void upipe_blend_alpha8_avx2(uint8_t *dst, const uint8_t *src,
+                             const uint8_t *a, ptrdiff_t w, int hsub,
+                             int alpha);
+void upipe_blend_threshold8_avx2(uint8_t *dst, const uint8_t *src,
+                                 const uint8_t *a, ptrdiff_t w, int hsub,
+                                 int alpha, int threshold);
+void upipe_blend_const16_avx2(uint16_t *dst, const uint16_t *src,
+                              ptrdiff_t w, int alpha);
+void upipe_blend_alpha16_avx2(uint16_t *dst, const uint16_t *src,
+                              const uint8_t *a, ptrdiff_t w, int hsub,
+                              int alpha);
+void upipe_blend_threshold16_avx2(uint16_t *dst, const uint16_t *src,
+                                  const uint8_t *a, ptrdiff_t w, int hsub,
+                                  int alpha, int threshold);
+
+#endif
@@ -47,6 +47,11 @@
 #define UDICT_MIN_SIZE 128
 /** default extra space added on udict expansion */
 #define UDICT_EXTRA_SIZE 64
+/** number of slots of the attribute index (power of 2) */
+#define UDICT_INDEX_SIZE 64
+/** maximum number of indexed attributes, beyond which lookups fall back to
+ * walking the attributes */
+#define UDICT_INDEX_MAX 48
 
 /** @internal @This represents a shorthand attribute type. */
 struct inline_shorthand {
@@ -122,9 +127,15 @@ struct udict_inline_mgr {
     struct upool udict_pool;
     /** umem allocator */
     struct umem_mgr *umem_mgr;
+    /** true if new udicts are indexed */
+    bool index;
 
 #ifdef STATS
     uint64_t stats[sizeof(inline_shorthands) / sizeof(struct inline_shorthand)];
+    /** number of index slots probed */
+    uint64_t index_probes;
+    /** number of lookups in udicts which are not indexed */
+    uint64_t index_fallbacks;
 #endif
 
     /** common management structure */
@@ -135,12 +146,28 @@ UBASE_FROM_TO(udict_inline_mgr, udict_mgr, udict_mgr, mgr)
 UBASE_FROM_TO(udict_inline_mgr, urefcount, urefcount, urefcount)
 UBASE_FROM_TO(udict_inline_mgr, upool, udict_pool, udict_pool)
 
+/** @This is the header of the attribute buffer. The buffer is shared by
+ * duplicated udicts, and copied when one of them is modified. */
+struct udict_inline_shared {
+    /** number of udicts sharing the buffer */
+    uatomic_uint32_t refcount;
+    /** used size of the attributes */
+    size_t size;
+
+    /** true if the index is valid */
+    bool indexed;
+    /** number of attributes in the index */
+    uint8_t nb_indexed;
+    /** open-addressing hash table of attribute offsets + 1 (0 if the slot
+     * is empty) */
+    uint16_t index[UDICT_INDEX_SIZE];
+};
+
 /** super-set of the udict structure with additional local members */
 struct udict_inline {
-    /** umem structure pointing to buffer */
+    /** umem structure pointing to the shared header, followed by the
+     * attributes */
     struct umem umem;
-    /** used size */
-    size_t size;
 
     /** common structure */
     struct udict udict;
@@ -148,6 +175,43 @@ struct udict_inline {
 
 UBASE_FROM_TO(udict_inline, udict, udict, udict)
 
+/** @internal @This returns the shared header of a udict.
+ *
+ * @param inl pointer to the udict_inline structure
+ * @return pointer to the shared header
+ */
+static inline struct udict_inline_shared *
+    udict_inline_shared(struct udict_inline *inl)
+{
+    return (struct udict_inline_shared *)umem_buffer(&inl->umem);
+}
+
+/** @internal @This returns the attributes of a udict.
+ *
+ * @param inl pointer to the udict_inline structure
+ * @return pointer to the first attribute
+ */
+static inline uint8_t *udict_inline_buffer(struct udict_inline *inl)
+{
+    return umem_buffer(&inl->umem) + sizeof(struct udict_inline_shared);
+}
+
+/** @internal @This releases a reference to an attribute buffer, and frees it
+ * if it was the last.
+ *
+ * @param umem umem structure pointing to the buffer
+ */
+static void udict_inline_release(struct umem *umem)
+{
+    struct udict_inline_shared *shared =
+        (struct udict_inline_shared *)umem_buffer(umem);
+    if (uatomic_load(&shared->refcount) == 1 ||
+        uatomic_fetch_sub(&shared->refcount, 1) == 1) {
+        uatomic_clean(&shared->refcount);
+        umem_free(umem);
+    }
+}
+
 /** @This allocates a udict with attributes space.
  *
  * @param mgr common management structure
@@ -159,23 +223,33 @@ static struct udict *udict_inline_alloc(struct udict_mgr *mgr, size_t size)
     struct udict_inline_mgr *inline_mgr = udict_inline_mgr_from_udict_mgr(mgr);
     struct udict_inline *inl = upool_alloc(&inline_mgr->udict_pool,
                                            struct udict_inline *);
+    if (unlikely(inl == NULL))
+        return NULL;
     struct udict *udict = udict_inline_to_udict(inl);
 
     if (size < inline_mgr->min_size)
         size = inline_mgr->min_size;
-    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, &inl->umem, size))) {
+    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, &inl->umem,
+                             sizeof(struct udict_inline_shared) + size))) {
         upool_free(&inline_mgr->udict_pool, inl);
         return NULL;
     }
 
-    uint8_t *buffer = umem_buffer(&inl->umem);
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    uatomic_init(&shared->refcount, 1);
+    uint8_t *buffer = udict_inline_buffer(inl);
     buffer[0] = UDICT_TYPE_END;
-    inl->size = 1;
+    shared->size = 1;
+    shared->indexed = inline_mgr->index;
+    shared->nb_indexed = 0;
+    if (shared->indexed)
+        memset(shared->index, 0, sizeof(shared->index));
 
     return udict;
 }
 
-/** @This duplicates a given udict.
+/** @This duplicates a given udict. The attributes are shared until one of
+ * the udicts is modified.
  *
  * @param udict pointer to udict
  * @param new_udict_p reference written with a pointer to the newly allocated
@@ -185,16 +259,48 @@ static struct udict *udict_inline_alloc(struct udict_mgr *mgr, size_t size)
 static int udict_inline_dup(struct udict *udict, struct udict **new_udict_p)
 {
     assert(new_udict_p != NULL);
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
     struct udict_inline *inl = udict_inline_from_udict(udict);
-    struct udict *new_udict = udict_inline_alloc(udict->mgr, inl->size);
-    if (unlikely(new_udict == NULL))
+    struct udict_inline *new_inl = upool_alloc(&inline_mgr->udict_pool,
+                                               struct udict_inline *);
+    if (unlikely(new_inl == NULL))
+        return UBASE_ERR_ALLOC;
+
+    uatomic_fetch_add(&udict_inline_shared(inl)->refcount, 1);
+    new_inl->umem = inl->umem;
+    *new_udict_p = udict_inline_to_udict(new_inl);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This makes sure the attributes of a udict are not shared
+ * before they are modified.
+ *
+ * @param inl pointer to the udict_inline structure
+ * @return an error code
+ */
+static int udict_inline_unshare(struct udict_inline *inl)
+{
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    if (likely(uatomic_load(&shared->refcount) == 1))
+        return UBASE_ERR_NONE;
+
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(inl->udict.mgr);
+    struct umem umem;
+    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, &umem,
+                             umem_size(&inl->umem))))
         return UBASE_ERR_ALLOC;
 
-    *new_udict_p = new_udict;
+    /* offsets are preserved by the copy */
+    struct udict_inline_shared *new_shared =
+        (struct udict_inline_shared *)umem_buffer(&umem);
+    memcpy(new_shared, shared, sizeof(struct udict_inline_shared) +
+                               shared->size);
+    uatomic_init(&new_shared->refcount, 1);
 
-    struct udict_inline *new_inl = udict_inline_from_udict(new_udict);
-    memcpy(umem_buffer(&new_inl->umem), umem_buffer(&inl->umem), inl->size);
-    new_inl->size = inl->size;
+    udict_inline_release(&inl->umem);
+    inl->umem = umem;
     return UBASE_ERR_NONE;
 }
 
@@ -236,6 +342,74 @@ static uint8_t *udict_inline_next(uint8_t *attr)
     return attr + 3 + size;
 }
 
+/** @internal @This computes the index slot of an attribute.
+ *
+ * @param name name of the attribute (ignored for shorthands)
+ * @param type type of the attribute
+ * @return first slot to probe
+ */
+static inline unsigned int udict_inline_hash(const char *name,
+                                             enum udict_type type)
+{
+    uint32_t hash = 2166136261U ^ type;
+    hash *= 16777619U;
+    if (type <= UDICT_TYPE_SHORTHAND) {
+        for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+            hash ^= *p;
+            hash *= 16777619U;
+        }
+    }
+    return (hash ^ (hash >> 16)) & (UDICT_INDEX_SIZE - 1);
+}
+
+/** @internal @This adds an attribute to the index.
+ *
+ * @param inl pointer to the udict_inline structure
+ * @param attr pointer to the attribute
+ */
+static void udict_inline_index_add(struct udict_inline *inl, uint8_t *attr)
+{
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    if (!shared->indexed)
+        return;
+
+    size_t offset = attr - udict_inline_buffer(inl);
+    if (unlikely(offset >= UINT16_MAX ||
+                 shared->nb_indexed >= UDICT_INDEX_MAX)) {
+        /* too large for the index, fall back to walking the attributes */
+        shared->indexed = false;
+        return;
+    }
+
+    unsigned int slot = udict_inline_hash((const char *)(attr + 3), *attr);
+    while (shared->index[slot])
+        slot = (slot + 1) & (UDICT_INDEX_SIZE - 1);
+    shared->index[slot] = offset + 1;
+    shared->nb_indexed++;
+}
+
+/** @internal @This rebuilds the index after attributes were moved.
+ *
+ * @param inl pointer to the udict_inline structure
+ */
+static void udict_inline_index_rebuild(struct udict_inline *inl)
+{
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(inl->udict.mgr);
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    shared->indexed = inline_mgr->index;
+    shared->nb_indexed = 0;
+    if (!shared->indexed)
+        return;
+
+    memset(shared->index, 0, sizeof(shared->index));
+    uint8_t *attr = udict_inline_buffer(inl);
+    while (attr != NULL && *attr != UDICT_TYPE_END && shared->indexed) {
+        udict_inline_index_add(inl, attr);
+        attr = udict_inline_next(attr);
+    }
+}
+
 /** @internal @This finds an attribute (shorthand or not) of the given name
  * and type and returns a pointer to its beginning.
  *
@@ -249,13 +423,34 @@ static uint8_t *udict_inline_find(struct udict *udict, const char *name,
 {
     struct udict_inline *inl = udict_inline_from_udict(udict);
 #ifdef STATS
-    if (type > UDICT_TYPE_SHORTHAND) {
-        struct udict_inline_mgr *inline_mgr =
-            udict_inline_mgr_from_udict_mgr(udict->mgr);
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
+    if (type > UDICT_TYPE_SHORTHAND)
         inline_mgr->stats[type - UDICT_TYPE_SHORTHAND - 1]++;
+#endif
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    uint8_t *attr = udict_inline_buffer(inl);
+
+    if (likely(shared->indexed && type != UDICT_TYPE_END)) {
+        unsigned int slot = udict_inline_hash(name, type);
+        uint16_t offset;
+        while ((offset = shared->index[slot])) {
+#ifdef STATS
+            inline_mgr->index_probes++;
+#endif
+            uint8_t *indexed = attr + offset - 1;
+            if (*indexed == type &&
+                (type > UDICT_TYPE_SHORTHAND ||
+                 !strcmp((const char *)(indexed + 3), name)))
+                return indexed;
+            slot = (slot + 1) & (UDICT_INDEX_SIZE - 1);
+        }
+        return NULL;
     }
+
+#ifdef STATS
+    inline_mgr->index_fallbacks++;
 #endif
-    uint8_t *attr = umem_buffer(&inl->umem);
     while (attr != NULL) {
         if (*attr == type &&
              (type > UDICT_TYPE_SHORTHAND || type == UDICT_TYPE_END ||
@@ -288,7 +483,7 @@ static void udict_inline_iterate(struct udict *udict, const char **name_p,
         if (likely(attr != NULL))
             attr = udict_inline_next(attr);
     } else
-        attr = umem_buffer(&inl->umem);
+        attr = udict_inline_buffer(inl);
     if (unlikely(attr == NULL || *attr == UDICT_TYPE_END)) {
         *type_p = UDICT_TYPE_END;
         return;
@@ -381,9 +576,15 @@ static int udict_inline_delete(struct udict *udict, const char *name,
     if (unlikely(attr == NULL))
         return UBASE_ERR_INVALID;
 
+    size_t offset = attr - udict_inline_buffer(inl);
+    UBASE_RETURN(udict_inline_unshare(inl))
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    attr = udict_inline_buffer(inl) + offset;
+
     uint8_t *end = udict_inline_next(attr);
-    memmove(attr, end, umem_buffer(&inl->umem) + inl->size - end);
-    inl->size -= end - attr;
+    memmove(attr, end, udict_inline_buffer(inl) + shared->size - end);
+    shared->size -= end - attr;
+    udict_inline_index_rebuild(inl);
     return UBASE_ERR_NONE;
 }
 
@@ -409,6 +610,7 @@ static int udict_inline_set(struct udict *udict, const char *name,
             return UBASE_ERR_INVALID;
         base_type = shorthand->base_type;
     }
+    UBASE_RETURN(udict_inline_unshare(inl))
 
     /* check if it already exists */
     size_t current_size;
@@ -444,21 +646,22 @@ static int udict_inline_set(struct udict *udict, const char *name,
     }
 
     /* check total attributes size */
-    attr = umem_buffer(&inl->umem) + inl->size - 1;
-    size_t total_size = (attr - umem_buffer(&inl->umem)) + header_size +
-                        attr_size + 1;
+    struct udict_inline_shared *shared = udict_inline_shared(inl);
+    size_t total_size = sizeof(struct udict_inline_shared) + shared->size +
+                        header_size + attr_size;
     if (unlikely(total_size >= umem_size(&inl->umem))) {
         struct udict_inline_mgr *inline_mgr =
             udict_inline_mgr_from_udict_mgr(udict->mgr);
         if (unlikely(!umem_realloc(&inl->umem, total_size +
                                                inline_mgr->extra_size)))
             return UBASE_ERR_ALLOC;
-
-        attr = umem_buffer(&inl->umem) + inl->size - 1;
+        shared = udict_inline_shared(inl);
     }
+    attr = udict_inline_buffer(inl) + shared->size - 1;
     assert(*attr == UDICT_TYPE_END);
 
     /* write attribute header */
+    uint8_t *header = attr;
     if (unlikely(shorthand == NULL)) {
         assert(namelen + 1 + attr_size <= UINT16_MAX);
         uint16_t size = namelen + 1 + attr_size;
@@ -480,7 +683,8 @@ static int udict_inline_set(struct udict *udict, const char *name,
     attr[attr_size] = UDICT_TYPE_END;
     if (attr_p != NULL)
         *attr_p = attr;
-    inl->size += header_size + attr_size;
+    shared->size += header_size + attr_size;
+    udict_inline_index_add(inl, header);
     return UBASE_ERR_NONE;
 }
 
@@ -566,7 +770,7 @@ static void udict_inline_free(struct udict *udict)
         udict_inline_mgr_from_udict_mgr(udict->mgr);
     struct udict_inline *inl = udict_inline_from_udict(udict);
 
-    umem_free(&inl->umem);
+    udict_inline_release(&inl->umem);
     upool_free(&inline_mgr->udict_pool, inl);
 }
 
@@ -622,6 +826,14 @@ static int udict_inline_mgr_control(struct udict_mgr *mgr,
         case UDICT_MGR_VACUUM:
             udict_inline_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UDICT_INLINE_MGR_SET_INDEX: {
+            UBASE_SIGNATURE_CHECK(args, UDICT_INLINE_SIGNATURE)
+            int index = va_arg(args, int);
+            struct udict_inline_mgr *inline_mgr =
+                udict_inline_mgr_from_udict_mgr(mgr);
+            inline_mgr->index = !!index;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -644,6 +856,8 @@ static void udict_inline_mgr_free(struct urefcount *urefcount)
         udict_inline_name(UDICT_TYPE_SHORTHAND + 1 + i, &name, &base_type);
         printf("%s: %"PRIu64"\n", name, inline_mgr->stats[i]);
     }
+    printf("index probes: %"PRIu64"\n", inline_mgr->index_probes);
+    printf("index fallbacks: %"PRIu64"\n", inline_mgr->index_fallbacks);
 #endif
 
     upool_clean(&inline_mgr->udict_pool);
@@ -688,6 +902,7 @@ struct udict_mgr *udict_inline_mgr_alloc(uint16_t udict_pool_depth,
     inline_mgr->umem_mgr = umem_mgr;
     umem_mgr_use(umem_mgr);
 
+    inline_mgr->index = true;
     inline_mgr->min_size = min_size > 0 ? min_size : UDICT_MIN_SIZE;
     inline_mgr->extra_size = extra_size > 0 ? extra_size : UDICT_EXTRA_SIZE;
 
@@ -696,6 +911,8 @@ struct udict_mgr *udict_inline_mgr_alloc(uint16_t udict_pool_depth,
     for (i = 0; i < sizeof(inline_shorthands) / sizeof(struct inline_shorthand);
          i++)
         inline_mgr->stats[i] = 0;
+    inline_mgr->index_probes = 0;
+    inline_mgr->index_fallbacks = 0;
 #endif
 
     return udict_inline_mgr_to_udict_mgr(inline_mgr);
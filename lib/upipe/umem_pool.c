@@ -25,14 +25,71 @@
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/ulifo.h>
 #include <upipe/umem.h>
 #include <upipe/umem_pool.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
+/** number of per-thread caches (threads beyond that share caches) */
+#define UMEM_POOL_SLOTS 16
+/** maximum number of buffers in a magazine */
+#define UMEM_POOL_MAGAZINE 16
+/** size of a cache line, to avoid false sharing between slots */
+#define UMEM_POOL_CACHE_LINE 64
+/** number of managers for which a thread remembers its number */
+#define UMEM_POOL_THREADS 4
+
+/** @This is a magazine of buffers of the same size, exchanged as a whole
+ * between the per-thread caches and the global depot. */
+struct umem_pool_magazine {
+    /** number of buffers in the magazine */
+    unsigned int count;
+    /** buffers */
+    uint8_t *buffers[];
+};
+
+/** @This is the cache of a thread for a given pool. */
+struct umem_pool_cache {
+    /** magazine currently in use */
+    struct umem_pool_magazine *loaded;
+    /** previous magazine, either full or empty */
+    struct umem_pool_magazine *previous;
+    /** number of buffers the cache may still take in without exceeding
+     * the depth of the pool */
+    unsigned int credit;
+    /** statistics */
+    struct umem_pool_stats stats;
+};
+
+/** @This is the set of caches used by a thread. */
+struct umem_pool_slot {
+    /** set to 1 when a thread is using the slot */
+    uatomic_uint32_t busy;
+    /** caches, one per pool */
+    struct umem_pool_cache *caches;
+    /** padding */
+    uint8_t pad[UMEM_POOL_CACHE_LINE - sizeof(uatomic_uint32_t) -
+                sizeof(struct umem_pool_cache *)];
+};
+
+/** @This is the global depot of a pool. */
+struct umem_pool_depot {
+    /** number of buffers in a magazine (0 disables the pool) */
+    unsigned int magazine_size;
+    /** number of buffers the pool may still take in, either in the caches
+     * or in the depot */
+    uatomic_uint32_t room;
+    /** full magazines */
+    struct ulifo full;
+    /** empty magazines */
+    struct ulifo empty;
+};
+
 /** @This defines the private data structures of the umem pool manager. */
 struct umem_pool_mgr {
     /** refcount management structure */
@@ -45,13 +102,28 @@ struct umem_pool_mgr {
     size_t pool0_size;
     /** number of pools of buffers */
     size_t nb_pools;
+    /** number of threads which have used the manager */
+    uatomic_uint32_t nb_threads;
+    /** per-thread caches */
+    struct umem_pool_slot slots[UMEM_POOL_SLOTS];
     /** buffer pools */
-    struct ulifo pools[];
+    struct umem_pool_depot pools[];
 };
 
 UBASE_FROM_TO(umem_pool_mgr, umem_mgr, umem_mgr, mgr)
 UBASE_FROM_TO(umem_pool_mgr, urefcount, urefcount, urefcount)
 
+/** @This is the number given to the current thread by a manager. */
+struct umem_pool_thread {
+    /** manager which gave the number (never dereferenced) */
+    const struct umem_pool_mgr *mgr;
+    /** number of the thread, starting at 1 */
+    unsigned int id;
+};
+
+/** numbers of the current thread in the last managers it used */
+static __thread struct umem_pool_thread umem_pool_threads[UMEM_POOL_THREADS];
+
 /** @internal @This returns the nearest bigger size to allocate for a umem of
  * the given size to fit into and returns the index of the appropriate pool.
  *
@@ -75,6 +147,267 @@ static unsigned int umem_pool_find(struct umem_mgr *mgr, size_t wanted,
     return pool;
 }
 
+/** @internal @This grabs the slot of the current thread. If it is in use by
+ * another thread, the other slots are tried.
+ *
+ * @param pool_mgr pointer to umem pool manager
+ * @return pointer to the slot, or NULL if none is available
+ */
+static struct umem_pool_slot *umem_pool_slot_lock(
+        struct umem_pool_mgr *pool_mgr)
+{
+    /* the number is only a hint of the first slot to try, so a stale entry
+     * left by a released manager at the same address is harmless */
+    struct umem_pool_thread *thread =
+        &umem_pool_threads[((uintptr_t)pool_mgr / UMEM_POOL_CACHE_LINE) %
+                           UMEM_POOL_THREADS];
+    if (unlikely(thread->mgr != pool_mgr)) {
+        thread->mgr = pool_mgr;
+        thread->id = uatomic_fetch_add(&pool_mgr->nb_threads, 1) + 1;
+    }
+
+    unsigned int first = (thread->id - 1) % UMEM_POOL_SLOTS;
+    for (unsigned int i = 0; i < UMEM_POOL_SLOTS; i++) {
+        struct umem_pool_slot *slot =
+            &pool_mgr->slots[(first + i) % UMEM_POOL_SLOTS];
+        uint32_t expected = 0;
+        if (likely(uatomic_compare_exchange(&slot->busy, &expected, 1)))
+            return slot;
+    }
+    return NULL;
+}
+
+/** @internal @This waits for a slot to be available and grabs it.
+ *
+ * @param slot pointer to slot
+ */
+static void umem_pool_slot_wait(struct umem_pool_slot *slot)
+{
+    uint32_t expected = 0;
+    while (!uatomic_compare_exchange(&slot->busy, &expected, 1))
+        expected = 0;
+}
+
+/** @internal @This releases a slot.
+ *
+ * @param slot pointer to slot
+ */
+static void umem_pool_slot_unlock(struct umem_pool_slot *slot)
+{
+    uatomic_store(&slot->busy, 0);
+}
+
+/** @internal @This returns the cache of a slot for a pool, allocating the
+ * magazines if needed.
+ *
+ * @param pool_mgr pointer to umem pool manager
+ * @param slot locked slot
+ * @param pool index of the pool
+ * @return pointer to cache, or NULL in case of allocation error
+ */
+static struct umem_pool_cache *umem_pool_cache_get(
+        struct umem_pool_mgr *pool_mgr, struct umem_pool_slot *slot,
+        unsigned int pool)
+{
+    if (unlikely(slot->caches == NULL)) {
+        slot->caches = calloc(pool_mgr->nb_pools,
+                              sizeof(struct umem_pool_cache));
+        if (unlikely(slot->caches == NULL))
+            return NULL;
+    }
+
+    struct umem_pool_cache *cache = &slot->caches[pool];
+    if (unlikely(cache->loaded == NULL)) {
+        size_t size = sizeof(struct umem_pool_magazine) +
+            pool_mgr->pools[pool].magazine_size * sizeof(uint8_t *);
+        cache->loaded = malloc(size);
+        cache->previous = malloc(size);
+        if (unlikely(cache->loaded == NULL || cache->previous == NULL)) {
+            free(cache->loaded);
+            free(cache->previous);
+            cache->loaded = cache->previous = NULL;
+            return NULL;
+        }
+        cache->loaded->count = cache->previous->count = 0;
+    }
+    return cache;
+}
+
+/** @internal @This reserves room in the pool for the buffers given back to
+ * a cache, so that the caches and the depot never hold more buffers than
+ * the depth of the pool.
+ *
+ * @param depot pointer to the depot of the pool
+ * @param cache locked cache
+ * @return false if the pool is full
+ */
+static bool umem_pool_cache_reserve(struct umem_pool_depot *depot,
+                                    struct umem_pool_cache *cache)
+{
+    if (likely(cache->credit))
+        return true;
+
+    uint32_t room = uatomic_load(&depot->room);
+    uint32_t wanted;
+    do {
+        wanted = room < depot->magazine_size ? room : depot->magazine_size;
+        if (!wanted)
+            return false;
+    } while (!uatomic_compare_exchange(&depot->room, &room, room - wanted));
+    cache->credit = wanted;
+    return true;
+}
+
+/** @internal @This gives room back to the pool when buffers leave it, and
+ * gives the excess of the cache back to the other threads.
+ *
+ * @param depot pointer to the depot of the pool
+ * @param cache locked cache
+ * @param nb number of buffers which left the pool
+ */
+static void umem_pool_cache_unreserve(struct umem_pool_depot *depot,
+                                      struct umem_pool_cache *cache,
+                                      unsigned int nb)
+{
+    cache->credit += nb;
+    if (unlikely(cache->credit > 2 * depot->magazine_size)) {
+        uatomic_fetch_add(&depot->room,
+                          cache->credit - depot->magazine_size);
+        cache->credit = depot->magazine_size;
+    }
+}
+
+/** @internal @This frees the buffers of a magazine.
+ *
+ * @param magazine pointer to magazine
+ */
+static void umem_pool_magazine_empty(struct umem_pool_magazine *magazine)
+{
+    for (unsigned int i = 0; i < magazine->count; i++)
+        free(magazine->buffers[i]);
+    magazine->count = 0;
+}
+
+/** @internal @This takes a buffer from the cache of the current thread,
+ * exchanging magazines with the depot if needed.
+ *
+ * @param pool_mgr pointer to umem pool manager
+ * @param pool index of the pool
+ * @return pointer to buffer, or NULL if the pool is empty
+ */
+static uint8_t *umem_pool_cache_pop(struct umem_pool_mgr *pool_mgr,
+                                    unsigned int pool)
+{
+    struct umem_pool_depot *depot = &pool_mgr->pools[pool];
+    if (unlikely(!depot->magazine_size))
+        return NULL;
+
+    struct umem_pool_slot *slot = umem_pool_slot_lock(pool_mgr);
+    if (unlikely(slot == NULL))
+        return NULL;
+
+    uint8_t *buffer = NULL;
+    struct umem_pool_cache *cache = umem_pool_cache_get(pool_mgr, slot, pool);
+    if (unlikely(cache == NULL))
+        goto umem_pool_cache_pop_end;
+
+    if (likely(cache->loaded->count)) {
+        cache->stats.hits++;
+    } else if (cache->previous->count) {
+        struct umem_pool_magazine *magazine = cache->loaded;
+        cache->loaded = cache->previous;
+        cache->previous = magazine;
+        cache->stats.hits++;
+    } else {
+        struct umem_pool_magazine *magazine =
+            ulifo_pop(&depot->full, struct umem_pool_magazine *);
+        if (magazine == NULL) {
+            cache->stats.misses++;
+            goto umem_pool_cache_pop_end;
+        }
+        if (!ulifo_push(&depot->empty, cache->previous))
+            free(cache->previous);
+        cache->previous = cache->loaded;
+        cache->loaded = magazine;
+        cache->stats.depot_hits++;
+    }
+    buffer = cache->loaded->buffers[--cache->loaded->count];
+    umem_pool_cache_unreserve(depot, cache, 1);
+
+umem_pool_cache_pop_end:
+    umem_pool_slot_unlock(slot);
+    return buffer;
+}
+
+/** @internal @This gives a buffer back to the cache of the current thread,
+ * exchanging magazines with the depot if needed.
+ *
+ * @param pool_mgr pointer to umem pool manager
+ * @param pool index of the pool
+ * @param buffer pointer to buffer
+ * @return false if the buffer couldn't be kept
+ */
+static bool umem_pool_cache_push(struct umem_pool_mgr *pool_mgr,
+                                 unsigned int pool, uint8_t *buffer)
+{
+    struct umem_pool_depot *depot = &pool_mgr->pools[pool];
+    if (unlikely(!depot->magazine_size))
+        return false;
+
+    struct umem_pool_slot *slot = umem_pool_slot_lock(pool_mgr);
+    if (unlikely(slot == NULL))
+        return false;
+
+    bool ret = false;
+    struct umem_pool_cache *cache = umem_pool_cache_get(pool_mgr, slot, pool);
+    if (unlikely(cache == NULL))
+        goto umem_pool_cache_push_end;
+
+    if (unlikely(!umem_pool_cache_reserve(depot, cache))) {
+        cache->stats.releases++;
+        goto umem_pool_cache_push_end;
+    }
+
+    if (unlikely(cache->loaded->count >= depot->magazine_size)) {
+        if (!cache->previous->count) {
+            struct umem_pool_magazine *magazine = cache->loaded;
+            cache->loaded = cache->previous;
+            cache->previous = magazine;
+        } else {
+            struct umem_pool_magazine *magazine =
+                ulifo_pop(&depot->empty, struct umem_pool_magazine *);
+            if (magazine == NULL) {
+                magazine = malloc(sizeof(struct umem_pool_magazine) +
+                                  depot->magazine_size * sizeof(uint8_t *));
+                if (unlikely(magazine == NULL)) {
+                    cache->stats.releases++;
+                    goto umem_pool_cache_push_end;
+                }
+            }
+            magazine->count = 0;
+
+            if (!ulifo_push(&depot->full, cache->previous)) {
+                /* depot is full, recycle the previous magazine */
+                unsigned int count = cache->previous->count;
+                cache->stats.releases += count;
+                umem_pool_magazine_empty(cache->previous);
+                umem_pool_cache_unreserve(depot, cache, count);
+                free(magazine);
+                magazine = cache->previous;
+            }
+            cache->previous = cache->loaded;
+            cache->loaded = magazine;
+        }
+    }
+    cache->loaded->buffers[cache->loaded->count++] = buffer;
+    cache->credit--;
+    ret = true;
+
+umem_pool_cache_push_end:
+    umem_pool_slot_unlock(slot);
+    return ret;
+}
+
 /** @This allocates a new umem buffer space.
  *
  * @param mgr management structure
@@ -92,7 +425,7 @@ static bool umem_pool_alloc(struct umem_mgr *mgr, struct umem *umem,
     uint8_t *buffer = NULL;
 
     if (likely(pool < pool_mgr->nb_pools))
-        buffer = ulifo_pop(&pool_mgr->pools[pool], uint8_t *);
+        buffer = umem_pool_cache_pop(pool_mgr, pool);
     if (unlikely(buffer == NULL))
         buffer = malloc(real_size);
     if (unlikely(buffer == NULL))
@@ -118,7 +451,7 @@ static void umem_pool_free(struct umem *umem)
     unsigned int pool = umem_pool_find(umem->mgr, umem->real_size, NULL);
 
     if (unlikely(pool >= pool_mgr->nb_pools ||
-                 !ulifo_push(&pool_mgr->pools[pool], umem->buffer)))
+                 !umem_pool_cache_push(pool_mgr, pool, umem->buffer)))
         free(umem->buffer);
     umem->buffer = NULL;
     umem->mgr = NULL;
@@ -158,10 +491,39 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 {
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
 
+    for (unsigned int i = 0; i < UMEM_POOL_SLOTS; i++) {
+        struct umem_pool_slot *slot = &pool_mgr->slots[i];
+        umem_pool_slot_wait(slot);
+        if (slot->caches != NULL)
+            for (unsigned int j = 0; j < pool_mgr->nb_pools; j++) {
+                struct umem_pool_cache *cache = &slot->caches[j];
+                if (cache->loaded == NULL)
+                    continue;
+                uatomic_fetch_add(&pool_mgr->pools[j].room,
+                                  cache->loaded->count +
+                                  cache->previous->count + cache->credit);
+                cache->credit = 0;
+                umem_pool_magazine_empty(cache->loaded);
+                umem_pool_magazine_empty(cache->previous);
+                free(cache->loaded);
+                free(cache->previous);
+                cache->loaded = cache->previous = NULL;
+            }
+        umem_pool_slot_unlock(slot);
+    }
+
     for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
-        uint8_t *buffer;
-        while ((buffer = ulifo_pop(&pool_mgr->pools[i], uint8_t *)) != NULL)
-            free(buffer);
+        struct umem_pool_depot *depot = &pool_mgr->pools[i];
+        struct umem_pool_magazine *magazine;
+        while ((magazine = ulifo_pop(&depot->full,
+                                     struct umem_pool_magazine *)) != NULL) {
+            uatomic_fetch_add(&depot->room, magazine->count);
+            umem_pool_magazine_empty(magazine);
+            free(magazine);
+        }
+        while ((magazine = ulifo_pop(&depot->empty,
+                                     struct umem_pool_magazine *)) != NULL)
+            free(magazine);
     }
 }
 
@@ -174,16 +536,62 @@ static void umem_pool_mgr_free(struct urefcount *urefcount)
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_urefcount(urefcount);
     umem_pool_mgr_vacuum(umem_pool_mgr_to_umem_mgr(pool_mgr));
 
-    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
-        ulifo_clean(&pool_mgr->pools[i]);
+    for (unsigned int i = 0; i < UMEM_POOL_SLOTS; i++) {
+        free(pool_mgr->slots[i].caches);
+        uatomic_clean(&pool_mgr->slots[i].busy);
+    }
+    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
+        ulifo_clean(&pool_mgr->pools[i].full);
+        ulifo_clean(&pool_mgr->pools[i].empty);
+        uatomic_clean(&pool_mgr->pools[i].room);
+    }
+    uatomic_clean(&pool_mgr->nb_threads);
 
     urefcount_clean(urefcount);
     free(pool_mgr);
 }
 
+/** @This returns the statistics of a pool, summed over all threads.
+ *
+ * @param mgr pointer to a umem pool manager
+ * @param pool index of the pool
+ * @param size_p filled in with the size of the buffers of the pool (may be
+ * NULL)
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+int umem_pool_mgr_get_stats(struct umem_mgr *mgr, unsigned int pool,
+                            size_t *size_p, struct umem_pool_stats *stats)
+{
+    struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
+    if (unlikely(pool >= pool_mgr->nb_pools))
+        return UBASE_ERR_INVALID;
+
+    if (size_p != NULL)
+        *size_p = pool_mgr->pool0_size << pool;
+    memset(stats, 0, sizeof(*stats));
+    for (unsigned int i = 0; i < UMEM_POOL_SLOTS; i++) {
+        struct umem_pool_slot *slot = &pool_mgr->slots[i];
+        umem_pool_slot_wait(slot);
+        if (slot->caches != NULL) {
+            struct umem_pool_stats *slot_stats = &slot->caches[pool].stats;
+            stats->hits += slot_stats->hits;
+            stats->depot_hits += slot_stats->depot_hits;
+            stats->misses += slot_stats->misses;
+            stats->releases += slot_stats->releases;
+        }
+        umem_pool_slot_unlock(slot);
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's.
  *
+ * Each thread keeps magazines of buffers of each pool, and exchanges full
+ * and empty magazines with a global depot, so that buffers allocated in a
+ * thread and freed in another do not require an atomic operation each.
+ *
  * @param pool0_size size (in octets) of the smallest allocatable buffer; it
  * must be a power of 2
  * @param nb_pools number of buffer pools to maintain, with sizes in power of
@@ -195,14 +603,24 @@ static void umem_pool_mgr_free(struct urefcount *urefcount)
 struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
 {
     size_t alloc_size = sizeof(struct umem_pool_mgr) +
-                        sizeof(struct ulifo) * nb_pools;
-    unsigned int pools_depths[nb_pools];
+                        sizeof(struct umem_pool_depot) * nb_pools;
+    unsigned int magazine_sizes[nb_pools];
+    unsigned int depot_depths[nb_pools];
+    unsigned int pool_depths[nb_pools];
     va_list args;
     va_start(args, nb_pools);
     for (unsigned int i = 0; i < nb_pools; i++) {
-        pools_depths[i] = va_arg(args, unsigned int);
-        assert(pools_depths[i] <= UINT16_MAX);
-        alloc_size += ulifo_sizeof(pools_depths[i]);
+        unsigned int pool_depth = va_arg(args, unsigned int);
+        assert(pool_depth <= UINT16_MAX);
+        pool_depths[i] = pool_depth;
+        magazine_sizes[i] = pool_depth / 4;
+        if (magazine_sizes[i] > UMEM_POOL_MAGAZINE)
+            magazine_sizes[i] = UMEM_POOL_MAGAZINE;
+        else if (!magazine_sizes[i])
+            magazine_sizes[i] = pool_depth;
+        depot_depths[i] = magazine_sizes[i] ?
+                          pool_depth / magazine_sizes[i] : 0;
+        alloc_size += 2 * ulifo_sizeof(depot_depths[i]);
     }
     va_end(args);
 
@@ -212,13 +630,23 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
 
     pool_mgr->pool0_size = pool0_size;
     pool_mgr->nb_pools = nb_pools;
+    uatomic_init(&pool_mgr->nb_threads, 0);
+    for (unsigned int i = 0; i < UMEM_POOL_SLOTS; i++) {
+        uatomic_init(&pool_mgr->slots[i].busy, 0);
+        pool_mgr->slots[i].caches = NULL;
+    }
 
     void *extra = (void *)pool_mgr + sizeof(struct umem_pool_mgr) +
-                  sizeof(struct ulifo) * nb_pools;
+                  sizeof(struct umem_pool_depot) * nb_pools;
 
     for (unsigned int i = 0; i < nb_pools; i++) {
-        ulifo_init(&pool_mgr->pools[i], pools_depths[i], extra);
-        extra += ulifo_sizeof(pools_depths[i]);
+        struct umem_pool_depot *depot = &pool_mgr->pools[i];
+        depot->magazine_size = magazine_sizes[i];
+        uatomic_init(&depot->room, pool_depths[i]);
+        ulifo_init(&depot->full, depot_depths[i], extra);
+        extra += ulifo_sizeof(depot_depths[i]);
+        ulifo_init(&depot->empty, depot_depths[i], extra);
+        extra += ulifo_sizeof(depot_depths[i]);
     }
 
     urefcount_init(umem_pool_mgr_to_urefcount(pool_mgr), umem_pool_mgr_free);
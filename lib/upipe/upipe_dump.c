@@ -33,6 +33,7 @@
 #include <upipe/upipe.h>
 #include <upipe/upipe_dump.h>
 #include <upipe/uprobe_prefix.h>
+#include <upipe/uclock.h>
 
 #include <stdio.h>
 #include <errno.h>
@@ -110,6 +111,24 @@ char *upipe_dump_flow_def_label_default(struct uref *flow_def)
     return string;
 }
 
+/** @internal @This looks up the context of a pipe in the list.
+ *
+ * @param upipe pipe to look up
+ * @param list list of already printed pipes
+ * @return pointer to the context, or NULL if not found
+ */
+static struct upipe_dump_ctx *upipe_dump_lookup(struct upipe *upipe,
+                                                struct uchain *list)
+{
+    struct uchain *uchain;
+    ulist_foreach (list, uchain) {
+        struct upipe_dump_ctx *ctx = upipe_dump_ctx_from_uchain(uchain);
+        if (ctx->upipe == upipe)
+            return ctx;
+    }
+    return NULL;
+}
+
 /** @internal @This finds in the list of a pipe has already been printed.
  *
  * @param upipe first pipe of the pipeline
@@ -118,12 +137,53 @@ char *upipe_dump_flow_def_label_default(struct uref *flow_def)
  */
 static bool upipe_dump_find(struct upipe *upipe, struct uchain *list)
 {
-    struct uchain *uchain;
-    ulist_foreach (list, uchain) {
-        if (upipe_dump_ctx_from_uchain(uchain)->upipe == upipe)
-            return true;
-    }
-    return false;
+    return upipe_dump_lookup(upipe, list) != NULL;
+}
+
+/** @internal @This converts a duration to milliseconds.
+ *
+ * @param duration duration in units of UCLOCK_FREQ
+ * @return duration in milliseconds
+ */
+static double upipe_dump_ms(uint64_t duration)
+{
+    return (double)duration * 1000. / UCLOCK_FREQ;
+}
+
+/** @internal @This appends the statistics of a pipe to its label.
+ *
+ * @param upipe upipe structure
+ * @param label allocated label, freed by this function
+ * @return allocated string
+ */
+static char *upipe_dump_stats_label(struct upipe *upipe, char *label)
+{
+    struct upipe_stats *stats = upipe->stats;
+    if (stats == NULL || label == NULL)
+        return label;
+
+    char *string;
+    int ret = asprintf(&string, "%s\\n"
+            "in: %"PRIu64" urefs, %"PRIu64" bytes\\n"
+            "out: %"PRIu64" urefs, %"PRIu64" bytes\\n"
+            "input: %.3f ms (%.3f ms total)",
+            label, stats->urefs_in, stats->bytes_in,
+            stats->urefs_out, stats->bytes_out,
+            upipe_dump_ms(stats->input_time),
+            upipe_dump_ms(stats->input_time_total));
+    free(label);
+    if (ret == -1)
+        return NULL;
+
+    if (!stats->latency_count)
+        return string;
+
+    label = string;
+    ret = asprintf(&string, "%s\\nlatency: %.3f ms avg, %.3f ms max",
+            label, upipe_dump_ms(stats->latency_total / stats->latency_count),
+            upipe_dump_ms(stats->latency_max));
+    free(label);
+    return ret == -1 ? NULL : string;
 }
 
 /** @internal @This dumps a pipe in dot format.
@@ -144,7 +204,7 @@ static void upipe_dump_pipe(upipe_dump_pipe_label pipe_label,
     if (upipe_dump_find(upipe, list))
         return;
 
-    char *label = pipe_label(upipe);
+    char *label = upipe_dump_stats_label(upipe, pipe_label(upipe));
 
     /* Prepare context. */
     struct upipe_dump_ctx *ctx = malloc(sizeof(struct upipe_dump_ctx));
@@ -310,6 +370,163 @@ void upipe_dump_va(upipe_dump_pipe_label pipe_label,
     assert(!uid);
 }
 
+/** @internal @This collects the pipes of a pipeline, following the same
+ * path as @ref upipe_dump_pipe.
+ *
+ * @param upipe upipe to collect
+ * @param uid_p pointer to unique ID
+ * @param list list of already collected pipes
+ * @param last_output last output pipe of the pipeline
+ */
+static void upipe_dump_collect(struct upipe *upipe, uint64_t *uid_p,
+                               struct uchain *list, struct upipe *last_output)
+{
+    if (upipe_dump_find(upipe, list))
+        return;
+
+    struct upipe_dump_ctx *ctx = malloc(sizeof(struct upipe_dump_ctx));
+    assert(ctx != NULL);
+    ctx->input_uid = ctx->output_uid = (*uid_p)++;
+    ctx->upipe = upipe;
+    ctx->original_opaque = upipe->opaque;
+    ulist_add(list, upipe_dump_ctx_to_uchain(ctx));
+
+    struct upipe *sub = NULL;
+    while (ubase_check(upipe_iterate_sub(upipe, &sub)) && sub != NULL)
+        upipe_dump_collect(sub, uid_p, list, last_output);
+
+    upipe_bin_freeze(upipe);
+    struct upipe *first_inner = NULL;
+    struct upipe *last_inner = NULL;
+    upipe_bin_get_first_inner(upipe, &first_inner);
+    upipe_bin_get_last_inner(upipe, &last_inner);
+    if (first_inner != NULL || last_inner != NULL) {
+        first_inner = first_inner ?: last_inner;
+        last_inner = last_inner ?: first_inner;
+        upipe_dump_collect(first_inner, uid_p, list, last_inner);
+        upipe_dump_collect(last_inner, uid_p, list, last_inner);
+    }
+    upipe_bin_thaw(upipe);
+
+    if (upipe == last_output)
+        return;
+
+    struct upipe *output = NULL;
+    upipe_get_output(upipe, &output);
+    if (output != NULL)
+        upipe_dump_collect(output, uid_p, list, last_output);
+}
+
+/** @internal @This prints a string in JSON format.
+ *
+ * @param file file pointer to write to
+ * @param string string to print, or NULL
+ */
+static void upipe_dump_json_string(FILE *file, const char *string)
+{
+    if (string == NULL) {
+        fprintf(file, "null");
+        return;
+    }
+
+    fputc('"', file);
+    for (const char *p = string; *p; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+/** @This dumps the pipes of a pipeline and their statistics in JSON format.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format
+ * @param args list of sources pipes terminated with NULL
+ */
+void upipe_dump_json_va(upipe_dump_pipe_label pipe_label,
+                        FILE *file, struct uchain *ulist, va_list args)
+{
+    pipe_label = pipe_label ?: upipe_dump_upipe_label_default;
+
+    uint64_t uid = 0;
+    struct uchain list;
+    struct uchain *uchain, *uchain_tmp;
+    ulist_init(&list);
+
+    if (ulist != NULL) {
+        ulist_foreach (ulist, uchain)
+            upipe_dump_collect(upipe_from_uchain(uchain), &uid, &list, NULL);
+    }
+
+    struct upipe *source;
+    while ((source = va_arg(args, struct upipe *)) != NULL)
+        upipe_dump_collect(source, &uid, &list, NULL);
+
+    /* Walk through the super-pipes that we may have forgotten. */
+    uint64_t last_uid;
+    do {
+        last_uid = uid;
+        ulist_foreach (&list, uchain) {
+            struct upipe *upipe = upipe_dump_ctx_from_uchain(uchain)->upipe;
+            struct upipe *super = NULL;
+            while (ubase_check(upipe_sub_get_super(upipe, &upipe)) &&
+                   upipe != NULL)
+                super = upipe;
+            if (super != NULL)
+                upipe_dump_collect(super, &uid, &list, NULL);
+        }
+    } while (last_uid != uid);
+
+    fprintf(file, "{\"pipes\":[");
+    ulist_foreach (&list, uchain) {
+        struct upipe_dump_ctx *ctx = upipe_dump_ctx_from_uchain(uchain);
+        struct upipe *upipe = ctx->upipe;
+
+        char *label = pipe_label(upipe);
+        fprintf(file, "%s\n{\"id\":%"PRIu64",\"label\":",
+                ctx->input_uid ? "," : "", ctx->input_uid);
+        upipe_dump_json_string(file, label);
+        free(label);
+        fprintf(file, ",\"signature\":\"%4.4s\"",
+                (const char *)&upipe->mgr->signature);
+
+        struct upipe *output = NULL;
+        upipe_get_output(upipe, &output);
+        struct upipe_dump_ctx *output_ctx =
+            output != NULL ? upipe_dump_lookup(output, &list) : NULL;
+        if (output_ctx != NULL)
+            fprintf(file, ",\"output\":%"PRIu64, output_ctx->input_uid);
+        else
+            fprintf(file, ",\"output\":null");
+
+        struct upipe_stats *stats = upipe->stats;
+        if (stats == NULL) {
+            fprintf(file, ",\"stats\":null}");
+            continue;
+        }
+        fprintf(file, ",\"stats\":{"
+                "\"urefs_in\":%"PRIu64",\"bytes_in\":%"PRIu64","
+                "\"urefs_out\":%"PRIu64",\"bytes_out\":%"PRIu64","
+                "\"input_time\":%"PRIu64",\"input_time_total\":%"PRIu64","
+                "\"latency_count\":%"PRIu64",\"latency_total\":%"PRIu64","
+                "\"latency_max\":%"PRIu64",\"freq\":%"PRIu64"}}",
+                stats->urefs_in, stats->bytes_in,
+                stats->urefs_out, stats->bytes_out,
+                stats->input_time, stats->input_time_total,
+                stats->latency_count, stats->latency_total,
+                stats->latency_max, (uint64_t)UCLOCK_FREQ);
+    }
+    fprintf(file, "\n]}\n");
+
+    ulist_delete_foreach (&list, uchain, uchain_tmp)
+        free(upipe_dump_ctx_from_uchain(uchain));
+}
 
 /** @This opens a file and dumps a pipeline in dot format.
  *
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe optional per-pipe statistics
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_block.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_stats.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/** time spent in nested input functions, in the current thread */
+static __thread uint64_t upipe_stats_nested = 0;
+
+/** @This enables statistics on a pipe, or resets them if they are already
+ * enabled.
+ *
+ * @param upipe description structure of the pipe
+ * @param uclock clock used for durations, must be the clock of cr_sys dates
+ * for latency to be meaningful
+ * @return an error code
+ */
+int upipe_stats_enable(struct upipe *upipe, struct uclock *uclock)
+{
+    if (unlikely(uclock == NULL))
+        return UBASE_ERR_INVALID;
+
+    struct upipe_stats *stats = upipe->stats;
+    if (stats == NULL) {
+        stats = malloc(sizeof(struct upipe_stats));
+        UBASE_ALLOC_RETURN(stats);
+    } else
+        uclock_release(stats->uclock);
+
+    memset(stats, 0, sizeof(struct upipe_stats));
+    stats->uclock = uclock_use(uclock);
+    upipe->stats = stats;
+    return UBASE_ERR_NONE;
+}
+
+/** @This disables statistics on a pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+void upipe_stats_disable(struct upipe *upipe)
+{
+    struct upipe_stats *stats = upipe->stats;
+    if (stats == NULL)
+        return;
+    upipe->stats = NULL;
+    uclock_release(stats->uclock);
+    free(stats);
+}
+
+/** @internal @This returns the size of the block buffer of a uref.
+ *
+ * @param uref uref structure
+ * @return size in octets, or 0 if the uref doesn't carry a block buffer
+ */
+static uint64_t upipe_stats_bytes(struct uref *uref)
+{
+    size_t size;
+    if (uref->ubuf == NULL || !ubase_check(uref_block_size(uref, &size)))
+        return 0;
+    return size;
+}
+
+/** @internal @This is called by upipe_input when statistics are enabled,
+ * and calls the input function of the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+void upipe_stats_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    /* the input function may disable statistics, keep our own pointer */
+    struct upipe_stats *stats = upipe->stats;
+    struct uclock *uclock = uclock_use(stats->uclock);
+    stats->urefs_in++;
+    stats->bytes_in += upipe_stats_bytes(uref);
+
+    uint64_t now = uclock_now(uclock);
+    uint64_t cr_sys;
+    if (ubase_check(uref_clock_get_cr_sys(uref, &cr_sys)) && now >= cr_sys) {
+        uint64_t latency = now - cr_sys;
+        stats->latency_count++;
+        stats->latency_total += latency;
+        if (latency > stats->latency_max)
+            stats->latency_max = latency;
+    }
+
+    uint64_t nested = upipe_stats_nested;
+    upipe_stats_nested = 0;
+    upipe->mgr->upipe_input(upipe, uref, upump_p);
+    uint64_t duration = uclock_now(uclock) - now;
+
+    if (upipe->stats == stats) {
+        stats->input_time_total += duration;
+        stats->input_time += duration > upipe_stats_nested ?
+                             duration - upipe_stats_nested : 0;
+    }
+    upipe_stats_nested = nested + duration;
+    uclock_release(uclock);
+}
+
+/** @internal @This is called by upipe_helper_output when statistics are
+ * enabled, before a uref is sent to the output.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ */
+void upipe_stats_output(struct upipe *upipe, struct uref *uref)
+{
+    upipe->stats->urefs_out++;
+    upipe->stats->bytes_out += upipe_stats_bytes(uref);
+}
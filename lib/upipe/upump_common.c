@@ -30,10 +30,13 @@
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/upool.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
 #include <upipe/upump_common.h>
 #include <upipe/upump_blocker.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 /** @This stores extra opaque structures for blockers.
  */
@@ -128,10 +131,30 @@ static void upump_common_blocker_free_inner(struct upool *upool,
  */
 void upump_common_init(struct upump *upump)
 {
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_mgr(upump->mgr);
     struct upump_common *common = upump_common_from_upump(upump);
     common->started = false;
     common->status = true;
     ulist_init(&common->blockers);
+    memset(&common->stats, 0, sizeof(common->stats));
+    ulist_add(&common_mgr->upumps, upump_common_to_uchain(common));
+}
+
+/** @internal @This adds a duration to a histogram.
+ *
+ * @param histo histogram
+ * @param duration duration in 27 MHz ticks
+ */
+static void upump_common_histo_add(uint64_t *histo, uint64_t duration)
+{
+    uint64_t us = duration * 1000000 / UCLOCK_FREQ;
+    unsigned int bucket = 0;
+    while (us && bucket < UPUMP_HISTO_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    histo[bucket]++;
 }
 
 /** @This dispatches a pump.
@@ -140,11 +163,56 @@ void upump_common_init(struct upump *upump)
  */
 void upump_common_dispatch(struct upump *upump)
 {
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_mgr(upump->mgr);
     struct urefcount *refcount = urefcount_use(upump->refcount);
+
+    if (likely(common_mgr->uclock == NULL)) {
+        upump->cb(upump);
+        urefcount_release(refcount);
+        return;
+    }
+
+    /* the callback may free the pump, which resets dispatching */
+    struct upump *dispatching = common_mgr->dispatching;
+    common_mgr->dispatching = upump;
+    uint64_t start = uclock_now(common_mgr->uclock);
     upump->cb(upump);
+    uint64_t duration = uclock_now(common_mgr->uclock) - start;
+
+    upump_common_histo_add(common_mgr->stats.callbacks, duration);
+    if (common_mgr->dispatching == upump) {
+        struct upump_common *common = upump_common_from_upump(upump);
+        common->stats.calls++;
+        common->stats.total += duration;
+        if (duration > common->stats.max)
+            common->stats.max = duration;
+    }
+    common_mgr->dispatching = dispatching;
     urefcount_release(refcount);
 }
 
+/** @This dispatches a timer pump, accounting for its lateness.
+ *
+ * @param upump description structure of the pump
+ * @param deadline date at which the timer was due, as returned by
+ * @ref upump_common_mgr_now, or UINT64_MAX if unknown
+ */
+void upump_common_dispatch_timer(struct upump *upump, uint64_t deadline)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_mgr(upump->mgr);
+    if (unlikely(common_mgr->uclock != NULL) && deadline != UINT64_MAX) {
+        uint64_t now = uclock_now(common_mgr->uclock);
+        uint64_t late = now > deadline ? now - deadline : 0;
+        struct upump_common *common = upump_common_from_upump(upump);
+        upump_common_histo_add(common_mgr->stats.timer_lateness, late);
+        if (late > common->stats.late_max)
+            common->stats.late_max = late;
+    }
+    upump_common_dispatch(upump);
+}
+
 /** @This starts a pump if allowed.
  *
  * @param upump description structure of the pump
@@ -227,7 +295,12 @@ void upump_common_set_status(struct upump *upump, int status)
  */
 void upump_common_clean(struct upump *upump)
 {
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_mgr(upump->mgr);
     struct upump_common *common = upump_common_from_upump(upump);
+    ulist_delete(upump_common_to_uchain(common));
+    if (common_mgr->dispatching == upump)
+        common_mgr->dispatching = NULL;
     struct uchain *uchain, *uchain_tmp;
     struct urefcount *refcount = urefcount_use(upump->refcount);
     ulist_delete_foreach (&common->blockers, uchain, uchain_tmp) {
@@ -240,6 +313,28 @@ void upump_common_clean(struct upump *upump)
     urefcount_release(refcount);
 }
 
+/** @This gets the statistics of a pump.
+ *
+ * @param upump description structure of the pump
+ * @param stats filled in with the statistics
+ */
+void upump_common_get_stats(struct upump *upump, struct upump_stats *stats)
+{
+    struct upump_common *common = upump_common_from_upump(upump);
+    *stats = common->stats;
+}
+
+/** @This gets whether a pump is blocked by at least one blocker.
+ *
+ * @param upump description structure of the pump
+ * @param blocked_p filled in with 1 if the pump is blocked, 0 otherwise
+ */
+void upump_common_get_blocked(struct upump *upump, int *blocked_p)
+{
+    struct upump_common *common = upump_common_from_upump(upump);
+    *blocked_p = ulist_empty(&common->blockers) ? 0 : 1;
+}
+
 /** @This returns the extra buffer space needed for pools.
  *
  * @param upump_pool_depth maximum number of upump structures in the pool
@@ -266,6 +361,107 @@ void upump_common_mgr_vacuum(struct upump_mgr *mgr)
     upool_vacuum(&common_mgr->upump_blocker_pool);
 }
 
+/** @This returns the current date of the statistics clock.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @return current date, or UINT64_MAX if statistics are disabled
+ */
+uint64_t upump_common_mgr_now(struct upump_mgr *mgr)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    if (likely(common_mgr->uclock == NULL))
+        return UINT64_MAX;
+    return uclock_now(common_mgr->uclock);
+}
+
+/** @This is called by the event loop when it wakes up, before dispatching
+ * events.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ */
+void upump_common_mgr_wake(struct upump_mgr *mgr)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    common_mgr->wake = upump_common_mgr_now(mgr);
+}
+
+/** @This is called by the event loop before it goes to sleep.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ */
+void upump_common_mgr_sleep(struct upump_mgr *mgr)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    if (common_mgr->uclock == NULL || common_mgr->wake == UINT64_MAX)
+        return;
+    common_mgr->stats.iterations++;
+    upump_common_histo_add(common_mgr->stats.loop_lag,
+                           uclock_now(common_mgr->uclock) - common_mgr->wake);
+    common_mgr->wake = UINT64_MAX;
+}
+
+/** @This enables or disables statistics.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param enabled true to enable statistics
+ * @return an error code
+ */
+int upump_common_mgr_set_stats(struct upump_mgr *mgr, bool enabled)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    uclock_release(common_mgr->uclock);
+    common_mgr->uclock = NULL;
+    common_mgr->wake = UINT64_MAX;
+    if (!enabled)
+        return UBASE_ERR_NONE;
+
+    common_mgr->uclock = uclock_std_alloc(0);
+    UBASE_ALLOC_RETURN(common_mgr->uclock);
+    memset(&common_mgr->stats, 0, sizeof(common_mgr->stats));
+    struct uchain *uchain;
+    ulist_foreach (&common_mgr->upumps, uchain) {
+        struct upump_common *common = upump_common_from_uchain(uchain);
+        memset(&common->stats, 0, sizeof(common->stats));
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @This gets the event loop statistics.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param stats filled in with the statistics
+ */
+void upump_common_mgr_get_stats(struct upump_mgr *mgr,
+                                struct upump_mgr_stats *stats)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    *stats = common_mgr->stats;
+}
+
+/** @This iterates over the allocated pumps.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_common_mgr structure
+ * @param upump_p reference to a pump, initialized with NULL, and set to NULL
+ * at the end
+ */
+void upump_common_mgr_iterate(struct upump_mgr *mgr, struct upump **upump_p)
+{
+    struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
+    struct uchain *uchain = *upump_p == NULL ? &common_mgr->upumps :
+        upump_common_to_uchain(upump_common_from_upump(*upump_p));
+    if (ulist_is_last(&common_mgr->upumps, uchain)) {
+        *upump_p = NULL;
+        return;
+    }
+    *upump_p = upump_common_to_upump(upump_common_from_uchain(uchain->next));
+}
+
 /** @This cleans up the common parts of a upump_common_mgr structure.
  * Note that all pumps have to be stopped before.
  *
@@ -277,6 +473,7 @@ void upump_common_mgr_clean(struct upump_mgr *mgr)
     struct upump_common_mgr *common_mgr = upump_common_mgr_from_upump_mgr(mgr);
     upool_clean(&common_mgr->upump_pool);
     upool_clean(&common_mgr->upump_blocker_pool);
+    uclock_release(common_mgr->uclock);
 }
 
 /** @This initializes the common parts of a upump_common_mgr structure.
@@ -309,6 +506,11 @@ void upump_common_mgr_init(struct upump_mgr *mgr,
     common_mgr->upump_real_start = upump_real_start;
     common_mgr->upump_real_stop = upump_real_stop;
     common_mgr->upump_real_restart = upump_real_restart;
+    ulist_init(&common_mgr->upumps);
+    common_mgr->uclock = NULL;
+    memset(&common_mgr->stats, 0, sizeof(common_mgr->stats));
+    common_mgr->wake = UINT64_MAX;
+    common_mgr->dispatching = NULL;
 
     upool_init(&common_mgr->upump_pool, mgr->refcount, upump_pool_depth,
                pool_extra, upump_alloc_inner, upump_free_inner);
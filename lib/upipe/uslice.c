@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Authors: Christophe Massiot
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe pool of threads processing jobs split into slices
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uslice.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <assert.h>
+
+/** @internal @This is the context of a worker thread. */
+struct uslice_worker {
+    /** pointer to the pool */
+    struct uslice_pool *pool;
+    /** thread identifier */
+    pthread_t thread;
+    /** index of the thread, passed to the callbacks */
+    unsigned int index;
+};
+
+/** @This initializes a pool with a single thread, the calling thread.
+ *
+ * @param pool pointer to the pool
+ */
+void uslice_pool_init(struct uslice_pool *pool)
+{
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    ulist_init(&pool->jobs);
+    pool->quit = false;
+    pool->threads = 1;
+    pool->workers = NULL;
+}
+
+/** @internal @This takes the next slice of a job, and unqueues the job if it
+ * was the last one. It must be called with the mutex held.
+ *
+ * @param job pointer to the job
+ * @return index of the slice
+ */
+static unsigned int uslice_job_take(struct uslice_job *job)
+{
+    unsigned int slice = job->next_slice++;
+    if (job->next_slice == job->nb_slices && job->uchain.next != NULL)
+        ulist_delete(&job->uchain);
+    return slice;
+}
+
+/** @internal @This is the main loop of a worker thread.
+ *
+ * @param _worker pointer to the worker context
+ * @return NULL
+ */
+static void *uslice_worker_main(void *_worker)
+{
+    struct uslice_worker *worker = (struct uslice_worker *)_worker;
+    struct uslice_pool *pool = worker->pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    for ( ; ; ) {
+        while (!pool->quit && ulist_empty(&pool->jobs))
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        if (pool->quit)
+            break;
+
+        struct uslice_job *job = uslice_job_from_uchain(ulist_peek(&pool->jobs));
+        unsigned int slice = uslice_job_take(job);
+        pthread_mutex_unlock(&pool->mutex);
+
+        job->cb(job, slice, worker->index);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (!--job->pending)
+            pthread_cond_broadcast(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+/** @internal @This stops and joins the worker threads.
+ *
+ * @param pool pointer to the pool
+ * @param nb_workers number of running worker threads
+ */
+static void uslice_pool_stop(struct uslice_pool *pool, unsigned int nb_workers)
+{
+    assert(ulist_empty(&pool->jobs));
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (unsigned int i = 0; i < nb_workers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pool->quit = false;
+    free(pool->workers);
+    pool->workers = NULL;
+    pool->threads = 1;
+}
+
+/** @This stops the worker threads and cleans up a pool. No job may be
+ * pending.
+ *
+ * @param pool pointer to the pool
+ */
+void uslice_pool_clean(struct uslice_pool *pool)
+{
+    uslice_pool_stop(pool, pool->threads - 1);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+/** @This sets the number of threads, and (re)starts the worker threads.
+ * No job may be pending. In case of error the pool is left with a single
+ * thread.
+ *
+ * @param pool pointer to the pool
+ * @param threads number of threads, including the calling thread
+ * @return an error code
+ */
+int uslice_pool_set_threads(struct uslice_pool *pool, unsigned int threads)
+{
+    if (!threads || threads > USLICE_MAX_THREADS)
+        return UBASE_ERR_INVALID;
+    if (threads == pool->threads)
+        return UBASE_ERR_NONE;
+
+    uslice_pool_stop(pool, pool->threads - 1);
+    if (threads == 1)
+        return UBASE_ERR_NONE;
+
+    pool->workers = calloc(threads - 1, sizeof (*pool->workers));
+    if (unlikely(pool->workers == NULL))
+        return UBASE_ERR_ALLOC;
+
+    for (unsigned int i = 0; i < threads - 1; i++) {
+        struct uslice_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i + 1;
+        if (unlikely(pthread_create(&worker->thread, NULL,
+                                    uslice_worker_main, worker) != 0)) {
+            uslice_pool_stop(pool, i);
+            return UBASE_ERR_EXTERNAL;
+        }
+    }
+    pool->threads = threads;
+    return UBASE_ERR_NONE;
+}
+
+/** @This hands the slices of a job to the worker threads, and returns
+ * immediately. @ref uslice_pool_wait must be called before the job is
+ * released.
+ *
+ * @param pool pointer to the pool
+ * @param job pointer to an initialized job
+ */
+void uslice_pool_queue(struct uslice_pool *pool, struct uslice_job *job)
+{
+    if (pool->threads == 1 || !job->nb_slices)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    ulist_add(&pool->jobs, &job->uchain);
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/** @This processes the slices of a queued job not picked by any worker in
+ * the calling thread, and returns when all slices are done.
+ *
+ * @param pool pointer to the pool
+ * @param job pointer to a queued job
+ */
+void uslice_pool_wait(struct uslice_pool *pool, struct uslice_job *job)
+{
+    if (pool->threads == 1) {
+        while (job->next_slice < job->nb_slices)
+            job->cb(job, job->next_slice++, 0);
+        job->pending = 0;
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    while (job->next_slice < job->nb_slices) {
+        unsigned int slice = uslice_job_take(job);
+        pthread_mutex_unlock(&pool->mutex);
+
+        job->cb(job, slice, 0);
+
+        pthread_mutex_lock(&pool->mutex);
+        job->pending--;
+    }
+    while (job->pending)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
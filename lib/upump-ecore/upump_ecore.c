@@ -387,6 +387,11 @@ static int upump_ecore_control(struct upump *upump, int command, va_list args)
             upump_common_blocker_free(blocker);
             return UBASE_ERR_NONE;
         }
+        case UPUMP_GET_BLOCKED: {
+            int *blocked_p = va_arg(args, int *);
+            upump_common_get_blocked(upump, blocked_p);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
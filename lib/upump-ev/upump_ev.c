@@ -49,6 +49,10 @@ struct upump_ev_mgr {
     struct ev_loop *ev_loop;
     /** true if the loop has to be destroyed at the end */
     bool destroy;
+    /** watcher called before the loop goes to sleep */
+    struct ev_prepare ev_prepare;
+    /** watcher called when the loop wakes up */
+    struct ev_check ev_check;
 
     /** common structure */
     struct upump_common_mgr common_mgr;
@@ -78,6 +82,9 @@ struct upump_ev {
     union {
         struct {
             uint64_t after;
+            uint64_t repeat;
+            /** date at which the timer is due, for statistics */
+            uint64_t deadline;
         } timer;
     };
 
@@ -113,7 +120,22 @@ static void upump_ev_dispatch_timer(struct ev_loop *ev_loop,
     struct upump_ev *upump_ev = container_of(ev_timer, struct upump_ev,
                                              ev_timer);
     struct upump *upump = upump_ev_to_upump(upump_ev);
-    upump_common_dispatch(upump);
+    uint64_t deadline = upump_ev->timer.deadline;
+    if (deadline != UINT64_MAX && upump_ev->timer.repeat)
+        upump_ev->timer.deadline += upump_ev->timer.repeat;
+    upump_common_dispatch_timer(upump, deadline);
+}
+
+/** @internal @This records the date at which a timer is due.
+ *
+ * @param upump description structure of the pump
+ * @param after delay before the timer is due
+ */
+static void upump_ev_timer_arm(struct upump *upump, uint64_t after)
+{
+    struct upump_ev *upump_ev = upump_ev_from_upump(upump);
+    uint64_t now = upump_common_mgr_now(upump->mgr);
+    upump_ev->timer.deadline = now == UINT64_MAX ? UINT64_MAX : now + after;
 }
 
 /** @This dispatches an event to a pump for type ev_idle.
@@ -171,6 +193,8 @@ static struct upump *upump_ev_alloc(struct upump_mgr *mgr,
             uint64_t after = va_arg(args, uint64_t);
             uint64_t repeat = va_arg(args, uint64_t);
             upump_ev->timer.after = after;
+            upump_ev->timer.repeat = repeat;
+            upump_ev->timer.deadline = UINT64_MAX;
             ev_timer_init(&upump_ev->ev_timer, upump_ev_dispatch_timer,
                           (ev_tstamp)after / UCLOCK_FREQ,
                           (ev_tstamp)repeat / UCLOCK_FREQ);
@@ -218,6 +242,7 @@ static void upump_ev_real_start(struct upump *upump, bool status)
             ev_idle_start(ev_mgr->ev_loop, &upump_ev->ev_idle);
             break;
         case UPUMP_TYPE_TIMER:
+            upump_ev_timer_arm(upump, upump_ev->timer.after);
             ev_timer_start(ev_mgr->ev_loop, &upump_ev->ev_timer);
             break;
         case UPUMP_TYPE_FD_READ:
@@ -279,6 +304,7 @@ static void upump_ev_real_restart(struct upump *upump, bool status)
         case UPUMP_TYPE_TIMER: {
             bool active = ev_is_active(&upump_ev->ev_timer);
             if (active && upump_ev->ev_timer.repeat) {
+                upump_ev_timer_arm(upump, upump_ev->timer.repeat);
                 ev_timer_again(ev_mgr->ev_loop, &upump_ev->ev_timer);
                 return;
             }
@@ -287,6 +313,7 @@ static void upump_ev_real_restart(struct upump *upump, bool status)
                 ev_timer_stop(ev_mgr->ev_loop, &upump_ev->ev_timer);
             upump_ev->ev_timer.at =
                 (ev_tstamp)upump_ev->timer.after / UCLOCK_FREQ;
+            upump_ev_timer_arm(upump, upump_ev->timer.after);
             ev_timer_start(ev_mgr->ev_loop, &upump_ev->ev_timer);
             break;
         }
@@ -379,6 +406,16 @@ static int upump_ev_control(struct upump *upump, int command, va_list args)
             upump_common_blocker_free(blocker);
             return UBASE_ERR_NONE;
         }
+        case UPUMP_GET_BLOCKED: {
+            int *blocked_p = va_arg(args, int *);
+            upump_common_get_blocked(upump, blocked_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_GET_STATS: {
+            struct upump_stats *stats = va_arg(args, struct upump_stats *);
+            upump_common_get_stats(upump, stats);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -404,6 +441,34 @@ static void upump_ev_mgr_unlock(struct ev_loop *loop)
     umutex_unlock(mutex);
 }
 
+/** @internal @This is called before the event loop goes to sleep.
+ *
+ * @param ev_loop ev loop
+ * @param ev_prepare ev watcher
+ * @param revents events triggered (unused parameter)
+ **/
+static void upump_ev_mgr_prepare(struct ev_loop *loop,
+                                 struct ev_prepare *ev_prepare, int revents)
+{
+    struct upump_ev_mgr *ev_mgr =
+        container_of(ev_prepare, struct upump_ev_mgr, ev_prepare);
+    upump_common_mgr_sleep(upump_ev_mgr_to_upump_mgr(ev_mgr));
+}
+
+/** @internal @This is called when the event loop wakes up.
+ *
+ * @param ev_loop ev loop
+ * @param ev_check ev watcher
+ * @param revents events triggered (unused parameter)
+ **/
+static void upump_ev_mgr_check(struct ev_loop *loop,
+                               struct ev_check *ev_check, int revents)
+{
+    struct upump_ev_mgr *ev_mgr =
+        container_of(ev_check, struct upump_ev_mgr, ev_check);
+    upump_common_mgr_wake(upump_ev_mgr_to_upump_mgr(ev_mgr));
+}
+
 /** @internal @This runs an event loop.
  *
  * @param mgr pointer to a upump_mgr structure
@@ -455,6 +520,21 @@ static int upump_ev_mgr_control(struct upump_mgr *mgr,
         case UPUMP_MGR_VACUUM:
             upump_common_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UPUMP_MGR_SET_STATS: {
+            int enabled = va_arg(args, int);
+            return upump_common_mgr_set_stats(mgr, !!enabled);
+        }
+        case UPUMP_MGR_GET_STATS: {
+            struct upump_mgr_stats *stats =
+                va_arg(args, struct upump_mgr_stats *);
+            upump_common_mgr_get_stats(mgr, stats);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_MGR_ITERATE: {
+            struct upump **upump_p = va_arg(args, struct upump **);
+            upump_common_mgr_iterate(mgr, upump_p);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -467,6 +547,10 @@ static int upump_ev_mgr_control(struct upump_mgr *mgr,
 static void upump_ev_mgr_free(struct urefcount *urefcount)
 {
     struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_urefcount(urefcount);
+    ev_ref(ev_mgr->ev_loop);
+    ev_prepare_stop(ev_mgr->ev_loop, &ev_mgr->ev_prepare);
+    ev_ref(ev_mgr->ev_loop);
+    ev_check_stop(ev_mgr->ev_loop, &ev_mgr->ev_check);
     upump_common_mgr_clean(upump_ev_mgr_to_upump_mgr(ev_mgr));
     if (ev_mgr->destroy)
         ev_loop_destroy(ev_mgr->ev_loop);
@@ -507,6 +591,14 @@ struct upump_mgr *upump_ev_mgr_alloc(struct ev_loop *ev_loop,
 
     ev_mgr->ev_loop = ev_loop;
     ev_mgr->destroy = false;
+
+    /* these watchers must not keep the loop alive */
+    ev_prepare_init(&ev_mgr->ev_prepare, upump_ev_mgr_prepare);
+    ev_prepare_start(ev_loop, &ev_mgr->ev_prepare);
+    ev_unref(ev_loop);
+    ev_check_init(&ev_mgr->ev_check, upump_ev_mgr_check);
+    ev_check_start(ev_loop, &ev_mgr->ev_check);
+    ev_unref(ev_loop);
     return mgr;
 }
 
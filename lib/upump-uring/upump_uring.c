@@ -0,0 +1,1171 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short implementation of a Upipe event loop using Linux io_uring
+ *
+ * fd watchers and signals are one-shot poll requests re-armed before each
+ * dispatch, which gives the level-triggered semantics of libev. Timers and
+ * idlers are managed in user space, and the loop waits for completions
+ * with the timeout of the nearest timer.
+ */
+
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/urefcount.h>
+#include <upipe/uclock.h>
+#include <upipe/umutex.h>
+#include <upipe/upump.h>
+#include <upipe/upump_common.h>
+#include <upump-uring/upump_uring.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/signalfd.h>
+#include <linux/io_uring.h>
+
+/** number of entries in the submission queue */
+#define UPUMP_URING_ENTRIES 256
+/** user data of requests whose completion is ignored */
+#define UPUMP_URING_IGNORE UINT64_MAX
+/** invalid request index */
+#define UPUMP_URING_NO_REQ (-1)
+
+/** @This defines the types of requests in flight. */
+enum upump_uring_req_type {
+    /** free or orphaned request */
+    UPUMP_URING_REQ_NONE,
+    /** poll request for a pump */
+    UPUMP_URING_REQ_POLL,
+    /** I/O submitted by a pipe */
+    UPUMP_URING_REQ_IO
+};
+
+/** @This describes a request in flight; its index is the user data of the
+ * submission. */
+struct upump_uring_req {
+    /** type of request */
+    enum upump_uring_req_type type;
+    /** true if a submission is in flight */
+    bool inflight;
+    union {
+        /** pump for poll requests */
+        struct upump_uring *upump;
+        /** I/O for I/O requests */
+        struct upump_uring_io *io;
+    };
+    /** next free request */
+    int next_free;
+};
+
+/** @This stores management parameters and local structures.
+ */
+struct upump_uring_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** ring file descriptor */
+    int ring_fd;
+    /** mapping of the submission ring */
+    void *sq_ptr;
+    /** size of the mapping of the submission ring */
+    size_t sq_size;
+    /** mapping of the completion ring */
+    void *cq_ptr;
+    /** size of the mapping of the completion ring */
+    size_t cq_size;
+    /** submission queue entries */
+    struct io_uring_sqe *sqes;
+    /** size of the mapping of the submission queue entries */
+    size_t sqes_size;
+    /** submission ring head (written by the kernel) */
+    unsigned *sq_head;
+    /** submission ring tail */
+    unsigned *sq_tail;
+    /** submission ring mask */
+    unsigned sq_mask;
+    /** number of submission entries */
+    unsigned sq_entries;
+    /** submission ring array */
+    unsigned *sq_array;
+    /** completion ring head */
+    unsigned *cq_head;
+    /** completion ring tail (written by the kernel) */
+    unsigned *cq_tail;
+    /** completion ring mask */
+    unsigned cq_mask;
+    /** completion ring entries */
+    struct io_uring_cqe *cqes;
+
+    /** requests in flight */
+    struct upump_uring_req *reqs;
+    /** number of allocated requests */
+    int nb_reqs;
+    /** first free request */
+    int free_req;
+
+    /** list of active timers, sorted by deadline */
+    struct uchain timers;
+    /** list of active idlers */
+    struct uchain idlers;
+    /** number of active blocking pumps and pending I/Os */
+    unsigned int nb_blocking;
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_uring_mgr, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_uring_mgr, urefcount, urefcount, urefcount)
+
+/** @This stores local structures.
+ */
+struct upump_uring {
+    /** type of event to watch */
+    int event;
+    /** true if the pump is armed in the loop */
+    bool active;
+    /** true if the pump keeps the loop running */
+    bool blocking;
+    /** structure for the lists of timers and idlers */
+    struct uchain uchain;
+
+    /** private structure */
+    union {
+        struct {
+            /** file descriptor to poll */
+            int fd;
+            /** poll request, or UPUMP_URING_NO_REQ */
+            int req;
+            /** signal number (signal pumps only) */
+            int signal;
+            /** true if the signal was unblocked before the pump started */
+            bool unblock;
+        } io;
+        struct {
+            /** delay before the first expiration */
+            uint64_t after;
+            /** period, or 0 */
+            uint64_t repeat;
+            /** date of the next expiration */
+            uint64_t deadline;
+        } timer;
+    };
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_uring, upump, upump, common.upump)
+UBASE_FROM_TO(upump_uring, uchain, uchain, uchain)
+
+/** @internal @This returns the current monotonic date.
+ *
+ * @return date in 27 MHz ticks
+ */
+static uint64_t upump_uring_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UCLOCK_FREQ +
+           (uint64_t)ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+}
+
+/** @internal @This calls io_uring_enter(2).
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param min_complete minimum number of completions to wait for
+ * @param flags io_uring_enter flags
+ * @param arg extended argument
+ * @return number of consumed submissions, or -1 with errno set
+ */
+static int upump_uring_enter(struct upump_uring_mgr *uring_mgr,
+                             unsigned min_complete, unsigned flags,
+                             struct io_uring_getevents_arg *arg)
+{
+    unsigned to_submit = *uring_mgr->sq_tail -
+        __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE);
+    return syscall(SYS_io_uring_enter, uring_mgr->ring_fd, to_submit,
+                   min_complete, flags, arg, arg != NULL ? sizeof(*arg) : 0);
+}
+
+/** @internal @This returns a free submission queue entry, submitting
+ * pending entries if the queue is full. If the kernel can't take any of
+ * them, it waits for a completion to release resources.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return pointer to the entry, or NULL in case of error
+ */
+static struct io_uring_sqe *upump_uring_get_sqe(
+        struct upump_uring_mgr *uring_mgr)
+{
+    unsigned tail = *uring_mgr->sq_tail;
+    while (tail - __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE) >=
+           uring_mgr->sq_entries) {
+        int ret = upump_uring_enter(uring_mgr, 0, 0, NULL);
+        if (ret == 0 || (ret < 0 && (errno == EAGAIN || errno == EBUSY)))
+            ret = upump_uring_enter(uring_mgr, 1, IORING_ENTER_GETEVENTS,
+                                    NULL);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return NULL;
+    }
+
+    unsigned index = tail & uring_mgr->sq_mask;
+    struct io_uring_sqe *sqe = &uring_mgr->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    uring_mgr->sq_array[index] = index;
+    return sqe;
+}
+
+/** @internal @This makes a submission queue entry visible to the kernel.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_commit_sqe(struct upump_uring_mgr *uring_mgr)
+{
+    __atomic_store_n(uring_mgr->sq_tail, *uring_mgr->sq_tail + 1,
+                     __ATOMIC_RELEASE);
+}
+
+/** @internal @This allocates a request.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param type type of request
+ * @return index of the request, or UPUMP_URING_NO_REQ
+ */
+static int upump_uring_req_alloc(struct upump_uring_mgr *uring_mgr,
+                                 enum upump_uring_req_type type)
+{
+    if (uring_mgr->free_req == UPUMP_URING_NO_REQ) {
+        int nb_reqs = uring_mgr->nb_reqs ? uring_mgr->nb_reqs * 2 :
+                      UPUMP_URING_ENTRIES;
+        struct upump_uring_req *reqs =
+            realloc(uring_mgr->reqs, nb_reqs * sizeof(*reqs));
+        if (unlikely(reqs == NULL))
+            return UPUMP_URING_NO_REQ;
+        for (int i = uring_mgr->nb_reqs; i < nb_reqs; i++) {
+            reqs[i].type = UPUMP_URING_REQ_NONE;
+            reqs[i].inflight = false;
+            reqs[i].next_free = i + 1 < nb_reqs ? i + 1 : UPUMP_URING_NO_REQ;
+        }
+        uring_mgr->free_req = uring_mgr->nb_reqs;
+        uring_mgr->reqs = reqs;
+        uring_mgr->nb_reqs = nb_reqs;
+    }
+
+    int req = uring_mgr->free_req;
+    uring_mgr->free_req = uring_mgr->reqs[req].next_free;
+    uring_mgr->reqs[req].type = type;
+    uring_mgr->reqs[req].inflight = true;
+    return req;
+}
+
+/** @internal @This frees a request.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param req index of the request
+ */
+static void upump_uring_req_free(struct upump_uring_mgr *uring_mgr, int req)
+{
+    uring_mgr->reqs[req].type = UPUMP_URING_REQ_NONE;
+    uring_mgr->reqs[req].inflight = false;
+    uring_mgr->reqs[req].next_free = uring_mgr->free_req;
+    uring_mgr->free_req = req;
+}
+
+/** @internal @This queues a poll request for an fd or signal pump.
+ *
+ * @param upump_uring pointer to pump
+ * @return false in case of error
+ */
+static bool upump_uring_arm(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring->common.upump.mgr);
+    int req = upump_uring_req_alloc(uring_mgr, UPUMP_URING_REQ_POLL);
+    if (unlikely(req == UPUMP_URING_NO_REQ))
+        return false;
+
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+    if (unlikely(sqe == NULL)) {
+        upump_uring_req_free(uring_mgr, req);
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = upump_uring->io.fd;
+    sqe->poll32_events =
+        upump_uring->event == UPUMP_TYPE_FD_WRITE ? POLLOUT : POLLIN;
+    sqe->user_data = req;
+    upump_uring_commit_sqe(uring_mgr);
+
+    uring_mgr->reqs[req].upump = upump_uring;
+    upump_uring->io.req = req;
+    return true;
+}
+
+/** @internal @This cancels the pending poll request of a pump. The request
+ * is orphaned and freed when its completion arrives.
+ *
+ * @param upump_uring pointer to pump
+ */
+static void upump_uring_disarm(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring->common.upump.mgr);
+    int req = upump_uring->io.req;
+    if (req == UPUMP_URING_NO_REQ)
+        return;
+    upump_uring->io.req = UPUMP_URING_NO_REQ;
+    uring_mgr->reqs[req].type = UPUMP_URING_REQ_NONE;
+    uring_mgr->reqs[req].upump = NULL;
+
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+    if (unlikely(sqe == NULL))
+        return;
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = req;
+    sqe->user_data = UPUMP_URING_IGNORE;
+    upump_uring_commit_sqe(uring_mgr);
+}
+
+/** @internal @This inserts a timer in the sorted list of timers.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param upump_uring pointer to timer pump
+ */
+static void upump_uring_timer_insert(struct upump_uring_mgr *uring_mgr,
+                                     struct upump_uring *upump_uring)
+{
+    struct uchain *uchain;
+    ulist_foreach_reverse (&uring_mgr->timers, uchain) {
+        struct upump_uring *timer = upump_uring_from_uchain(uchain);
+        if (timer->timer.deadline <= upump_uring->timer.deadline) {
+            ulist_insert(uchain, uchain->next, &upump_uring->uchain);
+            return;
+        }
+    }
+    ulist_unshift(&uring_mgr->timers, &upump_uring->uchain);
+}
+
+/** @internal @This marks a pump as armed.
+ *
+ * @param upump_uring pointer to pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_activate(struct upump_uring *upump_uring, bool status)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring->common.upump.mgr);
+    upump_uring->active = true;
+    upump_uring->blocking = status;
+    if (status)
+        uring_mgr->nb_blocking++;
+}
+
+/** @internal @This marks a pump as no longer armed.
+ *
+ * @param upump_uring pointer to pump
+ */
+static void upump_uring_deactivate(struct upump_uring *upump_uring)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump_uring->common.upump.mgr);
+    if (!upump_uring->active)
+        return;
+    upump_uring->active = false;
+    if (upump_uring->blocking)
+        uring_mgr->nb_blocking--;
+    if (ulist_is_in(&upump_uring->uchain))
+        ulist_delete(&upump_uring->uchain);
+}
+
+/** @This allocates a new upump_uring.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_uring_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_uring_alloc(struct upump_mgr *mgr,
+                                       int event, va_list args)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    struct upump_uring *upump_uring =
+        upool_alloc(&uring_mgr->common_mgr.upump_pool, struct upump_uring *);
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+
+    switch (event) {
+        case UPUMP_TYPE_IDLER:
+            break;
+        case UPUMP_TYPE_TIMER:
+            upump_uring->timer.after = va_arg(args, uint64_t);
+            upump_uring->timer.repeat = va_arg(args, uint64_t);
+            upump_uring->timer.deadline = 0;
+            break;
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            upump_uring->io.fd = va_arg(args, int);
+            upump_uring->io.req = UPUMP_URING_NO_REQ;
+            upump_uring->io.signal = 0;
+            break;
+        case UPUMP_TYPE_SIGNAL:
+            upump_uring->io.fd = -1;
+            upump_uring->io.req = UPUMP_URING_NO_REQ;
+            upump_uring->io.signal = va_arg(args, int);
+            upump_uring->io.unblock = false;
+            break;
+        default:
+            upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+            return NULL;
+    }
+    upump_uring->event = event;
+    upump_uring->active = false;
+    upump_uring->blocking = false;
+    uchain_init(&upump_uring->uchain);
+
+    upump_common_init(upump);
+
+    return upump;
+}
+
+/** @internal @This opens a signalfd for a signal pump, blocking the signal
+ * for the normal delivery.
+ *
+ * @param upump_uring pointer to signal pump
+ * @return false in case of error
+ */
+static bool upump_uring_signal_open(struct upump_uring *upump_uring)
+{
+    sigset_t sigs, old_sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, upump_uring->io.signal);
+    if (pthread_sigmask(SIG_BLOCK, &sigs, &old_sigs) != 0)
+        return false;
+    upump_uring->io.unblock = !sigismember(&old_sigs, upump_uring->io.signal);
+
+    upump_uring->io.fd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (unlikely(upump_uring->io.fd == -1)) {
+        if (upump_uring->io.unblock)
+            pthread_sigmask(SIG_UNBLOCK, &sigs, NULL);
+        return false;
+    }
+    return true;
+}
+
+/** @internal @This closes the signalfd of a signal pump.
+ *
+ * @param upump_uring pointer to signal pump
+ */
+static void upump_uring_signal_close(struct upump_uring *upump_uring)
+{
+    if (upump_uring->io.fd == -1)
+        return;
+    close(upump_uring->io.fd);
+    upump_uring->io.fd = -1;
+    if (upump_uring->io.unblock) {
+        sigset_t sigs;
+        sigemptyset(&sigs);
+        sigaddset(&sigs, upump_uring->io.signal);
+        pthread_sigmask(SIG_UNBLOCK, &sigs, NULL);
+    }
+}
+
+/** @This starts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_start(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    if (upump_uring->active)
+        return;
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+            ulist_add(&uring_mgr->idlers, &upump_uring->uchain);
+            break;
+        case UPUMP_TYPE_TIMER:
+            upump_uring->timer.deadline =
+                upump_uring_now() + upump_uring->timer.after;
+            upump_uring_timer_insert(uring_mgr, upump_uring);
+            break;
+        case UPUMP_TYPE_SIGNAL:
+            if (unlikely(!upump_uring_signal_open(upump_uring)))
+                return;
+            /* fallthrough */
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            if (unlikely(!upump_uring_arm(upump_uring))) {
+                if (upump_uring->event == UPUMP_TYPE_SIGNAL)
+                    upump_uring_signal_close(upump_uring);
+                return;
+            }
+            break;
+        default:
+            return;
+    }
+    upump_uring_activate(upump_uring, status);
+}
+
+/** @This stops a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_stop(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_SIGNAL:
+            upump_uring_disarm(upump_uring);
+            upump_uring_signal_close(upump_uring);
+            break;
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            upump_uring_disarm(upump_uring);
+            break;
+        default:
+            break;
+    }
+    upump_uring_deactivate(upump_uring);
+}
+
+/** @This restarts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_restart(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    if (upump_uring->event != UPUMP_TYPE_TIMER) {
+        upump_uring_real_start(upump, status);
+        return;
+    }
+
+    if (upump_uring->active && upump_uring->timer.repeat) {
+        ulist_delete(&upump_uring->uchain);
+        upump_uring->timer.deadline =
+            upump_uring_now() + upump_uring->timer.repeat;
+        upump_uring_timer_insert(uring_mgr, upump_uring);
+        return;
+    }
+
+    upump_uring_deactivate(upump_uring);
+    upump_uring_real_start(upump, status);
+}
+
+/** @This released the memory space previously used by a pump.
+ * Please note that the pump must be stopped before.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_uring_free(struct upump *upump)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    upump_stop(upump);
+    upump_common_clean(upump);
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_uring or NULL in case of allocation error
+ */
+static void *upump_uring_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_uring *upump_uring = malloc(sizeof(struct upump_uring));
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return upump_uring;
+}
+
+/** @internal @This frees a upump_uring.
+ *
+ * @param upool pointer to upool
+ * @param upump_uring pointer to a upump_uring structure to free
+ */
+static void upump_uring_free_inner(struct upool *upool, void *upump_uring)
+{
+    free(upump_uring);
+}
+
+/** @This processes control commands on a upump_uring.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_control(struct upump *upump, int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_RESTART:
+            upump_common_restart(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_uring_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_GET_BLOCKED: {
+            int *blocked_p = va_arg(args, int *);
+            upump_common_get_blocked(upump, blocked_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_GET_STATS: {
+            struct upump_stats *stats = va_arg(args, struct upump_stats *);
+            upump_common_get_stats(upump, stats);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This handles the completion of a poll request.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param upump_uring pointer to pump
+ * @param res result of the poll
+ */
+static void upump_uring_complete_poll(struct upump_uring_mgr *uring_mgr,
+                                      struct upump_uring *upump_uring,
+                                      int res)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump_uring->io.req = UPUMP_URING_NO_REQ;
+
+    if (upump_uring->event == UPUMP_TYPE_SIGNAL) {
+        struct signalfd_siginfo siginfo;
+        while (read(upump_uring->io.fd, &siginfo, sizeof(siginfo)) > 0);
+    }
+
+    /* re-arm before dispatching, the callback may stop or free the pump */
+    if (unlikely(res < 0 || !upump_uring_arm(upump_uring)))
+        upump_uring_deactivate(upump_uring);
+    upump_common_dispatch(upump);
+}
+
+/** @internal @This processes all available completions.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return number of dispatched events
+ */
+static unsigned upump_uring_process_cq(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned nb_events = 0;
+    unsigned head = *uring_mgr->cq_head;
+
+    while (head != __atomic_load_n(uring_mgr->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe cqe = uring_mgr->cqes[head & uring_mgr->cq_mask];
+        head++;
+        __atomic_store_n(uring_mgr->cq_head, head, __ATOMIC_RELEASE);
+
+        if (cqe.user_data == UPUMP_URING_IGNORE ||
+            cqe.user_data >= (uint64_t)uring_mgr->nb_reqs)
+            continue;
+
+        int req = cqe.user_data;
+        struct upump_uring_req *uring_req = &uring_mgr->reqs[req];
+        switch (uring_req->type) {
+            case UPUMP_URING_REQ_POLL: {
+                struct upump_uring *upump_uring = uring_req->upump;
+                upump_uring_req_free(uring_mgr, req);
+                upump_uring_complete_poll(uring_mgr, upump_uring, cqe.res);
+                nb_events++;
+                break;
+            }
+            case UPUMP_URING_REQ_IO: {
+                struct upump_uring_io *io = uring_req->io;
+                upump_uring_req_free(uring_mgr, req);
+                uring_mgr->nb_blocking--;
+                io->cb(io, cqe.res);
+                nb_events++;
+                break;
+            }
+            default:
+                /* orphaned request */
+                upump_uring_req_free(uring_mgr, req);
+                break;
+        }
+    }
+    return nb_events;
+}
+
+/** @internal @This dispatches expired timers.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return number of dispatched events
+ */
+static unsigned upump_uring_process_timers(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned nb_events = 0;
+    uint64_t now = upump_uring_now();
+    struct uchain *uchain;
+
+    while ((uchain = ulist_peek(&uring_mgr->timers)) != NULL) {
+        struct upump_uring *upump_uring = upump_uring_from_uchain(uchain);
+        uint64_t deadline = upump_uring->timer.deadline;
+        if (deadline > now)
+            break;
+
+        if (upump_uring->timer.repeat) {
+            ulist_delete(uchain);
+            upump_uring->timer.deadline += upump_uring->timer.repeat;
+            if (upump_uring->timer.deadline <= now)
+                upump_uring->timer.deadline = now + upump_uring->timer.repeat;
+            upump_uring_timer_insert(uring_mgr, upump_uring);
+        } else
+            upump_uring_deactivate(upump_uring);
+
+        /* both dates come from CLOCK_MONOTONIC, as uclock_std */
+        upump_common_dispatch_timer(upump_uring_to_upump(upump_uring),
+                                    deadline);
+        nb_events++;
+    }
+    return nb_events;
+}
+
+/** @internal @This dispatches all active idlers.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_process_idlers(struct upump_uring_mgr *uring_mgr)
+{
+    if (ulist_empty(&uring_mgr->idlers))
+        return;
+
+    /* move the idlers to a pending list, so that callbacks can stop any of
+     * them */
+    struct uchain pending;
+    pending.next = uring_mgr->idlers.next;
+    pending.prev = uring_mgr->idlers.prev;
+    pending.next->prev = &pending;
+    pending.prev->next = &pending;
+    ulist_init(&uring_mgr->idlers);
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&pending)) != NULL) {
+        ulist_add(&uring_mgr->idlers, uchain);
+        upump_common_dispatch(upump_uring_to_upump(
+                    upump_uring_from_uchain(uchain)));
+    }
+}
+
+/** @internal @This runs an event loop.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param mutex mutual exclusion primitives to access the event loop
+ * @return an error code
+ */
+static int upump_uring_mgr_run(struct upump_mgr *mgr, struct umutex *mutex)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+
+    if (mutex != NULL)
+        umutex_lock(mutex);
+
+    int err = UBASE_ERR_NONE;
+    while (uring_mgr->nb_blocking) {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        unsigned min_complete = 1;
+
+        struct uchain *uchain;
+        if (!ulist_empty(&uring_mgr->idlers)) {
+            ts.tv_sec = ts.tv_nsec = 0;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            min_complete = 0;
+        } else if ((uchain = ulist_peek(&uring_mgr->timers)) != NULL) {
+            struct upump_uring *timer = upump_uring_from_uchain(uchain);
+            uint64_t now = upump_uring_now();
+            uint64_t wait = timer->timer.deadline > now ?
+                            timer->timer.deadline - now : 0;
+            ts.tv_sec = wait / UCLOCK_FREQ;
+            ts.tv_nsec = (wait % UCLOCK_FREQ) * UINT64_C(1000000000) /
+                         UCLOCK_FREQ;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+
+        upump_common_mgr_sleep(mgr);
+        if (mutex != NULL)
+            umutex_unlock(mutex);
+        int ret = upump_uring_enter(uring_mgr, min_complete,
+                IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg);
+        int error = errno;
+        if (mutex != NULL)
+            umutex_lock(mutex);
+        upump_common_mgr_wake(mgr);
+
+        if (unlikely(ret < 0 && error != ETIME && error != EINTR &&
+                     error != EAGAIN && error != EBUSY)) {
+            err = UBASE_ERR_EXTERNAL;
+            break;
+        }
+
+        unsigned nb_events = upump_uring_process_cq(uring_mgr);
+        nb_events += upump_uring_process_timers(uring_mgr);
+        if (!nb_events)
+            upump_uring_process_idlers(uring_mgr);
+    }
+
+    if (mutex != NULL)
+        umutex_unlock(mutex);
+    return err;
+}
+
+/** @internal @This queues an I/O on the ring.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param io description of the I/O
+ * @return an error code
+ */
+static int upump_uring_mgr_submit_io(struct upump_mgr *mgr,
+                                     struct upump_uring_io *io)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    int req = upump_uring_req_alloc(uring_mgr, UPUMP_URING_REQ_IO);
+    if (unlikely(req == UPUMP_URING_NO_REQ))
+        return UBASE_ERR_ALLOC;
+
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+    if (unlikely(sqe == NULL)) {
+        upump_uring_req_free(uring_mgr, req);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    sqe->fd = io->fd;
+    switch (io->type) {
+        case UPUMP_URING_IO_READ:
+        case UPUMP_URING_IO_WRITE:
+            sqe->opcode = io->type == UPUMP_URING_IO_READ ?
+                          IORING_OP_READ : IORING_OP_WRITE;
+            sqe->addr = (uint64_t)(uintptr_t)io->buf;
+            sqe->len = io->len;
+            sqe->off = io->offset;
+            break;
+        case UPUMP_URING_IO_RECVMSG:
+        case UPUMP_URING_IO_SENDMSG:
+            sqe->opcode = io->type == UPUMP_URING_IO_RECVMSG ?
+                          IORING_OP_RECVMSG : IORING_OP_SENDMSG;
+            sqe->addr = (uint64_t)(uintptr_t)io->msg;
+            sqe->len = 1;
+            sqe->msg_flags = io->flags;
+            break;
+        default:
+            /* the entry is turned into a no-op */
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = UPUMP_URING_IGNORE;
+            upump_uring_commit_sqe(uring_mgr);
+            upump_uring_req_free(uring_mgr, req);
+            return UBASE_ERR_INVALID;
+    }
+    sqe->user_data = req;
+    upump_uring_commit_sqe(uring_mgr);
+    /* hand the I/O to the kernel now, so that the caller may close the file
+     * descriptor before the loop runs again */
+    upump_uring_enter(uring_mgr, 0, 0, NULL);
+
+    uring_mgr->reqs[req].io = io;
+    uring_mgr->nb_blocking++;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This cancels a queued I/O.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param io description of the I/O
+ * @return an error code
+ */
+static int upump_uring_mgr_cancel_io(struct upump_mgr *mgr,
+                                     struct upump_uring_io *io)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+    for (int req = 0; req < uring_mgr->nb_reqs; req++) {
+        if (uring_mgr->reqs[req].type != UPUMP_URING_REQ_IO ||
+            uring_mgr->reqs[req].io != io)
+            continue;
+
+        struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+        if (unlikely(sqe == NULL))
+            return UBASE_ERR_EXTERNAL;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = req;
+        sqe->user_data = UPUMP_URING_IGNORE;
+        upump_uring_commit_sqe(uring_mgr);
+        return UBASE_ERR_NONE;
+    }
+    return UBASE_ERR_INVALID;
+}
+
+/** @This processes control commands on a upump_uring_mgr.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_mgr_control(struct upump_mgr *mgr,
+                                   int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_MGR_RUN: {
+            struct umutex *mutex = va_arg(args, struct umutex *);
+            return upump_uring_mgr_run(mgr, mutex);
+        }
+        case UPUMP_MGR_VACUUM:
+            upump_common_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        case UPUMP_MGR_SET_STATS: {
+            int enabled = va_arg(args, int);
+            return upump_common_mgr_set_stats(mgr, !!enabled);
+        }
+        case UPUMP_MGR_GET_STATS: {
+            struct upump_mgr_stats *stats =
+                va_arg(args, struct upump_mgr_stats *);
+            upump_common_mgr_get_stats(mgr, stats);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_MGR_ITERATE: {
+            struct upump **upump_p = va_arg(args, struct upump **);
+            upump_common_mgr_iterate(mgr, upump_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_URING_MGR_SUBMIT: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            struct upump_uring_io *io = va_arg(args, struct upump_uring_io *);
+            return upump_uring_mgr_submit_io(mgr, io);
+        }
+        case UPUMP_URING_MGR_CANCEL: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            struct upump_uring_io *io = va_arg(args, struct upump_uring_io *);
+            return upump_uring_mgr_cancel_io(mgr, io);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This unmaps the rings and closes the ring file descriptor.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_mgr_close(struct upump_uring_mgr *uring_mgr)
+{
+    if (uring_mgr->sqes != MAP_FAILED)
+        munmap(uring_mgr->sqes, uring_mgr->sqes_size);
+    if (uring_mgr->cq_ptr != MAP_FAILED && uring_mgr->cq_ptr != uring_mgr->sq_ptr)
+        munmap(uring_mgr->cq_ptr, uring_mgr->cq_size);
+    if (uring_mgr->sq_ptr != MAP_FAILED)
+        munmap(uring_mgr->sq_ptr, uring_mgr->sq_size);
+    close(uring_mgr->ring_fd);
+}
+
+/** @internal @This sets up the io_uring instance.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return false in case of error
+ */
+static bool upump_uring_mgr_open(struct upump_uring_mgr *uring_mgr)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    uring_mgr->sq_ptr = uring_mgr->cq_ptr = MAP_FAILED;
+    uring_mgr->sqes = MAP_FAILED;
+
+    uring_mgr->ring_fd = syscall(SYS_io_uring_setup, UPUMP_URING_ENTRIES,
+                                 &params);
+    if (uring_mgr->ring_fd < 0)
+        return false;
+    if (!(params.features & IORING_FEAT_EXT_ARG))
+        goto upump_uring_mgr_open_err;
+
+    uring_mgr->sq_size = params.sq_off.array +
+                         params.sq_entries * sizeof(unsigned);
+    uring_mgr->cq_size = params.cq_off.cqes +
+                         params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (uring_mgr->cq_size > uring_mgr->sq_size)
+            uring_mgr->sq_size = uring_mgr->cq_size;
+        uring_mgr->cq_size = uring_mgr->sq_size;
+    }
+
+    uring_mgr->sq_ptr = mmap(NULL, uring_mgr->sq_size,
+                             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             uring_mgr->ring_fd, IORING_OFF_SQ_RING);
+    if (uring_mgr->sq_ptr == MAP_FAILED)
+        goto upump_uring_mgr_open_err;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        uring_mgr->cq_ptr = uring_mgr->sq_ptr;
+    else {
+        uring_mgr->cq_ptr = mmap(NULL, uring_mgr->cq_size,
+                                 PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE,
+                                 uring_mgr->ring_fd, IORING_OFF_CQ_RING);
+        if (uring_mgr->cq_ptr == MAP_FAILED)
+            goto upump_uring_mgr_open_err;
+    }
+
+    uring_mgr->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    uring_mgr->sqes = mmap(NULL, uring_mgr->sqes_size,
+                           PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           uring_mgr->ring_fd, IORING_OFF_SQES);
+    if (uring_mgr->sqes == MAP_FAILED)
+        goto upump_uring_mgr_open_err;
+
+    uint8_t *sq = uring_mgr->sq_ptr;
+    uring_mgr->sq_head = (unsigned *)(sq + params.sq_off.head);
+    uring_mgr->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    uring_mgr->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    uring_mgr->sq_entries = *(unsigned *)(sq + params.sq_off.ring_entries);
+    uring_mgr->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+    uint8_t *cq = uring_mgr->cq_ptr;
+    uring_mgr->cq_head = (unsigned *)(cq + params.cq_off.head);
+    uring_mgr->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    uring_mgr->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    uring_mgr->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+
+upump_uring_mgr_open_err:
+    upump_uring_mgr_close(uring_mgr);
+    return false;
+}
+
+/** @This frees a upump manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_uring_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_urefcount(urefcount);
+    upump_common_mgr_clean(upump_uring_mgr_to_upump_mgr(uring_mgr));
+    upump_uring_mgr_close(uring_mgr);
+    free(uring_mgr->reqs);
+    free(uring_mgr);
+}
+
+/** @This allocates and initializes a upump_mgr structure bound to a new
+ * io_uring instance.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL in case of error
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth)
+{
+    struct upump_uring_mgr *uring_mgr =
+        malloc(sizeof(struct upump_uring_mgr) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(uring_mgr == NULL))
+        return NULL;
+
+    if (unlikely(!upump_uring_mgr_open(uring_mgr))) {
+        free(uring_mgr);
+        return NULL;
+    }
+    uring_mgr->reqs = NULL;
+    uring_mgr->nb_reqs = 0;
+    uring_mgr->free_req = UPUMP_URING_NO_REQ;
+    ulist_init(&uring_mgr->timers);
+    ulist_init(&uring_mgr->idlers);
+    uring_mgr->nb_blocking = 0;
+
+    struct upump_mgr *mgr = upump_uring_mgr_to_upump_mgr(uring_mgr);
+    mgr->signature = UPUMP_URING_SIGNATURE;
+    urefcount_init(upump_uring_mgr_to_urefcount(uring_mgr),
+                   upump_uring_mgr_free);
+    uring_mgr->common_mgr.mgr.refcount =
+        upump_uring_mgr_to_urefcount(uring_mgr);
+    uring_mgr->common_mgr.mgr.upump_alloc = upump_uring_alloc;
+    uring_mgr->common_mgr.mgr.upump_control = upump_uring_control;
+    uring_mgr->common_mgr.mgr.upump_mgr_control = upump_uring_mgr_control;
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          uring_mgr->upool_extra,
+                          upump_uring_real_start, upump_uring_real_stop,
+                          upump_uring_real_restart,
+                          upump_uring_alloc_inner, upump_uring_free_inner);
+    return mgr;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <libavutil/mem.h>
+
+#include "checkasm.h"
+#include "lib/upipe/ubuf_pic_blend.h"
+
+#define WIDTH 1920
+
+/* the alpha values that matter most are the extremes */
+static uint8_t random_alpha(void)
+{
+    int r = rnd() % 4;
+    return r == 0 ? 0 : r == 1 ? 0xff : rnd() & 0xff;
+}
+
+static void randomize_buffers8(uint8_t *dst0, uint8_t *dst1, uint8_t *src,
+                               uint8_t *a, int w)
+{
+    for (int i = 0; i < w; i++) {
+        dst0[i] = dst1[i] = rnd() & 0xff;
+        src[i] = rnd() & 0xff;
+    }
+    for (int i = 0; i < 2 * w; i++)
+        a[i] = random_alpha();
+}
+
+static void randomize_buffers16(uint16_t *dst0, uint16_t *dst1, uint16_t *src,
+                                uint8_t *a, int w)
+{
+    for (int i = 0; i < w; i++) {
+        dst0[i] = dst1[i] = rnd() & 0x3ff;
+        src[i] = rnd() & 0x3ff;
+    }
+    for (int i = 0; i < 2 * w; i++)
+        a[i] = random_alpha();
+}
+
+#define check_blend(type, bits, call_args, bench_args)                      \
+    do {                                                                    \
+        DECLARE_ALIGNED(32, type, dst0)[WIDTH];                             \
+        DECLARE_ALIGNED(32, type, dst1)[WIDTH];                             \
+        DECLARE_ALIGNED(32, type, src)[WIDTH];                              \
+        DECLARE_ALIGNED(32, uint8_t, a)[2 * WIDTH];                         \
+        for (int i = 0; i < 32; i++) {                                      \
+            int w = (1 + rnd() % (WIDTH / UPIPE_BLEND_ALIGN)) *             \
+                    UPIPE_BLEND_ALIGN;                                      \
+            int hsub = 1 + (rnd() & 1);                                     \
+            int alpha = i & 1 ? 0xff : random_alpha();                      \
+            int threshold = rnd() % 0xff;                                   \
+            type *dst = dst0;                                               \
+            randomize_buffers##bits(dst0, dst1, src, a, w);                 \
+            call_ref call_args;                                             \
+            dst = dst1;                                                     \
+            call_new call_args;                                             \
+            if (memcmp(dst0, dst1, w * sizeof(type)))                       \
+                fail();                                                     \
+            (void)hsub; (void)alpha; (void)threshold;                       \
+        }                                                                   \
+        int w = WIDTH, hsub = 2, alpha = 0xc0, threshold = 0x80;            \
+        type *dst = dst1;                                                   \
+        bench_new bench_args;                                               \
+        (void)hsub; (void)alpha; (void)threshold;                           \
+    } while (0)
+
+void checkasm_check_blend(void)
+{
+    struct {
+        void (*const8)(uint8_t *dst, const uint8_t *src, ptrdiff_t w,
+                       int alpha);
+        void (*alpha8)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                       ptrdiff_t w, int hsub, int alpha);
+        void (*threshold8)(uint8_t *dst, const uint8_t *src,
+                           const uint8_t *a, ptrdiff_t w, int hsub,
+                           int alpha, int threshold);
+        void (*const16)(uint16_t *dst, const uint16_t *src, ptrdiff_t w,
+                        int alpha);
+        void (*alpha16)(uint16_t *dst, const uint16_t *src, const uint8_t *a,
+                        ptrdiff_t w, int hsub, int alpha);
+        void (*threshold16)(uint16_t *dst, const uint16_t *src,
+                            const uint8_t *a, ptrdiff_t w, int hsub,
+                            int alpha, int threshold);
+    } s = {
+        .const8 = upipe_blend_const8_c,
+        .alpha8 = upipe_blend_alpha8_c,
+        .threshold8 = upipe_blend_threshold8_c,
+        .const16 = upipe_blend_const16_c,
+        .alpha16 = upipe_blend_alpha16_c,
+        .threshold16 = upipe_blend_threshold16_c,
+    };
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.const8 = upipe_blend_const8_sse2;
+        s.alpha8 = upipe_blend_alpha8_sse2;
+        s.threshold8 = upipe_blend_threshold8_sse2;
+        s.const16 = upipe_blend_const16_sse2;
+        s.alpha16 = upipe_blend_alpha16_sse2;
+        s.threshold16 = upipe_blend_threshold16_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.const8 = upipe_blend_const8_avx2;
+        s.alpha8 = upipe_blend_alpha8_avx2;
+        s.threshold8 = upipe_blend_threshold8_avx2;
+        s.const16 = upipe_blend_const16_avx2;
+        s.alpha16 = upipe_blend_alpha16_avx2;
+        s.threshold16 = upipe_blend_threshold16_avx2;
+    }
+#endif
+
+    if (check_func(s.const8, "blend_const8")) {
+        declare_func(void, uint8_t *dst, const uint8_t *src, ptrdiff_t w,
+                     int alpha);
+        check_blend(uint8_t, 8, (dst, src, w, alpha), (dst, src, w, alpha));
+    }
+    report("blend_const8");
+
+    if (check_func(s.alpha8, "blend_alpha8")) {
+        declare_func(void, uint8_t *dst, const uint8_t *src,
+                     const uint8_t *a, ptrdiff_t w, int hsub, int alpha);
+        check_blend(uint8_t, 8, (dst, src, a, w, hsub, alpha),
+                    (dst, src, a, w, hsub, alpha));
+    }
+    report("blend_alpha8");
+
+    if (check_func(s.threshold8, "blend_threshold8")) {
+        declare_func(void, uint8_t *dst, const uint8_t *src,
+                     const uint8_t *a, ptrdiff_t w, int hsub, int alpha,
+                     int threshold);
+        check_blend(uint8_t, 8, (dst, src, a, w, hsub, alpha, threshold),
+                    (dst, src, a, w, hsub, alpha, threshold));
+    }
+    report("blend_threshold8");
+
+    if (check_func(s.const16, "blend_const16")) {
+        declare_func(void, uint16_t *dst, const uint16_t *src, ptrdiff_t w,
+                     int alpha);
+        check_blend(uint16_t, 16, (dst, src, w, alpha), (dst, src, w, alpha));
+    }
+    report("blend_const16");
+
+    if (check_func(s.alpha16, "blend_alpha16")) {
+        declare_func(void, uint16_t *dst, const uint16_t *src,
+                     const uint8_t *a, ptrdiff_t w, int hsub, int alpha);
+        check_blend(uint16_t, 16, (dst, src, a, w, hsub, alpha),
+                    (dst, src, a, w, hsub, alpha));
+    }
+    report("blend_alpha16");
+
+    if (check_func(s.threshold16, "blend_threshold16")) {
+        declare_func(void, uint16_t *dst, const uint16_t *src,
+                     const uint8_t *a, ptrdiff_t w, int hsub, int alpha,
+                     int threshold);
+        check_blend(uint16_t, 16, (dst, src, a, w, hsub, alpha, threshold),
+                    (dst, src, a, w, hsub, alpha, threshold));
+    }
+    report("blend_threshold16");
+}
@@ -74,9 +74,14 @@ static const struct {
     const char *name;
     void (*func)(void);
 } tests[] = {
+    { "blend", checkasm_check_blend },
+    { "merge", checkasm_check_merge },
 #ifdef HAVE_SDI
+    { "fecxor", checkasm_check_fecxor },
+    { "mpegscan", checkasm_check_mpegscan },
     { "sdidec", checkasm_check_sdidec },
     { "sdienc", checkasm_check_sdienc },
+    { "tssync", checkasm_check_tssync },
 #endif
     { "v210dec", checkasm_check_v210dec },
     { "v210enc", checkasm_check_v210enc },
@@ -73,8 +73,13 @@
 #define HAVE_RDTSC 0
 #include "timer.h"
 
+void checkasm_check_blend(void);
+void checkasm_check_fecxor(void);
+void checkasm_check_merge(void);
+void checkasm_check_mpegscan(void);
 void checkasm_check_sdidec(void);
 void checkasm_check_sdienc(void);
+void checkasm_check_tssync(void);
 void checkasm_check_v210dec(void);
 void checkasm_check_v210enc(void);
 
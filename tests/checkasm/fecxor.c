@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <libavutil/mem.h>
+
+#include "checkasm.h"
+#include "lib/upipe-ts/fecxor.h"
+
+#define LEN (7 * 188)
+#define BUF_SIZE (LEN + UPIPE_RTP_FEC_XOR_ALIGN)
+
+static void randomize_buffer(uint8_t *buf)
+{
+    for (int i = 0; i < BUF_SIZE; i++)
+        buf[i] = rnd() & 0xff;
+}
+
+void checkasm_check_fecxor(void)
+{
+    struct {
+        void (*fec_xor)(uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+    } s = {
+        .fec_xor = upipe_rtp_fec_xor_c,
+    };
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.fec_xor = upipe_rtp_fec_xor_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.fec_xor = upipe_rtp_fec_xor_avx2;
+    }
+#endif
+
+    if (check_func(s.fec_xor, "rtp_fec_xor")) {
+        DECLARE_ALIGNED(32, uint8_t, src)[BUF_SIZE];
+        DECLARE_ALIGNED(32, uint8_t, dst0)[BUF_SIZE];
+        DECLARE_ALIGNED(32, uint8_t, dst1)[BUF_SIZE];
+        declare_func(void, uint8_t *dst, const uint8_t *src, ptrdiff_t len);
+
+        for (int i = 0; i < 100; i++) {
+            /* packet payloads are not aligned in memory */
+            int offset = rnd() % UPIPE_RTP_FEC_XOR_ALIGN;
+            ptrdiff_t len = (1 + rnd() % (LEN / UPIPE_RTP_FEC_XOR_ALIGN)) *
+                            UPIPE_RTP_FEC_XOR_ALIGN;
+            randomize_buffer(src);
+            randomize_buffer(dst0);
+            memcpy(dst1, dst0, BUF_SIZE);
+            call_ref(dst0, src + offset, len);
+            call_new(dst1, src + offset, len);
+            if (memcmp(dst0, dst1, BUF_SIZE))
+                fail();
+        }
+
+        bench_new(dst1, src, LEN / UPIPE_RTP_FEC_XOR_ALIGN *
+                  UPIPE_RTP_FEC_XOR_ALIGN);
+    }
+    report("rtp_fec_xor");
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <string.h>
+#include <libavutil/mem.h>
+
+#include "checkasm.h"
+#include "lib/upipe-filters/merge.h"
+
+#define WIDTH 1920
+
+#define check_merge(type, mask)                                             \
+    do {                                                                    \
+        DECLARE_ALIGNED(32, type, dst0)[WIDTH];                             \
+        DECLARE_ALIGNED(32, type, dst1)[WIDTH];                             \
+        DECLARE_ALIGNED(32, type, s1)[WIDTH];                               \
+        DECLARE_ALIGNED(32, type, s2)[WIDTH];                               \
+        for (int i = 0; i < 32; i++) {                                      \
+            int w = (1 + rnd() % (WIDTH / UPIPE_FILTER_MERGE_ALIGN)) *      \
+                    UPIPE_FILTER_MERGE_ALIGN;                               \
+            for (int j = 0; j < WIDTH; j++) {                               \
+                dst0[j] = dst1[j] = rnd() & mask;                           \
+                s1[j] = rnd() & mask;                                       \
+                s2[j] = rnd() & mask;                                       \
+            }                                                               \
+            call_ref(dst0, s1, s2, w);                                      \
+            call_new(dst1, s1, s2, w);                                      \
+            if (memcmp(dst0, dst1, sizeof(dst0)))                           \
+                fail();                                                     \
+        }                                                                   \
+        bench_new(dst1, s1, s2, WIDTH);                                     \
+    } while (0)
+
+void checkasm_check_merge(void)
+{
+    struct {
+        void (*merge8)(uint8_t *dst, const uint8_t *s1, const uint8_t *s2,
+                       ptrdiff_t w);
+        void (*merge16)(uint16_t *dst, const uint16_t *s1,
+                        const uint16_t *s2, ptrdiff_t w);
+    } s = {
+        .merge8 = upipe_filter_merge8_c,
+        .merge16 = upipe_filter_merge16_c,
+    };
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.merge8 = upipe_filter_merge8_sse2;
+        s.merge16 = upipe_filter_merge16_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.merge8 = upipe_filter_merge8_avx2;
+        s.merge16 = upipe_filter_merge16_avx2;
+    }
+#endif
+
+    if (check_func(s.merge8, "filter_merge8")) {
+        declare_func(void, uint8_t *dst, const uint8_t *s1,
+                     const uint8_t *s2, ptrdiff_t w);
+        check_merge(uint8_t, 0xff);
+    }
+    report("filter_merge8");
+
+    if (check_func(s.merge16, "filter_merge16")) {
+        declare_func(void, uint16_t *dst, const uint16_t *s1,
+                     const uint16_t *s2, ptrdiff_t w);
+        check_merge(uint16_t, 0xffff);
+    }
+    report("filter_merge16");
+}
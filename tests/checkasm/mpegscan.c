@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <libavutil/mem.h>
+
+#include "checkasm.h"
+#include "lib/upipe-framers/mpegscan.h"
+
+#define LEN 4096
+
+static void randomize_buffer(uint8_t *buf, int size)
+{
+    /* make zeros and ones frequent enough to get start codes */
+    int density = 2 + rnd() % 256;
+    for (int i = 0; i < size; i++) {
+        int r = rnd() % density;
+        buf[i] = r == 0 ? 0 : r == 1 ? 1 : rnd() & 0xff;
+    }
+}
+
+void checkasm_check_mpegscan(void)
+{
+    struct {
+        ptrdiff_t (*scan)(const uint8_t *src, ptrdiff_t len);
+    } s = {
+        .scan = upipe_mpeg_scan_c,
+    };
+
+    int cpu_flags = av_get_cpu_flags();
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.scan = upipe_mpeg_scan_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.scan = upipe_mpeg_scan_avx2;
+    }
+#elif defined(__aarch64__)
+    if (cpu_flags & AV_CPU_FLAG_NEON) {
+        s.scan = upipe_mpeg_scan_neon;
+    }
+#endif
+    (void)cpu_flags;
+
+    if (check_func(s.scan, "mpeg_scan")) {
+        DECLARE_ALIGNED(32, uint8_t, buf)[LEN + 2];
+        declare_func(ptrdiff_t, const uint8_t *src, ptrdiff_t len);
+
+        for (int i = 0; i < 100; i++) {
+            ptrdiff_t len = (1 + rnd() % (LEN / UPIPE_MPEG_SCAN_ALIGN)) *
+                            UPIPE_MPEG_SCAN_ALIGN;
+            randomize_buffer(buf, LEN + 2);
+            if (call_ref(buf, len) != call_new(buf, len))
+                fail();
+        }
+
+        /* no start code: the whole buffer is scanned */
+        memset(buf, 0xff, LEN + 2);
+        bench_new(buf, LEN);
+    }
+    report("mpeg_scan");
+}
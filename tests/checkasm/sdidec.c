@@ -52,6 +52,11 @@ void checkasm_check_sdidec(void)
     if (cpu_flags & AV_CPU_FLAG_AVX2) {
         s.uyvy = upipe_sdi_to_uyvy_avx2;
     }
+#if defined(AV_CPU_FLAG_AVX512) && ARCH_X86_64
+    if (cpu_flags & AV_CPU_FLAG_AVX512) {
+        s.uyvy = upipe_sdi_to_uyvy_avx512;
+    }
+#endif
 #endif
 
     if (check_func(s.uyvy, "sdi_to_uyvy")) {
@@ -61,12 +66,15 @@ void checkasm_check_sdidec(void)
         DECLARE_ALIGNED(32, uint16_t, dst1)[NUM_SAMPLES];
         declare_func(void, const uint8_t *src, uint16_t *dst, int64_t pixels);
 
-        randomize_buffers(src0, src1);
-        call_ref(src0, dst0, NUM_SAMPLES / 2);
-        call_new(src1, dst1, NUM_SAMPLES / 2);
-        if (memcmp(src0, src1, NUM_SAMPLES * 10 / 8)
-                || memcmp(dst0, dst1, NUM_SAMPLES))
-            fail();
+        /* the SIMD versions process groups of 8 pixels */
+        for (int pixels = 8; pixels <= NUM_SAMPLES / 2; pixels += 8) {
+            randomize_buffers(src0, src1);
+            call_ref(src0, dst0, pixels);
+            call_new(src1, dst1, pixels);
+            if (memcmp(src0, src1, sizeof(src0))
+                    || memcmp(dst0, dst1, pixels * 4))
+                fail();
+        }
         bench_new(src1, dst1, NUM_SAMPLES / 2);
     }
     report("sdi_to_uyvy");
@@ -55,6 +55,11 @@ void checkasm_check_sdienc(void)
     if (cpu_flags & AV_CPU_FLAG_AVX2) {
         s.uyvy = upipe_uyvy_to_sdi_avx2;
     }
+#if defined(AV_CPU_FLAG_AVX512) && ARCH_X86_64
+    if (cpu_flags & AV_CPU_FLAG_AVX512) {
+        s.uyvy = upipe_uyvy_to_sdi_avx512;
+    }
+#endif
 #endif
 
     if (check_func(s.uyvy, "uyvy_to_sdi")) {
@@ -64,12 +69,15 @@ void checkasm_check_sdienc(void)
         uint8_t dst1[NUM_SAMPLES * 10 / 8 + 32];
         declare_func(void, uint8_t *dst, const uint8_t *src, int64_t pixels);
 
-        randomize_buffers(src0, src1);
-        call_ref(dst0, (const uint8_t*)src0, NUM_SAMPLES / 2);
-        call_new(dst1, (const uint8_t*)src1, NUM_SAMPLES / 2);
-        if (memcmp(src0, src1, NUM_SAMPLES)
-                || memcmp(dst0, dst1, NUM_SAMPLES * 10 / 8))
-            fail();
+        /* the SIMD versions process groups of 8 pixels */
+        for (int pixels = 8; pixels <= NUM_SAMPLES / 2; pixels += 8) {
+            randomize_buffers(src0, src1);
+            call_ref(dst0, (const uint8_t*)src0, pixels);
+            call_new(dst1, (const uint8_t*)src1, pixels);
+            if (memcmp(src0, src1, sizeof(src0))
+                    || memcmp(dst0, dst1, pixels * 5 / 2))
+                fail();
+        }
         bench_new(dst1, (const uint8_t*)src1, NUM_SAMPLES / 2);
     }
     report("uyvy_to_sdi");
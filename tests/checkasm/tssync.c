@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include <libavutil/mem.h>
+
+#include "checkasm.h"
+#include "lib/upipe-ts/tssync.h"
+
+#define LEN (7 * 188)
+#define COUNT 5
+#define BUF_SIZE (LEN + (COUNT - 1) * 204)
+
+static void randomize_buffer(uint8_t *buf)
+{
+    for (int i = 0; i < BUF_SIZE; i++)
+        buf[i] = rnd() & 0xff;
+
+    /* sprinkle lone sync words and a real stream somewhere */
+    for (int i = 0; i < 32; i++)
+        buf[rnd() % BUF_SIZE] = 0x47;
+
+    static const int strides[] = { 188, 192, 204 };
+    int stride = strides[rnd() % 3];
+    int count = 1 + rnd() % COUNT;
+    int offset = rnd() % LEN;
+    for (int k = 0; k < count && offset + k * stride < BUF_SIZE; k++)
+        buf[offset + k * stride] = 0x47;
+}
+
+void checkasm_check_tssync(void)
+{
+    struct {
+        ptrdiff_t (*scan)(const uint8_t *src, ptrdiff_t len, ptrdiff_t count,
+                          ptrdiff_t stride1, ptrdiff_t stride2,
+                          ptrdiff_t stride3);
+    } s = {
+        .scan = upipe_ts_sync_scan_c,
+    };
+
+#if defined(HAVE_X86ASM) && defined(__x86_64__)
+    int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2) {
+        s.scan = upipe_ts_sync_scan_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        s.scan = upipe_ts_sync_scan_avx2;
+    }
+#endif
+
+    if (check_func(s.scan, "ts_sync_scan")) {
+        DECLARE_ALIGNED(32, uint8_t, buf)[BUF_SIZE];
+        declare_func(ptrdiff_t, const uint8_t *src, ptrdiff_t len,
+                     ptrdiff_t count, ptrdiff_t stride1, ptrdiff_t stride2,
+                     ptrdiff_t stride3);
+
+        for (int i = 0; i < 100; i++) {
+            ptrdiff_t len = (1 + rnd() % (LEN / UPIPE_TS_SYNC_SCAN_ALIGN)) *
+                            UPIPE_TS_SYNC_SCAN_ALIGN;
+            ptrdiff_t count = 1 + rnd() % COUNT;
+            randomize_buffer(buf);
+            ptrdiff_t ref = call_ref(buf, len, count, 188, 192, 204);
+            ptrdiff_t new = call_new(buf, len, count, 188, 192, 204);
+            if (ref != new)
+                fail();
+        }
+
+        memset(buf, 0, BUF_SIZE);
+        bench_new(buf, LEN / UPIPE_TS_SYNC_SCAN_ALIGN *
+                  UPIPE_TS_SYNC_SCAN_ALIGN, COUNT, 188, 192, 204);
+    }
+    report("ts_sync_scan");
+}
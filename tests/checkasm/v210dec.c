@@ -94,6 +94,12 @@ void checkasm_check_v210dec(void)
         s.planar_10 = upipe_v210_to_planar_10_aligned_avx2;
         s.planar_8  = upipe_v210_to_planar_8_aligned_avx2;
     }
+#if defined(AV_CPU_FLAG_AVX512) && ARCH_X86_64
+    if (cpu_flags & AV_CPU_FLAG_AVX512) {
+        s.planar_10 = upipe_v210_to_planar_10_aligned_avx512;
+        s.planar_8  = upipe_v210_to_planar_8_aligned_avx512;
+    }
+#endif
 #endif
 
     if (check_func(s.planar_8, "v210_to_planar8")) {
@@ -100,6 +100,12 @@ void checkasm_check_v210enc(void)
         s.planar_10 = upipe_planar_to_v210_10_avx2;
         s.planar_8  = upipe_planar_to_v210_8_avx2;
     }
+#if defined(AV_CPU_FLAG_AVX512) && ARCH_X86_64
+    if (cpu_flags & AV_CPU_FLAG_AVX512) {
+        s.planar_10 = upipe_planar_to_v210_10_avx512;
+        s.planar_8  = upipe_planar_to_v210_8_avx512;
+    }
+#endif
 #endif
 
     if (check_func(s.planar_8, "planar_to_v210_8"))
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for ubuf manager for block formats with external storage
+ */
+
+#undef NDEBUG
+
+#include <upipe/urefcount.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/ubuf_block_ext.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define UBUF_POOL_DEPTH     1
+#define UBUF_SIZE           188
+
+static uint8_t slot[UBUF_SIZE];
+static struct urefcount slot_refcount;
+static unsigned int nb_released = 0;
+
+/** called when the last ubuf pointing to the slot is freed */
+static void slot_release(struct urefcount *urefcount)
+{
+    assert(urefcount == &slot_refcount);
+    nb_released++;
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct ubuf_mgr *mem_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                        UBUF_POOL_DEPTH,
+                                                        umem_mgr, -1, 0,
+                                                        -1, 0);
+    assert(mem_mgr != NULL);
+    struct ubuf_mgr *mgr = ubuf_block_ext_mgr_alloc(UBUF_POOL_DEPTH, mem_mgr);
+    assert(mgr != NULL);
+
+    for (int i = 0; i < UBUF_SIZE; i++)
+        slot[i] = i;
+    urefcount_init(&slot_refcount, slot_release);
+
+    struct ubuf *ubuf1, *ubuf2, *ubuf3;
+    ubuf1 = ubuf_block_ext_alloc(mgr, slot, UBUF_SIZE, &slot_refcount);
+    assert(ubuf1 != NULL);
+    /* the owner gives up its reference, the ubuf keeps the slot */
+    urefcount_release(&slot_refcount);
+    assert(!nb_released);
+
+    size_t size;
+    ubase_assert(ubuf_block_size(ubuf1, &size));
+    assert(size == UBUF_SIZE);
+
+    const uint8_t *r;
+    int wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf1, 0, &wanted, &r));
+    assert(wanted == UBUF_SIZE);
+    assert(r == slot);
+    ubase_assert(ubuf_block_unmap(ubuf1, 0));
+
+    /* sole reference, the slot may be written in place */
+    uint8_t *w;
+    wanted = 1;
+    ubase_assert(ubuf_block_write(ubuf1, 0, &wanted, &w));
+    assert(w == slot);
+    ubase_assert(ubuf_block_unmap(ubuf1, 0));
+
+    ubuf2 = ubuf_dup(ubuf1);
+    assert(ubuf2 != NULL);
+    wanted = 1;
+    ubase_nassert(ubuf_block_write(ubuf1, 0, &wanted, &w));
+
+    ubuf3 = ubuf_block_splice(ubuf1, 10, 20);
+    assert(ubuf3 != NULL);
+    ubase_assert(ubuf_block_size(ubuf3, &size));
+    assert(size == 20);
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf3, 0, &wanted, &r));
+    assert(wanted == 20);
+    assert(r == slot + 10);
+    ubase_assert(ubuf_block_unmap(ubuf3, 0));
+
+    ubuf_free(ubuf1);
+    ubuf_free(ubuf2);
+    assert(!nb_released);
+
+    /* regular allocations go to the underlying manager */
+    ubuf1 = ubuf_block_alloc(mgr, UBUF_SIZE);
+    assert(ubuf1 != NULL);
+    assert(ubuf1->mgr == mem_mgr);
+    ubase_assert(ubuf_block_append(ubuf1, ubuf3));
+    ubase_assert(ubuf_block_size(ubuf1, &size));
+    assert(size == UBUF_SIZE + 20);
+    uint8_t buf[20];
+    ubase_assert(ubuf_block_extract(ubuf1, UBUF_SIZE, 20, buf));
+    for (int i = 0; i < 20; i++)
+        assert(buf[i] == i + 10);
+
+    /* merging segments copies into a regular buffer */
+    ubase_assert(ubuf_block_merge(mgr, &ubuf1, 0, UBUF_SIZE + 20));
+    assert(nb_released == 1);
+    ubase_assert(ubuf_block_extract(ubuf1, UBUF_SIZE, 20, buf));
+    for (int i = 0; i < 20; i++)
+        assert(buf[i] == i + 10);
+    ubuf_free(ubuf1);
+
+    /* without owner reference, the ubuf is always shared */
+    ubuf1 = ubuf_block_ext_alloc(mgr, slot, UBUF_SIZE, NULL);
+    assert(ubuf1 != NULL);
+    wanted = 1;
+    ubase_nassert(ubuf_block_write(ubuf1, 0, &wanted, &w));
+    ubuf_free(ubuf1);
+
+    ubuf_mgr_release(mgr);
+    ubuf_mgr_release(mem_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -46,6 +46,8 @@
 #define UBUF_APPEND         2
 #define UBUF_ALIGN          16
 #define UBUF_ALIGN_HOFFSET  0
+#define BLEND_HSIZE         80
+#define BLEND_VSIZE         4
 
 static void fill_in(struct ubuf *ubuf)
 {
@@ -72,6 +74,25 @@ static void fill_in(struct ubuf *ubuf)
     }
 }
 
+static void fill_in_16(struct ubuf *ubuf, int seed)
+{
+    const char *chroma;
+    ubuf_pic_foreach_plane(ubuf, chroma) {
+        size_t stride;
+        uint8_t hsub, vsub;
+        ubase_assert(ubuf_pic_plane_size(ubuf, chroma, &stride, &hsub, &vsub,
+                                         NULL));
+        uint8_t *buffer;
+        ubase_assert(ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1, &buffer));
+        for (int y = 0; y < BLEND_VSIZE / vsub; y++) {
+            uint16_t *line = (uint16_t *)(buffer + y * stride);
+            for (int x = 0; x < BLEND_HSIZE / hsub; x++)
+                line[x] = (x * 7 + y * 3 + seed) & 0x3ff;
+        }
+        ubase_assert(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1));
+    }
+}
+
 int main(int argc, char **argv)
 {
     struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
@@ -266,6 +287,55 @@ int main(int argc, char **argv)
     ubuf_free(ubuf1);
     ubuf_mgr_release(mgr);
 
+    /* alpha blending of 10-bit planes */
+    mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr, 1,
+                                 0, 0, 0, 0, UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "y10l", 1, 1, 2));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "u10l", 2, 2, 2));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "v10l", 2, 2, 2));
+
+    uint8_t alpha_plane[BLEND_HSIZE * BLEND_VSIZE];
+    for (int i = 0; i < BLEND_HSIZE * BLEND_VSIZE; i++)
+        alpha_plane[i] = i * 37;
+
+    for (int threshold = 0x80; threshold <= 0xff; threshold += 0x7f) {
+        ubuf1 = ubuf_pic_alloc(mgr, BLEND_HSIZE, BLEND_VSIZE);
+        ubuf2 = ubuf_pic_alloc(mgr, BLEND_HSIZE, BLEND_VSIZE);
+        assert(ubuf1 != NULL && ubuf2 != NULL);
+        fill_in_16(ubuf1, 0);
+        fill_in_16(ubuf2, 500);
+        ubase_assert(ubuf_pic_blit_alpha(ubuf1, ubuf2, 0, 0, 0, 0,
+                                         BLEND_HSIZE, BLEND_VSIZE,
+                                         alpha_plane, BLEND_HSIZE,
+                                         0xc0, threshold));
+
+        ubuf_pic_foreach_plane(ubuf1, chroma) {
+            size_t stride;
+            uint8_t hsub, vsub;
+            ubase_assert(ubuf_pic_plane_size(ubuf1, chroma, &stride,
+                                             &hsub, &vsub, NULL));
+            ubase_assert(ubuf_pic_plane_read(ubuf1, chroma, 0, 0, -1, -1, &r));
+            for (int y = 0; y < BLEND_VSIZE / vsub; y++) {
+                const uint16_t *line = (const uint16_t *)(r + y * stride);
+                for (int x = 0; x < BLEND_HSIZE / hsub; x++) {
+                    unsigned int d = (x * 7 + y * 3) & 0x3ff;
+                    unsigned int s = (x * 7 + y * 3 + 500) & 0x3ff;
+                    unsigned int a = alpha_plane[BLEND_HSIZE * y * vsub +
+                                                 x * hsub] * 0xc0 / 0xff;
+                    if (threshold == 0xff)
+                        assert(line[x] == (d * (0xff - a) + s * a) / 0xff);
+                    else
+                        assert(line[x] == (a > threshold ? s : d));
+                }
+            }
+            ubase_assert(ubuf_pic_plane_unmap(ubuf1, chroma, 0, 0, -1, -1));
+        }
+        ubuf_free(ubuf1);
+        ubuf_free(ubuf2);
+    }
+    ubuf_mgr_release(mgr);
+
     /* pic -> block transformation */
     mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr, 1,
                                  0, 0, 0, 0, 0, 0);
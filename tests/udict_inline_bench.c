@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short micro-benchmark of attribute lookups in the inline udict manager,
+ * with and without the attribute index
+ */
+
+#undef NDEBUG
+
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 1
+#define NB_NAMED 24
+#define DEFAULT_ITERATIONS 1000000
+
+/** shorthand attributes set on the benchmarked udict */
+static const enum udict_type shorthands[] = {
+    UDICT_TYPE_FLOW_ID, UDICT_TYPE_CLOCK_DURATION, UDICT_TYPE_CLOCK_LATENCY,
+    UDICT_TYPE_PIC_NUM, UDICT_TYPE_PIC_HSIZE, UDICT_TYPE_PIC_VSIZE,
+    UDICT_TYPE_PIC_HSIZE_VISIBLE, UDICT_TYPE_PIC_VSIZE_VISIBLE,
+    UDICT_TYPE_PIC_HPOSITION, UDICT_TYPE_PIC_VPOSITION,
+    UDICT_TYPE_PIC_LPADDING, UDICT_TYPE_PIC_RPADDING,
+};
+
+#define NB_SHORTHANDS (sizeof(shorthands) / sizeof(shorthands[0]))
+
+/** @This returns a monotonic date in nanoseconds. */
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** @This benchmarks lookups on a udict resembling a flow definition.
+ *
+ * @param mgr udict manager
+ * @param index true to enable the attribute index
+ * @param iterations number of iterations
+ * @return average duration of a lookup in nanoseconds
+ */
+static double bench(struct udict_mgr *mgr, bool index, unsigned iterations)
+{
+    char names[NB_NAMED][32];
+    ubase_assert(udict_inline_mgr_set_index(mgr, index));
+    struct udict *udict = udict_alloc(mgr, 0);
+    assert(udict != NULL);
+
+    ubase_assert(udict_set_string(udict, "block.mpegtsaligned.",
+                                  UDICT_TYPE_FLOW_DEF, NULL));
+    for (unsigned i = 0; i < NB_SHORTHANDS; i++)
+        ubase_assert(udict_set_unsigned(udict, i, shorthands[i], NULL));
+    for (unsigned i = 0; i < NB_NAMED; i++) {
+        sprintf(names[i], "x.ts_attribute_%u", i);
+        ubase_assert(udict_set_unsigned(udict, i, UDICT_TYPE_UNSIGNED,
+                                        names[i]));
+    }
+
+    uint64_t sum = 0;
+    uint64_t begin = now();
+    for (unsigned n = 0; n < iterations; n++) {
+        uint64_t u = 0;
+        unsigned i = n % (NB_SHORTHANDS + NB_NAMED);
+        if (i < NB_SHORTHANDS)
+            ubase_assert(udict_get_unsigned(udict, &u, shorthands[i], NULL));
+        else
+            ubase_assert(udict_get_unsigned(udict, &u, UDICT_TYPE_UNSIGNED,
+                                            names[i - NB_SHORTHANDS]));
+        sum += u;
+    }
+    uint64_t end = now();
+
+    /* every attribute was read the same number of times, +/- 1 */
+    assert(sum);
+    udict_free(udict);
+    return (double)(end - begin) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) :
+                                     DEFAULT_ITERATIONS;
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr,
+                                                   -1, -1);
+    assert(mgr != NULL);
+
+    /* warm up */
+    bench(mgr, false, iterations / 10 + 1);
+    bench(mgr, true, iterations / 10 + 1);
+
+    double linear = bench(mgr, false, iterations);
+    double indexed = bench(mgr, true, iterations);
+    printf("%u attributes, %u lookups\n",
+           (unsigned)(1 + NB_SHORTHANDS + NB_NAMED), iterations);
+    printf("linear:  %6.1f ns/lookup\n", linear);
+    printf("indexed: %6.1f ns/lookup (x%.1f)\n", indexed, linear / indexed);
+
+    udict_mgr_release(mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -47,6 +47,95 @@
 
 #define SALUTATION "Hello everyone, this is just some padding to make the structure bigger, if you don't mind."
 
+/** checks lookups with many attributes, deletions and duplication */
+static void check_many(struct udict_mgr *mgr, bool index,
+                       unsigned int nb_attrs)
+{
+    char name[32];
+    ubase_assert(udict_inline_mgr_set_index(mgr, index));
+    struct udict *udict = udict_alloc(mgr, 0);
+    assert(udict != NULL);
+
+    ubase_assert(udict_set_string(udict, "pouet", UDICT_TYPE_FLOW_DEF, NULL));
+    for (unsigned int i = 0; i < nb_attrs; i++) {
+        sprintf(name, "x.attr%u", i);
+        ubase_assert(udict_set_unsigned(udict, i, UDICT_TYPE_UNSIGNED, name));
+        ubase_assert(udict_set_unsigned(udict, i, UDICT_TYPE_PIC_HSIZE,
+                                        NULL));
+        /* same name, different type */
+        if (i % 2)
+            ubase_assert(udict_set_int(udict, -(int64_t)i, UDICT_TYPE_INT,
+                                       name));
+    }
+
+    for (unsigned int i = 0; i < nb_attrs; i += 3) {
+        sprintf(name, "x.attr%u", i);
+        ubase_assert(udict_delete(udict, UDICT_TYPE_UNSIGNED, name));
+    }
+    /* grow an attribute, which moves it to the end */
+    ubase_assert(udict_set_string(udict, "pouet pouet", UDICT_TYPE_FLOW_DEF,
+                                  NULL));
+
+    struct udict *dup = udict_dup(udict);
+    assert(dup != NULL);
+    struct udict *udicts[] = { udict, dup };
+    for (unsigned int j = 0; j < 2; j++) {
+        for (unsigned int i = 0; i < nb_attrs; i++) {
+            uint64_t u;
+            int64_t d;
+            sprintf(name, "x.attr%u", i);
+            if (i % 3)
+                ubase_assert(udict_get_unsigned(udicts[j], &u,
+                                                UDICT_TYPE_UNSIGNED, name));
+            else
+                ubase_nassert(udict_get_unsigned(udicts[j], &u,
+                                                 UDICT_TYPE_UNSIGNED, name));
+            assert(!(i % 3) || u == i);
+            if (i % 2) {
+                ubase_assert(udict_get_int(udicts[j], &d, UDICT_TYPE_INT,
+                                           name));
+                assert(d == -(int64_t)i);
+            } else
+                ubase_nassert(udict_get_int(udicts[j], &d, UDICT_TYPE_INT,
+                                            name));
+        }
+        uint64_t u;
+        ubase_assert(udict_get_unsigned(udicts[j], &u, UDICT_TYPE_PIC_HSIZE,
+                                        NULL));
+        assert(u == nb_attrs - 1);
+        const char *string;
+        ubase_assert(udict_get_string(udicts[j], &string, UDICT_TYPE_FLOW_DEF,
+                                      NULL));
+        assert(!strcmp(string, "pouet pouet"));
+        ubase_nassert(udict_get_void(udicts[j], NULL, UDICT_TYPE_VOID,
+                                     "x.attr1"));
+    }
+
+    /* attributes are copied on write */
+    uint64_t u;
+    ubase_assert(udict_set_unsigned(dup, 42, UDICT_TYPE_UNSIGNED, "x.attr1"));
+    ubase_assert(udict_delete(udict, UDICT_TYPE_UNSIGNED, "x.attr2"));
+    ubase_assert(udict_get_unsigned(udict, &u, UDICT_TYPE_UNSIGNED, "x.attr1"));
+    assert(u == 1);
+    ubase_assert(udict_get_unsigned(dup, &u, UDICT_TYPE_UNSIGNED, "x.attr1"));
+    assert(u == 42);
+    ubase_nassert(udict_get_unsigned(udict, &u, UDICT_TYPE_UNSIGNED,
+                                     "x.attr2"));
+    ubase_assert(udict_get_unsigned(dup, &u, UDICT_TYPE_UNSIGNED, "x.attr2"));
+    assert(u == 2);
+
+    /* the last reference may be the duplicate */
+    struct udict *dup2 = udict_dup(dup);
+    assert(dup2 != NULL);
+    udict_free(dup);
+    ubase_assert(udict_get_unsigned(dup2, &u, UDICT_TYPE_UNSIGNED, "x.attr1"));
+    assert(u == 42);
+    ubase_assert(udict_set_unsigned(dup2, 43, UDICT_TYPE_UNSIGNED, "x.attr1"));
+
+    udict_free(dup2);
+    udict_free(udict);
+}
+
 int main(int argc, char **argv)
 {
     struct uprobe *uprobe = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_DEBUG);
@@ -131,6 +220,10 @@ int main(int argc, char **argv)
     udict_free(udict2);
 
     udict_free(udict1);
+
+    check_many(mgr, true, 20);
+    check_many(mgr, true, 100);
+    check_many(mgr, false, 100);
     udict_mgr_release(mgr);
 
     umem_mgr_release(umem_mgr);
@@ -29,14 +29,29 @@
 
 #undef NDEBUG
 
+#include <upipe/ubase.h>
 #include <upipe/umem.h>
 #include <upipe/umem_pool.h>
 
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include <assert.h>
 
+#define NB_BUFFERS 256
+#define NB_LOOPS 100
+
+static struct umem umems[NB_BUFFERS];
+
+/** frees buffers allocated by the main thread */
+static void *free_thread(void *unused)
+{
+    for (unsigned int i = 0; i < NB_BUFFERS; i++)
+        umem_free(&umems[i]);
+    return NULL;
+}
+
 int main(int argc, char **argv)
 {
     struct umem_mgr *mgr = umem_pool_mgr_alloc_simple(32);
@@ -87,6 +102,51 @@ int main(int argc, char **argv)
     umem_free(&umem);
     printf("Passed 6\n");
 
+    struct umem_pool_stats stats;
+    size_t size;
+    ubase_assert(umem_pool_mgr_get_stats(mgr, 8, &size, &stats));
+    assert(size == 8192);
+    assert(stats.hits == 1);
+    assert(stats.misses == 1);
+    ubase_nassert(umem_pool_mgr_get_stats(mgr, 18, NULL, &stats));
+    printf("Passed 7\n");
+
+    /* allocate in a thread and free in another */
+    for (unsigned int loop = 0; loop < NB_LOOPS; loop++) {
+        for (unsigned int i = 0; i < NB_BUFFERS; i++) {
+            assert(umem_alloc(mgr, &umems[i], 1000));
+            memset(umem_buffer(&umems[i]), loop, 1000);
+        }
+        pthread_t thread;
+        assert(!pthread_create(&thread, NULL, free_thread, NULL));
+        assert(!pthread_join(thread, NULL));
+    }
+    ubase_assert(umem_pool_mgr_get_stats(mgr, 5, &size, &stats));
+    assert(size == 1024);
+    assert(stats.hits + stats.depot_hits + stats.misses ==
+           NB_BUFFERS * NB_LOOPS);
+    assert(stats.depot_hits);
+    assert(stats.releases);
+    printf("Passed 8\n");
+
+    /* the caches never hold more buffers than the depth of the pool */
+    umem_mgr_vacuum(mgr);
+    for (unsigned int i = 0; i < NB_BUFFERS; i++)
+        assert(umem_alloc(mgr, &umems[i], 1000));
+    for (unsigned int i = 0; i < NB_BUFFERS; i++)
+        umem_free(&umems[i]);
+    struct umem_pool_stats prev_stats;
+    ubase_assert(umem_pool_mgr_get_stats(mgr, 5, NULL, &prev_stats));
+    for (unsigned int i = 0; i < NB_BUFFERS; i++)
+        assert(umem_alloc(mgr, &umems[i], 1000));
+    ubase_assert(umem_pool_mgr_get_stats(mgr, 5, NULL, &stats));
+    assert(stats.hits + stats.depot_hits -
+           prev_stats.hits - prev_stats.depot_hits <= 32);
+    for (unsigned int i = 0; i < NB_BUFFERS; i++)
+        umem_free(&umems[i]);
+    printf("Passed 9\n");
+
+    umem_mgr_vacuum(mgr);
     umem_mgr_release(mgr);
     return 0;
 }
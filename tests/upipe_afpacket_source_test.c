@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for afpacket source pipe
+ *
+ * Capturing needs CAP_NET_RAW; the test is skipped without it.
+ */
+
+#undef NDEBUG
+
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uref_mgr.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-afpacket/upipe_afpacket_source.h>
+#include <upipe/upipe_helper_upipe.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define BUF_SIZE 256
+#define FORMAT "This is packet number %d"
+#define PORT 42127
+#define NB_PACKETS 100
+#define NB_KEPT 16
+
+static int counter = 0;
+static struct upump *write_pump;
+static struct upipe *upipe_afpacket_source;
+static int sockfd;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+struct afpacket_test {
+    int counter;
+    struct uchain urefs;
+    unsigned int nb_urefs;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+UPIPE_HELPER_UPIPE(afpacket_test, upipe, 0);
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct afpacket_test *afpacket_test = malloc(sizeof(struct afpacket_test));
+    assert(afpacket_test != NULL);
+    afpacket_test->counter = 0;
+    ulist_init(&afpacket_test->urefs);
+    afpacket_test->nb_urefs = 0;
+    upipe_init(&afpacket_test->upipe, mgr, uprobe);
+    upipe_throw_ready(&afpacket_test->upipe);
+    return &afpacket_test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct afpacket_test *afpacket_test = afpacket_test_from_upipe(upipe);
+    char str[BUF_SIZE];
+    const uint8_t *buffer;
+    int size = -1;
+    uint64_t cr_sys;
+    assert(uref != NULL);
+
+    ubase_assert(uref_clock_get_cr_sys(uref, &cr_sys));
+    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
+    assert(size == BUF_SIZE);
+    snprintf(str, sizeof(str), FORMAT, afpacket_test->counter);
+    assert(!strncmp(str, (const char *)buffer, BUF_SIZE));
+    uref_block_unmap(uref, 0);
+    afpacket_test->counter++;
+
+    /* buffers point into the ring, and can't be written */
+    size = -1;
+    uint8_t *wbuffer;
+    assert(!ubase_check(uref_block_write(uref, 0, &size, &wbuffer)));
+
+    /* duplicates and splices share the ring block */
+    struct uref *dup = uref_dup(uref);
+    assert(dup != NULL);
+    ubase_assert(uref_block_resize(dup, 8, 16));
+    ubase_assert(uref_block_read(dup, 0, &size, &buffer));
+    assert(size == 16 && !strncmp(str + 8, (const char *)buffer, 16));
+    uref_block_unmap(dup, 0);
+    uref_free(dup);
+
+    /* keep a few urefs to hold blocks of the ring */
+    ulist_add(&afpacket_test->urefs, uref_to_uchain(uref));
+    if (++afpacket_test->nb_urefs > NB_KEPT) {
+        uref_free(uref_from_uchain(ulist_pop(&afpacket_test->urefs)));
+        afpacket_test->nb_urefs--;
+    }
+
+    if (afpacket_test->counter == NB_PACKETS)
+        /* the ring must outlive the pipe while urefs are kept */
+        ubase_assert(upipe_set_uri(upipe_afpacket_source, NULL));
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_dbg_va(upipe, "releasing pipe %p", upipe);
+    upipe_throw_dead(upipe);
+    struct afpacket_test *afpacket_test = afpacket_test_from_upipe(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&afpacket_test->urefs)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+    upipe_clean(upipe);
+    free(afpacket_test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr afpacket_test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a datagram to the given port */
+static void send_packet(uint16_t port, const uint8_t *buf)
+{
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(sockfd, buf, BUF_SIZE, 0, (struct sockaddr *)&sin, sizeof(sin));
+}
+
+/* packet generator */
+static void genpackets(struct upump *unused)
+{
+    uint8_t buf[BUF_SIZE];
+    if (counter >= NB_PACKETS) {
+        upump_stop(write_pump);
+        return;
+    }
+    for (int i = 0; i < 10; i++) {
+        memset(buf, 0, sizeof(buf));
+        snprintf((char *)buf, BUF_SIZE, FORMAT, counter);
+        counter++;
+        send_packet(PORT, buf);
+
+        /* filtered out */
+        memset(buf, 0, sizeof(buf));
+        send_packet(PORT + 1, buf);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0) {
+        fprintf(stderr, "can't open packet socket (%m), skipping\n");
+        return 77;
+    }
+    close(fd);
+
+    /* env */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH,
+                                                   udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    struct upipe *afpacket_test = upipe_void_alloc(&afpacket_test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "afpacket_test"));
+    assert(afpacket_test != NULL);
+
+    struct upipe_mgr *upipe_afpacket_source_mgr =
+        upipe_afpacket_source_mgr_alloc();
+    assert(upipe_afpacket_source_mgr != NULL);
+    upipe_afpacket_source = upipe_void_alloc(upipe_afpacket_source_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "afpacket source"));
+    assert(upipe_afpacket_source != NULL);
+    ubase_assert(upipe_set_output(upipe_afpacket_source, afpacket_test));
+    ubase_assert(upipe_attach_uclock(upipe_afpacket_source));
+
+    /* invalid uris */
+    ubase_nassert(upipe_set_uri(upipe_afpacket_source, "@127.0.0.1:42127"));
+    ubase_nassert(upipe_set_uri(upipe_afpacket_source,
+                                "@127.0.0.1:42127/ifname=lo/block-size=1000"));
+
+    char uri[256];
+    snprintf(uri, sizeof(uri), "@127.0.0.1:%d/ifname=lo/blocks=8/"
+             "block-size=%d", PORT, getpagesize() * 4);
+    ubase_assert(upipe_set_uri(upipe_afpacket_source, uri));
+    const char *uri_p;
+    ubase_assert(upipe_get_uri(upipe_afpacket_source, &uri_p));
+    assert(!strcmp(uri_p, uri));
+
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(sockfd != -1);
+
+    write_pump = upump_alloc_idler(upump_mgr, genpackets, NULL, NULL);
+    assert(write_pump);
+    upump_start(write_pump);
+
+    /* fire */
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(afpacket_test_from_upipe(afpacket_test)->counter == NB_PACKETS);
+    close(sockfd);
+
+    /* release */
+    upump_free(write_pump);
+    upipe_release(upipe_afpacket_source);
+    test_free(afpacket_test);
+    upipe_mgr_release(upipe_afpacket_source_mgr); /* nop */
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
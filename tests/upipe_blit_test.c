@@ -377,6 +377,27 @@ int main(int argc, char **argv)
     upipe_input(blit, uref, NULL);
     ubase_assert(upipe_blit_prepare(blit, NULL));
 
+    /* same composition, sliced into bands */
+    unsigned int threads;
+    ubase_assert(upipe_blit_get_threads(blit, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_blit_set_threads(blit, 0));
+    ubase_assert(upipe_blit_set_threads(blit, 3));
+    ubase_assert(upipe_blit_get_threads(blit, &threads));
+    assert(threads == 3);
+
+    for (int i = 0; i < 2; i++) {
+        uref = uref_pic_alloc(uref_mgr, pic_mgr, BGSIZE, BGSIZE);
+        assert(uref != NULL);
+        uref_pic_set_progressive(uref);
+        fill_in(uref, "y8", 0);
+        fill_in(uref, "u8", 0);
+        fill_in(uref, "v8", 0);
+        uref_attr_set_priv(uref, 1);
+        upipe_input(blit, uref, NULL);
+        ubase_assert(upipe_blit_prepare(blit, NULL));
+    }
+
     /* release blit pipe and subpipes */
     upipe_release(subpipe1);
     upipe_release(subpipe2);
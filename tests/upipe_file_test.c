@@ -48,7 +48,11 @@
 #include <upipe/uref.h>
 #include <upipe/uref_std.h>
 #include <upipe/upump.h>
+#ifdef UPIPE_FILE_TEST_URING
+#include <upump-uring/upump_uring.h>
+#else
 #include <upump-ev/upump_ev.h>
+#endif
 #include <upipe/upipe.h>
 #include <upipe-modules/upipe_file_source.h>
 #include <upipe-modules/upipe_file_sink.h>
@@ -127,8 +131,14 @@ int main(int argc, char *argv[])
     struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
                                                    0);
     assert(uref_mgr != NULL);
+#ifdef UPIPE_FILE_TEST_URING
+    /* reads and writes are queued on the ring */
+    struct upump_mgr *upump_mgr = upump_uring_mgr_alloc(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+#else
     struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
             UPUMP_BLOCKER_POOL);
+#endif
     assert(upump_mgr != NULL);
     struct uclock *uclock = uclock_std_alloc(0);
     assert(uclock != NULL);
@@ -0,0 +1,20 @@
+#!/bin/sh
+
+set -e
+
+srcdir="$1"
+
+TMP="`mktemp -d tmp.XXXXXXXXXX`"
+cleanup() { rm -rf "$TMP"; }
+trap cleanup EXIT
+
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_uring_test Makefile "$TMP"/test > "$TMP"/log
+cmp --quiet "$TMP"/test Makefile
+if grep -q "can't queue" "$TMP"/log; then
+    echo "reads and writes were not queued"
+    exit 1
+fi
+
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_uring_test -a Makefile "$TMP"/test > /dev/null
+cat Makefile Makefile > "$TMP"/twice
+cmp --quiet "$TMP"/test "$TMP"/twice
@@ -41,8 +41,8 @@
 #include <upipe/uref_pic.h>
 #include <upipe/uref_std.h>
 #include <upipe/upipe.h>
+#include <upipe/uref_flow.h>
 #include <upipe-filters/upipe_filter_blend.h>
-#include <upipe-modules/upipe_null.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -64,6 +64,8 @@
 
 static struct ubuf_mgr *ubuf_mgr;
 static struct uref_mgr *uref_mgr;
+static int counter = 0;
+static int nb_received = 0;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -81,10 +83,90 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** value of a component of an input pixel */
+static uint8_t pixel(int x, int y, int c)
+{
+    return c ? x + y + counter * 3 * 10 : x + y + counter * 3;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe checking the merged lines */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    const uint8_t *buf;
+    size_t stride = 0;
+    uint8_t macropixel = 0;
+    ubase_assert(uref_pic_plane_size(uref, "r8g8b8", &stride, NULL, NULL,
+                                     &macropixel));
+    ubase_assert(uref_pic_plane_read(uref, "r8g8b8", 0, 0, -1, -1, &buf));
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            for (int c = 0; c < 3; c++) {
+                uint8_t expected = y ? (pixel(x, y - 1, c) +
+                                        pixel(x, y, c) + 1) >> 1 :
+                                       pixel(x, y, c);
+                assert(buf[macropixel * x + c] == expected);
+            }
+        }
+        buf += stride;
+    }
+    uref_pic_plane_unmap(uref, "r8g8b8", 0, 0, -1, -1);
+    uref_free(uref);
+    nb_received++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "pic."));
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
 int main(int argc, char **argv)
 {
     printf("Compiled %s %s (%s)\n", __DATE__, __TIME__, __FILE__);
-    static int counter = 0;
     int x, y;
     uint8_t *buf, macropixel = 0;
     size_t stride = 0;
@@ -114,14 +196,11 @@ int main(int argc, char **argv)
                                    UBUF_POOL_DEPTH);
     assert(logger != NULL);
 
-    /* nullpipe */
-    struct upipe_mgr *null_mgr = upipe_null_mgr_alloc();
-    struct upipe *nullpipe = upipe_void_alloc(null_mgr,
-            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "null"));
-    assert(nullpipe);
-    ubase_assert(upipe_null_dump_dict(nullpipe, true));
+    /* test pipe */
+    struct upipe *test = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(test != NULL);
 
-    struct uref *uref = uref_pic_flow_alloc_def(uref_mgr, 3);
+    struct uref *uref = uref_pic_flow_alloc_def(uref_mgr, 1);
     ubase_assert(uref_pic_flow_add_plane(uref, 1, 1, 3, "r8g8b8"));
     assert(uref);
 
@@ -131,11 +210,22 @@ int main(int argc, char **argv)
             uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "blend"));
     assert(filter_blend);
     ubase_assert(upipe_set_flow_def(filter_blend, uref));
-    ubase_assert(upipe_set_output(filter_blend, nullpipe));
-    upipe_release(nullpipe);
+    ubase_assert(upipe_set_output(filter_blend, test));
     uref_free(uref);
 
-    for (counter=0; counter < 10; counter++) {
+    unsigned int threads;
+    ubase_assert(upipe_filter_blend_get_threads(filter_blend, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_filter_blend_set_threads(filter_blend, 0));
+
+    for (counter=0; counter < 20; counter++) {
+        if (counter == 10) {
+            /* odd number of threads, so that slices start on odd lines */
+            ubase_assert(upipe_filter_blend_set_threads(filter_blend, 3));
+            ubase_assert(upipe_filter_blend_get_threads(filter_blend,
+                                                        &threads));
+            assert(threads == 3);
+        }
         printf("Sending pic %d\n", counter);
         pic = uref_pic_alloc(uref_mgr, ubuf_mgr, WIDTH, HEIGHT);
         assert(pic);
@@ -153,11 +243,13 @@ int main(int argc, char **argv)
         upipe_input(filter_blend, pic, NULL);
     }
 
+    assert(nb_received == 20);
+
     // Clean - release
     upipe_release(filter_blend);
+    test_free(test);
 
     upipe_mgr_release(blend_mgr); // noop
-    upipe_mgr_release(null_mgr); // noop
     ubuf_mgr_release(ubuf_mgr);
     uref_mgr_release(uref_mgr);
     uprobe_release(logger);
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for SMPTE 2022-6 packetizer and depacketizer
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/uclock.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-hbrmt/upipe_hbrmt_enc.h>
+#include <upipe-hbrmt/upipe_hbrmt_dec.h>
+
+#include <bitstream/ietf/rtp.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+/* 720p60: 1650x750 raster, 10 bits per sample, 2 samples per pixel */
+#define FRAME_SIZE (1650 * 750 * 5 / 2)
+#define DATA_SIZE 1376
+#define NB_PACKETS ((FRAME_SIZE + DATA_SIZE - 1) / DATA_SIZE)
+#define DURATION (UCLOCK_FREQ / 60)
+#define NB_FRAMES 3
+
+static struct upipe *upipe_hbrmt_dec;
+static unsigned int nb_datagrams = 0;
+static unsigned int nb_frames = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe checking datagrams and forwarding them */
+static void test_rtp_input(struct upipe *upipe, struct uref *uref,
+                           struct upump **upump_p)
+{
+    assert(uref != NULL);
+    unsigned int frame = nb_datagrams / NB_PACKETS;
+    unsigned int packet = nb_datagrams % NB_PACKETS;
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == RTP_HEADER_SIZE + 8 + DATA_SIZE);
+
+    uint8_t buf[RTP_HEADER_SIZE + 8];
+    ubase_assert(uref_block_extract(uref, 0, sizeof(buf), buf));
+    assert(rtp_check_hdr(buf));
+    assert(rtp_get_type(buf) == 98);
+    assert(rtp_get_seqnum(buf) == (nb_datagrams & UINT16_MAX));
+    assert(!rtp_check_marker(buf) == (packet != NB_PACKETS - 1));
+    assert(buf[RTP_HEADER_SIZE + 1] == frame);
+
+    uint64_t cr_sys;
+    ubase_assert(uref_clock_get_cr_sys(uref, &cr_sys));
+    assert(cr_sys == UCLOCK_FREQ + frame * DURATION +
+                     (uint64_t)packet * DURATION / NB_PACKETS);
+
+    nb_datagrams++;
+    upipe_input(upipe_hbrmt_dec, uref, upump_p);
+}
+
+/** helper phony pipe */
+static int test_rtp_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "block.rtp."));
+            return upipe_set_flow_def(upipe_hbrmt_dec, flow_def);
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe checking reassembled frames */
+static void test_frame_input(struct upipe *upipe, struct uref *uref,
+                             struct upump **upump_p)
+{
+    assert(uref != NULL);
+    /* the first frame is only used to synchronize */
+    unsigned int frame = nb_frames + 1;
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == FRAME_SIZE);
+
+    const uint8_t *buf;
+    int read_size = -1;
+    ubase_assert(uref_block_read(uref, 0, &read_size, &buf));
+    assert(read_size == FRAME_SIZE);
+    for (int i = 0; i < FRAME_SIZE; i++)
+        assert(buf[i] == ((i + frame) & 0xff));
+    uref_block_unmap(uref, 0);
+
+    nb_frames++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_frame_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "block."));
+            uint64_t hsize, vsize;
+            ubase_assert(uref_pic_flow_get_hsize(flow_def, &hsize));
+            ubase_assert(uref_pic_flow_get_vsize(flow_def, &vsize));
+            assert(hsize == 1280 && vsize == 720);
+            ubase_assert(uref_pic_get_progressive(flow_def));
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_rtp_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_rtp_input,
+    .upipe_control = test_rtp_control
+};
+
+/** helper phony pipe */
+static struct upipe_mgr test_frame_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_frame_input,
+    .upipe_control = test_frame_control
+};
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr,
+                                                         0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+
+    uprobe_stdio = uprobe_ubuf_mem_alloc(uprobe_stdio, umem_mgr,
+            UBUF_POOL_DEPTH, UBUF_POOL_DEPTH);
+    assert(uprobe_stdio != NULL);
+
+    struct upipe_mgr *upipe_hbrmt_dec_mgr = upipe_hbrmt_dec_mgr_alloc();
+    assert(upipe_hbrmt_dec_mgr != NULL);
+    upipe_hbrmt_dec = upipe_void_alloc(upipe_hbrmt_dec_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "hbrmt dec"));
+    assert(upipe_hbrmt_dec != NULL);
+
+    struct upipe *frame_sink = upipe_void_alloc(&test_frame_mgr,
+                                                uprobe_use(uprobe_stdio));
+    assert(frame_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_hbrmt_dec, frame_sink));
+
+    struct uref *uref;
+    uref = uref_block_flow_alloc_def(uref_mgr, "");
+    assert(uref != NULL);
+    ubase_assert(uref_pic_flow_set_hsize(uref, 1280));
+    ubase_assert(uref_pic_flow_set_vsize(uref, 720));
+    struct urational fps = { .num = 60, .den = 1 };
+    ubase_assert(uref_pic_flow_set_fps(uref, fps));
+    ubase_assert(uref_pic_set_progressive(uref));
+
+    struct upipe_mgr *upipe_hbrmt_enc_mgr = upipe_hbrmt_enc_mgr_alloc();
+    assert(upipe_hbrmt_enc_mgr != NULL);
+    struct upipe *upipe_hbrmt_enc = upipe_void_alloc(upipe_hbrmt_enc_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "hbrmt enc"));
+    assert(upipe_hbrmt_enc != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_hbrmt_enc, uref));
+    uref_free(uref);
+
+    struct upipe *rtp_sink = upipe_void_alloc(&test_rtp_mgr,
+                                              uprobe_use(uprobe_stdio));
+    assert(rtp_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_hbrmt_enc, rtp_sink));
+
+    for (int frame = 0; frame < NB_FRAMES; frame++) {
+        uint8_t *buffer;
+        int size = -1;
+        uref = uref_block_alloc(uref_mgr, ubuf_mgr, FRAME_SIZE);
+        assert(uref != NULL);
+        ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+        assert(size == FRAME_SIZE);
+        for (int i = 0; i < FRAME_SIZE; i++)
+            buffer[i] = i + frame;
+        uref_block_unmap(uref, 0);
+
+        uref_clock_set_pts_sys(uref, UCLOCK_FREQ + frame * DURATION);
+        uref_clock_set_cr_sys(uref, UCLOCK_FREQ + frame * DURATION);
+        upipe_input(upipe_hbrmt_enc, uref, NULL);
+    }
+    assert(nb_datagrams == NB_FRAMES * NB_PACKETS);
+    assert(nb_frames == NB_FRAMES - 1);
+
+    upipe_release(upipe_hbrmt_enc);
+    upipe_release(upipe_hbrmt_dec);
+    upipe_mgr_release(upipe_hbrmt_enc_mgr); // nop
+    upipe_mgr_release(upipe_hbrmt_dec_mgr); // nop
+
+    test_free(rtp_sink);
+    test_free(frame_sink);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe_stdio);
+
+    return 0;
+}
@@ -186,19 +186,34 @@ int main(int argc, char *argv[])
     assert(sink != NULL);
     ubase_assert(upipe_set_output(upipe_pack10, sink));
 
-    uint8_t *buffer;
-    int size;
-    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 2*WIDTH);
-    assert(uref != NULL);
-    size = -1;
-    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
-    assert(size == 2*WIDTH);
-    uint16_t *pixels_buf = (uint16_t*)buffer;
-    for (int i = 0; i < WIDTH; i++)
-        pixels_buf[i] = i;
-    uref_block_unmap(uref, 0);
-    upipe_input(upipe_pack10, uref, NULL);
-    assert(received_block);
+    unsigned int threads;
+    ubase_assert(upipe_pack10bit_get_threads(upipe_pack10, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_pack10bit_set_threads(upipe_pack10, 0));
+
+    for (int n = 0; n < 2; n++) {
+        if (n == 1) {
+            /* slices do not end on a multiple of the SIMD width */
+            ubase_assert(upipe_pack10bit_set_threads(upipe_pack10, 3));
+            ubase_assert(upipe_pack10bit_get_threads(upipe_pack10, &threads));
+            assert(threads == 3);
+        }
+
+        uint8_t *buffer;
+        int size;
+        uref = uref_block_alloc(uref_mgr, ubuf_mgr, 2*WIDTH);
+        assert(uref != NULL);
+        size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+        assert(size == 2*WIDTH);
+        uint16_t *pixels_buf = (uint16_t*)buffer;
+        for (int i = 0; i < WIDTH; i++)
+            pixels_buf[i] = i;
+        uref_block_unmap(uref, 0);
+        received_block = false;
+        upipe_input(upipe_pack10, uref, NULL);
+        assert(received_block);
+    }
 
     upipe_release(upipe_pack10);
     upipe_mgr_release(upipe_pack10bit_mgr); // nop
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2014-2019 OpenHeadend S.A.R.L.
+ *
+ * Authors: Christophe Massiot
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for upipe_pthread_worker (using upump_ev)
+ */
+
+#undef NDEBUG
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe-pthread/uprobe_pthread_upump_mgr.h>
+#include <upipe-pthread/uprobe_pthread_assert.h>
+#include <upipe-pthread/upipe_pthread_worker.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_null.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define XFER_QUEUE 255
+#define XFER_POOL 1
+#define WLIN_QUEUE 1
+#define THREAD_NAME "wlin_test"
+
+static struct uprobe *logger;
+static bool transferred = false;
+static unsigned int nb_packets = 0;
+static pthread_t wlin_thread_id;
+static int wlin_cpu = -1;
+
+/** checks that we run in the worker thread, with its attributes */
+static void test_check_thread(void)
+{
+    assert(pthread_equal(pthread_self(), wlin_thread_id));
+#ifdef __linux__
+    char name[16];
+    assert(!pthread_getname_np(pthread_self(), name, sizeof(name)));
+    assert(!strcmp(name, THREAD_NAME));
+
+    if (wlin_cpu >= 0) {
+        cpu_set_t cpuset;
+        assert(!pthread_getaffinity_np(pthread_self(), sizeof(cpuset),
+                                       &cpuset));
+        assert(CPU_COUNT(&cpuset) == 1);
+        assert(CPU_ISSET(wlin_cpu, &cpuset));
+    }
+#endif
+}
+
+/** helper phony pipe */
+struct test_pipe {
+    struct urefcount urefcount;
+    struct upipe *output;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static void test_free(struct urefcount *urefcount)
+{
+    struct test_pipe *test_pipe =
+        container_of(urefcount, struct test_pipe, urefcount);
+    upipe_dbg(&test_pipe->upipe, "dead");
+    test_check_thread();
+    upipe_release(test_pipe->output);
+    urefcount_clean(&test_pipe->urefcount);
+    upipe_clean(&test_pipe->upipe);
+    free(test_pipe);
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe, uint32_t signature,
+                                va_list args)
+{
+    struct test_pipe *test_pipe = malloc(sizeof(struct test_pipe));
+    assert(test_pipe != NULL);
+    upipe_init(&test_pipe->upipe, mgr, uprobe);
+    urefcount_init(&test_pipe->urefcount, test_free);
+    test_pipe->upipe.refcount = &test_pipe->urefcount;
+    test_pipe->output = NULL;
+    return &test_pipe->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test_pipe *test_pipe = container_of(upipe, struct test_pipe, upipe);
+    upipe_dbg(upipe, "input");
+    test_check_thread();
+    upipe_input(test_pipe->output, uref, upump_p);
+    nb_packets--;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    struct test_pipe *test_pipe = container_of(upipe, struct test_pipe, upipe);
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR: {
+            upipe_dbg(upipe, "attached");
+            transferred = true;
+            test_check_thread();
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            *p = test_pipe->output;
+            if (transferred)
+                test_check_thread();
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SET_OUTPUT: {
+            upipe_dbg(upipe, "output set");
+            struct upipe *output = va_arg(args, struct upipe *);
+            assert(output != NULL);
+            test_pipe->output = upipe_use(output);
+            if (transferred)
+                test_check_thread();
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SET_FLOW_DEF: {
+            upipe_dbg(upipe, "flow_def set");
+            test_check_thread();
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_set_flow_def(test_pipe->output, flow_def);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe, int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_NEED_UPUMP_MGR:
+        case UPROBE_SOURCE_END:
+        case UPROBE_STALLED:
+            break;
+        default:
+            assert(0);
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+                                                             UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_VERBOSE);
+    assert(logger != NULL);
+    logger = uprobe_pthread_upump_mgr_alloc(logger);
+    assert(logger != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+
+    struct uprobe *uprobe_main = uprobe_pthread_assert_alloc(uprobe_use(logger));
+    assert(uprobe_main != NULL);
+    uprobe_pthread_assert_set(uprobe_main, pthread_self());
+    struct uprobe *uprobe_remote =
+        uprobe_pthread_assert_alloc(uprobe_use(logger));
+    assert(uprobe_remote != NULL);
+
+    /* pin the worker on the first CPU we are allowed to run on */
+    struct upipe_pthread_xfer_attr xfer_attr;
+    upipe_pthread_xfer_attr_init(&xfer_attr);
+#ifdef __linux__
+    cpu_set_t cpuset;
+    assert(!sched_getaffinity(0, sizeof(cpuset), &cpuset));
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        if (CPU_ISSET(cpu, &cpuset)) {
+            wlin_cpu = cpu;
+            break;
+        }
+    assert(wlin_cpu >= 0);
+    assert(upipe_pthread_xfer_attr_add_cpu(&xfer_attr, wlin_cpu));
+#endif
+
+    struct upipe *upipe_test = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_remote), UPROBE_LOG_VERBOSE,
+                             "test"));
+    assert(upipe_test != NULL);
+
+    struct upipe_mgr *upipe_wlin_mgr =
+        upipe_pthread_wlin_mgr_alloc(XFER_QUEUE, XFER_POOL,
+                                     uprobe_use(logger),
+                                     upump_ev_mgr_alloc_loop,
+                                     UPUMP_POOL, UPUMP_BLOCKER_POOL, NULL,
+                                     &wlin_thread_id, &xfer_attr,
+                                     THREAD_NAME);
+    assert(upipe_wlin_mgr != NULL);
+    uprobe_pthread_assert_set(uprobe_remote, wlin_thread_id);
+
+    uprobe_throw(uprobe_main, NULL, UPROBE_FREEZE_UPUMP_MGR);
+    struct upipe *upipe_handle = upipe_wlin_alloc(upipe_wlin_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_main), UPROBE_LOG_VERBOSE,
+                             "wlin"),
+            upipe_test,
+            uprobe_pfx_alloc(uprobe_use(uprobe_remote), UPROBE_LOG_VERBOSE,
+                             "wlin_x"),
+            WLIN_QUEUE, WLIN_QUEUE);
+    /* from now on upipe_test shouldn't be accessed from this thread */
+    assert(upipe_handle != NULL);
+    upipe_mgr_release(upipe_wlin_mgr);
+    uprobe_throw(uprobe_main, NULL, UPROBE_THAW_UPUMP_MGR);
+    upipe_attach_upump_mgr(upipe_handle);
+
+    struct upipe_mgr *upipe_null_mgr = upipe_null_mgr_alloc();
+    assert(upipe_null_mgr != NULL);
+    struct upipe *null = upipe_void_alloc(upipe_null_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_main), UPROBE_LOG_VERBOSE,
+                             "null"));
+    assert(null != NULL);
+    upipe_mgr_release(upipe_null_mgr);
+    upipe_set_output(upipe_handle, null);
+    upipe_release(null);
+
+    struct uref *uref = uref_alloc(uref_mgr);
+    ubase_assert(uref_flow_set_def(uref, "void."));
+    ubase_assert(upipe_set_flow_def(upipe_handle, uref));
+    uref_flow_delete_def(uref);
+    nb_packets++;
+    upipe_input(upipe_handle, uref, NULL);
+    upipe_release(upipe_handle);
+
+    /* the thread is joined by the transfer manager from this event loop */
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(transferred);
+    assert(!nb_packets);
+
+    uprobe_release(uprobe_remote);
+    uprobe_release(uprobe_main);
+
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
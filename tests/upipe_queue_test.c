@@ -43,6 +43,7 @@
 #include <upipe/uref_flow.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/upump.h>
+#include <upipe/upump_blocker.h>
 #include <upump-ev/upump_ev.h>
 #include <upipe/upipe.h>
 #include <upipe-modules/upipe_queue_source.h>
@@ -57,6 +58,8 @@
 #define UPUMP_POOL 0
 #define UPUMP_BLOCKER_POOL 0
 #define QUEUE_LENGTH 6
+#define BLOCKING_QUEUE_LENGTH 4
+#define NB_BLOCKING 10
 #define UPROBE_LOG_LEVEL UPROBE_LOG_VERBOSE
 
 UREF_ATTR_SMALL_UNSIGNED(test, test, "x.test", test)
@@ -67,6 +70,9 @@ static uint8_t counter = 0;
 static struct uref_mgr *uref_mgr;
 static struct urequest request;
 static bool request_was_unregistered = false;
+static struct upump_blocker *blocker = NULL;
+static struct upump *unblock_pump = NULL;
+static uint8_t nb_blocking = 0;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -79,6 +85,7 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_READY:
         case UPROBE_DEAD:
         case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_STALLED:
             break;
         case UPROBE_SOURCE_END:
             upipe_release(upipe);
@@ -167,6 +174,54 @@ static struct upipe_mgr queue_test_mgr = {
     .upipe_control = test_control
 };
 
+/** called when the blocked pump is released */
+static void blocking_test_blocker(struct upump_blocker *upump_blocker)
+{
+    assert(upump_blocker == blocker);
+    upump_blocker_free(blocker);
+    blocker = NULL;
+}
+
+/** phony pipe blocking the pump after each uref */
+static void blocking_test_input(struct upipe *upipe, struct uref *uref,
+                                struct upump **upump_p)
+{
+    /* the queue source must not output while its pump is blocked */
+    assert(blocker == NULL);
+    uint8_t uref_counter;
+    ubase_assert(uref_test_get_test(uref, &uref_counter));
+    assert(uref_counter == nb_blocking);
+    upipe_notice_va(upipe, "blocking after %"PRIu8, nb_blocking);
+    nb_blocking++;
+    uref_free(uref);
+
+    assert(upump_p != NULL && *upump_p != NULL);
+    blocker = upump_blocker_alloc(*upump_p, blocking_test_blocker, upipe,
+                                  NULL);
+    assert(blocker != NULL);
+    upump_start(unblock_pump);
+}
+
+/** unblocks the queue source at the next iteration of the event loop */
+static void blocking_test_unblock(struct upump *upump)
+{
+    upump_stop(upump);
+    if (blocker != NULL) {
+        upump_blocker_free(blocker);
+        blocker = NULL;
+    }
+    if (nb_blocking == NB_BLOCKING)
+        upipe_release(upipe_qsink);
+}
+
+/** phony pipe blocking the pump after each uref */
+static struct upipe_mgr blocking_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = blocking_test_input,
+    .upipe_control = test_control
+};
+
 int main(int argc, char *argv[])
 {
     upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
@@ -237,6 +292,46 @@ int main(int argc, char *argv[])
     assert(counter == 2);
     assert(request_was_unregistered);
 
+    /* check that urefs are not output while the pump is blocked */
+    struct upipe *upipe_blocking = upipe_void_alloc(&blocking_test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "blocking"));
+    assert(upipe_blocking != NULL);
+    upipe_qsrc = upipe_qsrc_alloc(upipe_qsrc_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "queue source"), BLOCKING_QUEUE_LENGTH);
+    assert(upipe_qsrc != NULL);
+    ubase_assert(upipe_set_output(upipe_qsrc, upipe_blocking));
+
+    upipe_qsink = upipe_qsink_alloc(upipe_qsink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "queue sink"),
+            upipe_qsrc);
+    assert(upipe_qsink != NULL);
+    uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_qsink, uref));
+    uref_free(uref);
+
+    /* more urefs than the queue can take, so that some are held */
+    for (uint8_t i = 0; i < NB_BLOCKING; i++) {
+        uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        ubase_assert(uref_test_set_test(uref, i));
+        upipe_input(upipe_qsink, uref, NULL);
+    }
+
+    unblock_pump = upump_alloc_idler(upump_mgr, blocking_test_unblock, NULL,
+                                     NULL);
+    assert(unblock_pump != NULL);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(nb_blocking == NB_BLOCKING);
+    assert(blocker == NULL);
+    upump_free(unblock_pump);
+    test_free(upipe_blocking);
+
     /* check that they are correctly released even if no flow def is input */
     upipe_qsrc = upipe_qsrc_alloc(upipe_qsrc_mgr,
             uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
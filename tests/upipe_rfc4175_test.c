@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for SMPTE 2110-20 packetizer and depacketizer
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/uclock.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-hbrmt/upipe_rfc4175_enc.h>
+#include <upipe-hbrmt/upipe_rfc4175_dec.h>
+
+#include <bitstream/ietf/rtp.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define CHROMA "u10y10v10y10"
+#define NB_FRAMES 2
+
+/** test configurations */
+static const struct {
+    uint64_t hsize;
+    uint64_t vsize;
+    bool progressive;
+} configs[] = {
+    /* several datagrams per line */
+    { 1920, 4, true },
+    /* several lines per datagram, width not a multiple of 8 pixels */
+    { 44, 10, false },
+};
+
+static unsigned int config;
+static struct upipe *upipe_rfc4175_dec;
+static unsigned int nb_datagrams;
+static unsigned int nb_markers;
+static unsigned int nb_frames;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** value of a sample in the test pattern */
+static uint16_t sample(unsigned int frame, unsigned int line, unsigned int i)
+{
+    return (i * 7 + line * 13 + frame * 5) & 0x3ff;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe counting datagrams and forwarding them */
+static void test_rtp_input(struct upipe *upipe, struct uref *uref,
+                           struct upump **upump_p)
+{
+    assert(uref != NULL);
+    uint8_t buf[RTP_HEADER_SIZE];
+    ubase_assert(uref_block_extract(uref, 0, sizeof(buf), buf));
+    assert(rtp_check_hdr(buf));
+    assert(rtp_get_type(buf) == 96);
+    assert(rtp_get_seqnum(buf) == (nb_datagrams & UINT16_MAX));
+    if (rtp_check_marker(buf))
+        nb_markers++;
+
+    nb_datagrams++;
+    upipe_input(upipe_rfc4175_dec, uref, upump_p);
+}
+
+/** helper phony pipe */
+static int test_rtp_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "block.rtp."));
+            return upipe_set_flow_def(upipe_rfc4175_dec, flow_def);
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe checking depacketized pictures */
+static void test_pic_input(struct upipe *upipe, struct uref *uref,
+                           struct upump **upump_p)
+{
+    assert(uref != NULL);
+    size_t hsize, vsize;
+    ubase_assert(uref_pic_size(uref, &hsize, &vsize, NULL));
+    assert(hsize == configs[config].hsize);
+    assert(vsize == configs[config].vsize);
+    assert(ubase_check(uref_pic_get_progressive(uref)) ==
+           configs[config].progressive);
+
+    size_t stride;
+    const uint8_t *buf;
+    ubase_assert(uref_pic_plane_size(uref, CHROMA, &stride,
+                                     NULL, NULL, NULL));
+    ubase_assert(uref_pic_plane_read(uref, CHROMA, 0, 0, -1, -1, &buf));
+    for (unsigned int line = 0; line < vsize; line++) {
+        const uint16_t *samples = (const uint16_t *)(buf + line * stride);
+        for (unsigned int i = 0; i < hsize * 2; i++)
+            assert(samples[i] == sample(nb_frames, line, i));
+    }
+    uref_pic_plane_unmap(uref, CHROMA, 0, 0, -1, -1);
+
+    nb_frames++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_pic_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "pic."));
+            ubase_assert(uref_pic_flow_check_chroma(flow_def, 1, 1, 8,
+                                                    CHROMA));
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_rtp_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_rtp_input,
+    .upipe_control = test_rtp_control
+};
+
+/** helper phony pipe */
+static struct upipe_mgr test_pic_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_pic_input,
+    .upipe_control = test_pic_control
+};
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                       UBUF_POOL_DEPTH,
+                                                       umem_mgr, 2,
+                                                       0, 0, 0, 0, 32, 0);
+    assert(ubuf_mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr, CHROMA, 1, 1, 8));
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+
+    uprobe_stdio = uprobe_ubuf_mem_alloc(uprobe_stdio, umem_mgr,
+            UBUF_POOL_DEPTH, UBUF_POOL_DEPTH);
+    assert(uprobe_stdio != NULL);
+
+    struct upipe_mgr *upipe_rfc4175_enc_mgr = upipe_rfc4175_enc_mgr_alloc();
+    assert(upipe_rfc4175_enc_mgr != NULL);
+    struct upipe_mgr *upipe_rfc4175_dec_mgr = upipe_rfc4175_dec_mgr_alloc();
+    assert(upipe_rfc4175_dec_mgr != NULL);
+
+    for (config = 0; config < UBASE_ARRAY_SIZE(configs); config++) {
+        uint64_t hsize = configs[config].hsize;
+        uint64_t vsize = configs[config].vsize;
+        nb_datagrams = nb_markers = nb_frames = 0;
+
+        upipe_rfc4175_dec = upipe_void_alloc(upipe_rfc4175_dec_mgr,
+                uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                                 "rfc4175 dec"));
+        assert(upipe_rfc4175_dec != NULL);
+
+        struct upipe *pic_sink = upipe_void_alloc(&test_pic_mgr,
+                                                  uprobe_use(uprobe_stdio));
+        assert(pic_sink != NULL);
+        ubase_assert(upipe_set_output(upipe_rfc4175_dec, pic_sink));
+
+        struct uref *uref = uref_pic_flow_alloc_def(uref_mgr, 2);
+        assert(uref != NULL);
+        ubase_assert(uref_pic_flow_add_plane(uref, 1, 1, 8, CHROMA));
+        ubase_assert(uref_pic_flow_set_hsize(uref, hsize));
+        ubase_assert(uref_pic_flow_set_vsize(uref, vsize));
+        struct urational fps = { .num = 25, .den = 1 };
+        ubase_assert(uref_pic_flow_set_fps(uref, fps));
+        if (configs[config].progressive)
+            ubase_assert(uref_pic_set_progressive(uref));
+
+        struct upipe *upipe_rfc4175_enc = upipe_void_alloc(
+                upipe_rfc4175_enc_mgr,
+                uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                                 "rfc4175 enc"));
+        assert(upipe_rfc4175_enc != NULL);
+        ubase_assert(upipe_set_flow_def(upipe_rfc4175_enc, uref));
+        uref_free(uref);
+
+        struct upipe *rtp_sink = upipe_void_alloc(&test_rtp_mgr,
+                                                  uprobe_use(uprobe_stdio));
+        assert(rtp_sink != NULL);
+        ubase_assert(upipe_set_output(upipe_rfc4175_enc, rtp_sink));
+
+        for (unsigned int frame = 0; frame < NB_FRAMES; frame++) {
+            uref = uref_pic_alloc(uref_mgr, ubuf_mgr, hsize, vsize);
+            assert(uref != NULL);
+            size_t stride;
+            uint8_t *buf;
+            ubase_assert(uref_pic_plane_size(uref, CHROMA, &stride,
+                                             NULL, NULL, NULL));
+            ubase_assert(uref_pic_plane_write(uref, CHROMA, 0, 0, -1, -1,
+                                              &buf));
+            for (unsigned int line = 0; line < vsize; line++) {
+                uint16_t *samples = (uint16_t *)(buf + line * stride);
+                for (unsigned int i = 0; i < hsize * 2; i++)
+                    samples[i] = sample(frame, line, i);
+            }
+            uref_pic_plane_unmap(uref, CHROMA, 0, 0, -1, -1);
+
+            uref_clock_set_pts_sys(uref, UCLOCK_FREQ * (frame + 1));
+            uref_clock_set_cr_sys(uref, UCLOCK_FREQ * (frame + 1));
+            upipe_input(upipe_rfc4175_enc, uref, NULL);
+        }
+
+        assert(nb_datagrams > NB_FRAMES);
+        assert(nb_markers ==
+               NB_FRAMES * (configs[config].progressive ? 1 : 2));
+        assert(nb_frames == NB_FRAMES);
+
+        upipe_release(upipe_rfc4175_enc);
+        upipe_release(upipe_rfc4175_dec);
+        test_free(rtp_sink);
+        test_free(pic_sink);
+    }
+
+    upipe_mgr_release(upipe_rfc4175_enc_mgr); // nop
+    upipe_mgr_release(upipe_rfc4175_dec_mgr); // nop
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe_stdio);
+
+    return 0;
+}
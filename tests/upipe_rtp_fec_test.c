@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for rtp fec pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-ts/upipe_rtp_fec.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <bitstream/ietf/rtp.h>
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/smpte/2022_1_fec.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define PT 33
+#define COLS 3
+#define ROWS 3
+#define MATRIX (COLS * ROWS)
+#define MATRICES 8
+#define PAYLOAD_SIZE (7 * TS_SIZE)
+#define FEC_SIZE (RTP_HEADER_SIZE + SMPTE_2022_FEC_HEADER_SIZE + PAYLOAD_SIZE)
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct upipe *upipe_rtp_fec;
+static uint64_t now;
+static int next_seqnum = 0;
+static int counter = 0;
+static uint64_t recovered = 0;
+
+/* lost packets, as (matrix, row, column) */
+static const int lost[][3] = {
+    /* two losses in a row, one of them in a column without FEC */
+    { 2, 0, 0 }, { 2, 0, 1 },
+    /* two losses in a column, one of them in a row without FEC */
+    { 4, 0, 0 }, { 4, 1, 0 }, { 4, 0, 1 },
+};
+/* lost FEC packets, as (matrix, column) or (matrix, row) */
+static const int lost_col[][2] = { { 2, 1 } };
+static const int lost_row[][2] = { { 4, 1 } };
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == RTP_HEADER_SIZE + PAYLOAD_SIZE);
+
+    uint8_t buffer[RTP_HEADER_SIZE + PAYLOAD_SIZE];
+    ubase_assert(uref_block_extract(uref, 0, -1, buffer));
+    uint16_t seqnum = rtp_get_seqnum(buffer);
+    assert(rtp_get_type(buffer) == PT);
+    assert(rtp_get_timestamp(buffer) == seqnum * 100);
+    for (int i = 0; i < PAYLOAD_SIZE; i++)
+        assert(buffer[RTP_HEADER_SIZE + i] == (uint8_t)(seqnum * 7 + i));
+
+    /* packets are forwarded as is until FEC is detected, then every packet
+     * is output in order */
+    assert(seqnum >= next_seqnum);
+    if (next_seqnum >= 2 * MATRIX)
+        assert(seqnum == next_seqnum);
+    next_seqnum = seqnum + 1;
+    counter++;
+
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** builds a main packet */
+static void build_packet(uint8_t *buffer, uint16_t seqnum)
+{
+    memset(buffer, 0, RTP_HEADER_SIZE);
+    rtp_set_hdr(buffer);
+    rtp_set_type(buffer, PT);
+    rtp_set_seqnum(buffer, seqnum);
+    rtp_set_timestamp(buffer, seqnum * 100);
+    for (int i = 0; i < PAYLOAD_SIZE; i++)
+        buffer[RTP_HEADER_SIZE + i] = seqnum * 7 + i;
+}
+
+/** sends a packet to a subpipe */
+static void send_packet(struct upipe *subpipe, const uint8_t *buffer,
+                        int size)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, size);
+    assert(uref != NULL);
+    uint8_t *w;
+    ubase_assert(uref_block_write(uref, 0, &size, &w));
+    memcpy(w, buffer, size);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_date_sys(uref, now++, UREF_DATE_CR);
+    upipe_input(subpipe, uref, NULL);
+}
+
+/** sends a FEC packet protecting items packets */
+static void send_fec(struct upipe *subpipe, uint16_t fec_seqnum,
+                     uint16_t snbase, int step, int items, bool row)
+{
+    uint8_t fec[FEC_SIZE];
+    memset(fec, 0, sizeof(fec));
+    rtp_set_hdr(fec);
+    rtp_set_type(fec, 96);
+    rtp_set_seqnum(fec, fec_seqnum);
+
+    uint8_t *header = fec + RTP_HEADER_SIZE;
+    uint8_t *payload = header + SMPTE_2022_FEC_HEADER_SIZE;
+    uint16_t length_rec = 0;
+    uint32_t ts_rec = 0;
+    for (int i = 0; i < items; i++) {
+        uint8_t buffer[RTP_HEADER_SIZE + PAYLOAD_SIZE];
+        build_packet(buffer, snbase + i * step);
+        length_rec ^= PAYLOAD_SIZE;
+        ts_rec ^= rtp_get_timestamp(buffer);
+        for (int j = 0; j < PAYLOAD_SIZE; j++)
+            payload[j] ^= buffer[RTP_HEADER_SIZE + j];
+    }
+    smpte_fec_set_snbase_low(header, snbase);
+    smpte_fec_set_length_rec(header, length_rec);
+    smpte_fec_set_ts_recovery(header, ts_rec);
+    if (row) {
+        smpte_fec_set_d(header);
+        smpte_fec_set_offset(header, 1);
+        smpte_fec_set_na(header, COLS);
+    } else {
+        smpte_fec_set_offset(header, COLS);
+        smpte_fec_set_na(header, ROWS);
+    }
+    send_packet(subpipe, fec, sizeof(fec));
+}
+
+/** stops the test once every packet is output */
+static void stop(struct upump *upump)
+{
+    upump_stop(upump);
+    ubase_assert(upipe_rtp_fec_get_packets_recovered(upipe_rtp_fec,
+                                                     &recovered));
+    upipe_release(upipe_rtp_fec);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_rtp_fec_mgr = upipe_rtp_fec_mgr_alloc();
+    assert(upipe_rtp_fec_mgr != NULL);
+    upipe_rtp_fec = upipe_rtp_fec_alloc(upipe_rtp_fec_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "fec"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "main"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "col"),
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "row"));
+    assert(upipe_rtp_fec != NULL);
+    upipe_mgr_release(upipe_rtp_fec_mgr);
+    ubase_assert(upipe_rtp_fec_set_pt(upipe_rtp_fec, PT));
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "sink"));
+    assert(upipe_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_rtp_fec, upipe_sink));
+    ubase_assert(upipe_attach_uclock(upipe_rtp_fec));
+
+    struct upipe *main_sub, *col_sub, *row_sub;
+    ubase_assert(upipe_rtp_fec_get_main_sub(upipe_rtp_fec, &main_sub));
+    ubase_assert(upipe_rtp_fec_get_col_sub(upipe_rtp_fec, &col_sub));
+    ubase_assert(upipe_rtp_fec_get_row_sub(upipe_rtp_fec, &row_sub));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "rtp.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(main_sub, flow_def));
+    uref_free(flow_def);
+
+    now = uclock_now(uclock);
+    uint16_t col_seqnum = 0, row_seqnum = 0;
+    for (int m = 0; m < MATRICES; m++) {
+        for (int r = 0; r < ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                bool drop = false;
+                for (int i = 0; i < UBASE_ARRAY_SIZE(lost); i++)
+                    if (lost[i][0] == m && lost[i][1] == r &&
+                        lost[i][2] == c)
+                        drop = true;
+                if (drop)
+                    continue;
+
+                uint8_t buffer[RTP_HEADER_SIZE + PAYLOAD_SIZE];
+                build_packet(buffer, m * MATRIX + r * COLS + c);
+                send_packet(main_sub, buffer, sizeof(buffer));
+            }
+
+            bool drop = false;
+            for (int i = 0; i < UBASE_ARRAY_SIZE(lost_row); i++)
+                if (lost_row[i][0] == m && lost_row[i][1] == r)
+                    drop = true;
+            if (!drop)
+                send_fec(row_sub, row_seqnum, m * MATRIX + r * COLS, 1, COLS,
+                         true);
+            row_seqnum++;
+        }
+
+        for (int c = 0; c < COLS; c++) {
+            bool drop = false;
+            for (int i = 0; i < UBASE_ARRAY_SIZE(lost_col); i++)
+                if (lost_col[i][0] == m && lost_col[i][1] == c)
+                    drop = true;
+            if (!drop)
+                send_fec(col_sub, col_seqnum, m * MATRIX + c, COLS, ROWS,
+                         false);
+            col_seqnum++;
+        }
+    }
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, stop, NULL, NULL,
+                                            UCLOCK_FREQ / 2, 0);
+    assert(upump != NULL);
+    upump_start(upump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(next_seqnum == MATRICES * MATRIX);
+    assert(counter > (MATRICES - 1) * MATRIX);
+    assert(recovered == UBASE_ARRAY_SIZE(lost));
+
+    upump_free(upump);
+    test_free(upipe_sink);
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
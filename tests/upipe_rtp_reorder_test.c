@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for rtp reorder pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_rtp_reorder.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <bitstream/ietf/rtp.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define PAYLOAD_SIZE 188
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct uclock *uclock;
+static struct upipe *upipe_rtpr;
+static struct upipe *upipe_rtpr_input;
+static int step = 0;
+
+/* packets in the order they are sent, and in the order they are expected */
+static const uint16_t sent[] = { 100, 102, 101, 102, 99 };
+static const uint16_t expected[] = { 100, 101, 102 };
+static int counter = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint8_t buffer[RTP_HEADER_SIZE];
+    ubase_assert(uref_block_extract(uref, 0, RTP_HEADER_SIZE, buffer));
+    uint16_t seqnum = rtp_get_seqnum(buffer);
+    upipe_dbg_va(upipe, "received seqnum %"PRIu16, seqnum);
+    assert(counter < UBASE_ARRAY_SIZE(expected));
+    assert(seqnum == expected[counter]);
+    counter++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a packet to the input subpipe, to be output right away */
+static void send_packet(uint16_t seqnum)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                         RTP_HEADER_SIZE + PAYLOAD_SIZE);
+    assert(uref != NULL);
+    int size = -1;
+    uint8_t *w;
+    ubase_assert(uref_block_write(uref, 0, &size, &w));
+    memset(w, 0, size);
+    rtp_set_hdr(w);
+    rtp_set_type(w, 33);
+    rtp_set_seqnum(w, seqnum);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_date_sys(uref, uclock_now(uclock), UREF_DATE_CR);
+    upipe_input(upipe_rtpr_input, uref, NULL);
+}
+
+/** sends the packets, leaving time to the reorder timer to output the
+ * first one before the others arrive */
+static void feed(struct upump *upump)
+{
+    switch (step++) {
+        case 0:
+            send_packet(sent[0]);
+            break;
+        case 1:
+            assert(counter == 1);
+            /* 102 then 101, then a duplicate and a late packet */
+            for (int i = 1; i < UBASE_ARRAY_SIZE(sent); i++)
+                send_packet(sent[i]);
+            break;
+        default:
+            assert(counter == UBASE_ARRAY_SIZE(expected));
+            upump_stop(upump);
+            upipe_release(upipe_rtpr_input);
+            upipe_release(upipe_rtpr);
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_rtpr_mgr = upipe_rtpr_mgr_alloc();
+    assert(upipe_rtpr_mgr != NULL);
+    upipe_rtpr = upipe_void_alloc(upipe_rtpr_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "rtpr"));
+    assert(upipe_rtpr != NULL);
+    upipe_mgr_release(upipe_rtpr_mgr);
+    ubase_assert(upipe_rtpr_set_delay(upipe_rtpr, 0));
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "sink"));
+    assert(upipe_sink != NULL);
+    ubase_assert(upipe_set_output(upipe_rtpr, upipe_sink));
+    ubase_assert(upipe_attach_uclock(upipe_rtpr));
+
+    upipe_rtpr_input = upipe_void_alloc_sub(upipe_rtpr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "input"));
+    assert(upipe_rtpr_input != NULL);
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "rtp.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_rtpr_input, flow_def));
+    uref_free(flow_def);
+
+    struct upump *upump = upump_alloc_timer(upump_mgr, feed, NULL, NULL,
+                                            UCLOCK_FREQ / 20,
+                                            UCLOCK_FREQ / 20);
+    assert(upump != NULL);
+    upump_start(upump);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    assert(step == 3);
+    assert(counter == UBASE_ARRAY_SIZE(expected));
+
+    upump_free(upump);
+    test_free(upipe_sink);
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for per-pipe statistics and their dump
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_dump.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe-modules/upipe_null.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 5
+#define UREF_POOL_DEPTH 5
+#define UBUF_POOL_DEPTH 5
+#define ITERATIONS 50
+#define BLOCK_SIZE 188
+#define LATENCY (UCLOCK_FREQ / 1000)
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_LOG:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+        default:
+            assert(0);
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** pipe forwarding urefs to its output */
+struct linear {
+    struct upipe upipe;
+    struct urefcount urefcount;
+    struct upipe *output;
+    struct uref *flow_def;
+    enum upipe_helper_output_state output_state;
+    struct uchain requests;
+};
+
+UPIPE_HELPER_UPIPE(linear, upipe, 0);
+UPIPE_HELPER_UREFCOUNT(linear, urefcount, linear_free);
+UPIPE_HELPER_VOID(linear);
+UPIPE_HELPER_OUTPUT(linear, output, flow_def, output_state, requests);
+
+static struct upipe *linear_alloc(struct upipe_mgr *mgr,
+                                  struct uprobe *uprobe,
+                                  uint32_t signature,
+                                  va_list args)
+{
+    struct upipe *upipe = linear_alloc_void(mgr, uprobe, signature, args);
+    assert(upipe);
+
+    linear_init_urefcount(upipe);
+    linear_init_output(upipe);
+
+    upipe_throw_ready(upipe);
+
+    return upipe;
+}
+
+static void linear_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+
+    linear_clean_output(upipe);
+    linear_clean_urefcount(upipe);
+    linear_free_void(upipe);
+}
+
+static void linear_input(struct upipe *upipe,
+                         struct uref *uref,
+                         struct upump **upump_p)
+{
+    linear_output(upipe, uref, upump_p);
+}
+
+static int linear_control(struct upipe *upipe, int cmd, va_list args)
+{
+    UBASE_HANDLED_RETURN(linear_control_output(upipe, cmd, args));
+    switch (cmd) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            linear_store_flow_def(upipe, uref_dup(flow_def));
+            return UBASE_ERR_NONE;
+        }
+    }
+    return UBASE_ERR_UNHANDLED;
+}
+
+static struct upipe_mgr linear_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = linear_alloc,
+    .upipe_input = linear_input,
+    .upipe_control = linear_control,
+};
+
+/** @This dumps a pipeline to a string. */
+static char *dump(bool json, struct upipe *source)
+{
+    char *string;
+    size_t size;
+    FILE *file = open_memstream(&string, &size);
+    assert(file != NULL);
+    if (json)
+        upipe_dump_json(NULL, file, NULL, source, NULL);
+    else
+        upipe_dump(NULL, NULL, file, NULL, source, NULL);
+    fclose(file);
+    return string;
+}
+
+int main(int argc, char **argv)
+{
+    printf("Compiled %s %s - %s\n", __DATE__, __TIME__, __FILE__);
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr =
+        udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr =
+        uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr =
+        ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr,
+                                 0, 0, 0, 0);
+    assert(ubuf_mgr != NULL);
+    struct uclock *uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+
+    struct upipe *linear = upipe_void_alloc(&linear_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "linear"));
+    assert(linear != NULL);
+    struct upipe_mgr *upipe_null_mgr = upipe_null_mgr_alloc();
+    assert(upipe_null_mgr != NULL);
+    struct upipe *null = upipe_void_alloc_output(linear, upipe_null_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "null"));
+    assert(null != NULL);
+    upipe_release(null);
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(linear, flow_def));
+    uref_free(flow_def);
+
+    /* statistics are disabled by default */
+    assert(linear->stats == NULL);
+    char *string = dump(true, linear);
+    assert(strstr(string, "\"stats\":null") != NULL);
+    free(string);
+
+    ubase_assert(upipe_stats_enable(linear, uclock));
+    ubase_assert(upipe_stats_enable(null, uclock));
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, BLOCK_SIZE);
+        assert(uref != NULL);
+        uref_clock_set_cr_sys(uref, uclock_now(uclock) - LATENCY);
+        upipe_input(linear, uref, NULL);
+    }
+    upipe_input(linear, uref_alloc(uref_mgr), NULL);
+
+    struct upipe_stats *stats = linear->stats;
+    assert(stats->urefs_in == ITERATIONS + 1);
+    assert(stats->bytes_in == ITERATIONS * BLOCK_SIZE);
+    assert(stats->urefs_out == ITERATIONS + 1);
+    assert(stats->bytes_out == ITERATIONS * BLOCK_SIZE);
+    assert(stats->latency_count == ITERATIONS);
+    assert(stats->latency_max >= LATENCY);
+    assert(stats->latency_total >= ITERATIONS * LATENCY);
+    assert(stats->input_time <= stats->input_time_total);
+
+    struct upipe_stats *null_stats = null->stats;
+    assert(null_stats->urefs_in == ITERATIONS + 1);
+    assert(null_stats->bytes_in == ITERATIONS * BLOCK_SIZE);
+    assert(null_stats->urefs_out == 0);
+    assert(null_stats->input_time_total <= stats->input_time_total);
+    assert(stats->input_time + null_stats->input_time_total <=
+           stats->input_time_total);
+
+    string = dump(true, linear);
+    printf("%s", string);
+    assert(strstr(string, "{\"pipes\":[") == string);
+    assert(strstr(string, "\"urefs_in\":51,\"bytes_in\":9400") != NULL);
+    assert(strstr(string, "\"output\":1") != NULL);
+    free(string);
+
+    string = dump(false, linear);
+    printf("%s", string);
+    assert(strstr(string, "in: 51 urefs, 9400 bytes") != NULL);
+    assert(strstr(string, "latency: ") != NULL);
+    free(string);
+
+    /* reset */
+    ubase_assert(upipe_stats_enable(linear, uclock));
+    assert(linear->stats->urefs_in == 0);
+    upipe_stats_disable(linear);
+    assert(linear->stats == NULL);
+    upipe_input(linear, uref_alloc(uref_mgr), NULL);
+    assert(null->stats->urefs_in == ITERATIONS + 2);
+
+    upipe_release(linear);
+    upipe_mgr_release(upipe_null_mgr);
+
+    uclock_release(uclock);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    return 0;
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short benchmark of swscale pipes, converting on the calling thread,
+ * by slices on worker threads, and with pictures converted in the background
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_pic_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-swscale/upipe_sws.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    5
+#define UREF_POOL_DEPTH     5
+#define UBUF_POOL_DEPTH     5
+#define UBUF_ALIGN          32
+#define UPROBE_LOG_LEVEL    UPROBE_LOG_WARNING
+
+#define INPUT_HSIZE         1920
+#define INPUT_VSIZE         1080
+#define OUTPUT_HSIZE        1280
+#define OUTPUT_VSIZE        720
+#define DEFAULT_ITERATIONS  100
+#define DEFAULT_THREADS     4
+#define PIPELINE            2
+
+/** chroma planes of the I420 pictures */
+static const struct {
+    const char *chroma;
+    uint8_t hsub, vsub;
+} planes[] = { { "y8", 1, 1 }, { "u8", 2, 2 }, { "v8", 2, 2 } };
+
+#define NB_PLANES (sizeof(planes) / sizeof(planes[0]))
+
+/** number of pictures received by the phony pipe */
+static unsigned int nb_received;
+/** last picture received by the phony pipe */
+static struct uref *last_pic;
+
+/** @This returns a monotonic date in nanoseconds. */
+static uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uref_free(last_pic);
+    last_pic = uref;
+    nb_received++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** @This checks that two pictures have the same content.
+ *
+ * @param uref1 first picture
+ * @param uref2 second picture
+ * @return true if the pictures are identical
+ */
+static bool compare_pics(struct uref *uref1, struct uref *uref2)
+{
+    bool same = true;
+    for (unsigned i = 0; i < NB_PLANES && same; i++) {
+        const uint8_t *data1, *data2;
+        size_t stride1, stride2;
+        ubase_assert(uref_pic_plane_size(uref1, planes[i].chroma, &stride1,
+                                         NULL, NULL, NULL));
+        ubase_assert(uref_pic_plane_size(uref2, planes[i].chroma, &stride2,
+                                         NULL, NULL, NULL));
+        ubase_assert(uref_pic_plane_read(uref1, planes[i].chroma,
+                                         0, 0, -1, -1, &data1));
+        ubase_assert(uref_pic_plane_read(uref2, planes[i].chroma,
+                                         0, 0, -1, -1, &data2));
+        for (unsigned y = 0; y < OUTPUT_VSIZE / planes[i].vsub; y++)
+            if (memcmp(data1 + y * stride1, data2 + y * stride2,
+                       OUTPUT_HSIZE / planes[i].hsub)) {
+                same = false;
+                break;
+            }
+        uref_pic_plane_unmap(uref1, planes[i].chroma, 0, 0, -1, -1);
+        uref_pic_plane_unmap(uref2, planes[i].chroma, 0, 0, -1, -1);
+    }
+    return same;
+}
+
+/** @This benchmarks the conversion of pictures by a swscale pipe.
+ *
+ * @param logger uprobe hierarchy
+ * @param flow_def input flow definition
+ * @param pic input picture
+ * @param threads number of conversion threads
+ * @param pipeline number of pictures converted in the background
+ * @param iterations number of pictures to convert
+ * @return average duration of a conversion in nanoseconds
+ */
+static double bench(struct uprobe *logger, struct uref *flow_def,
+                    struct uref *pic, unsigned threads, unsigned pipeline,
+                    unsigned iterations)
+{
+    struct upipe_mgr *upipe_sws_mgr = upipe_sws_mgr_alloc();
+    struct uref *output_flow = uref_dup(flow_def);
+    assert(output_flow != NULL);
+    ubase_assert(uref_pic_flow_set_hsize(output_flow, OUTPUT_HSIZE));
+    ubase_assert(uref_pic_flow_set_vsize(output_flow, OUTPUT_VSIZE));
+    struct upipe *sws = upipe_flow_alloc(upipe_sws_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "sws"),
+            output_flow);
+    assert(sws != NULL);
+    uref_free(output_flow);
+    ubase_assert(upipe_sws_set_threads(sws, threads));
+    ubase_assert(upipe_sws_set_pipeline(sws, pipeline));
+    ubase_assert(upipe_set_flow_def(sws, flow_def));
+
+    struct upipe *test = upipe_void_alloc(&test_mgr, uprobe_use(logger));
+    assert(test != NULL);
+    ubase_assert(upipe_set_output(sws, test));
+
+    /* warm up */
+    nb_received = 0;
+    upipe_input(sws, uref_dup(pic), NULL);
+
+    uint64_t begin = now();
+    for (unsigned n = 0; n < iterations; n++)
+        upipe_input(sws, uref_dup(pic), NULL);
+    /* pictures converted in the background are output on release */
+    upipe_release(sws);
+    uint64_t end = now();
+
+    assert(nb_received == iterations + 1);
+    test_free(test);
+    return (double)(end - begin) / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned iterations = argc > 1 ? strtoul(argv[1], NULL, 0) :
+                                     DEFAULT_ITERATIONS;
+    unsigned threads = argc > 2 ? strtoul(argv[2], NULL, 0) :
+                                  DEFAULT_THREADS;
+
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH,
+                                                   udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH,
+            UBUF_POOL_DEPTH, umem_mgr, 1, 0, 0, 0, 0, UBUF_ALIGN, 0);
+    assert(ubuf_mgr != NULL);
+    struct uref *flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow_def != NULL);
+    for (unsigned i = 0; i < NB_PLANES; i++) {
+        ubase_assert(ubuf_pic_mem_mgr_add_plane(ubuf_mgr, planes[i].chroma,
+                     planes[i].hsub, planes[i].vsub, 1));
+        ubase_assert(uref_pic_flow_add_plane(flow_def, planes[i].hsub,
+                     planes[i].vsub, 1, planes[i].chroma));
+    }
+    ubase_assert(uref_pic_flow_set_align(flow_def, UBUF_ALIGN));
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    /* fill the input picture with a gradient */
+    struct uref *pic = uref_pic_alloc(uref_mgr, ubuf_mgr,
+                                      INPUT_HSIZE, INPUT_VSIZE);
+    assert(pic != NULL);
+    for (unsigned i = 0; i < NB_PLANES; i++) {
+        uint8_t *data;
+        size_t stride;
+        ubase_assert(uref_pic_plane_size(pic, planes[i].chroma, &stride,
+                                         NULL, NULL, NULL));
+        ubase_assert(uref_pic_plane_write(pic, planes[i].chroma,
+                                          0, 0, -1, -1, &data));
+        for (unsigned y = 0; y < INPUT_VSIZE / planes[i].vsub; y++)
+            for (unsigned x = 0; x < INPUT_HSIZE / planes[i].hsub; x++)
+                data[y * stride + x] = x * 3 + y * 7 + i * 50;
+        ubase_assert(uref_pic_plane_unmap(pic, planes[i].chroma,
+                                          0, 0, -1, -1));
+    }
+
+    printf("%ux%u -> %ux%u I420, %u pictures\n", INPUT_HSIZE, INPUT_VSIZE,
+           OUTPUT_HSIZE, OUTPUT_VSIZE, iterations);
+    for (int progressive = 1; progressive >= 0; progressive--) {
+        if (progressive)
+            ubase_assert(uref_pic_set_progressive(pic));
+        else
+            uref_pic_delete_progressive(pic);
+
+        double single = bench(logger, flow_def, pic, 1, 0, iterations);
+        struct uref *reference = last_pic;
+        last_pic = NULL;
+
+        double sliced = bench(logger, flow_def, pic, threads, 0, iterations);
+        assert(compare_pics(reference, last_pic));
+        uref_free(last_pic);
+        last_pic = NULL;
+
+        double pipelined = bench(logger, flow_def, pic, threads, PIPELINE,
+                                 iterations);
+        assert(compare_pics(reference, last_pic));
+        uref_free(last_pic);
+        last_pic = NULL;
+        uref_free(reference);
+
+        printf("%s:\n", progressive ? "progressive" : "interlaced");
+        printf("   1 thread:               %7.2f ms/picture\n", single / 1e6);
+        printf("  %2u threads:              %7.2f ms/picture (x%.1f)\n",
+               threads, sliced / 1e6, single / sliced);
+        printf("  %2u threads, %u pipelined: %7.2f ms/picture (x%.1f)\n",
+               threads, PIPELINE, pipelined / 1e6, single / pipelined);
+    }
+
+    uref_free(pic);
+    uref_free(flow_def);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
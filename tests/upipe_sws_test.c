@@ -424,14 +424,57 @@ int main(int argc, char **argv)
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
 
-    /* release urefs */
-    uref_free(uref1);
-    uref_free(uref2);
+    /* Now send pic converted by slices on worker threads */
+    unsigned int threads;
+    ubase_assert(upipe_sws_set_threads(sws, 3));
+    ubase_assert(upipe_sws_get_threads(sws, &threads));
+    assert(threads == 3);
+    uref_free(sws_test_from_upipe(sws_test)->pic);
+    sws_test_from_upipe(sws_test)->pic = NULL;
+    pic = uref_dup(uref1);
+    upipe_input(sws, pic, NULL);
+
+    assert(sws_test_from_upipe(sws_test)->pic);
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "y8", 1, 1, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
+
+    /* Now send pics converted in the background, output in order */
+    unsigned int pipeline;
+    uint64_t number;
+    ubase_assert(upipe_sws_set_pipeline(sws, 1));
+    ubase_assert(upipe_sws_get_pipeline(sws, &pipeline));
+    assert(pipeline == 1);
+    uref_free(sws_test_from_upipe(sws_test)->pic);
+    sws_test_from_upipe(sws_test)->pic = NULL;
+    pic = uref_dup(uref1);
+    ubase_assert(uref_pic_set_number(pic, 1));
+    upipe_input(sws, pic, NULL);
+    assert(sws_test_from_upipe(sws_test)->pic == NULL);
+
+    pic = uref_dup(uref1);
+    ubase_assert(uref_pic_set_number(pic, 2));
+    upipe_input(sws, pic, NULL);
+    assert(sws_test_from_upipe(sws_test)->pic);
+    ubase_assert(uref_pic_get_number(sws_test_from_upipe(sws_test)->pic, &number));
+    assert(number == 1);
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "y8", 1, 1, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
 
-    /* release pipes */
+    /* release pipes, the last pic is output */
     upipe_release(sws);
+    ubase_assert(uref_pic_get_number(sws_test_from_upipe(sws_test)->pic, &number));
+    assert(number == 2);
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "y8", 1, 1, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
     test_free(sws_test);
 
+    /* release urefs */
+    uref_free(uref1);
+    uref_free(uref2);
+
     /* release managers */
     ubuf_mgr_release(ubuf_mgr);
     uref_mgr_release(uref_mgr);
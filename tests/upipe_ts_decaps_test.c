@@ -51,6 +51,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <assert.h>
@@ -240,6 +241,49 @@ int main(int argc, char *argv[])
     assert(!nb_packets);
     assert(!pcr);
 
+    /* several packets per uref: payloads of continuation packets are
+     * gathered */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 3 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 3 * TS_SIZE);
+    for (int i = 0; i < 3; i++) {
+        ts_init(buffer + i * TS_SIZE);
+        ts_set_cc(buffer + i * TS_SIZE, 4 + i);
+        ts_set_payload(buffer + i * TS_SIZE);
+        memset(buffer + i * TS_SIZE + TS_HEADER_SIZE, i,
+               TS_SIZE - TS_HEADER_SIZE);
+    }
+    ts_set_unitstart(buffer);
+    start = UBASE_ERR_NONE;
+    discontinuity = UBASE_ERR_INVALID;
+    payload_size = 3 * 184;
+    uref_block_unmap(uref, 0);
+    nb_packets++;
+    upipe_input(upipe_ts_decaps, uref, NULL);
+    assert(!nb_packets);
+
+    /* with a duplicate packet in the middle */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 3 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 3 * TS_SIZE);
+    for (int i = 0; i < 3; i++) {
+        ts_init(buffer + i * TS_SIZE);
+        ts_set_cc(buffer + i * TS_SIZE, i < 2 ? 7 : 8);
+        ts_set_payload(buffer + i * TS_SIZE);
+        memset(buffer + i * TS_SIZE + TS_HEADER_SIZE, 0,
+               TS_SIZE - TS_HEADER_SIZE);
+    }
+    start = UBASE_ERR_INVALID;
+    payload_size = 2 * 184;
+    uref_block_unmap(uref, 0);
+    nb_packets++;
+    upipe_input(upipe_ts_decaps, uref, NULL);
+    assert(!nb_packets);
+
     upipe_release(upipe_ts_decaps);
     upipe_mgr_release(upipe_ts_decaps_mgr); // nop
 
@@ -95,6 +95,8 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
 struct test {
     uint16_t pid;
     bool got_packet;
+    unsigned int nb_urefs;
+    unsigned int nb_packets;
     struct upipe upipe;
 };
 
@@ -109,6 +111,7 @@ static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
     assert(test != NULL);
     upipe_init(&test->upipe, mgr, uprobe);
     test->got_packet = false;
+    test->nb_urefs = test->nb_packets = 0;
     test->pid = pid;
     return &test->upipe;
 }
@@ -120,13 +123,20 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     struct test *test = container_of(upipe, struct test, upipe);
     assert(uref != NULL);
     test->got_packet = true;
-    const uint8_t *buffer;
-    int size = -1;
-    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
-    assert(size == TS_SIZE); //because of the way we allocated it
-    assert(ts_validate(buffer));
-    assert(ts_get_pid(buffer) == test->pid);
-    uref_block_unmap(uref, 0);
+    size_t uref_size;
+    ubase_assert(uref_block_size(uref, &uref_size));
+    assert(uref_size && !(uref_size % TS_SIZE));
+    for (int offset = 0; offset < uref_size; offset += TS_SIZE) {
+        const uint8_t *buffer;
+        int size = -1;
+        ubase_assert(uref_block_read(uref, offset, &size, &buffer));
+        assert(size >= TS_HEADER_SIZE);
+        assert(ts_validate(buffer));
+        assert(ts_get_pid(buffer) == test->pid);
+        uref_block_unmap(uref, offset);
+        test->nb_packets++;
+    }
+    test->nb_urefs++;
     uref_free(uref);
 }
 
@@ -236,6 +246,77 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_split, uref, NULL);
 
+    struct test *test68 = container_of(upipe_sink68, struct test, upipe);
+    struct test *test69 = container_of(upipe_sink69, struct test, upipe);
+    assert(test68->nb_urefs == 1 && test68->nb_packets == 1);
+    assert(test69->nb_urefs == 1 && test69->nb_packets == 1);
+
+    /* several aligned packets per uref */
+    uref = uref_block_flow_alloc_def(uref_mgr, "mpegtsaligned.");
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_split, uref));
+    uref_free(uref);
+
+    static const uint16_t pids[] = { 68, 68, 69, 70, 68 };
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 5 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 5 * TS_SIZE);
+    for (int i = 0; i < 5; i++) {
+        ts_pad(buffer + i * TS_SIZE);
+        ts_set_pid(buffer + i * TS_SIZE, pids[i]);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_split, uref, NULL);
+    assert(test68->nb_urefs == 3 && test68->nb_packets == 4);
+    assert(test69->nb_urefs == 2 && test69->nb_packets == 2);
+
+    /* second output on the same PID */
+    uref = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(uref != NULL);
+    ubase_assert(uref_ts_flow_set_pid(uref, 68));
+    struct upipe *upipe_sink68b = upipe_flow_alloc(&test_mgr,
+            uprobe_use(uprobe_stdio), uref);
+    assert(upipe_sink68b != NULL);
+    struct upipe *upipe_ts_split_output68b =
+        upipe_flow_alloc_sub(upipe_ts_split,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts split output 68b"), uref);
+    assert(upipe_ts_split_output68b != NULL);
+    ubase_assert(upipe_set_output(upipe_ts_split_output68b, upipe_sink68b));
+    uref_free(uref);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 2 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 2 * TS_SIZE);
+    for (int i = 0; i < 2; i++) {
+        ts_pad(buffer + i * TS_SIZE);
+        ts_set_pid(buffer + i * TS_SIZE, 68);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_split, uref, NULL);
+    struct test *test68b = container_of(upipe_sink68b, struct test, upipe);
+    assert(test68->nb_urefs == 4 && test68->nb_packets == 6);
+    assert(test68b->nb_urefs == 1 && test68b->nb_packets == 2);
+
+    upipe_release(upipe_ts_split_output68b);
+    test_free(upipe_sink68b);
+
+    /* back to a single output */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == TS_SIZE);
+    ts_pad(buffer);
+    ts_set_pid(buffer, 68);
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_split, uref, NULL);
+    assert(test68->nb_urefs == 5 && test68->nb_packets == 7);
+
     upipe_release(upipe_ts_split_output68);
     upipe_release(upipe_ts_split_output69);
     upipe_release(upipe_ts_split);
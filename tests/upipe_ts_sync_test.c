@@ -63,6 +63,8 @@
 
 static unsigned int nb_packets = 0;
 static int expect_loss = -1;
+static unsigned int vector = 1;
+static const char *expect_def = "block.mpegts.";
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -101,24 +103,29 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     assert(uref != NULL);
     size_t size;
     ubase_assert(uref_block_size(uref, &size));
-    assert(size == TS_SIZE);
+    assert(size == vector * TS_SIZE);
 
-    const uint8_t *buffer;
-    int rsize = 1;
-    ubase_assert(uref_block_read(uref, 0, &rsize, &buffer));
-    assert(rsize == 1);
-    assert(ts_validate(buffer));
-    uref_block_unmap(uref, 0);
+    for (unsigned int i = 0; i < vector; i++) {
+        const uint8_t *buffer;
+        int rsize = 1;
+        ubase_assert(uref_block_read(uref, i * TS_SIZE, &rsize, &buffer));
+        assert(rsize == 1);
+        assert(ts_validate(buffer));
+        uref_block_unmap(uref, i * TS_SIZE);
+    }
     uref_free(uref);
-    nb_packets--;
+    nb_packets -= vector;
 }
 
 /** helper phony pipe */
 static int test_control(struct upipe *upipe, int command, va_list args)
 {
     switch (command) {
-        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, expect_def));
             return UBASE_ERR_NONE;
+        }
         default:
             assert(0);
             return UBASE_ERR_UNHANDLED;
@@ -230,6 +237,75 @@ int main(int argc, char *argv[])
     upipe_input(upipe_ts_sync, uref, NULL);
     assert(!nb_packets);
 
+    nb_packets++;
+    upipe_release(upipe_ts_sync);
+    assert(!nb_packets);
+
+    /* several packets per uref */
+    upipe_ts_sync = upipe_void_alloc(upipe_ts_sync_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts sync vector"));
+    assert(upipe_ts_sync != NULL);
+    uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_sync, uref));
+    ubase_assert(upipe_set_output(upipe_ts_sync, upipe_sink));
+    uref_free(uref);
+    expect_def = "block.mpegtsaligned.";
+    ubase_assert(upipe_ts_sync_set_vector(upipe_ts_sync, 8));
+    unsigned int vector_get;
+    ubase_assert(upipe_ts_sync_get_vector(upipe_ts_sync, &vector_get));
+    assert(vector_get == 8);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 5 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 5 * TS_SIZE);
+    for (int i = 0; i < 5; i++)
+        ts_pad(buffer + i * TS_SIZE);
+    uref_block_unmap(uref, 0);
+    /* the last packet is kept until the next sync word is seen */
+    vector = 4;
+    nb_packets += 4;
+    upipe_input(upipe_ts_sync, uref, NULL);
+    assert(!nb_packets);
+
+    vector = 1;
+    nb_packets++;
+    upipe_release(upipe_ts_sync);
+    assert(!nb_packets);
+
+    /* packet size detection */
+    upipe_ts_sync = upipe_void_alloc(upipe_ts_sync_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts sync autodetect"));
+    assert(upipe_ts_sync != NULL);
+    uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_sync, uref));
+    ubase_assert(upipe_set_output(upipe_ts_sync, upipe_sink));
+    uref_free(uref);
+    expect_def = "block.mpegts.";
+    ubase_assert(upipe_ts_sync_set_autodetect(upipe_ts_sync, 1));
+    int autodetect;
+    ubase_assert(upipe_ts_sync_get_autodetect(upipe_ts_sync, &autodetect));
+    assert(autodetect == 1);
+
+    /* 204-octet packets (with Reed-Solomon parity) after some garbage */
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 20 + 6 * 204);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 20 + 6 * 204);
+    memset(buffer, 0xff, size);
+    for (int i = 0; i < 6; i++)
+        ts_pad(buffer + 20 + i * 204);
+    uref_block_unmap(uref, 0);
+    nb_packets += 5;
+    upipe_input(upipe_ts_sync, uref, NULL);
+    assert(!nb_packets);
+
     nb_packets++;
     upipe_release(upipe_ts_sync);
     assert(!nb_packets);
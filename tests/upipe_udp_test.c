@@ -51,6 +51,7 @@
 #include <upipe/uref_block.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
 #include <upipe/uref_std.h>
 #include <upipe/upump.h>
 #include <upump-ev/upump_ev.h>
@@ -62,6 +63,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <assert.h>
@@ -80,6 +82,7 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 #define BUF_SIZE 256
 #define FORMAT "This is packet number %d"
+#define BATCH_SIZE 8
 
 /* FIXME: uncomment or remove */
 /*static void usage(const char *argv0) {
@@ -102,6 +105,10 @@ struct addrinfo hints, *servinfo, *p;
 struct upipe *upipe_udpsrc;
 struct upipe *upipe_udpsink;
 static int counter = 0;
+/* first packet of the batch test, or -1 */
+static int batch_start = -1;
+/* reception dates of the packets of the batch test */
+static uint64_t batch_dates[BATCH_SIZE];
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -160,7 +167,14 @@ static void test_input(struct upipe *upipe, struct uref *uref,
         udpsrc_test->counter++;
         uref_block_peek_unmap(uref, 0, buf, rbuf);
     }
-    if (udpsrc_test->counter == 110 || udpsrc_test->counter == 210) {
+    if (batch_start != -1) {
+        int n = udpsrc_test->counter - 1 - batch_start;
+        assert(n >= 0 && n < BATCH_SIZE);
+        ubase_assert(uref_clock_get_cr_sys(uref, &batch_dates[n]));
+    }
+    if (udpsrc_test->counter == 110 || udpsrc_test->counter == 210 ||
+        (batch_start != -1 &&
+         udpsrc_test->counter == batch_start + BATCH_SIZE)) {
         upipe_set_uri(upipe_udpsrc, NULL);
     }
 
@@ -249,6 +263,97 @@ static void genpackets2(struct upump *upump)
     }
 }
 
+/* sends a batch of datagrams of various sizes through the udp sink, and
+ * checks that they are received one by one and intact */
+static void test_sink_batch(bool gso)
+{
+    /* with segmentation offload, the first four datagrams and the last three
+     * are sent as two buffers, with a short last segment */
+    static const size_t sizes[BATCH_SIZE] = {
+        300, 300, 300, 120, 300, 500, 500, 7
+    };
+    if (!ubase_check(upipe_udpsink_set_gso(upipe_udpsink, gso)))
+        return;
+    printf("Sending a batch %s segmentation offload\n",
+           gso ? "with" : "without");
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd != -1);
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    char uri[64];
+    snprintf(uri, sizeof(uri), "127.0.0.1:%u", ntohs(addr.sin_port));
+    ubase_assert(upipe_set_uri(upipe_udpsink, uri));
+
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, sizes[i]);
+        assert(uref != NULL);
+        uint8_t *buf;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buf));
+        assert(size == sizes[i]);
+        for (int j = 0; j < size; j++)
+            buf[j] = i * 31 + j;
+        uref_block_unmap(uref, 0);
+        upipe_input(upipe_udpsink, uref, NULL);
+    }
+
+    /* the batch is full, so it was sent by the last input */
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        uint8_t buf[1024];
+        ssize_t ret = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        assert(ret == sizes[i]);
+        for (int j = 0; j < ret; j++)
+            assert(buf[j] == (uint8_t)(i * 31 + j));
+    }
+    assert(recv(fd, NULL, 0, MSG_DONTWAIT) == -1);
+    close(fd);
+}
+
+/* sends fewer datagrams than a batch and releases the udp sink, and checks
+ * that the datagrams still waiting are sent */
+static void test_sink_release(void)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd != -1);
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(getsockname(fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    char uri[64];
+    snprintf(uri, sizeof(uri), "127.0.0.1:%u", ntohs(addr.sin_port));
+    ubase_assert(upipe_set_uri(upipe_udpsink, uri));
+
+    for (int i = 0; i < 3; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, 100);
+        assert(uref != NULL);
+        uint8_t *buf;
+        int size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buf));
+        memset(buf, i, size);
+        uref_block_unmap(uref, 0);
+        upipe_input(upipe_udpsink, uref, NULL);
+    }
+    upipe_release(upipe_udpsink);
+
+    for (int i = 0; i < 3; i++) {
+        uint8_t buf[1024];
+        ssize_t ret = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        assert(ret == 100);
+        assert(buf[0] == i && buf[99] == i);
+    }
+    assert(recv(fd, NULL, 0, MSG_DONTWAIT) == -1);
+    close(fd);
+}
+
 int main(int argc, char *argv[])
 {
     char udp_uri[512], port_str[8];
@@ -352,6 +457,14 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_flow_def(upipe_udpsink, flow_def));
     uref_free(flow_def);
 
+    /* send datagrams in batches, if supported */
+    if (ubase_check(upipe_udpsink_set_batch(upipe_udpsink, 8))) {
+        unsigned int batch;
+        ubase_assert(upipe_udpsink_get_batch(upipe_udpsink, &batch));
+        assert(batch == 8);
+        upipe_udpsink_set_gso(upipe_udpsink, true);
+    }
+
     /* reset source uri */
     for (i=0; i < 10; i++) {
         port = ((rand() % 40000) + 1024);
@@ -364,6 +477,21 @@ int main(int argc, char *argv[])
     assert(ret);
     ubase_assert(upipe_set_uri(upipe_udpsink, udp_uri+1));
 
+    /* read datagrams in batches, if supported */
+    if (ubase_check(upipe_udpsrc_set_batch(upipe_udpsrc, 8))) {
+        unsigned int batch;
+        ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+        assert(batch == 8);
+    }
+
+    /* date datagrams with kernel timestamps, if supported */
+    if (ubase_check(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                        UPIPE_UDPSRC_TIMESTAMP_KERNEL))) {
+        int timestamp;
+        ubase_assert(upipe_udpsrc_get_timestamp(upipe_udpsrc, &timestamp));
+        assert(timestamp == UPIPE_UDPSRC_TIMESTAMP_KERNEL);
+    }
+
     /* redefine write pump */
     write_pump = upump_alloc_idler(upump_mgr, genpackets2, NULL, NULL);
     assert(write_pump);
@@ -372,10 +500,107 @@ int main(int argc, char *argv[])
     /* fire again */
     upump_mgr_run(upump_mgr, NULL);
 
-    /* release */
     upump_free(write_pump);
+
+    /* read datagrams sent at different times in a single batch, and check
+     * that each of them has its own date */
+    if (ubase_check(upipe_udpsrc_set_batch(upipe_udpsrc, BATCH_SIZE))) {
+        ubase_assert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                                                UPIPE_UDPSRC_TIMESTAMP_UCLOCK));
+        for (i=0; i < 10; i++) {
+            port = ((rand() % 40000) + 1024);
+            snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d", port);
+            printf("Trying uri: %s ...\n", udp_uri);
+            if (( ret = ubase_check(upipe_set_uri(upipe_udpsrc, udp_uri)) )) {
+                break;
+            }
+        }
+        assert(ret);
+
+        freeaddrinfo(servinfo);
+        snprintf(port_str, sizeof(port_str), "%d", port);
+        assert(getaddrinfo("127.0.0.1", port_str, &hints, &servinfo) == 0);
+        p = servinfo;
+        sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        assert(sockfd != -1);
+
+        /* the datagrams are queued before the pump runs */
+        uint64_t before = uclock_now(uclock);
+        batch_start = udpsrc_test_from_upipe(udpsrc_test)->counter;
+        for (i = 0; i < BATCH_SIZE; i++) {
+            uint8_t buf[BUF_SIZE];
+            memset(buf, 0, sizeof(buf));
+            snprintf((char *)buf, BUF_SIZE, FORMAT, batch_start + i);
+            assert(sendto(sockfd, buf, BUF_SIZE, 0,
+                          p->ai_addr, p->ai_addrlen) == BUF_SIZE);
+            usleep(2000);
+        }
+
+        upump_mgr_run(upump_mgr, NULL);
+        uint64_t after = uclock_now(uclock);
+        close(sockfd);
+
+        assert(udpsrc_test_from_upipe(udpsrc_test)->counter ==
+               batch_start + BATCH_SIZE);
+        for (i = 0; i < BATCH_SIZE; i++) {
+            printf("Packet %d received at %"PRIu64"\n", batch_start + i,
+                   batch_dates[i] - before);
+            assert(batch_dates[i] + UCLOCK_FREQ / 1000 >= before);
+            assert(batch_dates[i] <= after);
+            if (i)
+                assert(batch_dates[i] >=
+                       batch_dates[i - 1] + UCLOCK_FREQ / 1000);
+        }
+    }
+
+    /* check the datagrams sent in a batch, if supported */
+    if (ubase_check(upipe_udpsink_set_batch(upipe_udpsink, BATCH_SIZE))) {
+        test_sink_batch(false);
+        test_sink_batch(true);
+    }
+
+    /* socket option errors are reported, and leave the configuration as is */
+    int pipefd[2], fd;
+    assert(pipe(pipefd) == 0);
+    ubase_assert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                                            UPIPE_UDPSRC_TIMESTAMP_KERNEL));
+    ubase_nassert(upipe_udpsrc_set_fd(upipe_udpsrc, pipefd[0]));
+    ubase_assert(upipe_udpsrc_get_fd(upipe_udpsrc, &fd));
+    assert(fd == -1);
+    ubase_assert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                                            UPIPE_UDPSRC_TIMESTAMP_UCLOCK));
+    ubase_assert(upipe_udpsrc_set_fd(upipe_udpsrc, pipefd[0]));
+    ubase_nassert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                                             UPIPE_UDPSRC_TIMESTAMP_KERNEL));
+    int timestamp;
+    ubase_assert(upipe_udpsrc_get_timestamp(upipe_udpsrc, &timestamp));
+    assert(timestamp == UPIPE_UDPSRC_TIMESTAMP_UCLOCK);
+    ubase_assert(upipe_udpsrc_set_fd(upipe_udpsrc, -1));
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+#ifdef SO_TIMESTAMPNS
+    /* the timestamping options of a socket given by the caller are left as
+     * they are */
+    ubase_assert(upipe_udpsrc_set_batch(upipe_udpsrc, 1));
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    assert(sock != -1);
+    int enable = 1;
+    socklen_t enable_len = sizeof(enable);
+    assert(setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS,
+                      &enable, enable_len) == 0);
+    ubase_assert(upipe_udpsrc_set_fd(upipe_udpsrc, sock));
+    enable = 0;
+    assert(getsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS,
+                      &enable, &enable_len) == 0);
+    assert(enable);
+    ubase_assert(upipe_udpsrc_set_fd(upipe_udpsrc, -1));
+    close(sock);
+#endif
+
+    /* release */
     upipe_release(upipe_udpsrc);
-    upipe_release(upipe_udpsink);
+    test_sink_release();
     test_free(udpsrc_test);
     upipe_mgr_release(upipe_udpsrc_mgr); /* nop */
     upump_mgr_release(upump_mgr);
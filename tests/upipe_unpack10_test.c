@@ -181,25 +181,40 @@ int main(int argc, char *argv[])
     assert(sink != NULL);
     ubase_assert(upipe_set_output(upipe_unpack10, sink));
 
-    uint8_t *buffer;
-    int size;
-    uref = uref_block_alloc(uref_mgr, ubuf_mgr, WIDTH * 10 / 8);
-    assert(uref != NULL);
-    size = -1;
-    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
-    assert(size == WIDTH * 10 / 8);
-
-    struct ubits s;
-    ubits_init(&s, buffer, size, UBITS_WRITE);
-    for (int i = 0; i < WIDTH; i++)
-        ubits_put(&s, 10, i);
-    uint8_t *end;
-    ubase_assert(ubits_clean(&s, &end));
-    assert(end == &buffer[size]);
+    unsigned int threads;
+    ubase_assert(upipe_unpack10bit_get_threads(upipe_unpack10, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_unpack10bit_set_threads(upipe_unpack10, 0));
+
+    for (int n = 0; n < 2; n++) {
+        if (n == 1) {
+            ubase_assert(upipe_unpack10bit_set_threads(upipe_unpack10, 3));
+            ubase_assert(upipe_unpack10bit_get_threads(upipe_unpack10,
+                                                       &threads));
+            assert(threads == 3);
+        }
 
-    uref_block_unmap(uref, 0);
-    upipe_input(upipe_unpack10, uref, NULL);
-    assert(received_block);
+        uint8_t *buffer;
+        int size;
+        uref = uref_block_alloc(uref_mgr, ubuf_mgr, WIDTH * 10 / 8);
+        assert(uref != NULL);
+        size = -1;
+        ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+        assert(size == WIDTH * 10 / 8);
+
+        struct ubits s;
+        ubits_init(&s, buffer, size, UBITS_WRITE);
+        for (int i = 0; i < WIDTH; i++)
+            ubits_put(&s, 10, i);
+        uint8_t *end;
+        ubase_assert(ubits_clean(&s, &end));
+        assert(end == &buffer[size]);
+
+        uref_block_unmap(uref, 0);
+        received_block = false;
+        upipe_input(upipe_unpack10, uref, NULL);
+        assert(received_block);
+    }
 
     upipe_release(upipe_unpack10);
     upipe_mgr_release(upipe_unpack10bit_mgr); // nop
@@ -61,7 +61,7 @@
 #define UBUF_ALIGN 32
 
 #define TEST_WIDTH 1920
-#define TEST_HEIGHT 1
+#define TEST_HEIGHT 4
 
 const char *v210_chroma = "u10y10v10y10u10y10v10y10u10y10v10y10";
 
@@ -315,6 +315,20 @@ int main(int argc, char **argv)
     struct uref *pic = uref_dup(input_uref);
     assert(pic);
     upipe_input(v210dec, pic, 0);
+    assert(test_sucessful);
+
+    /* send it again, converted by several threads */
+    unsigned int threads;
+    ubase_assert(upipe_v210dec_get_threads(v210dec, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_v210dec_set_threads(v210dec, 0));
+    ubase_assert(upipe_v210dec_set_threads(v210dec, 3));
+    ubase_assert(upipe_v210dec_get_threads(v210dec, &threads));
+    assert(threads == 3);
+    test_sucessful = false;
+    pic = uref_dup(input_uref);
+    assert(pic);
+    upipe_input(v210dec, pic, 0);
 
     uref_free(in_flow_def);
     uref_free(out_flow_8);
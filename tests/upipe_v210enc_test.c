@@ -58,7 +58,7 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_VERBOSE
 
 #define TEST_WIDTH 1920
-#define TEST_HEIGHT 1
+#define TEST_HEIGHT 4
 
 #define VALUE_Y 64
 #define VALUE_U 128
@@ -297,6 +297,20 @@ int main(int argc, char **argv)
     struct uref *pic = uref_dup(input_uref);
     assert(pic);
     upipe_input(v210enc, pic, 0);
+    assert(test_sucessful);
+
+    /* send it again, converted by several threads */
+    unsigned int threads;
+    ubase_assert(upipe_v210enc_get_threads(v210enc, &threads));
+    assert(threads == 1);
+    ubase_nassert(upipe_v210enc_set_threads(v210enc, 0));
+    ubase_assert(upipe_v210enc_set_threads(v210enc, 3));
+    ubase_assert(upipe_v210enc_get_threads(v210enc, &threads));
+    assert(threads == 3);
+    test_sucessful = false;
+    pic = uref_dup(input_uref);
+    assert(pic);
+    upipe_input(v210enc, pic, 0);
 
     uref_free(in_flow_def);
     /* release v210enc pipe */
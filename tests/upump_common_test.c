@@ -31,7 +31,6 @@
 
 #include <upipe/upump.h>
 #include <upipe/upump_blocker.h>
-#include <upump-ev/upump_ev.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -151,6 +150,12 @@ static void timer_again_2_cb(struct upump *upump)
         upump_restart(timer);
 }
 
+static void free_timer_cb(struct upump *upump)
+{
+    printf("free timer passed\n");
+    upump_free(upump);
+}
+
 static void timer_2_cb(struct upump *upump)
 {
     static unsigned last_timeout_count = 0;
@@ -185,12 +190,57 @@ void run(struct upump_mgr *mgr)
                                        pipefd[0]);
     assert(read_watcher != NULL);
 
+    /* Statistics are optional */
+    int err = upump_mgr_set_stats(mgr, true);
+    assert(err == UBASE_ERR_NONE || err == UBASE_ERR_UNHANDLED);
+    bool stats = err == UBASE_ERR_NONE;
+
     /* Start tests */
     upump_start(write_idler);
     upump_mgr_run(mgr, NULL);
     assert(bytes_read);
     assert(bytes_read == bytes_written);
 
+    if (stats) {
+        struct upump_stats upump_stats;
+        ubase_assert(upump_get_stats(write_idler, &upump_stats));
+        assert(upump_stats.calls);
+        assert(upump_stats.total >= upump_stats.max);
+        ubase_assert(upump_get_stats(read_timer, &upump_stats));
+        assert(upump_stats.calls == 1);
+
+        struct upump_mgr_stats mgr_stats;
+        ubase_assert(upump_mgr_get_stats(mgr, &mgr_stats));
+        assert(mgr_stats.iterations);
+        uint64_t callbacks = 0, lateness = 0;
+        for (unsigned int i = 0; i < UPUMP_HISTO_BUCKETS; i++) {
+            callbacks += mgr_stats.callbacks[i];
+            lateness += mgr_stats.timer_lateness[i];
+        }
+        assert(callbacks >= upump_stats.calls);
+        assert(lateness == 1);
+
+        unsigned int nb_upumps = 0;
+        struct upump *upump = NULL;
+        while (ubase_check(upump_mgr_iterate(mgr, &upump)) && upump != NULL)
+            nb_upumps++;
+        assert(nb_upumps == 4);
+
+        /* a pump freeing itself from its callback */
+        struct upump *free_timer =
+            upump_alloc_timer(mgr, free_timer_cb, NULL, NULL, 0, 0);
+        assert(free_timer != NULL);
+        upump_start(free_timer);
+        upump_mgr_run(mgr, NULL);
+        ubase_assert(upump_mgr_get_stats(mgr, &mgr_stats));
+        lateness = 0;
+        for (unsigned int i = 0; i < UPUMP_HISTO_BUCKETS; i++)
+            lateness += mgr_stats.timer_lateness[i];
+        assert(lateness == 2);
+
+        ubase_assert(upump_mgr_set_stats(mgr, false));
+    }
+
     /* Clean up */
     upump_free(write_idler);
     upump_free(write_watcher);
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for upump manager with io_uring event loop
+ */
+
+#undef NDEBUG
+
+#include <upipe/uclock.h>
+#include <upump-uring/upump_uring.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "upump_common_test.h"
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+
+static const char *message = "uring";
+static char buffer[16];
+static bool written = false, read_done = false, signaled = false;
+
+static void write_cb(struct upump_uring_io *io, int res)
+{
+    assert(res == strlen(message));
+    written = true;
+}
+
+static void read_cb(struct upump_uring_io *io, int res)
+{
+    assert(res == strlen(message));
+    assert(!memcmp(buffer, message, res));
+    read_done = true;
+}
+
+static void cancel_cb(struct upump_uring_io *io, int res)
+{
+    assert(res == -ECANCELED || res == -EINTR);
+    *(bool *)io->opaque = true;
+}
+
+static void signal_cb(struct upump *upump)
+{
+    signaled = true;
+    upump_stop(upump);
+}
+
+static void raise_cb(struct upump *upump)
+{
+    raise(SIGUSR1);
+}
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *mgr = upump_uring_mgr_alloc(UPUMP_POOL,
+                                                  UPUMP_BLOCKER_POOL);
+    assert(mgr != NULL);
+
+    /* queued I/O */
+    int fds[2];
+    assert(pipe(fds) != -1);
+    struct upump_uring_io read_io = {
+        .type = UPUMP_URING_IO_READ, .fd = fds[0],
+        .buf = buffer, .len = sizeof(buffer), .offset = -1,
+        .cb = read_cb
+    };
+    struct upump_uring_io write_io = {
+        .type = UPUMP_URING_IO_WRITE, .fd = fds[1],
+        .buf = (void *)message, .len = strlen(message), .offset = -1,
+        .cb = write_cb
+    };
+    assert(ubase_check(upump_uring_mgr_submit(mgr, &read_io)));
+    assert(ubase_check(upump_uring_mgr_submit(mgr, &write_io)));
+    upump_mgr_run(mgr, NULL);
+    assert(written && read_done);
+
+    /* cancellation */
+    bool cancelled = false;
+    read_io.cb = cancel_cb;
+    read_io.opaque = &cancelled;
+    assert(ubase_check(upump_uring_mgr_submit(mgr, &read_io)));
+    assert(ubase_check(upump_uring_mgr_cancel(mgr, &read_io)));
+    upump_mgr_run(mgr, NULL);
+    assert(cancelled);
+    close(fds[0]);
+    close(fds[1]);
+
+    /* signals */
+    struct upump *signal_pump = upump_alloc_signal(mgr, signal_cb, NULL, NULL,
+                                                   SIGUSR1);
+    assert(signal_pump != NULL);
+    struct upump *raise_pump = upump_alloc_timer(mgr, raise_cb, NULL, NULL,
+                                                 UCLOCK_FREQ / 100, 0);
+    assert(raise_pump != NULL);
+    upump_start(signal_pump);
+    upump_start(raise_pump);
+    upump_mgr_run(mgr, NULL);
+    assert(signaled);
+    upump_free(signal_pump);
+    upump_free(raise_pump);
+
+    run(mgr);
+    return 0;
+}
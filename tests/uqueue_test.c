@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for uqueue batches and long queues (without event loop)
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/uqueue.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define UQUEUE_DEPTH 1000
+#define NB_THREADS 3
+#define NB_ELEMS 100000
+#define BATCH 17
+
+/** elements are encoded as (thread << 24) | (number + 1) */
+#define ELEM(thread, number) \
+    ((void *)(uintptr_t)(((uintptr_t)(thread) << 24) | ((number) + 1)))
+
+static struct uqueue uqueue;
+
+static void *push_thread(void *_thread)
+{
+    uintptr_t thread = (uintptr_t)_thread;
+    unsigned int number = 0;
+    while (number < NB_ELEMS) {
+        void *elems[BATCH];
+        unsigned int nb = 1 + (number % BATCH);
+        if (nb > NB_ELEMS - number)
+            nb = NB_ELEMS - number;
+        for (unsigned int i = 0; i < nb; i++)
+            elems[i] = ELEM(thread, number + i);
+        unsigned int pushed = uqueue_push_batch(&uqueue, elems, nb);
+        number += pushed;
+        if (pushed < nb)
+            sched_yield();
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *extra;
+    void *elems[UQUEUE_DEPTH + 1];
+
+    /* limits */
+    extra = malloc(uqueue_sizeof(UQUEUE_DEPTH));
+    assert(extra != NULL);
+    assert(!uqueue_init(&uqueue, 0, extra));
+    assert(!uqueue_init(&uqueue, UQUEUE_MAX_LENGTH + 1, extra));
+    assert(uqueue_init(&uqueue, UQUEUE_DEPTH, extra));
+
+    for (unsigned int i = 0; i < UQUEUE_DEPTH + 1; i++)
+        elems[i] = ELEM(0, i);
+    assert(uqueue_push_batch(&uqueue, elems, UQUEUE_DEPTH - 10) ==
+           UQUEUE_DEPTH - 10);
+    assert(uqueue_push_batch(&uqueue, elems + UQUEUE_DEPTH - 10, 11) == 10);
+    assert(!uqueue_push(&uqueue, elems[UQUEUE_DEPTH]));
+    assert(uqueue_length(&uqueue) == UQUEUE_DEPTH);
+
+    void *popped[BATCH];
+    for (unsigned int i = 0; i < UQUEUE_DEPTH; ) {
+        unsigned int nb = uqueue_pop_batch(&uqueue, popped, BATCH);
+        assert(nb == (UQUEUE_DEPTH - i < BATCH ? UQUEUE_DEPTH - i : BATCH));
+        for (unsigned int j = 0; j < nb; j++)
+            assert(popped[j] == ELEM(0, i + j));
+        i += nb;
+    }
+    assert(!uqueue_pop_batch(&uqueue, popped, BATCH));
+    assert(uqueue_pop(&uqueue, void *) == NULL);
+    assert(!uqueue_length(&uqueue));
+
+    /* a batch larger than the queue is cut, even if the queue is empty */
+    assert(uqueue_push_batch(&uqueue, elems, UQUEUE_DEPTH + 1) ==
+           UQUEUE_DEPTH);
+    assert(uqueue_length(&uqueue) == UQUEUE_DEPTH);
+    for (unsigned int i = 0; i < UQUEUE_DEPTH; ) {
+        unsigned int nb = uqueue_pop_batch(&uqueue, popped, BATCH);
+        assert(nb);
+        for (unsigned int j = 0; j < nb; j++)
+            assert(popped[j] == ELEM(0, i + j));
+        i += nb;
+    }
+    assert(!uqueue_length(&uqueue));
+    uqueue_clean(&uqueue);
+
+    /* single element queue */
+    assert(uqueue_init(&uqueue, 1, extra));
+    for (unsigned int i = 0; i < 10; i++) {
+        assert(uqueue_push(&uqueue, elems[i]));
+        assert(!uqueue_push(&uqueue, elems[i + 1]));
+        assert(uqueue_pop(&uqueue, void *) == elems[i]);
+        assert(uqueue_pop(&uqueue, void *) == NULL);
+    }
+    uqueue_clean(&uqueue);
+
+    /* concurrent producers */
+    assert(uqueue_init(&uqueue, UQUEUE_DEPTH, extra));
+    pthread_t threads[NB_THREADS];
+    for (uintptr_t i = 0; i < NB_THREADS; i++)
+        assert(pthread_create(&threads[i], NULL, push_thread,
+                              (void *)i) == 0);
+
+    unsigned int next[NB_THREADS] = { 0 };
+    unsigned int total = 0;
+    while (total < NB_THREADS * NB_ELEMS) {
+        unsigned int nb = uqueue_pop_batch(&uqueue, popped, BATCH);
+        if (!nb) {
+            sched_yield();
+            continue;
+        }
+        for (unsigned int j = 0; j < nb; j++) {
+            uintptr_t elem = (uintptr_t)popped[j];
+            unsigned int thread = elem >> 24;
+            assert(thread < NB_THREADS);
+            assert((elem & 0xffffff) == next[thread] + 1);
+            next[thread]++;
+        }
+        total += nb;
+    }
+
+    for (unsigned int i = 0; i < NB_THREADS; i++) {
+        assert(!pthread_join(threads[i], NULL));
+        assert(next[i] == NB_ELEMS);
+    }
+    assert(uqueue_pop(&uqueue, void *) == NULL);
+    uqueue_clean(&uqueue);
+    free(extra);
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for useqring
+ */
+
+#undef NDEBUG
+
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/useqring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define RING_SIZE 256
+#define NB_OPS 100000
+
+static struct uref_mgr *uref_mgr;
+
+/** model of the ring: uref stored for each sequence number */
+static struct uref *model[65536];
+
+/** checks the ring against the model */
+static void check(struct useqring *useqring)
+{
+    uint16_t head = useqring_head(useqring);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < RING_SIZE; i++) {
+        uint16_t seqnum = head + i;
+        assert(useqring_peek(useqring, seqnum) == model[seqnum]);
+        if (model[seqnum] != NULL)
+            count++;
+
+        uint16_t found;
+        bool next = false, missing = false;
+        for (uint32_t j = i; j < RING_SIZE; j++) {
+            if (!next && model[(uint16_t)(head + j)] != NULL) {
+                assert(useqring_next(useqring, seqnum, &found));
+                assert(found == (uint16_t)(head + j));
+                next = true;
+            }
+            if (!missing && model[(uint16_t)(head + j)] == NULL) {
+                assert(useqring_next_missing(useqring, seqnum,
+                                             head + RING_SIZE, &found));
+                assert(found == (uint16_t)(head + j));
+                missing = true;
+            }
+            if (next && missing)
+                break;
+        }
+        if (!next)
+            assert(!useqring_next(useqring, seqnum, &found));
+        if (!missing)
+            assert(!useqring_next_missing(useqring, seqnum,
+                                          head + RING_SIZE, &found));
+    }
+    assert(useqring_count(useqring) == count);
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+
+    struct useqring useqring;
+    void *extra = malloc(useqring_sizeof(RING_SIZE));
+    assert(extra != NULL);
+    assert(!useqring_init(&useqring, 0, extra));
+    assert(!useqring_init(&useqring, RING_SIZE + 1, extra));
+    assert(!useqring_init(&useqring, USEQRING_MAX_SIZE * 2, extra));
+    assert(useqring_init(&useqring, RING_SIZE, extra));
+
+    /* window across the wrap-around of sequence numbers */
+    useqring_set_head(&useqring, 65500);
+    assert(useqring_head(&useqring) == 65500);
+
+    struct uref *uref = uref_alloc_control(uref_mgr);
+    assert(uref != NULL);
+    assert(useqring_insert(&useqring, 65499, uref) == USEQRING_LATE);
+    assert(useqring_insert(&useqring, (uint16_t)(65500 + RING_SIZE), uref) ==
+           USEQRING_AHEAD);
+    assert(useqring_insert(&useqring, 10, uref) == USEQRING_INSERTED);
+    model[10] = uref;
+    uref = uref_alloc_control(uref_mgr);
+    assert(uref != NULL);
+    assert(useqring_insert(&useqring, 10, uref) == USEQRING_DUPLICATE);
+    uref_free(uref);
+    check(&useqring);
+
+    /* random operations */
+    for (unsigned int i = 0; i < NB_OPS; i++) {
+        uint16_t head = useqring_head(&useqring);
+        uint16_t seqnum = head + rand() % (RING_SIZE + 16) - 8;
+        uint16_t offset = seqnum - head;
+        switch (rand() % 8) {
+            case 0:
+            case 1:
+            case 2: {
+                uref = uref_alloc_control(uref_mgr);
+                assert(uref != NULL);
+                enum useqring_status status =
+                    useqring_insert(&useqring, seqnum, uref);
+                if (offset >= 0x8000)
+                    assert(status == USEQRING_LATE);
+                else if (offset >= RING_SIZE)
+                    assert(status == USEQRING_AHEAD);
+                else if (model[seqnum] != NULL)
+                    assert(status == USEQRING_DUPLICATE);
+                else
+                    assert(status == USEQRING_INSERTED);
+                if (status == USEQRING_INSERTED)
+                    model[seqnum] = uref;
+                else
+                    uref_free(uref);
+                break;
+            }
+            case 3:
+                uref = useqring_remove(&useqring, seqnum);
+                if (offset < RING_SIZE) {
+                    assert(uref == model[seqnum]);
+                    model[seqnum] = NULL;
+                } else {
+                    assert(uref == NULL);
+                }
+                uref_free(uref);
+                break;
+            case 4:
+            case 5:
+                uref = useqring_pop(&useqring);
+                assert(uref == model[head]);
+                model[head] = NULL;
+                uref_free(uref);
+                assert(useqring_head(&useqring) == (uint16_t)(head + 1));
+                break;
+            case 6: {
+                /* move the window back or forward */
+                uint16_t new_head = head + rand() % 64 - 32;
+                for (uint32_t j = 0; j < RING_SIZE; j++) {
+                    uint16_t seq = head + j;
+                    if ((uint16_t)(seq - new_head) >= RING_SIZE)
+                        model[seq] = NULL;
+                }
+                useqring_set_head(&useqring, new_head);
+                assert(useqring_head(&useqring) == new_head);
+                break;
+            }
+            case 7:
+                if (!(rand() % 64)) {
+                    useqring_flush(&useqring);
+                    for (uint32_t j = 0; j < RING_SIZE; j++)
+                        model[(uint16_t)(head + j)] = NULL;
+                }
+                break;
+        }
+        if (!(i % 64))
+            check(&useqring);
+    }
+    check(&useqring);
+
+    useqring_clean(&useqring);
+    assert(!useqring_count(&useqring));
+    free(extra);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 OpenHeadend S.A.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for uslice pools
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/uslice.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define NB_THREADS 4
+#define NB_SLICES 32
+#define NB_JOBS 1000
+#define NB_QUEUED 8
+
+/** job counting the number of times each slice is processed */
+struct test_job {
+    struct uslice_job job;
+    unsigned int threads;
+    unsigned int done[NB_SLICES];
+    bool seen[NB_THREADS];
+};
+
+static void test_cb(struct uslice_job *job, unsigned int slice,
+                    unsigned int thread)
+{
+    struct test_job *test = container_of(job, struct test_job, job);
+    assert(slice < job->nb_slices);
+    assert(thread < test->threads);
+    test->done[slice]++;
+    test->seen[thread] = true;
+    if (!(slice % 4))
+        sched_yield();
+}
+
+static void test_init(struct test_job *test, unsigned int threads,
+                      unsigned int nb_slices)
+{
+    uslice_job_init(&test->job, test_cb, nb_slices);
+    test->threads = threads;
+    for (unsigned int i = 0; i < NB_SLICES; i++)
+        test->done[i] = 0;
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        test->seen[i] = false;
+}
+
+static void test_check(struct test_job *test)
+{
+    for (unsigned int i = 0; i < NB_SLICES; i++)
+        assert(test->done[i] == (i < test->job.nb_slices ? 1 : 0));
+}
+
+int main(int argc, char **argv)
+{
+    struct uslice_pool pool;
+    struct test_job test;
+    struct test_job queued[NB_QUEUED];
+
+    uslice_pool_init(&pool);
+    assert(uslice_pool_get_threads(&pool) == 1);
+    ubase_nassert(uslice_pool_set_threads(&pool, 0));
+    ubase_nassert(uslice_pool_set_threads(&pool, USLICE_MAX_THREADS + 1));
+    assert(uslice_pool_get_threads(&pool) == 1);
+
+    /* single thread: everything runs in the calling thread */
+    test_init(&test, 1, NB_SLICES);
+    uslice_pool_run(&pool, &test.job);
+    test_check(&test);
+    assert(test.seen[0]);
+
+    /* worker threads, including jobs without slices or with fewer slices
+     * than threads */
+    ubase_assert(uslice_pool_set_threads(&pool, NB_THREADS));
+    assert(uslice_pool_get_threads(&pool) == NB_THREADS);
+    for (unsigned int i = 0; i < NB_JOBS; i++) {
+        test_init(&test, NB_THREADS, i % (NB_SLICES + 1));
+        uslice_pool_run(&pool, &test.job);
+        test_check(&test);
+    }
+
+    /* several jobs in flight, waited for in order */
+    for (unsigned int i = 0; i < NB_JOBS / NB_QUEUED; i++) {
+        for (unsigned int j = 0; j < NB_QUEUED; j++) {
+            test_init(&queued[j], NB_THREADS, NB_SLICES);
+            uslice_pool_queue(&pool, &queued[j].job);
+        }
+        for (unsigned int j = 0; j < NB_QUEUED; j++) {
+            uslice_pool_wait(&pool, &queued[j].job);
+            test_check(&queued[j]);
+        }
+    }
+
+    /* restarting the threads */
+    ubase_assert(uslice_pool_set_threads(&pool, 2));
+    test_init(&test, 2, NB_SLICES);
+    uslice_pool_run(&pool, &test.job);
+    test_check(&test);
+    ubase_assert(uslice_pool_set_threads(&pool, 1));
+    test_init(&test, 1, NB_SLICES);
+    uslice_pool_run(&pool, &test.job);
+    test_check(&test);
+
+    ubase_assert(uslice_pool_set_threads(&pool, NB_THREADS));
+    uslice_pool_clean(&pool);
+    return 0;
+}